@@ -69,6 +69,7 @@
 
 #include "btstack.h"
 
+#include "btstack_jitter_buffer.h"
 #include "btstack_resample.h"
 
 //#define AVRCP_BROWSING_ENABLED
@@ -77,10 +78,6 @@
 #include "btstack_stdin.h"
 #endif
 
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-#include "btstack_sample_rate_compensation.h"
-#endif
-
 #include "btstack_ring_buffer.h"
 
 #ifdef HAVE_POSIX_FILE_IO
@@ -104,10 +101,6 @@ static const char * device_addr_string = "00:1B:DC:08:E2:72"; // pts v5.0
 #endif
 static bd_addr_t device_addr;
 
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-static btstack_sample_rate_compensation_t sample_rate_compensation;
-#endif
-
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
 static uint8_t  sdp_avdtp_sink_service_buffer[150];
@@ -132,14 +125,12 @@ static char * wav_filename = "a2dp_sink_demo.wav";
 static const btstack_sbc_decoder_t *   sbc_decoder_instance;
 static btstack_sbc_decoder_bluedroid_t sbc_decoder_context;
 
-// ring buffer for SBC Frames
-// below 30: add samples, 30-40: fine, above 40: drop samples
-#define OPTIMAL_FRAMES_MIN 60
-#define OPTIMAL_FRAMES_MAX 80
-#define ADDITIONAL_FRAMES  30
-static uint8_t sbc_frame_storage[(OPTIMAL_FRAMES_MAX + ADDITIONAL_FRAMES) * MAX_SBC_FRAME_SIZE];
-static btstack_ring_buffer_t sbc_frame_ring_buffer;
-static unsigned int sbc_frame_size;
+// jitter buffer for SBC Frames, adapts its depth to the link quality and provides the resampling factor
+#define JITTER_BUFFER_FRAMES 128
+static uint8_t sbc_frame_storage[JITTER_BUFFER_FRAMES * (MAX_SBC_FRAME_SIZE + BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE)];
+static btstack_jitter_buffer_t sbc_jitter_buffer;
+static uint16_t sbc_samples_per_frame;
+static int16_t  sbc_silence_frame[SBC_MAX_AUDIO_FRAMES_PER_BLOCK * NUM_CHANNELS];
 
 // overflow buffer for not fully used sbc frames, with additional frames for resampling
 static uint8_t decoded_audio_storage[RESAMPLE_OUTPUT_FRAMES * BYTES_PER_FRAME];
@@ -147,9 +138,6 @@ static btstack_ring_buffer_t decoded_audio_ring_buffer;
 
 static int media_initialized = 0;
 static int audio_stream_started;
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-static int l2cap_stream_started;
-#endif
 static btstack_resample_t resample_instance;
 static uint32_t resampling_min_factor;
 
@@ -380,6 +368,8 @@ static int setup_demo(void){
 /* LISTING_END */
 
 
+static void handle_pcm_data(int16_t * data, int num_audio_frames, int num_channels, int sample_rate, void * context);
+
 static void playback_handler(int16_t * buffer, uint16_t num_audio_frames, const btstack_audio_context_t * context){
     UNUSED(context);
 
@@ -389,7 +379,7 @@ static void playback_handler(int16_t * buffer, uint16_t num_audio_frames, const
 #endif
     
     // called from lower-layer but guaranteed to be on main thread
-    if (sbc_frame_size == 0){
+    if (!media_initialized){
         memset(buffer, 0, num_audio_frames * BYTES_PER_FRAME);
         return;
     }
@@ -403,11 +393,25 @@ static void playback_handler(int16_t * buffer, uint16_t num_audio_frames, const
     // then start decoding sbc frames using request_* globals
     request_buffer = buffer;
     request_frames = num_audio_frames;
-    while (request_frames && btstack_ring_buffer_bytes_available(&sbc_frame_ring_buffer) >= sbc_frame_size){
-        // decode frame
-        uint8_t sbc_frame[MAX_SBC_FRAME_SIZE];
-        btstack_ring_buffer_read(&sbc_frame_ring_buffer, sbc_frame, sbc_frame_size, &bytes_read);
-        sbc_decoder_instance->decode_signed_16(&sbc_decoder_context, 0, sbc_frame, sbc_frame_size);
+    while (request_frames > 0){
+        uint8_t  sbc_frame[MAX_SBC_FRAME_SIZE];
+        uint16_t sbc_frame_size;
+        btstack_jitter_buffer_read_status_t status = btstack_jitter_buffer_read_frame(&sbc_jitter_buffer, sbc_frame, sizeof(sbc_frame), &sbc_frame_size);
+        if (status == BTSTACK_JITTER_BUFFER_READ_EMPTY){
+            break;
+        }
+        if (status == BTSTACK_JITTER_BUFFER_READ_MISSING){
+            // conceal lost frame with silence
+            handle_pcm_data(sbc_silence_frame, sbc_samples_per_frame, NUM_CHANNELS, 0, NULL);
+        } else {
+            // decode frame
+            sbc_decoder_instance->decode_signed_16(&sbc_decoder_context, 0, sbc_frame, sbc_frame_size);
+        }
+    }
+
+    // play silence while jitter buffer is filling up
+    if (request_frames > 0){
+        memset(request_buffer, 0, request_frames * BYTES_PER_FRAME);
     }
 
 #ifdef STORE_TO_WAV_FILE
@@ -459,7 +463,8 @@ static int media_processing_init(media_codec_configuration_sbc_t * configuration
     wav_writer_open(wav_filename, configuration->num_channels, configuration->sampling_frequency);
 #endif
 
-    btstack_ring_buffer_init(&sbc_frame_ring_buffer, sbc_frame_storage, sizeof(sbc_frame_storage));
+    sbc_samples_per_frame = configuration->block_length * configuration->subbands;
+    btstack_jitter_buffer_init(&sbc_jitter_buffer, sbc_frame_storage, sizeof(sbc_frame_storage), configuration->sampling_frequency, sbc_samples_per_frame);
     btstack_ring_buffer_init(&decoded_audio_ring_buffer, decoded_audio_storage, sizeof(decoded_audio_storage));
     btstack_resample_init(&resample_instance, configuration->num_channels);
     resampling_min_factor = btstack_resample_get_min_factor_for_output_capacity(SBC_MAX_AUDIO_FRAMES_PER_BLOCK, RESAMPLE_OUTPUT_FRAMES);
@@ -478,9 +483,6 @@ static int media_processing_init(media_codec_configuration_sbc_t * configuration
 static void media_processing_start(void){
     if (!media_initialized) return;
 
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-    btstack_sample_rate_compensation_reset( &sample_rate_compensation, btstack_run_loop_get_time_ms() );
-#endif
     // setup audio playback
     const btstack_audio_sink_t * audio = btstack_audio_sink_get_instance();
     if (audio){
@@ -494,9 +496,6 @@ static void media_processing_pause(void){
 
     // stop audio playback
     audio_stream_started = 0;
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-    l2cap_stream_started = 0;
-#endif
 
     const btstack_audio_sink_t * audio = btstack_audio_sink_get_instance();
     if (audio){
@@ -504,7 +503,7 @@ static void media_processing_pause(void){
     }
     // discard pending data
     btstack_ring_buffer_reset(&decoded_audio_ring_buffer);
-    btstack_ring_buffer_reset(&sbc_frame_ring_buffer);
+    btstack_jitter_buffer_reset(&sbc_jitter_buffer);
 }
 
 static void media_processing_close(void){
@@ -512,10 +511,11 @@ static void media_processing_close(void){
 
     media_initialized = 0;
     audio_stream_started = 0;
-    sbc_frame_size = 0;
-#ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-    l2cap_stream_started = 0;
-#endif
+
+    btstack_jitter_buffer_statistics_t statistics;
+    btstack_jitter_buffer_get_statistics(&sbc_jitter_buffer, &statistics);
+    printf("Jitter buffer: %" PRIu32 " packets received, %" PRIu32 " lost, %" PRIu32 " late, %" PRIu32 " frames concealed, %" PRIu32 " underruns, target %u frames\n",
+           statistics.packets_received, statistics.packets_lost, statistics.packets_late, statistics.frames_concealed, statistics.underruns, statistics.target_frames);
 
 #ifdef STORE_TO_WAV_FILE                 
     wav_writer_close();
@@ -537,8 +537,9 @@ static void media_processing_close(void){
  *
  * @text Here the audio data, are received through the handle_l2cap_media_data_packet callback.
  * Currently, only the SBC media codec is supported. Hence, the media data consists of the media packet header and the SBC packet.
- * The SBC frame will be stored in a ring buffer for later processing (instead of decoding it to PCM right away which would require a much larger buffer).
- * If the audio stream wasn't started already and there are enough SBC frames in the ring buffer, start playback.
+ * The SBC frames will be stored in a jitter buffer for later processing (instead of decoding it to PCM right away which would require a much larger buffer).
+ * The jitter buffer detects lost packets, adapts its depth to the link quality, and provides the resampling factor to keep its level.
+ * If the audio stream wasn't started already and the jitter buffer reached its target depth, start playback.
  */ 
 
 static int read_media_data_header(uint8_t * packet, int size, int * offset, avdtp_media_packet_header_t * media_header);
@@ -564,49 +565,24 @@ static void handle_l2cap_media_data_packet(uint8_t seid, uint8_t *packet, uint16
         return;
     }
 
-    // store sbc frame size for buffer management
-    sbc_frame_size = packet_length / sbc_header.num_frames;
-    int status = btstack_ring_buffer_write(&sbc_frame_ring_buffer, packet_begin, packet_length);
+    // store sbc frames in jitter buffer, lost packets are detected by RTP sequence number and timestamp
+    uint8_t status = btstack_jitter_buffer_write_packet(&sbc_jitter_buffer, media_header.sequence_number, media_header.timestamp,
+                                                        btstack_run_loop_get_time_ms(), packet_begin, packet_length, sbc_header.num_frames);
     if (status != ERROR_CODE_SUCCESS){
-        printf("Error storing samples in SBC ring buffer!!!\n");
+        printf("Error storing SBC frames in jitter buffer!!!\n");
     }
 
-    // decide on audio sync drift based on number of sbc frames in queue
-    int sbc_frames_in_buffer = btstack_ring_buffer_bytes_available(&sbc_frame_ring_buffer) / sbc_frame_size;
 #ifdef HAVE_BTSTACK_AUDIO_EFFECTIVE_SAMPLERATE
-    if( !l2cap_stream_started && audio_stream_started ) {
-        l2cap_stream_started = 1;
-        btstack_sample_rate_compensation_init( &sample_rate_compensation, btstack_run_loop_get_time_ms(), a2dp_sink_demo_a2dp_connection.sbc_configuration.sampling_frequency, FLOAT_TO_Q15(1.f) );
-    }
-    // update sample rate compensation
-    if( audio_stream_started && (audio != NULL)) {
-        uint32_t resampling_factor = btstack_sample_rate_compensation_update( &sample_rate_compensation, btstack_run_loop_get_time_ms(), sbc_header.num_frames * SBC_MAX_AUDIO_FRAMES_PER_BLOCK, audio->get_samplerate() );
-        // limit resampling factor by minimum factor to avoid overrun of output buffer in handle_pcm_data()
-        uint32_t resampling_factor_clamped = btstack_max(resampling_factor, resampling_min_factor);
-        btstack_resample_set_factor(&resample_instance, resampling_factor_clamped);
-//        printf("sbc buffer level :            %"PRIu32"\n", btstack_ring_buffer_bytes_available(&sbc_frame_ring_buffer));
-    }
-#else
-    uint32_t resampling_factor;
+    // measure sample rate drift against actual playback sample rate
+    btstack_jitter_buffer_set_playback_sample_rate(&sbc_jitter_buffer, audio->get_samplerate());
+#endif
 
-    // nominal factor (fixed-point 2^16) and compensation offset
-    uint32_t nominal_factor = 0x10000;
-    uint32_t compensation   = 0x00100;
+    // limit resampling factor by minimum factor to avoid overrun of output buffer in handle_pcm_data()
+    uint32_t resampling_factor = btstack_jitter_buffer_get_resampling_factor(&sbc_jitter_buffer);
+    btstack_resample_set_factor(&resample_instance, btstack_max(resampling_factor, resampling_min_factor));
 
-    if (sbc_frames_in_buffer < OPTIMAL_FRAMES_MIN){
-    	resampling_factor = nominal_factor - compensation;    // stretch samples
-    } else if (sbc_frames_in_buffer <= OPTIMAL_FRAMES_MAX){
-    	resampling_factor = nominal_factor;                   // nothing to do
-    } else {
-    	resampling_factor = nominal_factor + compensation;    // compress samples
-    }
-
-    // assert output buffer is large enough for handle_pcm_data()
-    btstack_assert(resampling_factor >= resampling_min_factor);
-    btstack_resample_set_factor(&resample_instance, resampling_factor);
-#endif
     // start stream if enough frames buffered
-    if (!audio_stream_started && sbc_frames_in_buffer >= OPTIMAL_FRAMES_MIN){
+    if (!audio_stream_started && btstack_jitter_buffer_is_playing(&sbc_jitter_buffer)){
         media_processing_start();
     }
 }
@@ -53,6 +53,9 @@ typedef struct le_device_memory_db {
     bd_addr_t addr;
     sm_key_t irk;
 
+    // order of use, higher for more recently bonded or used devices
+    uint32_t last_used;
+
     // Stored pairing information allows to re-establish an enncrypted connection
     // with a peripheral that doesn't have any persistent memory
     sm_key_t ltk;
@@ -96,6 +99,7 @@ const  char * csv_header = "# addr_type, addr, irk, ltk, ediv, rand[8], key_size
 static char db_path[sizeof(DB_PATH_TEMPLATE) - 2 + 17 + 1];
 
 static le_device_memory_db_t le_devices[LE_DEVICE_MEMORY_SIZE];
+static uint32_t le_device_db_last_used;
 
 static char * bd_addr_to_dash_str(bd_addr_t addr){
     return bd_addr_to_str_with_delimiter(addr, '-');
@@ -301,6 +305,7 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     le_devices[index].addr_type = addr_type;
     memcpy(le_devices[index].addr, addr, 6);
     memcpy(le_devices[index].irk, irk, 16);
+    le_devices[index].last_used = ++le_device_db_last_used;
 #ifdef ENABLE_LE_SIGNED_WRITE
     le_devices[index].remote_counter = 0; 
 #endif
@@ -317,6 +322,16 @@ void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk)
     if (irk) memcpy(irk, le_devices[index].irk, 16);
 }
 
+void le_device_db_mark_used(int index){
+    if (le_devices[index].addr_type == BD_ADDR_TYPE_UNKNOWN) return;
+    if (le_devices[index].last_used == le_device_db_last_used) return;
+    le_devices[index].last_used = ++le_device_db_last_used;
+}
+
+uint32_t le_device_db_last_used_get(int index){
+    return le_devices[index].last_used;
+}
+
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
     log_info("LE Device DB set encryption for %u, ediv x%04x, key size %u, authenticated %u, authorized %u, secure connection %u",
         index, ediv, key_size, authenticated, authorized, secure_connection);
@@ -60,7 +60,7 @@
 
 typedef struct le_device_nvm {
 	uint32_t magic;
-	uint32_t seq_nr;	// used for "last recently stored" eviction strategy
+	uint32_t seq_nr;	// used for "least recently used" eviction strategy
 
     // Identification
     sm_key_t irk;
@@ -250,6 +250,24 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     return absolute_index;
 }
 
+void le_device_db_mark_used(int device_index){
+	int absolute_index = le_device_db_get_absolute_index_for_device_index(device_index);
+    le_device_nvm_t entry;
+	if (!le_device_db_entry_read(absolute_index, &entry)) return;
+    uint32_t seq_nr = le_device_db_highest_seq_nr();
+    // already most recently used, avoid write
+    if (entry.seq_nr == seq_nr) return;
+    entry.seq_nr = seq_nr + 1;
+    le_device_db_entry_write(absolute_index, &entry);
+}
+
+uint32_t le_device_db_last_used_get(int device_index){
+	int absolute_index = le_device_db_get_absolute_index_for_device_index(device_index);
+    le_device_nvm_t entry;
+	if (!le_device_db_entry_read(absolute_index, &entry)) return 0;
+    return entry.seq_nr;
+}
+
 void le_device_db_encryption_set(int device_index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
 
 	int absolute_index = le_device_db_get_absolute_index_for_device_index(device_index);
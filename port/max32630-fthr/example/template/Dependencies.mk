@@ -301,7 +301,7 @@ ublox_spp_le_counter_deps = ${BLE_DEPS} ${ATT_OBJ} ${GATT_SERVER_OBJ} device_inf
 
 # classic - no le
 CLASSIC_DEPS = ${GENERAL_DEPS} ${CLASSIC_OBJ}
-a2dp_sink_demo_deps = ${CLASSIC_DEPS} ${SDP_CLIENT_OBJ} ${SBC_CODEC_OBJ} ${AVDTP_OBJ} avrcp.o avrcp_controller.o avrcp_target.o avrcp_cover_art_client.o  obex_srm_client.o goep_client.o obex_parser.o obex_message_builder.o btstack_sample_rate_compensation.o a2dp_sink_demo.c
+a2dp_sink_demo_deps = ${CLASSIC_DEPS} ${SDP_CLIENT_OBJ} ${SBC_CODEC_OBJ} ${AVDTP_OBJ} avrcp.o avrcp_controller.o avrcp_target.o avrcp_cover_art_client.o  obex_srm_client.o goep_client.o obex_parser.o obex_message_builder.o btstack_sample_rate_compensation.o btstack_jitter_buffer.o a2dp_sink_demo.c
 a2dp_source_demo_deps = ${CLASSIC_DEPS} ${SDP_CLIENT_OBJ} ${SBC_CODEC_OBJ} ${AVDTP_OBJ} ${HXCMOD_PLAYER_OBJ} avrcp.o avrcp_controller.o avrcp_target.o a2dp_source_demo.c
 ant_test_deps = ${CLASSIC_DEPS} ant_test.c
 avrcp_browsing_client_deps = ${CLASSIC_DEPS} ${SDP_CLIENT_OBJ} ${AVRCP_OBJ} ${AVDTP_OBJ} avrcp_browsing_client.c
@@ -54,7 +54,7 @@
 
 #include "ad_parser.h"
 
-void ad_iterator_init(ad_context_t *context, uint8_t ad_len, const uint8_t * ad_data){
+void ad_iterator_init(ad_context_t *context, uint16_t ad_len, const uint8_t * ad_data){
     context->data = ad_data;
     context->length = ad_len;
     context->offset = 0;
@@ -97,7 +97,7 @@ const uint8_t * ad_iterator_get_data(const ad_context_t * context){
     return &context->data[context->offset + 2u];
 }
 
-bool ad_data_contains_uuid16(uint8_t ad_len, const uint8_t * ad_data, uint16_t uuid16){
+bool ad_data_contains_uuid16(uint16_t ad_len, const uint8_t * ad_data, uint16_t uuid16){
     ad_context_t context;
     ad_iterator_init(&context, ad_len, ad_data);
     while ( ad_iterator_has_more(&context) ){
@@ -136,7 +136,7 @@ bool ad_data_contains_uuid16(uint8_t ad_len, const uint8_t * ad_data, uint16_t u
     return false;
 }
 
-bool ad_data_contains_uuid128(uint8_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128){
+bool ad_data_contains_uuid128(uint16_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128){
     ad_context_t context;
     // input in big endian/network order, bluetooth data in little endian
     uint8_t uuid128_le[16];
@@ -179,3 +179,180 @@ bool ad_data_contains_uuid128(uint8_t ad_len, const uint8_t * ad_data, const uin
     return false;
 }
 
+// Bluetooth Base UUID in little endian without the 32-bit UUID field
+static const uint8_t ad_bluetooth_base_uuid_le[] = {
+    0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00
+};
+
+static void ad_mark_matched(uint8_t * matched, uint16_t index){
+    if (matched != NULL){
+        matched[index >> 3] |= (uint8_t) (1u << (index & 7u));
+    }
+}
+
+static bool ad_find_uuid16(const uint16_t * uuid16s, uint16_t num_uuid16s, uint16_t uuid16, uint16_t * index){
+    uint16_t low  = 0;
+    uint16_t high = num_uuid16s;
+    while (low < high){
+        uint16_t mid = low + ((high - low) >> 1);
+        if (uuid16s[mid] < uuid16){
+            low = mid + 1u;
+        } else {
+            high = mid;
+        }
+    }
+    *index = low;
+    return (low < num_uuid16s) && (uuid16s[low] == uuid16);
+}
+
+static bool ad_find_uuid128(const uint8_t * uuid128s, uint16_t num_uuid128s, const uint8_t * uuid128, uint16_t * index){
+    uint16_t low  = 0;
+    uint16_t high = num_uuid128s;
+    while (low < high){
+        uint16_t mid = low + ((high - low) >> 1);
+        if (memcmp(&uuid128s[mid * 16u], uuid128, 16) < 0){
+            low = mid + 1u;
+        } else {
+            high = mid;
+        }
+    }
+    *index = low;
+    return (low < num_uuid128s) && (memcmp(&uuid128s[low * 16u], uuid128, 16) == 0);
+}
+
+bool ad_data_match_uuid16s(uint16_t ad_len, const uint8_t * ad_data, const uint16_t * uuid16s, uint16_t num_uuid16s, uint8_t * matched){
+    if (matched != NULL){
+        memset(matched, 0, (num_uuid16s + 7u) / 8u);
+    }
+    bool found = false;
+    uint16_t index;
+    ad_context_t context;
+    for (ad_iterator_init(&context, ad_len, ad_data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        uint8_t data_len     = ad_iterator_get_data_len(&context);
+        const uint8_t * data = ad_iterator_get_data(&context);
+        uint8_t i;
+        switch (ad_iterator_get_data_type(&context)){
+            case BLUETOOTH_DATA_TYPE_INCOMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS:
+            case BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS:
+                for (i = 0u; (i + 2u) <= data_len; i += 2u){
+                    if (ad_find_uuid16(uuid16s, num_uuid16s, little_endian_read_16(data, i), &index)){
+                        found = true;
+                        ad_mark_matched(matched, index);
+                    }
+                }
+                break;
+            case BLUETOOTH_DATA_TYPE_INCOMPLETE_LIST_OF_128_BIT_SERVICE_CLASS_UUIDS:
+            case BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_128_BIT_SERVICE_CLASS_UUIDS:
+                for (i = 0u; (i + 16u) <= data_len; i += 16u){
+                    const uint8_t * uuid128_le = &data[i];
+                    if (memcmp(uuid128_le, ad_bluetooth_base_uuid_le, sizeof(ad_bluetooth_base_uuid_le)) != 0) continue;
+                    if ((uuid128_le[14] != 0u) || (uuid128_le[15] != 0u)) continue;
+                    if (ad_find_uuid16(uuid16s, num_uuid16s, little_endian_read_16(uuid128_le, 12), &index)){
+                        found = true;
+                        ad_mark_matched(matched, index);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if (found && (matched == NULL)){
+            break;
+        }
+    }
+    return found;
+}
+
+bool ad_data_match_uuid128s(uint16_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128s, uint16_t num_uuid128s, uint8_t * matched){
+    if (matched != NULL){
+        memset(matched, 0, (num_uuid128s + 7u) / 8u);
+    }
+    bool found = false;
+    uint16_t index;
+    uint8_t uuid128[16];
+    ad_context_t context;
+    for (ad_iterator_init(&context, ad_len, ad_data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        uint8_t data_len     = ad_iterator_get_data_len(&context);
+        const uint8_t * data = ad_iterator_get_data(&context);
+        uint8_t i;
+        switch (ad_iterator_get_data_type(&context)){
+            case BLUETOOTH_DATA_TYPE_INCOMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS:
+            case BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS:
+                for (i = 0u; (i + 2u) <= data_len; i += 2u){
+                    uuid_add_bluetooth_prefix(uuid128, little_endian_read_16(data, i));
+                    if (ad_find_uuid128(uuid128s, num_uuid128s, uuid128, &index)){
+                        found = true;
+                        ad_mark_matched(matched, index);
+                    }
+                }
+                break;
+            case BLUETOOTH_DATA_TYPE_INCOMPLETE_LIST_OF_128_BIT_SERVICE_CLASS_UUIDS:
+            case BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_128_BIT_SERVICE_CLASS_UUIDS:
+                for (i = 0u; (i + 16u) <= data_len; i += 16u){
+                    reverse_128(&data[i], uuid128);
+                    if (ad_find_uuid128(uuid128s, num_uuid128s, uuid128, &index)){
+                        found = true;
+                        ad_mark_matched(matched, index);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if (found && (matched == NULL)){
+            break;
+        }
+    }
+    return found;
+}
+
+uint8_t ad_index_build(ad_index_t * index, uint16_t ad_len, const uint8_t * ad_data){
+    index->data = ad_data;
+    index->length = ad_len;
+    index->num_structures = 0;
+    memset(index->data_types_present, 0, sizeof(index->data_types_present));
+    ad_context_t context;
+    for (ad_iterator_init(&context, ad_len, ad_data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        if (index->num_structures == AD_INDEX_MAX_STRUCTURES){
+            index->unindexed_offset = context.offset;
+            return index->num_structures;
+        }
+        uint8_t data_type = ad_iterator_get_data_type(&context);
+        ad_index_entry_t * entry = &index->structures[index->num_structures++];
+        entry->offset    = context.offset + 2u;
+        entry->data_type = data_type;
+        entry->data_len  = ad_iterator_get_data_len(&context);
+        index->data_types_present[data_type >> 3] |= (uint8_t) (1u << (data_type & 7u));
+    }
+    index->unindexed_offset = ad_len;
+    return index->num_structures;
+}
+
+const uint8_t * ad_index_get_data(const ad_index_t * index, uint8_t data_type, uint8_t * data_len){
+    uint8_t i;
+    if ((index->data_types_present[data_type >> 3] & (1u << (data_type & 7u))) != 0u){
+        for (i = 0; i < index->num_structures; i++){
+            const ad_index_entry_t * entry = &index->structures[i];
+            if (entry->data_type == data_type){
+                *data_len = entry->data_len;
+                return &index->data[entry->offset];
+            }
+        }
+    }
+    // AD Structures that did not fit into the index
+    ad_context_t context;
+    ad_iterator_init(&context, index->length, index->data);
+    context.offset = index->unindexed_offset;
+    for ( ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        if (ad_iterator_get_data_type(&context) == data_type){
+            *data_len = ad_iterator_get_data_len(&context);
+            return ad_iterator_get_data(&context);
+        }
+    }
+    return NULL;
+}
+
+bool ad_index_contains_data_type(const ad_index_t * index, uint8_t data_type){
+    uint8_t data_len;
+    return ad_index_get_data(index, data_type, &data_len) != NULL;
+}
@@ -57,12 +57,33 @@ extern "C" {
 
 typedef struct ad_context {
      const uint8_t * data;
-     uint8_t   offset;
-     uint8_t   length;
+     uint16_t  offset;
+     uint16_t  length;
 } ad_context_t;
 
-// Advertising or Scan Response data iterator
-void ad_iterator_init(ad_context_t *context, uint8_t ad_len, const uint8_t * ad_data);
+// Max number of AD Structures recorded in an AD Index, lookups for later structures fall back to iteration
+#ifndef AD_INDEX_MAX_STRUCTURES
+#define AD_INDEX_MAX_STRUCTURES 32
+#endif
+
+typedef struct {
+     uint16_t  offset;     // offset of AD Structure data
+     uint8_t   data_type;
+     uint8_t   data_len;
+} ad_index_entry_t;
+
+typedef struct {
+     const uint8_t *  data;
+     uint16_t         length;
+     // offset of first AD Structure not recorded, or length if all are recorded
+     uint16_t         unindexed_offset;
+     uint8_t          num_structures;
+     uint8_t          data_types_present[32];
+     ad_index_entry_t structures[AD_INDEX_MAX_STRUCTURES];
+} ad_index_t;
+
+// Advertising or Scan Response data iterator, supports Extended Advertising data up to 1650 bytes
+void ad_iterator_init(ad_context_t *context, uint16_t ad_len, const uint8_t * ad_data);
 bool ad_iterator_has_more(const ad_context_t * context);
 void ad_iterator_next(ad_context_t * context);
 
@@ -72,8 +93,57 @@ uint8_t         ad_iterator_get_data_len(const ad_context_t * context);
 const uint8_t * ad_iterator_get_data(const ad_context_t * context);
 
 // convenience function on complete advertisements
-bool ad_data_contains_uuid16(uint8_t ad_len, const uint8_t * ad_data, uint16_t uuid16);
-bool ad_data_contains_uuid128(uint8_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128);
+bool ad_data_contains_uuid16(uint16_t ad_len, const uint8_t * ad_data, uint16_t uuid16);
+bool ad_data_contains_uuid128(uint16_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128);
+
+/**
+ * @brief Check a set of 16-bit Service UUIDs in a single pass over the AD data.
+ *        16-bit UUIDs are also found in 128-bit UUID lists if they use the Bluetooth Base UUID.
+ * @param ad_len
+ * @param ad_data
+ * @param uuid16s sorted in ascending order
+ * @param num_uuid16s
+ * @param matched optional bitmap of (num_uuid16s + 7) / 8 bytes, bit i is set if uuid16s[i] is contained
+ * @return true if at least one UUID is contained
+ */
+bool ad_data_match_uuid16s(uint16_t ad_len, const uint8_t * ad_data, const uint16_t * uuid16s, uint16_t num_uuid16s, uint8_t * matched);
+
+/**
+ * @brief Check a set of 128-bit Service UUIDs in a single pass over the AD data, also matches 16-bit UUID lists
+ * @param ad_len
+ * @param ad_data
+ * @param uuid128s num_uuid128s UUIDs in big endian, each 16 bytes, sorted in ascending order
+ * @param num_uuid128s
+ * @param matched optional bitmap of (num_uuid128s + 7) / 8 bytes, bit i is set if UUID i is contained
+ * @return true if at least one UUID is contained
+ */
+bool ad_data_match_uuid128s(uint16_t ad_len, const uint8_t * ad_data, const uint8_t * uuid128s, uint16_t num_uuid128s, uint8_t * matched);
+
+/**
+ * @brief Record data type and offset of all AD Structures in a single pass
+ * @param index
+ * @param ad_len
+ * @param ad_data has to stay valid while index is used
+ * @return number of recorded AD Structures
+ */
+uint8_t ad_index_build(ad_index_t * index, uint16_t ad_len, const uint8_t * ad_data);
+
+/**
+ * @brief Check if AD data contains AD Structure with given data type
+ * @param index
+ * @param data_type
+ * @return true if contained
+ */
+bool ad_index_contains_data_type(const ad_index_t * index, uint8_t data_type);
+
+/**
+ * @brief Get data of first AD Structure with given data type
+ * @param index
+ * @param data_type
+ * @param data_len
+ * @return data or NULL if not contained
+ */
+const uint8_t * ad_index_get_data(const ad_index_t * index, uint8_t data_type, uint8_t * data_len);
 
 /* API_END */
 
@@ -947,7 +947,6 @@ static uint16_t handle_read_multiple_request2(att_connection_t * att_connection,
             break;
         }
 
-#ifdef ENABLE_GATT_OVER_EATT
         // assert that at least Value Length can be stored
         if (store_length && ((offset + 2) >= response_buffer_size)){
             break;
@@ -957,16 +956,13 @@ static uint16_t handle_read_multiple_request2(att_connection_t * att_connection,
         if (store_length){
             offset += 2;
         }
-#endif
         // store data
         uint16_t bytes_copied = att_copy_value(&it, 0, response_buffer + offset, response_buffer_size - offset, att_connection->con_handle);
         offset += bytes_copied;
-#ifdef ENABLE_GATT_OVER_EATT
         // set length field
         if (store_length) {
             little_endian_store_16(response_buffer, offset_value_length, bytes_copied);
         }
-#endif
     }
 
     if (error_code != 0u){
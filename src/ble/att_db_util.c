@@ -65,6 +65,18 @@ static uint16_t  att_db_max_size;
 static uint16_t  att_db_next_handle;
 static uint16_t  att_db_hash_len;
 
+// handle range modified since last call to att_db_util_clear_changed_handle_range
+static uint16_t  att_db_changed_start_handle;
+static uint16_t  att_db_changed_end_handle;
+
+// database hash is only re-calculated after the database was modified
+static uint8_t   att_db_hash[16];
+static bool      att_db_hash_valid;
+static uint16_t  att_db_change_counter;
+static uint16_t  att_db_hash_change_counter;
+static uint8_t * att_db_hash_result;
+static void   (* att_db_hash_callback)(void * arg);
+
 static void att_db_util_set_end_tag(void){
 	// end tag
 	att_db[att_db_size] = 0u;
@@ -91,6 +103,10 @@ void att_db_util_init(void){
 	att_db_size = 1u;
 	att_db_next_handle = 1u;
 	att_db_hash_len = 0u;
+	att_db_changed_start_handle = 0u;
+	att_db_changed_end_handle = 0u;
+	att_db_hash_valid = false;
+	att_db_change_counter++;
 	att_db_util_set_end_tag();
 }
 
@@ -128,6 +144,31 @@ static bool att_db_util_hash_include_without_value(uint16_t uuid16){
     }
 }
 
+// number of bytes of attribute included in database hash
+static uint16_t att_db_util_hash_len_for_attribute(uint16_t flags, uint16_t uuid16, uint16_t data_len){
+    if ((flags & (uint16_t)ATT_PROPERTY_UUID128) != 0u){
+        return 0;
+    }
+    if (att_db_util_hash_include_with_value(uuid16)){
+        return 4u + data_len;
+    }
+    if (att_db_util_hash_include_without_value(uuid16)){
+        return 4u;
+    }
+    return 0;
+}
+
+static void att_db_util_mark_changed(uint16_t start_handle, uint16_t end_handle){
+    if ((att_db_changed_start_handle == 0u) || (start_handle < att_db_changed_start_handle)){
+        att_db_changed_start_handle = start_handle;
+    }
+    if (end_handle > att_db_changed_end_handle){
+        att_db_changed_end_handle = end_handle;
+    }
+    att_db_hash_valid = false;
+    att_db_change_counter++;
+}
+
 /**
  * asserts that the requested amount of bytes can be stored in the att_db
  * @return TRUE if space is available
@@ -168,6 +209,7 @@ static void att_db_util_add_attribute_uuid16(uint16_t uuid16, uint16_t flags, ui
 	att_db_size += 2u;
 	little_endian_store_16(att_db, att_db_size, att_db_next_handle);
 	att_db_size += 2u;
+	att_db_util_mark_changed(att_db_next_handle, att_db_next_handle);
 	att_db_next_handle++;
 	little_endian_store_16(att_db, att_db_size, uuid16);
 	att_db_size += 2u;
@@ -175,11 +217,7 @@ static void att_db_util_add_attribute_uuid16(uint16_t uuid16, uint16_t flags, ui
 	att_db_size += data_len;
 	att_db_util_set_end_tag();
 
-	if (att_db_util_hash_include_with_value(uuid16)){
-	    att_db_hash_len += 4u + data_len;
-	} else if (att_db_util_hash_include_without_value(uuid16)){
-        att_db_hash_len += 4u;
-	}
+	att_db_hash_len += att_db_util_hash_len_for_attribute(flags, uuid16, data_len);
 }
 
 static void att_db_util_add_attribute_uuid128(const uint8_t * uuid128, uint16_t flags, uint8_t * data, uint16_t data_len){
@@ -192,6 +230,7 @@ static void att_db_util_add_attribute_uuid128(const uint8_t * uuid128, uint16_t
 	att_db_size += 2u;
 	little_endian_store_16(att_db, att_db_size, att_db_next_handle);
 	att_db_size += 2u;
+	att_db_util_mark_changed(att_db_next_handle, att_db_next_handle);
 	att_db_next_handle++;
 	reverse_128(uuid128, &att_db[att_db_size]);
 	att_db_size += 16u;
@@ -336,6 +375,70 @@ uint16_t att_db_util_add_descriptor_uuid128(const uint8_t * uuid128, uint16_t pr
     return descriptor_handler;
  }
 
+static bool att_db_util_is_service_declaration(const uint8_t * attribute){
+    uint16_t flags = little_endian_read_16(attribute, 2);
+    if ((flags & (uint16_t)ATT_PROPERTY_UUID128) != 0u){
+        return false;
+    }
+    uint16_t uuid16 = little_endian_read_16(attribute, 6);
+    return (uuid16 == GATT_PRIMARY_SERVICE_UUID) || (uuid16 == GATT_SECONDARY_SERVICE_UUID);
+}
+
+bool att_db_util_remove_service(uint16_t service_handle){
+    // find service declaration
+    uint16_t service_pos = 1u;
+    while (true){
+        uint16_t size = little_endian_read_16(att_db, service_pos);
+        if (size == 0u){
+            return false;
+        }
+        if ((little_endian_read_16(att_db, service_pos + 4u) == service_handle) && att_db_util_is_service_declaration(&att_db[service_pos])){
+            break;
+        }
+        service_pos += size;
+    }
+
+    // collect attributes up to next service declaration
+    uint16_t end_pos = service_pos;
+    uint16_t end_handle = service_handle;
+    uint16_t hash_len_removed = 0;
+    while (true){
+        uint16_t size = little_endian_read_16(att_db, end_pos);
+        if (size == 0u){
+            break;
+        }
+        if ((end_pos != service_pos) && att_db_util_is_service_declaration(&att_db[end_pos])){
+            break;
+        }
+        uint16_t flags = little_endian_read_16(att_db, end_pos + 2u);
+        end_handle = little_endian_read_16(att_db, end_pos + 4u);
+        uint16_t uuid16 = little_endian_read_16(att_db, end_pos + 6u);
+        hash_len_removed += att_db_util_hash_len_for_attribute(flags, uuid16, size - 8u);
+        end_pos += size;
+    }
+
+    // remove attributes, handles of following attributes stay the same
+    (void)memmove(&att_db[service_pos], &att_db[end_pos], (att_db_size + 2u) - end_pos);
+    att_db_size -= end_pos - service_pos;
+    att_db_hash_len -= hash_len_removed;
+    att_db_util_mark_changed(service_handle, end_handle);
+    return true;
+}
+
+bool att_db_util_get_changed_handle_range(uint16_t * start_handle, uint16_t * end_handle){
+    if (att_db_changed_start_handle == 0u){
+        return false;
+    }
+    *start_handle = att_db_changed_start_handle;
+    *end_handle   = att_db_changed_end_handle;
+    return true;
+}
+
+void att_db_util_clear_changed_handle_range(void){
+    att_db_changed_start_handle = 0u;
+    att_db_changed_end_handle = 0u;
+}
+
 uint8_t * att_db_util_get_address(void){
 	return att_db;
 }
@@ -403,8 +506,28 @@ static uint8_t att_db_util_hash_get(uint16_t offset){
     return att_db_util_hash_get_next();
 }
 
+static void att_db_util_hash_handle_result(void * arg){
+    // cache hash if database was not modified during calculation
+    if (att_db_hash_change_counter == att_db_change_counter){
+        (void)memcpy(att_db_hash, att_db_hash_result, 16);
+        att_db_hash_valid = true;
+    }
+    (*att_db_hash_callback)(arg);
+}
+
 void att_db_util_hash_calc(btstack_crypto_aes128_cmac_t * request, uint8_t * db_hash, void (* callback)(void * arg), void * callback_arg){
     static const uint8_t zero_key[16] = { 0 };
+
+    // database not modified since last calculation
+    if (att_db_hash_valid){
+        (void)memcpy(db_hash, att_db_hash, 16);
+        (*callback)(callback_arg);
+        return;
+    }
+
+    att_db_hash_result = db_hash;
+    att_db_hash_callback = callback;
+    att_db_hash_change_counter = att_db_change_counter;
     att_db_util_hash_init();
-    btstack_crypto_aes128_cmac_generator(request, zero_key, att_db_hash_len, &att_db_util_hash_get, db_hash, callback, callback_arg);
+    btstack_crypto_aes128_cmac_generator(request, zero_key, att_db_hash_len, &att_db_util_hash_get, db_hash, &att_db_util_hash_handle_result, callback_arg);
 }
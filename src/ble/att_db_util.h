@@ -157,6 +157,28 @@ uint16_t att_db_util_add_descriptor_uuid16(uint16_t uuid16, uint16_t properties,
 */
 uint16_t att_db_util_add_descriptor_uuid128(const uint8_t * uuid128, uint16_t properties, uint8_t read_permission, uint8_t write_permission, uint8_t * data, uint16_t data_len);
 
+/**
+ * @brief Remove primary or secondary service with all its attributes up to the next service declaration.
+ * @note Handles of following attributes are not changed. The removed handle range is added to the changed handle range.
+ * @param service_handle of service declaration as returned by att_db_util_add_service_uuid16 and others
+ * @return true if service found and removed
+ */
+bool att_db_util_remove_service(uint16_t service_handle);
+
+/**
+ * @brief Get handle range of attributes added or removed since att_db_util_init or att_db_util_clear_changed_handle_range,
+ *        e.g. for the Service Changed indication
+ * @param start_handle
+ * @param end_handle
+ * @return true if database was modified
+ */
+bool att_db_util_get_changed_handle_range(uint16_t * start_handle, uint16_t * end_handle);
+
+/**
+ * @brief Reset changed handle range, e.g. after clients have been informed
+ */
+void att_db_util_clear_changed_handle_range(void);
+
 /**
  * @brief Get address of constructed ATT DB
  */
@@ -184,6 +206,8 @@ uint8_t att_db_util_hash_get_next(void);
 
 /**
  * @brief Calculate GATT Database Hash using crypto engine
+ * @note The hash is only calculated if the database was modified since the last calculation,
+ *       otherwise the previous result is returned and the callback is called directly
  * @param request
  * @param db_hash
  * @param callback
@@ -77,6 +77,11 @@
 #define NVN_NUM_GATT_SERVER_CCC 20
 #endif
 
+// delay before modified CCC values are written to TLV, 0 = write immediately
+#ifndef ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS
+#define ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS 5000
+#endif
+
 #define ATT_SERVER_FLAGS_DELAYED_RESPONSE       (1u<<0u)
 #define ATT_SERVER_FLAGS_VALIDATE_DATABASE_HASH (1u<<1u)
 
@@ -86,6 +91,8 @@ static btstack_packet_handler_t att_server_packet_handler_for_handle(uint16_t ha
 static void att_server_handle_can_send_now(void);
 static void att_server_persistent_ccc_restore(att_server_t * att_server, att_connection_t * att_connection);
 static void att_server_persistent_ccc_clear(int le_device_db_index);
+static void att_server_service_changed_request(att_server_t * att_server, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle);
+static void att_server_service_changed_complete(att_server_t * att_server);
 static void att_server_handle_att_pdu(att_server_t * att_server, att_connection_t * att_connection, uint8_t * packet, uint16_t size);
 
 typedef enum {
@@ -102,11 +109,19 @@ typedef struct {
     uint8_t  device_index;
 } persistent_ccc_entry_t;
 
+// RAM copy of persistent CCC tag with same index
+typedef struct {
+    persistent_ccc_entry_t entry;
+    bool valid;
+    bool dirty;
+} persistent_ccc_table_entry_t;
+
 // global
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 static btstack_packet_handler_t               att_client_packet_handler;
 static btstack_linked_list_t                  service_handlers;
+static btstack_linked_list_t                  att_server_value_caches;
 static btstack_context_callback_registration_t att_client_waiting_for_can_send_registration;
 
 static att_read_callback_t                    att_server_client_read_callback;
@@ -117,6 +132,18 @@ static hci_con_handle_t att_server_last_can_send_now = HCI_CON_HANDLE_INVALID;
 
 static uint8_t att_server_flags;
 
+// persistent CCC values, loaded from TLV on first use and written back in batches
+static persistent_ccc_table_entry_t att_server_persistent_ccc_table[NVN_NUM_GATT_SERVER_CCC];
+static bool                         att_server_persistent_ccc_table_loaded;
+static const btstack_tlv_t *        att_server_persistent_ccc_tlv_impl;
+static void *                       att_server_persistent_ccc_tlv_context;
+static btstack_timer_source_t       att_server_persistent_ccc_flush_timer;
+static bool                         att_server_persistent_ccc_flush_timer_active;
+
+// Service Changed characteristic of GATT Service, 0 if not present
+static uint16_t att_server_service_changed_value_handle;
+static uint16_t att_server_service_changed_ccc_handle;
+
 #ifdef ENABLE_GATT_OVER_EATT
 static att_server_eatt_bearer_t * att_server_eatt_bearer_for_con_handle(hci_con_handle_t con_handle);
 static btstack_linked_list_t att_server_eatt_bearer_pool;
@@ -191,6 +218,34 @@ static bool att_server_can_send_packet(att_server_t * att_server, att_connection
     return false;
 }
 
+// EATT bearers provide their own request context, all others use the pool
+static att_server_request_t * att_server_request_get(att_server_t * att_server){
+#ifdef ENABLE_GATT_OVER_EATT
+    if (att_server->bearer_request != NULL){
+        return att_server->bearer_request;
+    }
+#else
+    UNUSED(att_server);
+#endif
+    return btstack_memory_att_server_request_get();
+}
+
+// finalize current request and return request context to pool if it was taken from there
+static void att_server_request_done(att_server_t * att_server){
+    att_server->state = ATT_SERVER_IDLE;
+    if (att_server->request == NULL){
+        return;
+    }
+    bool from_pool = true;
+#ifdef ENABLE_GATT_OVER_EATT
+    from_pool = att_server->request != att_server->bearer_request;
+#endif
+    if (from_pool){
+        btstack_memory_att_server_request_free(att_server->request);
+    }
+    att_server->request = NULL;
+}
+
 static void att_handle_value_indication_notify_client(uint8_t status, uint16_t client_handle, uint16_t attribute_handle){
     btstack_packet_handler_t packet_handler = att_server_packet_handler_for_handle(attribute_handle);
     if (!packet_handler) return;
@@ -392,7 +447,10 @@ static void att_server_event_packet_handler (uint8_t packet_type, uint16_t chann
                     att_clear_transaction_queue(att_connection);
                     att_connection->con_handle = 0;
                     att_server->pairing_active = false;
-                    att_server->state = ATT_SERVER_IDLE;
+                    att_server->service_changed_indications_enabled = false;
+                    att_server->change_unaware = false;
+                    att_server_request_done(att_server);
+                    att_server_persistent_ccc_flush();
                     if (att_server->value_indication_handle != 0u){
                         btstack_run_loop_remove_timer(&att_server->value_indication_timer);
                         uint16_t att_handle = att_server->value_indication_handle;
@@ -529,12 +587,12 @@ static void att_signed_write_handle_cmac_result(uint8_t hash[8]){
 
     uint8_t hash_flipped[8];
     reverse_64(hash, hash_flipped);
-    if (memcmp(hash_flipped, &att_server->request_buffer[att_server->request_size-8], 8) != 0){
+    if (memcmp(hash_flipped, &att_server->request->buffer[att_server->request->size-8], 8) != 0){
         log_info("ATT Signed Write, invalid signature");
 #ifdef ENABLE_TESTING_SUPPORT
         printf("ATT Signed Write, invalid signature\n");
 #endif
-        att_server->state = ATT_SERVER_IDLE;
+        att_server_request_done(att_server);
         return;
     }
     log_info("ATT Signed Write, valid signature");
@@ -543,7 +601,7 @@ static void att_signed_write_handle_cmac_result(uint8_t hash[8]){
 #endif
 
     // update sequence number
-    uint32_t counter_packet = little_endian_read_32(att_server->request_buffer, att_server->request_size-12);
+    uint32_t counter_packet = little_endian_read_32(att_server->request->buffer, att_server->request->size-12);
     le_device_db_remote_counter_set(att_server->ir_le_device_db_index, counter_packet+1);
     att_server->state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
     att_server_request_can_send_now(att_server, att_connection);
@@ -600,8 +658,16 @@ att_server_process_validated_request(att_server_t *att_server, att_connection_t
     }
 
     uint16_t  att_response_size = 0;
-    // Send Error Response for MTU Request over connection-oriented channel
-    if ((att_server->bearer_type != ATT_BEARER_UNENHANCED_LE) && (att_server->request_buffer[0] == ATT_EXCHANGE_MTU_REQUEST)){
+    if (att_server->request == NULL){
+        // Send Error Response if no request context was available
+        att_response_size = 5;
+        att_response_buffer[0] = ATT_ERROR_RESPONSE;
+        att_response_buffer[1] = att_server->request_opcode;
+        att_response_buffer[2] = 0;
+        att_response_buffer[3] = 0;
+        att_response_buffer[4] = ATT_ERROR_INSUFFICIENT_RESOURCES;
+    } else if ((att_server->bearer_type != ATT_BEARER_UNENHANCED_LE) && (att_server->request_opcode == ATT_EXCHANGE_MTU_REQUEST)){
+        // Send Error Response for MTU Request over connection-oriented channel
         att_response_size = 5;
         att_response_buffer[0] = ATT_ERROR_RESPONSE;
         att_response_buffer[1] = ATT_EXCHANGE_MTU_REQUEST;
@@ -609,7 +675,7 @@ att_server_process_validated_request(att_server_t *att_server, att_connection_t
         att_response_buffer[3] = 0;
         att_response_buffer[4] = ATT_ERROR_REQUEST_NOT_SUPPORTED;
     } else {
-        att_response_size = att_handle_request(att_connection, att_server->request_buffer, att_server->request_size, att_response_buffer);
+        att_response_size = att_handle_request(att_connection, att_server->request->buffer, att_server->request->size, att_response_buffer);
     }
 
 #ifdef ENABLE_ATT_DELAYED_RESPONSE
@@ -642,7 +708,7 @@ att_server_process_validated_request(att_server_t *att_server, att_connection_t
         }
     }
 
-    att_server->state = ATT_SERVER_IDLE;
+    att_server_request_done(att_server);
     if (att_response_size == 0u) {
         if (eatt_buffer == NULL){
             l2cap_release_packet_buffer();
@@ -663,13 +729,37 @@ att_server_process_validated_request(att_server_t *att_server, att_connection_t
 uint8_t att_server_response_ready(hci_con_handle_t con_handle){
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
     if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    uint8_t status = ERROR_CODE_COMMAND_DISALLOWED;
     att_server_t * att_server = &hci_connection->att_server;
     att_connection_t * att_connection = &hci_connection->att_connection;
-    if (att_server->state != ATT_SERVER_RESPONSE_PENDING)   return ERROR_CODE_COMMAND_DISALLOWED;
+    if (att_server->state == ATT_SERVER_RESPONSE_PENDING){
+        att_server->state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
+        att_server_request_can_send_now(att_server, att_connection);
+        status = ERROR_CODE_SUCCESS;
+    }
 
-    att_server->state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
-    att_server_request_can_send_now(att_server, att_connection);
-    return ERROR_CODE_SUCCESS;
+#ifdef ENABLE_GATT_OVER_EATT
+    // each EATT bearer has its own request context, retry all pending requests for this connection
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &att_server_eatt_bearer_active);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        att_server_eatt_bearer_t * eatt_bearer = (att_server_eatt_bearer_t *) btstack_linked_list_iterator_next(&it);
+        if (eatt_bearer->att_connection.con_handle != con_handle) continue;
+        if (eatt_bearer->att_server.state != ATT_SERVER_RESPONSE_PENDING) continue;
+        eatt_bearer->att_server.state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
+        att_server_request_can_send_now(&eatt_bearer->att_server, &eatt_bearer->att_connection);
+        status = ERROR_CODE_SUCCESS;
+    }
+#endif
+    return status;
+}
+
+uint8_t att_server_read_response_ready(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t * value, uint16_t value_len){
+    uint8_t status = att_server_value_cache_store(attribute_handle, value, value_len);
+    if (status != ERROR_CODE_SUCCESS){
+        return status;
+    }
+    return att_server_response_ready(con_handle);
 }
 #endif
 
@@ -703,16 +793,16 @@ static void att_run_for_context(att_server_t * att_server, att_connection_t * at
             if (att_server->pairing_active) break;
 
 #ifdef ENABLE_LE_SIGNED_WRITE
-            if (att_server->request_buffer[0] == ATT_SIGNED_WRITE_COMMAND){
+            if (att_server->request_opcode == ATT_SIGNED_WRITE_COMMAND){
                 log_info("ATT Signed Write!");
                 if (!sm_cmac_ready()) {
                     log_info("ATT Signed Write, sm_cmac engine not ready. Abort");
-                    att_server->state = ATT_SERVER_IDLE;
+                    att_server_request_done(att_server);
                     return;
                 }  
-                if (att_server->request_size < (3 + 12)) {
+                if (att_server->request->size < (3 + 12)) {
                     log_info("ATT Signed Write, request to short. Abort.");
-                    att_server->state = ATT_SERVER_IDLE;
+                    att_server_request_done(att_server);
                     return;
                 }
                 if (att_server->ir_lookup_active){
@@ -720,17 +810,17 @@ static void att_run_for_context(att_server_t * att_server, att_connection_t * at
                 }
                 if (att_server->ir_le_device_db_index < 0){
                     log_info("ATT Signed Write, CSRK not available");
-                    att_server->state = ATT_SERVER_IDLE;
+                    att_server_request_done(att_server);
                     return;
                 }
 
                 // check counter
-                uint32_t counter_packet = little_endian_read_32(att_server->request_buffer, att_server->request_size-12);
+                uint32_t counter_packet = little_endian_read_32(att_server->request->buffer, att_server->request->size-12);
                 uint32_t counter_db     = le_device_db_remote_counter_get(att_server->ir_le_device_db_index);
                 log_info("ATT Signed Write, DB counter %"PRIu32", packet counter %"PRIu32, counter_db, counter_packet);
                 if (counter_packet < counter_db){
                     log_info("ATT Signed Write, db reports higher counter, abort");
-                    att_server->state = ATT_SERVER_IDLE;
+                    att_server_request_done(att_server);
                     return;
                 }
 
@@ -739,9 +829,9 @@ static void att_run_for_context(att_server_t * att_server, att_connection_t * at
                 le_device_db_remote_csrk_get(att_server->ir_le_device_db_index, csrk);
                 att_server->state = ATT_SERVER_W4_SIGNED_WRITE_VALIDATION;
                 log_info("Orig Signature: ");
-                log_info_hexdump( &att_server->request_buffer[att_server->request_size-8], 8);
-                uint16_t attribute_handle = little_endian_read_16(att_server->request_buffer, 1);
-                sm_cmac_signed_write_start(csrk, att_server->request_buffer[0], attribute_handle, att_server->request_size - 15, &att_server->request_buffer[3], counter_packet, att_signed_write_handle_cmac_result);
+                log_info_hexdump( &att_server->request->buffer[att_server->request->size-8], 8);
+                uint16_t attribute_handle = little_endian_read_16(att_server->request->buffer, 1);
+                sm_cmac_signed_write_start(csrk, att_server->request->buffer[0], attribute_handle, att_server->request->size - 15, &att_server->request->buffer[3], counter_packet, att_signed_write_handle_cmac_result);
                 return;
             } 
 #endif
@@ -755,6 +845,87 @@ static void att_run_for_context(att_server_t * att_server, att_connection_t * at
     }   
 }
 
+static bool att_server_notification_streams_ready(att_server_t * att_server){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &att_server->notification_streams);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        att_server_notification_stream_t * stream = (att_server_notification_stream_t *) btstack_linked_list_iterator_next(&it);
+        if (stream->bytes_used > 0u){
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool att_server_notification_stream_registered(att_server_t * att_server, const att_server_notification_stream_t * stream){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &att_server->notification_streams);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        if (btstack_linked_list_iterator_next(&it) == (const btstack_linked_item_t *) stream){
+            return true;
+        }
+    }
+    return false;
+}
+
+static void att_server_notification_stream_store(att_server_notification_stream_t * stream, const uint8_t * data, uint16_t len){
+    // 32-bit sum to avoid overflow for storage_size > 32767
+    uint32_t write_pos = (uint32_t) stream->read_pos + stream->bytes_used;
+    if (write_pos >= stream->storage_size){
+        write_pos -= stream->storage_size;
+    }
+    uint16_t bytes_to_end = stream->storage_size - (uint16_t) write_pos;
+    uint16_t bytes_first  = btstack_min(len, bytes_to_end);
+    (void) memcpy(&stream->storage[write_pos], data, bytes_first);
+    (void) memcpy(stream->storage, &data[bytes_first], len - bytes_first);
+    stream->bytes_used += len;
+}
+
+static void att_server_notification_stream_read(att_server_notification_stream_t * stream, uint8_t * buffer, uint16_t len){
+    uint16_t bytes_to_end = stream->storage_size - stream->read_pos;
+    uint16_t bytes_first  = btstack_min(len, bytes_to_end);
+    (void) memcpy(buffer, &stream->storage[stream->read_pos], bytes_first);
+    (void) memcpy(&buffer[bytes_first], stream->storage, len - bytes_first);
+    uint32_t read_pos = (uint32_t) stream->read_pos + len;
+    if (read_pos >= stream->storage_size){
+        read_pos -= stream->storage_size;
+    }
+    stream->read_pos = (uint16_t) read_pos;
+    stream->bytes_used -= len;
+}
+
+static void att_server_notification_stream_send(att_server_t * att_server, att_connection_t * att_connection){
+    // round robin: serve first stream with queued values and move it to the end
+    att_server_notification_stream_t * stream = NULL;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &att_server->notification_streams);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        att_server_notification_stream_t * candidate = (att_server_notification_stream_t *) btstack_linked_list_iterator_next(&it);
+        if (candidate->bytes_used > 0u){
+            stream = candidate;
+            break;
+        }
+    }
+    btstack_assert(stream != NULL);
+    btstack_linked_list_remove(&att_server->notification_streams, (btstack_linked_item_t *) stream);
+    btstack_linked_list_add_tail(&att_server->notification_streams, (btstack_linked_item_t *) stream);
+
+    uint8_t length_field[2];
+    att_server_notification_stream_read(stream, length_field, 2);
+    uint16_t value_len = little_endian_read_16(length_field, 0);
+
+    // copy value from stream storage directly into outgoing buffer
+    l2cap_reserve_packet_buffer();
+    uint8_t * packet_buffer = l2cap_get_outgoing_buffer();
+    packet_buffer[0] = ATT_HANDLE_VALUE_NOTIFICATION;
+    little_endian_store_16(packet_buffer, 1, stream->attribute_handle);
+    att_server_notification_stream_read(stream, &packet_buffer[3], value_len);
+
+    stream->num_notifications_sent++;
+    stream->num_bytes_sent += value_len;
+    (void) att_server_send_prepared(att_server, att_connection, packet_buffer, 3u + value_len);
+}
+
 static bool att_server_data_ready_for_phase(att_server_t * att_server,  att_server_run_phase_t phase){
     switch (phase){
         case ATT_SERVER_RUN_PHASE_1_REQUESTS:
@@ -762,7 +933,10 @@ static bool att_server_data_ready_for_phase(att_server_t * att_server,  att_serv
         case ATT_SERVER_RUN_PHASE_2_INDICATIONS:
              return (!btstack_linked_list_empty(&att_server->indication_requests) && (att_server->value_indication_handle == 0u));
         case ATT_SERVER_RUN_PHASE_3_NOTIFICATIONS:
-            return (!btstack_linked_list_empty(&att_server->notification_requests));
+            if (!btstack_linked_list_empty(&att_server->notification_requests)){
+                return true;
+            }
+            return att_server_notification_streams_ready(att_server);
         default:
             btstack_assert(false);
             return false;
@@ -781,6 +955,10 @@ static void att_server_trigger_send_for_phase(att_server_t * att_server, att_con
             client->callback(client->context);
             break;
        case ATT_SERVER_RUN_PHASE_3_NOTIFICATIONS:
+            if (btstack_linked_list_empty(&att_server->notification_requests)){
+                att_server_notification_stream_send(att_server, att_connection);
+                break;
+            }
             client = (btstack_context_callback_registration_t*) att_server->notification_requests;
             btstack_linked_list_remove(&att_server->notification_requests, (btstack_linked_item_t *) client);
             client->callback(client->context);
@@ -884,6 +1062,9 @@ static void att_server_handle_att_pdu(att_server_t * att_server, att_connection_
         btstack_run_loop_remove_timer(&att_server->value_indication_timer);
         uint16_t att_handle = att_server->value_indication_handle;
         att_server->value_indication_handle = 0u;    
+        if ((att_handle == att_server_service_changed_value_handle) && (att_server->bearer_type != ATT_BEARER_ENHANCED_LE)){
+            att_server_service_changed_complete(att_server);
+        }
         att_handle_value_indication_notify_client(0u, att_connection->con_handle, att_handle);
         att_server_request_can_send_now(att_server, att_connection);
         return;
@@ -897,8 +1078,8 @@ static void att_server_handle_att_pdu(att_server_t * att_server, att_connection_
     }
 
     // check size
-    if (size > sizeof(att_server->request_buffer)) {
-        log_info("drop att pdu 0x%02x as size %u > att_server->request_buffer %u", packet[0], size, (int) sizeof(att_server->request_buffer));
+    if (size > ATT_REQUEST_BUFFER_SIZE) {
+        log_info("drop att pdu 0x%02x as size %u > ATT_REQUEST_BUFFER_SIZE %u", packet[0], size, (int) ATT_REQUEST_BUFFER_SIZE);
         return;
     }
 
@@ -910,7 +1091,7 @@ static void att_server_handle_att_pdu(att_server_t * att_server, att_connection_
             return;
         } else {
             log_info("abort signed write validation to process new request");
-            att_server->state = ATT_SERVER_IDLE;
+            att_server_request_done(att_server);
         }
     }
 #endif
@@ -920,10 +1101,20 @@ static void att_server_handle_att_pdu(att_server_t * att_server, att_connection_
         return;
     }
 
-    // store request
+    // store request in request context, reject request if none available
+    att_server->request = att_server_request_get(att_server);
+    if (att_server->request == NULL){
+        if (command){
+            log_info("drop att pdu 0x%02x as no request context available", packet[0]);
+            return;
+        }
+        log_info("no request context available for att pdu 0x%02x", packet[0]);
+    } else {
+        att_server->request->size = size;
+        (void)memcpy(att_server->request->buffer, packet, size);
+    }
     att_server->state = ATT_SERVER_REQUEST_RECEIVED;
-    att_server->request_size = size;
-    (void)memcpy(att_server->request_buffer, packet, size);
+    att_server->request_opcode = opcode;
 
     att_run_for_context(att_server, att_connection);
 }
@@ -1032,10 +1223,100 @@ static uint32_t att_server_persistent_ccc_tag_for_index(uint8_t index){
     return (((uint8_t)'B') << 24u) | (((uint8_t)'T') << 16u) | (((uint8_t)'C') << 8u) | index;
 }
 
+static uint32_t att_server_service_changed_tag_for_index(uint8_t index){
+    return (((uint8_t)'B') << 24u) | (((uint8_t)'T') << 16u) | (((uint8_t)'S') << 8u) | index;
+}
+
 static uint32_t att_server_tag_for_hash(void){
     return (((uint8_t)'B') << 24u) | (((uint8_t)'T') << 16u) | (((uint8_t)'D') << 8u) | ((uint8_t)'B');
 }
 
+// @returns true if table of persistent CCC values is available
+static bool att_server_persistent_ccc_table_load(void){
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (!tlv_impl) return false;
+
+    if (att_server_persistent_ccc_table_loaded &&
+        (tlv_impl == att_server_persistent_ccc_tlv_impl) && (tlv_context == att_server_persistent_ccc_tlv_context)){
+        return true;
+    }
+
+    // store pending changes in previous TLV
+    att_server_persistent_ccc_flush();
+
+    // bulk read all ccc tags
+    att_server_persistent_ccc_tlv_impl    = tlv_impl;
+    att_server_persistent_ccc_tlv_context = tlv_context;
+    int index;
+    for (index=0; index<NVN_NUM_GATT_SERVER_CCC; index++){
+        persistent_ccc_table_entry_t * table_entry = &att_server_persistent_ccc_table[index];
+        uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
+        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &table_entry->entry, sizeof(persistent_ccc_entry_t));
+        table_entry->valid = len == (int) sizeof(persistent_ccc_entry_t);
+        table_entry->dirty = false;
+    }
+    att_server_persistent_ccc_table_loaded = true;
+    return true;
+}
+
+static void att_server_persistent_ccc_table_reset(void){
+    if (att_server_persistent_ccc_flush_timer_active){
+        btstack_run_loop_remove_timer(&att_server_persistent_ccc_flush_timer);
+        att_server_persistent_ccc_flush_timer_active = false;
+    }
+    att_server_persistent_ccc_table_loaded = false;
+}
+
+void att_server_persistent_ccc_flush(void){
+    if (att_server_persistent_ccc_flush_timer_active){
+        btstack_run_loop_remove_timer(&att_server_persistent_ccc_flush_timer);
+        att_server_persistent_ccc_flush_timer_active = false;
+    }
+    if (!att_server_persistent_ccc_table_loaded) return;
+
+    const btstack_tlv_t * tlv_impl = att_server_persistent_ccc_tlv_impl;
+    void * tlv_context = att_server_persistent_ccc_tlv_context;
+    int index;
+    for (index=0; index<NVN_NUM_GATT_SERVER_CCC; index++){
+        persistent_ccc_table_entry_t * table_entry = &att_server_persistent_ccc_table[index];
+        if (!table_entry->dirty) continue;
+        table_entry->dirty = false;
+        uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
+        if (table_entry->valid){
+            log_info("CCC Index %u: Store", index);
+            int result = tlv_impl->store_tag(tlv_context, tag, (const uint8_t *) &table_entry->entry, sizeof(persistent_ccc_entry_t));
+            if (result != 0){
+                log_error("Store tag index %u failed", index);
+            }
+        } else {
+            log_info("CCC Index %u: Delete", index);
+            tlv_impl->delete_tag(tlv_context, tag);
+        }
+    }
+}
+
+#if ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS > 0
+static void att_server_persistent_ccc_flush_timeout(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    att_server_persistent_ccc_flush_timer_active = false;
+    att_server_persistent_ccc_flush();
+}
+#endif
+
+static void att_server_persistent_ccc_schedule_flush(void){
+#if ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS == 0
+    att_server_persistent_ccc_flush();
+#else
+    if (att_server_persistent_ccc_flush_timer_active) return;
+    att_server_persistent_ccc_flush_timer_active = true;
+    btstack_run_loop_set_timer_handler(&att_server_persistent_ccc_flush_timer, &att_server_persistent_ccc_flush_timeout);
+    btstack_run_loop_set_timer(&att_server_persistent_ccc_flush_timer, ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS);
+    btstack_run_loop_add_timer(&att_server_persistent_ccc_flush_timer);
+#endif
+}
+
 static void att_server_persistent_ccc_write(hci_con_handle_t con_handle, uint16_t att_handle, uint16_t value){
     // lookup att_server instance
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
@@ -1047,108 +1328,99 @@ static void att_server_persistent_ccc_write(hci_con_handle_t con_handle, uint16_
     // check if bonded
     if (le_device_index < 0) return;
 
-    // get btstack_tlv
-    const btstack_tlv_t * tlv_impl = NULL;
-    void * tlv_context;
-    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
-    if (!tlv_impl) return;
+    if (!att_server_persistent_ccc_table_load()) return;
 
-    // update ccc tag
+    // update ccc entry
     int index;
     uint32_t highest_seq_nr = 0;
     uint32_t lowest_seq_nr = 0;
-    uint32_t tag_for_lowest_seq_nr = 0;
-    uint32_t tag_for_empty = 0;
-    persistent_ccc_entry_t entry;
+    int index_for_lowest_seq_nr = -1;
+    int index_for_empty = -1;
+    persistent_ccc_table_entry_t * table_entry;
     for (index=0; index<NVN_NUM_GATT_SERVER_CCC; index++){
-        uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
+        table_entry = &att_server_persistent_ccc_table[index];
 
-        // empty/invalid tag
-        if (len != (int) sizeof(persistent_ccc_entry_t)){
-            tag_for_empty = tag;
+        // empty entry
+        if (!table_entry->valid){
+            index_for_empty = index;
             continue;
         }
+        persistent_ccc_entry_t * entry = &table_entry->entry;
         // update highest seq nr
-        if (entry.seq_nr > highest_seq_nr){
-            highest_seq_nr = entry.seq_nr;
+        if (entry->seq_nr > highest_seq_nr){
+            highest_seq_nr = entry->seq_nr;
         }
         // find entry with lowest seq nr
-        if ((tag_for_lowest_seq_nr == 0u) || (entry.seq_nr < lowest_seq_nr)){
-            tag_for_lowest_seq_nr = tag;
-            lowest_seq_nr = entry.seq_nr;
+        if ((index_for_lowest_seq_nr < 0) || (entry->seq_nr < lowest_seq_nr)){
+            index_for_lowest_seq_nr = index;
+            lowest_seq_nr = entry->seq_nr;
         }
 
-        if ((int)entry.device_index != le_device_index) continue;
-        if (     entry.att_handle   != att_handle)      continue;
+        if ((int)entry->device_index != le_device_index) continue;
+        if (     entry->att_handle   != att_handle)      continue;
 
         // found matching entry
         if (value != 0u){
             // update
-            if (entry.value == value) {
+            if (entry->value == value) {
                 log_info("CCC Index %u: Up-to-date", index);
                 return;
             }
-            entry.value = (uint8_t) value;
-            entry.seq_nr = highest_seq_nr + 1u;
-            log_info("CCC Index %u: Store", index);
-            int result = tlv_impl->store_tag(tlv_context, tag, (const uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-            if (result != 0){
-                log_error("Store tag index %u failed", index);
-            }
+            entry->value = (uint8_t) value;
+            entry->seq_nr = highest_seq_nr + 1u;
         } else {
             // delete
-            log_info("CCC Index %u: Delete", index);
-            tlv_impl->delete_tag(tlv_context, tag);
+            table_entry->valid = false;
         }
+        table_entry->dirty = true;
+        att_server_persistent_ccc_schedule_flush();
         return;
     }
 
-    log_info("tag_for_empty %"PRIx32", tag_for_lowest_seq_nr %"PRIx32, tag_for_empty, tag_for_lowest_seq_nr);
+    log_info("index_for_empty %d, index_for_lowest_seq_nr %d", index_for_empty, index_for_lowest_seq_nr);
 
     if (value == 0u){
         // done
         return;
     }
 
-    uint32_t tag_to_use = 0u;
-    if (tag_for_empty != 0u){
-        tag_to_use = tag_for_empty;
-    } else if (tag_for_lowest_seq_nr != 0u){
-        tag_to_use = tag_for_lowest_seq_nr;
+    int index_to_use;
+    if (index_for_empty >= 0){
+        index_to_use = index_for_empty;
+    } else if (index_for_lowest_seq_nr >= 0){
+        index_to_use = index_for_lowest_seq_nr;
     } else {
         // should not happen
         return;
     }
-    // store ccc tag
-    entry.seq_nr       = highest_seq_nr + 1u;
-    entry.device_index = le_device_index;
-    entry.att_handle   = att_handle;
-    entry.value        = (uint8_t) value;
-    int result = tlv_impl->store_tag(tlv_context, tag_to_use, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-    if (result != 0){
-        log_error("Store tag index %u failed", index);
-    }
+    // store ccc entry
+    table_entry = &att_server_persistent_ccc_table[index_to_use];
+    table_entry->entry.seq_nr       = highest_seq_nr + 1u;
+    table_entry->entry.device_index = le_device_index;
+    table_entry->entry.att_handle   = att_handle;
+    table_entry->entry.value        = (uint8_t) value;
+    table_entry->valid = true;
+    table_entry->dirty = true;
+    att_server_persistent_ccc_schedule_flush();
 }
 
 static void att_server_persistent_ccc_clear(int le_device_index){
-    // get btstack_tlv
-    const btstack_tlv_t * tlv_impl = NULL;
-    void * tlv_context;
-    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
-    if (!tlv_impl) return;
-    // get all ccc tag
+    if (!att_server_persistent_ccc_table_load()) return;
+    // delete all entries of device
     int index;
-    persistent_ccc_entry_t entry;
+    bool changed = false;
     for (index=0;index<NVN_NUM_GATT_SERVER_CCC;index++){
-        uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-        if (len != (int) sizeof(persistent_ccc_entry_t)) continue;
-        if ((int)entry.device_index != le_device_index) continue;
-        // delete entry
-        log_info("CCC Index %u: Delete", index);
-        tlv_impl->delete_tag(tlv_context, tag);
-    }  
+        persistent_ccc_table_entry_t * table_entry = &att_server_persistent_ccc_table[index];
+        if (!table_entry->valid) continue;
+        if ((int)table_entry->entry.device_index != le_device_index) continue;
+        table_entry->valid = false;
+        table_entry->dirty = true;
+        changed = true;
+    }
+    // device index might get re-used, write immediately
+    if (changed){
+        att_server_persistent_ccc_flush();
+    }
 }
 
 // @returns true if cccs are valid
@@ -1181,6 +1453,7 @@ static bool att_server_persistent_ccc_validate_database(const btstack_tlv_t * tl
 
     // clear stored CCCs
     if (stored_cccs_valid == false) {
+        att_server_persistent_ccc_table_reset();
         for (int index=0;index<NVN_NUM_GATT_SERVER_CCC;index++) {
             uint32_t ccc_tag = att_server_persistent_ccc_tag_for_index(index);
             tlv_impl->delete_tag(tlv_context, ccc_tag);
@@ -1212,28 +1485,143 @@ static void att_server_persistent_ccc_restore(att_server_t * att_server, att_con
     int le_device_index = att_server->ir_le_device_db_index;
     if (le_device_index < 0) return;
     log_info("Restore CCC values of remote %s, le device id %d", bd_addr_to_str(att_server->peer_address), le_device_index);
-    // get all ccc tag
+    if (!att_server_persistent_ccc_table_load()) return;
+    // get all ccc entries
     int index;
-    persistent_ccc_entry_t entry;
     for (index=0;index<NVN_NUM_GATT_SERVER_CCC;index++){
-        uint32_t tag = att_server_persistent_ccc_tag_for_index(index);
-        int len = tlv_impl->get_tag(tlv_context, tag, (uint8_t *) &entry, sizeof(persistent_ccc_entry_t));
-        if (len != (int) sizeof(persistent_ccc_entry_t)) continue;
-        if ((int) entry.device_index != le_device_index) continue;
+        const persistent_ccc_table_entry_t * table_entry = &att_server_persistent_ccc_table[index];
+        if (!table_entry->valid) continue;
+        if ((int) table_entry->entry.device_index != le_device_index) continue;
         // simulate write callback
-        uint16_t attribute_handle = entry.att_handle;
+        uint16_t attribute_handle = table_entry->entry.att_handle;
         uint8_t  value[2];
-        little_endian_store_16(value, 0, entry.value);
+        little_endian_store_16(value, 0, table_entry->entry.value);
+        if (attribute_handle == att_server_service_changed_ccc_handle){
+            att_server->service_changed_indications_enabled = (table_entry->entry.value & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_INDICATION) != 0u;
+        }
         att_write_callback_t callback = att_server_write_callback_for_handle(attribute_handle);
         if (!callback) continue;
-        log_info("CCC Index %u: Set Attribute handle 0x%04x to value 0x%04x", index, attribute_handle, entry.value );
+        log_info("CCC Index %u: Set Attribute handle 0x%04x to value 0x%04x", index, attribute_handle, table_entry->entry.value);
         (*callback)(att_connection->con_handle, attribute_handle, ATT_TRANSACTION_MODE_NONE, 0, value, sizeof(value));
     }
+
+    // send Service Changed for database changes while disconnected
+    uint8_t range[4];
+    uint32_t tag = att_server_service_changed_tag_for_index((uint8_t) le_device_index);
+    int len = tlv_impl->get_tag(tlv_context, tag, range, sizeof(range));
+    if ((len == (int) sizeof(range)) && att_server->service_changed_indications_enabled){
+        att_server_service_changed_request(att_server, att_connection->con_handle, little_endian_read_16(range, 0), little_endian_read_16(range, 2));
+    }
 }
 
 // persistent CCC writes
 // ---------------------
 
+// ---------------------
+// Service Changed
+
+static void att_server_service_changed_lookup_handles(void){
+    att_server_service_changed_value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, GAP_SERVICE_CHANGED);
+    att_server_service_changed_ccc_handle   = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, GAP_SERVICE_CHANGED);
+}
+
+static void att_server_service_changed_send(void * context){
+    hci_con_handle_t con_handle = (hci_con_handle_t) (uintptr_t) context;
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (hci_connection == NULL) return;
+    att_server_t * att_server = &hci_connection->att_server;
+    if (att_server->change_unaware == false) return;
+    uint8_t value[4];
+    little_endian_store_16(value, 0, att_server->service_changed_start_handle);
+    little_endian_store_16(value, 2, att_server->service_changed_end_handle);
+    (void) att_server_indicate(con_handle, att_server_service_changed_value_handle, value, sizeof(value));
+}
+
+static void att_server_service_changed_request(att_server_t * att_server, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle){
+    // merge with pending range
+    if (att_server->change_unaware){
+        start_handle = btstack_min(start_handle, att_server->service_changed_start_handle);
+        end_handle   = btstack_max(end_handle,   att_server->service_changed_end_handle);
+    }
+    att_server->service_changed_start_handle = start_handle;
+    att_server->service_changed_end_handle   = end_handle;
+    att_server->change_unaware = true;
+    att_server->service_changed_request.callback = &att_server_service_changed_send;
+    att_server->service_changed_request.context  = (void *) (uintptr_t) con_handle;
+    (void) att_server_request_to_send_indication(&att_server->service_changed_request, con_handle);
+}
+
+static void att_server_service_changed_complete(att_server_t * att_server){
+    att_server->change_unaware = false;
+    int le_device_index = att_server->ir_le_device_db_index;
+    if (le_device_index < 0) return;
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (!tlv_impl) return;
+    tlv_impl->delete_tag(tlv_context, att_server_service_changed_tag_for_index((uint8_t) le_device_index));
+}
+
+// store pending range for bonded clients that enabled Service Changed indications
+static void att_server_service_changed_store(const btstack_tlv_t * tlv_impl, void * tlv_context, uint16_t start_handle, uint16_t end_handle){
+    if (!att_server_persistent_ccc_table_load()) return;
+    int index;
+    for (index=0;index<NVN_NUM_GATT_SERVER_CCC;index++){
+        const persistent_ccc_table_entry_t * table_entry = &att_server_persistent_ccc_table[index];
+        if (!table_entry->valid) continue;
+        if (table_entry->entry.att_handle != att_server_service_changed_ccc_handle) continue;
+        if ((table_entry->entry.value & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_INDICATION) == 0u) continue;
+        uint8_t  range[4];
+        uint32_t tag = att_server_service_changed_tag_for_index(table_entry->entry.device_index);
+        uint16_t range_start = start_handle;
+        uint16_t range_end   = end_handle;
+        int len = tlv_impl->get_tag(tlv_context, tag, range, sizeof(range));
+        if (len == (int) sizeof(range)){
+            range_start = btstack_min(range_start, little_endian_read_16(range, 0));
+            range_end   = btstack_max(range_end,   little_endian_read_16(range, 2));
+        }
+        little_endian_store_16(range, 0, range_start);
+        little_endian_store_16(range, 2, range_end);
+        tlv_impl->store_tag(tlv_context, tag, range, sizeof(range));
+    }
+}
+
+void att_server_service_changed(uint16_t start_handle, uint16_t end_handle){
+    att_server_service_changed_lookup_handles();
+    if (att_server_service_changed_value_handle == 0u) return;
+
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl != NULL){
+        att_server_service_changed_store(tlv_impl, tlv_context, start_handle, end_handle);
+        // bonded clients are informed about the change, keep their persistent CCCs on next start
+        uint8_t hash_from_db[16];
+        if (gatt_server_get_database_hash(hash_from_db)){
+            tlv_impl->store_tag(tlv_context, att_server_tag_for_hash(), hash_from_db, sizeof(hash_from_db));
+        }
+    }
+
+    // inform connected clients
+    btstack_linked_list_iterator_t it;
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        att_server_t * att_server = &hci_connection->att_server;
+        if (att_server->service_changed_indications_enabled == false) continue;
+        att_server_service_changed_request(att_server, hci_connection->con_handle, start_handle, end_handle);
+    }
+}
+
+bool att_server_client_change_aware(hci_con_handle_t con_handle){
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (hci_connection == NULL) return false;
+    return hci_connection->att_server.change_unaware == false;
+}
+
+// Service Changed
+// ---------------------
+
 // gatt service management
 static att_service_handler_t * att_service_handler_for_handle(uint16_t handle){
     btstack_linked_list_iterator_t it;
@@ -1286,7 +1674,77 @@ static uint8_t att_validate_prepared_write(hci_con_handle_t con_handle){
     return (*att_server_client_write_callback)(con_handle, 0, ATT_TRANSACTION_MODE_VALIDATE, 0, NULL, 0);
 }
 
+static att_server_value_cache_t * att_server_value_cache_for_handle(uint16_t attribute_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &att_server_value_caches);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        att_server_value_cache_t * cache = (att_server_value_cache_t *) btstack_linked_list_iterator_next(&it);
+        if (cache->attribute_handle == attribute_handle){
+            return cache;
+        }
+    }
+    return NULL;
+}
+
+static bool att_server_value_cache_valid(att_server_value_cache_t * cache){
+    if (cache->valid == false){
+        return false;
+    }
+    if (cache->validity_period_ms == 0u){
+        return true;
+    }
+    uint32_t age_ms = btstack_run_loop_get_time_ms() - cache->timestamp_ms;
+    if (age_ms >= cache->validity_period_ms){
+        cache->valid = false;
+        return false;
+    }
+    return true;
+}
+
+void att_server_value_cache_register(att_server_value_cache_t * cache, uint16_t attribute_handle, uint8_t * storage, uint16_t storage_size, uint32_t validity_period_ms){
+    btstack_assert(storage != NULL);
+    cache->attribute_handle = attribute_handle;
+    cache->storage = storage;
+    cache->storage_size = storage_size;
+    cache->validity_period_ms = validity_period_ms;
+    cache->value_len = 0;
+    cache->valid = false;
+    btstack_linked_list_add(&att_server_value_caches, (btstack_linked_item_t *) cache);
+}
+
+uint8_t att_server_value_cache_store(uint16_t attribute_handle, const uint8_t * value, uint16_t value_len){
+    att_server_value_cache_t * cache = att_server_value_cache_for_handle(attribute_handle);
+    if (cache == NULL){
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+    if (value_len > cache->storage_size){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+    (void)memcpy(cache->storage, value, value_len);
+    cache->value_len = value_len;
+    cache->timestamp_ms = btstack_run_loop_get_time_ms();
+    cache->valid = true;
+    return ERROR_CODE_SUCCESS;
+}
+
+void att_server_value_cache_invalidate(uint16_t attribute_handle){
+    att_server_value_cache_t * cache = att_server_value_cache_for_handle(attribute_handle);
+    if (cache != NULL){
+        cache->valid = false;
+    }
+}
+
+void att_server_value_cache_unregister(att_server_value_cache_t * cache){
+    (void) btstack_linked_list_remove(&att_server_value_caches, (btstack_linked_item_t *) cache);
+}
+
 static uint16_t att_server_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    // serve length query and (blob) reads from value cache
+    att_server_value_cache_t * cache = att_server_value_cache_for_handle(attribute_handle);
+    if ((cache != NULL) && att_server_value_cache_valid(cache)){
+        return att_read_callback_handle_blob(cache->storage, cache->value_len, offset, buffer, buffer_size);
+    }
+
     att_service_handler_t * service = att_service_handler_for_handle(attribute_handle);
     att_read_callback_t read_callback = (service != NULL) ? service->read_callback : att_server_client_read_callback;
     uint16_t result = 0;
@@ -1317,6 +1775,17 @@ static int att_server_write_callback(hci_con_handle_t con_handle, uint16_t attri
             break;
     }
 
+    // cached value is outdated
+    att_server_value_cache_invalidate(attribute_handle);
+
+    // track Service Changed subscription
+    if ((attribute_handle == att_server_service_changed_ccc_handle) && (offset == 0u) && (buffer_size == 2u)){
+        hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+        if (hci_connection != NULL){
+            hci_connection->att_server.service_changed_indications_enabled = (little_endian_read_16(buffer, 0) & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_INDICATION) != 0u;
+        }
+    }
+
     // track CCC writes
     if (att_is_persistent_ccc(attribute_handle) && (offset == 0u) && (buffer_size == 2u)){
         att_server_persistent_ccc_write(con_handle, attribute_handle, little_endian_read_16(buffer, 0));
@@ -1378,6 +1847,10 @@ void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_
 
     // validate database hash on first connect
     att_server_flags = ATT_SERVER_FLAGS_VALIDATE_DATABASE_HASH;
+    att_server_persistent_ccc_flush();
+    att_server_persistent_ccc_table_reset();
+
+    att_server_service_changed_lookup_handles();
 }
 
 void att_server_register_packet_handler(btstack_packet_handler_t handler){
@@ -1510,6 +1983,62 @@ uint8_t att_server_multiple_notify(hci_con_handle_t con_handle, uint8_t num_attr
     return att_server_send_prepared(att_server, att_connection, packet_buffer, size);
 }
 
+uint8_t att_server_notification_stream_register(att_server_notification_stream_t * stream, hci_con_handle_t con_handle,
+                                                uint16_t attribute_handle, uint8_t * storage, uint16_t storage_size){
+    btstack_assert(storage_size > 2u);
+    hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
+    if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    att_server_t * att_server = &hci_connection->att_server;
+    bool added = btstack_linked_list_add_tail(&att_server->notification_streams, (btstack_linked_item_t *) stream);
+    if (added == false){
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+    stream->con_handle = con_handle;
+    stream->attribute_handle = attribute_handle;
+    stream->storage = storage;
+    stream->storage_size = storage_size;
+    stream->read_pos = 0;
+    stream->bytes_used = 0;
+    stream->num_notifications_sent = 0;
+    stream->num_bytes_sent = 0;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t att_server_notification_stream_write(att_server_notification_stream_t * stream, const uint8_t * value, uint16_t value_len){
+    hci_connection_t * hci_connection = hci_connection_for_handle(stream->con_handle);
+    if (!hci_connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    att_server_t * att_server = &hci_connection->att_server;
+    att_connection_t * att_connection = &hci_connection->att_connection;
+    if (att_server_notification_stream_registered(att_server, stream) == false){
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+    if ((value_len + 3u) > att_connection->mtu){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    if ((stream->bytes_used + 2u + value_len) > stream->storage_size){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    bool streams_ready = att_server_notification_streams_ready(att_server);
+
+    uint8_t length_field[2];
+    little_endian_store_16(length_field, 0, value_len);
+    att_server_notification_stream_store(stream, length_field, 2);
+    att_server_notification_stream_store(stream, value, value_len);
+
+    if (streams_ready == false){
+        att_server_request_can_send_now(att_server, att_connection);
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+void att_server_notification_stream_unregister(att_server_notification_stream_t * stream){
+    hci_connection_t * hci_connection = hci_connection_for_handle(stream->con_handle);
+    if (!hci_connection) return;
+    (void) btstack_linked_list_remove(&hci_connection->att_server.notification_streams, (btstack_linked_item_t *) stream);
+    stream->bytes_used = 0;
+}
+
 uint8_t att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t *value, uint16_t value_len){
 
     att_server_t * att_server = NULL;
@@ -1552,6 +2081,9 @@ void att_server_deinit(void){
     att_server_client_write_callback = NULL;
     att_client_packet_handler = NULL;
     service_handlers = NULL;
+    att_server_value_caches = NULL;
+    att_server_persistent_ccc_flush();
+    att_server_persistent_ccc_table_reset();
 }
 
 #ifdef ENABLE_GATT_OVER_EATT
@@ -1690,6 +2222,7 @@ static void att_server_eatt_handler(uint8_t packet_type, uint16_t channel, uint8
                     btstack_assert(eatt_bearer != NULL);
 
                     // TODO: finalize - abort queued writes
+                    att_server_request_done(&eatt_bearer->att_server);
 
                     btstack_linked_list_remove(&att_server_eatt_bearer_active, (btstack_linked_item_t  *) eatt_bearer);
                     btstack_linked_list_add(&att_server_eatt_bearer_pool, (btstack_linked_item_t  *) eatt_bearer);
@@ -1724,6 +2257,7 @@ uint8_t att_server_eatt_init(uint8_t num_eatt_bearers, uint8_t * storage_buffer,
              num_eatt_bearers, att_server_eatt_receive_buffer_size);
     for (i=0;i<num_eatt_bearers;i++){
         eatt_bearer->att_connection.con_handle = HCI_CON_HANDLE_INVALID;
+        eatt_bearer->att_server.bearer_request = &eatt_bearer->request;
         eatt_bearer->receive_buffer = bearer_buffer;
         bearer_buffer += att_server_eatt_receive_buffer_size;
         eatt_bearer->send_buffer = bearer_buffer;
@@ -58,6 +58,7 @@ typedef struct {
     btstack_linked_item_t item;
     att_server_t     att_server;
     att_connection_t att_connection;
+    att_server_request_t request;
     uint8_t * receive_buffer;
     uint8_t * send_buffer;
 } att_server_eatt_bearer_t;
@@ -65,6 +66,35 @@ typedef struct {
 
 /* API_START */
 
+// Notification stream for a single attribute, see att_server_notification_stream_register
+typedef struct {
+    btstack_linked_item_t item;
+    hci_con_handle_t con_handle;
+    uint16_t attribute_handle;
+
+    // queued notifications in ring buffer, each stored as 16-bit little endian length followed by value
+    uint8_t * storage;
+    uint16_t  storage_size;
+    uint16_t  read_pos;
+    uint16_t  bytes_used;
+
+    // statistics
+    uint32_t num_notifications_sent;
+    uint32_t num_bytes_sent;
+} att_server_notification_stream_t;
+
+// Cached value of a dynamic attribute, see att_server_value_cache_register
+typedef struct {
+    btstack_linked_item_t item;
+    uint16_t  attribute_handle;
+    uint8_t * storage;
+    uint16_t  storage_size;
+    uint16_t  value_len;
+    uint32_t  validity_period_ms;
+    uint32_t  timestamp_ms;
+    bool      valid;
+} att_server_value_cache_t;
+
 /**
  * @title ATT Server
  *
@@ -162,6 +192,72 @@ uint8_t att_server_notify(hci_con_handle_t con_handle, uint16_t attribute_handle
 uint8_t att_server_multiple_notify(hci_con_handle_t con_handle, uint8_t num_attributes,
                                    const uint16_t * attribute_handles, const uint8_t ** values_data, const uint16_t * values_len);
 
+/**
+ * @brief Register notification stream for attribute. Values queued with att_server_notification_stream_write
+ *        are sent as Handle Value Notifications as fast as the Controller accepts ACL packets, without
+ *        further callbacks. Pending notification requests of the connection are served first.
+ * @note The stream is removed on disconnect
+ * @param stream
+ * @param con_handle
+ * @param attribute_handle
+ * @param storage for queued values, 2 bytes overhead per value
+ * @param storage_size
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if handle unknown, and ERROR_CODE_COMMAND_DISALLOWED if stream already registered
+ */
+uint8_t att_server_notification_stream_register(att_server_notification_stream_t * stream, hci_con_handle_t con_handle,
+                                                uint16_t attribute_handle, uint8_t * storage, uint16_t storage_size);
+
+/**
+ * @brief Queue value for notification stream
+ * @param stream
+ * @param value
+ * @param value_len must not exceed ATT MTU - 3
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER if not registered,
+ *         ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if value too long, and ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if storage full
+ */
+uint8_t att_server_notification_stream_write(att_server_notification_stream_t * stream, const uint8_t * value, uint16_t value_len);
+
+/**
+ * @brief Unregister notification stream, queued values are dropped
+ * @param stream
+ */
+void att_server_notification_stream_unregister(att_server_notification_stream_t * stream);
+
+/**
+ * @brief Register value cache for dynamic attribute. While the cached value is valid, reads of the attribute,
+ *        including the length query, Read Blob Requests for long values and reads by other clients, are served
+ *        from the cache without calling the att_read_callback.
+ * @note The cached value is invalidated by writes to the attribute
+ * @param cache
+ * @param attribute_handle
+ * @param storage for cached value
+ * @param storage_size
+ * @param validity_period_ms after which the att_read_callback is called again, 0 = valid until invalidated
+ */
+void att_server_value_cache_register(att_server_value_cache_t * cache, uint16_t attribute_handle, uint8_t * storage, uint16_t storage_size, uint32_t validity_period_ms);
+
+/**
+ * @brief Store value in value cache of attribute
+ * @param attribute_handle
+ * @param value
+ * @param value_len
+ * @return ERROR_CODE_SUCCESS if ok, ERROR_CODE_COMMAND_DISALLOWED if no cache registered for attribute,
+ *         and ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if value larger than storage
+ */
+uint8_t att_server_value_cache_store(uint16_t attribute_handle, const uint8_t * value, uint16_t value_len);
+
+/**
+ * @brief Invalidate cached value of attribute, next read calls att_read_callback again
+ * @param attribute_handle
+ */
+void att_server_value_cache_invalidate(uint16_t attribute_handle);
+
+/**
+ * @brief Unregister value cache
+ * @param cache
+ */
+void att_server_value_cache_unregister(att_server_value_cache_t * cache);
+
 /**
  * @brief indicate value change to client. client is supposed to reply with an indication_response
  * @param con_handle
@@ -172,15 +268,53 @@ uint8_t att_server_multiple_notify(hci_con_handle_t con_handle, uint8_t num_attr
  */
 uint8_t att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t *value, uint16_t value_len);
 
+/**
+ * @brief Inform clients about modified handle range after the GATT database was changed, e.g. by att_db_util.
+ *        Connected clients that enabled Service Changed indications receive the range and are change-unaware
+ *        until they confirm the indication. For bonded clients, the range is stored and indicated on reconnect.
+ *        The stored GATT Database Hash is updated, so persistent CCCs stay valid after restart.
+ * @note Update the value of the Database Hash characteristic before, see att_db_util_hash_calc
+ * @param start_handle
+ * @param end_handle
+ */
+void att_server_service_changed(uint16_t start_handle, uint16_t end_handle);
+
+/**
+ * @brief Check if client is change-aware, i.e. it has no pending Service Changed indication
+ * @param con_handle
+ * @return true if change-aware
+ */
+bool att_server_client_change_aware(hci_con_handle_t con_handle);
+
+/**
+ * @brief Write modified Client Characteristic Configuration values of bonded clients to TLV
+ * @note CCC writes are collected in RAM and stored ATT_SERVER_PERSISTENT_CCC_FLUSH_DELAY_MS after the first change
+ *       or on disconnect. Call before power-off to not lose recent changes.
+ */
+void att_server_persistent_ccc_flush(void);
+
 #ifdef ENABLE_ATT_DELAYED_RESPONSE
 /**
  * @brief response ready - called after returning ATT_READ__RESPONSE_PENDING in an att_read_callback or
  * ATT_ERROR_WRITE_REQUEST_PENDING IN att_write_callback before to trigger callback again and complete the transaction
  * @nore The ATT Server will retry handling the current ATT request
+ * @note With EATT, the pending requests on all bearers of the connection are retried
  * @param con_handle
  * @return 0 if ok, error otherwise
  */
 uint8_t att_server_response_ready(hci_con_handle_t con_handle);
+
+/**
+ * @brief asynchronous read complete - called after returning ATT_READ_RESPONSE_PENDING in an att_read_callback
+ *        for an attribute with value cache. The value is stored in the cache and the pending request is completed
+ *        from it without calling the att_read_callback again.
+ * @param con_handle
+ * @param attribute_handle
+ * @param value
+ * @param value_len
+ * @return 0 if ok, error otherwise
+ */
+uint8_t att_server_read_response_ready(hci_con_handle_t con_handle, uint16_t attribute_handle, const uint8_t * value, uint16_t value_len);
 #endif
 
 /**
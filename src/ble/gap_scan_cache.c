@@ -0,0 +1,462 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "gap_scan_cache.c"
+
+// *****************************************************************************
+//
+// GAP Scan Cache
+//
+// Advertisers are stored in application provided entries, found via a hash table
+// and kept in a LRU list ordered by last seen. If all entries are in use, the
+// least recently seen advertiser is evicted.
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ble/gap_scan_cache.h"
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_run_loop.h"
+#include "hci.h"
+
+#define GAP_SCAN_CACHE_INVALID_INDEX 0xffffu
+
+// parts of the merged payload, used for incomplete and truncated flags
+#define GAP_SCAN_CACHE_PART_ADVERTISING_DATA  0x01u
+#define GAP_SCAN_CACHE_PART_SCAN_RESPONSE     0x02u
+
+// RSSI not available in Extended Advertising Report
+#define GAP_SCAN_CACHE_RSSI_NOT_AVAILABLE 127
+
+// Legacy Advertising Report event types
+#define GAP_SCAN_CACHE_LEGACY_ADV_DIRECT_IND  0x01u
+#define GAP_SCAN_CACHE_LEGACY_SCAN_RSP        0x04u
+
+// Extended Advertising Report event type bits
+#define GAP_SCAN_CACHE_EXTENDED_DIRECTED      0x0004u
+#define GAP_SCAN_CACHE_EXTENDED_SCAN_RESPONSE 0x0008u
+#define GAP_SCAN_CACHE_EXTENDED_LEGACY        0x0010u
+#define GAP_SCAN_CACHE_EXTENDED_DATA_STATUS_POS  5
+#define GAP_SCAN_CACHE_EXTENDED_DATA_STATUS_MASK 0x03u
+#define GAP_SCAN_CACHE_DATA_STATUS_INCOMPLETE_MORE_TO_COME 0x01u
+
+#if (GAP_SCAN_CACHE_NUM_BUCKETS & (GAP_SCAN_CACHE_NUM_BUCKETS - 1)) != 0
+#error "GAP_SCAN_CACHE_NUM_BUCKETS must be a power of two"
+#endif
+
+static btstack_packet_callback_registration_t gap_scan_cache_hci_event_callback_registration;
+static btstack_timer_source_t gap_scan_cache_timer;
+static gap_scan_cache_callback_t gap_scan_cache_callback;
+
+static gap_scan_cache_entry_t * gap_scan_cache_entries;
+static uint16_t gap_scan_cache_num_entries;
+static uint16_t gap_scan_cache_num_advertisers;
+static uint16_t gap_scan_cache_buckets[GAP_SCAN_CACHE_NUM_BUCKETS];
+static uint16_t gap_scan_cache_free_head;
+static uint16_t gap_scan_cache_lru_head;
+static uint16_t gap_scan_cache_lru_tail;
+
+static uint8_t  gap_scan_cache_policy;
+static uint32_t gap_scan_cache_period_ms;
+static uint32_t gap_scan_cache_period_start_ms;
+
+static uint32_t gap_scan_cache_hash(uint32_t hash, const uint8_t * data, uint16_t len){
+    // FNV-1a
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint16_t gap_scan_cache_bucket(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid){
+    uint8_t key[2] = { (uint8_t) address_type, advertising_sid };
+    uint32_t hash = gap_scan_cache_hash(2166136261u, address, BD_ADDR_LEN);
+    hash = gap_scan_cache_hash(hash, key, sizeof(key));
+    return (uint16_t) (hash & (GAP_SCAN_CACHE_NUM_BUCKETS - 1u));
+}
+
+static uint32_t gap_scan_cache_data_hash(const gap_scan_cache_entry_t * entry){
+    uint8_t lengths[4];
+    little_endian_store_16(lengths, 0, entry->advertising_data_len);
+    little_endian_store_16(lengths, 2, entry->scan_response_data_len);
+    uint32_t hash = gap_scan_cache_hash(2166136261u, lengths, sizeof(lengths));
+    return gap_scan_cache_hash(hash, entry->data, entry->advertising_data_len + entry->scan_response_data_len);
+}
+
+static uint16_t gap_scan_cache_find(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid){
+    if (gap_scan_cache_entries == NULL) {
+        return GAP_SCAN_CACHE_INVALID_INDEX;
+    }
+    uint16_t index = gap_scan_cache_buckets[gap_scan_cache_bucket(address_type, address, advertising_sid)];
+    while (index != GAP_SCAN_CACHE_INVALID_INDEX){
+        const gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+        if ((entry->address_type == address_type) && (entry->advertising_sid == advertising_sid)
+            && (memcmp(entry->address, address, BD_ADDR_LEN) == 0)){
+            break;
+        }
+        index = entry->hash_next;
+    }
+    return index;
+}
+
+static void gap_scan_cache_lru_unlink(uint16_t index){
+    gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+    if (entry->lru_prev == GAP_SCAN_CACHE_INVALID_INDEX){
+        gap_scan_cache_lru_head = entry->lru_next;
+    } else {
+        gap_scan_cache_entries[entry->lru_prev].lru_next = entry->lru_next;
+    }
+    if (entry->lru_next == GAP_SCAN_CACHE_INVALID_INDEX){
+        gap_scan_cache_lru_tail = entry->lru_prev;
+    } else {
+        gap_scan_cache_entries[entry->lru_next].lru_prev = entry->lru_prev;
+    }
+}
+
+static void gap_scan_cache_lru_push_front(uint16_t index){
+    gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+    entry->lru_prev = GAP_SCAN_CACHE_INVALID_INDEX;
+    entry->lru_next = gap_scan_cache_lru_head;
+    if (gap_scan_cache_lru_head == GAP_SCAN_CACHE_INVALID_INDEX){
+        gap_scan_cache_lru_tail = index;
+    } else {
+        gap_scan_cache_entries[gap_scan_cache_lru_head].lru_prev = index;
+    }
+    gap_scan_cache_lru_head = index;
+}
+
+static void gap_scan_cache_bucket_unlink(uint16_t index){
+    gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+    uint16_t * link = &gap_scan_cache_buckets[gap_scan_cache_bucket(entry->address_type, entry->address, entry->advertising_sid)];
+    while (*link != index){
+        btstack_assert(*link != GAP_SCAN_CACHE_INVALID_INDEX);
+        link = &gap_scan_cache_entries[*link].hash_next;
+    }
+    *link = entry->hash_next;
+}
+
+static uint16_t gap_scan_cache_allocate(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid){
+    uint16_t index = gap_scan_cache_free_head;
+    if (index != GAP_SCAN_CACHE_INVALID_INDEX){
+        gap_scan_cache_free_head = gap_scan_cache_entries[index].hash_next;
+        gap_scan_cache_num_advertisers++;
+    } else {
+        // evict least recently seen advertiser
+        index = gap_scan_cache_lru_tail;
+        log_debug("evict %s", bd_addr_to_str(gap_scan_cache_entries[index].address));
+        gap_scan_cache_bucket_unlink(index);
+        gap_scan_cache_lru_unlink(index);
+    }
+    gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+    memset(entry, 0, sizeof(gap_scan_cache_entry_t));
+    memcpy(entry->address, address, BD_ADDR_LEN);
+    entry->address_type = address_type;
+    entry->advertising_sid = advertising_sid;
+    entry->data_hash = gap_scan_cache_data_hash(entry);
+    uint16_t bucket = gap_scan_cache_bucket(address_type, address, advertising_sid);
+    entry->hash_next = gap_scan_cache_buckets[bucket];
+    gap_scan_cache_buckets[bucket] = index;
+    gap_scan_cache_lru_push_front(index);
+    return index;
+}
+
+static void gap_scan_cache_part_reset(gap_scan_cache_entry_t * entry, uint8_t part){
+    if (part == GAP_SCAN_CACHE_PART_ADVERTISING_DATA){
+        memmove(&entry->data[0], &entry->data[entry->advertising_data_len], entry->scan_response_data_len);
+        entry->advertising_data_len = 0;
+    } else {
+        entry->scan_response_data_len = 0;
+    }
+    entry->truncated &= ~part;
+}
+
+static void gap_scan_cache_part_append(gap_scan_cache_entry_t * entry, uint8_t part, const uint8_t * data, uint16_t len){
+    uint16_t space = GAP_SCAN_CACHE_MAX_DATA_LEN - entry->advertising_data_len - entry->scan_response_data_len;
+    if (len > space){
+        len = space;
+        entry->truncated |= part;
+    }
+    if (part == GAP_SCAN_CACHE_PART_ADVERTISING_DATA){
+        uint16_t pos = entry->advertising_data_len;
+        memmove(&entry->data[pos + len], &entry->data[pos], entry->scan_response_data_len);
+        memcpy(&entry->data[pos], data, len);
+        entry->advertising_data_len += len;
+    } else {
+        memcpy(&entry->data[entry->advertising_data_len + entry->scan_response_data_len], data, len);
+        entry->scan_response_data_len += len;
+    }
+}
+
+// drop partial AD Structure at the end of a truncated part
+static void gap_scan_cache_part_trim(gap_scan_cache_entry_t * entry, uint8_t part){
+    uint16_t offset = (part == GAP_SCAN_CACHE_PART_ADVERTISING_DATA) ? 0 : entry->advertising_data_len;
+    uint16_t len    = (part == GAP_SCAN_CACHE_PART_ADVERTISING_DATA) ? entry->advertising_data_len : entry->scan_response_data_len;
+    uint16_t pos = 0;
+    while (pos < len){
+        uint16_t next = pos + 1u + entry->data[offset + pos];
+        if (next > len) break;
+        pos = next;
+    }
+    if (part == GAP_SCAN_CACHE_PART_ADVERTISING_DATA){
+        memmove(&entry->data[pos], &entry->data[len], entry->scan_response_data_len);
+        entry->advertising_data_len = pos;
+    } else {
+        entry->scan_response_data_len = pos;
+    }
+    entry->truncated &= ~part;
+}
+
+static void gap_scan_cache_emit(gap_scan_cache_reason_t reason, gap_scan_cache_entry_t * entry){
+    if (gap_scan_cache_callback != NULL){
+        (*gap_scan_cache_callback)(reason, entry);
+    }
+}
+
+static void gap_scan_cache_handle_report(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid,
+                                         int8_t rssi, uint8_t part, bool more_to_come, uint16_t data_len, const uint8_t * data){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint16_t index = gap_scan_cache_find(address_type, address, advertising_sid);
+    if (index == GAP_SCAN_CACHE_INVALID_INDEX){
+        index = gap_scan_cache_allocate(address_type, address, advertising_sid);
+        gap_scan_cache_entries[index].first_seen_ms = now;
+    } else if (index != gap_scan_cache_lru_head){
+        gap_scan_cache_lru_unlink(index);
+        gap_scan_cache_lru_push_front(index);
+    }
+    gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+    entry->last_seen_ms = now;
+
+    // fragments of a chained report share the RSSI of the first one
+    bool continuation = (entry->incomplete & part) != 0u;
+    if ((continuation == false) && (rssi != GAP_SCAN_CACHE_RSSI_NOT_AVAILABLE)){
+        if ((entry->num_reports == 0u) || (rssi < entry->rssi_min)){
+            entry->rssi_min = rssi;
+        }
+        if ((entry->num_reports == 0u) || (rssi > entry->rssi_max)){
+            entry->rssi_max = rssi;
+        }
+        entry->rssi_last = rssi;
+        entry->rssi_sum += rssi;
+        entry->num_reports++;
+    }
+
+    // directed advertising without data only updates the statistics
+    bool changed = false;
+    if (part != 0u){
+        if (continuation == false){
+            gap_scan_cache_part_reset(entry, part);
+        }
+        gap_scan_cache_part_append(entry, part, data, data_len);
+        if (more_to_come){
+            entry->incomplete |= part;
+            return;
+        }
+        entry->incomplete &= ~part;
+        if ((entry->truncated & part) != 0u){
+            gap_scan_cache_part_trim(entry, part);
+        }
+        uint32_t data_hash = gap_scan_cache_data_hash(entry);
+        changed = data_hash != entry->data_hash;
+        entry->data_hash = data_hash;
+    }
+
+    if (entry->data_valid == false){
+        entry->data_valid = true;
+        if ((gap_scan_cache_policy & GAP_SCAN_CACHE_REPORT_NEW_DEVICE) != 0u){
+            gap_scan_cache_emit(GAP_SCAN_CACHE_REASON_NEW_DEVICE, entry);
+        }
+    } else if (changed && ((gap_scan_cache_policy & GAP_SCAN_CACHE_REPORT_ON_CHANGE) != 0u)){
+        gap_scan_cache_emit(GAP_SCAN_CACHE_REASON_CHANGED, entry);
+    }
+}
+
+static void gap_scan_cache_handle_advertising_report(const uint8_t * packet){
+    bd_addr_t address;
+    gap_event_advertising_report_get_address(packet, address);
+    uint8_t event_type = gap_event_advertising_report_get_advertising_event_type(packet);
+    uint8_t part;
+    switch (event_type){
+        case GAP_SCAN_CACHE_LEGACY_ADV_DIRECT_IND:
+            part = 0;
+            break;
+        case GAP_SCAN_CACHE_LEGACY_SCAN_RSP:
+            part = GAP_SCAN_CACHE_PART_SCAN_RESPONSE;
+            break;
+        default:
+            part = GAP_SCAN_CACHE_PART_ADVERTISING_DATA;
+            break;
+    }
+    gap_scan_cache_handle_report((bd_addr_type_t) gap_event_advertising_report_get_address_type(packet), address,
+                                 GAP_SCAN_CACHE_SID_NONE, gap_event_advertising_report_get_rssi(packet), part, false,
+                                 gap_event_advertising_report_get_data_length(packet),
+                                 gap_event_advertising_report_get_data(packet));
+}
+
+static void gap_scan_cache_handle_extended_advertising_report(const uint8_t * packet){
+    bd_addr_t address;
+    gap_event_extended_advertising_report_get_address(packet, address);
+    uint16_t event_type = gap_event_extended_advertising_report_get_advertising_event_type(packet);
+    uint8_t data_status = (event_type >> GAP_SCAN_CACHE_EXTENDED_DATA_STATUS_POS) & GAP_SCAN_CACHE_EXTENDED_DATA_STATUS_MASK;
+    uint8_t part;
+    if ((event_type & GAP_SCAN_CACHE_EXTENDED_SCAN_RESPONSE) != 0u){
+        part = GAP_SCAN_CACHE_PART_SCAN_RESPONSE;
+    } else if ((event_type & (GAP_SCAN_CACHE_EXTENDED_LEGACY | GAP_SCAN_CACHE_EXTENDED_DIRECTED)) == (GAP_SCAN_CACHE_EXTENDED_LEGACY | GAP_SCAN_CACHE_EXTENDED_DIRECTED)){
+        part = 0;
+    } else {
+        part = GAP_SCAN_CACHE_PART_ADVERTISING_DATA;
+    }
+    gap_scan_cache_handle_report((bd_addr_type_t) gap_event_extended_advertising_report_get_address_type(packet), address,
+                                 gap_event_extended_advertising_report_get_advertising_sid(packet),
+                                 gap_event_extended_advertising_report_get_rssi(packet), part,
+                                 data_status == GAP_SCAN_CACHE_DATA_STATUS_INCOMPLETE_MORE_TO_COME,
+                                 gap_event_extended_advertising_report_get_data_length(packet),
+                                 gap_event_extended_advertising_report_get_data(packet));
+}
+
+static void gap_scan_cache_hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case GAP_EVENT_ADVERTISING_REPORT:
+            gap_scan_cache_handle_advertising_report(packet);
+            break;
+        case GAP_EVENT_EXTENDED_ADVERTISING_REPORT:
+            gap_scan_cache_handle_extended_advertising_report(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void gap_scan_cache_timer_handler(btstack_timer_source_t * ts){
+    uint32_t period_start_ms = gap_scan_cache_period_start_ms;
+    gap_scan_cache_period_start_ms = btstack_run_loop_get_time_ms();
+    // LRU list is ordered by last seen
+    uint16_t index = gap_scan_cache_lru_head;
+    while (index != GAP_SCAN_CACHE_INVALID_INDEX){
+        gap_scan_cache_entry_t * entry = &gap_scan_cache_entries[index];
+        if ((int32_t) (entry->last_seen_ms - period_start_ms) < 0) break;
+        index = entry->lru_next;
+        if (entry->data_valid){
+            gap_scan_cache_emit(GAP_SCAN_CACHE_REASON_PERIODIC, entry);
+        }
+    }
+    btstack_run_loop_set_timer(ts, gap_scan_cache_period_ms);
+    btstack_run_loop_add_timer(ts);
+}
+
+static void gap_scan_cache_reset(void){
+    uint16_t i;
+    for (i = 0; i < GAP_SCAN_CACHE_NUM_BUCKETS; i++){
+        gap_scan_cache_buckets[i] = GAP_SCAN_CACHE_INVALID_INDEX;
+    }
+    gap_scan_cache_free_head = GAP_SCAN_CACHE_INVALID_INDEX;
+    for (i = gap_scan_cache_num_entries; i > 0u; i--){
+        gap_scan_cache_entries[i - 1u].hash_next = gap_scan_cache_free_head;
+        gap_scan_cache_free_head = i - 1u;
+    }
+    gap_scan_cache_lru_head = GAP_SCAN_CACHE_INVALID_INDEX;
+    gap_scan_cache_lru_tail = GAP_SCAN_CACHE_INVALID_INDEX;
+    gap_scan_cache_num_advertisers = 0;
+}
+
+void gap_scan_cache_init(gap_scan_cache_entry_t * entries, uint16_t num_entries){
+    btstack_assert(num_entries > 0u);
+    btstack_assert(num_entries < GAP_SCAN_CACHE_INVALID_INDEX);
+    gap_scan_cache_entries = entries;
+    gap_scan_cache_num_entries = num_entries;
+    gap_scan_cache_reset();
+    gap_scan_cache_policy = GAP_SCAN_CACHE_REPORT_NEW_DEVICE | GAP_SCAN_CACHE_REPORT_ON_CHANGE;
+    gap_scan_cache_period_ms = 0;
+    gap_scan_cache_hci_event_callback_registration.callback = &gap_scan_cache_hci_event_handler;
+    hci_add_event_handler(&gap_scan_cache_hci_event_callback_registration);
+}
+
+void gap_scan_cache_register_callback(gap_scan_cache_callback_t callback){
+    gap_scan_cache_callback = callback;
+}
+
+void gap_scan_cache_set_reporting_policy(uint8_t policy, uint32_t period_ms){
+    gap_scan_cache_policy = policy;
+    gap_scan_cache_period_ms = period_ms;
+    btstack_run_loop_remove_timer(&gap_scan_cache_timer);
+    if (((policy & GAP_SCAN_CACHE_REPORT_PERIODIC) != 0u) && (period_ms > 0u)){
+        gap_scan_cache_period_start_ms = btstack_run_loop_get_time_ms();
+        btstack_run_loop_set_timer_handler(&gap_scan_cache_timer, &gap_scan_cache_timer_handler);
+        btstack_run_loop_set_timer(&gap_scan_cache_timer, period_ms);
+        btstack_run_loop_add_timer(&gap_scan_cache_timer);
+    }
+}
+
+const gap_scan_cache_entry_t * gap_scan_cache_lookup(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid){
+    uint16_t index = gap_scan_cache_find(address_type, address, advertising_sid);
+    if (index == GAP_SCAN_CACHE_INVALID_INDEX){
+        return NULL;
+    }
+    return &gap_scan_cache_entries[index];
+}
+
+int8_t gap_scan_cache_entry_get_rssi_average(const gap_scan_cache_entry_t * entry){
+    if (entry->num_reports == 0u){
+        return GAP_SCAN_CACHE_RSSI_NOT_AVAILABLE;
+    }
+    return (int8_t) (entry->rssi_sum / (int32_t) entry->num_reports);
+}
+
+uint16_t gap_scan_cache_get_num_advertisers(void){
+    return gap_scan_cache_num_advertisers;
+}
+
+void gap_scan_cache_clear(void){
+    if (gap_scan_cache_entries == NULL) return;
+    gap_scan_cache_reset();
+}
+
+void gap_scan_cache_deinit(void){
+    hci_remove_event_handler(&gap_scan_cache_hci_event_callback_registration);
+    btstack_run_loop_remove_timer(&gap_scan_cache_timer);
+    gap_scan_cache_entries = NULL;
+    gap_scan_cache_num_entries = 0;
+    gap_scan_cache_num_advertisers = 0;
+    gap_scan_cache_callback = NULL;
+}
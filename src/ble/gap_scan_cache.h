@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title GAP Scan Cache
+ *
+ * Aggregates LE Advertising Reports per advertiser and reports them according to a configurable policy
+ */
+
+#ifndef GAP_SCAN_CACHE_H
+#define GAP_SCAN_CACHE_H
+
+#include "btstack_config.h"
+#include "btstack_bool.h"
+#include "bluetooth.h"
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Max size of merged Advertising and Scan Response Data stored per advertiser, longer data is truncated
+#ifndef GAP_SCAN_CACHE_MAX_DATA_LEN
+#define GAP_SCAN_CACHE_MAX_DATA_LEN 62
+#endif
+
+// Number of hash buckets used for lookup by address, must be a power of two
+#ifndef GAP_SCAN_CACHE_NUM_BUCKETS
+#define GAP_SCAN_CACHE_NUM_BUCKETS 64
+#endif
+
+// Advertising SID used for legacy advertising
+#define GAP_SCAN_CACHE_SID_NONE 0xff
+
+/* API_START */
+
+// Reporting policy flags
+#define GAP_SCAN_CACHE_REPORT_NEW_DEVICE  0x01u
+#define GAP_SCAN_CACHE_REPORT_ON_CHANGE   0x02u
+#define GAP_SCAN_CACHE_REPORT_PERIODIC    0x04u
+
+typedef enum {
+    GAP_SCAN_CACHE_REASON_NEW_DEVICE = 0,
+    GAP_SCAN_CACHE_REASON_CHANGED,
+    GAP_SCAN_CACHE_REASON_PERIODIC,
+} gap_scan_cache_reason_t;
+
+typedef struct {
+    // key
+    bd_addr_t      address;
+    bd_addr_type_t address_type;
+    uint8_t        advertising_sid;
+
+    // merged payload: Advertising Data followed by Scan Response Data
+    uint16_t advertising_data_len;
+    uint16_t scan_response_data_len;
+    uint8_t  data[GAP_SCAN_CACHE_MAX_DATA_LEN];
+
+    // statistics
+    int8_t   rssi_last;
+    int8_t   rssi_min;
+    int8_t   rssi_max;
+    int32_t  rssi_sum;
+    uint32_t num_reports;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+
+    // internal
+    uint32_t data_hash;
+    uint16_t hash_next;
+    uint16_t lru_prev;
+    uint16_t lru_next;
+    uint8_t  incomplete;
+    uint8_t  truncated;
+    bool     data_valid;
+} gap_scan_cache_entry_t;
+
+/**
+ * @brief Callback for aggregated advertising reports
+ * @param reason
+ * @param entry valid until the callback returns
+ */
+typedef void (*gap_scan_cache_callback_t)(gap_scan_cache_reason_t reason, const gap_scan_cache_entry_t * entry);
+
+/**
+ * @brief Init scan cache and register for Advertising Reports. If all entries are in use, the least recently seen
+ *        advertiser is evicted.
+ * @param entries storage provided by application
+ * @param num_entries
+ */
+void gap_scan_cache_init(gap_scan_cache_entry_t * entries, uint16_t num_entries);
+
+/**
+ * @brief Register callback for aggregated advertising reports
+ * @param callback
+ */
+void gap_scan_cache_register_callback(gap_scan_cache_callback_t callback);
+
+/**
+ * @brief Set reporting policy
+ * @param policy GAP_SCAN_CACHE_REPORT_x flags, default: GAP_SCAN_CACHE_REPORT_NEW_DEVICE | GAP_SCAN_CACHE_REPORT_ON_CHANGE
+ * @param period_ms for GAP_SCAN_CACHE_REPORT_PERIODIC: all advertisers seen since the last period are reported
+ */
+void gap_scan_cache_set_reporting_policy(uint8_t policy, uint32_t period_ms);
+
+/**
+ * @brief Lookup advertiser
+ * @param address_type
+ * @param address
+ * @param advertising_sid or GAP_SCAN_CACHE_SID_NONE for legacy advertising
+ * @return entry or NULL if not found
+ */
+const gap_scan_cache_entry_t * gap_scan_cache_lookup(bd_addr_type_t address_type, const bd_addr_t address, uint8_t advertising_sid);
+
+/**
+ * @brief Get average RSSI of all reports for this advertiser
+ * @param entry
+ * @return rssi
+ */
+int8_t gap_scan_cache_entry_get_rssi_average(const gap_scan_cache_entry_t * entry);
+
+/**
+ * @brief Get number of cached advertisers
+ * @return num advertisers
+ */
+uint16_t gap_scan_cache_get_num_advertisers(void);
+
+/**
+ * @brief Remove all advertisers
+ */
+void gap_scan_cache_clear(void);
+
+/**
+ * @brief De-Init scan cache
+ */
+void gap_scan_cache_deinit(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // GAP_SCAN_CACHE_H
@@ -56,16 +56,22 @@
 #include "gap.h"
 
 #define DEVICE_INFORMATION_MAX_STRING_LEN 32
+#define DEVICE_INFORMATION_NUM_CHARACTERISTICS 10
+
+// With a smaller MTU, characteristic discovery takes several requests and most values do not fit into the
+// Read Multiple Variable Response, reading each value by UUID is faster then
+#ifndef DEVICE_INFORMATION_SERVICE_CLIENT_READ_MULTIPLE_MIN_MTU
+#define DEVICE_INFORMATION_SERVICE_CLIENT_READ_MULTIPLE_MIN_MTU 100
+#endif
 
 
 typedef enum {
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_IDLE,
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_SERVICE,
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_SERVICE_RESULT,
-#ifdef ENABLE_TESTING_SUPPORT
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_CHARACTERISTICS,
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_RESULT,
-#endif
+    DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUES,
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC,
     DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUE
 } device_information_service_client_state_t;
@@ -80,8 +86,16 @@ typedef struct {
     uint16_t end_handle;
     uint8_t  num_instances;
 
-    // index of next characteristic to query
+    // index of next characteristic to query if values are read by UUID
     uint8_t characteristic_index;
+
+    // value handles of discovered characteristics, indexed like device_information_characteristics
+    uint16_t value_handles[DEVICE_INFORMATION_NUM_CHARACTERISTICS];
+
+    // values are read with coalesced reads, i.e. Read Multiple Variable Requests if supported
+    gatt_client_coalesced_read_t reads[DEVICE_INFORMATION_NUM_CHARACTERISTICS];
+    uint8_t num_reads;
+    uint8_t num_reads_completed;
 } device_information_service_client_t;
 
 
@@ -101,7 +115,7 @@ static const struct device_information_characteristic {
     uint16_t uuid;
     uint8_t  subevent;
     void (*handle_value)(device_information_service_client_t * client, uint8_t subevent, uint8_t att_status, const uint8_t * value, uint16_t value_len);    
-} device_information_characteristics[] = {
+} device_information_characteristics[DEVICE_INFORMATION_NUM_CHARACTERISTICS] = {
     {ORG_BLUETOOTH_CHARACTERISTIC_MANUFACTURER_NAME_STRING, GATTSERVICE_SUBEVENT_DEVICE_INFORMATION_MANUFACTURER_NAME, device_information_service_emit_string_value},
     {ORG_BLUETOOTH_CHARACTERISTIC_MODEL_NUMBER_STRING, GATTSERVICE_SUBEVENT_DEVICE_INFORMATION_MODEL_NUMBER, device_information_service_emit_string_value},
     {ORG_BLUETOOTH_CHARACTERISTIC_SERIAL_NUMBER_STRING, GATTSERVICE_SUBEVENT_DEVICE_INFORMATION_SERIAL_NUMBER, device_information_service_emit_string_value},
@@ -126,36 +140,36 @@ static uint8_t device_informatiom_client_request_send_gatt_query(device_informat
     return status;
 }
 
-#ifdef ENABLE_TESTING_SUPPORT
-static struct device_information_characteristic_handles{
-    uint16_t uuid;
-    uint16_t value_handle;
-} device_information_characteristic_handles[] = {
-    {ORG_BLUETOOTH_CHARACTERISTIC_MANUFACTURER_NAME_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_MODEL_NUMBER_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_SERIAL_NUMBER_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_HARDWARE_REVISION_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_FIRMWARE_REVISION_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_SOFTWARE_REVISION_STRING, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_SYSTEM_ID, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_IEEE_11073_20601_REGULATORY_CERTIFICATION_DATA_LIST, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_PNP_ID, 0},
-    {ORG_BLUETOOTH_CHARACTERISTIC_UDI_FOR_MEDICAL_DEVICES, 0}
-};
 
-static void device_information_service_update_handle_for_uuid(uint16_t uuid, uint16_t value_handle){
+
+static int device_information_service_get_characteristic_index_for_uuid(uint16_t uuid){
     uint8_t i;
-    for (i = 0; i < 9; i++){
-        if (device_information_characteristic_handles[i].uuid == uuid){
-            device_information_characteristic_handles[i].value_handle = value_handle;
-            return;
+    for (i = 0; i < DEVICE_INFORMATION_NUM_CHARACTERISTICS; i++){
+        if (device_information_characteristics[i].uuid == uuid){
+            return i;
         }
     }
+    return -1;
 }
-#endif
 
+static int device_information_service_get_characteristic_index_for_value_handle(device_information_service_client_t * client, uint16_t value_handle){
+    uint8_t i;
+    for (i = 0; i < DEVICE_INFORMATION_NUM_CHARACTERISTICS; i++){
+        if ((client->value_handles[i] != 0u) && (client->value_handles[i] == value_handle)){
+            return i;
+        }
+    }
+    return -1;
+}
 
-static const uint8_t num_information_fields = sizeof(device_information_characteristics)/sizeof(struct device_information_characteristic);
+// values truncated in Read Multiple Variable Response are read again by GATT Client
+static bool device_information_service_use_read_multiple(device_information_service_client_t * client){
+    uint16_t mtu;
+    if (gatt_client_get_mtu(client->con_handle, &mtu) != ERROR_CODE_SUCCESS){
+        return false;
+    }
+    return mtu >= DEVICE_INFORMATION_SERVICE_CLIENT_READ_MULTIPLE_MIN_MTU;
+}
 
 #ifdef ENABLE_TESTING_SUPPORT
 static char * device_information_characteristic_name(uint16_t uuid){
@@ -213,6 +227,10 @@ static void device_information_service_finalize_client(device_information_servic
     client->num_instances = 0;
     client->start_handle = 0;
     client->end_handle = 0;
+    client->characteristic_index = 0;
+    client->num_reads = 0;
+    client->num_reads_completed = 0;
+    memset(client->value_handles, 0, sizeof(client->value_handles));
 }
 
 static void device_information_service_emit_query_done_and_finalize_client(device_information_service_client_t * client, uint8_t status){
@@ -332,6 +350,7 @@ static void device_information_service_send_next_query(void * context){
     }
 
     uint8_t att_status;
+    gatt_client_service_t service;
 
     switch (client->state){
         case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_SERVICE:
@@ -340,30 +359,22 @@ static void device_information_service_send_next_query(void * context){
             // TODO handle status
             UNUSED(att_status);
             break;
-#ifdef ENABLE_TESTING_SUPPORT   
         case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_CHARACTERISTICS:
             client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_RESULT;
-            gatt_client_discover_characteristics_for_handle_range_by_uuid16(
-                &handle_gatt_client_event, 
-                client->con_handle, client->start_handle, client->end_handle,
-                device_information_characteristics[client->characteristic_index].uuid);
+            memset(&service, 0, sizeof(service));
+            service.start_group_handle = client->start_handle;
+            service.end_group_handle = client->end_handle;
+            att_status = gatt_client_discover_characteristics_for_service(&handle_gatt_client_event, client->con_handle, &service);
+            // TODO handle status
+            UNUSED(att_status);
             break;
-#endif
 
         case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC:
             client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUE;
- 
-#ifdef ENABLE_TESTING_SUPPORT  
-            att_status = gatt_client_read_value_of_characteristic_using_value_handle(
-                handle_gatt_client_event, 
-                client->con_handle, 
-                device_information_characteristic_handles[client->characteristic_index].value_handle);
-#else            
             att_status = gatt_client_read_value_of_characteristics_by_uuid16(
-                handle_gatt_client_event, 
-                client->con_handle, client->start_handle, client->end_handle, 
+                &handle_gatt_client_event,
+                client->con_handle, client->start_handle, client->end_handle,
                 device_information_characteristics[client->characteristic_index].uuid);
-#endif 
             // TODO handle status
             UNUSED(att_status);
             break;
@@ -373,6 +384,22 @@ static void device_information_service_send_next_query(void * context){
     }
 }
 
+static void device_information_service_read_characteristic_values(device_information_service_client_t * client){
+    uint8_t i;
+    client->num_reads = 0;
+    client->num_reads_completed = 0;
+    for (i = 0; i < DEVICE_INFORMATION_NUM_CHARACTERISTICS; i++){
+        if (client->value_handles[i] == 0u){
+            continue;
+        }
+        uint8_t status = gatt_client_read_value_of_characteristic_coalesced(&client->reads[client->num_reads],
+            &handle_gatt_client_event, client->con_handle, client->value_handles[i]);
+        if (status == ERROR_CODE_SUCCESS){
+            client->num_reads++;
+        }
+    }
+}
+
 static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(packet_type); 
     UNUSED(channel);     
@@ -381,10 +408,9 @@ static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint
     uint8_t att_status;
     device_information_service_client_t * client = NULL;
     gatt_client_service_t service;
-    bool trigger_next_query = false;
-#ifdef ENABLE_TESTING_SUPPORT
     gatt_client_characteristic_t characteristic;
-#endif
+    bool trigger_next_query = false;
+    int index;
 
     switch(hci_event_packet_get_type(packet)){
         
@@ -396,7 +422,6 @@ static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint
             client->start_handle = service.start_group_handle;
             client->end_handle = service.end_group_handle;
 
-            client->characteristic_index = 0;
             if (client->start_handle < client->end_handle){
                 client->num_instances++;
             }
@@ -405,27 +430,40 @@ static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint
 #endif
             break;
 
-#ifdef ENABLE_TESTING_SUPPORT
         case GATT_EVENT_CHARACTERISTIC_QUERY_RESULT:
             client = device_information_service_get_client_for_con_handle(gatt_event_characteristic_query_result_get_handle(packet));
             btstack_assert(client != NULL);
             gatt_event_characteristic_query_result_get_characteristic(packet, &characteristic);
 
-            device_information_service_update_handle_for_uuid(characteristic.uuid16, characteristic.value_handle);
+            index = device_information_service_get_characteristic_index_for_uuid(characteristic.uuid16);
+            if (index < 0){
+                break;
+            }
+            client->value_handles[index] = characteristic.value_handle;
+#ifdef ENABLE_TESTING_SUPPORT
             printf("Device Information Characteristic %s:  \n    Attribute Handle 0x%04X, Properties 0x%02X, Handle 0x%04X, UUID 0x%04X\n", 
                 device_information_characteristic_name(characteristic.uuid16),
                 characteristic.start_handle, 
                 characteristic.properties, 
                 characteristic.value_handle, characteristic.uuid16);
-            break;
 #endif
+            break;
+
         case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
             client = device_information_service_get_client_for_con_handle(gatt_event_characteristic_value_query_result_get_handle(packet));
             btstack_assert(client != NULL);
 
-
-            (device_information_characteristics[client->characteristic_index].handle_value(
-                client, device_information_characteristics[client->characteristic_index].subevent, 
+            if (client->state == DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUE){
+                index = client->characteristic_index;
+            } else {
+                index = device_information_service_get_characteristic_index_for_value_handle(client,
+                    gatt_event_characteristic_value_query_result_get_value_handle(packet));
+            }
+            if (index < 0){
+                break;
+            }
+            (device_information_characteristics[index].handle_value(
+                client, device_information_characteristics[index].subevent, 
                 ATT_ERROR_SUCCESS,
                 gatt_event_characteristic_value_query_result_get_value(packet), 
                 gatt_event_characteristic_value_query_result_get_value_length(packet)));
@@ -447,38 +485,49 @@ static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint
                         device_information_service_emit_query_done_and_finalize_client(client, ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE); 
                         return;   
                     }
-                    client->characteristic_index = 0;
 
-#ifdef ENABLE_TESTING_SUPPORT   
-                    client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_CHARACTERISTICS;
-#else 
-                    client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC;
-#endif
+                    // discover characteristics and read all values with Read Multiple Variable if the MTU is large
+                    // enough, otherwise read one value by UUID after the other
+                    if (device_information_service_use_read_multiple(client)){
+                        client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_CHARACTERISTICS;
+                    } else {
+                        client->characteristic_index = 0;
+                        client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC;
+                    }
                     trigger_next_query = true;
                     break;
  
-#ifdef ENABLE_TESTING_SUPPORT   
-                    case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_RESULT:
-                        // check if there is another characteristic to query
-                        if ((client->characteristic_index + 1) < num_information_fields){
-                            client->characteristic_index++;
-                            client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_QUERY_CHARACTERISTICS;
-                            trigger_next_query = true;
-                            break;
-                        } 
-                        client->characteristic_index = 0;
-                        client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC;
-                        trigger_next_query = true;
+                case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_RESULT:
+                    if (att_status != ATT_ERROR_SUCCESS){
+                        device_information_service_emit_query_done_and_finalize_client(client, att_status);
+                        return;
+                    }
+                    // read all values at once, reads get combined into as few requests as possible
+                    client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUES;
+                    device_information_service_read_characteristic_values(client);
+                    if (client->num_reads == 0u){
+                        device_information_service_emit_query_done_and_finalize_client(client, ERROR_CODE_SUCCESS);
+                    }
+                    return;
+
+                case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUES:
+                    // errors for individual characteristics are not reported
+                    client->num_reads_completed++;
+                    if (client->num_reads_completed < client->num_reads){
                         break;
-#endif                
+                    }
+                    // we are done with quering all characteristics
+                    device_information_service_emit_query_done_and_finalize_client(client, ERROR_CODE_SUCCESS);
+                    return;
+
                 case DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W4_CHARACTERISTIC_VALUE:
                     // check if there is another characteristic to query
-                    if ((client->characteristic_index + 1u) < num_information_fields){
+                    if ((client->characteristic_index + 1u) < DEVICE_INFORMATION_NUM_CHARACTERISTICS){
                         client->characteristic_index++;
                         client->state = DEVICE_INFORMATION_SERVICE_CLIENT_STATE_W2_READ_VALUE_OF_CHARACTERISTIC;
                         trigger_next_query = true;
                         break;
-                    } 
+                    }
                     // we are done with quering all characteristics
                     device_information_service_emit_query_done_and_finalize_client(client, ERROR_CODE_SUCCESS);
                     return;
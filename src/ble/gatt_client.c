@@ -71,11 +71,48 @@
 // L2CAP Test Spec p35 defines a minimum of 100 ms, but PTS might indicate an error if we sent after 100 ms
 #define GATT_CLIENT_COLLISION_BACKOFF_MS 150
 
+// Size of RAM buffer and TLV value for the Discovery Cache of the last used bonded device
+#ifndef GATT_CLIENT_DISCOVERY_CACHE_SIZE
+#define GATT_CLIENT_DISCOVERY_CACHE_SIZE 1024
+#endif
+
+// Number of hash buckets for characteristic value listeners with con_handle and value handle, power of two
+#ifndef GATT_CLIENT_VALUE_LISTENER_HASH_SIZE
+#define GATT_CLIENT_VALUE_LISTENER_HASH_SIZE 16
+#endif
+
+#if (GATT_CLIENT_VALUE_LISTENER_HASH_SIZE == 0) || ((GATT_CLIENT_VALUE_LISTENER_HASH_SIZE & (GATT_CLIENT_VALUE_LISTENER_HASH_SIZE - 1)) != 0)
+#error "GATT_CLIENT_VALUE_LISTENER_HASH_SIZE must be a power of two"
+#endif
+
+// GATT_EVENT_NOTIFICATION_BATCH: event type (1), len (1), handle (2), num notifications (1), notifications length (2)
+#define GATT_CLIENT_NOTIFICATION_BATCH_HEADER_SIZE 7
+#define GATT_CLIENT_NOTIFICATION_BATCH_ITEM_HEADER_SIZE 4
+
 static btstack_linked_list_t gatt_client_connections;
+// value listeners with wildcard for con_handle or value handle
 static btstack_linked_list_t gatt_client_value_listeners;
+// value listeners for a single characteristic, indexed by con_handle and value handle
+static btstack_linked_list_t gatt_client_value_listener_buckets[GATT_CLIENT_VALUE_LISTENER_HASH_SIZE];
+static btstack_linked_list_t gatt_client_notification_batches;
+static btstack_context_callback_registration_t gatt_client_notification_batch_flush_request;
+static bool                  gatt_client_notification_batch_flush_scheduled;
 static btstack_linked_list_t gatt_client_service_value_listeners;
 #ifdef ENABLE_GATT_CLIENT_CACHING
 static btstack_linked_list_t gatt_client_caching_service_changed_handler;
+// Discovery Cache
+static int             gatt_client_discovery_cache_le_device_db_index;
+static uint16_t        gatt_client_discovery_cache_len;
+static uint8_t         gatt_client_discovery_cache_data[GATT_CLIENT_DISCOVERY_CACHE_SIZE];
+static gatt_client_t * gatt_client_discovery_cache_recording_client;
+static uint16_t        gatt_client_discovery_cache_recording_offset;
+static uint16_t        gatt_client_discovery_cache_recording_start_handle;
+static uint16_t        gatt_client_discovery_cache_recording_end_handle;
+static bool            gatt_client_discovery_cache_recording_overflow;
+static bool            gatt_client_discovery_cache_emitting;
+// recorded results are stored in TLV once the connection is closed or the cache is used for another device
+static bool             gatt_client_discovery_cache_store_pending;
+static hci_con_handle_t gatt_client_discovery_cache_store_con_handle;
 #endif
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
@@ -95,12 +132,25 @@ static void gatt_client_notify_can_send_query(gatt_client_t * gatt_client);
 static void gatt_client_read_value_of_characteristics_by_uuid16_internal(gatt_client_t * gatt_client,
     btstack_packet_handler_t callback, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16);
 static void gatt_client_report_error_if_pending(gatt_client_t *gatt_client, uint8_t att_error_code);
+static void gatt_client_coalesced_reads_abort(gatt_client_t * gatt_client, uint8_t att_status);
 static void gatt_client_write_value_of_characteristic_internal(gatt_client_t * gatt_client, btstack_packet_handler_t callback,
     uint16_t value_handle, uint16_t value_length, uint8_t * value, uint16_t service_id, uint16_t connection_id);
 static uint8_t gatt_client_write_client_characteristic_configuration_internal(gatt_client_t * gatt_client,
     btstack_packet_handler_t callback, gatt_client_characteristic_t * characteristic, uint16_t configuration,
     uint16_t service_id, uint16_t connection_id);
 
+#ifdef ENABLE_GATT_CLIENT_CACHING
+static void gatt_client_discovery_cache_delete(int le_device_db_index);
+static void gatt_client_discovery_cache_record_service(const gatt_client_t * gatt_client, uint16_t start_group_handle,
+    uint16_t end_group_handle, const uint8_t * uuid128);
+static void gatt_client_discovery_cache_record_characteristic(const gatt_client_t * gatt_client, uint16_t start_handle,
+    uint16_t value_handle, uint16_t end_handle, uint16_t properties, const uint8_t * uuid128);
+static void gatt_client_discovery_cache_record_descriptor(const gatt_client_t * gatt_client, uint16_t descriptor_handle,
+    const uint8_t * uuid128);
+static void gatt_client_discovery_cache_record_finish(gatt_client_t * gatt_client, uint8_t att_status);
+static void gatt_client_discovery_cache_emit_results(gatt_client_t * gatt_client);
+#endif
+
 #ifdef ENABLE_LE_SIGNED_WRITE
 static void att_signed_write_handle_cmac_result(uint8_t hash[8]);
 #endif
@@ -115,15 +165,24 @@ static void gatt_client_classic_retry(btstack_timer_source_t * ts);
 #ifdef ENABLE_GATT_OVER_EATT
 static bool gatt_client_eatt_enabled;
 static bool gatt_client_le_enhanced_handle_can_send_query(gatt_client_t * gatt_client);
+static uint8_t gatt_client_le_enhanced_num_eatt_clients_in_state(gatt_client_t * gatt_client, gatt_client_state_t state);
 static void gatt_client_le_enhanced_retry(btstack_timer_source_t * ts);
 #endif
 
 void gatt_client_init(void){
     gatt_client_connections = NULL;
     gatt_client_value_listeners = NULL;
+    memset(gatt_client_value_listener_buckets, 0, sizeof(gatt_client_value_listener_buckets));
     gatt_client_service_value_listeners = NULL;
+    gatt_client_notification_batches = NULL;
+    gatt_client_notification_batch_flush_scheduled = false;
 #ifdef ENABLE_GATT_CLIENT_CACHING
     gatt_client_caching_service_changed_handler = NULL;
+    gatt_client_discovery_cache_le_device_db_index = -1;
+    gatt_client_discovery_cache_len = 0;
+    gatt_client_discovery_cache_recording_client = NULL;
+    gatt_client_discovery_cache_emitting = false;
+    gatt_client_discovery_cache_store_pending = false;
 #endif
     // default configuration
     gatt_client_mtu_exchange_enabled    = true;
@@ -314,6 +373,9 @@ static uint8_t gatt_client_provide_context_for_request(hci_con_handle_t con_hand
         if (eatt_client == NULL){
             return ERROR_CODE_COMMAND_DISALLOWED;
         }
+        // round-robin: next request starts search with the following bearer
+        btstack_linked_list_remove(&gatt_client->eatt_clients, (btstack_linked_item_t *) eatt_client);
+        btstack_linked_list_add_tail(&gatt_client->eatt_clients, (btstack_linked_item_t *) eatt_client);
         gatt_client = eatt_client;
     }
 #endif
@@ -502,12 +564,10 @@ att_read_multiple_request(gatt_client_t *gatt_client, uint16_t num_value_handles
     return att_read_multiple_request_with_opcode(gatt_client, num_value_handles, value_handles, ATT_READ_MULTIPLE_REQUEST);
 }
 
-#ifdef ENABLE_GATT_OVER_EATT
 static uint8_t
 att_read_multiple_variable_request(gatt_client_t *gatt_client, uint16_t num_value_handles, uint16_t *value_handles) {
     return att_read_multiple_request_with_opcode(gatt_client, num_value_handles, value_handles, ATT_READ_MULTIPLE_VARIABLE_REQ);
 }
-#endif
 
 #ifdef ENABLE_LE_SIGNED_WRITE
 // precondition: can_send_packet_now == TRUE
@@ -657,11 +717,9 @@ static void send_gatt_read_multiple_request(gatt_client_t * gatt_client){
     att_read_multiple_request(gatt_client, gatt_client->read_multiple_handle_count, gatt_client->read_multiple_handles);
 }
 
-#ifdef ENABLE_GATT_OVER_EATT
 static void send_gatt_read_multiple_variable_request(gatt_client_t * gatt_client){
     att_read_multiple_variable_request(gatt_client, gatt_client->read_multiple_handle_count, gatt_client->read_multiple_handles);
 }
-#endif
 
 static void send_gatt_write_attribute_value_request(gatt_client_t * gatt_client){
     att_write_request(gatt_client, ATT_WRITE_REQUEST, gatt_client->attribute_handle, gatt_client->attribute_length,
@@ -895,7 +953,9 @@ static void gatt_client_caching_handle_database_hash(gatt_client_t * gatt_client
                 }
             }
             if (update_entry) {
-                // database hash changed, update entry in tlv
+                // database hash changed, cached discovery results are stale
+                gatt_client_discovery_cache_delete(le_device_db_index);
+                // update entry in tlv
                 database_version++;
                 entry.database_version = database_version;
                 memcpy(entry.database_hash, database_hash, 16);
@@ -915,6 +975,7 @@ static void gatt_client_caching_delete_database_hash(int le_device_db_index) {
         uint32_t tag = gatt_client_caching_database_hash_tag_for_index((uint8_t) le_device_db_index);
         tlv_impl->delete_tag(tlv_context, tag);
     }
+    gatt_client_discovery_cache_delete(le_device_db_index);
 }
 
 static void gatt_client_caching_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
@@ -1060,20 +1121,21 @@ static bool gatt_client_caching_handle_can_send_query(gatt_client_t * gatt_clien
 static void gatt_client_notify_can_send_query(gatt_client_t * gatt_client){
 
 #ifdef ENABLE_GATT_OVER_EATT
-    // if eatt is ready, notify all clients that can send a query
+    // query requests are queued in the context of the connection, also serve them when an EATT bearer becomes ready
+    if (gatt_client->bearer_type == ATT_BEARER_ENHANCED_LE){
+        gatt_client = gatt_client_get_context_for_handle(gatt_client->con_handle);
+        if (gatt_client == NULL){
+            return;
+        }
+    }
+    // if eatt is ready, notify query requests while any bearer is ready
     if (gatt_client->eatt_state == GATT_CLIENT_EATT_READY){
-        btstack_linked_list_iterator_t it;
-        btstack_linked_list_iterator_init(&it, &gatt_client->eatt_clients);
-        while (btstack_linked_list_iterator_has_next(&it)){
-            gatt_client_t * client = (gatt_client_t *) btstack_linked_list_iterator_next(&it);
-            if (client->state == P_READY){
-                // call callback
-                btstack_context_callback_registration_t * callback = (btstack_context_callback_registration_t *) btstack_linked_list_pop(&gatt_client->query_requests);
-                if (callback == NULL) {
-                    return;
-                }
-                (*callback->callback)(callback->context);
+        while (gatt_client_le_enhanced_num_eatt_clients_in_state(gatt_client, P_READY) > 0u){
+            btstack_context_callback_registration_t * callback = (btstack_context_callback_registration_t *) btstack_linked_list_pop(&gatt_client->query_requests);
+            if (callback == NULL) {
+                return;
             }
+            (*callback->callback)(callback->context);
         }
         return;
     }
@@ -1104,6 +1166,8 @@ static void gatt_client_notify_can_send_query(gatt_client_t * gatt_client){
             if (query_sent){
                 continue;
             }
+            // keep query requests until EATT bearers are ready
+            return;
         }
 #endif
         btstack_context_callback_registration_t * callback = (btstack_context_callback_registration_t *) btstack_linked_list_pop(&gatt_client->query_requests);
@@ -1156,6 +1220,9 @@ static void emit_gatt_service_query_result_event(gatt_client_t * gatt_client, ui
     hci_event_builder_add_16(&context, start_group_handle);
     hci_event_builder_add_16(&context, end_group_handle);
     hci_event_builder_add_128(&context, uuid128);
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    gatt_client_discovery_cache_record_service(gatt_client, start_group_handle, end_group_handle, uuid128);
+#endif
     emit_event_new(gatt_client->callback, packet, hci_event_builder_get_length(&context));
 }
 
@@ -1188,6 +1255,9 @@ static void emit_gatt_characteristic_query_result_event(gatt_client_t * gatt_cli
     hci_event_builder_add_16(&context, end_handle);
     hci_event_builder_add_16(&context, properties);
     hci_event_builder_add_128(&context, uuid128);
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    gatt_client_discovery_cache_record_characteristic(gatt_client, start_handle, value_handle, end_handle, properties, uuid128);
+#endif
     emit_event_new(gatt_client->callback, packet, hci_event_builder_get_length(&context));
 }
 
@@ -1202,6 +1272,9 @@ static void emit_gatt_all_characteristic_descriptors_result_event(
     hci_event_builder_add_16(&context, gatt_client->connection_id);
     hci_event_builder_add_16(&context, descriptor_handle);
     hci_event_builder_add_128(&context, uuid128);
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    gatt_client_discovery_cache_record_descriptor(gatt_client, descriptor_handle, uuid128);
+#endif
     emit_event_new(gatt_client->callback, packet, hci_event_builder_get_length(&context));
 }
 
@@ -1218,6 +1291,9 @@ static void emit_gatt_mtu_exchanged_result_event(gatt_client_t * gatt_client, ui
 
 // helper
 static void gatt_client_handle_transaction_complete(gatt_client_t *gatt_client, uint8_t att_status) {
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    gatt_client_discovery_cache_record_finish(gatt_client, att_status);
+#endif
     gatt_client->state = P_READY;
     gatt_client_timeout_stop(gatt_client);
     emit_gatt_complete_event(gatt_client, att_status);
@@ -1393,12 +1469,33 @@ static void report_gatt_included_service_uuid128(gatt_client_t * gatt_client, ui
                                                   gatt_client->query_end_handle, uuid128);
 }
 
+static btstack_linked_list_t * gatt_client_value_listener_list(hci_con_handle_t con_handle, uint16_t value_handle){
+    if ((con_handle == GATT_CLIENT_ANY_CONNECTION) || (value_handle == GATT_CLIENT_ANY_VALUE_HANDLE)){
+        return &gatt_client_value_listeners;
+    }
+    // multiplicative hash, use upper bits of lower half
+    uint32_t key  = (((uint32_t) con_handle) << 16) | value_handle;
+    uint32_t hash = (key * 0x9E3779B1u) >> 16;
+    return &gatt_client_value_listener_buckets[hash & (GATT_CLIENT_VALUE_LISTENER_HASH_SIZE - 1u)];
+}
+
 static void report_gatt_characteristic_value_change(gatt_client_t *gatt_client, uint8_t event_type, uint16_t value_handle, uint8_t *value, int length) {
     uint8_t * packet;
 
     // Single Characteristic listener, setup packet with service + connection id = 0
     packet = setup_characteristic_value_packet(gatt_client, event_type, value_handle, value, length, 0, 0);
     btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, gatt_client_value_listener_list(gatt_client->con_handle, value_handle));
+    while (btstack_linked_list_iterator_has_next(&it)) {
+        gatt_client_notification_t *notification = (gatt_client_notification_t *) btstack_linked_list_iterator_next(&it);
+        // bucket is shared with other characteristics
+        if ((notification->con_handle != gatt_client->con_handle) || (notification->attribute_handle != value_handle)){
+            continue;
+        }
+        (*notification->callback)(HCI_EVENT_PACKET, 0, packet, CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE + length);
+    }
+
+    // Listeners with wildcards
     btstack_linked_list_iterator_init(&it, &gatt_client_value_listeners);
     while (btstack_linked_list_iterator_has_next(&it)) {
         gatt_client_notification_t *notification = (gatt_client_notification_t *) btstack_linked_list_iterator_next(&it);
@@ -1431,11 +1528,97 @@ static void report_gatt_characteristic_value_change(gatt_client_t *gatt_client,
     }
 }
 
+static void gatt_client_notification_batch_emit(gatt_client_notification_batch_t * batch){
+    if (batch->num_notifications == 0u){
+        return;
+    }
+    uint8_t * event = batch->buffer;
+    uint16_t event_size = batch->buffer_len;
+    event[0] = GATT_EVENT_NOTIFICATION_BATCH;
+    event[1] = (uint8_t) (event_size - 2u);
+    little_endian_store_16(event, 2, batch->con_handle);
+    event[4] = batch->num_notifications;
+    little_endian_store_16(event, 5, event_size - GATT_CLIENT_NOTIFICATION_BATCH_HEADER_SIZE);
+    // reset before callback, event stays valid until next notification is added
+    batch->buffer_len = GATT_CLIENT_NOTIFICATION_BATCH_HEADER_SIZE;
+    batch->num_notifications = 0;
+    (*batch->callback)(HCI_EVENT_PACKET, 0, event, event_size);
+}
+
+static void gatt_client_notification_batch_handle_flush_request(void * context){
+    UNUSED(context);
+    gatt_client_notification_batch_flush_scheduled = false;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &gatt_client_notification_batches);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        gatt_client_notification_batch_t * batch = (gatt_client_notification_batch_t *) btstack_linked_list_iterator_next(&it);
+        gatt_client_notification_batch_emit(batch);
+    }
+}
+
+static void gatt_client_notification_batch_flush_for_handle(hci_con_handle_t con_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &gatt_client_notification_batches);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        gatt_client_notification_batch_t * batch = (gatt_client_notification_batch_t *) btstack_linked_list_iterator_next(&it);
+        if (batch->con_handle == con_handle){
+            gatt_client_notification_batch_emit(batch);
+        }
+    }
+}
+
+// @return true if notification was added to batch
+static bool gatt_client_notification_batch_add(gatt_client_notification_batch_t * batch, uint16_t value_handle, const uint8_t * value, uint16_t length){
+    // event length field limits event size
+    uint16_t capacity = (uint16_t) btstack_min(batch->buffer_size, 255u + 2u);
+    uint16_t item_size = GATT_CLIENT_NOTIFICATION_BATCH_ITEM_HEADER_SIZE + length;
+    if ((GATT_CLIENT_NOTIFICATION_BATCH_HEADER_SIZE + item_size) > capacity){
+        return false;
+    }
+    if (((batch->buffer_len + item_size) > capacity) || (batch->num_notifications == 255u)){
+        gatt_client_notification_batch_emit(batch);
+    }
+    uint8_t * item = &batch->buffer[batch->buffer_len];
+    little_endian_store_16(item, 0, value_handle);
+    little_endian_store_16(item, 2, length);
+    (void)memcpy(&item[GATT_CLIENT_NOTIFICATION_BATCH_ITEM_HEADER_SIZE], value, length);
+    batch->buffer_len += item_size;
+    batch->num_notifications++;
+
+    // emit on next run loop iteration
+    if (gatt_client_notification_batch_flush_scheduled == false){
+        gatt_client_notification_batch_flush_scheduled = true;
+        gatt_client_notification_batch_flush_request.callback = &gatt_client_notification_batch_handle_flush_request;
+        btstack_run_loop_execute_on_main_thread(&gatt_client_notification_batch_flush_request);
+    }
+    return true;
+}
+
+// @note assume that value is part of an l2cap buffer - overwrite parts of the HCI/L2CAP/ATT packet (4/4/3) bytes
+static void report_gatt_notification_batches(gatt_client_t *gatt_client, uint16_t value_handle, uint8_t *value, int length) {
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &gatt_client_notification_batches);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        gatt_client_notification_batch_t * batch = (gatt_client_notification_batch_t *) btstack_linked_list_iterator_next(&it);
+        if (batch->con_handle != gatt_client->con_handle){
+            continue;
+        }
+        if (gatt_client_notification_batch_add(batch, value_handle, value, (uint16_t) length)){
+            continue;
+        }
+        // too large for batch, keep order and deliver as single notification
+        gatt_client_notification_batch_emit(batch);
+        uint8_t * packet = setup_characteristic_value_packet(gatt_client, GATT_EVENT_NOTIFICATION, value_handle, value, length, 0, 0);
+        (*batch->callback)(HCI_EVENT_PACKET, 0, packet, CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE + length);
+    }
+}
+
 // @note assume that value is part of an l2cap buffer - overwrite parts of the HCI/L2CAP/ATT packet (4/4/3) bytes 
 static void report_gatt_notification(gatt_client_t *gatt_client, uint16_t value_handle, uint8_t *value, int length) {
     if (!gatt_client_accept_server_message(gatt_client)){
         return;
     }
+    report_gatt_notification_batches(gatt_client, value_handle, value, length);
     report_gatt_characteristic_value_change(gatt_client, GATT_EVENT_NOTIFICATION, value_handle, value, length);
 }
 
@@ -1448,6 +1631,12 @@ static void report_gatt_indication(gatt_client_t *gatt_client, uint16_t value_ha
     if (value_handle == gatt_client->gatt_service_changed_value_handle){
         gatt_client_caching_emit_service_changed(gatt_client, value, length);
         log_info("GATT Service Changed, restart caching");
+        // Database Hash is unknown until read again, drop cached discovery results
+        gatt_client->database_hash_valid = false;
+        int le_device_db_index = sm_le_device_index(gatt_client->con_handle);
+        if (le_device_db_index >= 0){
+            gatt_client_discovery_cache_delete(le_device_db_index);
+        }
         gatt_client->caching_state = GATT_CLIENT_CACHING_DISCOVER_CHARACTERISTICS_W2_SEND;
         gatt_client_notify_can_send_query(gatt_client);
     }
@@ -1576,11 +1765,11 @@ void gatt_client_listen_for_characteristic_value_updates(gatt_client_notificatio
     } else {
         notification->attribute_handle = characteristic->value_handle;
     }
-    btstack_linked_list_add(&gatt_client_value_listeners, (btstack_linked_item_t*) notification);
+    btstack_linked_list_add(gatt_client_value_listener_list(con_handle, notification->attribute_handle), (btstack_linked_item_t*) notification);
 }
 
 void gatt_client_stop_listening_for_characteristic_value_updates(gatt_client_notification_t * notification){
-    btstack_linked_list_remove(&gatt_client_value_listeners, (btstack_linked_item_t*) notification);
+    btstack_linked_list_remove(gatt_client_value_listener_list(notification->con_handle, notification->attribute_handle), (btstack_linked_item_t*) notification);
 }
 
 void gatt_client_listen_for_service_characteristic_value_updates(gatt_client_service_notification_t * notification,
@@ -1607,6 +1796,25 @@ void gatt_client_stop_listening_for_service_characteristic_value_updates(gatt_cl
     btstack_linked_list_remove(&gatt_client_service_value_listeners, (btstack_linked_item_t*) notification);
 }
 
+void gatt_client_register_notification_batch(gatt_client_notification_batch_t * batch, btstack_packet_handler_t callback,
+                                             hci_con_handle_t con_handle, uint8_t * buffer, uint16_t buffer_size){
+    batch->callback = callback;
+    batch->con_handle = con_handle;
+    batch->buffer = buffer;
+    batch->buffer_size = buffer_size;
+    batch->buffer_len = GATT_CLIENT_NOTIFICATION_BATCH_HEADER_SIZE;
+    batch->num_notifications = 0;
+    btstack_linked_list_add(&gatt_client_notification_batches, (btstack_linked_item_t*) batch);
+}
+
+void gatt_client_flush_notification_batch(gatt_client_notification_batch_t * batch){
+    gatt_client_notification_batch_emit(batch);
+}
+
+void gatt_client_unregister_notification_batch(gatt_client_notification_batch_t * batch){
+    btstack_linked_list_remove(&gatt_client_notification_batches, (btstack_linked_item_t*) batch);
+}
+
 static bool is_value_valid(gatt_client_t *gatt_client, uint8_t *packet, uint16_t size){
     if (size < 5u){
         return false;
@@ -1778,12 +1986,10 @@ static bool gatt_client_run_for_gatt_client(gatt_client_t * gatt_client){
             send_gatt_read_multiple_request(gatt_client);
             break;
 
-#ifdef ENABLE_GATT_OVER_EATT
         case P_W2_SEND_READ_MULTIPLE_VARIABLE_REQUEST:
             gatt_client->state = P_W4_READ_MULTIPLE_VARIABLE_RESPONSE;
             send_gatt_read_multiple_variable_request(gatt_client);
             break;
-#endif
 
         case P_W2_SEND_WRITE_CHARACTERISTIC_VALUE:
             gatt_client->state = P_W4_WRITE_CHARACTERISTIC_VALUE_RESULT;
@@ -2018,6 +2224,396 @@ static void gatt_client_emit_events(void * context){
             emit_gatt_complete_event(gatt_client, ATT_ERROR_SUCCESS);
         }
     }
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    // callbacks might start new queries which re-order the connection list, restart after each client
+    bool emitted = true;
+    while (emitted){
+        emitted = false;
+        for (it = (btstack_linked_item_t *) gatt_client_connections; it != NULL; it = it->next) {
+            gatt_client_t *gatt_client = (gatt_client_t *) it;
+            if (gatt_client->state == P_W2_EMIT_DISCOVERY_CACHE_RESULTS){
+                gatt_client_discovery_cache_emit_results(gatt_client);
+                emitted = true;
+                break;
+            }
+        }
+    }
+#endif
+}
+
+#ifdef ENABLE_GATT_CLIENT_CACHING
+
+// Discovery Cache
+// - holds the results of complete service, characteristic, and descriptor discoveries for one bonded device
+// - format: Database Hash (16 bytes) followed by records. A marker record completes the preceding results.
+// - UUIDs are stored as 16-bit UUID, or as 128-bit UUID if GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128 is set in the type
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICE                   0x01u  // start, end, uuid
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTIC            0x02u  // start, value, end, properties (1), uuid
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTOR                0x03u  // handle, uuid
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE         0x11u
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTICS_COMPLETE  0x12u  // start, end
+#define GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTORS_COMPLETE      0x13u  // start, end
+#define GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128                     0x80u
+
+static uint32_t gatt_client_discovery_cache_tag_for_index(uint8_t index){
+    return (((uint8_t)'G') << 24u) | (((uint8_t)'D') << 16u) | (((uint8_t)'C') << 8u) | index;
+}
+
+static void gatt_client_discovery_cache_store(void){
+    if (gatt_client_discovery_cache_store_pending == false){
+        return;
+    }
+    gatt_client_discovery_cache_store_pending = false;
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl != NULL) {
+        log_info("Discovery Cache: store %u bytes", gatt_client_discovery_cache_len);
+        uint32_t tag = gatt_client_discovery_cache_tag_for_index((uint8_t) gatt_client_discovery_cache_le_device_db_index);
+        (void) tlv_impl->store_tag(tlv_context, tag, gatt_client_discovery_cache_data, gatt_client_discovery_cache_len);
+    }
+}
+
+static void gatt_client_discovery_cache_handle_disconnect(hci_con_handle_t con_handle){
+    if (gatt_client_discovery_cache_store_con_handle == con_handle){
+        gatt_client_discovery_cache_store();
+    }
+}
+
+static void gatt_client_discovery_cache_delete(int le_device_db_index){
+    if (gatt_client_discovery_cache_le_device_db_index == le_device_db_index){
+        gatt_client_discovery_cache_le_device_db_index = -1;
+        gatt_client_discovery_cache_len = 0;
+        gatt_client_discovery_cache_recording_client = NULL;
+        gatt_client_discovery_cache_store_pending = false;
+    }
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl != NULL) {
+        uint32_t tag = gatt_client_discovery_cache_tag_for_index((uint8_t) le_device_db_index);
+        tlv_impl->delete_tag(tlv_context, tag);
+    }
+}
+
+// load cache for bonded device with known Database Hash, @return true if cache is available
+static bool gatt_client_discovery_cache_load(const gatt_client_t * gatt_client){
+    if (gatt_client->bearer_type != ATT_BEARER_UNENHANCED_LE){
+        return false;
+    }
+    if (gatt_client->database_hash_valid == false){
+        return false;
+    }
+    int le_device_db_index = sm_le_device_index(gatt_client->con_handle);
+    if (le_device_db_index < 0){
+        return false;
+    }
+    if (gatt_client_discovery_cache_le_device_db_index == le_device_db_index){
+        return true;
+    }
+    // keep cache while another device records or receives discovery results
+    if ((gatt_client_discovery_cache_recording_client != NULL) || gatt_client_discovery_cache_emitting){
+        return false;
+    }
+    const btstack_tlv_t * tlv_impl = NULL;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl == NULL){
+        return false;
+    }
+    gatt_client_discovery_cache_store();
+    gatt_client_discovery_cache_le_device_db_index = le_device_db_index;
+    uint32_t tag = gatt_client_discovery_cache_tag_for_index((uint8_t) le_device_db_index);
+    int len = tlv_impl->get_tag(tlv_context, tag, gatt_client_discovery_cache_data, GATT_CLIENT_DISCOVERY_CACHE_SIZE);
+    if ((len >= 16) && (memcmp(gatt_client_discovery_cache_data, gatt_client->database_hash, 16) == 0)){
+        gatt_client_discovery_cache_len = (uint16_t) len;
+        log_info("Discovery Cache: loaded %u bytes", gatt_client_discovery_cache_len);
+    } else {
+        (void) memcpy(gatt_client_discovery_cache_data, gatt_client->database_hash, 16);
+        gatt_client_discovery_cache_len = 16;
+    }
+    return true;
+}
+
+// @return record len or 0 if record is invalid
+static uint16_t gatt_client_discovery_cache_record_len(uint16_t offset){
+    uint8_t type = gatt_client_discovery_cache_data[offset];
+    uint16_t uuid_len = ((type & GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128) != 0u) ? 16u : 2u;
+    uint16_t record_len;
+    switch (type & (uint8_t) ~GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128){
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICE:
+            record_len = 5u + uuid_len;
+            break;
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTIC:
+            record_len = 8u + uuid_len;
+            break;
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTOR:
+            record_len = 3u + uuid_len;
+            break;
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE:
+            record_len = 1u;
+            break;
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTICS_COMPLETE:
+        case GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTORS_COMPLETE:
+            record_len = 5u;
+            break;
+        default:
+            return 0;
+    }
+    if ((offset + record_len) > gatt_client_discovery_cache_len){
+        return 0;
+    }
+    return record_len;
+}
+
+static void gatt_client_discovery_cache_read_uuid(uint16_t offset, uint16_t uuid_offset, uint8_t * uuid128){
+    if ((gatt_client_discovery_cache_data[offset] & GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128) != 0u){
+        (void) memcpy(uuid128, &gatt_client_discovery_cache_data[offset + uuid_offset], 16);
+    } else {
+        uuid_add_bluetooth_prefix(uuid128, little_endian_read_16(gatt_client_discovery_cache_data, offset + uuid_offset));
+    }
+}
+
+// find marker for query and the results it completes
+static bool gatt_client_discovery_cache_find_results(uint8_t marker, uint16_t start_handle, uint16_t end_handle,
+                                                     uint16_t * out_results_offset, uint16_t * out_results_end){
+    uint16_t results_offset = 16;
+    uint16_t offset = 16;
+    while (offset < gatt_client_discovery_cache_len){
+        uint16_t record_len = gatt_client_discovery_cache_record_len(offset);
+        if (record_len == 0u){
+            break;
+        }
+        uint8_t type = gatt_client_discovery_cache_data[offset] & (uint8_t) ~GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128;
+        if (type >= GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE){
+            if ((type == marker) && ((marker == GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE) ||
+                ((little_endian_read_16(gatt_client_discovery_cache_data, offset + 1u) == start_handle) &&
+                 (little_endian_read_16(gatt_client_discovery_cache_data, offset + 3u) == end_handle)))){
+                *out_results_offset = results_offset;
+                *out_results_end    = offset;
+                return true;
+            }
+            results_offset = offset + record_len;
+        }
+        offset += record_len;
+    }
+    return false;
+}
+
+static void gatt_client_discovery_cache_append(const uint8_t * record, uint16_t record_len){
+    if (gatt_client_discovery_cache_recording_overflow){
+        return;
+    }
+    if ((gatt_client_discovery_cache_len + record_len) > GATT_CLIENT_DISCOVERY_CACHE_SIZE){
+        log_info("Discovery Cache: full, drop results");
+        gatt_client_discovery_cache_recording_overflow = true;
+        return;
+    }
+    (void) memcpy(&gatt_client_discovery_cache_data[gatt_client_discovery_cache_len], record, record_len);
+    gatt_client_discovery_cache_len += record_len;
+}
+
+// store uuid and set flag in record type, @return record len
+static uint16_t gatt_client_discovery_cache_store_uuid(uint8_t * record, uint16_t offset, const uint8_t * uuid128){
+    if (uuid_has_bluetooth_prefix(uuid128) && (big_endian_read_32(uuid128, 0) <= 0xffffu)){
+        little_endian_store_16(record, offset, (uint16_t) big_endian_read_32(uuid128, 0));
+        return offset + 2u;
+    }
+    record[0] |= GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128;
+    (void) memcpy(&record[offset], uuid128, 16);
+    return offset + 16u;
+}
+
+static void gatt_client_discovery_cache_record_service(const gatt_client_t * gatt_client, uint16_t start_group_handle,
+                                                       uint16_t end_group_handle, const uint8_t * uuid128){
+    if (gatt_client != gatt_client_discovery_cache_recording_client){
+        return;
+    }
+    uint8_t record[21];
+    record[0] = GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICE;
+    little_endian_store_16(record, 1, start_group_handle);
+    little_endian_store_16(record, 3, end_group_handle);
+    uint16_t record_len = gatt_client_discovery_cache_store_uuid(record, 5, uuid128);
+    gatt_client_discovery_cache_append(record, record_len);
+}
+
+static void gatt_client_discovery_cache_record_characteristic(const gatt_client_t * gatt_client, uint16_t start_handle,
+                                                              uint16_t value_handle, uint16_t end_handle, uint16_t properties,
+                                                              const uint8_t * uuid128){
+    if (gatt_client != gatt_client_discovery_cache_recording_client){
+        return;
+    }
+    uint8_t record[24];
+    record[0] = GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTIC;
+    little_endian_store_16(record, 1, start_handle);
+    little_endian_store_16(record, 3, value_handle);
+    little_endian_store_16(record, 5, end_handle);
+    record[7] = (uint8_t) properties;
+    uint16_t record_len = gatt_client_discovery_cache_store_uuid(record, 8, uuid128);
+    gatt_client_discovery_cache_append(record, record_len);
+}
+
+static void gatt_client_discovery_cache_record_descriptor(const gatt_client_t * gatt_client, uint16_t descriptor_handle,
+                                                          const uint8_t * uuid128){
+    if (gatt_client != gatt_client_discovery_cache_recording_client){
+        return;
+    }
+    uint8_t record[19];
+    record[0] = GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTOR;
+    little_endian_store_16(record, 1, descriptor_handle);
+    uint16_t record_len = gatt_client_discovery_cache_store_uuid(record, 3, uuid128);
+    gatt_client_discovery_cache_append(record, record_len);
+}
+
+// @return marker that completes results for query, or 0 if query cannot be served from cache
+static uint8_t gatt_client_discovery_cache_marker_for_query(const gatt_client_t * gatt_client, gatt_client_state_t query){
+    switch (query){
+        case P_W2_SEND_SERVICE_QUERY:
+            if (gatt_client->uuid16 != GATT_PRIMARY_SERVICE_UUID){
+                return 0;
+            }
+            return GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE;
+        case P_W2_SEND_SERVICE_WITH_UUID_QUERY:
+            return GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE;
+        case P_W2_SEND_ALL_CHARACTERISTICS_OF_SERVICE_QUERY:
+        case P_W2_SEND_CHARACTERISTIC_WITH_UUID_QUERY:
+            return GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTICS_COMPLETE;
+        case P_W2_SEND_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY:
+            return GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTORS_COMPLETE;
+        default:
+            return 0;
+    }
+}
+
+static void gatt_client_discovery_cache_record_finish(gatt_client_t * gatt_client, uint8_t att_status){
+    if (gatt_client != gatt_client_discovery_cache_recording_client){
+        return;
+    }
+    gatt_client_discovery_cache_recording_client = NULL;
+
+    if ((att_status == ATT_ERROR_SUCCESS) && (gatt_client_discovery_cache_recording_overflow == false)){
+        uint8_t marker[5];
+        marker[0] = gatt_client_discovery_cache_marker_for_query(gatt_client, gatt_client->discovery_cache_query);
+        little_endian_store_16(marker, 1, gatt_client_discovery_cache_recording_start_handle);
+        little_endian_store_16(marker, 3, gatt_client_discovery_cache_recording_end_handle);
+        uint16_t marker_len = (marker[0] == GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICES_COMPLETE) ? 1u : 5u;
+        gatt_client_discovery_cache_append(marker, marker_len);
+    }
+
+    if (gatt_client_discovery_cache_recording_overflow || (att_status != ATT_ERROR_SUCCESS)){
+        // drop partial results
+        gatt_client_discovery_cache_len = gatt_client_discovery_cache_recording_offset;
+        return;
+    }
+
+    // avoid flash write for each query
+    gatt_client_discovery_cache_store_pending = true;
+    gatt_client_discovery_cache_store_con_handle = gatt_client->con_handle;
+}
+
+// serve discovery query from cache or record its results, @return true if served from cache
+static bool gatt_client_discovery_cache_handle_query(gatt_client_t * gatt_client){
+    gatt_client_state_t query = gatt_client->state;
+    uint8_t marker = gatt_client_discovery_cache_marker_for_query(gatt_client, query);
+    if (marker == 0u){
+        return false;
+    }
+    if (gatt_client_discovery_cache_load(gatt_client) == false){
+        return false;
+    }
+    gatt_client->discovery_cache_query = query;
+
+    uint16_t results_offset;
+    uint16_t results_end;
+    if (gatt_client_discovery_cache_find_results(marker, gatt_client->start_group_handle, gatt_client->end_group_handle,
+                                                 &results_offset, &results_end)){
+        // emit results on next run loop iteration
+        gatt_client->state = P_W2_EMIT_DISCOVERY_CACHE_RESULTS;
+        gatt_client_deferred_event_emit.callback = gatt_client_emit_events;
+        btstack_run_loop_execute_on_main_thread(&gatt_client_deferred_event_emit);
+        return true;
+    }
+
+    // record results of complete discoveries
+    bool complete_discovery = (query == P_W2_SEND_SERVICE_QUERY) || (query == P_W2_SEND_ALL_CHARACTERISTICS_OF_SERVICE_QUERY) ||
+                              (query == P_W2_SEND_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY);
+    if (complete_discovery && (gatt_client_discovery_cache_recording_client == NULL)){
+        gatt_client_discovery_cache_recording_client = gatt_client;
+        gatt_client_discovery_cache_recording_offset = gatt_client_discovery_cache_len;
+        gatt_client_discovery_cache_recording_start_handle = gatt_client->start_group_handle;
+        gatt_client_discovery_cache_recording_end_handle = gatt_client->end_group_handle;
+        gatt_client_discovery_cache_recording_overflow = false;
+    }
+    return false;
+}
+
+static void gatt_client_discovery_cache_emit_results(gatt_client_t * gatt_client){
+    gatt_client_state_t query = gatt_client->discovery_cache_query;
+    uint8_t marker = gatt_client_discovery_cache_marker_for_query(gatt_client, query);
+    uint16_t results_offset;
+    uint16_t results_end;
+    if ((gatt_client_discovery_cache_load(gatt_client) == false) ||
+        (gatt_client_discovery_cache_find_results(marker, gatt_client->start_group_handle, gatt_client->end_group_handle,
+                                                  &results_offset, &results_end) == false)){
+        // cache was dropped in the meantime, send query instead
+        gatt_client->state = query;
+        gatt_client_run();
+        return;
+    }
+
+    bool filter_with_uuid = (query == P_W2_SEND_SERVICE_WITH_UUID_QUERY) || (query == P_W2_SEND_CHARACTERISTIC_WITH_UUID_QUERY);
+    gatt_client_discovery_cache_emitting = true;
+    uint16_t offset = results_offset;
+    while (offset < results_end){
+        const uint8_t * record = &gatt_client_discovery_cache_data[offset];
+        uint16_t record_len = gatt_client_discovery_cache_record_len(offset);
+        if (record_len == 0u){
+            // cache deleted by callback
+            break;
+        }
+        uint8_t uuid128[16];
+        switch (record[0] & (uint8_t) ~GATT_CLIENT_DISCOVERY_CACHE_FLAG_UUID128){
+            case GATT_CLIENT_DISCOVERY_CACHE_RECORD_SERVICE:
+                gatt_client_discovery_cache_read_uuid(offset, 5, uuid128);
+                if (filter_with_uuid && (memcmp(uuid128, gatt_client->uuid128, 16) != 0)){
+                    break;
+                }
+                emit_gatt_service_query_result_event(gatt_client, little_endian_read_16(record, 1),
+                                                     little_endian_read_16(record, 3), uuid128);
+                break;
+            case GATT_CLIENT_DISCOVERY_CACHE_RECORD_CHARACTERISTIC:
+                gatt_client_discovery_cache_read_uuid(offset, 8, uuid128);
+                if (filter_with_uuid && (memcmp(uuid128, gatt_client->uuid128, 16) != 0)){
+                    break;
+                }
+                emit_gatt_characteristic_query_result_event(gatt_client, little_endian_read_16(record, 1),
+                                                            little_endian_read_16(record, 3), little_endian_read_16(record, 5),
+                                                            record[7], uuid128);
+                break;
+            case GATT_CLIENT_DISCOVERY_CACHE_RECORD_DESCRIPTOR:
+                gatt_client_discovery_cache_read_uuid(offset, 3, uuid128);
+                emit_gatt_all_characteristic_descriptors_result_event(gatt_client, little_endian_read_16(record, 1), uuid128);
+                break;
+            default:
+                break;
+        }
+        offset += record_len;
+    }
+    gatt_client_discovery_cache_emitting = false;
+    gatt_client_handle_transaction_complete(gatt_client, ATT_ERROR_SUCCESS);
+}
+#endif
+
+// start discovery query, served from Discovery Cache if possible
+static void gatt_client_run_discovery_query(gatt_client_t * gatt_client){
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    if (gatt_client_discovery_cache_handle_query(gatt_client)){
+        return;
+    }
+#else
+    UNUSED(gatt_client);
+#endif
+    gatt_client_run();
 }
 
 static void gatt_client_report_error_if_pending(gatt_client_t *gatt_client, uint8_t att_error_code) {
@@ -2086,7 +2682,12 @@ static void gatt_client_handle_disconnection_complete(const uint8_t * packet){
         return;
     }
 
+    gatt_client_notification_batch_flush_for_handle(con_handle);
+#ifdef ENABLE_GATT_CLIENT_CACHING
+    gatt_client_discovery_cache_handle_disconnect(con_handle);
+#endif
     gatt_client_report_error_if_pending(gatt_client, ATT_ERROR_HCI_DISCONNECT_RECEIVED);
+    gatt_client_coalesced_reads_abort(gatt_client, ATT_ERROR_HCI_DISCONNECT_RECEIVED);
     gatt_client_timeout_stop(gatt_client);
     btstack_linked_list_remove(&gatt_client_connections, (btstack_linked_item_t *) gatt_client);
     btstack_memory_gatt_client_free(gatt_client);
@@ -2570,7 +3171,6 @@ static void gatt_client_handle_att_response(gatt_client_t * gatt_client, uint8_t
             }
             break;
 
-#ifdef ENABLE_GATT_OVER_EATT
         case ATT_READ_MULTIPLE_VARIABLE_RSP:
             switch (gatt_client->state) {
                 case P_W4_READ_MULTIPLE_VARIABLE_RESPONSE:
@@ -2581,7 +3181,6 @@ static void gatt_client_handle_att_response(gatt_client_t * gatt_client, uint8_t
                     break;
             }
             break;
-#endif
 
         case ATT_ERROR_RESPONSE:
             if (size < 5u){
@@ -2875,7 +3474,7 @@ uint8_t gatt_client_discover_primary_services(btstack_packet_handler_t callback,
     gatt_client->end_group_handle   = 0xffff;
     gatt_client->state = P_W2_SEND_SERVICE_QUERY;
     gatt_client->uuid16 = GATT_PRIMARY_SERVICE_UUID;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -2891,7 +3490,7 @@ uint8_t gatt_client_discover_secondary_services(btstack_packet_handler_t callbac
     gatt_client->end_group_handle   = 0xffff;
     gatt_client->state = P_W2_SEND_SERVICE_QUERY;
     gatt_client->uuid16 = GATT_SECONDARY_SERVICE_UUID;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -2905,7 +3504,7 @@ static void gatt_client_discover_primary_service_by_uuid16_internal(gatt_client_
     gatt_client->state = P_W2_SEND_SERVICE_WITH_UUID_QUERY;
     gatt_client->uuid16 = uuid16;
     uuid_add_bluetooth_prefix((uint8_t*) &(gatt_client->uuid128), gatt_client->uuid16);
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
 }
 
 uint8_t gatt_client_discover_primary_services_by_uuid16_with_context(btstack_packet_handler_t callback, hci_con_handle_t con_handle,
@@ -2943,7 +3542,7 @@ uint8_t gatt_client_discover_primary_services_by_uuid128_with_context(btstack_pa
     gatt_client->uuid16 = 0;
     (void)memcpy(gatt_client->uuid128, uuid128, 16);
     gatt_client->state = P_W2_SEND_SERVICE_WITH_UUID_QUERY;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -2957,7 +3556,7 @@ static void gatt_client_discover_characteristics_for_service_internal(gatt_clien
     gatt_client->filter_with_uuid = false;
     gatt_client->characteristic_start_handle = 0;
     gatt_client->state = P_W2_SEND_ALL_CHARACTERISTICS_OF_SERVICE_QUERY;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
 }
 
 uint8_t gatt_client_discover_characteristics_for_service_with_context(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_service_t * service,
@@ -3009,7 +3608,7 @@ static void gatt_client_discover_characteristics_for_handle_range_by_uuid16_inte
     uuid_add_bluetooth_prefix((uint8_t*) &(gatt_client->uuid128), uuid16);
     gatt_client->characteristic_start_handle = 0;
     gatt_client->state = P_W2_SEND_CHARACTERISTIC_WITH_UUID_QUERY;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
 }
 
 uint8_t gatt_client_discover_characteristics_for_handle_range_by_uuid16(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
@@ -3037,7 +3636,7 @@ uint8_t gatt_client_discover_characteristics_for_handle_range_by_uuid128(btstack
     (void)memcpy(gatt_client->uuid128, uuid128, 16);
     gatt_client->characteristic_start_handle = 0;
     gatt_client->state = P_W2_SEND_CHARACTERISTIC_WITH_UUID_QUERY;
-    gatt_client_run();
+    gatt_client_run_discovery_query(gatt_client);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -3067,7 +3666,7 @@ uint8_t gatt_client_discover_characteristic_descriptors_with_context(btstack_pac
         gatt_client->start_group_handle = characteristic->value_handle + 1u;
         gatt_client->end_group_handle   = characteristic->end_handle;
         gatt_client->state = P_W2_SEND_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY;
-        gatt_client_run();
+        gatt_client_run_discovery_query(gatt_client);
     } else {
         // schedule gatt complete event on next run loop iteration otherwise
         gatt_client->state = P_W2_EMIT_QUERY_COMPLETE_EVENT;
@@ -3210,11 +3809,229 @@ uint8_t gatt_client_read_multiple_characteristic_values(btstack_packet_handler_t
     return gatt_client_read_multiple_characteristic_values_with_state(callback, con_handle, num_value_handles, value_handles, P_W2_SEND_READ_MULTIPLE_REQUEST);
 }
 
-#ifdef ENABLE_GATT_OVER_EATT
 uint8_t gatt_client_read_multiple_variable_characteristic_values(btstack_packet_handler_t callback, hci_con_handle_t con_handle, int num_value_handles, uint16_t * value_handles){
     return gatt_client_read_multiple_characteristic_values_with_state(callback, con_handle, num_value_handles, value_handles, P_W2_SEND_READ_MULTIPLE_VARIABLE_REQUEST);
 }
-#endif
+
+static void gatt_client_coalesced_read_emit_query_complete(gatt_client_coalesced_read_t * read, hci_con_handle_t con_handle, uint8_t att_status){
+    // @format H122
+    uint8_t packet[9];
+    hci_event_builder_context_t context;
+    hci_event_builder_init(&context, packet, sizeof(packet), GATT_EVENT_QUERY_COMPLETE, 0);
+    hci_event_builder_add_con_handle(&context, con_handle);
+    hci_event_builder_add_16(&context, 0);
+    hci_event_builder_add_16(&context, 0);
+    hci_event_builder_add_08(&context, att_status);
+    emit_event_new(read->callback, packet, hci_event_builder_get_length(&context));
+}
+
+static void gatt_client_coalesced_reads_trigger(gatt_client_t * gatt_client){
+    if (gatt_client->coalesced_reads_query_pending){
+        return;
+    }
+    if (!btstack_linked_list_empty(&gatt_client->coalesced_reads_active)){
+        return;
+    }
+    if (btstack_linked_list_empty(&gatt_client->coalesced_reads)){
+        return;
+    }
+    gatt_client->coalesced_reads_query_pending = true;
+    (void) gatt_client_request_to_send_gatt_query(&gatt_client->coalesced_reads_query_request, gatt_client->con_handle);
+}
+
+// re-queue reads of current request in front of reads queued in the meantime
+static void gatt_client_coalesced_reads_requeue_active(gatt_client_t * gatt_client){
+    while (true){
+        btstack_linked_item_t * item = btstack_linked_list_pop(&gatt_client->coalesced_reads);
+        if (item == NULL){
+            break;
+        }
+        btstack_linked_list_add_tail(&gatt_client->coalesced_reads_active, item);
+    }
+    gatt_client->coalesced_reads = gatt_client->coalesced_reads_active;
+    gatt_client->coalesced_reads_active = NULL;
+}
+
+static void gatt_client_coalesced_reads_abort(gatt_client_t * gatt_client, uint8_t att_status){
+    gatt_client_coalesced_reads_requeue_active(gatt_client);
+    btstack_linked_list_t reads = gatt_client->coalesced_reads;
+    gatt_client->coalesced_reads = NULL;
+    while (true){
+        gatt_client_coalesced_read_t * read = (gatt_client_coalesced_read_t *) btstack_linked_list_pop(&reads);
+        if (read == NULL){
+            break;
+        }
+        gatt_client_coalesced_read_emit_query_complete(read, gatt_client->con_handle, att_status);
+    }
+}
+
+static void gatt_client_coalesced_reads_handle_value(gatt_client_t * gatt_client, uint8_t * packet, uint16_t size){
+    gatt_client_coalesced_read_t * read;
+    if (gatt_client->coalesced_reads_single){
+        read = (gatt_client_coalesced_read_t *) gatt_client->coalesced_reads_active;
+        (*read->callback)(HCI_EVENT_PACKET, 0, packet, size);
+        gatt_client->coalesced_reads_num_completed = 1;
+        return;
+    }
+
+    // split Length Value Tuple List, values are complete if they fit into the response
+    uint8_t * tuples = &packet[CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE];
+    uint16_t tuples_len = gatt_event_characteristic_value_query_result_get_value_length(packet);
+    uint16_t pos = 0;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &gatt_client->coalesced_reads_active);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        read = (gatt_client_coalesced_read_t *) btstack_linked_list_iterator_next(&it);
+        if ((pos + 2u) > tuples_len){
+            break;
+        }
+        uint16_t value_len = little_endian_read_16(tuples, pos);
+        pos += 2u;
+        if ((pos + value_len) > tuples_len){
+            // truncated, read again with ATT Read Request
+            read->single = true;
+            break;
+        }
+        // event header overwrites previous tuples or header of received event
+        uint8_t * event = &tuples[pos] - CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE;
+        event[0] = GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT;
+        event[1] = CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE - 2 + value_len;
+        little_endian_store_16(event, 2, gatt_client->con_handle);
+        little_endian_store_16(event, 4, 0);
+        little_endian_store_16(event, 6, 0);
+        little_endian_store_16(event, 8, read->value_handle);
+        little_endian_store_16(event, 10, value_len);
+        emit_event_new(read->callback, event, CHARACTERISTIC_VALUE_EVENT_HEADER_SIZE + value_len);
+        pos += value_len;
+        gatt_client->coalesced_reads_num_completed++;
+    }
+}
+
+static void gatt_client_coalesced_reads_handle_query_complete(gatt_client_t * gatt_client, uint8_t att_status){
+    if (att_status == ATT_ERROR_HCI_DISCONNECT_RECEIVED){
+        gatt_client_coalesced_reads_abort(gatt_client, att_status);
+        return;
+    }
+
+    btstack_linked_list_t completed_reads = NULL;
+    uint8_t num_completed;
+    if (att_status == ATT_ERROR_SUCCESS){
+        num_completed = gatt_client->coalesced_reads_num_completed;
+    } else if (gatt_client->coalesced_reads_single){
+        num_completed = 1;
+    } else {
+        // try again with ATT Read Requests, also report error for the failing value
+        if (att_status == ATT_ERROR_REQUEST_NOT_SUPPORTED){
+            gatt_client->read_multiple_variable_unsupported = true;
+        }
+        num_completed = 0;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &gatt_client->coalesced_reads_active);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            gatt_client_coalesced_read_t * read = (gatt_client_coalesced_read_t *) btstack_linked_list_iterator_next(&it);
+            read->single = true;
+        }
+    }
+    while (num_completed > 0u){
+        btstack_linked_list_add_tail(&completed_reads, btstack_linked_list_pop(&gatt_client->coalesced_reads_active));
+        num_completed--;
+    }
+    gatt_client_coalesced_reads_requeue_active(gatt_client);
+
+    // report completed reads
+    while (true){
+        gatt_client_coalesced_read_t * read = (gatt_client_coalesced_read_t *) btstack_linked_list_pop(&completed_reads);
+        if (read == NULL){
+            break;
+        }
+        gatt_client_coalesced_read_emit_query_complete(read, gatt_client->con_handle, att_status);
+    }
+
+    gatt_client_coalesced_reads_trigger(gatt_client);
+}
+
+static void gatt_client_coalesced_reads_handle_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    gatt_client_t * gatt_client;
+    switch (hci_event_packet_get_type(packet)){
+        case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
+            gatt_client = gatt_client_get_context_for_handle(gatt_event_characteristic_value_query_result_get_handle(packet));
+            btstack_assert(gatt_client != NULL);
+            gatt_client_coalesced_reads_handle_value(gatt_client, packet, size);
+            break;
+        case GATT_EVENT_QUERY_COMPLETE:
+            gatt_client = gatt_client_get_context_for_handle(gatt_event_query_complete_get_handle(packet));
+            btstack_assert(gatt_client != NULL);
+            gatt_client_coalesced_reads_handle_query_complete(gatt_client, gatt_event_query_complete_get_att_status(packet));
+            break;
+        default:
+            break;
+    }
+}
+
+static void gatt_client_coalesced_reads_handle_can_send_query(void * context){
+    gatt_client_t * gatt_client = (gatt_client_t *) context;
+    gatt_client->coalesced_reads_query_pending = false;
+
+    gatt_client_coalesced_read_t * read = (gatt_client_coalesced_read_t *) btstack_linked_list_pop(&gatt_client->coalesced_reads);
+    if (read == NULL){
+        return;
+    }
+    btstack_linked_list_add_tail(&gatt_client->coalesced_reads_active, (btstack_linked_item_t *) read);
+    gatt_client->coalesced_reads_num_completed = 0;
+
+    // collect value handles that fit into the request
+    uint16_t max_handles = btstack_min(GATT_CLIENT_COALESCED_READS_MAX_HANDLES, (gatt_client->mtu - 1u) / 2u);
+    uint16_t num_handles = 1;
+    gatt_client->coalesced_reads_handles[0] = read->value_handle;
+    gatt_client->coalesced_reads_single = read->single || gatt_client->read_multiple_variable_unsupported;
+    while ((gatt_client->coalesced_reads_single == false) && (num_handles < max_handles)){
+        read = (gatt_client_coalesced_read_t *) gatt_client->coalesced_reads;
+        if ((read == NULL) || read->single){
+            break;
+        }
+        btstack_linked_list_pop(&gatt_client->coalesced_reads);
+        btstack_linked_list_add_tail(&gatt_client->coalesced_reads_active, (btstack_linked_item_t *) read);
+        gatt_client->coalesced_reads_handles[num_handles++] = read->value_handle;
+    }
+    if (num_handles == 1u){
+        gatt_client->coalesced_reads_single = true;
+    }
+
+    uint8_t status;
+    if (gatt_client->coalesced_reads_single){
+        status = gatt_client_read_value_of_characteristic_using_value_handle(&gatt_client_coalesced_reads_handle_event,
+                                                                              gatt_client->con_handle, gatt_client->coalesced_reads_handles[0]);
+    } else {
+        status = gatt_client_read_multiple_variable_characteristic_values(&gatt_client_coalesced_reads_handle_event,
+                                                                           gatt_client->con_handle, num_handles, gatt_client->coalesced_reads_handles);
+    }
+    if (status != ERROR_CODE_SUCCESS){
+        // wait for next query slot
+        gatt_client_coalesced_reads_requeue_active(gatt_client);
+        gatt_client_coalesced_reads_trigger(gatt_client);
+    }
+}
+
+uint8_t gatt_client_read_value_of_characteristic_coalesced(gatt_client_coalesced_read_t * read, btstack_packet_handler_t callback,
+                                                           hci_con_handle_t con_handle, uint16_t value_handle){
+    gatt_client_t * gatt_client;
+    uint8_t status = gatt_client_provide_context_for_handle(con_handle, &gatt_client);
+    if (status != ERROR_CODE_SUCCESS){
+        return status;
+    }
+
+    read->callback = callback;
+    read->value_handle = value_handle;
+    read->single = false;
+    btstack_linked_list_add_tail(&gatt_client->coalesced_reads, (btstack_linked_item_t *) read);
+
+    gatt_client->coalesced_reads_query_request.callback = &gatt_client_coalesced_reads_handle_can_send_query;
+    gatt_client->coalesced_reads_query_request.context = gatt_client;
+    gatt_client_coalesced_reads_trigger(gatt_client);
+    return ERROR_CODE_SUCCESS;
+}
 
 uint8_t gatt_client_write_value_of_characteristic_without_response(hci_con_handle_t con_handle, uint16_t value_handle, uint16_t value_length, uint8_t * value){
     gatt_client_t * gatt_client;
@@ -3931,7 +4748,7 @@ static void gatt_client_le_enhanced_handle_connected(gatt_client_t * gatt_client
             gatt_client->eatt_state = GATT_CLIENT_EATT_READY;
             // free unused channels
             btstack_linked_list_iterator_t it;
-            btstack_linked_list_iterator_init(&it, &gatt_client_connections);
+            btstack_linked_list_iterator_init(&it, &gatt_client->eatt_clients);
             while (btstack_linked_list_iterator_has_next(&it)) {
                 gatt_client_t *eatt_client = (gatt_client_t *) btstack_linked_list_iterator_next(&it);
                 if (eatt_client->state == P_L2CAP_CLOSED){
@@ -3961,7 +4778,10 @@ static void gatt_client_le_enhanced_handle_connected(gatt_client_t * gatt_client
         gatt_client->eatt_state = GATT_CLIENT_EATT_IDLE;
     }
 
-    gatt_client_emit_connected(gatt_client->callback, status, gatt_client->addr_type, gatt_client->addr, gatt_client->con_handle);
+    gatt_client_emit_connected(gatt_client->eatt_callback, status, gatt_client->addr_type, gatt_client->addr, gatt_client->con_handle);
+
+    // serve queued query requests on EATT bearers or unenhanced bearer
+    gatt_client_notify_can_send_query(gatt_client);
 }
 
 // single channel disconnected
@@ -3983,7 +4803,7 @@ static void gatt_client_le_enhanced_handle_ecbm_disconnected(gatt_client_t * gat
             // report disconnected if last channel closed
             uint8_t buffer[20];
             uint16_t len = hci_event_create_from_template_and_arguments(buffer, sizeof(buffer), &gatt_client_disconnected, gatt_client->con_handle);
-            (*gatt_client->callback)(HCI_EVENT_PACKET, 0, buffer, len);
+            (*gatt_client->eatt_callback)(HCI_EVENT_PACKET, 0, buffer, len);
         }
     }
 }
@@ -4126,10 +4946,11 @@ static void gatt_client_le_enhanced_packet_handler(uint8_t packet_type, uint16_t
                     btstack_assert(eatt_client != NULL);
                     btstack_assert(eatt_client->state == P_W4_L2CAP_CONNECTION);
 
-                    status = l2cap_event_channel_opened_get_status(packet);
+                    status = l2cap_event_ecbm_channel_opened_get_status(packet);
                     if (status == ERROR_CODE_SUCCESS){
                         eatt_client->state = P_READY;
-                        eatt_client->mtu = l2cap_event_channel_opened_get_remote_mtu(packet);
+                        eatt_client->mtu = btstack_min(l2cap_event_ecbm_channel_opened_get_local_mtu(packet),
+                                                       l2cap_event_ecbm_channel_opened_get_remote_mtu(packet));
                     } else {
                         eatt_client->state = P_L2CAP_CLOSED;
                     }
@@ -4258,7 +5079,7 @@ uint8_t gatt_client_le_enhanced_connect(btstack_packet_handler_t callback, hci_c
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
     hci_connection->att_server.eatt_outgoing_active = true;
 
-    gatt_client->callback = callback;
+    gatt_client->eatt_callback = callback;
     gatt_client->eatt_num_clients   = num_channels;
     gatt_client->eatt_storage_buffer = storage_buffer;
     gatt_client->eatt_storage_size   = storage_size;
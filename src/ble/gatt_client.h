@@ -47,6 +47,11 @@
 
 // spec defines 100 ms, PTS might indicate an error if we sent after 100 ms
 #define GATT_CLIENT_COLLISION_BACKOFF_MS 150
+
+// max number of value handles combined into a single Read Multiple Variable Request for coalesced reads
+#ifndef GATT_CLIENT_COALESCED_READS_MAX_HANDLES
+#define GATT_CLIENT_COALESCED_READS_MAX_HANDLES 10
+#endif
 #if defined __cplusplus
 extern "C" {
 #endif
@@ -64,6 +69,7 @@ extern "C" {
 typedef enum {
     P_READY,
     P_W2_EMIT_QUERY_COMPLETE_EVENT,
+    P_W2_EMIT_DISCOVERY_CACHE_RESULTS,
     P_W2_SEND_SERVICE_QUERY,
     P_W4_SERVICE_QUERY_RESULT,
     P_W2_SEND_SERVICE_WITH_UUID_QUERY,
@@ -228,6 +234,8 @@ typedef struct gatt_client{
 
 #ifdef ENABLE_GATT_OVER_EATT
     gatt_client_eatt_state_t eatt_state;
+    // callback for GATT_EVENT_CONNECTED and GATT_EVENT_DISCONNECTED
+    btstack_packet_handler_t eatt_callback;
     btstack_linked_list_t eatt_clients;
     uint8_t * eatt_storage_buffer;
     uint16_t eatt_storage_size;
@@ -260,6 +268,16 @@ typedef struct gatt_client{
     uint16_t    read_multiple_handle_count;
     uint16_t  * read_multiple_handles;
 
+    // coalesced reads, queued and in current request
+    btstack_linked_list_t coalesced_reads;
+    btstack_linked_list_t coalesced_reads_active;
+    btstack_context_callback_registration_t coalesced_reads_query_request;
+    uint16_t coalesced_reads_handles[GATT_CLIENT_COALESCED_READS_MAX_HANDLES];
+    uint8_t  coalesced_reads_num_completed;
+    bool     coalesced_reads_query_pending;
+    bool     coalesced_reads_single;
+    bool     read_multiple_variable_unsupported;
+
     uint16_t client_characteristic_configuration_handle;
     uint8_t  client_characteristic_configuration_value[2];
     
@@ -306,6 +324,8 @@ typedef struct gatt_client{
     uint8_t                     database_hash[16];
     bool                        database_hash_valid;
     uint16_t                    cache_id;
+    // - Discovery Cache: query served from cache
+    gatt_client_state_t         discovery_cache_query;
 #endif
 } gatt_client_t;
 
@@ -329,6 +349,27 @@ typedef struct {
     uint16_t connection_id;
 } gatt_client_service_notification_t;
 
+// Batched notifications for a single connection, see gatt_client_register_notification_batch
+typedef struct {
+    btstack_linked_item_t    item;
+    btstack_packet_handler_t callback;
+    hci_con_handle_t con_handle;
+    // GATT_EVENT_NOTIFICATION_BATCH is assembled in buffer
+    uint8_t * buffer;
+    uint16_t  buffer_size;
+    uint16_t  buffer_len;
+    uint8_t   num_notifications;
+} gatt_client_notification_batch_t;
+
+// Characteristic value read combined with other reads on the same connection, see gatt_client_read_value_of_characteristic_coalesced
+typedef struct {
+    btstack_linked_item_t    item;
+    btstack_packet_handler_t callback;
+    uint16_t value_handle;
+    // read with ATT Read Request, e.g. if value did not fit into Read Multiple Variable Response
+    bool     single;
+} gatt_client_coalesced_read_t;
+
 /* API_START */
 
 typedef struct {
@@ -827,7 +868,7 @@ uint8_t gatt_client_read_long_value_of_characteristic_using_value_handle_with_of
 uint8_t gatt_client_read_multiple_characteristic_values(btstack_packet_handler_t callback, hci_con_handle_t con_handle, int num_value_handles, uint16_t * value_handles);
 
 /*
- * @brief Read multiple varaible characteristic values. Only supported over LE Enhanced Bearer
+ * @brief Read multiple varaible characteristic values. Requires server support for ATT Read Multiple Variable Request
  * The all results are emitted via single GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT event,
  * followed by the GATT_EVENT_QUERY_COMPLETE event, which marks the end of read.
  * @param  callback
@@ -840,6 +881,22 @@ uint8_t gatt_client_read_multiple_characteristic_values(btstack_packet_handler_t
  */
 uint8_t gatt_client_read_multiple_variable_characteristic_values(btstack_packet_handler_t callback, hci_con_handle_t con_handle, int num_value_handles, uint16_t * value_handles);
 
+/**
+ * @brief Reads the characteristic value using the characteristic's value handle. Reads queued for the same connection
+ * are combined into ATT Read Multiple Variable Requests that fit the MTU. The results are emitted to the callback of each
+ * read as a single GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT event, followed by the GATT_EVENT_QUERY_COMPLETE event.
+ * Reads are sent with regular ATT Read Requests if the server does not support Read Multiple Variable, if a value
+ * does not fit into the response, or if the combined request failed.
+ * @param read struct used to store the request, must stay valid until GATT_EVENT_QUERY_COMPLETE
+ * @param callback
+ * @param con_handle
+ * @param value_handle
+ * @return status BTSTACK_MEMORY_ALLOC_FAILED, if no GATT client for con_handle is found
+ *                ERROR_CODE_SUCCESS         , if read is queued
+ */
+uint8_t gatt_client_read_value_of_characteristic_coalesced(gatt_client_coalesced_read_t * read, btstack_packet_handler_t callback,
+                                                           hci_con_handle_t con_handle, uint16_t value_handle);
+
 /**
  * @brief Writes the characteristic value using the characteristic's value handle without 
  * an acknowledgment that the write was successfully performed.
@@ -1238,6 +1295,33 @@ void gatt_client_listen_for_service_characteristic_value_updates(gatt_client_ser
  */
 void gatt_client_stop_listening_for_service_characteristic_value_updates(gatt_client_service_notification_t * notification);
 
+/**
+ * @brief Register for batched delivery of all notifications received on a connection.
+ * Notifications are collected in the provided buffer and emitted as GATT_EVENT_NOTIFICATION_BATCH
+ * when the next notification does not fit, on the next run loop iteration, or on disconnect.
+ * Notifications that do not fit into an empty batch are delivered as GATT_EVENT_NOTIFICATION.
+ * Indications and the regular characteristic value listeners are not affected.
+ * @param batch struct used to store registration
+ * @param callback
+ * @param con_handle
+ * @param buffer for GATT_EVENT_NOTIFICATION_BATCH, up to 257 bytes are used
+ * @param buffer_size
+ */
+void gatt_client_register_notification_batch(gatt_client_notification_batch_t * batch, btstack_packet_handler_t callback,
+                                             hci_con_handle_t con_handle, uint8_t * buffer, uint16_t buffer_size);
+
+/**
+ * @brief Emit collected notifications of a batch now
+ * @param batch struct used in gatt_client_register_notification_batch
+ */
+void gatt_client_flush_notification_batch(gatt_client_notification_batch_t * batch);
+
+/**
+ * @brief Stop batched delivery registered with gatt_client_register_notification_batch. Pending notifications are dropped.
+ * @param batch struct used in gatt_client_register_notification_batch
+ */
+void gatt_client_unregister_notification_batch(gatt_client_notification_batch_t * batch);
+
 
 /**
  * @brief Transactional write. It can be called as many times as it is needed to write the characteristics within the same transaction. 
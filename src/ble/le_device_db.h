@@ -108,6 +108,21 @@ int le_device_db_max_count(void);
  */
 void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk);
 
+/**
+ * @brief mark device as most recently used, e.g. after it was bonded or identified on connect
+ * @note optional, only used by SM and HCI if ENABLE_LE_DEVICE_DB_LAST_USED is defined
+ * @param index
+ */
+void le_device_db_mark_used(int index);
+
+/**
+ * @brief get order of use. Devices that have been bonded or marked as used more recently have a higher value
+ * @note optional, only used by SM and HCI if ENABLE_LE_DEVICE_DB_LAST_USED is defined
+ * @param index
+ * @return order of use or 0 if unknown
+ */
+uint32_t le_device_db_last_used_get(int index);
+
 
 /**
  * @brief set remote encryption info
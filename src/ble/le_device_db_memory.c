@@ -55,6 +55,9 @@ typedef struct le_device_memory_db {
     bd_addr_t addr;
     sm_key_t irk;
 
+    // order of use, higher for more recently bonded or used devices
+    uint32_t last_used;
+
     // Stored pairing information allows to re-establish an enncrypted connection
     // with a peripheral that doesn't have any persistent memory
     sm_key_t ltk;
@@ -82,6 +85,7 @@ typedef struct le_device_memory_db {
 #endif
 
 static le_device_memory_db_t le_devices[MAX_NR_LE_DEVICE_DB_ENTRIES];
+static uint32_t le_device_db_last_used;
 
 void le_device_db_init(void){
     int i;
@@ -131,6 +135,7 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     le_devices[index].addr_type = addr_type;
     (void)memcpy(le_devices[index].addr, addr, 6);
     (void)memcpy(le_devices[index].irk, irk, 16);
+    le_devices[index].last_used = ++le_device_db_last_used;
 #ifdef ENABLE_LE_SIGNED_WRITE
     le_devices[index].remote_counter = 0; 
 #endif
@@ -145,6 +150,16 @@ void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk)
     if (irk) (void)memcpy(irk, le_devices[index].irk, 16);
 }
 
+void le_device_db_mark_used(int index){
+    if (le_devices[index].addr_type == BD_ADDR_TYPE_UNKNOWN) return;
+    if (le_devices[index].last_used == le_device_db_last_used) return;
+    le_devices[index].last_used = ++le_device_db_last_used;
+}
+
+uint32_t le_device_db_last_used_get(int index){
+    return le_devices[index].last_used;
+}
+
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
     log_info("LE Device DB set encryption for %u, ediv x%04x, key size %u, authenticated %u, authorized %u, secure connection %u",
         index, ediv, key_size, authenticated, authorized, secure_connection);
@@ -54,7 +54,7 @@
 // Single stored entry
 typedef struct le_device_db_entry_t {
 
-    uint32_t seq_nr;    // used for "least recently stored" eviction strategy
+    uint32_t seq_nr;    // used for "least recently used" eviction strategy
 
     // Identification
     int addr_type;
@@ -97,6 +97,11 @@ typedef struct le_device_db_entry_t {
 static uint8_t  entry_map[NVM_NUM_DEVICE_DB_ENTRIES];
 static uint32_t num_valid_entries;
 
+// order of use is kept in RAM and only stored with the next update of the entry or before an entry gets replaced
+static uint32_t entry_seq_nr[NVM_NUM_DEVICE_DB_ENTRIES];
+static uint8_t  entry_seq_nr_dirty[NVM_NUM_DEVICE_DB_ENTRIES];
+static uint32_t highest_seq_nr;
+
 static const btstack_tlv_t * le_device_db_tlv_btstack_tlv_impl;
 static       void *          le_device_db_tlv_btstack_tlv_context;
 
@@ -128,11 +133,29 @@ static bool le_device_db_tlv_store(int index, le_device_db_entry_t * entry){
     btstack_assert(index >= 0);
     btstack_assert(index < NVM_NUM_DEVICE_DB_ENTRIES);
 
+    // store current order of use
+    entry->seq_nr = entry_seq_nr[index];
+    entry_seq_nr_dirty[index] = 0;
+
     uint32_t tag = le_device_db_tlv_tag_for_index(index);
     int result = le_device_db_tlv_btstack_tlv_impl->store_tag(le_device_db_tlv_btstack_tlv_context, tag, (uint8_t*) entry, sizeof(le_device_db_entry_t));
     return result == 0;
 }
 
+// store order of use for entries marked as used since their last update
+static void le_device_db_tlv_store_seq_nrs(void){
+    int i;
+    for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        if (entry_seq_nr_dirty[i] == 0u) continue;
+        le_device_db_entry_t entry;
+        if (!le_device_db_tlv_fetch(i, &entry)) continue;
+        bool ok = le_device_db_tlv_store(i, &entry);
+        if (!ok){
+            log_error("Store order of use failed");
+        }
+    }
+}
+
 // @param index = entry_pos
 static bool le_device_db_tlv_delete(int index){
     btstack_assert(le_device_db_tlv_btstack_tlv_impl != NULL);
@@ -147,13 +170,20 @@ static bool le_device_db_tlv_delete(int index){
 static void le_device_db_tlv_scan(void){
     int i;
     num_valid_entries = 0;
+    highest_seq_nr = 0;
     memset(entry_map, 0, sizeof(entry_map));
+    memset(entry_seq_nr, 0, sizeof(entry_seq_nr));
+    memset(entry_seq_nr_dirty, 0, sizeof(entry_seq_nr_dirty));
     for (i=0;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
         // lookup entry
         le_device_db_entry_t entry;
         if (!le_device_db_tlv_fetch(i, &entry)) continue;
 
         entry_map[i] = 1;
+        entry_seq_nr[i] = entry.seq_nr;
+        if (entry.seq_nr > highest_seq_nr){
+            highest_seq_nr = entry.seq_nr;
+        }
         num_valid_entries++;
     }
     log_info("num valid le device entries %u", (unsigned int) num_valid_entries);
@@ -191,6 +221,8 @@ void le_device_db_remove(int index){
 
 	// mark as unused
     entry_map[index] = 0;
+    entry_seq_nr[index] = 0;
+    entry_seq_nr_dirty[index] = 0;
 
     // keep track
     num_valid_entries--;
@@ -198,7 +230,6 @@ void le_device_db_remove(int index){
 
 int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
 
-    uint32_t highest_seq_nr = 0;
     uint32_t lowest_seq_nr  = 0xFFFFFFFFU;
     int index_for_lowest_seq_nr = -1;
     int index_for_addr  = -1;
@@ -215,14 +246,10 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
             if ((memcmp(addr, entry.addr, 6) == 0) && (addr_type == entry.addr_type)){
                 index_for_addr = i;
             }
-            // update highest seq nr
-            if (entry.seq_nr > highest_seq_nr){
-                highest_seq_nr = entry.seq_nr;
-            }
             // find entry with lowest seq nr
-            if ((index_for_lowest_seq_nr == -1) || (entry.seq_nr < lowest_seq_nr)){
+            if ((index_for_lowest_seq_nr == -1) || (entry_seq_nr[i] < lowest_seq_nr)){
                 index_for_lowest_seq_nr = i;
-                lowest_seq_nr = entry.seq_nr;
+                lowest_seq_nr = entry_seq_nr[i];
             }
         } else {
             index_for_empty = i;
@@ -239,6 +266,9 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
         index_to_use = index_for_empty;
     } else if (index_for_lowest_seq_nr >= 0){
         index_to_use = index_for_lowest_seq_nr;
+        // keep order of use of remaining entries for the next replacement
+        entry_seq_nr_dirty[index_to_use] = 0;
+        le_device_db_tlv_store_seq_nrs();
     } else {
         // should not happen
         return -1;
@@ -256,7 +286,8 @@ int le_device_db_add(int addr_type, bd_addr_t addr, sm_key_t irk){
     entry.addr_type = addr_type;
     (void)memcpy(entry.addr, addr, 6);
     (void)memcpy(entry.irk, irk, 16);
-    entry.seq_nr = highest_seq_nr + 1u;
+    highest_seq_nr++;
+    entry_seq_nr[index_to_use] = highest_seq_nr;
  #ifdef ENABLE_LE_SIGNED_WRITE
     entry.remote_counter = 0; 
 #endif
@@ -298,6 +329,26 @@ void le_device_db_info(int index, int * addr_type, bd_addr_t addr, sm_key_t irk)
     if (irk != NULL) (void)memcpy(irk, entry.irk, 16);
 }
 
+void le_device_db_mark_used(int index){
+    btstack_assert(index >= 0);
+    btstack_assert(index < NVM_NUM_DEVICE_DB_ENTRIES);
+    if (entry_map[index] == 0u) return;
+
+    // already most recently used
+    if (entry_seq_nr[index] == highest_seq_nr) return;
+
+    // avoid flash write on every connection, order is stored lazily
+    highest_seq_nr++;
+    entry_seq_nr[index] = highest_seq_nr;
+    entry_seq_nr_dirty[index] = 1;
+}
+
+uint32_t le_device_db_last_used_get(int index){
+    btstack_assert(index >= 0);
+    btstack_assert(index < NVM_NUM_DEVICE_DB_ENTRIES);
+    return entry_seq_nr[index];
+}
+
 void le_device_db_encryption_set(int index, uint16_t ediv, uint8_t rand[8], sm_key_t ltk, int key_size, int authenticated, int authorized, int secure_connection){
 
 	// fetch entry
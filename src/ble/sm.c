@@ -1310,6 +1310,17 @@ static int sm_stk_generation_init(sm_connection_t * sm_conn){
     return 0;
 }
 
+// bonded device identified on connect, keep it in Controller's resolving list if evicted before
+static void sm_le_device_db_entry_used(int le_db_index){
+    UNUSED(le_db_index);
+#ifdef ENABLE_LE_DEVICE_DB_LAST_USED
+    le_device_db_mark_used(le_db_index);
+#endif
+#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+    hci_touch_le_device_db_entry_in_resolving_list((uint16_t) le_db_index);
+#endif
+}
+
 static void sm_address_resolution_handle_event(address_resolution_event_t event){
 
     // cache and reset context
@@ -1348,6 +1359,7 @@ static void sm_address_resolution_handle_event(address_resolution_event_t event)
                     sm_connection->sm_irk_lookup_state = IRK_LOOKUP_SUCCEEDED;
                     sm_connection->sm_le_db_index = matched_device_id;
                     log_info("ADDRESS_RESOLUTION_SUCCEEDED, index %d", sm_connection->sm_le_db_index);
+                    sm_le_device_db_entry_used(matched_device_id);
 
                     le_device_db_encryption_get(sm_connection->sm_le_db_index, NULL, NULL, ltk, NULL, &authenticated, NULL, NULL);
                     have_ltk = !sm_is_null_key(ltk);
@@ -1598,6 +1610,9 @@ static void sm_process_bonding_information(sm_connection_t * sm_conn){
     }
 
     if (le_db_index >= 0){
+#ifdef ENABLE_LE_DEVICE_DB_LAST_USED
+        le_device_db_mark_used(le_db_index);
+#endif
 #ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
         hci_load_le_device_db_entry_into_resolving_list(le_db_index);
 #endif
@@ -1617,8 +1632,7 @@ static void sm_pairing_error(sm_connection_t * sm_conn, uint8_t reason){
 static void sm_remove_le_device_db_entry(uint16_t i) {
     le_device_db_remove(i);
 #ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
-    // to remove an entry from the resolving list requires its identity address, which was already deleted
-    // fully reload resolving list instead
+    // sync resolving list with le_device_db, entry gets removed via identity address stored in hci
     gap_load_resolving_list_from_le_device_db();
 #endif
 }
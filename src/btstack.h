@@ -85,6 +85,7 @@
 #include "ble/att_db_util.h"
 #include "ble/att_dispatch.h"
 #include "ble/att_server.h"
+#include "ble/gap_scan_cache.h"
 #include "ble/gatt-service/ancs_client.h"
 #include "ble/gatt-service/battery_service_client.h"
 #include "ble/gatt-service/battery_service_server.h"
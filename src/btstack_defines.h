@@ -1747,6 +1747,17 @@ typedef SSIZE_T ssize_t;
  */
 #define GATT_EVENT_SERVICE_CHANGED                               0xAFu
 
+/**
+ * @brief Several notifications for one connection, see gatt_client_register_notification_batch
+ * Each notification is stored as value_handle (16), value_length (16), value
+ * @format H1LV
+ * @param handle
+ * @param num_notifications
+ * @param notifications_length
+ * @param notifications
+ */
+#define GATT_EVENT_NOTIFICATION_BATCH                            0xB0u
+
 
 /** 
  * @format 1BH
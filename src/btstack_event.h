@@ -3396,6 +3396,45 @@ static inline uint16_t gatt_event_service_changed_get_attribute_handle_end(const
 }
 #endif
 
+#ifdef ENABLE_BLE
+/**
+ * @brief Get field handle from event GATT_EVENT_NOTIFICATION_BATCH
+ * @param event packet
+ * @return handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t gatt_event_notification_batch_get_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field num_notifications from event GATT_EVENT_NOTIFICATION_BATCH
+ * @param event packet
+ * @return num_notifications
+ * @note: btstack_type 1
+ */
+static inline uint8_t gatt_event_notification_batch_get_num_notifications(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field notifications_length from event GATT_EVENT_NOTIFICATION_BATCH
+ * @param event packet
+ * @return notifications_length
+ * @note: btstack_type L
+ */
+static inline uint16_t gatt_event_notification_batch_get_notifications_length(const uint8_t * event){
+    return little_endian_read_16(event, 5);
+}
+/**
+ * @brief Get field notifications from event GATT_EVENT_NOTIFICATION_BATCH
+ * @param event packet
+ * @return notifications
+ * @note: btstack_type V
+ */
+static inline const uint8_t * gatt_event_notification_batch_get_notifications(const uint8_t * event){
+    return &event[7];
+}
+#endif
+
 /**
  * @brief Get field address_type from event ATT_EVENT_CONNECTED
  * @param event packet
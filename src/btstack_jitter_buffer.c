@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_jitter_buffer.c"
+
+/*
+ *  btstack_jitter_buffer.c
+ *
+ */
+
+#include <string.h>
+
+#include "bluetooth.h"
+#include "btstack_debug.h"
+#include "btstack_jitter_buffer.h"
+#include "btstack_util.h"
+
+// smallest target depth
+#ifndef BTSTACK_JITTER_BUFFER_MIN_TARGET_MS
+#define BTSTACK_JITTER_BUFFER_MIN_TARGET_MS 40
+#endif
+
+// target depth before first underrun
+#ifndef BTSTACK_JITTER_BUFFER_INITIAL_TARGET_MS
+#define BTSTACK_JITTER_BUFFER_INITIAL_TARGET_MS 120
+#endif
+
+// largest target depth, frames above this are dropped
+#ifndef BTSTACK_JITTER_BUFFER_MAX_TARGET_MS
+#define BTSTACK_JITTER_BUFFER_MAX_TARGET_MS 300
+#endif
+
+// interval for decreasing the target depth if buffer level stayed high
+#ifndef BTSTACK_JITTER_BUFFER_ADAPTATION_WINDOW_MS
+#define BTSTACK_JITTER_BUFFER_ADAPTATION_WINDOW_MS 5000
+#endif
+
+// resampling correction if buffer level deviates from target, as fixed point value
+#ifndef BTSTACK_JITTER_BUFFER_RESAMPLING_CORRECTION
+#define BTSTACK_JITTER_BUFFER_RESAMPLING_CORRECTION 0x100
+#endif
+
+#define RESAMPLING_FACTOR_NOMINAL 0x10000
+
+static uint32_t btstack_jitter_buffer_frames_for_ms(const btstack_jitter_buffer_t * jitter_buffer, uint32_t duration_ms){
+    uint32_t samples_per_second_block = 1000u * jitter_buffer->samples_per_frame;
+    uint32_t num_frames = ((duration_ms * jitter_buffer->sample_rate) + samples_per_second_block - 1u) / samples_per_second_block;
+    return btstack_max(1, num_frames);
+}
+
+static void btstack_jitter_buffer_discard_bytes(btstack_jitter_buffer_t * jitter_buffer, uint16_t num_bytes){
+    uint8_t buffer[16];
+    while (num_bytes > 0u){
+        uint32_t bytes_read;
+        uint16_t bytes_to_read = (uint16_t) btstack_min(num_bytes, sizeof(buffer));
+        btstack_ring_buffer_read(&jitter_buffer->ring_buffer, buffer, bytes_to_read, &bytes_read);
+        num_bytes -= bytes_to_read;
+    }
+}
+
+static uint16_t btstack_jitter_buffer_read_frame_header(btstack_jitter_buffer_t * jitter_buffer){
+    uint8_t header[BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE];
+    uint32_t bytes_read;
+    btstack_ring_buffer_read(&jitter_buffer->ring_buffer, header, sizeof(header), &bytes_read);
+    btstack_assert(bytes_read == sizeof(header));
+    jitter_buffer->num_frames--;
+    return little_endian_read_16(header, 0);
+}
+
+static void btstack_jitter_buffer_drop_oldest_frame(btstack_jitter_buffer_t * jitter_buffer){
+    uint16_t frame_size = btstack_jitter_buffer_read_frame_header(jitter_buffer);
+    btstack_jitter_buffer_discard_bytes(jitter_buffer, frame_size);
+    jitter_buffer->statistics.frames_dropped++;
+}
+
+static void btstack_jitter_buffer_store_frame(btstack_jitter_buffer_t * jitter_buffer, const uint8_t * frame, uint16_t frame_size){
+    uint32_t bytes_required = BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE + frame_size;
+    while (btstack_ring_buffer_bytes_free(&jitter_buffer->ring_buffer) < bytes_required){
+        btstack_jitter_buffer_drop_oldest_frame(jitter_buffer);
+    }
+    uint8_t header[BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE];
+    little_endian_store_16(header, 0, frame_size);
+    btstack_ring_buffer_write(&jitter_buffer->ring_buffer, header, sizeof(header));
+    if (frame_size > 0u){
+        btstack_ring_buffer_write(&jitter_buffer->ring_buffer, (uint8_t *) frame, frame_size);
+    }
+    jitter_buffer->num_frames++;
+}
+
+static void btstack_jitter_buffer_restart_adaptation_window(btstack_jitter_buffer_t * jitter_buffer){
+    jitter_buffer->window_frames_played = 0;
+    jitter_buffer->window_min_frames = jitter_buffer->num_frames;
+}
+
+static void btstack_jitter_buffer_discard_frames(btstack_jitter_buffer_t * jitter_buffer){
+    btstack_ring_buffer_reset(&jitter_buffer->ring_buffer);
+    jitter_buffer->num_frames = 0;
+    jitter_buffer->playing = false;
+    jitter_buffer->sequence_valid = false;
+    jitter_buffer->sample_rate_compensation_active = false;
+}
+
+void btstack_jitter_buffer_init(btstack_jitter_buffer_t * jitter_buffer, uint8_t * storage, uint32_t storage_size,
+                                uint32_t sample_rate, uint16_t samples_per_frame){
+    btstack_assert(sample_rate > 0u);
+    btstack_assert(samples_per_frame > 0u);
+
+    memset(jitter_buffer, 0, sizeof(btstack_jitter_buffer_t));
+    btstack_ring_buffer_init(&jitter_buffer->ring_buffer, storage, storage_size);
+    jitter_buffer->sample_rate = sample_rate;
+    jitter_buffer->samples_per_frame = samples_per_frame;
+    jitter_buffer->playback_sample_rate = sample_rate;
+    jitter_buffer->sample_rate_ratio = RESAMPLING_FACTOR_NOMINAL;
+    jitter_buffer->frames_per_packet = 1;
+
+    jitter_buffer->min_target_frames = (uint16_t) btstack_jitter_buffer_frames_for_ms(jitter_buffer, BTSTACK_JITTER_BUFFER_MIN_TARGET_MS);
+    jitter_buffer->max_target_frames = (uint16_t) btstack_jitter_buffer_frames_for_ms(jitter_buffer, BTSTACK_JITTER_BUFFER_MAX_TARGET_MS);
+    jitter_buffer->target_frames     = (uint16_t) btstack_jitter_buffer_frames_for_ms(jitter_buffer, BTSTACK_JITTER_BUFFER_INITIAL_TARGET_MS);
+    jitter_buffer->window_frames     = btstack_jitter_buffer_frames_for_ms(jitter_buffer, BTSTACK_JITTER_BUFFER_ADAPTATION_WINDOW_MS);
+}
+
+void btstack_jitter_buffer_reset(btstack_jitter_buffer_t * jitter_buffer){
+    btstack_jitter_buffer_discard_frames(jitter_buffer);
+    btstack_jitter_buffer_restart_adaptation_window(jitter_buffer);
+}
+
+void btstack_jitter_buffer_set_playback_sample_rate(btstack_jitter_buffer_t * jitter_buffer, uint32_t playback_sample_rate){
+    jitter_buffer->playback_sample_rate = playback_sample_rate;
+}
+
+static void btstack_jitter_buffer_update_sample_rate_compensation(btstack_jitter_buffer_t * jitter_buffer, uint32_t receive_time_ms, uint32_t num_samples){
+    if (jitter_buffer->playing == false){
+        return;
+    }
+    if (jitter_buffer->sample_rate_compensation_active == false){
+        // start measurement with last known ratio
+        jitter_buffer->sample_rate_compensation_active = true;
+        btstack_sample_rate_compensation_init(&jitter_buffer->sample_rate_compensation, receive_time_ms,
+                                              jitter_buffer->sample_rate, jitter_buffer->sample_rate_ratio >> 1);
+        return;
+    }
+    jitter_buffer->sample_rate_ratio = btstack_sample_rate_compensation_update(&jitter_buffer->sample_rate_compensation,
+                                                                               receive_time_ms, num_samples, jitter_buffer->playback_sample_rate);
+}
+
+uint8_t btstack_jitter_buffer_write_packet(btstack_jitter_buffer_t * jitter_buffer, uint16_t sequence_number, uint32_t timestamp,
+                                           uint32_t receive_time_ms, const uint8_t * frames, uint16_t size, uint8_t num_frames){
+    if ((num_frames == 0u) || ((size % num_frames) != 0u)){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    uint16_t frame_size = size / num_frames;
+    if (((uint32_t) num_frames * (BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE + frame_size)) > jitter_buffer->ring_buffer.size){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    jitter_buffer->statistics.packets_received++;
+    jitter_buffer->frames_per_packet = num_frames;
+
+    if (jitter_buffer->sequence_valid){
+        int16_t  sequence_delta  = (int16_t)(sequence_number - jitter_buffer->next_sequence_number);
+        int32_t  timestamp_delta = (int32_t)(timestamp - jitter_buffer->next_timestamp);
+        if (sequence_delta < 0){
+            if (timestamp_delta < 0){
+                // late or duplicate, frames have been played or concealed already
+                jitter_buffer->statistics.packets_late++;
+                return ERROR_CODE_SUCCESS;
+            }
+            // sequence number jumped back, source restarted stream
+            log_info("sequence number %u, expected %u: resync", sequence_number, jitter_buffer->next_sequence_number);
+            jitter_buffer->statistics.resyncs++;
+            btstack_jitter_buffer_discard_frames(jitter_buffer);
+        } else if (sequence_delta > 0){
+            jitter_buffer->statistics.packets_lost += (uint16_t) sequence_delta;
+            // prefer number of missing frames from RTP timestamp, fallback to frames per packet
+            uint32_t frames_lost;
+            if (timestamp_delta > 0){
+                frames_lost = ((uint32_t) timestamp_delta) / jitter_buffer->samples_per_frame;
+            } else {
+                frames_lost = ((uint32_t) sequence_delta) * num_frames;
+            }
+            if (frames_lost > jitter_buffer->max_target_frames){
+                log_info("%u frames lost: resync", (unsigned int) frames_lost);
+                jitter_buffer->statistics.resyncs++;
+                btstack_jitter_buffer_discard_frames(jitter_buffer);
+            } else {
+                while (frames_lost > 0u){
+                    btstack_jitter_buffer_store_frame(jitter_buffer, NULL, 0);
+                    frames_lost--;
+                }
+            }
+        } else {
+            // in sequence
+        }
+    }
+
+    jitter_buffer->sequence_valid = true;
+    jitter_buffer->next_sequence_number = sequence_number + 1u;
+    jitter_buffer->next_timestamp = timestamp + ((uint32_t) num_frames * jitter_buffer->samples_per_frame);
+
+    uint8_t i;
+    for (i = 0; i < num_frames; i++){
+        btstack_jitter_buffer_store_frame(jitter_buffer, &frames[i * frame_size], frame_size);
+    }
+
+    if (jitter_buffer->playing){
+        // limit latency, e.g. after burst
+        if (jitter_buffer->num_frames > jitter_buffer->max_target_frames){
+            while (jitter_buffer->num_frames > jitter_buffer->target_frames){
+                btstack_jitter_buffer_drop_oldest_frame(jitter_buffer);
+            }
+        }
+    } else if (jitter_buffer->num_frames >= jitter_buffer->target_frames){
+        log_info("start playback with %u frames", jitter_buffer->num_frames);
+        jitter_buffer->playing = true;
+        btstack_jitter_buffer_restart_adaptation_window(jitter_buffer);
+    } else {
+        // wait for target depth
+    }
+
+    jitter_buffer->statistics.max_buffered_frames = (uint16_t) btstack_max(jitter_buffer->statistics.max_buffered_frames, jitter_buffer->num_frames);
+
+    btstack_jitter_buffer_update_sample_rate_compensation(jitter_buffer, receive_time_ms, (uint32_t) num_frames * jitter_buffer->samples_per_frame);
+    return ERROR_CODE_SUCCESS;
+}
+
+static void btstack_jitter_buffer_handle_underrun(btstack_jitter_buffer_t * jitter_buffer){
+    jitter_buffer->statistics.underruns++;
+    jitter_buffer->playing = false;
+    // increase target depth by half, at least one packet
+    uint32_t increment = btstack_max(jitter_buffer->target_frames / 2u, jitter_buffer->frames_per_packet);
+    jitter_buffer->target_frames = (uint16_t) btstack_min(jitter_buffer->target_frames + increment, jitter_buffer->max_target_frames);
+    log_info("underrun, new target %u frames", jitter_buffer->target_frames);
+}
+
+static void btstack_jitter_buffer_adapt_target(btstack_jitter_buffer_t * jitter_buffer){
+    jitter_buffer->window_min_frames = (uint16_t) btstack_min(jitter_buffer->window_min_frames, jitter_buffer->num_frames);
+    jitter_buffer->window_frames_played++;
+    if (jitter_buffer->window_frames_played < jitter_buffer->window_frames){
+        return;
+    }
+    // keep one packet as reserve and decrease target by half of the unused frames
+    if (jitter_buffer->window_min_frames > jitter_buffer->frames_per_packet){
+        uint32_t decrement = btstack_max(1, (jitter_buffer->window_min_frames - jitter_buffer->frames_per_packet) / 2u);
+        uint32_t target_frames = jitter_buffer->target_frames;
+        if (target_frames > (jitter_buffer->min_target_frames + decrement)){
+            target_frames -= decrement;
+        } else {
+            target_frames = jitter_buffer->min_target_frames;
+        }
+        jitter_buffer->target_frames = (uint16_t) target_frames;
+    }
+    btstack_jitter_buffer_restart_adaptation_window(jitter_buffer);
+}
+
+btstack_jitter_buffer_read_status_t btstack_jitter_buffer_read_frame(btstack_jitter_buffer_t * jitter_buffer, uint8_t * buffer,
+                                                                     uint16_t buffer_size, uint16_t * frame_size){
+    *frame_size = 0;
+    if (jitter_buffer->playing == false){
+        return BTSTACK_JITTER_BUFFER_READ_EMPTY;
+    }
+    if (jitter_buffer->num_frames == 0u){
+        btstack_jitter_buffer_handle_underrun(jitter_buffer);
+        return BTSTACK_JITTER_BUFFER_READ_EMPTY;
+    }
+
+    uint16_t size = btstack_jitter_buffer_read_frame_header(jitter_buffer);
+    btstack_jitter_buffer_adapt_target(jitter_buffer);
+
+    if (size == 0u){
+        jitter_buffer->statistics.frames_concealed++;
+        return BTSTACK_JITTER_BUFFER_READ_MISSING;
+    }
+
+    if (size > buffer_size){
+        log_error("frame size %u > buffer size %u", size, buffer_size);
+        btstack_jitter_buffer_discard_bytes(jitter_buffer, size);
+        jitter_buffer->statistics.frames_concealed++;
+        return BTSTACK_JITTER_BUFFER_READ_MISSING;
+    }
+
+    uint32_t bytes_read;
+    btstack_ring_buffer_read(&jitter_buffer->ring_buffer, buffer, size, &bytes_read);
+    *frame_size = size;
+    jitter_buffer->statistics.frames_played++;
+    return BTSTACK_JITTER_BUFFER_READ_FRAME;
+}
+
+bool btstack_jitter_buffer_is_playing(const btstack_jitter_buffer_t * jitter_buffer){
+    return jitter_buffer->playing;
+}
+
+uint32_t btstack_jitter_buffer_get_resampling_factor(const btstack_jitter_buffer_t * jitter_buffer){
+    uint32_t factor = jitter_buffer->sample_rate_ratio;
+    uint16_t hysteresis = jitter_buffer->frames_per_packet;
+    if ((jitter_buffer->num_frames + hysteresis) < jitter_buffer->target_frames){
+        factor -= BTSTACK_JITTER_BUFFER_RESAMPLING_CORRECTION;    // stretch samples
+    } else if (jitter_buffer->num_frames > (jitter_buffer->target_frames + hysteresis)){
+        factor += BTSTACK_JITTER_BUFFER_RESAMPLING_CORRECTION;    // compress samples
+    } else {
+        // within target range
+    }
+    return factor;
+}
+
+uint16_t btstack_jitter_buffer_get_num_frames(const btstack_jitter_buffer_t * jitter_buffer){
+    return jitter_buffer->num_frames;
+}
+
+uint32_t btstack_jitter_buffer_get_latency_ms(const btstack_jitter_buffer_t * jitter_buffer){
+    return ((uint32_t) jitter_buffer->num_frames * jitter_buffer->samples_per_frame * 1000u) / jitter_buffer->sample_rate;
+}
+
+void btstack_jitter_buffer_get_statistics(const btstack_jitter_buffer_t * jitter_buffer, btstack_jitter_buffer_statistics_t * statistics){
+    *statistics = jitter_buffer->statistics;
+    statistics->buffered_frames = jitter_buffer->num_frames;
+    statistics->target_frames   = jitter_buffer->target_frames;
+}
+
+void btstack_jitter_buffer_reset_statistics(btstack_jitter_buffer_t * jitter_buffer){
+    memset(&jitter_buffer->statistics, 0, sizeof(btstack_jitter_buffer_statistics_t));
+}
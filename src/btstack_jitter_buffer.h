@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title Jitter Buffer
+ *
+ * Adaptive jitter buffer for received media frames, e.g. SBC frames from an A2DP Sink stream.
+ *
+ * Media packets are stored together with their RTP sequence number and timestamp. Lost packets are
+ * detected by gaps in the sequence number and replaced by placeholders, which are reported as missing
+ * frames during playback so that the application can conceal them. Late or duplicate packets are dropped.
+ *
+ * Playback starts as soon as the target depth has been buffered. The target depth is increased after
+ * an underrun and decreased slowly if the buffer level did not drop close to zero for a while.
+ * The buffer level is kept at the target depth by a resampling factor that combines the measured
+ * sample rate drift (see btstack_sample_rate_compensation) with a correction based on the buffer level.
+ *
+ */
+
+#ifndef BTSTACK_JITTER_BUFFER_H
+#define BTSTACK_JITTER_BUFFER_H
+
+#include <stdint.h>
+
+#include "btstack_bool.h"
+#include "btstack_ring_buffer.h"
+#include "btstack_sample_rate_compensation.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// storage overhead per frame
+#define BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE 2
+
+typedef enum {
+    BTSTACK_JITTER_BUFFER_READ_FRAME = 0,   // frame available
+    BTSTACK_JITTER_BUFFER_READ_MISSING,     // frame lost, conceal
+    BTSTACK_JITTER_BUFFER_READ_EMPTY        // buffering or underrun, play silence
+} btstack_jitter_buffer_read_status_t;
+
+typedef struct {
+    uint32_t packets_received;
+    uint32_t packets_lost;
+    uint32_t packets_late;
+    uint32_t frames_played;
+    uint32_t frames_concealed;
+    uint32_t frames_dropped;
+    uint32_t underruns;
+    uint32_t resyncs;
+    uint16_t buffered_frames;
+    uint16_t target_frames;
+    uint16_t max_buffered_frames;
+} btstack_jitter_buffer_statistics_t;
+
+typedef struct {
+    // frames stored as little endian 16-bit length + data, length 0 for missing frame
+    btstack_ring_buffer_t ring_buffer;
+
+    uint32_t sample_rate;
+    uint16_t samples_per_frame;
+
+    // target depth in frames
+    uint16_t min_target_frames;
+    uint16_t max_target_frames;
+    uint16_t target_frames;
+
+    uint16_t num_frames;
+    uint16_t frames_per_packet;
+    bool     playing;
+
+    // RTP
+    bool     sequence_valid;
+    uint16_t next_sequence_number;
+    uint32_t next_timestamp;
+
+    // target adaptation
+    uint32_t window_frames;
+    uint32_t window_frames_played;
+    uint16_t window_min_frames;
+
+    // resampling
+    btstack_sample_rate_compensation_t sample_rate_compensation;
+    bool     sample_rate_compensation_active;
+    uint32_t playback_sample_rate;
+    uint32_t sample_rate_ratio;
+
+    btstack_jitter_buffer_statistics_t statistics;
+} btstack_jitter_buffer_t;
+
+/* API_START */
+
+/**
+ * @brief Init jitter buffer
+ * @param jitter_buffer
+ * @param storage for frames, each frame requires BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE additional bytes
+ * @param storage_size in bytes
+ * @param sample_rate of media stream
+ * @param samples_per_frame per channel, used to convert RTP timestamps into frames
+ */
+void btstack_jitter_buffer_init(btstack_jitter_buffer_t * jitter_buffer, uint8_t * storage, uint32_t storage_size,
+                                uint32_t sample_rate, uint16_t samples_per_frame);
+
+/**
+ * @brief Discard buffered frames and wait for target depth before playback, e.g. when stream gets suspended
+ * @note Target depth and statistics are kept
+ * @param jitter_buffer
+ */
+void btstack_jitter_buffer_reset(btstack_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Set current sample rate of audio playback used for sample rate compensation
+ * @note Defaults to nominal sample rate of media stream
+ * @param jitter_buffer
+ * @param playback_sample_rate
+ */
+void btstack_jitter_buffer_set_playback_sample_rate(btstack_jitter_buffer_t * jitter_buffer, uint32_t playback_sample_rate);
+
+/**
+ * @brief Store media packet
+ * @param jitter_buffer
+ * @param sequence_number from RTP header
+ * @param timestamp from RTP header
+ * @param receive_time_ms of packet, e.g. from btstack_run_loop_get_time_ms()
+ * @param frames with equal size
+ * @param size of all frames
+ * @param num_frames in packet
+ * @return status ERROR_CODE_SUCCESS if packet was stored or dropped as late/duplicate,
+ *                ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if size is not multiple of num_frames,
+ *                ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if packet does not fit into storage
+ */
+uint8_t btstack_jitter_buffer_write_packet(btstack_jitter_buffer_t * jitter_buffer, uint16_t sequence_number, uint32_t timestamp,
+                                           uint32_t receive_time_ms, const uint8_t * frames, uint16_t size, uint8_t num_frames);
+
+/**
+ * @brief Get next frame for playback
+ * @param jitter_buffer
+ * @param buffer for frame
+ * @param buffer_size
+ * @param frame_size of returned frame
+ * @return status, see btstack_jitter_buffer_read_status_t
+ */
+btstack_jitter_buffer_read_status_t btstack_jitter_buffer_read_frame(btstack_jitter_buffer_t * jitter_buffer, uint8_t * buffer,
+                                                                     uint16_t buffer_size, uint16_t * frame_size);
+
+/**
+ * @brief Check if target depth was reached and playback should be running
+ * @param jitter_buffer
+ * @return true if playing
+ */
+bool btstack_jitter_buffer_is_playing(const btstack_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get resampling factor that keeps buffer level at target depth
+ * @param jitter_buffer
+ * @return factor as fixed point value, identity is 0x10000, see btstack_resample_set_factor
+ */
+uint32_t btstack_jitter_buffer_get_resampling_factor(const btstack_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get number of buffered frames
+ * @param jitter_buffer
+ * @return num frames including missing frames
+ */
+uint16_t btstack_jitter_buffer_get_num_frames(const btstack_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get current latency caused by buffered frames
+ * @param jitter_buffer
+ * @return latency in ms
+ */
+uint32_t btstack_jitter_buffer_get_latency_ms(const btstack_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get statistics
+ * @param jitter_buffer
+ * @param statistics
+ */
+void btstack_jitter_buffer_get_statistics(const btstack_jitter_buffer_t * jitter_buffer, btstack_jitter_buffer_statistics_t * statistics);
+
+/**
+ * @brief Reset statistic counters
+ * @param jitter_buffer
+ */
+void btstack_jitter_buffer_reset_statistics(btstack_jitter_buffer_t * jitter_buffer);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // BTSTACK_JITTER_BUFFER_H
@@ -1186,6 +1186,64 @@ void btstack_memory_avrcp_browsing_connection_free(avrcp_browsing_connection_t *
 #endif
 #ifdef ENABLE_BLE
 
+// MARK: att_server_request_t
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_ATT_SERVER_REQUESTS)
+    #if defined(MAX_NO_ATT_SERVER_REQUESTS)
+        #error "Deprecated MAX_NO_ATT_SERVER_REQUESTS defined instead of MAX_NR_ATT_SERVER_REQUESTS. Please update your btstack_config.h to use MAX_NR_ATT_SERVER_REQUESTS."
+    #else
+        #define MAX_NR_ATT_SERVER_REQUESTS 0
+    #endif
+#endif
+
+#ifdef MAX_NR_ATT_SERVER_REQUESTS
+#if MAX_NR_ATT_SERVER_REQUESTS > 0
+static att_server_request_t att_server_request_storage[MAX_NR_ATT_SERVER_REQUESTS];
+static btstack_memory_pool_t att_server_request_pool;
+att_server_request_t * btstack_memory_att_server_request_get(void){
+    void * buffer = btstack_memory_pool_get(&att_server_request_pool);
+    if (buffer){
+        memset(buffer, 0, sizeof(att_server_request_t));
+    }
+    return (att_server_request_t *) buffer;
+}
+void btstack_memory_att_server_request_free(att_server_request_t *att_server_request){
+    btstack_memory_pool_free(&att_server_request_pool, att_server_request);
+}
+#else
+att_server_request_t * btstack_memory_att_server_request_get(void){
+    return NULL;
+}
+void btstack_memory_att_server_request_free(att_server_request_t *att_server_request){
+    UNUSED(att_server_request);
+}
+#endif
+#elif defined(HAVE_MALLOC)
+
+typedef struct {
+    btstack_memory_buffer_t tracking;
+    att_server_request_t data;
+} btstack_memory_att_server_request_t;
+
+att_server_request_t * btstack_memory_att_server_request_get(void){
+    btstack_memory_att_server_request_t * buffer = (btstack_memory_att_server_request_t *) malloc(sizeof(btstack_memory_att_server_request_t));
+    if (buffer){
+        memset(buffer, 0, sizeof(btstack_memory_att_server_request_t));
+        btstack_memory_tracking_add(&buffer->tracking);
+        return &buffer->data;
+    } else {
+        return NULL;
+    }
+}
+void btstack_memory_att_server_request_free(att_server_request_t *att_server_request){
+    // reconstruct buffer start
+    btstack_memory_att_server_request_t *buffer = (btstack_memory_att_server_request_t *)
+        ((uint8_t *)att_server_request - offsetof(btstack_memory_att_server_request_t, data));
+    btstack_memory_tracking_remove(&buffer->tracking);
+    free(buffer);
+}
+#endif
+
+
 // MARK: battery_service_client_t
 #if !defined(HAVE_MALLOC) && !defined(MAX_NR_BATTERY_SERVICE_CLIENTS)
     #if defined(MAX_NO_BATTERY_SERVICE_CLIENTS)
@@ -2083,6 +2141,9 @@ void btstack_memory_init(void){
 
 #endif
 #ifdef ENABLE_BLE
+#if MAX_NR_ATT_SERVER_REQUESTS > 0
+    btstack_memory_pool_create(&att_server_request_pool, att_server_request_storage, MAX_NR_ATT_SERVER_REQUESTS, sizeof(att_server_request_t));
+#endif
 #if MAX_NR_BATTERY_SERVICE_CLIENTS > 0
     btstack_memory_pool_create(&battery_service_client_pool, battery_service_client_storage, MAX_NR_BATTERY_SERVICE_CLIENTS, sizeof(battery_service_client_t));
 #endif
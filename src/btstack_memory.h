@@ -153,6 +153,8 @@ void   btstack_memory_avrcp_browsing_connection_free(avrcp_browsing_connection_t
 
 #endif
 #ifdef ENABLE_BLE
+att_server_request_t * btstack_memory_att_server_request_get(void);
+void   btstack_memory_att_server_request_free(att_server_request_t *att_server_request);
 battery_service_client_t * btstack_memory_battery_service_client_get(void);
 void   btstack_memory_battery_service_client_free(battery_service_client_t *battery_service_client);
 gatt_client_t * btstack_memory_gatt_client_get(void);
@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "btstack_resample_polyphase.c"
+
+/*
+ *  btstack_resample_polyphase.c
+ *
+ *  Windowed-sinc polyphase filter with linear interpolation between adjacent phases.
+ *  Coefficient tables generated by tool/resample_polyphase_table_generator.py
+ */
+
+#include <string.h>
+
+#include "btstack_bool.h"
+#include "btstack_debug.h"
+#include "btstack_resample_polyphase.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define NUM_PHASES_BITS        6
+#define NUM_PHASES             (1u << NUM_PHASES_BITS)
+#define PHASE_FRACTION_BITS    (16u - NUM_PHASES_BITS)
+#define COEFFICIENT_SHIFT      14
+
+// 8 taps, cutoff 0.38 * sample rate, kaiser beta 5.0
+static const int16_t btstack_resample_polyphase_coefficients_8[] = {
+       309,  -1438,   3098,  12446,   3098,  -1438,    309,      0,
+       311,  -1409,   2914,  12448,   3285,  -1467,    306,     -4,
+       312,  -1378,   2733,  12436,   3474,  -1493,    303,     -3,
+       312,  -1346,   2554,  12420,   3665,  -1518,    298,     -1,
+       312,  -1312,   2377,  12397,   3857,  -1541,    293,      1,
+       311,  -1278,   2204,  12366,   4052,  -1562,    287,      4,
+       310,  -1242,   2034,  12328,   4248,  -1581,    281,      6,
+       307,  -1206,   1867,  12286,   4446,  -1598,    273,      9,
+       305,  -1169,   1703,  12236,   4645,  -1612,    264,     12,
+       302,  -1131,   1543,  12180,   4845,  -1625,    255,     15,
+       298,  -1092,   1386,  12117,   5047,  -1635,    244,     19,
+       294,  -1053,   1232,  12049,   5249,  -1642,    233,     22,
+       289,  -1014,   1083,  11975,   5452,  -1647,    220,     26,
+       284,   -974,    937,  11894,   5655,  -1650,    207,     31,
+       279,   -934,    795,  11807,   5859,  -1649,    192,     35,
+       273,   -893,    656,  11715,   6063,  -1646,    177,     39,
+       267,   -853,    522,  11618,   6266,  -1640,    160,     44,
+       261,   -812,    391,  11513,   6470,  -1630,    142,     49,
+       254,   -772,    265,  11403,   6673,  -1618,    124,     55,
+       247,   -732,    143,  11289,   6875,  -1602,    104,     60,
+       240,   -692,     24,  11169,   7077,  -1583,     83,     66,
+       233,   -652,    -90,  11043,   7277,  -1560,     61,     72,
+       226,   -612,   -200,  10913,   7476,  -1535,     38,     78,
+       218,   -573,   -306,  10778,   7674,  -1505,     14,     84,
+       211,   -534,   -407,  10636,   7870,  -1472,    -11,     91,
+       203,   -496,   -505,  10492,   8065,  -1435,    -37,     97,
+       195,   -458,   -598,  10343,   8257,  -1395,    -64,    104,
+       187,   -421,   -687,  10188,   8448,  -1350,    -92,    111,
+       179,   -385,   -772,  10032,   8635,  -1302,   -121,    118,
+       172,   -349,   -853,   9868,   8821,  -1250,   -151,    126,
+       164,   -314,   -929,   9702,   9003,  -1194,   -181,    133,
+       156,   -279,  -1001,   9531,   9183,  -1134,   -213,    141,
+       148,   -246,  -1070,   9361,   9359,  -1070,   -246,    148,
+       141,   -213,  -1134,   9183,   9531,  -1001,   -279,    156,
+       133,   -181,  -1194,   9003,   9702,   -929,   -314,    164,
+       126,   -151,  -1250,   8821,   9868,   -853,   -349,    172,
+       118,   -121,  -1302,   8635,  10032,   -772,   -385,    179,
+       111,    -92,  -1350,   8448,  10188,   -687,   -421,    187,
+       104,    -64,  -1395,   8257,  10343,   -598,   -458,    195,
+        97,    -37,  -1435,   8065,  10492,   -505,   -496,    203,
+        91,    -11,  -1472,   7870,  10636,   -407,   -534,    211,
+        84,     14,  -1505,   7674,  10778,   -306,   -573,    218,
+        78,     38,  -1535,   7476,  10913,   -200,   -612,    226,
+        72,     61,  -1560,   7277,  11043,    -90,   -652,    233,
+        66,     83,  -1583,   7077,  11169,     24,   -692,    240,
+        60,    104,  -1602,   6875,  11289,    143,   -732,    247,
+        55,    124,  -1618,   6673,  11403,    265,   -772,    254,
+        49,    142,  -1630,   6470,  11513,    391,   -812,    261,
+        44,    160,  -1640,   6266,  11618,    522,   -853,    267,
+        39,    177,  -1646,   6063,  11715,    656,   -893,    273,
+        35,    192,  -1649,   5859,  11807,    795,   -934,    279,
+        31,    207,  -1650,   5655,  11894,    937,   -974,    284,
+        26,    220,  -1647,   5452,  11975,   1083,  -1014,    289,
+        22,    233,  -1642,   5249,  12049,   1232,  -1053,    294,
+        19,    244,  -1635,   5047,  12117,   1386,  -1092,    298,
+        15,    255,  -1625,   4845,  12180,   1543,  -1131,    302,
+        12,    264,  -1612,   4645,  12236,   1703,  -1169,    305,
+         9,    273,  -1598,   4446,  12286,   1867,  -1206,    307,
+         6,    281,  -1581,   4248,  12328,   2034,  -1242,    310,
+         4,    287,  -1562,   4052,  12366,   2204,  -1278,    311,
+         1,    293,  -1541,   3857,  12397,   2377,  -1312,    312,
+        -1,    298,  -1518,   3665,  12420,   2554,  -1346,    312,
+        -3,    303,  -1493,   3474,  12436,   2733,  -1378,    312,
+        -4,    306,  -1467,   3285,  12448,   2914,  -1409,    311,
+         0,    309,  -1438,   3098,  12446,   3098,  -1438,    309,
+};
+
+// 16 taps, cutoff 0.45 * sample rate, kaiser beta 7.0
+static const int16_t btstack_resample_polyphase_coefficients_16[] = {
+        24,    -96,    256,   -523,    878,  -1248,   1531,  14740,
+      1531,  -1248,    878,   -523,    256,    -96,     24,      0,
+        24,    -96,    252,   -510,    840,  -1158,   1299,  14738,
+      1769,  -1337,    914,   -536,    259,    -96,     24,     -2,
+        24,    -95,    248,   -495,    801,  -1068,   1072,  14725,
+      2010,  -1426,    950,   -548,    261,    -96,     23,     -2,
+        24,    -95,    244,   -480,    762,   -977,    851,  14698,
+      2257,  -1514,    984,   -559,    264,    -96,     23,     -2,
+        24,    -94,    239,   -464,    722,   -887,    635,  14664,
+      2507,  -1600,   1017,   -570,    265,    -95,     23,     -2,
+        24,    -93,    234,   -448,    681,   -796,    425,  14618,
+      2762,  -1685,   1049,   -579,    266,    -94,     22,     -2,
+        24,    -91,    228,   -431,    639,   -706,    220,  14564,
+      3021,  -1769,   1079,   -587,    267,    -93,     21,     -2,
+        24,    -90,    222,   -413,    597,   -617,     22,  14500,
+      3283,  -1851,   1107,   -594,    267,    -92,     21,     -2,
+        24,    -88,    216,   -395,    555,   -528,   -171,  14426,
+      3549,  -1931,   1134,   -601,    266,    -90,     20,     -2,
+        23,    -87,    209,   -377,    512,   -440,   -357,  14344,
+      3817,  -2009,   1159,   -605,    265,    -88,     19,     -1,
+        23,    -85,    203,   -358,    470,   -353,   -536,  14248,
+      4089,  -2084,   1182,   -609,    263,    -86,     18,     -1,
+        23,    -83,    195,   -339,    427,   -267,   -709,  14148,
+      4363,  -2157,   1203,   -612,    260,    -84,     17,     -1,
+        22,    -81,    188,   -319,    384,   -183,   -876,  14039,
+      4639,  -2228,   1222,   -613,    257,    -81,     15,     -1,
+        22,    -79,    181,   -300,    341,    -99,  -1036,  13917,
+      4918,  -2295,   1238,   -613,    253,    -78,     14,      0,
+        21,    -76,    173,   -280,    299,    -18,  -1189,  13787,
+      5198,  -2359,   1253,   -612,    249,    -75,     13,      0,
+        21,    -74,    165,   -260,    257,     62,  -1335,  13651,
+      5479,  -2420,   1265,   -610,    244,    -72,     11,      0,
+        20,    -71,    157,   -240,    215,    140,  -1474,  13503,
+      5761,  -2477,   1275,   -606,    238,    -68,     10,      1,
+        19,    -69,    149,   -220,    173,    216,  -1607,  13350,
+      6045,  -2531,   1283,   -601,    232,    -64,      8,      1,
+        19,    -66,    141,   -200,    132,    290,  -1732,  13187,
+      6328,  -2580,   1287,   -594,    225,    -60,      6,      1,
+        18,    -63,    132,   -180,     92,    362,  -1851,  13015,
+      6612,  -2626,   1290,   -586,    217,    -55,      5,      2,
+        18,    -61,    124,   -160,     52,    432,  -1962,  12835,
+      6896,  -2667,   1290,   -577,    209,    -50,      3,      2,
+        17,    -58,    116,   -140,     13,    499,  -2066,  12647,
+      7179,  -2703,   1287,   -566,    200,    -45,      1,      3,
+        16,    -55,    107,   -120,    -25,    564,  -2164,  12455,
+      7461,  -2735,   1281,   -553,    190,    -40,     -1,      3,
+        15,    -52,     99,   -101,    -63,    627,  -2254,  12253,
+      7743,  -2762,   1273,   -540,    180,    -34,     -4,      4,
+        15,    -49,     90,    -82,    -99,    687,  -2338,  12047,
+      8023,  -2784,   1261,   -525,    169,    -29,     -6,      4,
+        14,    -46,     82,    -63,   -135,    744,  -2414,  11832,
+      8301,  -2801,   1247,   -508,    157,    -23,     -8,      5,
+        13,    -43,     74,    -44,   -170,    799,  -2484,  11612,
+      8577,  -2813,   1230,   -490,    145,    -16,    -11,      5,
+        13,    -40,     65,    -26,   -203,    850,  -2547,  11387,
+      8850,  -2819,   1210,   -471,    132,    -10,    -13,      6,
+        12,    -38,     57,     -8,   -236,    900,  -2603,  11153,
+      9121,  -2819,   1188,   -450,    119,     -3,    -16,      7,
+        11,    -35,     49,     10,   -267,    946,  -2653,  10916,
+      9389,  -2814,   1162,   -428,    105,      4,    -18,      7,
+        11,    -32,     41,     27,   -297,    989,  -2695,  10672,
+      9654,  -2803,   1133,   -404,     90,     11,    -21,      8,
+        10,    -29,     33,     43,   -326,   1029,  -2732,  10426,
+      9914,  -2785,   1102,   -379,     75,     18,    -23,      8,
+         9,    -26,     26,     60,   -353,   1067,  -2762,  10171,
+     10171,  -2762,   1067,   -353,     60,     26,    -26,      9,
+         8,    -23,     18,     75,   -379,   1102,  -2785,   9914,
+     10426,  -2732,   1029,   -326,     43,     33,    -29,     10,
+         8,    -21,     11,     90,   -404,   1133,  -2803,   9654,
+     10672,  -2695,    989,   -297,     27,     41,    -32,     11,
+         7,    -18,      4,    105,   -428,   1162,  -2814,   9389,
+     10916,  -2653,    946,   -267,     10,     49,    -35,     11,
+         7,    -16,     -3,    119,   -450,   1188,  -2819,   9121,
+     11153,  -2603,    900,   -236,     -8,     57,    -38,     12,
+         6,    -13,    -10,    132,   -471,   1210,  -2819,   8850,
+     11387,  -2547,    850,   -203,    -26,     65,    -40,     13,
+         5,    -11,    -16,    145,   -490,   1230,  -2813,   8577,
+     11612,  -2484,    799,   -170,    -44,     74,    -43,     13,
+         5,     -8,    -23,    157,   -508,   1247,  -2801,   8301,
+     11832,  -2414,    744,   -135,    -63,     82,    -46,     14,
+         4,     -6,    -29,    169,   -525,   1261,  -2784,   8023,
+     12047,  -2338,    687,    -99,    -82,     90,    -49,     15,
+         4,     -4,    -34,    180,   -540,   1273,  -2762,   7743,
+     12253,  -2254,    627,    -63,   -101,     99,    -52,     15,
+         3,     -1,    -40,    190,   -553,   1281,  -2735,   7461,
+     12455,  -2164,    564,    -25,   -120,    107,    -55,     16,
+         3,      1,    -45,    200,   -566,   1287,  -2703,   7179,
+     12647,  -2066,    499,     13,   -140,    116,    -58,     17,
+         2,      3,    -50,    209,   -577,   1290,  -2667,   6896,
+     12835,  -1962,    432,     52,   -160,    124,    -61,     18,
+         2,      5,    -55,    217,   -586,   1290,  -2626,   6612,
+     13015,  -1851,    362,     92,   -180,    132,    -63,     18,
+         1,      6,    -60,    225,   -594,   1287,  -2580,   6328,
+     13187,  -1732,    290,    132,   -200,    141,    -66,     19,
+         1,      8,    -64,    232,   -601,   1283,  -2531,   6045,
+     13350,  -1607,    216,    173,   -220,    149,    -69,     19,
+         1,     10,    -68,    238,   -606,   1275,  -2477,   5761,
+     13503,  -1474,    140,    215,   -240,    157,    -71,     20,
+         0,     11,    -72,    244,   -610,   1265,  -2420,   5479,
+     13651,  -1335,     62,    257,   -260,    165,    -74,     21,
+         0,     13,    -75,    249,   -612,   1253,  -2359,   5198,
+     13787,  -1189,    -18,    299,   -280,    173,    -76,     21,
+         0,     14,    -78,    253,   -613,   1238,  -2295,   4918,
+     13917,  -1036,    -99,    341,   -300,    181,    -79,     22,
+        -1,     15,    -81,    257,   -613,   1222,  -2228,   4639,
+     14039,   -876,   -183,    384,   -319,    188,    -81,     22,
+        -1,     17,    -84,    260,   -612,   1203,  -2157,   4363,
+     14148,   -709,   -267,    427,   -339,    195,    -83,     23,
+        -1,     18,    -86,    263,   -609,   1182,  -2084,   4089,
+     14248,   -536,   -353,    470,   -358,    203,    -85,     23,
+        -1,     19,    -88,    265,   -605,   1159,  -2009,   3817,
+     14344,   -357,   -440,    512,   -377,    209,    -87,     23,
+        -2,     20,    -90,    266,   -601,   1134,  -1931,   3549,
+     14426,   -171,   -528,    555,   -395,    216,    -88,     24,
+        -2,     21,    -92,    267,   -594,   1107,  -1851,   3283,
+     14500,     22,   -617,    597,   -413,    222,    -90,     24,
+        -2,     21,    -93,    267,   -587,   1079,  -1769,   3021,
+     14564,    220,   -706,    639,   -431,    228,    -91,     24,
+        -2,     22,    -94,    266,   -579,   1049,  -1685,   2762,
+     14618,    425,   -796,    681,   -448,    234,    -93,     24,
+        -2,     23,    -95,    265,   -570,   1017,  -1600,   2507,
+     14664,    635,   -887,    722,   -464,    239,    -94,     24,
+        -2,     23,    -96,    264,   -559,    984,  -1514,   2257,
+     14698,    851,   -977,    762,   -480,    244,    -95,     24,
+        -2,     23,    -96,    261,   -548,    950,  -1426,   2010,
+     14725,   1072,  -1068,    801,   -495,    248,    -95,     24,
+        -2,     24,    -96,    259,   -536,    914,  -1337,   1769,
+     14738,   1299,  -1158,    840,   -510,    252,    -96,     24,
+         0,     24,    -96,    256,   -523,    878,  -1248,   1531,
+     14740,   1531,  -1248,    878,   -523,    256,    -96,     24,
+};
+
+// 32 taps, cutoff 0.46 * sample rate, kaiser beta 8.0
+static const int16_t btstack_resample_polyphase_coefficients_32[] = {
+        -2,      3,     -2,     -5,     23,    -60,    123,   -218,
+       345,   -503,    683,   -868,   1042,  -1185,   1278,  15076,
+      1278,  -1185,   1042,   -868,    683,   -503,    345,   -218,
+       123,    -60,     23,     -5,     -2,      3,     -2,      0,
+        -2,      3,     -2,     -6,     25,    -64,    127,   -221,
+       346,   -499,    668,   -838,    985,  -1077,   1035,  15069,
+      1526,  -1292,   1099,   -897,    696,   -507,    344,   -214,
+       119,    -57,     21,     -3,     -3,      4,     -2,      1,
+        -2,      2,     -1,     -8,     28,    -67,    130,   -223,
+       346,   -493,    652,   -806,    926,   -969,    798,  15056,
+      1779,  -1399,   1153,   -925,    707,   -510,    342,   -210,
+       115,    -53,     18,     -1,     -4,      4,     -2,      1,
+        -1,      2,      0,     -9,     30,    -69,    133,   -225,
+       345,   -486,    636,   -772,    866,   -860,    567,  15024,
+      2037,  -1504,   1206,   -951,    718,   -511,    339,   -206,
+       111,    -50,     15,      0,     -5,      5,     -2,      1,
+        -1,      2,      1,    -10,     32,    -72,    136,   -227,
+       344,   -479,    618,   -738,    804,   -752,    341,  14991,
+      2299,  -1608,   1258,   -976,    727,   -512,    335,   -201,
+       106,    -46,     13,      2,     -6,      5,     -3,      1,
+        -1,      1,      2,    -12,     34,    -75,    138,   -228,
+       341,   -470,    599,   -702,    743,   -644,    121,  14945,
+      2566,  -1711,   1307,   -998,    735,   -512,    331,   -195,
+       101,    -42,     10,      4,     -7,      5,     -3,      1,
+        -1,      1,      3,    -13,     36,    -77,    140,   -229,
+       338,   -461,    579,   -666,    680,   -536,    -92,  14887,
+      2837,  -1812,   1354,  -1019,    741,   -510,    326,   -189,
+        95,    -37,      7,      6,     -8,      6,     -3,      1,
+        -1,      0,      3,    -14,     38,    -79,    142,   -229,
+       335,   -451,    558,   -628,    617,   -430,   -299,  14822,
+      3111,  -1912,   1400,  -1038,    746,   -507,    320,   -183,
+        90,    -33,      4,      7,     -9,      6,     -3,      1,
+        -1,      0,      4,    -16,     40,    -81,    144,   -228,
+       331,   -440,    536,   -590,    553,   -324,   -499,  14745,
+      3389,  -2009,   1442,  -1055,    749,   -504,    314,   -176,
+        84,    -29,      1,      9,    -10,      7,     -3,      1,
+        -1,      0,      5,    -17,     41,    -83,    145,   -227,
+       326,   -428,    513,   -550,    489,   -219,   -693,  14657,
+      3670,  -2104,   1483,  -1070,    751,   -499,    307,   -168,
+        77,    -24,     -2,     11,    -11,      7,     -3,      1,
+         0,     -1,      5,    -18,     43,    -84,    145,   -226,
+       320,   -415,    490,   -511,    425,   -115,   -880,  14561,
+      3954,  -2196,   1521,  -1083,    751,   -493,    299,   -161,
+        71,    -19,     -5,     13,    -12,      7,     -3,      1,
+         0,     -1,      6,    -19,     44,    -85,    146,   -224,
+       314,   -402,    465,   -470,    361,    -13,  -1060,  14454,
+      4241,  -2285,   1556,  -1094,    750,   -486,    290,   -152,
+        64,    -15,     -8,     14,    -12,      8,     -4,      1,
+         0,     -1,      7,    -20,     45,    -86,    146,   -222,
+       308,   -388,    440,   -429,    296,     87,  -1233,  14339,
+      4530,  -2371,   1589,  -1103,    747,   -478,    281,   -144,
+        57,    -10,    -11,     16,    -13,      8,     -4,      1,
+         0,     -2,      7,    -21,     46,    -87,    146,   -220,
+       300,   -373,    415,   -388,    232,    186,  -1398,  14216,
+      4821,  -2454,   1618,  -1109,    743,   -469,    270,   -135,
+        50,     -5,    -15,     18,    -14,      9,     -4,      1,
+         0,     -2,      8,    -22,     47,    -88,    145,   -217,
+       293,   -358,    388,   -346,    169,    283,  -1557,  14081,
+      5114,  -2533,   1645,  -1114,    736,   -459,    260,   -125,
+        43,      0,    -18,     20,    -15,      9,     -4,      1,
+         0,     -2,      8,    -22,     48,    -89,    145,   -213,
+       285,   -343,    362,   -304,    106,    377,  -1708,  13935,
+      5409,  -2609,   1669,  -1116,    729,   -448,    248,   -115,
+        35,      6,    -21,     22,    -16,      9,     -4,      1,
+         0,     -2,      9,    -23,     49,    -89,    144,   -209,
+       276,   -326,    334,   -262,     43,    469,  -1851,  13781,
+      5704,  -2681,   1689,  -1115,    720,   -435,    236,   -105,
+        28,     11,    -24,     23,    -17,     10,     -4,      1,
+         0,     -3,      9,    -24,     50,    -89,    142,   -205,
+       267,   -309,    307,   -220,    -19,    559,  -1987,  13622,
+      6000,  -2748,   1707,  -1113,    709,   -422,    223,    -95,
+        20,     16,    -27,     25,    -18,     10,     -4,      1,
+         0,     -3,     10,    -24,     50,    -89,    141,   -200,
+       257,   -292,    279,   -177,    -80,    647,  -2116,  13451,
+      6297,  -2812,   1721,  -1108,    696,   -408,    210,    -84,
+        12,     21,    -31,     27,    -18,     10,     -4,      1,
+         1,     -3,     10,    -25,     51,    -89,    139,   -195,
+       247,   -275,    251,   -135,   -140,    731,  -2237,  13272,
+      6594,  -2870,   1731,  -1101,    682,   -392,    196,    -73,
+         4,     27,    -34,     29,    -19,     11,     -5,      1,
+         1,     -3,     11,    -25,     51,    -88,    137,   -190,
+       236,   -256,    222,    -93,   -199,    813,  -2351,  13085,
+      6890,  -2924,   1738,  -1091,    667,   -376,    182,    -61,
+        -4,     32,    -37,     30,    -20,     11,     -5,      1,
+         1,     -4,     11,    -26,     51,    -88,    134,   -184,
+       226,   -238,    194,    -52,   -257,    892,  -2456,  12893,
+      7186,  -2973,   1742,  -1079,    649,   -358,    167,    -50,
+       -13,     38,    -40,     32,    -21,     11,     -5,      1,
+         1,     -4,     11,    -26,     51,    -87,    132,   -178,
+       214,   -220,    165,    -11,   -314,    968,  -2555,  12693,
+      7481,  -3016,   1742,  -1065,    631,   -340,    151,    -38,
+       -21,     43,    -43,     33,    -21,     11,     -5,      1,
+         1,     -4,     12,    -27,     51,    -86,    129,   -172,
+       203,   -201,    137,     30,   -369,   1040,  -2646,  12482,
+      7775,  -3055,   1739,  -1048,    610,   -321,    135,    -25,
+       -29,     48,    -46,     35,    -22,     12,     -5,      1,
+         1,     -4,     12,    -27,     51,    -85,    126,   -166,
+       191,   -182,    108,     70,   -423,   1110,  -2729,  12265,
+      8067,  -3087,   1732,  -1029,    589,   -301,    119,    -13,
+       -38,     54,    -49,     37,    -23,     12,     -5,      1,
+         1,     -4,     12,    -27,     51,    -84,    122,   -159,
+       179,   -162,     80,    110,   -475,   1176,  -2804,  12040,
+      8358,  -3114,   1721,  -1007,    565,   -280,    102,     -1,
+       -46,     59,    -52,     38,    -23,     12,     -5,      1,
+         1,     -4,     12,    -27,     50,    -82,    119,   -152,
+       167,   -143,     51,    149,   -526,   1238,  -2873,  11815,
+      8646,  -3135,   1706,   -984,    541,   -258,     84,     12,
+       -55,     64,    -55,     39,    -24,     12,     -5,      1,
+         1,     -5,     12,    -27,     50,    -81,    115,   -145,
+       154,   -123,     23,    187,   -575,   1298,  -2933,  11577,
+      8932,  -3150,   1688,   -957,    515,   -236,     67,     25,
+       -64,     69,    -58,     41,    -24,     12,     -5,      1,
+         1,     -5,     13,    -27,     49,    -79,    111,   -137,
+       142,   -104,     -5,    225,   -623,   1353,  -2987,  11336,
+      9215,  -3159,   1666,   -929,    487,   -212,     48,     38,
+       -72,     74,    -61,     42,    -25,     13,     -5,      1,
+         1,     -5,     13,    -27,     49,    -77,    107,   -129,
+       129,    -85,    -32,    261,   -668,   1405,  -3033,  11086,
+      9494,  -3161,   1640,   -898,    459,   -188,     30,     51,
+       -81,     79,    -63,     43,    -25,     13,     -5,      1,
+         1,     -5,     13,    -27,     48,    -75,    103,   -122,
+       116,    -65,    -60,    297,   -712,   1454,  -3071,  10835,
+      9770,  -3157,   1610,   -865,    429,   -164,     11,     64,
+       -89,     84,    -66,     44,    -26,     13,     -5,      1,
+         1,     -5,     13,    -27,     47,    -73,     98,   -114,
+       103,    -46,    -86,    331,   -753,   1499,  -3103,  10576,
+     10042,  -3146,   1577,   -830,    397,   -139,     -7,     77,
+       -97,     89,    -68,     45,    -26,     13,     -5,      1,
+         1,     -5,     13,    -26,     46,    -71,     94,   -106,
+        90,    -26,   -113,    365,   -792,   1540,  -3128,  10310,
+     10310,  -3128,   1540,   -792,    365,   -113,    -26,     90,
+      -106,     94,    -71,     46,    -26,     13,     -5,      1,
+         1,     -5,     13,    -26,     45,    -68,     89,    -97,
+        77,     -7,   -139,    397,   -830,   1577,  -3146,  10042,
+     10576,  -3103,   1499,   -753,    331,    -86,    -46,    103,
+      -114,     98,    -73,     47,    -27,     13,     -5,      1,
+         1,     -5,     13,    -26,     44,    -66,     84,    -89,
+        64,     11,   -164,    429,   -865,   1610,  -3157,   9770,
+     10835,  -3071,   1454,   -712,    297,    -60,    -65,    116,
+      -122,    103,    -75,     48,    -27,     13,     -5,      1,
+         1,     -5,     13,    -25,     43,    -63,     79,    -81,
+        51,     30,   -188,    459,   -898,   1640,  -3161,   9494,
+     11086,  -3033,   1405,   -668,    261,    -32,    -85,    129,
+      -129,    107,    -77,     49,    -27,     13,     -5,      1,
+         1,     -5,     13,    -25,     42,    -61,     74,    -72,
+        38,     48,   -212,    487,   -929,   1666,  -3159,   9215,
+     11336,  -2987,   1353,   -623,    225,     -5,   -104,    142,
+      -137,    111,    -79,     49,    -27,     13,     -5,      1,
+         1,     -5,     12,    -24,     41,    -58,     69,    -64,
+        25,     67,   -236,    515,   -957,   1688,  -3150,   8932,
+     11577,  -2933,   1298,   -575,    187,     23,   -123,    154,
+      -145,    115,    -81,     50,    -27,     12,     -5,      1,
+         1,     -5,     12,    -24,     39,    -55,     64,    -55,
+        12,     84,   -258,    541,   -984,   1706,  -3135,   8646,
+     11815,  -2873,   1238,   -526,    149,     51,   -143,    167,
+      -152,    119,    -82,     50,    -27,     12,     -4,      1,
+         1,     -5,     12,    -23,     38,    -52,     59,    -46,
+        -1,    102,   -280,    565,  -1007,   1721,  -3114,   8358,
+     12040,  -2804,   1176,   -475,    110,     80,   -162,    179,
+      -159,    122,    -84,     51,    -27,     12,     -4,      1,
+         1,     -5,     12,    -23,     37,    -49,     54,    -38,
+       -13,    119,   -301,    589,  -1029,   1732,  -3087,   8067,
+     12265,  -2729,   1110,   -423,     70,    108,   -182,    191,
+      -166,    126,    -85,     51,    -27,     12,     -4,      1,
+         1,     -5,     12,    -22,     35,    -46,     48,    -29,
+       -25,    135,   -321,    610,  -1048,   1739,  -3055,   7775,
+     12482,  -2646,   1040,   -369,     30,    137,   -201,    203,
+      -172,    129,    -86,     51,    -27,     12,     -4,      1,
+         1,     -5,     11,    -21,     33,    -43,     43,    -21,
+       -38,    151,   -340,    631,  -1065,   1742,  -3016,   7481,
+     12693,  -2555,    968,   -314,    -11,    165,   -220,    214,
+      -178,    132,    -87,     51,    -26,     11,     -4,      1,
+         1,     -5,     11,    -21,     32,    -40,     38,    -13,
+       -50,    167,   -358,    649,  -1079,   1742,  -2973,   7186,
+     12893,  -2456,    892,   -257,    -52,    194,   -238,    226,
+      -184,    134,    -88,     51,    -26,     11,     -4,      1,
+         1,     -5,     11,    -20,     30,    -37,     32,     -4,
+       -61,    182,   -376,    667,  -1091,   1738,  -2924,   6890,
+     13085,  -2351,    813,   -199,    -93,    222,   -256,    236,
+      -190,    137,    -88,     51,    -25,     11,     -3,      1,
+         1,     -5,     11,    -19,     29,    -34,     27,      4,
+       -73,    196,   -392,    682,  -1101,   1731,  -2870,   6594,
+     13272,  -2237,    731,   -140,   -135,    251,   -275,    247,
+      -195,    139,    -89,     51,    -25,     10,     -3,      1,
+         1,     -4,     10,    -18,     27,    -31,     21,     12,
+       -84,    210,   -408,    696,  -1108,   1721,  -2812,   6297,
+     13451,  -2116,    647,    -80,   -177,    279,   -292,    257,
+      -200,    141,    -89,     50,    -24,     10,     -3,      0,
+         1,     -4,     10,    -18,     25,    -27,     16,     20,
+       -95,    223,   -422,    709,  -1113,   1707,  -2748,   6000,
+     13622,  -1987,    559,    -19,   -220,    307,   -309,    267,
+      -205,    142,    -89,     50,    -24,      9,     -3,      0,
+         1,     -4,     10,    -17,     23,    -24,     11,     28,
+      -105,    236,   -435,    720,  -1115,   1689,  -2681,   5704,
+     13781,  -1851,    469,     43,   -262,    334,   -326,    276,
+      -209,    144,    -89,     49,    -23,      9,     -2,      0,
+         1,     -4,      9,    -16,     22,    -21,      6,     35,
+      -115,    248,   -448,    729,  -1116,   1669,  -2609,   5409,
+     13935,  -1708,    377,    106,   -304,    362,   -343,    285,
+      -213,    145,    -89,     48,    -22,      8,     -2,      0,
+         1,     -4,      9,    -15,     20,    -18,      0,     43,
+      -125,    260,   -459,    736,  -1114,   1645,  -2533,   5114,
+     14081,  -1557,    283,    169,   -346,    388,   -358,    293,
+      -217,    145,    -88,     47,    -22,      8,     -2,      0,
+         1,     -4,      9,    -14,     18,    -15,     -5,     50,
+      -135,    270,   -469,    743,  -1109,   1618,  -2454,   4821,
+     14216,  -1398,    186,    232,   -388,    415,   -373,    300,
+      -220,    146,    -87,     46,    -21,      7,     -2,      0,
+         1,     -4,      8,    -13,     16,    -11,    -10,     57,
+      -144,    281,   -478,    747,  -1103,   1589,  -2371,   4530,
+     14339,  -1233,     87,    296,   -429,    440,   -388,    308,
+      -222,    146,    -86,     45,    -20,      7,     -1,      0,
+         1,     -4,      8,    -12,     14,     -8,    -15,     64,
+      -152,    290,   -486,    750,  -1094,   1556,  -2285,   4241,
+     14454,  -1060,    -13,    361,   -470,    465,   -402,    314,
+      -224,    146,    -85,     44,    -19,      6,     -1,      0,
+         1,     -3,      7,    -12,     13,     -5,    -19,     71,
+      -161,    299,   -493,    751,  -1083,   1521,  -2196,   3954,
+     14561,   -880,   -115,    425,   -511,    490,   -415,    320,
+      -226,    145,    -84,     43,    -18,      5,     -1,      0,
+         1,     -3,      7,    -11,     11,     -2,    -24,     77,
+      -168,    307,   -499,    751,  -1070,   1483,  -2104,   3670,
+     14657,   -693,   -219,    489,   -550,    513,   -428,    326,
+      -227,    145,    -83,     41,    -17,      5,      0,     -1,
+         1,     -3,      7,    -10,      9,      1,    -29,     84,
+      -176,    314,   -504,    749,  -1055,   1442,  -2009,   3389,
+     14745,   -499,   -324,    553,   -590,    536,   -440,    331,
+      -228,    144,    -81,     40,    -16,      4,      0,     -1,
+         1,     -3,      6,     -9,      7,      4,    -33,     90,
+      -183,    320,   -507,    746,  -1038,   1400,  -1912,   3111,
+     14822,   -299,   -430,    617,   -628,    558,   -451,    335,
+      -229,    142,    -79,     38,    -14,      3,      0,     -1,
+         1,     -3,      6,     -8,      6,      7,    -37,     95,
+      -189,    326,   -510,    741,  -1019,   1354,  -1812,   2837,
+     14887,    -92,   -536,    680,   -666,    579,   -461,    338,
+      -229,    140,    -77,     36,    -13,      3,      1,     -1,
+         1,     -3,      5,     -7,      4,     10,    -42,    101,
+      -195,    331,   -512,    735,   -998,   1307,  -1711,   2566,
+     14945,    121,   -644,    743,   -702,    599,   -470,    341,
+      -228,    138,    -75,     34,    -12,      2,      1,     -1,
+         1,     -3,      5,     -6,      2,     13,    -46,    106,
+      -201,    335,   -512,    727,   -976,   1258,  -1608,   2299,
+     14991,    341,   -752,    804,   -738,    618,   -479,    344,
+      -227,    136,    -72,     32,    -10,      1,      2,     -1,
+         1,     -2,      5,     -5,      0,     15,    -50,    111,
+      -206,    339,   -511,    718,   -951,   1206,  -1504,   2037,
+     15024,    567,   -860,    866,   -772,    636,   -486,    345,
+      -225,    133,    -69,     30,     -9,      0,      2,     -1,
+         1,     -2,      4,     -4,     -1,     18,    -53,    115,
+      -210,    342,   -510,    707,   -925,   1153,  -1399,   1779,
+     15056,    798,   -969,    926,   -806,    652,   -493,    346,
+      -223,    130,    -67,     28,     -8,     -1,      2,     -2,
+         1,     -2,      4,     -3,     -3,     21,    -57,    119,
+      -214,    344,   -507,    696,   -897,   1099,  -1292,   1526,
+     15069,   1035,  -1077,    985,   -838,    668,   -499,    346,
+      -221,    127,    -64,     25,     -6,     -2,      3,     -2,
+         0,     -2,      3,     -2,     -5,     23,    -60,    123,
+      -218,    345,   -503,    683,   -868,   1042,  -1185,   1278,
+     15076,   1278,  -1185,   1042,   -868,    683,   -503,    345,
+      -218,    123,    -60,     23,     -5,     -2,      3,     -2,
+};
+
+static int32_t btstack_resample_polyphase_dot_product(const int16_t * samples, const int16_t * coefficients, uint16_t num_taps){
+#if defined(__SSE2__)
+    __m128i accumulator = _mm_setzero_si128();
+    uint16_t i;
+    for (i = 0; i < num_taps; i += 8u){
+        __m128i s = _mm_loadu_si128((const __m128i *) &samples[i]);
+        __m128i c = _mm_loadu_si128((const __m128i *) &coefficients[i]);
+        accumulator = _mm_add_epi32(accumulator, _mm_madd_epi16(s, c));
+    }
+    accumulator = _mm_add_epi32(accumulator, _mm_shuffle_epi32(accumulator, _MM_SHUFFLE(1, 0, 3, 2)));
+    accumulator = _mm_add_epi32(accumulator, _mm_shuffle_epi32(accumulator, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(accumulator);
+#elif defined(__ARM_NEON)
+    int32x4_t accumulator = vdupq_n_s32(0);
+    uint16_t i;
+    for (i = 0; i < num_taps; i += 8u){
+        int16x8_t s = vld1q_s16(&samples[i]);
+        int16x8_t c = vld1q_s16(&coefficients[i]);
+        accumulator = vmlal_s16(accumulator, vget_low_s16(s),  vget_low_s16(c));
+        accumulator = vmlal_s16(accumulator, vget_high_s16(s), vget_high_s16(c));
+    }
+    int32x2_t sum = vadd_s32(vget_low_s32(accumulator), vget_high_s32(accumulator));
+    sum = vpadd_s32(sum, sum);
+    return vget_lane_s32(sum, 0);
+#else
+    int32_t accumulator = 0;
+    uint16_t i;
+    for (i = 0; i < num_taps; i++){
+        accumulator += (int32_t) samples[i] * coefficients[i];
+    }
+    return accumulator;
+#endif
+}
+
+static int16_t btstack_resample_polyphase_saturate(int32_t value){
+    if (value > INT16_MAX){
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN){
+        return INT16_MIN;
+    }
+    return (int16_t) value;
+}
+
+void btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, int num_channels, btstack_resample_polyphase_filter_t filter){
+    btstack_assert(num_channels <= BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS);
+
+    memset(context, 0, sizeof(btstack_resample_polyphase_t));
+    switch (filter){
+        case BTSTACK_RESAMPLE_POLYPHASE_FILTER_8_TAPS:
+            context->coefficients = btstack_resample_polyphase_coefficients_8;
+            break;
+        case BTSTACK_RESAMPLE_POLYPHASE_FILTER_16_TAPS:
+            context->coefficients = btstack_resample_polyphase_coefficients_16;
+            break;
+        case BTSTACK_RESAMPLE_POLYPHASE_FILTER_32_TAPS:
+            context->coefficients = btstack_resample_polyphase_coefficients_32;
+            break;
+        default:
+            btstack_unreachable();
+            break;
+    }
+    context->num_taps = (uint16_t) filter;
+    context->src_step = 0x10000;  // default resampling 1.0
+    context->num_channels = num_channels;
+    // silence before first sample, first output frame corresponds to first input frame
+    context->buffer_frames = btstack_resample_polyphase_get_delay_frames(context);
+}
+
+void btstack_resample_polyphase_set_factor(btstack_resample_polyphase_t * context, uint32_t factor){
+    context->src_step = factor;
+}
+
+uint16_t btstack_resample_polyphase_get_delay_frames(const btstack_resample_polyphase_t * context){
+    return (context->num_taps / 2u) - 1u;
+}
+
+static uint16_t btstack_resample_polyphase_filter_buffer(btstack_resample_polyphase_t * context, int16_t * output_buffer){
+    uint16_t dest_frames = 0;
+    uint16_t dest_samples = 0;
+    const uint16_t num_taps = context->num_taps;
+
+    while (((context->src_pos >> 16) + num_taps) <= context->buffer_frames){
+        const uint16_t index    = context->src_pos >> 16;
+        const uint16_t phase    = (context->src_pos & 0xffffu) >> PHASE_FRACTION_BITS;
+        const int32_t  fraction = (int32_t) (context->src_pos & ((1u << PHASE_FRACTION_BITS) - 1u));
+        const int16_t * coefficients = &context->coefficients[phase * num_taps];
+        int i;
+        for (i = 0; i < context->num_channels; i++){
+            // interpolate between adjacent phases
+            int32_t s1 = btstack_resample_polyphase_dot_product(&context->buffer[i][index], coefficients, num_taps);
+            int32_t s2 = btstack_resample_polyphase_dot_product(&context->buffer[i][index], coefficients + num_taps, num_taps);
+            int32_t os = s1 + (int32_t) (((int64_t) (s2 - s1) * fraction) >> PHASE_FRACTION_BITS);
+            output_buffer[dest_samples++] = btstack_resample_polyphase_saturate((os + (1 << (COEFFICIENT_SHIFT - 1))) >> COEFFICIENT_SHIFT);
+        }
+        dest_frames++;
+        context->src_pos += context->src_step;
+    }
+
+    // drop frames that are not needed anymore
+    uint16_t frames_to_drop = context->src_pos >> 16;
+    if (frames_to_drop > context->buffer_frames){
+        frames_to_drop = context->buffer_frames;
+    }
+    if (frames_to_drop > 0u){
+        int i;
+        for (i = 0; i < context->num_channels; i++){
+            memmove(&context->buffer[i][0], &context->buffer[i][frames_to_drop], (context->buffer_frames - frames_to_drop) * sizeof(int16_t));
+        }
+        context->buffer_frames -= frames_to_drop;
+        context->src_pos -= (uint32_t) frames_to_drop << 16;
+    }
+    return dest_frames;
+}
+
+uint16_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer){
+    btstack_assert(context->num_channels > 0);
+
+    uint16_t dest_frames = 0;
+    const uint16_t buffer_size = BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS + BTSTACK_RESAMPLE_POLYPHASE_BUFFER_FRAMES;
+    while (num_frames > 0u){
+        // de-interleave input into per channel buffer
+        uint16_t frames_to_copy = buffer_size - context->buffer_frames;
+        if (frames_to_copy > num_frames){
+            frames_to_copy = (uint16_t) num_frames;
+        }
+        uint16_t frame;
+        for (frame = 0; frame < frames_to_copy; frame++){
+            int i;
+            for (i = 0; i < context->num_channels; i++){
+                context->buffer[i][context->buffer_frames + frame] = *input_buffer++;
+            }
+        }
+        context->buffer_frames += frames_to_copy;
+        num_frames -= frames_to_copy;
+
+        dest_frames += btstack_resample_polyphase_filter_buffer(context, &output_buffer[dest_frames * context->num_channels]);
+    }
+    return dest_frames;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL BLUEKITCHEN
+ * GMBH OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/**
+ * @title Polyphase Resample
+ *
+ * Resampling for 16-bit audio samples with a windowed-sinc polyphase filter.
+ *
+ * Compared to the linear interpolation of btstack_resample, the polyphase filter suppresses aliasing and imaging
+ * at the cost of more processing and a delay of half the filter length. The filter is designed for resampling
+ * factors close to 1.0, e.g. for sample rate compensation or conversion between 44.1 and 48 kHz.
+ *
+ * The filter kernel uses SSE2 or NEON if available and 16 bit fixed point math otherwise.
+ *
+ */
+
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_H
+#define BTSTACK_RESAMPLE_POLYPHASE_H
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS 2
+#define BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS     32
+
+// number of input frames buffered per channel before filtering
+#ifndef BTSTACK_RESAMPLE_POLYPHASE_BUFFER_FRAMES
+#define BTSTACK_RESAMPLE_POLYPHASE_BUFFER_FRAMES 128
+#endif
+
+typedef enum {
+    BTSTACK_RESAMPLE_POLYPHASE_FILTER_8_TAPS  = 8,
+    BTSTACK_RESAMPLE_POLYPHASE_FILTER_16_TAPS = 16,
+    BTSTACK_RESAMPLE_POLYPHASE_FILTER_32_TAPS = 32,
+} btstack_resample_polyphase_filter_t;
+
+typedef struct {
+    uint32_t src_pos;
+    uint32_t src_step;
+    const int16_t * coefficients;
+    uint16_t num_taps;
+    uint16_t buffer_frames;
+    int16_t  buffer[BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS][BTSTACK_RESAMPLE_POLYPHASE_MAX_TAPS + BTSTACK_RESAMPLE_POLYPHASE_BUFFER_FRAMES];
+    int      num_channels;
+} btstack_resample_polyphase_t;
+
+/* API_START */
+
+/**
+ * @brief Init polyphase resample context
+ * @param context
+ * @param num_channels
+ * @param filter length, longer filters improve quality and take more time
+ */
+void btstack_resample_polyphase_init(btstack_resample_polyphase_t * context, int num_channels, btstack_resample_polyphase_filter_t filter);
+
+/**
+ * @brief Set resampling factor
+ * @param factor as fixed point value, identity is 0x10000
+ * @note factor is used as step size over input data, smaller values result in more output samples
+ */
+void btstack_resample_polyphase_set_factor(btstack_resample_polyphase_t * context, uint32_t factor);
+
+/**
+ * @brief Get delay caused by filter
+ * @param context
+ * @return delay in input frames
+ */
+uint16_t btstack_resample_polyphase_get_delay_frames(const btstack_resample_polyphase_t * context);
+
+/**
+ * @brief Process block of input samples
+ * @note size of output buffer is not checked, use btstack_resample_get_min_factor_for_output_capacity to limit the factor
+ * @param input_buffer
+ * @param num_frames
+ * @param output_buffer
+ * @return number destination frames
+ */
+uint16_t btstack_resample_polyphase_block(btstack_resample_polyphase_t * context, const int16_t * input_buffer, uint32_t num_frames, int16_t * output_buffer);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // BTSTACK_RESAMPLE_POLYPHASE_H
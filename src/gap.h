@@ -359,6 +359,34 @@ struct gap_privacy_client {
 
 typedef struct gap_privacy_client gap_privacy_client_t;
 
+// rules for LE Advertising Report filter
+#define GAP_ADVERTISING_REPORT_FILTER_ADDRESS         0x01
+#define GAP_ADVERTISING_REPORT_FILTER_RSSI            0x02
+#define GAP_ADVERTISING_REPORT_FILTER_AD_TYPE         0x04
+#define GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID16  0x08
+#define GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID128 0x10
+
+// LE Advertising Report filter, a report matches if all selected rules match
+typedef struct {
+    btstack_linked_item_t item;
+    // GAP_ADVERTISING_REPORT_FILTER_x
+    uint8_t         rules;
+    // GAP_ADVERTISING_REPORT_FILTER_ADDRESS: advertiser address
+    bd_addr_type_t  address_type;
+    bd_addr_t       address;
+    // GAP_ADVERTISING_REPORT_FILTER_RSSI: minimal RSSI in dBm
+    int8_t          rssi_min;
+    // GAP_ADVERTISING_REPORT_FILTER_AD_TYPE: AD Structure with type that starts with prefix,
+    // e.g. BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA and little-endian Company ID
+    uint8_t         ad_type;
+    uint8_t         ad_data_prefix_len;
+    const uint8_t * ad_data_prefix;
+    // GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID16: Service UUID in list of Service UUIDs
+    uint16_t        service_uuid16;
+    // GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID128: Service UUID in list of 128-bit Service UUIDs
+    const uint8_t * service_uuid128;
+} gap_advertising_report_filter_t;
+
 /* API_START */
 
 // Classic + LE
@@ -632,6 +660,29 @@ void gap_set_scan_parameters(uint8_t scan_type, uint16_t scan_interval, uint16_t
  */
 void gap_set_scan_duplicate_filter(bool enabled);
 
+/**
+ * @brief Add filter for LE Advertising Reports. If at least one filter is registered, only reports that match
+ *        one of them are delivered as GAP_EVENT_ADVERTISING_REPORT or GAP_EVENT_EXTENDED_ADVERTISING_REPORT.
+ *        HCI LE Advertising Report events are not delivered if none of their reports matched.
+ * @note rules on advertising data are only checked for complete Extended Advertising Reports. All fragments of
+ *       a chained Extended Advertising Report are delivered or dropped together, based on address and RSSI rules
+ * @param filter
+ */
+void gap_advertising_report_filter_add(gap_advertising_report_filter_t * filter);
+
+/**
+ * @brief Remove filter for LE Advertising Reports
+ * @param filter
+ */
+void gap_advertising_report_filter_remove(gap_advertising_report_filter_t * filter);
+
+/**
+ * @brief Suppress LE Advertising Reports with unchanged advertising data from the same advertiser
+ * @note in contrast to gap_set_scan_duplicate_filter, reports are delivered again when data changes or window expired
+ * @param window_ms or 0 to disable, default: 0
+ */
+void gap_set_advertising_report_duplicate_window(uint16_t window_ms);
+
 /**
  * @brief Set PHYs for LE Scan
  * @param phy bitmask: 1 = LE 1M PHY, 4 = LE Coded PHY
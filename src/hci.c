@@ -151,6 +151,11 @@
 #define GAP_PAIRING_STATE_SEND_CONFIRMATION_NEGATIVE 6
 #define GAP_PAIRING_STATE_WAIT_FOR_COMMAND_COMPLETE  7
 
+// LE lists for hci_run_gap_le_list_updates
+#define HCI_LE_LIST_FILTER_ACCEPT       0x01
+#define HCI_LE_LIST_RESOLVING           0x02
+#define HCI_LE_LIST_PERIODIC_ADVERTISER 0x04
+
 //
 // compact storage of relevant supported HCI Commands.
 // X-Macro below provides enumeration and mapping table into the supported
@@ -218,8 +223,13 @@ static void hci_emit_dedicated_bonding_result(bd_addr_t address, uint8_t status)
 static void hci_emit_event(uint8_t * event, uint16_t size, int dump);
 static void hci_emit_acl_packet(uint8_t * packet, uint16_t size);
 static void hci_run(void);
+static void hci_run_for_connection(hci_connection_t * connection);
+static void hci_run_pending(void);
+static void hci_run_commands(void);
+static void hci_connection_cancel_run(hci_connection_t * connection);
 static bool hci_is_le_connection(hci_connection_t * connection);
 static uint8_t hci_send_prepared_cmd_packet(void);
+static bool hci_command_can_be_pipelined(uint16_t opcode);
 
 #ifdef ENABLE_CLASSIC
 static int hci_have_usb_transport(void);
@@ -228,6 +238,14 @@ static void hci_trigger_remote_features_for_connection(hci_connection_t * connec
 
 #ifdef ENABLE_BLE
 static bool hci_run_general_gap_le(void);
+static bool hci_run_gap_le_list_updates(uint8_t lists);
+#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+static uint16_t hci_le_resolving_list_num_indices(void);
+static uint16_t hci_le_resolving_list_capacity(void);
+static bool hci_le_resolving_list_get_identity(uint16_t index, int * address_type, bd_addr_t address, sm_key_t irk);
+static void hci_le_resolving_list_reset(void);
+static void hci_le_resolving_list_sync(void);
+#endif
 static void gap_privacy_clients_handle_ready(void);
 static void gap_privacy_clients_notify(bd_addr_t new_random_address);
 #ifdef ENABLE_LE_CENTRAL
@@ -398,6 +416,44 @@ void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
     btstack_linked_list_iterator_init(it, &hci_stack->connections);
 }
 
+/**
+ * queue connection for pending command check in next hci_run
+ */
+void hci_connection_trigger_run(hci_connection_t * connection){
+    if (connection->run_pending) return;
+    connection->run_pending = true;
+    connection->run_next = NULL;
+    if (hci_stack->connections_run_tail == NULL){
+        hci_stack->connections_run_head = connection;
+    } else {
+        hci_stack->connections_run_tail->run_next = connection;
+    }
+    hci_stack->connections_run_tail = connection;
+}
+
+static void hci_connection_cancel_run(hci_connection_t * connection){
+    if (!connection->run_pending) return;
+    connection->run_pending = false;
+    hci_connection_t * prev = NULL;
+    hci_connection_t * it;
+    for (it = hci_stack->connections_run_head; it != NULL; it = it->run_next){
+        if (it != connection) {
+            prev = it;
+            continue;
+        }
+        if (prev == NULL){
+            hci_stack->connections_run_head = connection->run_next;
+        } else {
+            prev->run_next = connection->run_next;
+        }
+        if (hci_stack->connections_run_tail == connection){
+            hci_stack->connections_run_tail = prev;
+        }
+        break;
+    }
+    connection->run_next = NULL;
+}
+
 /**
  * get connection for a given handle
  *
@@ -759,6 +815,16 @@ bool hci_can_send_command_packet_now(void){
     return hci_stack->num_cmd_packets > 0u;
 }
 
+#ifdef ENABLE_BLE
+// LE list updates can be pipelined if only LE list updates are outstanding
+static bool hci_can_send_pipelined_command_packet_now(void){
+    if (hci_can_send_command_packet_transport() == 0) return false;
+    if (hci_stack->num_cmd_packets_pipelined == 0u) return false;
+    if (hci_stack->num_cmd_packets_pipelined >= HCI_MAX_PIPELINED_COMMANDS) return false;
+    return hci_stack->num_cmd_packets_controller > 0u;
+}
+#endif
+
 static int hci_transport_can_send_prepared_packet_now(uint8_t packet_type){
     // check for async hci transport implementations
     if (!hci_stack->hci_transport->can_send_packet_now) return true;
@@ -852,7 +918,7 @@ void hci_acl_release_packets(uint8_t num_packets) {
     hci_stack->acl_packets_reserved -= num_packets;
 
     // execute main loop
-    hci_run();
+    hci_run_pending();
 }
 #endif
 
@@ -1348,7 +1414,7 @@ static void acl_handler(uint8_t *packet, uint16_t size){
     }
     
     // execute main loop
-    hci_run();
+    hci_run_pending();
 }
 
 static void hci_connection_stop_timer(hci_connection_t * conn){
@@ -1370,6 +1436,7 @@ static void hci_shutdown_connection(hci_connection_t *connection){
     hci_connection_stop_timer(connection);
 
     btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) connection);
+    hci_connection_cancel_run(connection);
     btstack_memory_hci_connection_free( connection );
     
     // now it's gone
@@ -1636,6 +1703,105 @@ void gap_le_get_own_connection_address(uint8_t * addr_type, bd_addr_t addr){
     hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, addr);
 }
 
+static bool hci_le_advertising_report_filter_match(const gap_advertising_report_filter_t * filter, uint8_t address_type,
+                                                   const bd_addr_t address, int8_t rssi, uint8_t data_len,
+                                                   const uint8_t * data, bool data_complete){
+    if ((filter->rules & GAP_ADVERTISING_REPORT_FILTER_ADDRESS) != 0u){
+        if (address_type != (uint8_t) filter->address_type) return false;
+        if (bd_addr_cmp(address, filter->address) != 0) return false;
+    }
+    if ((filter->rules & GAP_ADVERTISING_REPORT_FILTER_RSSI) != 0u){
+        if (rssi < filter->rssi_min) return false;
+    }
+    // advertising data of incomplete extended advertising reports is checked by application
+    if (data_complete == false) return true;
+    if ((filter->rules & GAP_ADVERTISING_REPORT_FILTER_AD_TYPE) != 0u){
+        bool found = false;
+        ad_context_t context;
+        for (ad_iterator_init(&context, data_len, data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+            if (ad_iterator_get_data_type(&context) != filter->ad_type) continue;
+            if (ad_iterator_get_data_len(&context) < filter->ad_data_prefix_len) continue;
+            if (memcmp(ad_iterator_get_data(&context), filter->ad_data_prefix, filter->ad_data_prefix_len) != 0) continue;
+            found = true;
+            break;
+        }
+        if (found == false) return false;
+    }
+    if ((filter->rules & GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID16) != 0u){
+        if (ad_data_contains_uuid16(data_len, data, filter->service_uuid16) == false) return false;
+    }
+    if ((filter->rules & GAP_ADVERTISING_REPORT_FILTER_SERVICE_UUID128) != 0u){
+        if (ad_data_contains_uuid128(data_len, data, filter->service_uuid128) == false) return false;
+    }
+    return true;
+}
+
+// returns true if same advertising data was reported by this advertiser within duplicate window
+static bool hci_le_advertising_report_duplicate(uint8_t event_type, uint8_t address_type, const bd_addr_t address,
+                                                uint8_t data_len, const uint8_t * data){
+    // FNV-1a over event type and advertising data
+    uint32_t data_hash = 2166136261u;
+    data_hash = (data_hash ^ event_type) * 16777619u;
+    uint16_t i;
+    for (i = 0; i < data_len; i++){
+        data_hash = (data_hash ^ data[i]) * 16777619u;
+    }
+
+    uint32_t now_ms = btstack_run_loop_get_time_ms();
+    le_advertising_report_cache_entry_t * oldest = &hci_stack->le_advertising_report_cache[0];
+    for (i = 0; i < HCI_LE_ADVERTISING_REPORT_DUPLICATE_CACHE_SIZE; i++){
+        le_advertising_report_cache_entry_t * entry = &hci_stack->le_advertising_report_cache[i];
+        if ((entry->address_type == address_type) && (bd_addr_cmp(entry->address, address) == 0)){
+            if ((entry->data_hash == data_hash) && ((now_ms - entry->time_ms) < hci_stack->le_advertising_report_duplicate_window_ms)){
+                return true;
+            }
+            entry->data_hash = data_hash;
+            entry->time_ms = now_ms;
+            return false;
+        }
+        if ((int32_t) (entry->time_ms - oldest->time_ms) < 0){
+            oldest = entry;
+        }
+    }
+
+    // replace least recently reported advertiser
+    oldest->address_type = address_type;
+    memcpy(oldest->address, address, 6);
+    oldest->data_hash = data_hash;
+    oldest->time_ms = now_ms;
+    return false;
+}
+
+// check report with address in little-endian order as received from Controller before creating events for it
+static bool hci_le_advertising_report_accept(uint8_t event_type, uint8_t address_type, const uint8_t * address_le, int8_t rssi,
+                                             uint8_t data_len, const uint8_t * data, bool data_complete){
+    // fast path: no filters
+    bool no_filters = btstack_linked_list_empty(&hci_stack->le_advertising_report_filters);
+    if (no_filters && (hci_stack->le_advertising_report_duplicate_window_ms == 0u)) return true;
+
+    bd_addr_t address;
+    reverse_bd_addr(address_le, address);
+
+    if (no_filters == false){
+        bool match = false;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &hci_stack->le_advertising_report_filters);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            const gap_advertising_report_filter_t * filter = (const gap_advertising_report_filter_t *) btstack_linked_list_iterator_next(&it);
+            if (hci_le_advertising_report_filter_match(filter, address_type, address, rssi, data_len, data, data_complete)){
+                match = true;
+                break;
+            }
+        }
+        if (match == false) return false;
+    }
+
+    if ((hci_stack->le_advertising_report_duplicate_window_ms != 0u) && data_complete){
+        if (hci_le_advertising_report_duplicate(event_type, address_type, address, data_len, data)) return false;
+    }
+    return true;
+}
+
 void hci_le_handle_advertisement_report(uint8_t *packet, uint16_t size){
 
     uint16_t offset = 3;
@@ -1649,6 +1815,14 @@ void hci_le_handle_advertisement_report(uint8_t *packet, uint16_t size){
         uint8_t data_length = packet[offset + 8];
         if (data_length > LE_ADVERTISING_DATA_SIZE) return;
         if ((offset + 9u + data_length + 1u) > size)    return;
+        // filter before creating event
+        if (hci_le_advertising_report_accept(packet[offset], packet[offset + 1], &packet[offset + 2],
+                                             (int8_t) packet[offset + 9 + data_length], data_length,
+                                             &packet[offset + 9], true) == false){
+            offset += 10u + data_length;
+            continue;
+        }
+        hci_stack->le_advertising_reports_dropped = false;
         // setup event
         uint8_t event_size = 10u + data_length;
         uint16_t pos = 0;
@@ -1668,6 +1842,66 @@ void hci_le_handle_advertisement_report(uint8_t *packet, uint16_t size){
 }
 
 #ifdef ENABLE_LE_EXTENDED_ADVERTISING
+// fragments of chained Extended Advertising Reports only contain part of the advertising data. The first fragment
+// is checked without rules on advertising data and all following fragments of the same advertiser and SID share its result
+static bool hci_le_extended_advertising_report_accept(uint16_t event_type, const uint8_t * report, uint8_t data_len){
+    const uint8_t * address_le = &report[3];
+    uint8_t address_type = report[2];
+    uint8_t sid = report[11];
+    int8_t  rssi = (int8_t) report[13];
+    const uint8_t * data = &report[24];
+    // data status in bits 5-6: 0 = complete, 1 = incomplete with more data to come, 2 = incomplete and truncated
+    uint8_t data_status = (event_type >> 5) & 0x03u;
+
+    // fast path: no filters
+    if (btstack_linked_list_empty(&hci_stack->le_advertising_report_filters) && (hci_stack->le_advertising_report_duplicate_window_ms == 0u)){
+        return true;
+    }
+
+    // legacy PDUs are never fragmented
+    if ((event_type & 0x10u) != 0u){
+        return hci_le_advertising_report_accept((uint8_t) event_type, address_type, address_le, rssi, data_len, data, true);
+    }
+
+    // following fragment of a chain
+    uint8_t i;
+    for (i = 0; i < HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE; i++){
+        le_advertising_report_chain_t * chain = &hci_stack->le_advertising_report_chains[i];
+        if (chain->active == false) continue;
+        if (chain->address_type != address_type) continue;
+        if (chain->sid != sid) continue;
+        if (memcmp(chain->address, address_le, 6) != 0) continue;
+        if (data_status != 1u){
+            // last fragment
+            chain->active = false;
+        }
+        return chain->accepted;
+    }
+
+    bool accepted = hci_le_advertising_report_accept((uint8_t) event_type, address_type, address_le, rssi, data_len, data,
+                                                     data_status == 0u);
+    if (data_status == 1u){
+        // first fragment of a chain: use free entry or replace entries round-robin
+        le_advertising_report_chain_t * chain = NULL;
+        for (i = 0; i < HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE; i++){
+            if (hci_stack->le_advertising_report_chains[i].active == false){
+                chain = &hci_stack->le_advertising_report_chains[i];
+                break;
+            }
+        }
+        if (chain == NULL){
+            chain = &hci_stack->le_advertising_report_chains[hci_stack->le_advertising_report_chain_next];
+            hci_stack->le_advertising_report_chain_next = (hci_stack->le_advertising_report_chain_next + 1u) % HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE;
+        }
+        memcpy(chain->address, address_le, 6);
+        chain->address_type = address_type;
+        chain->sid = sid;
+        chain->active = true;
+        chain->accepted = accepted;
+    }
+    return accepted;
+}
+
 static void le_handle_extended_advertisement_report(uint8_t *packet, uint16_t size) {
     uint16_t offset = 3;
     uint8_t num_reports = packet[offset++];
@@ -1679,6 +1913,12 @@ static void le_handle_extended_advertisement_report(uint8_t *packet, uint16_t si
         if (data_length > LE_EXTENDED_ADVERTISING_DATA_SIZE) return;
         if ((offset + 24u + data_length) > size)    return;
         uint16_t event_type = little_endian_read_16(packet, offset);
+        // filter before creating event
+        if (hci_le_extended_advertising_report_accept(event_type, &packet[offset], (uint8_t) data_length) == false){
+            offset += 24u + data_length;
+            continue;
+        }
+        hci_stack->le_advertising_reports_dropped = false;
         offset += 2;
         if ((event_type & 0x10) != 0) {
            // setup legacy event
@@ -2789,6 +3029,7 @@ static void hci_handle_connection_failed(hci_connection_t * conn, uint8_t status
     
     // connection failed, remove entry
     btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+    hci_connection_cancel_run(conn);
     btstack_memory_hci_connection_free( conn );
 
 #ifdef ENABLE_CLASSIC
@@ -3001,10 +3242,14 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
     hci_stack->hci_command_con_handle = HCI_CON_HANDLE_INVALID;
 #endif
 
-    // get num cmd packets - limit to 1 to reduce complexity
-    hci_stack->num_cmd_packets = packet[2] ? 1 : 0;
-
     uint16_t opcode = hci_event_command_complete_get_command_opcode(packet);
+
+    // get num cmd packets - limit to 1 to reduce complexity, only LE list updates are pipelined
+    hci_stack->num_cmd_packets_controller = packet[2];
+    if (hci_command_can_be_pipelined(opcode) && (hci_stack->num_cmd_packets_pipelined > 0u)){
+        hci_stack->num_cmd_packets_pipelined--;
+    }
+    hci_stack->num_cmd_packets = ((packet[2] > 0u) && (hci_stack->num_cmd_packets_pipelined == 0u)) ? 1 : 0;
     switch (opcode){
         case HCI_OPCODE_HCI_READ_LOCAL_NAME:
             if (size < (OFFSET_OF_DATA_IN_COMMAND_COMPLETE + 1u)) break;
@@ -3084,10 +3329,18 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
                 conn = hci_connection_for_handle(le_active_command_con_handle);
                 if (conn != NULL){
                     conn->gap_connection_tasks_active &= ~GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH;
+                    hci_connection_trigger_run(conn);
                 }
             }
             break;
 #endif
+#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+        case HCI_OPCODE_HCI_LE_READ_RESOLVING_LIST_SIZE:
+            if (size < (OFFSET_OF_DATA_IN_COMMAND_COMPLETE + 2u)) break;
+            hci_stack->le_resolving_list_size = packet[6];
+            log_info("hci_le_read_resolving_list_size: size %u", hci_stack->le_resolving_list_size);
+            break;
+#endif
 #ifdef ENABLE_LE_CENTRAL
         case HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE:
             if (size < (OFFSET_OF_DATA_IN_COMMAND_COMPLETE + 2u)) break;
@@ -3217,6 +3470,7 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
                     log_info("Read Encryption Key Size failed 0x%02x-> assuming insecure connection with key size of 1", status);
                 }
                 hci_handle_read_encryption_key_size_complete(conn, key_size);
+                hci_connection_trigger_run(conn);
             }
             break;
         // assert pairing complete event is emitted.
@@ -3229,6 +3483,7 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
             conn = hci_connection_for_bd_addr_and_type(hci_stack->gap_pairing_addr, BD_ADDR_TYPE_ACL);
             if (conn == NULL) break;
             hci_pairing_complete(conn, ERROR_CODE_AUTHENTICATION_FAILURE);
+            hci_connection_trigger_run(conn);
             break;
 
 #ifdef ENABLE_CLASSIC_PAIRING_OOB
@@ -3264,6 +3519,7 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
             hci_stack->classic_oob_con_handle = HCI_CON_HANDLE_INVALID;
             if (conn == NULL) break;
             hci_pairing_complete(conn, ERROR_CODE_AUTHENTICATION_FAILURE);
+            hci_connection_trigger_run(conn);
             break;
 #endif
 #endif
@@ -3471,12 +3727,16 @@ static void hci_iso_big_sync_failed(const le_audio_big_sync_t *big_sync, uint8_t
 static void handle_command_status_event(uint8_t * packet, uint16_t size) {
     UNUSED(size);
 
-    // get num cmd packets - limit to 1 to reduce complexity
-    hci_stack->num_cmd_packets = packet[3] ? 1 : 0;
-
     // get opcode and command status
     uint16_t opcode = hci_event_command_status_get_command_opcode(packet);
 
+    // get num cmd packets - limit to 1 to reduce complexity, only LE list updates are pipelined
+    hci_stack->num_cmd_packets_controller = packet[3];
+    if (hci_command_can_be_pipelined(opcode) && (hci_stack->num_cmd_packets_pipelined > 0u)){
+        hci_stack->num_cmd_packets_pipelined--;
+    }
+    hci_stack->num_cmd_packets = ((packet[3] > 0u) && (hci_stack->num_cmd_packets_pipelined == 0u)) ? 1 : 0;
+
 #if defined(ENABLE_CLASSIC) || defined(ENABLE_BLE) || defined(ENABLE_LE_ISOCHRONOUS_STREAMS)
     uint8_t status = hci_event_command_status_get_status(packet);
 #endif
@@ -3610,6 +3870,7 @@ static void handle_command_status_event(uint8_t * packet, uint16_t size) {
             hci_connection_t * conn = hci_connection_for_handle(le_active_command_con_handle);
             if (conn != NULL){
                 conn->gap_connection_tasks_active &= ~gap_connection_task;
+                hci_connection_trigger_run(conn);
             }
         }
     }
@@ -3688,6 +3949,7 @@ static void hci_handle_le_connection_complete_event(const uint8_t * hci_event){
 	        if ((conn != NULL) && cancelled_by_user){
 	            // remove entry
 	            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+	            hci_connection_cancel_run(conn);
 	            btstack_memory_hci_connection_free( conn );
 	        }
 
@@ -3837,11 +4099,13 @@ static void hci_handle_le_meta_event(uint8_t * packet, uint16_t size){
 #ifdef ENABLE_LE_CENTRAL
         case HCI_SUBEVENT_LE_ADVERTISING_REPORT:
             if (!hci_stack->le_scanning_enabled) break;
+            hci_stack->le_advertising_reports_dropped = true;
             hci_le_handle_advertisement_report(packet, size);
             break;
 #ifdef ENABLE_LE_EXTENDED_ADVERTISING
         case HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT:
             if (!hci_stack->le_scanning_enabled) break;
+            hci_stack->le_advertising_reports_dropped = true;
             le_handle_extended_advertisement_report(packet, size);
             break;
         case HCI_SUBEVENT_LE_PERIODIC_ADVERTISING_SYNC_ESTABLISHMENT:
@@ -5173,8 +5437,17 @@ static void event_handler(uint8_t *packet, uint16_t size){
 
     handle_event_for_current_stack_state(packet, size);
 
-    // notify upper stack
-	hci_emit_event(packet, size, 0);   // don't dump, already happened in packet handler
+    // notify upper stack, unless all LE Advertising Reports were dropped by filters
+    bool emit_event = true;
+#ifdef ENABLE_LE_CENTRAL
+    if (hci_stack->le_advertising_reports_dropped){
+        hci_stack->le_advertising_reports_dropped = false;
+        emit_event = false;
+    }
+#endif
+    if (emit_event){
+        hci_emit_event(packet, size, 0);   // don't dump, already happened in packet handler
+    }
 
     // moved here to give upper stack a chance to close down everything with hci_connection_t intact
     if ((hci_event_packet_get_type(packet) == HCI_EVENT_DISCONNECTION_COMPLETE) && (size >= 6u) && (packet[2] == 0)){
@@ -5189,8 +5462,32 @@ static void event_handler(uint8_t *packet, uint16_t size){
 #endif
     }
 
-	// execute main loop
-	hci_run();
+    // execute main loop, flow control and advertising reports don't affect pending connection commands,
+    // command complete/status handlers queue the connection they update
+    switch (hci_event_packet_get_type(packet)){
+        case HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS:
+        case HCI_EVENT_TRANSPORT_PACKET_SENT:
+        case HCI_EVENT_COMMAND_COMPLETE:
+        case HCI_EVENT_COMMAND_STATUS:
+            hci_run_pending();
+            break;
+#ifdef ENABLE_BLE
+        case HCI_EVENT_LE_META:
+            switch (hci_event_le_meta_get_subevent_code(packet)){
+                case HCI_SUBEVENT_LE_ADVERTISING_REPORT:
+                case HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT:
+                    hci_run_pending();
+                    break;
+                default:
+                    hci_run();
+                    break;
+            }
+            break;
+#endif
+        default:
+            hci_run();
+            break;
+    }
 }
 
 #ifdef ENABLE_CLASSIC
@@ -5930,6 +6227,8 @@ static int hci_power_control_wake(void){
 static void hci_power_enter_initializing_state(void){
     // set up state machine
     hci_stack->num_cmd_packets = 1; // assume that one cmd can be sent
+    hci_stack->num_cmd_packets_controller = 1;
+    hci_stack->num_cmd_packets_pipelined = 0;
     hci_stack->hci_packet_buffer_reserved = false;
     hci_stack->state = HCI_STATE_INITIALIZING;
 
@@ -6792,6 +7091,173 @@ static bool hci_whitelist_modification_process(void){
     return false;
 }
 
+// send next update for given LE lists, returns true if command was sent
+static bool hci_run_gap_le_list_updates(uint8_t lists){
+
+#if (defined(ENABLE_LE_CENTRAL) && defined(ENABLE_LE_EXTENDED_ADVERTISING)) || defined(ENABLE_LE_WHITELIST_TOUCH_AFTER_RESOLVING_LIST_UPDATE)
+    btstack_linked_list_iterator_t lit;
+#endif
+
+    // LE Whitelist Management
+    if ((lists & HCI_LE_LIST_FILTER_ACCEPT) != 0u){
+        bool done = hci_whitelist_modification_process();
+        if (done) return true;
+    }
+
+#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+    // LE Resolving List Management
+    if (((lists & HCI_LE_LIST_RESOLVING) != 0u) && (hci_stack->le_resolving_list_state != LE_RESOLVING_LIST_DONE)) {
+		uint16_t i;
+        uint8_t null_16[16];
+        uint8_t local_irk_flipped[16];
+        const uint8_t *local_irk;
+		switch (hci_stack->le_resolving_list_state) {
+			case LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION:
+			case LE_RESOLVING_LIST_READ_SIZE:
+			case LE_RESOLVING_LIST_SEND_CLEAR:
+				// wait for pipelined commands to complete
+				if (hci_stack->num_cmd_packets_pipelined > 0u) return false;
+				break;
+			default:
+				break;
+		}
+		switch (hci_stack->le_resolving_list_state) {
+			case LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION:
+				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_READ_SIZE;
+				hci_send_cmd(&hci_le_set_address_resolution_enabled, 1);
+				return true;
+			case LE_RESOLVING_LIST_READ_SIZE:
+				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SEND_CLEAR;
+				hci_send_cmd(&hci_le_read_resolving_list_size);
+				return true;
+			case LE_RESOLVING_LIST_SEND_CLEAR:
+				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SET_IRK;
+				hci_le_resolving_list_reset();
+				hci_le_resolving_list_sync();
+				hci_send_cmd(&hci_le_clear_resolving_list);
+				return true;
+            case LE_RESOLVING_LIST_SET_IRK:
+                // set IRK used by RPA for undirected advertising
+                hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_UPDATES_ENTRIES;
+                local_irk = gap_get_persistent_irk();
+                reverse_128(local_irk, local_irk_flipped);
+                memset(null_16, 0, sizeof(null_16));
+                hci_send_cmd(&hci_le_add_device_to_resolving_list, BD_ADDR_TYPE_LE_PUBLIC, null_16,
+                             null_16, local_irk_flipped);
+                return true;
+			case LE_RESOLVING_LIST_UPDATES_ENTRIES:
+                // first remove stale and evicted entries, using the address from the shadow copy
+				for (i = 0; i < hci_le_resolving_list_num_indices(); i++) {
+					uint8_t offset = i >> 3;
+					uint8_t mask = 1 << (i & 7);
+					if ((hci_stack->le_resolving_list_remove_entries[offset] & mask) == 0) continue;
+					hci_stack->le_resolving_list_remove_entries[offset] &= ~mask;
+					le_resolving_list_entry_t * list_entry = &hci_stack->le_resolving_list_entries[i];
+					if (list_entry->address_type == (uint8_t) BD_ADDR_TYPE_UNKNOWN) continue;
+					bd_addr_type_t peer_identity_addr_type = (bd_addr_type_t) list_entry->address_type;
+					bd_addr_t peer_identity_addreses;
+					memcpy(peer_identity_addreses, list_entry->address, 6);
+					list_entry->address_type = (uint8_t) BD_ADDR_TYPE_UNKNOWN;
+					hci_stack->le_resolving_list_count--;
+
+#ifdef ENABLE_LE_WHITELIST_TOUCH_AFTER_RESOLVING_LIST_UPDATE
+					// trigger whitelist entry 'update' (work around for controller bug)
+					btstack_linked_list_iterator_init(&lit, &hci_stack->le_whitelist);
+					while (btstack_linked_list_iterator_has_next(&lit)) {
+						whitelist_entry_t *entry = (whitelist_entry_t *) btstack_linked_list_iterator_next(&lit);
+						if (entry->address_type != peer_identity_addr_type) continue;
+						if (memcmp(entry->address, peer_identity_addreses, 6) != 0) continue;
+						log_info("trigger whitelist update %s", bd_addr_to_str(peer_identity_addreses));
+						entry->state |= LE_WHITELIST_REMOVE_FROM_CONTROLLER | LE_WHITELIST_ADD_TO_CONTROLLER;
+					}
+#endif
+
+					hci_send_cmd(&hci_le_remove_device_from_resolving_list, peer_identity_addr_type,
+								 peer_identity_addreses);
+					return true;
+				}
+
+                // then add new entries
+				for (i = 0; i < hci_le_resolving_list_num_indices(); i++) {
+					uint8_t offset = i >> 3;
+					uint8_t mask = 1 << (i & 7);
+					if ((hci_stack->le_resolving_list_add_entries[offset] & mask) == 0) continue;
+					hci_stack->le_resolving_list_add_entries[offset] &= ~mask;
+					le_resolving_list_entry_t * entry = &hci_stack->le_resolving_list_entries[i];
+					if (entry->address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN) continue;
+					if (hci_stack->le_resolving_list_count >= hci_le_resolving_list_capacity()) continue;
+					bd_addr_t peer_identity_addreses;
+					int peer_identity_addr_type;
+					sm_key_t peer_irk;
+					if (hci_le_resolving_list_get_identity(i, &peer_identity_addr_type, peer_identity_addreses, peer_irk) == false) continue;
+					memcpy(entry->address, peer_identity_addreses, 6);
+					entry->address_type = (uint8_t) peer_identity_addr_type;
+					hci_stack->le_resolving_list_count++;
+					local_irk = gap_get_persistent_irk();
+					// command uses format specifier 'P' that stores 16-byte value without flip
+					uint8_t peer_irk_flipped[16];
+					reverse_128(local_irk, local_irk_flipped);
+					reverse_128(peer_irk, peer_irk_flipped);
+					hci_send_cmd(&hci_le_add_device_to_resolving_list, peer_identity_addr_type, peer_identity_addreses,
+								 peer_irk_flipped, local_irk_flipped);
+					return true;
+				}
+
+                // finally, set privacy mode
+                for (i = 0; i < hci_le_resolving_list_num_indices(); i++) {
+                    uint8_t offset = i >> 3;
+                    uint8_t mask = 1 << (i & 7);
+                    if ((hci_stack->le_resolving_list_set_privacy_mode[offset] & mask) == 0) continue;
+                    hci_stack->le_resolving_list_set_privacy_mode[offset] &= ~mask;
+                    if (hci_stack->le_privacy_mode == LE_PRIVACY_MODE_NETWORK) {
+                        // Network Privacy Mode is default
+                        continue;
+                    }
+                    const le_resolving_list_entry_t * entry = &hci_stack->le_resolving_list_entries[i];
+                    if (entry->address_type == (uint8_t) BD_ADDR_TYPE_UNKNOWN) continue;
+                    hci_send_cmd(&hci_le_set_privacy_mode, entry->address_type, entry->address, hci_stack->le_privacy_mode);
+                    return true;
+                }
+				break;
+
+			default:
+				break;
+		}
+        hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_DONE;
+	}
+#endif
+
+#ifdef ENABLE_LE_CENTRAL
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    // LE Periodic Advertiser List Management
+    if ((lists & HCI_LE_LIST_PERIODIC_ADVERTISER) != 0u){
+        // add/remove entries
+        btstack_linked_list_iterator_init(&lit, &hci_stack->le_periodic_advertiser_list);
+        while (btstack_linked_list_iterator_has_next(&lit)){
+            periodic_advertiser_list_entry_t * entry = (periodic_advertiser_list_entry_t*) btstack_linked_list_iterator_next(&lit);
+            if (entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_REMOVE_FROM_CONTROLLER){
+                entry->state &= ~LE_PERIODIC_ADVERTISER_LIST_ENTRY_REMOVE_FROM_CONTROLLER;
+                hci_send_cmd(&hci_le_remove_device_from_periodic_advertiser_list, entry->address_type, entry->address, entry->sid);
+                return true;
+            }
+            if (entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_ADD_TO_CONTROLLER){
+                entry->state &= ~LE_PERIODIC_ADVERTISER_LIST_ENTRY_ADD_TO_CONTROLLER;
+                entry->state |= LE_PERIODIC_ADVERTISER_LIST_ENTRY_ON_CONTROLLER;
+                hci_send_cmd(&hci_le_add_device_to_periodic_advertiser_list, entry->address_type, entry->address, entry->sid);
+                return true;
+            }
+            if ((entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_ON_CONTROLLER) == 0){
+                btstack_linked_list_remove(&hci_stack->le_periodic_advertiser_list, (btstack_linked_item_t *) entry);
+                btstack_memory_periodic_advertiser_list_entry_free(entry);
+            }
+        }
+    }
+#endif
+#endif
+
+    return false;
+}
+
 static bool hci_run_general_gap_le(void){
 
 #if defined(ENABLE_LE_EXTENDED_ADVERTISING) || defined(ENABLE_LE_WHITELIST_TOUCH_AFTER_RESOLVING_LIST_UPDATE)
@@ -7345,158 +7811,28 @@ static bool hci_run_general_gap_le(void){
 #endif
 #endif
 
-    // LE Whitelist Management
+    // LE Whitelist, Resolving List, and Periodic Advertiser List Management
+    uint8_t lists = 0;
     if (whitelist_modification_pending){
-        bool done = hci_whitelist_modification_process();
+        lists |= HCI_LE_LIST_FILTER_ACCEPT;
+    }
+    if (resolving_list_modification_pending){
+        lists |= HCI_LE_LIST_RESOLVING;
+    }
+#ifdef ENABLE_LE_CENTRAL
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    if (periodic_list_modification_pending){
+        lists |= HCI_LE_LIST_PERIODIC_ADVERTISER;
+    }
+#endif
+#endif
+    if (lists != 0u){
+        // lists are not in use, further updates can be pipelined, see hci_run_pending
+        hci_stack->le_list_updates_pipelined = lists;
+        bool done = hci_run_gap_le_list_updates(lists);
         if (done) return true;
     }
 
-#ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
-    // LE Resolving List Management
-    if (resolving_list_modification_pending) {
-		uint16_t i;
-        uint8_t null_16[16];
-        uint8_t local_irk_flipped[16];
-        const uint8_t *local_irk;
-		switch (hci_stack->le_resolving_list_state) {
-			case LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION:
-				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_READ_SIZE;
-				hci_send_cmd(&hci_le_set_address_resolution_enabled, 1);
-				return true;
-			case LE_RESOLVING_LIST_READ_SIZE:
-				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SEND_CLEAR;
-				hci_send_cmd(&hci_le_read_resolving_list_size);
-				return true;
-			case LE_RESOLVING_LIST_SEND_CLEAR:
-				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SET_IRK;
-				(void) memset(hci_stack->le_resolving_list_add_entries, 0xff,
-							  sizeof(hci_stack->le_resolving_list_add_entries));
-                (void) memset(hci_stack->le_resolving_list_set_privacy_mode, 0xff,
-                              sizeof(hci_stack->le_resolving_list_set_privacy_mode));
-				(void) memset(hci_stack->le_resolving_list_remove_entries, 0,
-							  sizeof(hci_stack->le_resolving_list_remove_entries));
-				hci_send_cmd(&hci_le_clear_resolving_list);
-				return true;
-            case LE_RESOLVING_LIST_SET_IRK:
-                // set IRK used by RPA for undirected advertising
-                hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_UPDATES_ENTRIES;
-                local_irk = gap_get_persistent_irk();
-                reverse_128(local_irk, local_irk_flipped);
-                memset(null_16, 0, sizeof(null_16));
-                hci_send_cmd(&hci_le_add_device_to_resolving_list, BD_ADDR_TYPE_LE_PUBLIC, null_16,
-                             null_16, local_irk_flipped);
-                return true;
-			case LE_RESOLVING_LIST_UPDATES_ENTRIES:
-                // first remove old entries
-				for (i = 0; i < MAX_NUM_RESOLVING_LIST_ENTRIES && i < le_device_db_max_count(); i++) {
-					uint8_t offset = i >> 3;
-					uint8_t mask = 1 << (i & 7);
-					if ((hci_stack->le_resolving_list_remove_entries[offset] & mask) == 0) continue;
-					hci_stack->le_resolving_list_remove_entries[offset] &= ~mask;
-					bd_addr_t peer_identity_addreses;
-					int peer_identity_addr_type = (int) BD_ADDR_TYPE_UNKNOWN;
-					sm_key_t peer_irk;
-					le_device_db_info(i, &peer_identity_addr_type, peer_identity_addreses, peer_irk);
-					if (peer_identity_addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
-
-#ifdef ENABLE_LE_WHITELIST_TOUCH_AFTER_RESOLVING_LIST_UPDATE
-					// trigger whitelist entry 'update' (work around for controller bug)
-					btstack_linked_list_iterator_init(&lit, &hci_stack->le_whitelist);
-					while (btstack_linked_list_iterator_has_next(&lit)) {
-						whitelist_entry_t *entry = (whitelist_entry_t *) btstack_linked_list_iterator_next(&lit);
-						if ((int)entry->address_type != peer_identity_addr_type) continue;
-						if (memcmp(entry->address, peer_identity_addreses, 6) != 0) continue;
-						log_info("trigger whitelist update %s", bd_addr_to_str(peer_identity_addreses));
-						entry->state |= LE_WHITELIST_REMOVE_FROM_CONTROLLER | LE_WHITELIST_ADD_TO_CONTROLLER;
-					}
-#endif
-
-					hci_send_cmd(&hci_le_remove_device_from_resolving_list, peer_identity_addr_type,
-								 peer_identity_addreses);
-					return true;
-				}
-
-                // then add new entries
-				for (i = 0; i < MAX_NUM_RESOLVING_LIST_ENTRIES && i < le_device_db_max_count(); i++) {
-					uint8_t offset = i >> 3;
-					uint8_t mask = 1 << (i & 7);
-					if ((hci_stack->le_resolving_list_add_entries[offset] & mask) == 0) continue;
-					hci_stack->le_resolving_list_add_entries[offset] &= ~mask;
-					bd_addr_t peer_identity_addreses;
-					int peer_identity_addr_type = (int) BD_ADDR_TYPE_UNKNOWN;
-					sm_key_t peer_irk;
-					le_device_db_info(i, &peer_identity_addr_type, peer_identity_addreses, peer_irk);
-					if (peer_identity_addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
-                    if (btstack_is_null(peer_irk, 16)) continue;
-					local_irk = gap_get_persistent_irk();
-					// command uses format specifier 'P' that stores 16-byte value without flip
-					uint8_t peer_irk_flipped[16];
-					reverse_128(local_irk, local_irk_flipped);
-					reverse_128(peer_irk, peer_irk_flipped);
-					hci_send_cmd(&hci_le_add_device_to_resolving_list, peer_identity_addr_type, peer_identity_addreses,
-								 peer_irk_flipped, local_irk_flipped);
-					return true;
-				}
-
-                // finally, set privacy mode
-                for (i = 0; i < MAX_NUM_RESOLVING_LIST_ENTRIES && i < le_device_db_max_count(); i++) {
-                    uint8_t offset = i >> 3;
-                    uint8_t mask = 1 << (i & 7);
-                    if ((hci_stack->le_resolving_list_set_privacy_mode[offset] & mask) == 0) continue;
-                    hci_stack->le_resolving_list_set_privacy_mode[offset] &= ~mask;
-                    if (hci_stack->le_privacy_mode == LE_PRIVACY_MODE_NETWORK) {
-                        // Network Privacy Mode is default
-                        continue;
-                    }
-                    bd_addr_t peer_identity_address;
-                    int peer_identity_addr_type = (int) BD_ADDR_TYPE_UNKNOWN;
-                    sm_key_t peer_irk;
-                    le_device_db_info(i, &peer_identity_addr_type, peer_identity_address, peer_irk);
-                    if (peer_identity_addr_type == BD_ADDR_TYPE_UNKNOWN) continue;
-                    if (btstack_is_null(peer_irk, 16)) continue;
-                    // command uses format specifier 'P' that stores 16-byte value without flip
-                    uint8_t peer_irk_flipped[16];
-                    reverse_128(peer_irk, peer_irk_flipped);
-                    hci_send_cmd(&hci_le_set_privacy_mode, peer_identity_addr_type, peer_identity_address, hci_stack->le_privacy_mode);
-                    return true;
-                }
-				break;
-
-			default:
-				break;
-		}
-        hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_DONE;
-	}
-#endif
-
-#ifdef ENABLE_LE_CENTRAL
-#ifdef ENABLE_LE_EXTENDED_ADVERTISING
-    // LE Whitelist Management
-    if (periodic_list_modification_pending){
-        // add/remove entries
-        btstack_linked_list_iterator_init(&lit, &hci_stack->le_periodic_advertiser_list);
-        while (btstack_linked_list_iterator_has_next(&lit)){
-            periodic_advertiser_list_entry_t * entry = (periodic_advertiser_list_entry_t*) btstack_linked_list_iterator_next(&lit);
-            if (entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_REMOVE_FROM_CONTROLLER){
-                entry->state &= ~LE_PERIODIC_ADVERTISER_LIST_ENTRY_REMOVE_FROM_CONTROLLER;
-                hci_send_cmd(&hci_le_remove_device_from_periodic_advertiser_list, entry->address_type, entry->address, entry->sid);
-                return true;
-            }
-            if (entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_ADD_TO_CONTROLLER){
-                entry->state &= ~LE_PERIODIC_ADVERTISER_LIST_ENTRY_ADD_TO_CONTROLLER;
-                entry->state |= LE_PERIODIC_ADVERTISER_LIST_ENTRY_ON_CONTROLLER;
-                hci_send_cmd(&hci_le_add_device_to_periodic_advertiser_list, entry->address_type, entry->address, entry->sid);
-                return true;
-            }
-            if ((entry->state & LE_PERIODIC_ADVERTISER_LIST_ENTRY_ON_CONTROLLER) == 0){
-                btstack_linked_list_remove(&hci_stack->le_periodic_advertiser_list, (btstack_linked_item_t *) entry);
-                btstack_memory_periodic_advertiser_list_entry_free(entry);
-            }
-        }
-    }
-#endif
-#endif
-
 #ifdef ENABLE_LE_CENTRAL
 #ifdef ENABLE_LE_EXTENDED_ADVERTISING
 #ifdef ENABLE_LE_PERIODIC_ADVERTISING
@@ -7894,415 +8230,446 @@ static bool hci_run_iso_tasks(void){
 #endif /* ENABLE_LE_ISOCHRONOUS_STREAMS */
 #endif
 
-static bool hci_run_general_pending_commands(void){
-    btstack_linked_item_t * it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
-        hci_connection_t * connection = (hci_connection_t *) it;
-
-        switch(connection->state){
-            case SEND_CREATE_CONNECTION:
-                switch(connection->address_type){
+// returns true if a command was sent for the connection
+static bool hci_run_general_pending_commands_for_connection(hci_connection_t * connection){
+    switch(connection->state){
+        case SEND_CREATE_CONNECTION:
+            switch(connection->address_type){
 #ifdef ENABLE_CLASSIC
-                    case BD_ADDR_TYPE_ACL:
-                        log_info("sending hci_create_connection");
-                        hci_send_cmd(&hci_create_connection, connection->address, hci_usable_acl_packet_types(), 1, 0, 0, hci_stack->allow_role_switch);
-                        break;
+                case BD_ADDR_TYPE_ACL:
+                    log_info("sending hci_create_connection");
+                    hci_send_cmd(&hci_create_connection, connection->address, hci_usable_acl_packet_types(), 1, 0, 0, hci_stack->allow_role_switch);
+                    break;
 #endif
-                    default:
+                default:
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
-                        log_info("sending hci_le_create_connection");
-                        hci_stack->le_connection_own_addr_type =  hci_stack->le_own_addr_type;
-                        hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, hci_stack->le_connection_own_address);
-                        connection->state = SENT_CREATE_CONNECTION;
-                        hci_send_le_create_connection(0, connection->address_type, connection->address);
+                    log_info("sending hci_le_create_connection");
+                    hci_stack->le_connection_own_addr_type =  hci_stack->le_own_addr_type;
+                    hci_get_own_address_for_addr_type(hci_stack->le_connection_own_addr_type, hci_stack->le_connection_own_address);
+                    connection->state = SENT_CREATE_CONNECTION;
+                    hci_send_le_create_connection(0, connection->address_type, connection->address);
 #endif
 #endif
-                        break;
-                }
-                return true;
+                    break;
+            }
+            return true;
 
 #ifdef ENABLE_CLASSIC
-            case RECEIVED_CONNECTION_REQUEST:
-                if (connection->address_type == BD_ADDR_TYPE_ACL){
-                    log_info("sending hci_accept_connection_request");
-                    connection->state = ACCEPTED_CONNECTION_REQUEST;
-                    connection->role = HCI_ROLE_SLAVE;
-                    hci_send_cmd(&hci_accept_connection_request, connection->address, hci_stack->master_slave_policy);
-                    return true;
-                }
-                break;
-#endif
-            case SEND_DISCONNECT:
-                connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+        case RECEIVED_CONNECTION_REQUEST:
+            if (connection->address_type == BD_ADDR_TYPE_ACL){
+                log_info("sending hci_accept_connection_request");
+                connection->state = ACCEPTED_CONNECTION_REQUEST;
+                connection->role = HCI_ROLE_SLAVE;
+                hci_send_cmd(&hci_accept_connection_request, connection->address, hci_stack->master_slave_policy);
                 return true;
+            }
+            break;
+#endif
+        case SEND_DISCONNECT:
+            connection->state = SENT_DISCONNECT;
+            hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+            return true;
 
-            default:
-                break;
-        }
+        default:
+            break;
+    }
 
-        // no further commands if connection is about to get shut down
-        if (connection->state == SENT_DISCONNECT) continue;
+    // no further commands if connection is about to get shut down
+    if (connection->state == SENT_DISCONNECT) return false;
 
 #ifdef ENABLE_CLASSIC
 
-        // Handling link key request requires remote supported features
-        if (((connection->authentication_flags & AUTH_FLAG_HANDLE_LINK_KEY_REQUEST) != 0)){
-            log_info("responding to link key request, have link key db: %u", hci_stack->link_key_db != NULL);
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_HANDLE_LINK_KEY_REQUEST);
+    // Handling link key request requires remote supported features
+    if (((connection->authentication_flags & AUTH_FLAG_HANDLE_LINK_KEY_REQUEST) != 0)){
+        log_info("responding to link key request, have link key db: %u", hci_stack->link_key_db != NULL);
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_HANDLE_LINK_KEY_REQUEST);
 
-            bool have_link_key = connection->link_key_type != INVALID_LINK_KEY;
-            bool security_level_sufficient = have_link_key && (gap_security_level_for_link_key_type(connection->link_key_type) >= connection->requested_security_level);
-            if (have_link_key && security_level_sufficient){
-                hci_send_cmd(&hci_link_key_request_reply, connection->address, &connection->link_key);
-            } else {
-                hci_send_cmd(&hci_link_key_request_negative_reply, connection->address);
-            }
-            return true;
+        bool have_link_key = connection->link_key_type != INVALID_LINK_KEY;
+        bool security_level_sufficient = have_link_key && (gap_security_level_for_link_key_type(connection->link_key_type) >= connection->requested_security_level);
+        if (have_link_key && security_level_sufficient){
+            hci_send_cmd(&hci_link_key_request_reply, connection->address, &connection->link_key);
+        } else {
+            hci_send_cmd(&hci_link_key_request_negative_reply, connection->address);
         }
+        return true;
+    }
 
-        if (connection->authentication_flags & AUTH_FLAG_DENY_PIN_CODE_REQUEST){
-            log_info("denying to pin request");
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_DENY_PIN_CODE_REQUEST);
-            hci_send_cmd(&hci_pin_code_request_negative_reply, connection->address);
-            return true;
-        }
+    if (connection->authentication_flags & AUTH_FLAG_DENY_PIN_CODE_REQUEST){
+        log_info("denying to pin request");
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_DENY_PIN_CODE_REQUEST);
+        hci_send_cmd(&hci_pin_code_request_negative_reply, connection->address);
+        return true;
+    }
 
-        // security assessment requires remote features
-        if ((connection->authentication_flags & AUTH_FLAG_RECV_IO_CAPABILITIES_REQUEST) != 0){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_RECV_IO_CAPABILITIES_REQUEST);
-            hci_ssp_assess_security_on_io_cap_request(connection);
-            // no return here as hci_ssp_assess_security_on_io_cap_request only sets AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY or AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY
-        }
-
-        if (connection->authentication_flags & AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY);
-            // set authentication requirements:
-            // - MITM = ssp_authentication_requirement (USER) | requested_security_level (dynamic)
-            // - BONDING MODE: dedicated if requested, bondable otherwise. Drop bondable if not set for remote
-            connection->io_cap_request_auth_req = hci_stack->ssp_authentication_requirement & 1;
-            if (gap_mitm_protection_required_for_security_level(connection->requested_security_level)){
-                connection->io_cap_request_auth_req |= 1;
-            }
-            bool bonding = hci_stack->bondable;
-            if (connection->authentication_flags & AUTH_FLAG_RECV_IO_CAPABILITIES_RESPONSE){
-                // if we have received IO Cap Response, we're in responder role
-                bool remote_bonding = connection->io_cap_response_auth_req >= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_DEDICATED_BONDING;
-                if (bonding && !remote_bonding){
-                    log_info("Remote not bonding, dropping local flag");
-                    bonding = false;
-                }
+    // security assessment requires remote features
+    if ((connection->authentication_flags & AUTH_FLAG_RECV_IO_CAPABILITIES_REQUEST) != 0){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_RECV_IO_CAPABILITIES_REQUEST);
+        hci_ssp_assess_security_on_io_cap_request(connection);
+        // no return here as hci_ssp_assess_security_on_io_cap_request only sets AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY or AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY
+    }
+
+    if (connection->authentication_flags & AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_IO_CAPABILITIES_REPLY);
+        // set authentication requirements:
+        // - MITM = ssp_authentication_requirement (USER) | requested_security_level (dynamic)
+        // - BONDING MODE: dedicated if requested, bondable otherwise. Drop bondable if not set for remote
+        connection->io_cap_request_auth_req = hci_stack->ssp_authentication_requirement & 1;
+        if (gap_mitm_protection_required_for_security_level(connection->requested_security_level)){
+            connection->io_cap_request_auth_req |= 1;
+        }
+        bool bonding = hci_stack->bondable;
+        if (connection->authentication_flags & AUTH_FLAG_RECV_IO_CAPABILITIES_RESPONSE){
+            // if we have received IO Cap Response, we're in responder role
+            bool remote_bonding = connection->io_cap_response_auth_req >= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_DEDICATED_BONDING;
+            if (bonding && !remote_bonding){
+                log_info("Remote not bonding, dropping local flag");
+                bonding = false;
             }
-            if (bonding){
-                if (connection->bonding_flags & BONDING_DEDICATED){
-                    connection->io_cap_request_auth_req |= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_DEDICATED_BONDING;
-                } else {
-                    connection->io_cap_request_auth_req |= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_GENERAL_BONDING;
-                }
+        }
+        if (bonding){
+            if (connection->bonding_flags & BONDING_DEDICATED){
+                connection->io_cap_request_auth_req |= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_DEDICATED_BONDING;
+            } else {
+                connection->io_cap_request_auth_req |= SSP_IO_AUTHREQ_MITM_PROTECTION_NOT_REQUIRED_GENERAL_BONDING;
             }
-            uint8_t have_oob_data = 0;
+        }
+        uint8_t have_oob_data = 0;
 #ifdef ENABLE_CLASSIC_PAIRING_OOB
-            if (connection->classic_oob_c_192 != NULL){
-                    have_oob_data |= 1;
-            }
-            if (connection->classic_oob_c_256 != NULL){
-                have_oob_data |= 2;
-            }
-#endif
-            hci_send_cmd(&hci_io_capability_request_reply, &connection->address, hci_stack->ssp_io_capability, have_oob_data, connection->io_cap_request_auth_req);
-            return true;
+        if (connection->classic_oob_c_192 != NULL){
+                have_oob_data |= 1;
         }
-
-        if (connection->authentication_flags & AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY) {
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY);
-            hci_send_cmd(&hci_io_capability_request_negative_reply, &connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED);
-            return true;
+        if (connection->classic_oob_c_256 != NULL){
+            have_oob_data |= 2;
         }
+#endif
+        hci_send_cmd(&hci_io_capability_request_reply, &connection->address, hci_stack->ssp_io_capability, have_oob_data, connection->io_cap_request_auth_req);
+        return true;
+    }
 
-#ifdef ENABLE_CLASSIC_PAIRING_OOB
-        if (connection->authentication_flags & AUTH_FLAG_SEND_REMOTE_OOB_DATA_REPLY){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_REMOTE_OOB_DATA_REPLY);
-            const uint8_t zero[16] = { 0 };
-            const uint8_t * r_192 = zero;
-            const uint8_t * c_192 = zero;
-            const uint8_t * r_256 = zero;
-            const uint8_t * c_256 = zero;
-            // verify P-256 OOB
-            if ((connection->classic_oob_c_256 != NULL) && hci_command_supported(SUPPORTED_HCI_COMMAND_REMOTE_OOB_EXTENDED_DATA_REQUEST_REPLY)) {
-                c_256 = connection->classic_oob_c_256;
-                if (connection->classic_oob_r_256 != NULL) {
-                    r_256 = connection->classic_oob_r_256;
-                }
-            }
-            // verify P-192 OOB
-            if ((connection->classic_oob_c_192 != NULL)) {
-                c_192 = connection->classic_oob_c_192;
-                if (connection->classic_oob_r_192 != NULL) {
-                    r_192 = connection->classic_oob_r_192;
-                }
-            }
-
-            // assess security
-            bool need_level_4 = hci_stack->gap_secure_connections_only_mode || (connection->requested_security_level == LEVEL_4);
-            bool can_reach_level_4 = hci_remote_sc_enabled(connection) && (c_256 != NULL);
-            if (need_level_4 && !can_reach_level_4){
-                log_info("Level 4 required, but not possible -> abort");
-                hci_pairing_complete(connection, ERROR_CODE_INSUFFICIENT_SECURITY);
-                // send oob negative reply
-                c_256 = NULL;
-                c_192 = NULL;
-            }
+    if (connection->authentication_flags & AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY) {
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_IO_CAPABILITIES_NEGATIVE_REPLY);
+        hci_send_cmd(&hci_io_capability_request_negative_reply, &connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED);
+        return true;
+    }
 
-            // Reply
-            if (c_256 != zero) {
-                hci_send_cmd(&hci_remote_oob_extended_data_request_reply, &connection->address, c_192, r_192, c_256, r_256);
-            } else if (c_192 != zero){
-                hci_send_cmd(&hci_remote_oob_data_request_reply, &connection->address, c_192, r_192);
-            } else {
-                hci_stack->classic_oob_con_handle = connection->con_handle;
-                hci_send_cmd(&hci_remote_oob_data_request_negative_reply, &connection->address);
-            }
-            return true;
+#ifdef ENABLE_CLASSIC_PAIRING_OOB
+    if (connection->authentication_flags & AUTH_FLAG_SEND_REMOTE_OOB_DATA_REPLY){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_REMOTE_OOB_DATA_REPLY);
+        const uint8_t zero[16] = { 0 };
+        const uint8_t * r_192 = zero;
+        const uint8_t * c_192 = zero;
+        const uint8_t * r_256 = zero;
+        const uint8_t * c_256 = zero;
+        // verify P-256 OOB
+        if ((connection->classic_oob_c_256 != NULL) && hci_command_supported(SUPPORTED_HCI_COMMAND_REMOTE_OOB_EXTENDED_DATA_REQUEST_REPLY)) {
+            c_256 = connection->classic_oob_c_256;
+            if (connection->classic_oob_r_256 != NULL) {
+                r_256 = connection->classic_oob_r_256;
+            }
+        }
+        // verify P-192 OOB
+        if ((connection->classic_oob_c_192 != NULL)) {
+            c_192 = connection->classic_oob_c_192;
+            if (connection->classic_oob_r_192 != NULL) {
+                r_192 = connection->classic_oob_r_192;
+            }
+        }
+
+        // assess security
+        bool need_level_4 = hci_stack->gap_secure_connections_only_mode || (connection->requested_security_level == LEVEL_4);
+        bool can_reach_level_4 = hci_remote_sc_enabled(connection) && (c_256 != NULL);
+        if (need_level_4 && !can_reach_level_4){
+            log_info("Level 4 required, but not possible -> abort");
+            hci_pairing_complete(connection, ERROR_CODE_INSUFFICIENT_SECURITY);
+            // send oob negative reply
+            c_256 = NULL;
+            c_192 = NULL;
+        }
+
+        // Reply
+        if (c_256 != zero) {
+            hci_send_cmd(&hci_remote_oob_extended_data_request_reply, &connection->address, c_192, r_192, c_256, r_256);
+        } else if (c_192 != zero){
+            hci_send_cmd(&hci_remote_oob_data_request_reply, &connection->address, c_192, r_192);
+        } else {
+            hci_stack->classic_oob_con_handle = connection->con_handle;
+            hci_send_cmd(&hci_remote_oob_data_request_negative_reply, &connection->address);
         }
+        return true;
+    }
 #endif
 
-        if (connection->authentication_flags & AUTH_FLAG_SEND_USER_CONFIRM_REPLY){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_CONFIRM_REPLY);
-            hci_send_cmd(&hci_user_confirmation_request_reply, &connection->address);
-            return true;
-        }
+    if (connection->authentication_flags & AUTH_FLAG_SEND_USER_CONFIRM_REPLY){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_CONFIRM_REPLY);
+        hci_send_cmd(&hci_user_confirmation_request_reply, &connection->address);
+        return true;
+    }
 
-        if (connection->authentication_flags & AUTH_FLAG_SEND_USER_CONFIRM_NEGATIVE_REPLY){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_CONFIRM_NEGATIVE_REPLY);
-            hci_send_cmd(&hci_user_confirmation_request_negative_reply, &connection->address);
-            return true;
-        }
+    if (connection->authentication_flags & AUTH_FLAG_SEND_USER_CONFIRM_NEGATIVE_REPLY){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_CONFIRM_NEGATIVE_REPLY);
+        hci_send_cmd(&hci_user_confirmation_request_negative_reply, &connection->address);
+        return true;
+    }
 
-        if (connection->authentication_flags & AUTH_FLAG_SEND_USER_PASSKEY_REPLY){
-            hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_PASSKEY_REPLY);
-            hci_send_cmd(&hci_user_passkey_request_reply, &connection->address, 000000);
-            return true;
-        }
+    if (connection->authentication_flags & AUTH_FLAG_SEND_USER_PASSKEY_REPLY){
+        hci_connection_clear_authentication_flags(connection, AUTH_FLAG_SEND_USER_PASSKEY_REPLY);
+        hci_send_cmd(&hci_user_passkey_request_reply, &connection->address, 000000);
+        return true;
+    }
 
-        if ((connection->bonding_flags & (BONDING_DISCONNECT_DEDICATED_DONE | BONDING_DEDICATED_DEFER_DISCONNECT)) == BONDING_DISCONNECT_DEDICATED_DONE){
-            connection->bonding_flags &= ~BONDING_DISCONNECT_DEDICATED_DONE;
-            connection->bonding_flags |= BONDING_EMIT_COMPLETE_ON_DISCONNECT;
-            connection->state = SENT_DISCONNECT;
-            hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
-            return true;
-        }
+    if ((connection->bonding_flags & (BONDING_DISCONNECT_DEDICATED_DONE | BONDING_DEDICATED_DEFER_DISCONNECT)) == BONDING_DISCONNECT_DEDICATED_DONE){
+        connection->bonding_flags &= ~BONDING_DISCONNECT_DEDICATED_DONE;
+        connection->bonding_flags |= BONDING_EMIT_COMPLETE_ON_DISCONNECT;
+        connection->state = SENT_DISCONNECT;
+        hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+        return true;
+    }
 
-        if ((connection->bonding_flags & BONDING_SEND_AUTHENTICATE_REQUEST) && ((connection->bonding_flags & BONDING_RECEIVED_REMOTE_FEATURES) != 0)){
-            connection->bonding_flags &= ~BONDING_SEND_AUTHENTICATE_REQUEST;
-            connection->bonding_flags |= BONDING_SENT_AUTHENTICATE_REQUEST;
-            hci_send_cmd(&hci_authentication_requested, connection->con_handle);
-            return true;
-        }
+    if ((connection->bonding_flags & BONDING_SEND_AUTHENTICATE_REQUEST) && ((connection->bonding_flags & BONDING_RECEIVED_REMOTE_FEATURES) != 0)){
+        connection->bonding_flags &= ~BONDING_SEND_AUTHENTICATE_REQUEST;
+        connection->bonding_flags |= BONDING_SENT_AUTHENTICATE_REQUEST;
+        hci_send_cmd(&hci_authentication_requested, connection->con_handle);
+        return true;
+    }
 
-        if (connection->bonding_flags & BONDING_SEND_ENCRYPTION_REQUEST){
-            connection->bonding_flags &= ~BONDING_SEND_ENCRYPTION_REQUEST;
-            hci_send_cmd(&hci_set_connection_encryption, connection->con_handle, 1);
-            return true;
-        }
+    if (connection->bonding_flags & BONDING_SEND_ENCRYPTION_REQUEST){
+        connection->bonding_flags &= ~BONDING_SEND_ENCRYPTION_REQUEST;
+        hci_send_cmd(&hci_set_connection_encryption, connection->con_handle, 1);
+        return true;
+    }
 
-        if (connection->bonding_flags & BONDING_SEND_READ_ENCRYPTION_KEY_SIZE){
-            connection->bonding_flags &= ~BONDING_SEND_READ_ENCRYPTION_KEY_SIZE;
-            hci_send_cmd(&hci_read_encryption_key_size, connection->con_handle, 1);
-            return true;
-        }
+    if (connection->bonding_flags & BONDING_SEND_READ_ENCRYPTION_KEY_SIZE){
+        connection->bonding_flags &= ~BONDING_SEND_READ_ENCRYPTION_KEY_SIZE;
+        hci_send_cmd(&hci_read_encryption_key_size, connection->con_handle, 1);
+        return true;
+    }
 
-        if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_0){
-            connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_0;
-            hci_send_cmd(&hci_read_remote_supported_features_command, connection->con_handle);
-            return true;
-        }
+    if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_0){
+        connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_0;
+        hci_send_cmd(&hci_read_remote_supported_features_command, connection->con_handle);
+        return true;
+    }
 
-        if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_1){
-            connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_1;
-            hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 1);
-            return true;
-        }
+    if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_1){
+        connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_1;
+        hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 1);
+        return true;
+    }
 
-        if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_2){
-            connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_2;
-            hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 2);
-            return true;
-        }
+    if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_2){
+        connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_2;
+        hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 2);
+        return true;
+    }
 #endif
 
-        if (connection->bonding_flags & BONDING_DISCONNECT_SECURITY_BLOCK){
-            connection->bonding_flags &= ~BONDING_DISCONNECT_SECURITY_BLOCK;
+    if (connection->bonding_flags & BONDING_DISCONNECT_SECURITY_BLOCK){
+        connection->bonding_flags &= ~BONDING_DISCONNECT_SECURITY_BLOCK;
 #ifdef ENABLE_CLASSIC
-            hci_pairing_complete(connection, ERROR_CODE_CONNECTION_REJECTED_DUE_TO_SECURITY_REASONS);
+        hci_pairing_complete(connection, ERROR_CODE_CONNECTION_REJECTED_DUE_TO_SECURITY_REASONS);
 #endif
-            if (connection->state != SENT_DISCONNECT){
-                connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE);
-                return true;
-            }
+        if (connection->state != SENT_DISCONNECT){
+            connection->state = SENT_DISCONNECT;
+            hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE);
+            return true;
         }
+    }
 
 #ifdef ENABLE_CLASSIC
-        uint16_t sniff_min_interval;
-        switch (connection->sniff_min_interval){
-            case 0:
-                break;
-            case 0xffff:
-                connection->sniff_min_interval = 0;
-                hci_send_cmd(&hci_exit_sniff_mode, connection->con_handle);
-                return true;
-            default:
-                sniff_min_interval = connection->sniff_min_interval;
-                connection->sniff_min_interval = 0;
-                hci_send_cmd(&hci_sniff_mode, connection->con_handle, connection->sniff_max_interval, sniff_min_interval, connection->sniff_attempt, connection->sniff_timeout);
-                return true;
-        }
-
-        if (connection->sniff_subrating_max_latency != 0xFFFFu){
-            uint16_t max_latency = connection->sniff_subrating_max_latency;
-            connection->sniff_subrating_max_latency = 0xFFFFu;
-            hci_send_cmd(&hci_sniff_subrating, connection->con_handle, max_latency, connection->sniff_subrating_min_remote_timeout, connection->sniff_subrating_min_local_timeout);
+    uint16_t sniff_min_interval;
+    switch (connection->sniff_min_interval){
+        case 0:
+            break;
+        case 0xffff:
+            connection->sniff_min_interval = 0;
+            hci_send_cmd(&hci_exit_sniff_mode, connection->con_handle);
             return true;
-        }
+        default:
+            sniff_min_interval = connection->sniff_min_interval;
+            connection->sniff_min_interval = 0;
+            hci_send_cmd(&hci_sniff_mode, connection->con_handle, connection->sniff_max_interval, sniff_min_interval, connection->sniff_attempt, connection->sniff_timeout);
+            return true;
+    }
+
+    if (connection->sniff_subrating_max_latency != 0xFFFFu){
+        uint16_t max_latency = connection->sniff_subrating_max_latency;
+        connection->sniff_subrating_max_latency = 0xFFFFu;
+        hci_send_cmd(&hci_sniff_subrating, connection->con_handle, max_latency, connection->sniff_subrating_min_remote_timeout, connection->sniff_subrating_min_local_timeout);
+        return true;
+    }
+
+    if (connection->qos_service_type != HCI_SERVICE_TYPE_INVALID){
+        uint8_t service_type = (uint8_t) connection->qos_service_type;
+        connection->qos_service_type = HCI_SERVICE_TYPE_INVALID;
+        hci_send_cmd(&hci_qos_setup, connection->con_handle, 0, service_type, connection->qos_token_rate, connection->qos_peak_bandwidth, connection->qos_latency, connection->qos_delay_variation);
+        return true;
+    }
 
-        if (connection->qos_service_type != HCI_SERVICE_TYPE_INVALID){
-            uint8_t service_type = (uint8_t) connection->qos_service_type;
-            connection->qos_service_type = HCI_SERVICE_TYPE_INVALID;
-            hci_send_cmd(&hci_qos_setup, connection->con_handle, 0, service_type, connection->qos_token_rate, connection->qos_peak_bandwidth, connection->qos_latency, connection->qos_delay_variation);
+    if (connection->request_role != HCI_ROLE_INVALID){
+        hci_role_t role = connection->request_role;
+        connection->request_role = HCI_ROLE_INVALID;
+        hci_send_cmd(&hci_switch_role_command, connection->address, role);
+        return true;
+    }
+#endif
+
+    if (connection->gap_connection_tasks_pending != 0){
+#ifdef ENABLE_CLASSIC
+        if ((connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_WRITE_AUTOMATIC_FLUSH_TIMEOUT) != 0){
+            connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_WRITE_AUTOMATIC_FLUSH_TIMEOUT;
+            hci_send_cmd(&hci_write_automatic_flush_timeout, connection->con_handle, hci_stack->automatic_flush_timeout);
             return true;
         }
-
-        if (connection->request_role != HCI_ROLE_INVALID){
-            hci_role_t role = connection->request_role;
-            connection->request_role = HCI_ROLE_INVALID;
-            hci_send_cmd(&hci_switch_role_command, connection->address, role);
+        if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_WRITE_SUPERVISION_TIMEOUT){
+            connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_WRITE_SUPERVISION_TIMEOUT;
+            hci_send_cmd(&hci_write_link_supervision_timeout, connection->con_handle, hci_stack->link_supervision_timeout);
             return true;
         }
 #endif
-
-        if (connection->gap_connection_tasks_pending != 0){
-#ifdef ENABLE_CLASSIC
-            if ((connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_WRITE_AUTOMATIC_FLUSH_TIMEOUT) != 0){
-                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_WRITE_AUTOMATIC_FLUSH_TIMEOUT;
-                hci_send_cmd(&hci_write_automatic_flush_timeout, connection->con_handle, hci_stack->automatic_flush_timeout);
+        if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_READ_RSSI){
+            connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_READ_RSSI;
+            hci_send_cmd(&hci_read_rssi, connection->con_handle);
+            return true;
+        }
+#ifdef ENABLE_BLE
+        if ((connection->gap_connection_tasks_active & GAP_CONNECTION_TASK_LE_ANY) == 0){
+            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES){
+                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES;
+                connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES;
+                hci_stack->le_active_command_con_handle = connection->con_handle;
+                hci_send_cmd(&hci_le_read_remote_used_features, connection->con_handle);
                 return true;
             }
-            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_WRITE_SUPERVISION_TIMEOUT){
-                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_WRITE_SUPERVISION_TIMEOUT;
-                hci_send_cmd(&hci_write_link_supervision_timeout, connection->con_handle, hci_stack->link_supervision_timeout);
+            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_SET_PHY){
+                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_SET_PHY;
+                connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_SET_PHY;
+                hci_stack->le_active_command_con_handle = connection->con_handle;
+                hci_send_cmd(&hci_le_set_phy, connection->con_handle, connection->le_phy_update_all_phys,
+                    connection->le_phy_update_tx_phys, connection->le_phy_update_rx_phys, connection->le_phy_update_phy_options);
                 return true;
             }
-#endif
-            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_READ_RSSI){
-                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_READ_RSSI;
-                hci_send_cmd(&hci_read_rssi, connection->con_handle);
+#ifdef ENABLE_LE_SHORTER_CONNECTION_INTERVALS
+            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE){
+                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE;
+                connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE;
+                hci_stack->le_active_command_con_handle = connection->con_handle;
+                hci_send_cmd(&hci_le_frame_space_update, connection->con_handle,
+                             connection->le_frame_space_min_us, connection->le_frame_space_max_us,
+                             connection->le_frame_space_phys, connection->le_frame_space_spacing_types);
+                return true;
+            }
+            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST){
+                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST;
+                connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST;
+                hci_stack->le_active_command_con_handle = connection->con_handle;
+                hci_send_cmd(&hci_le_connection_rate_request, connection->con_handle,
+                             connection->le_connection_rate_interval_min_us, connection->le_connection_rate_interval_max_us,
+                             connection->le_connection_rate_subrate_min, connection->le_connection_rate_subrate_max,
+                             connection->le_connection_rate_max_latency, connection->le_connection_rate_continuation_number,
+                             connection->le_connection_rate_supervision_timeout, connection->le_connection_rate_min_ce_length,
+                             connection->le_connection_rate_max_ce_length);
                 return true;
             }
-#ifdef ENABLE_BLE
-            if ((connection->gap_connection_tasks_active & GAP_CONNECTION_TASK_LE_ANY) == 0){
-                if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES){
-                    connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES;
-                    connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_READ_REMOTE_FEATURES;
-                    hci_stack->le_active_command_con_handle = connection->con_handle;
-                    hci_send_cmd(&hci_le_read_remote_used_features, connection->con_handle);
-                    return true;
-                }
-                if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_SET_PHY){
-                    connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_SET_PHY;
-                    connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_SET_PHY;
-                    hci_stack->le_active_command_con_handle = connection->con_handle;
-                    hci_send_cmd(&hci_le_set_phy, connection->con_handle, connection->le_phy_update_all_phys,
-                        connection->le_phy_update_tx_phys, connection->le_phy_update_rx_phys, connection->le_phy_update_phy_options);
-                    return true;
-                }
-#ifdef ENABLE_LE_SHORTER_CONNECTION_INTERVALS
-                if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE){
-                    connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE;
-                    connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE;
-                    hci_stack->le_active_command_con_handle = connection->con_handle;
-                    hci_send_cmd(&hci_le_frame_space_update, connection->con_handle,
-                                 connection->le_frame_space_min_us, connection->le_frame_space_max_us,
-                                 connection->le_frame_space_phys, connection->le_frame_space_spacing_types);
-                    return true;
-                }
-                if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST){
-                    connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST;
-                    connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST;
-                    hci_stack->le_active_command_con_handle = connection->con_handle;
-                    hci_send_cmd(&hci_le_connection_rate_request, connection->con_handle,
-                                 connection->le_connection_rate_interval_min_us, connection->le_connection_rate_interval_max_us,
-                                 connection->le_connection_rate_subrate_min, connection->le_connection_rate_subrate_max,
-                                 connection->le_connection_rate_max_latency, connection->le_connection_rate_continuation_number,
-                                 connection->le_connection_rate_supervision_timeout, connection->le_connection_rate_min_ce_length,
-                                 connection->le_connection_rate_max_ce_length);
-                    return true;
-                }
 #ifdef ENABLE_LE_DATA_LENGTH_EXTENSION
-                if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH){
-                    connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH;
-                    connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH;
-                    hci_stack->le_active_command_con_handle = connection->con_handle;
-                    hci_send_cmd(&hci_le_set_data_length, connection->con_handle,
-                                 connection->le_set_data_length_tx_octets, connection->le_set_data_length_tx_time);
-                    return true;
-                }
-#endif
-#endif
+            if (connection->gap_connection_tasks_pending & GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH){
+                connection->gap_connection_tasks_pending &= ~GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH;
+                connection->gap_connection_tasks_active  |= GAP_CONNECTION_TASK_LE_SET_DATA_LENGTH;
+                hci_stack->le_active_command_con_handle = connection->con_handle;
+                hci_send_cmd(&hci_le_set_data_length, connection->con_handle,
+                             connection->le_set_data_length_tx_octets, connection->le_set_data_length_tx_time);
+                return true;
             }
+#endif
 #endif
         }
+#endif
+    }
 
 #ifdef ENABLE_BLE
-        switch (connection->le_con_parameter_update_state){
-            // response to L2CAP CON PARAMETER UPDATE REQUEST
-            case CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS:
-                connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_connection_update, connection->con_handle, connection->le_conn_interval_min,
-                             connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
-                             hci_stack->le_minimum_ce_length, hci_stack->le_maximum_ce_length);
-                return true;
-            case CON_PARAMETER_UPDATE_REPLY:
-                connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_remote_connection_parameter_request_reply, connection->con_handle, connection->le_conn_interval_min,
-                             connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
-                             hci_stack->le_minimum_ce_length, hci_stack->le_maximum_ce_length);
-                return true;
-            case CON_PARAMETER_UPDATE_NEGATIVE_REPLY:
-                connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_remote_connection_parameter_request_negative_reply, connection->con_handle,
-                             ERROR_CODE_UNACCEPTABLE_CONNECTION_PARAMETERS);
-                return true;
-            default:
-                break;
-        }
-        if (connection->le_subrate_min > 0){
-            uint16_t subrate_min = connection->le_subrate_min;
-            connection->le_subrate_min = 0;
-            hci_send_cmd(&hci_le_subrate_request, connection->con_handle, subrate_min, connection->le_subrate_max, connection->le_subrate_max_latency,
-                             connection->le_subrate_continuation_number, connection->le_supervision_timeout);
+    switch (connection->le_con_parameter_update_state){
+        // response to L2CAP CON PARAMETER UPDATE REQUEST
+        case CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS:
+            connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
+            hci_send_cmd(&hci_le_connection_update, connection->con_handle, connection->le_conn_interval_min,
+                         connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
+                         hci_stack->le_minimum_ce_length, hci_stack->le_maximum_ce_length);
             return true;
-        }
-#ifdef ENABLE_LE_PERIODIC_ADVERTISING
-        if (connection->le_past_sync_handle != HCI_CON_HANDLE_INVALID){
-            hci_con_handle_t sync_handle = connection->le_past_sync_handle;
-            connection->le_past_sync_handle = HCI_CON_HANDLE_INVALID;
-            hci_send_cmd(&hci_le_periodic_advertising_sync_transfer, connection->con_handle, connection->le_past_service_data, sync_handle);
+        case CON_PARAMETER_UPDATE_REPLY:
+            connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
+            hci_send_cmd(&hci_le_remote_connection_parameter_request_reply, connection->con_handle, connection->le_conn_interval_min,
+                         connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
+                         hci_stack->le_minimum_ce_length, hci_stack->le_maximum_ce_length);
             return true;
-        }
-        if (connection->le_past_advertising_handle != 0xff){
-            uint8_t advertising_handle = connection->le_past_advertising_handle;
-            connection->le_past_advertising_handle = 0xff;
-            hci_send_cmd(&hci_le_periodic_advertising_set_info_transfer, connection->con_handle, connection->le_past_service_data, advertising_handle);
+        case CON_PARAMETER_UPDATE_NEGATIVE_REPLY:
+            connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
+            hci_send_cmd(&hci_le_remote_connection_parameter_request_negative_reply, connection->con_handle,
+                         ERROR_CODE_UNACCEPTABLE_CONNECTION_PARAMETERS);
             return true;
-        }
+        default:
+            break;
+    }
+    if (connection->le_subrate_min > 0){
+        uint16_t subrate_min = connection->le_subrate_min;
+        connection->le_subrate_min = 0;
+        hci_send_cmd(&hci_le_subrate_request, connection->con_handle, subrate_min, connection->le_subrate_max, connection->le_subrate_max_latency,
+                         connection->le_subrate_continuation_number, connection->le_supervision_timeout);
+        return true;
+    }
+#ifdef ENABLE_LE_PERIODIC_ADVERTISING
+    if (connection->le_past_sync_handle != HCI_CON_HANDLE_INVALID){
+        hci_con_handle_t sync_handle = connection->le_past_sync_handle;
+        connection->le_past_sync_handle = HCI_CON_HANDLE_INVALID;
+        hci_send_cmd(&hci_le_periodic_advertising_sync_transfer, connection->con_handle, connection->le_past_service_data, sync_handle);
+        return true;
+    }
+    if (connection->le_past_advertising_handle != 0xff){
+        uint8_t advertising_handle = connection->le_past_advertising_handle;
+        connection->le_past_advertising_handle = 0xff;
+        hci_send_cmd(&hci_le_periodic_advertising_set_info_transfer, connection->con_handle, connection->le_past_service_data, advertising_handle);
+        return true;
+    }
 #endif
 #endif
+    return false;
+}
+
+static bool hci_run_general_pending_commands(void){
+    if (hci_stack->connections_run_all){
+        hci_stack->connections_run_all = false;
+        btstack_linked_item_t * it;
+        for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
+            hci_connection_trigger_run((hci_connection_t *) it);
+        }
+    }
+    // visit connections with pending work, connection stays queued as long as it sends commands
+    while (hci_stack->connections_run_head != NULL){
+        hci_connection_t * connection = hci_stack->connections_run_head;
+        hci_stack->connections_run_visits++;
+        if (hci_run_general_pending_commands_for_connection(connection)) return true;
+        hci_stack->connections_run_head = connection->run_next;
+        if (hci_stack->connections_run_head == NULL){
+            hci_stack->connections_run_tail = NULL;
+        }
+        connection->run_next = NULL;
+        connection->run_pending = false;
     }
     return false;
 }
 
+// check all connections for pending commands, used for events and API calls that might affect any connection
 static void hci_run(void){
+    hci_stack->connections_run_all = true;
+    hci_run_pending();
+}
+
+// check single connection for pending commands, used for events and API calls that only affect this connection
+static void hci_run_for_connection(hci_connection_t * connection){
+    hci_connection_trigger_run(connection);
+    hci_run_pending();
+}
+
+static void hci_run_pending(void){
 
     // stack state sub statemachines
     switch (hci_stack->state) {
@@ -8344,10 +8711,23 @@ static void hci_run(void){
     }
 #endif
 
-    if (!hci_can_send_command_packet_now()) return;
+    if (hci_can_send_command_packet_now()){
+        hci_run_commands();
+    }
 
-    // global/non-connection oriented commands
+#ifdef ENABLE_BLE
+    // pipeline LE list updates up to the number of HCI Command Packets allowed by the Controller
+    while (hci_can_send_pipelined_command_packet_now()){
+        done = hci_run_gap_le_list_updates(hci_stack->le_list_updates_pipelined);
+        if (!done) break;
+    }
+#endif
+}
+
+static void hci_run_commands(void){
+    bool done;
 
+    // global/non-connection oriented commands
 
 #ifdef ENABLE_CLASSIC
     // general gap classic
@@ -8383,6 +8763,24 @@ static void hci_set_sco_payload_length_for_flipped_packet_types(hci_connection_t
 }
 #endif
 
+// LE list updates only complete with HCI Command Complete and don't affect other commands
+static bool hci_command_can_be_pipelined(uint16_t opcode){
+    switch (opcode){
+#ifdef ENABLE_BLE
+        case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST:
+        case HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_WHITE_LIST:
+        case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_RESOLVING_LIST:
+        case HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_RESOLVING_LIST:
+        case HCI_OPCODE_HCI_LE_SET_PRIVACY_MODE:
+        case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_PERIODIC_ADVERTISER_LIST:
+        case HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_PERIODIC_ADVERTISER_LIST:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
 // funnel for sending cmd packet using single outgoing buffer
 static uint8_t hci_send_prepared_cmd_packet(void) {
     btstack_assert(hci_stack->hci_packet_buffer_reserved);
@@ -8610,7 +9008,18 @@ uint8_t hci_send_cmd_packet(uint8_t *packet, int size){
             break;
     }
 
-    hci_stack->num_cmd_packets--;
+    if (hci_command_can_be_pipelined(opcode)){
+        // further LE list updates can be sent before HCI Command Complete, see hci_run_pending
+        hci_stack->num_cmd_packets_pipelined++;
+        if (hci_stack->num_cmd_packets > 0u){
+            hci_stack->num_cmd_packets--;
+        }
+    } else {
+        hci_stack->num_cmd_packets--;
+    }
+    if (hci_stack->num_cmd_packets_controller > 0u){
+        hci_stack->num_cmd_packets_controller--;
+    }
 
     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet, size);
     int err = hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, packet, size);
@@ -8667,8 +9076,21 @@ bool gap_secure_connections_active(void){
 #endif
 
 // va_list part of hci_send_cmd
+static bool hci_can_send_command_now(uint16_t opcode){
+    if (hci_can_send_command_packet_now()) return true;
+#ifdef ENABLE_BLE
+    // LE list updates can be pipelined while only LE list updates are outstanding
+    if (hci_command_can_be_pipelined(opcode)){
+        return hci_can_send_pipelined_command_packet_now();
+    }
+#else
+    UNUSED(opcode);
+#endif
+    return false;
+}
+
 uint8_t hci_send_cmd_va_arg(const hci_cmd_t * cmd, va_list argptr){
-    if (!hci_can_send_command_packet_now()){ 
+    if (!hci_can_send_command_now(cmd->opcode)){
         log_error("hci_send_cmd called but cannot send packet now");
         return ERROR_CODE_COMMAND_DISALLOWED;
     }
@@ -9055,7 +9477,7 @@ void hci_remote_features_query(hci_con_handle_t con_handle){
     hci_connection_t * connection = hci_connection_for_handle(con_handle);
     if (!connection) return;
     hci_trigger_remote_features_for_connection(connection);
-    hci_run();
+    hci_run_for_connection(connection);
 }
 #endif
 
@@ -9221,7 +9643,7 @@ uint8_t hci_dedicated_bonding_defer_disconnect(hci_con_handle_t con_handle, bool
     } else {
         connection->bonding_flags &= ~BONDING_DEDICATED_DEFER_DISCONNECT;
         // trigger disconnect
-        hci_run();
+        hci_run_for_connection(connection);
     }
     return ERROR_CODE_SUCCESS;
 }
@@ -9272,6 +9694,19 @@ void gap_set_scan_parameters(uint8_t scan_type, uint16_t scan_interval, uint16_t
     gap_set_scan_params(scan_type, scan_interval, scan_window, 0);
 }
 
+void gap_advertising_report_filter_add(gap_advertising_report_filter_t * filter){
+    btstack_linked_list_add_tail(&hci_stack->le_advertising_report_filters, (btstack_linked_item_t *) filter);
+}
+
+void gap_advertising_report_filter_remove(gap_advertising_report_filter_t * filter){
+    btstack_linked_list_remove(&hci_stack->le_advertising_report_filters, (btstack_linked_item_t *) filter);
+}
+
+void gap_set_advertising_report_duplicate_window(uint16_t window_ms){
+    hci_stack->le_advertising_report_duplicate_window_ms = window_ms;
+    (void) memset(hci_stack->le_advertising_report_cache, 0, sizeof(hci_stack->le_advertising_report_cache));
+}
+
 void gap_set_scan_duplicate_filter(bool enabled){
     hci_stack->le_scan_filter_duplicates = enabled ? 1 : 0;
 }
@@ -9357,6 +9792,7 @@ uint8_t gap_connect_cancel(void){
                         // skip sending create connection and emit event instead
                         hci_emit_le_connection_complete(conn->address_type, conn->address, 0, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
                         btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+                        hci_connection_cancel_run(conn);
                         btstack_memory_hci_connection_free( conn );
                         break;
                     case SENT_CREATE_CONNECTION:
@@ -9425,7 +9861,7 @@ int gap_update_connection_parameters(hci_con_handle_t con_handle, uint16_t conn_
     connection->le_conn_latency = conn_latency;
     connection->le_supervision_timeout = supervision_timeout;
     connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS;
-    hci_run();
+    hci_run_for_connection(connection);
     return 0;
 }
 
@@ -9462,7 +9898,7 @@ uint8_t gap_request_connection_subrating(hci_con_handle_t con_handle, uint16_t s
     connection->le_subrate_max_latency = max_latency;
     connection->le_subrate_continuation_number = continuation_number;
     connection->le_supervision_timeout = supervision_timeout;
-    hci_run();
+    hci_run_for_connection(connection);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -9477,7 +9913,7 @@ uint8_t gap_request_frame_space_update(hci_con_handle_t con_handle, uint16_t fra
     connection->le_frame_space_phys = phys;
     connection->le_frame_space_spacing_types = spacing_types;
     connection->gap_connection_tasks_pending |= GAP_CONNECTION_TASK_LE_FRAME_SPACE_UPDATE;
-    hci_run();
+    hci_run_for_connection(connection);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -9499,7 +9935,7 @@ uint8_t gap_request_connection_rate_update(hci_con_handle_t con_handle, uint16_t
     connection->le_connection_rate_min_ce_length = min_ce_length;
     connection->le_connection_rate_max_ce_length = max_ce_length;
     connection->gap_connection_tasks_pending |= GAP_CONNECTION_TASK_LE_CONNECTION_RATE_REQUEST;
-    hci_run();
+    hci_run_for_connection(connection);
     return ERROR_CODE_SUCCESS;
 }
 #endif
@@ -9778,7 +10214,7 @@ uint8_t gap_periodic_advertising_sync_transfer_send(hci_con_handle_t con_handle,
     }
     hci_connection->le_past_sync_handle = sync_handle;
     hci_connection->le_past_service_data = service_data;
-    hci_run();
+    hci_run_for_connection(hci_connection);
     return ERROR_CODE_SUCCESS;
 }
 #endif
@@ -9790,7 +10226,7 @@ uint8_t gap_periodic_advertising_set_info_transfer_send(hci_con_handle_t con_han
     }
     hci_connection->le_past_advertising_handle = advertising_handle;
     hci_connection->le_past_service_data = service_data;
-    hci_run();
+    hci_run_for_connection(hci_connection);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -9849,7 +10285,7 @@ uint8_t gap_disconnect(hci_con_handle_t handle){
         default:
             // trigger hci_disconnect
             conn->state = SEND_DISCONNECT;
-            hci_run();
+            hci_run_for_connection(conn);
             break;
     }
     return status;
@@ -9859,7 +10295,7 @@ int gap_read_rssi(hci_con_handle_t con_handle){
     hci_connection_t * hci_connection = hci_connection_for_handle(con_handle);
     if (hci_connection == NULL) return 0;
     hci_connection->gap_connection_tasks_pending |= GAP_CONNECTION_TASK_READ_RSSI;
-    hci_run();
+    hci_run_for_connection(hci_connection);
     return 1;
 }
 
@@ -9898,7 +10334,7 @@ uint8_t gap_request_role(const bd_addr_t addr, hci_role_t role){
     hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_ACL);
     if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     conn->request_role = role;
-    hci_run();
+    hci_run_for_connection(conn);
     return ERROR_CODE_SUCCESS;
 }
 #endif
@@ -9915,7 +10351,7 @@ uint8_t gap_le_set_phy(hci_con_handle_t con_handle, uint8_t all_phys, uint8_t tx
     conn->le_phy_update_rx_phys     = rx_phys;
     conn->le_phy_update_phy_options = (uint8_t) phy_options;
 
-    hci_run();
+    hci_run_for_connection(conn);
 
     return 0;
 }
@@ -9929,7 +10365,7 @@ uint8_t gap_le_set_data_length(hci_con_handle_t con_handle, uint8_t tx_octets, u
     conn->le_set_data_length_tx_octets = tx_octets;
     conn->le_set_data_length_tx_time = tx_time;
 
-    hci_run();
+    hci_run_for_connection(conn);
 
     return 0;
 }
@@ -10340,7 +10776,7 @@ static uint8_t gap_set_auth_flag_and_run(const bd_addr_t addr, hci_authenticatio
     hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_ACL);
     if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     hci_connection_set_authentication_flags(conn, flag);
-    hci_run();
+    hci_run_for_connection(conn);
     return ERROR_CODE_SUCCESS;
 }
 #endif
@@ -10630,7 +11066,7 @@ uint8_t gap_sniff_mode_enter(hci_con_handle_t con_handle, uint16_t sniff_min_int
     conn->sniff_max_interval = sniff_max_interval;
     conn->sniff_attempt = sniff_attempt;
     conn->sniff_timeout = sniff_timeout;
-    hci_run();
+    hci_run_for_connection(conn);
     return 0;
 }
 
@@ -10643,7 +11079,7 @@ uint8_t gap_sniff_mode_exit(hci_con_handle_t con_handle){
     hci_connection_t * conn = hci_connection_for_handle(con_handle);
     if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     conn->sniff_min_interval = 0xffff;
-    hci_run();
+    hci_run_for_connection(conn);
     return 0;
 }
 
@@ -10653,7 +11089,7 @@ uint8_t gap_sniff_subrating_configure(hci_con_handle_t con_handle, uint16_t max_
     conn->sniff_subrating_max_latency = max_latency;
     conn->sniff_subrating_min_remote_timeout = min_remote_timeout;
     conn->sniff_subrating_min_local_timeout = min_local_timeout;
-    hci_run();
+    hci_run_for_connection(conn);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -10665,7 +11101,7 @@ uint8_t gap_qos_set(hci_con_handle_t con_handle, hci_service_type_t service_type
     conn->qos_peak_bandwidth = peak_bandwidth;
     conn->qos_latency = latency;
     conn->qos_delay_variation = delay_variation;
-    hci_run();
+    hci_run_for_connection(conn);
     return ERROR_CODE_SUCCESS;
 }
 
@@ -10691,16 +11127,143 @@ void gap_set_page_timeout(uint16_t page_timeout){
 #endif
 
 #ifdef ENABLE_LE_PRIVACY_ADDRESS_RESOLUTION
+static uint16_t hci_le_resolving_list_num_indices(void){
+    return (uint16_t) btstack_min(le_device_db_max_count(), MAX_NUM_RESOLVING_LIST_ENTRIES);
+}
+
+static uint16_t hci_le_resolving_list_capacity(void){
+    // size not known yet
+    if (hci_stack->le_resolving_list_size == 0u) return MAX_NUM_RESOLVING_LIST_ENTRIES;
+    // one entry is used for local IRK
+    return hci_stack->le_resolving_list_size - 1u;
+}
+
+// get identity address and IRK of bonded device, returns false if le_device_db entry is unused or without IRK
+static bool hci_le_resolving_list_get_identity(uint16_t index, int * address_type, bd_addr_t address, sm_key_t irk){
+    *address_type = (int) BD_ADDR_TYPE_UNKNOWN;
+    le_device_db_info(index, address_type, address, irk);
+    if (*address_type == (int) BD_ADDR_TYPE_UNKNOWN) return false;
+    return btstack_is_null(irk, 16) == false;
+}
+
+// Controller's resolving list was cleared
+static void hci_le_resolving_list_reset(void){
+    uint16_t i;
+    for (i = 0; i < MAX_NUM_RESOLVING_LIST_ENTRIES; i++){
+        hci_stack->le_resolving_list_entries[i].address_type = (uint8_t) BD_ADDR_TYPE_UNKNOWN;
+    }
+    hci_stack->le_resolving_list_count = 0;
+    (void) memset(hci_stack->le_resolving_list_add_entries, 0, sizeof(hci_stack->le_resolving_list_add_entries));
+    (void) memset(hci_stack->le_resolving_list_set_privacy_mode, 0, sizeof(hci_stack->le_resolving_list_set_privacy_mode));
+    (void) memset(hci_stack->le_resolving_list_remove_entries, 0, sizeof(hci_stack->le_resolving_list_remove_entries));
+}
+
+// returns true if entry a should rather be in the Controller's resolving list than entry b
+static bool hci_le_resolving_list_entry_preferred(uint16_t a, uint16_t b){
+    const le_resolving_list_entry_t * entry_a = &hci_stack->le_resolving_list_entries[a];
+    const le_resolving_list_entry_t * entry_b = &hci_stack->le_resolving_list_entries[b];
+    if (entry_a->last_used != entry_b->last_used){
+        return entry_a->last_used > entry_b->last_used;
+    }
+    // avoid churn: keep entries already in resolving list
+    bool a_in_list = entry_a->address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN;
+    bool b_in_list = entry_b->address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN;
+    if (a_in_list != b_in_list){
+        return a_in_list;
+    }
+    return a < b;
+}
+
+// compare shadow copy of Controller's resolving list with le_device_db and schedule minimal set of remove and add
+// operations. If there are more bonded devices than the Controller can store, the least recently used ones are left out.
+static void hci_le_resolving_list_sync(void){
+    uint8_t bonded[(MAX_NUM_RESOLVING_LIST_ENTRIES + 7) / 8];
+    uint16_t num_bonded = 0;
+    uint16_t num_indices = hci_le_resolving_list_num_indices();
+    uint16_t capacity = hci_le_resolving_list_capacity();
+    bool changes = false;
+    uint16_t i;
+
+    // remove stale entries
+    (void) memset(bonded, 0, sizeof(bonded));
+    for (i = 0; i < num_indices; i++){
+        uint8_t offset = i >> 3;
+        uint8_t mask = 1 << (i & 7);
+        bd_addr_t address;
+        int address_type;
+        sm_key_t irk;
+        bool is_bonded = hci_le_resolving_list_get_identity(i, &address_type, address, irk);
+        if (is_bonded){
+            bonded[offset] |= mask;
+            num_bonded++;
+        }
+        const le_resolving_list_entry_t * entry = &hci_stack->le_resolving_list_entries[i];
+        if (entry->address_type == (uint8_t) BD_ADDR_TYPE_UNKNOWN) continue;
+        if (is_bonded && (entry->address_type == (uint8_t) address_type) && (memcmp(entry->address, address, 6) == 0)) continue;
+        hci_stack->le_resolving_list_remove_entries[offset] |= mask;
+        changes = true;
+    }
+
+#ifdef ENABLE_LE_DEVICE_DB_LAST_USED
+    // order of use is only needed if not all bonded devices fit
+    if (num_bonded > capacity){
+        for (i = 0; i < num_indices; i++){
+            if ((bonded[i >> 3] & (1 << (i & 7))) == 0u) continue;
+            hci_stack->le_resolving_list_entries[i].last_used = le_device_db_last_used_get(i);
+        }
+    }
+#endif
+
+    // add missing entries and evict least recently used ones if resolving list is too small
+    for (i = 0; i < num_indices; i++){
+        uint8_t offset = i >> 3;
+        uint8_t mask = 1 << (i & 7);
+        bool in_list = (hci_stack->le_resolving_list_entries[i].address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN) &&
+                       ((hci_stack->le_resolving_list_remove_entries[offset] & mask) == 0u);
+        bool wanted = (bonded[offset] & mask) != 0u;
+        if (wanted && (num_bonded > capacity)){
+            uint16_t rank = 0;
+            uint16_t j;
+            for (j = 0; j < num_indices; j++){
+                if ((bonded[j >> 3] & (1 << (j & 7))) == 0u) continue;
+                if (hci_le_resolving_list_entry_preferred(j, i)) rank++;
+            }
+            wanted = rank < capacity;
+        }
+        if (wanted && (in_list == false)){
+            hci_stack->le_resolving_list_add_entries[offset] |= mask;
+            hci_stack->le_resolving_list_set_privacy_mode[offset] |= mask;
+            changes = true;
+        }
+        if (wanted == false){
+            hci_stack->le_resolving_list_add_entries[offset] &= ~mask;
+            if (in_list){
+                log_info("resolving list full, evict le_device_db index %u", i);
+                hci_stack->le_resolving_list_remove_entries[offset] |= mask;
+                changes = true;
+            }
+        }
+    }
+
+    if (changes && (hci_stack->le_resolving_list_state == LE_RESOLVING_LIST_DONE)){
+        hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_UPDATES_ENTRIES;
+    }
+}
+
 void hci_load_le_device_db_entry_into_resolving_list(uint16_t le_device_db_index){
     if (le_device_db_index >= MAX_NUM_RESOLVING_LIST_ENTRIES) return;
     if (le_device_db_index >= le_device_db_max_count()) return;
     uint8_t offset = le_device_db_index >> 3;
     uint8_t mask = 1 << (le_device_db_index & 7);
-    hci_stack->le_resolving_list_add_entries[offset] |= mask;
-    hci_stack->le_resolving_list_set_privacy_mode[offset] |= mask;
-    if (hci_stack->le_resolving_list_state == LE_RESOLVING_LIST_DONE){
-    	// note: go back to remove entries, otherwise, a remove + add will skip the add
-        hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_UPDATES_ENTRIES;
+    le_resolving_list_entry_t * entry = &hci_stack->le_resolving_list_entries[le_device_db_index];
+    entry->last_used = ++hci_stack->le_resolving_list_last_used;
+    if (entry->address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN){
+        // IRK might have changed, remove and add again
+        hci_stack->le_resolving_list_remove_entries[offset] |= mask;
+    }
+    // resolving list gets synced after clear otherwise
+    if (hci_stack->le_resolving_list_state >= LE_RESOLVING_LIST_UPDATES_ENTRIES){
+        hci_le_resolving_list_sync();
     }
 }
 
@@ -10709,19 +11272,33 @@ void hci_remove_le_device_db_entry_from_resolving_list(uint16_t le_device_db_ind
 	if (le_device_db_index >= le_device_db_max_count()) return;
 	uint8_t offset = le_device_db_index >> 3;
 	uint8_t mask = 1 << (le_device_db_index & 7);
+	hci_stack->le_resolving_list_add_entries[offset] &= ~mask;
+	if (hci_stack->le_resolving_list_entries[le_device_db_index].address_type == (uint8_t) BD_ADDR_TYPE_UNKNOWN) return;
 	hci_stack->le_resolving_list_remove_entries[offset] |= mask;
 	if (hci_stack->le_resolving_list_state == LE_RESOLVING_LIST_DONE){
 		hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_UPDATES_ENTRIES;
 	}
 }
 
+void hci_touch_le_device_db_entry_in_resolving_list(uint16_t le_device_db_index){
+    if (le_device_db_index >= MAX_NUM_RESOLVING_LIST_ENTRIES) return;
+    if (le_device_db_index >= le_device_db_max_count()) return;
+    le_resolving_list_entry_t * entry = &hci_stack->le_resolving_list_entries[le_device_db_index];
+    entry->last_used = ++hci_stack->le_resolving_list_last_used;
+    // entries in Controller's resolving list stay, evicted entries may replace the least recently used one
+    if (entry->address_type != (uint8_t) BD_ADDR_TYPE_UNKNOWN) return;
+    if (hci_stack->le_resolving_list_state >= LE_RESOLVING_LIST_UPDATES_ENTRIES){
+        hci_le_resolving_list_sync();
+    }
+}
+
 uint8_t gap_load_resolving_list_from_le_device_db(void){
     if (hci_command_supported(SUPPORTED_HCI_COMMAND_LE_SET_ADDRESS_RESOLUTION_ENABLE) == false){
 		return ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE;
 	}
-	if (hci_stack->le_resolving_list_state != LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION){
-		// restart le resolving list update
-		hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_READ_SIZE;
+	// sync with shadow copy unless Controller's resolving list gets cleared and loaded anyway
+	if (hci_stack->le_resolving_list_state >= LE_RESOLVING_LIST_UPDATES_ENTRIES){
+		hci_le_resolving_list_sync();
 	}
 	return ERROR_CODE_SUCCESS;
 }
@@ -11719,6 +12296,7 @@ void hci_setup_test_connections_fuzz(void){
 
     // setup Controller info
     hci_stack->num_cmd_packets = 255;
+    hci_stack->num_cmd_packets_controller = 255;
     hci_stack->acl_packets_total_num = 255;
 
     // setup incoming Classic ACL connection with con handle 0x0001, 66:55:44:33:22:01
@@ -11765,6 +12343,7 @@ void hci_free_connections_fuzz(void){
         hci_connection_t * con = (hci_connection_t*) btstack_linked_list_iterator_next(&it); // LCOV_EXCL_LINE
         hci_connection_stop_timer(con);                                                      // LCOV_EXCL_LINE
         btstack_linked_list_iterator_remove(&it);                                            // LCOV_EXCL_LINE
+        hci_connection_cancel_run(con);                                                      // LCOV_EXCL_LINE
         btstack_memory_hci_connection_free(con);                                             // LCOV_EXCL_LINE
     }                                                                                        // LCOV_EXCL_LINE
 }                                                                                            // LCOV_EXCL_LINE
@@ -11773,6 +12352,11 @@ void hci_simulate_working_fuzz(void){
     hci_stack->le_scanning_param_update = false;
     hci_init_done();
     hci_stack->num_cmd_packets = 255;
+    hci_stack->num_cmd_packets_controller = 255;
+}
+
+uint32_t hci_get_connection_visits_fuzz(void){
+    return hci_stack->connections_run_visits;
 }
 
 // get hci struct
@@ -168,6 +168,22 @@ extern "C" {
 #endif
 #endif
 
+// max number of LE list update commands (Filter Accept List, Resolving List, Periodic Advertiser List) sent without
+// waiting for the HCI Command Complete Event, also limited by Num_HCI_Command_Packets of the Controller
+#ifndef HCI_MAX_PIPELINED_COMMANDS
+#define HCI_MAX_PIPELINED_COMMANDS 4
+#endif
+
+// number of advertisers tracked for duplicate suppression of LE Advertising Reports, see gap_set_advertising_report_duplicate_window
+#ifndef HCI_LE_ADVERTISING_REPORT_DUPLICATE_CACHE_SIZE
+#define HCI_LE_ADVERTISING_REPORT_DUPLICATE_CACHE_SIZE 16
+#endif
+
+// number of advertisers with chained Extended Advertising Reports tracked by LE Advertising Report filters
+#ifndef HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE
+#define HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE 4
+#endif
+
 // 
 #define IS_COMMAND(packet, command) ( little_endian_read_16(packet,0) == command.opcode )
 
@@ -501,6 +517,17 @@ typedef struct sm_connection {
 #define ATT_REQUEST_BUFFER_SIZE HCI_ACL_PAYLOAD_SIZE
 #endif
 
+// one request context per HCI connection by default, EATT bearers use request contexts from att_server_eatt_init storage
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_ATT_SERVER_REQUESTS) && defined(MAX_NR_HCI_CONNECTIONS)
+#define MAX_NR_ATT_SERVER_REQUESTS MAX_NR_HCI_CONNECTIONS
+#endif
+
+// ATT request context, allocated from pool while request is processed
+typedef struct {
+    uint16_t                size;
+    uint8_t                 buffer[ATT_REQUEST_BUFFER_SIZE];
+} att_server_request_t;
+
 typedef enum {
     ATT_SERVER_IDLE,
     ATT_SERVER_REQUEST_RECEIVED,
@@ -526,6 +553,14 @@ typedef struct {
 
     btstack_linked_list_t   notification_requests;
     btstack_linked_list_t   indication_requests;
+    btstack_linked_list_t   notification_streams;
+
+    // Service Changed indication for pending handle range, client is change-unaware until confirmed
+    btstack_context_callback_registration_t service_changed_request;
+    uint16_t                service_changed_start_handle;
+    uint16_t                service_changed_end_handle;
+    bool                    service_changed_indications_enabled;
+    bool                    change_unaware;
 
 #if defined(ENABLE_GATT_OVER_CLASSIC) || defined(ENABLE_GATT_OVER_EATT)
     // unified (client + server) att bearer
@@ -536,8 +571,14 @@ typedef struct {
     bool                    eatt_outgoing_active;
 #endif
 
-    uint16_t                request_size;
-    uint8_t                 request_buffer[ATT_REQUEST_BUFFER_SIZE];
+    // current request, NULL if idle or if no request context was available
+    att_server_request_t *  request;
+    uint8_t                 request_opcode;
+
+#ifdef ENABLE_GATT_OVER_EATT
+    // request context provided by EATT bearer, NULL: use request context from pool
+    att_server_request_t *  bearer_request;
+#endif
 
 } att_server_t;
 
@@ -556,10 +597,11 @@ typedef struct {
     l2cap_information_state_t information_state;
     uint16_t                  extended_feature_mask;
     uint16_t                  fixed_channels_supported;    // Core V5.3 - only first octet used
+    uint8_t                   send_deficit;                // outgoing scheduler: round-robin across connections
 } l2cap_state_t;
 
 //
-typedef struct {
+typedef struct hci_connection {
     // linked list - assert: first field
     btstack_linked_item_t    item;
     
@@ -761,6 +803,10 @@ typedef struct {
     const uint8_t * classic_oob_r_256;
 #endif
 
+    // pending work queue for hci_run
+    struct hci_connection * run_next;
+    bool run_pending;
+
 } hci_connection_t;
 
 typedef enum {
@@ -1071,7 +1117,36 @@ typedef struct {
     uint8_t        state;
 } periodic_advertiser_list_entry_t;
 
+// last advertising data received from an advertiser
+typedef struct {
+    bd_addr_t address;
+    uint8_t   address_type;
+    // hash over event type and advertising data
+    uint32_t  data_hash;
+    uint32_t  time_ms;
+} le_advertising_report_cache_entry_t;
+
+// advertiser with chained Extended Advertising Report in progress, address in little-endian order
+typedef struct {
+    uint8_t   address[6];
+    uint8_t   address_type;
+    uint8_t   sid;
+    bool      active;
+    // filter result of first fragment, used for all fragments of the chain
+    bool      accepted;
+} le_advertising_report_chain_t;
+
 #define MAX_NUM_RESOLVING_LIST_ENTRIES 64
+
+// shadow copy of Controller's resolving list entry for a le_device_db index
+typedef struct {
+    bd_addr_t address;
+    // BD_ADDR_TYPE_UNKNOWN if not in Controller's resolving list
+    uint8_t   address_type;
+    // order of use for LRU eviction, from le_device_db_last_used_get with ENABLE_LE_DEVICE_DB_LAST_USED
+    uint32_t  last_used;
+} le_resolving_list_entry_t;
+
 typedef enum {
     LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION,
     LE_RESOLVING_LIST_READ_SIZE,
@@ -1109,6 +1184,12 @@ typedef struct {
     // list of existing baseband connections
     btstack_linked_list_t     connections;
 
+    // connections with pending commands, checked by hci_run
+    hci_connection_t *        connections_run_head;
+    hci_connection_t *        connections_run_tail;
+    bool                      connections_run_all;
+    uint32_t                  connections_run_visits;
+
     /* callback to L2CAP layer */
     btstack_packet_handler_t acl_packet_handler;
 
@@ -1208,6 +1289,10 @@ typedef struct {
      
     /* host to controller flow control */
     uint8_t  num_cmd_packets;
+    // Num_HCI_Command_Packets reported by Controller minus commands sent since
+    uint8_t  num_cmd_packets_controller;
+    // LE list update commands sent without HCI Command Complete yet
+    uint8_t  num_cmd_packets_pipelined;
     uint8_t  acl_packets_total_num;
     uint16_t acl_data_packet_length;
     uint8_t  sco_packets_total_num;
@@ -1301,6 +1386,9 @@ typedef struct {
     uint8_t               le_whitelist_capacity;
     btstack_linked_list_t le_whitelist;
 
+    // LE lists (HCI_LE_LIST_x) that can be updated by pipelined commands, see hci_run_pending
+    uint8_t               le_list_updates_pipelined;
+
     // Connection parameters
     uint16_t le_connection_scan_interval;
     uint16_t le_connection_scan_window;
@@ -1341,6 +1429,17 @@ typedef struct {
     uint8_t  le_connection_phys;
     bd_addr_t le_connection_own_address;
 
+    // LE Advertising Report filters and duplicate suppression
+    btstack_linked_list_t le_advertising_report_filters;
+    uint16_t              le_advertising_report_duplicate_window_ms;
+    le_advertising_report_cache_entry_t le_advertising_report_cache[HCI_LE_ADVERTISING_REPORT_DUPLICATE_CACHE_SIZE];
+#ifdef ENABLE_LE_EXTENDED_ADVERTISING
+    le_advertising_report_chain_t le_advertising_report_chains[HCI_LE_ADVERTISING_REPORT_CHAIN_CACHE_SIZE];
+    uint8_t               le_advertising_report_chain_next;
+#endif
+    // all reports of current HCI Event were dropped, don't forward HCI Event
+    bool                  le_advertising_reports_dropped;
+
 #ifdef ENABLE_LE_EXTENDED_ADVERTISING
     btstack_linked_list_t le_periodic_advertiser_list;
     uint16_t        le_periodic_terminate_sync_handle;
@@ -1429,6 +1528,11 @@ typedef struct {
     uint8_t                   le_resolving_list_add_entries[(MAX_NUM_RESOLVING_LIST_ENTRIES + 7) / 8];
     uint8_t                   le_resolving_list_set_privacy_mode[(MAX_NUM_RESOLVING_LIST_ENTRIES + 7) / 8];
 	uint8_t                   le_resolving_list_remove_entries[(MAX_NUM_RESOLVING_LIST_ENTRIES + 7) / 8];
+    le_resolving_list_entry_t le_resolving_list_entries[MAX_NUM_RESOLVING_LIST_ENTRIES];
+    // number of entries in Controller's resolving list, without local IRK
+    uint16_t                  le_resolving_list_count;
+    // order of use since power on, if not provided by le_device_db
+    uint32_t                  le_resolving_list_last_used;
 #endif
 
 #ifdef ENABLE_CLASSIC_PAIRING_OOB
@@ -1761,6 +1865,11 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle);
  */
 hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t addr, bd_addr_type_t addr_type);
 
+/**
+ * Queue hci_connection_t for pending command check in next hci_run. Used by L2CAP after changing connection state
+ */
+void hci_connection_trigger_run(hci_connection_t * connection);
+
 /**
  * Check if outgoing packet buffer is reserved. Used for internal checks in l2cap.c
  * @return true if packet buffer is reserved
@@ -1928,6 +2037,11 @@ void hci_load_le_device_db_entry_into_resolving_list(uint16_t le_device_db_index
  */
 void hci_remove_le_device_db_entry_from_resolving_list(uint16_t le_device_db_index);
 
+/**
+ * @note internal use by sm, after bonded device was identified
+ */
+void hci_touch_le_device_db_entry_in_resolving_list(uint16_t le_device_db_index);
+
 /**
  * @note internal use
  */
@@ -2038,6 +2152,9 @@ void hci_free_connections_fuzz(void);
 // simulate stack bootup
 void hci_simulate_working_fuzz(void);
 
+// number of connection visits in hci_run, used for testing
+uint32_t hci_get_connection_visits_fuzz(void);
+
 // get hci struct
 hci_stack_t * hci_get_stack();
 
@@ -123,10 +123,35 @@ typedef enum {
 // used to cache l2cap rejects, echo, and informational requests
 #define NR_PENDING_SIGNALING_RESPONSES 3
 
-// nr of credits provided to remote if credits fall below watermark
+// ERTM: max tx window with Enhanced Control Field, larger windows require the Extended Window Size option
+#define L2CAP_ERTM_MAX_TX_WINDOW_SIZE          63
+#define L2CAP_ERTM_MAX_EXTENDED_TX_WINDOW_SIZE 0x3fff
+
+// automatic credits: min nr of credits provided to remote if credits fall below watermark
 #define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_WATERMARK 5
 #define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INCREMENT 5
 
+// automatic credits: max nr of outstanding credits provided after initial credits, limits data buffered in Controller
+#ifndef L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_MAX
+#define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_MAX 64
+#endif
+
+// automatic credits: nr of initial credits. The adaptive window only applies once the remote has used up the initial
+// credits, which practically does not happen with the default of 0xffff. Define as
+// L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_MAX to enable it and to limit data buffered in Controller
+#ifndef L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL
+#define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL 0xffff
+#endif
+
+// automatic credits: window covers consumption during this nr of connection intervals
+#define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INTERVALS 4
+
+// automatic credits: measurement period for incoming PDU rate
+#define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_RATE_PERIOD_MS 250
+
+// automatic credits: connection interval used for Classic ACL
+#define L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_CLASSIC_INTERVAL_MS 10
+
 // offsets for L2CAP SIGNALING COMMANDS
 #define L2CAP_SIGNALING_COMMAND_CODE_OFFSET   0
 #define L2CAP_SIGNALING_COMMAND_SIGID_OFFSET  1
@@ -158,6 +183,10 @@ static void l2cap_run(void);
 static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
 static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size );
 static void l2cap_notify_channel_can_send(void);
+static void l2cap_channel_mark_send_request(l2cap_channel_t * channel);
+static void l2cap_send_queue_add(l2cap_channel_t * channel);
+static void l2cap_send_queue_remove(l2cap_channel_t * channel);
+static void l2cap_send_queue_move_to_tail(l2cap_channel_t * channel);
 static void l2cap_emit_can_send_now(btstack_packet_handler_t packet_handler, uint16_t channel);
 static uint8_t  l2cap_next_sig_id(void);
 static l2cap_fixed_channel_t * l2cap_fixed_channel_for_channel_id(uint16_t local_cid);
@@ -187,16 +216,22 @@ static void l2cap_credit_based_send_pdu(l2cap_channel_t *channel);
 static void l2cap_credit_based_send_credits(l2cap_channel_t *channel);
 static bool l2cap_credit_based_handle_credit_indication(hci_con_handle_t handle, const uint8_t * command, uint16_t len);
 static void l2cap_credit_based_handle_pdu(l2cap_channel_t * l2cap_channel, const uint8_t * packet, uint16_t size);
+static uint16_t l2cap_credit_based_initial_credits(l2cap_channel_t * channel, uint16_t initial_credits);
 #endif
 #ifdef L2CAP_USES_CHANNELS
 static uint16_t l2cap_next_local_cid(void);
 static l2cap_channel_t * l2cap_get_channel_for_local_cid(uint16_t local_cid);
 static void l2cap_emit_simple_event_with_cid(l2cap_channel_t * channel, uint8_t event_code);
 static void l2cap_dispatch_to_channel(l2cap_channel_t *channel, uint8_t type, uint8_t * data, uint16_t size);
+static uint8_t * l2cap_receive_buffer_for_sdu(l2cap_channel_t * channel, uint16_t sdu_len, uint8_t * default_buffer);
+static void l2cap_receive_buffer_release(l2cap_channel_t * channel, const uint8_t * default_buffer);
 static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t packet_handler, l2cap_channel_type_t channel_type, bd_addr_t address, bd_addr_type_t address_type,
         uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level);
 static void l2cap_finalize_channel_close(l2cap_channel_t *channel);
 static void l2cap_free_channel_entry(l2cap_channel_t * channel);
+static void l2cap_trigger_run_for_channel(l2cap_channel_t * channel);
+static void l2cap_trigger_run_for_all_channels(void);
+static void l2cap_cancel_run_for_channel(l2cap_channel_t * channel);
 #endif
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 static void l2cap_ertm_notify_channel_can_send(l2cap_channel_t * channel);
@@ -252,6 +287,32 @@ static btstack_packet_callback_registration_t l2cap_hci_event_callback_registrat
 
 static bool l2cap_call_notify_channel_in_run;
 
+// outgoing scheduler, NULL for default scheduler
+static const l2cap_scheduler_t * l2cap_scheduler;
+
+// channels with pending send requests, only these are passed to the scheduler
+static l2cap_channel_t * l2cap_send_queue_head;
+static l2cap_channel_t * l2cap_send_queue_tail;
+
+// l2cap_run is not re-entrant, nested calls are executed after the current run
+static bool l2cap_run_active;
+static bool l2cap_run_requested;
+
+#ifdef L2CAP_USES_CHANNELS
+// FIFO of channels linked via l2cap_channel_t.run_next
+typedef struct {
+    l2cap_channel_t * head;
+    l2cap_channel_t * tail;
+} l2cap_channel_queue_t;
+
+// only channels with outstanding work are visited by l2cap_run
+static l2cap_channel_queue_t l2cap_channels_pending;
+static l2cap_channel_queue_t l2cap_channels_blocked;
+static l2cap_channel_t *     l2cap_channel_active;
+static bool                  l2cap_channels_trigger_all;
+static uint32_t              l2cap_channel_visits;
+#endif
+
 #ifdef ENABLE_BLE
 // only used for connection parameter update events
 static uint16_t l2cap_le_custom_max_mtu;
@@ -303,31 +364,81 @@ static inline uint16_t l2cap_encanced_control_field_for_supevisor_frame(l2cap_su
     return (req_seq << 8) | (final << 7) | (poll << 4) | (((int) supervisory_function) << 2) | 1; 
 }
 
-static int l2cap_next_ertm_seq_nr(int seq_nr){
-    return (seq_nr + 1) & 0x3f;
+static inline uint32_t l2cap_extended_control_field_for_information_frame(uint16_t tx_seq, int final, uint16_t req_seq, l2cap_segmentation_and_reassembly_t sar){
+    return (((uint32_t) tx_seq) << 18) | (((uint32_t) sar) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 0;
+}
+
+static inline uint32_t l2cap_extended_control_field_for_supervisor_frame(l2cap_supervisory_function_t supervisory_function, int poll, int final, uint16_t req_seq){
+    return (((uint32_t) poll) << 18) | (((uint32_t) supervisory_function) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 1;
+}
+
+static uint32_t l2cap_ertm_control_field_for_information_frame(const l2cap_channel_t * channel, uint16_t tx_seq, int final, uint16_t req_seq, l2cap_segmentation_and_reassembly_t sar){
+    if (channel->extended_control){
+        return l2cap_extended_control_field_for_information_frame(tx_seq, final, req_seq, sar);
+    }
+    return l2cap_encanced_control_field_for_information_frame((uint8_t) tx_seq, final, (uint8_t) req_seq, sar);
+}
+
+static uint32_t l2cap_ertm_control_field_for_supervisor_frame(const l2cap_channel_t * channel, l2cap_supervisory_function_t supervisory_function, int poll, int final, uint16_t req_seq){
+    if (channel->extended_control){
+        return l2cap_extended_control_field_for_supervisor_frame(supervisory_function, poll, final, req_seq);
+    }
+    return l2cap_encanced_control_field_for_supevisor_frame(supervisory_function, poll, final, (uint8_t) req_seq);
+}
+
+static uint16_t l2cap_ertm_control_field_size(const l2cap_channel_t * channel){
+    return channel->extended_control ? 4 : 2;
+}
+
+static void l2cap_ertm_store_control_field(const l2cap_channel_t * channel, uint8_t * acl_buffer, uint32_t control){
+    if (channel->extended_control){
+        little_endian_store_32(acl_buffer, 8, control);
+    } else {
+        little_endian_store_16(acl_buffer, 8, (uint16_t) control);
+    }
+}
+
+// 6-bit sequence numbers with Enhanced Control Field, 14-bit with Extended Control Field
+static uint16_t l2cap_ertm_seq_nr_mask(const l2cap_channel_t * channel){
+    return channel->extended_control ? 0x3fff : 0x3f;
+}
+
+// receiver: frames with delta to ExpectedTxSeq less than this can be stored. To tell them apart from duplicates,
+// at most half of the sequence number space is used
+static uint16_t l2cap_ertm_rx_window_size(const l2cap_channel_t * l2cap_channel){
+    return btstack_min(l2cap_channel->num_rx_buffers, (l2cap_ertm_seq_nr_mask(l2cap_channel) + 1u) / 2u);
+}
+
+static uint16_t l2cap_next_ertm_seq_nr(const l2cap_channel_t * channel, uint16_t seq_nr){
+    return (seq_nr + 1) & l2cap_ertm_seq_nr_mask(channel);
 }
 
 static bool l2cap_ertm_can_store_packet_now(l2cap_channel_t * channel){
     // get num free tx buffers
     int num_free_tx_buffers = channel->num_tx_buffers - channel->num_stored_tx_frames;
-    // calculate num tx buffers for remote MTU
+    // calculate num tx buffers and ring buffer space for remote MTU
     int num_tx_buffers_for_max_remote_mtu;
+    uint32_t num_bytes_for_max_remote_mtu;
     uint16_t effective_mps = btstack_min(channel->remote_mps, channel->local_mps);
     if (channel->remote_mtu <= effective_mps){
         // MTU fits into single packet
         num_tx_buffers_for_max_remote_mtu = 1;
+        num_bytes_for_max_remote_mtu = channel->remote_mtu;
     } else {
         // include SDU Length
         num_tx_buffers_for_max_remote_mtu = (channel->remote_mtu + 2 + (effective_mps - 1)) / effective_mps;
+        num_bytes_for_max_remote_mtu = channel->remote_mtu + 2u;
     }
-    log_debug("num_free_tx_buffers %u, num_tx_buffers_for_max_remote_mtu %u", num_free_tx_buffers, num_tx_buffers_for_max_remote_mtu);
+    uint32_t num_free_bytes = channel->tx_ring_size - channel->tx_ring_used;
+    log_debug("num_free_tx_buffers %u, num_tx_buffers_for_max_remote_mtu %u, num_free_bytes %u", num_free_tx_buffers, num_tx_buffers_for_max_remote_mtu, (int) num_free_bytes);
+    if (num_bytes_for_max_remote_mtu > num_free_bytes) return false;
     return num_tx_buffers_for_max_remote_mtu <= num_free_tx_buffers;
 }
 
 static void l2cap_ertm_retransmit_unacknowledged_frames(l2cap_channel_t * l2cap_channel){
-    uint8_t tx_index = l2cap_channel->tx_read_index;
+    uint16_t tx_index = l2cap_channel->tx_read_index;
     l2cap_channel->tx_send_index = tx_index;
-    for (uint8_t unacked_frames = l2cap_channel->unacked_frames; unacked_frames > 0 ; unacked_frames--){
+    for (uint16_t unacked_frames = l2cap_channel->unacked_frames; unacked_frames > 0 ; unacked_frames--){
         l2cap_ertm_tx_packet_state_t * tx_packet_state = &l2cap_channel->tx_packets_state[tx_index];
         tx_packet_state->tx_state = L2CAP_ERTM_TX_STATE_RETRANSMISSION_REQUESTED;
         log_info("Retransmit tx seq %u", tx_packet_state->tx_seq);
@@ -397,6 +508,7 @@ static void l2cap_ertm_monitor_timeout_callback(btstack_timer_source_t * ts){
         log_info("Monitor timer expired & retry count >= max transmit -> disconnect");
         l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
     }
+    l2cap_trigger_run_for_channel(l2cap_channel);
     l2cap_run();
 }
 
@@ -422,28 +534,50 @@ static void l2cap_ertm_retransmission_timeout_callback(btstack_timer_source_t *
 
     // send RR/P=1
     l2cap_channel->send_supervisor_frame_receiver_ready_poll = 1;
+    l2cap_trigger_run_for_channel(l2cap_channel);
     l2cap_run();
 }
 
+// copy data from tx ring buffer, data might wrap around
+static void l2cap_ertm_tx_ring_read(const l2cap_channel_t * channel, uint32_t offset, uint8_t * data, uint16_t len){
+    uint32_t bytes_till_end = channel->tx_ring_size - offset;
+    uint16_t len_first = (uint16_t) btstack_min(len, bytes_till_end);
+    (void)memcpy(data, &channel->tx_packets_data[offset], len_first);
+    (void)memcpy(&data[len_first], &channel->tx_packets_data[0], len - len_first);
+}
+
+// append data to tx ring buffer, data might wrap around
+static void l2cap_ertm_tx_ring_write(l2cap_channel_t * channel, const uint8_t * data, uint16_t len){
+    uint32_t bytes_till_end = channel->tx_ring_size - channel->tx_ring_write_pos;
+    uint16_t len_first = (uint16_t) btstack_min(len, bytes_till_end);
+    (void)memcpy(&channel->tx_packets_data[channel->tx_ring_write_pos], data, len_first);
+    (void)memcpy(&channel->tx_packets_data[0], &data[len_first], len - len_first);
+    channel->tx_ring_write_pos += len;
+    if (channel->tx_ring_write_pos >= channel->tx_ring_size){
+        channel->tx_ring_write_pos -= channel->tx_ring_size;
+    }
+    channel->tx_ring_used += len;
+}
+
 static int l2cap_ertm_send_information_frame(l2cap_channel_t * channel, int index, int final){
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
 
     l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
-    uint16_t control = l2cap_encanced_control_field_for_information_frame(tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
-    log_info("I-Frame: control 0x%04x", control);
-    little_endian_store_16(acl_buffer, 8, control);
-    (void)memcpy(&acl_buffer[8 + 2],
-                 &channel->tx_packets_data[index * channel->remote_mps],
-                 tx_state->len);
+    uint32_t control = l2cap_ertm_control_field_for_information_frame(channel, tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
+    log_info("I-Frame: control 0x%04x", (int) control);
+    l2cap_ertm_store_control_field(channel, acl_buffer, control);
+    uint16_t control_size = l2cap_ertm_control_field_size(channel);
+    l2cap_ertm_tx_ring_read(channel, tx_state->offset, &acl_buffer[8 + control_size], tx_state->len);
     // (re-)start retransmission timer on 
     l2cap_ertm_start_retransmission_timer(channel);
     // send
     tx_state->tx_state = L2CAP_ERTM_TX_STATE_SENT;
-    return l2cap_send_prepared(channel->local_cid, 2 + tx_state->len);
+    return l2cap_send_prepared(channel->local_cid, control_size + tx_state->len);
 }
 
-static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentation_and_reassembly_t sar, uint16_t sdu_length, const uint8_t * data, uint16_t len){
+// fragments refer to the SDU stored in the tx ring buffer, the start fragment includes the SDU Length field
+static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentation_and_reassembly_t sar, uint32_t offset, uint16_t len){
     // get next index for storing packets
     int index = channel->tx_write_index;
 
@@ -452,20 +586,13 @@ static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentat
     tx_state->sar = sar;
     tx_state->retry_count = 0;
     tx_state->tx_state = L2CAP_ERTM_TX_STATE_NEW;
-
-    uint8_t * tx_packet = &channel->tx_packets_data[index * channel->remote_mps];
-    log_debug("index %u, local mps %u, remote mps %u, packet tx %p, len %u", index, channel->local_mps, channel->remote_mps, tx_packet, len);
-    int pos = 0;
-    if (sar == L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU){
-        little_endian_store_16(tx_packet, 0, sdu_length);
-        pos += 2;
-    }
-    (void)memcpy(&tx_packet[pos], data, len);
-    tx_state->len = pos + len;
+    tx_state->offset = offset;
+    tx_state->len = len;
+    log_debug("index %u, local mps %u, remote mps %u, offset %u, len %u", index, channel->local_mps, channel->remote_mps, (int) offset, len);
 
     // update
     channel->num_stored_tx_frames++;
-    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel->next_tx_seq);
+    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel, channel->next_tx_seq);
     l2cap_ertm_next_tx_write_index(channel);
 
     log_info("l2cap_ertm_store_fragment: tx_read_index %u, tx_write_index %u, num stored %u", channel->tx_read_index, channel->tx_write_index, channel->num_stored_tx_frames);
@@ -483,50 +610,81 @@ static uint8_t l2cap_ertm_send(l2cap_channel_t * channel, const uint8_t * data,
         return BTSTACK_ACL_BUFFERS_FULL;
     }
 
+    // store SDU in ring buffer once, fragments refer to it
+    uint32_t offset = channel->tx_ring_write_pos;
+
     // check if it needs to get fragmented
     uint16_t effective_mps = btstack_min(channel->remote_mps, channel->local_mps);
     if (len > effective_mps){
-        // fragmentation needed.
+        // fragmentation needed. prefix SDU with SDU Length
+        uint8_t sdu_length[2];
+        little_endian_store_16(sdu_length, 0, len);
+        l2cap_ertm_tx_ring_write(channel, sdu_length, 2);
+        l2cap_ertm_tx_ring_write(channel, data, len);
         l2cap_segmentation_and_reassembly_t sar =  L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU;
         uint16_t chunk_len = 0;
-        while (len){
+        uint16_t remaining = len + 2;
+        while (remaining){
             switch (sar){
                 case L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU:
-                    chunk_len = effective_mps - 2;    // sdu_length
-                    l2cap_ertm_store_fragment(channel, sar, len, data, chunk_len);
+                    chunk_len = effective_mps;    // incl. sdu_length
+                    l2cap_ertm_store_fragment(channel, sar, offset, chunk_len);
                     sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU;
                     break;
                 case L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU:
                     chunk_len = effective_mps;
-                    if (chunk_len >= len){
+                    if (chunk_len >= remaining){
                         sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU; 
-                        chunk_len = len;                       
+                        chunk_len = remaining;
                     }
-                    l2cap_ertm_store_fragment(channel, sar, len, data, chunk_len);
+                    l2cap_ertm_store_fragment(channel, sar, offset, chunk_len);
                     break;
                 default:
                     btstack_unreachable();
                     break;
             }
-            len  -= chunk_len;
-            data += chunk_len;
+            remaining -= chunk_len;
+            offset    += chunk_len;
+            if (offset >= channel->tx_ring_size){
+                offset -= channel->tx_ring_size;
+            }
         }
 
     } else {
-        l2cap_ertm_store_fragment(channel, L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU, 0, data, len);
+        l2cap_ertm_tx_ring_write(channel, data, len);
+        l2cap_ertm_store_fragment(channel, L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU, offset, len);
     }
 
     // try to send
+    l2cap_send_queue_add(channel);
     l2cap_notify_channel_can_send();
     return ERROR_CODE_SUCCESS;
 }
 
+static bool l2cap_ertm_extended_window_size_supported(l2cap_channel_t * channel){
+    hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+    if (connection == NULL) return false;
+    // Extended Window Size feature bit
+    return (connection->l2cap_state.extended_feature_mask & 0x0100) != 0;
+}
+
 static uint16_t l2cap_setup_options_ertm_request(l2cap_channel_t * channel, uint8_t * config_options){
+    // tx windows > 63 require Extended Window Size option, otherwise out-of-order frames beyond are not used
+    if (channel->num_rx_buffers > L2CAP_ERTM_MAX_TX_WINDOW_SIZE){
+        if (l2cap_ertm_extended_window_size_supported(channel)){
+            channel->extended_control = true;
+        } else {
+            log_info("Extended Window Size not supported by remote, limit tx window to %u", L2CAP_ERTM_MAX_TX_WINDOW_SIZE);
+            channel->num_rx_buffers = L2CAP_ERTM_MAX_TX_WINDOW_SIZE;
+        }
+    }
     int pos = 0;
     config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_RETRANSMISSION_AND_FLOW_CONTROL;
     config_options[pos++] = 9;      // length
     config_options[pos++] = (uint8_t) channel->mode;
-    config_options[pos++] = channel->num_rx_buffers;    // == TxWindows size
+    // TxWindow size: remote must not send more frames than can be told apart from duplicates
+    uint16_t rx_window_size = l2cap_ertm_rx_window_size(channel);
+    config_options[pos++] = (uint8_t) btstack_min(rx_window_size, L2CAP_ERTM_MAX_TX_WINDOW_SIZE);
     config_options[pos++] = channel->local_max_transmit;
     little_endian_store_16( config_options, pos, channel->local_retransmission_timeout_ms);
     pos += 2;
@@ -546,7 +704,15 @@ static uint16_t l2cap_setup_options_ertm_request(l2cap_channel_t * channel, uint
         config_options[pos++] = 1;     // length
         config_options[pos++] = channel->fcs_option;
     }
-    return pos; // 11+4+3=18
+
+    // Extended Window Size replaces TxWindow from Retransmission and Flow Control option
+    if (channel->extended_control){
+        config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+        config_options[pos++] = 2;     // length
+        little_endian_store_16(config_options, pos, rx_window_size);
+        pos += 2;
+    }
+    return pos; // 11+4+3+4=22
 }
 
 static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uint8_t * config_options){
@@ -555,7 +721,8 @@ static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uin
     config_options[pos++] = 9;      // length
     config_options[pos++] = (uint8_t) channel->mode;
     // less or equal to remote tx window size
-    config_options[pos++] = btstack_min(channel->num_tx_buffers, channel->remote_tx_window_size);
+    uint16_t tx_window_size = btstack_min(channel->num_tx_buffers, channel->remote_tx_window_size);
+    config_options[pos++] = (uint8_t) btstack_min(tx_window_size, L2CAP_ERTM_MAX_TX_WINDOW_SIZE);
     // max transmit in response shall be ignored -> use sender values
     config_options[pos++] = channel->remote_max_transmit;
     // A value for the Retransmission time-out shall be sent in a positive Configuration Response
@@ -579,15 +746,22 @@ static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uin
     config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_FRAME_CHECK_SEQUENCE;
     config_options[pos++] = 1;     // length
     config_options[pos++] = channel->fcs_option;
-    return pos; // 11+4=15
+    //
+    if (channel->extended_control){
+        config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+        config_options[pos++] = 2;     // length
+        little_endian_store_16(config_options, pos, tx_window_size);
+        pos += 2;
+    }
+    return pos; // 11+4+3+4=22
 }
 
-static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, uint16_t control){
+static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, uint32_t control){
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    log_info("S-Frame: control 0x%04x", control);
-    little_endian_store_16(acl_buffer, 8, control);
-    return l2cap_send_prepared(channel->local_cid, 2);
+    log_info("S-Frame: control 0x%04x", (int) control);
+    l2cap_ertm_store_control_field(channel, acl_buffer, control);
+    return l2cap_send_prepared(channel->local_cid, l2cap_ertm_control_field_size(channel));
 }
 
 static uint8_t l2cap_ertm_validate_local_config(l2cap_ertm_config_t * ertm_config){
@@ -613,8 +787,12 @@ static uint8_t l2cap_ertm_validate_local_config(l2cap_ertm_config_t * ertm_confi
         log_error("num_rx_buffers must be >= 1");
         result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
     }
+    if (ertm_config->num_rx_buffers > L2CAP_ERTM_MAX_EXTENDED_TX_WINDOW_SIZE){
+        log_error("num_rx_buffers must be <= %u", L2CAP_ERTM_MAX_EXTENDED_TX_WINDOW_SIZE);
+        result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
     if (ertm_config->num_tx_buffers < 1){
-        log_error("num_rx_buffers must be >= 1");
+        log_error("num_tx_buffers must be >= 1");
         result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
     }
     return result;
@@ -629,6 +807,8 @@ static void l2cap_ertm_setup_buffers(l2cap_channel_t * channel, uint8_t * buffer
     pos += channel->num_rx_buffers * sizeof(l2cap_ertm_rx_packet_state_t);
     channel->tx_packets_state = (l2cap_ertm_tx_packet_state_t *) (void *) &buffer[pos];
     pos += channel->num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t);
+    // buffer might be reused, rx frames are looked up by TxSeq
+    (void) memset(buffer, 0, pos);
 
     // setup reassembly buffer
     channel->reassembly_buffer = &buffer[pos];
@@ -638,12 +818,12 @@ static void l2cap_ertm_setup_buffers(l2cap_channel_t * channel, uint8_t * buffer
     channel->rx_packets_data = &buffer[pos];
     pos += channel->num_rx_buffers * channel->local_mps;
 
-    // setup tx buffers
-    channel->tx_packets_data = &buffer[pos];
-    pos += channel->num_rx_buffers * channel->remote_mps;
-
+    // setup tx ring buffer with remaining space
     btstack_assert(pos <= size);
-    UNUSED(pos);
+    channel->tx_packets_data = &buffer[pos];
+    channel->tx_ring_size = size - pos;
+    channel->tx_ring_used = 0;
+    channel->tx_ring_write_pos = 0;
 }
 
 static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size){
@@ -657,6 +837,7 @@ static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_c
     channel->num_rx_buffers = ertm_config->num_rx_buffers;
     channel->num_tx_buffers = ertm_config->num_tx_buffers;
     channel->fcs_option = ertm_config->fcs_option;
+    channel->extended_control = false;
 
     // align buffer to 16-byte boundary to assert l2cap_ertm_rx_packet_state_t is aligned
     int bytes_till_alignment = 16 - (((uintptr_t) buffer) & 0x0f);
@@ -761,6 +942,7 @@ uint8_t l2cap_ertm_accept_connection(uint16_t local_cid, l2cap_ertm_config_t * e
             break;
     }
 
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
 
     return ERROR_CODE_SUCCESS;
@@ -780,6 +962,7 @@ uint8_t l2cap_ertm_set_busy(uint16_t local_cid){
     if (!channel->local_busy){
         channel->local_busy = 1;
         channel->send_supervisor_frame_receiver_not_ready = 1;
+        l2cap_trigger_run_for_channel(channel);
         l2cap_run();
     }
     return ERROR_CODE_SUCCESS;
@@ -799,13 +982,14 @@ uint8_t l2cap_ertm_set_ready(uint16_t local_cid){
 
         // send RR/P=1
         channel->send_supervisor_frame_receiver_ready_poll = 1;
+        l2cap_trigger_run_for_channel(channel);
         l2cap_run();
     }
     return ERROR_CODE_SUCCESS;
 }
 
 // Process-ReqSeq
-static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t req_seq){
+static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint16_t req_seq){
     int num_buffers_acked = 0;
     l2cap_ertm_tx_packet_state_t * tx_state;
     log_info("l2cap_ertm_process_req_seq: tx_read_index %u, tx_write_index %u, req_seq %u", l2cap_channel->tx_read_index, l2cap_channel->tx_write_index, req_seq);
@@ -820,13 +1004,14 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
 
         tx_state = &l2cap_channel->tx_packets_state[l2cap_channel->tx_read_index];
         // calc delta
-        int delta = (req_seq - tx_state->tx_seq) & 0x03f;
+        int delta = (req_seq - tx_state->tx_seq) & l2cap_ertm_seq_nr_mask(l2cap_channel);
         if (delta == 0) break;  // all packets acknowledged
         if (delta > l2cap_channel->remote_tx_window_size) break;   
 
         num_buffers_acked++;
         l2cap_channel->num_stored_tx_frames--;
         l2cap_channel->unacked_frames--;
+        l2cap_channel->tx_ring_used -= tx_state->len;
         log_info("RR seq %u => packet with tx_seq %u done", req_seq, tx_state->tx_seq);
 
         l2cap_channel->tx_read_index++;
@@ -838,39 +1023,96 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
     }
     if (num_buffers_acked){
         log_info("num_buffers_acked %u", num_buffers_acked);
+        // restart ring buffer at the beginning if empty to avoid wrap-around
+        if (l2cap_channel->num_stored_tx_frames == 0){
+            l2cap_channel->tx_ring_write_pos = 0;
+        }
         l2cap_ertm_notify_channel_can_send(l2cap_channel);
     }
 }     
 
-static l2cap_ertm_tx_packet_state_t * l2cap_ertm_get_tx_state(l2cap_channel_t * l2cap_channel, uint8_t tx_seq){
-    int i;
-    for (i=0;i<l2cap_channel->num_tx_buffers;i++){
-        l2cap_ertm_tx_packet_state_t * tx_state = &l2cap_channel->tx_packets_state[i];
+// only unacknowledged frames can be requested
+static l2cap_ertm_tx_packet_state_t * l2cap_ertm_get_tx_state(l2cap_channel_t * l2cap_channel, uint16_t tx_seq){
+    uint16_t tx_index = l2cap_channel->tx_read_index;
+    for (uint16_t unacked_frames = l2cap_channel->unacked_frames; unacked_frames > 0 ; unacked_frames--){
+        l2cap_ertm_tx_packet_state_t * tx_state = &l2cap_channel->tx_packets_state[tx_index];
         if (tx_state->tx_seq == tx_seq) return tx_state;
+        tx_index++;
+        if (tx_index >= l2cap_channel->num_tx_buffers){
+            tx_index = 0;
+        }
     }
     return NULL;
 }
 
-// @param delta number of frames in the future, >= 1
+// returns buffer index of oldest frame with retransmission requested
+static bool l2cap_ertm_get_retransmission_index(l2cap_channel_t * l2cap_channel, uint16_t * out_tx_index){
+    uint16_t tx_index = l2cap_channel->tx_read_index;
+    for (uint16_t unacked_frames = l2cap_channel->unacked_frames; unacked_frames > 0 ; unacked_frames--){
+        if (l2cap_channel->tx_packets_state[tx_index].tx_state == L2CAP_ERTM_TX_STATE_RETRANSMISSION_REQUESTED){
+            *out_tx_index = tx_index;
+            return true;
+        }
+        tx_index++;
+        if (tx_index >= l2cap_channel->num_tx_buffers){
+            tx_index = 0;
+        }
+    }
+    return false;
+}
+
+// receiver: out-of-order frames are stored in slot relative to rx_store_index, which holds ExpectedTxSeq
+static l2cap_ertm_rx_packet_state_t * l2cap_ertm_get_rx_state(l2cap_channel_t * l2cap_channel, uint16_t delta, uint8_t ** out_rx_buffer){
+    uint32_t index = l2cap_channel->rx_store_index + delta;
+    if (index >= l2cap_channel->num_rx_buffers){
+        index -= l2cap_channel->num_rx_buffers;
+    }
+    if (out_rx_buffer != NULL){
+        *out_rx_buffer = &l2cap_channel->rx_packets_data[index * l2cap_channel->local_mps];
+    }
+    return &l2cap_channel->rx_packets_state[index];
+}
+
+// receiver: find next missing frame between ExpectedTxSeq and last frame received out of order to request with SREJ
+static bool l2cap_ertm_get_selective_reject_tx_seq(l2cap_channel_t * l2cap_channel, uint16_t * out_tx_seq){
+    uint16_t mask = l2cap_ertm_seq_nr_mask(l2cap_channel);
+    uint16_t end_delta = (l2cap_channel->srej_end_tx_seq - l2cap_channel->expected_tx_seq) & mask;
+    uint16_t delta     = (l2cap_channel->srej_tx_seq     - l2cap_channel->expected_tx_seq) & mask;
+    // missing frames before have been received in the meantime
+    if (delta > end_delta){
+        delta = 0;
+    }
+    for (; delta < end_delta; delta++){
+        if (l2cap_ertm_get_rx_state(l2cap_channel, delta, NULL)->valid == 0u){
+            *out_tx_seq = (l2cap_channel->expected_tx_seq + delta) & mask;
+            l2cap_channel->srej_tx_seq = *out_tx_seq;
+            return true;
+        }
+    }
+    l2cap_channel->srej_tx_seq = l2cap_channel->srej_end_tx_seq;
+    return false;
+}
+
+static bool l2cap_ertm_selective_reject_pending(l2cap_channel_t * l2cap_channel){
+    uint16_t tx_seq;
+    return l2cap_ertm_get_selective_reject_tx_seq(l2cap_channel, &tx_seq);
+}
+
+// @param delta number of frames in the future, >= 1 and < rx window size
 // @assumption size <= l2cap_channel->local_mps (checked in l2cap_acl_classic_handler)
-static void l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel_t * l2cap_channel, l2cap_segmentation_and_reassembly_t sar, int delta, const uint8_t * payload, uint16_t size){
+static void l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel_t * l2cap_channel, l2cap_segmentation_and_reassembly_t sar, uint16_t delta, const uint8_t * payload, uint16_t size){
     log_info("Store SDU with delta %u", delta);
     // get rx state for packet to store
-    int index = l2cap_channel->rx_store_index + delta - 1;
-    if (index > l2cap_channel->num_rx_buffers){
-        index -= l2cap_channel->num_rx_buffers;
-    }
-    log_info("Index of packet to store %u", index);
-    l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
+    uint8_t * rx_buffer;
+    l2cap_ertm_rx_packet_state_t * rx_state = l2cap_ertm_get_rx_state(l2cap_channel, delta, &rx_buffer);
     // check if buffer is free
     if (rx_state->valid){
-        log_error("Packet buffer already used");
+        log_info("Duplicate frame already stored");
         return;
     }
     rx_state->valid = 1;
     rx_state->sar = sar;
     rx_state->len = size;
-    uint8_t * rx_buffer = &l2cap_channel->rx_packets_data[index];
     (void)memcpy(rx_buffer, payload, size);
 }
 
@@ -879,12 +1121,16 @@ static void l2cap_ertm_handle_in_sequence_sdu(l2cap_channel_t * l2cap_channel, l
     uint16_t reassembly_sdu_length;
     switch (sar){
         case L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU:
+            // abort incomplete SDU
+            l2cap_receive_buffer_release(l2cap_channel, l2cap_channel->reassembly_buffer);
             // assert total packet size <= our mtu
             if (size > l2cap_channel->local_mtu) break;
             // packet complete -> disapatch
             l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, (uint8_t*) payload, size);
             break;
         case L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU:
+            // abort incomplete SDU
+            l2cap_receive_buffer_release(l2cap_channel, l2cap_channel->reassembly_buffer);
             if (size < 2) break;
             // read SDU len
             reassembly_sdu_length = little_endian_read_16(payload, 0);
@@ -894,31 +1140,39 @@ static void l2cap_ertm_handle_in_sequence_sdu(l2cap_channel_t * l2cap_channel, l
             if (reassembly_sdu_length > l2cap_channel->local_mtu) break;
             // assert segment <= reassembled size
             if (size > reassembly_sdu_length) break;
-            // store start segment
+            // store start segment in provided buffer or reassembly buffer
             l2cap_channel->reassembly_sdu_length = reassembly_sdu_length;
-            (void)memcpy(&l2cap_channel->reassembly_buffer[0], payload, size);
+            l2cap_channel->receive_sdu_target = l2cap_receive_buffer_for_sdu(l2cap_channel, reassembly_sdu_length, l2cap_channel->reassembly_buffer);
+            (void)memcpy(&l2cap_channel->receive_sdu_target[0], payload, size);
             l2cap_channel->reassembly_pos = size;
             break;
         case L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU:
-            // assert size of reassembled data <= our mtu
-            if (l2cap_channel->reassembly_pos + size > l2cap_channel->local_mtu) break;
+            if (l2cap_channel->receive_sdu_target == NULL) break;
+            // assert size of reassembled data <= announced sdu length
+            if (l2cap_channel->reassembly_pos + size > l2cap_channel->reassembly_sdu_length){
+                l2cap_receive_buffer_release(l2cap_channel, l2cap_channel->reassembly_buffer);
+                break;
+            }
             // store continuation segment
-            (void)memcpy(&l2cap_channel->reassembly_buffer[l2cap_channel->reassembly_pos],
+            (void)memcpy(&l2cap_channel->receive_sdu_target[l2cap_channel->reassembly_pos],
                          payload, size);
             l2cap_channel->reassembly_pos += size;
             break;
         case L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU:
-            // assert size of reassembled data <= our mtu
-            if (l2cap_channel->reassembly_pos + size > l2cap_channel->local_mtu) break;
-            // store continuation segment
-            (void)memcpy(&l2cap_channel->reassembly_buffer[l2cap_channel->reassembly_pos],
+            if (l2cap_channel->receive_sdu_target == NULL) break;
+            // assert size of reassembled data matches announced sdu length
+            if (l2cap_channel->reassembly_pos + size != l2cap_channel->reassembly_sdu_length){
+                l2cap_receive_buffer_release(l2cap_channel, l2cap_channel->reassembly_buffer);
+                break;
+            }
+            // store end segment
+            (void)memcpy(&l2cap_channel->receive_sdu_target[l2cap_channel->reassembly_pos],
                          payload, size);
             l2cap_channel->reassembly_pos += size;
-            // assert size of reassembled data matches announced sdu length
-            if (l2cap_channel->reassembly_pos != l2cap_channel->reassembly_sdu_length) break;
             // packet complete -> disapatch
-            l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, l2cap_channel->reassembly_buffer, l2cap_channel->reassembly_pos);
-            l2cap_channel->reassembly_pos = 0;    
+            l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, l2cap_channel->receive_sdu_target, l2cap_channel->reassembly_pos);
+            l2cap_channel->reassembly_pos = 0;
+            l2cap_channel->receive_sdu_target = NULL;
             break; 
         default:
             btstack_assert(false);
@@ -926,16 +1180,13 @@ static void l2cap_ertm_handle_in_sequence_sdu(l2cap_channel_t * l2cap_channel, l
     }
 }
 
+// @pre tx_send_index selected by l2cap_channel_ready_to_send
 static void l2cap_ertm_channel_send_information_frame(l2cap_channel_t * channel){
     int index = channel->tx_send_index;
     l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
     if (tx_state->tx_state == L2CAP_ERTM_TX_STATE_NEW){
         channel->unacked_frames++;
     }
-    channel->tx_send_index++;
-    if (channel->tx_send_index >= channel->num_tx_buffers){
-        channel->tx_send_index = 0;
-    }
     l2cap_ertm_send_information_frame(channel, index, 0);   // final = 0
 }
 
@@ -1021,6 +1272,19 @@ void l2cap_init(void){
 void l2cap_deinit(void){
     l2cap_channels = NULL;
     l2cap_signaling_responses_pending = 0;
+    l2cap_run_active = false;
+    l2cap_run_requested = false;
+    l2cap_scheduler = NULL;
+    while (l2cap_send_queue_head != NULL){
+        l2cap_send_queue_remove(l2cap_send_queue_head);
+    }
+#ifdef L2CAP_USES_CHANNELS
+    (void)memset(&l2cap_channels_pending, 0, sizeof(l2cap_channels_pending));
+    (void)memset(&l2cap_channels_blocked, 0, sizeof(l2cap_channels_blocked));
+    l2cap_channel_active = NULL;
+    l2cap_channels_trigger_all = false;
+    l2cap_channel_visits = 0;
+#endif
 #ifdef ENABLE_CLASSIC
     l2cap_require_security_level2_for_outgoing_sdp = 0;
     (void)memset(&l2cap_fixed_channel_classic_connectionless, 0, sizeof(l2cap_fixed_channel_classic_connectionless));
@@ -1066,7 +1330,11 @@ void l2cap_request_can_send_fix_channel_now_event(hci_con_handle_t con_handle, u
 
     l2cap_fixed_channel_t * channel = l2cap_fixed_channel_for_channel_id(channel_id);
     if (!channel) return;
+    if (channel->waiting_for_can_send_now == 0u){
+        l2cap_channel_mark_send_request((l2cap_channel_t *) channel);
+    }
     channel->waiting_for_can_send_now = 1;
+    l2cap_send_queue_add((l2cap_channel_t *) channel);
     l2cap_notify_channel_can_send();
 }
 
@@ -1304,7 +1572,11 @@ static l2cap_channel_t * l2cap_get_channel_for_remote_handle_and_cid(hci_con_han
 uint8_t l2cap_request_can_send_now_event(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    if (channel->waiting_for_can_send_now == 0u){
+        l2cap_channel_mark_send_request(channel);
+    }
     channel->waiting_for_can_send_now = 1;
+    l2cap_send_queue_add(channel);
     switch (channel->channel_type){
         case L2CAP_CHANNEL_TYPE_CLASSIC:
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
@@ -1664,7 +1936,8 @@ static uint32_t l2cap_extended_features_mask(void){
     // extended features request supported, features: fixed channels, unicast connectionless data reception
     uint32_t features = 0x280;
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
-    features |= 0x0028;
+    // ERTM, FCS Option, Extended Window Size
+    features |= 0x0128;
 #endif
 #ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
     features |= 0x0400;
@@ -1680,7 +1953,7 @@ static uint32_t l2cap_extended_features_mask(void){
 static bool l2cap_run_for_classic_channel(l2cap_channel_t * channel){
 
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
-    uint8_t  config_options[18];
+    uint8_t  config_options[22];
 #else
     uint8_t  config_options[10];
 #endif
@@ -1843,7 +2116,7 @@ static void l2cap_run_for_classic_channel_ertm(l2cap_channel_t * channel){
     if (channel->send_supervisor_frame_receiver_ready){
         channel->send_supervisor_frame_receiver_ready = 0;
         log_info("Send S-Frame: RR %u, final %u", channel->req_seq, channel->set_final_bit_after_packet_with_poll_bit_set);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0,  channel->set_final_bit_after_packet_with_poll_bit_set, channel->req_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0,  channel->set_final_bit_after_packet_with_poll_bit_set, channel->req_seq);
         channel->set_final_bit_after_packet_with_poll_bit_set = 0;
         l2cap_ertm_send_supervisor_frame(channel, control);
         return;
@@ -1851,51 +2124,52 @@ static void l2cap_run_for_classic_channel_ertm(l2cap_channel_t * channel){
     if (channel->send_supervisor_frame_receiver_ready_poll){
         channel->send_supervisor_frame_receiver_ready_poll = 0;
         log_info("Send S-Frame: RR %u with poll=1 ", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
         l2cap_ertm_send_supervisor_frame(channel, control);
         return;
     }
     if (channel->send_supervisor_frame_receiver_not_ready){
         channel->send_supervisor_frame_receiver_not_ready = 0;
         log_info("Send S-Frame: RNR %u", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
         l2cap_ertm_send_supervisor_frame(channel, control);
         return;
     }
     if (channel->send_supervisor_frame_reject){
         channel->send_supervisor_frame_reject = 0;
         log_info("Send S-Frame: REJ %u", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
         l2cap_ertm_send_supervisor_frame(channel, control);
         return;
     }
     if (channel->send_supervisor_frame_selective_reject){
         channel->send_supervisor_frame_selective_reject = 0;
         log_info("Send S-Frame: SREJ %u", channel->expected_tx_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, channel->set_final_bit_after_packet_with_poll_bit_set, channel->expected_tx_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, channel->set_final_bit_after_packet_with_poll_bit_set, channel->expected_tx_seq);
         channel->set_final_bit_after_packet_with_poll_bit_set = 0;
         l2cap_ertm_send_supervisor_frame(channel, control);
         return;
     }
+    // request each missing frame once
+    uint16_t srej_tx_seq;
+    if (l2cap_ertm_get_selective_reject_tx_seq(channel, &srej_tx_seq)){
+        channel->srej_tx_seq = l2cap_next_ertm_seq_nr(channel, srej_tx_seq);
+        log_info("Send S-Frame: SREJ %u", srej_tx_seq);
+        uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, 0, srej_tx_seq);
+        l2cap_ertm_send_supervisor_frame(channel, control);
+        return;
+    }
 
     if (channel->srej_active){
-        int i;
-        for (i=0;i<channel->num_tx_buffers;i++){
-            l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[i];
-            if (tx_state->tx_state == L2CAP_ERTM_TX_STATE_RETRANSMISSION_REQUESTED) {
-                uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
-                channel->set_final_bit_after_packet_with_poll_bit_set = 0;
-                l2cap_ertm_send_information_frame(channel, i, final);
-                break;
-            }
-        }
-        if (i == channel->num_tx_buffers){
-            // no retransmission request found
-            channel->srej_active = 0;
-        } else {
-            // packet was sent
+        uint16_t tx_index;
+        if (l2cap_ertm_get_retransmission_index(channel, &tx_index)){
+            uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
+            channel->set_final_bit_after_packet_with_poll_bit_set = 0;
+            l2cap_ertm_send_information_frame(channel, tx_index, final);
             return;
         }
+        // no retransmission request found
+        channel->srej_active = 0;
     }
 }
 #endif /* ERTM */
@@ -2116,24 +2390,6 @@ static bool l2cap_cbm_run_channel(l2cap_channel_t * channel) {
     return channel_closed;
 }
 
-static void l2cap_cbm_run_channels(void){
-    btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &l2cap_channels);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-
-        if (channel->channel_type != L2CAP_CHANNEL_TYPE_CHANNEL_CBM) continue;
-        if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-
-        bool channel_closed = l2cap_cbm_run_channel(channel);
-        if (channel_closed) {
-            // discard channel - l2cap_finialize_channel_close without sending l2cap close event
-            btstack_linked_list_iterator_remove(&it);
-            l2cap_free_channel_entry(channel);
-        }
-    }
-}
-
 static inline uint8_t l2cap_cbm_status_for_result(uint16_t result) {
     switch (result) {
         case L2CAP_CBM_CONNECTION_RESULT_SUCCESS:
@@ -2198,103 +2454,70 @@ static void l2cap_ecbm_emit_reconfigure_complete(l2cap_channel_t *channel, uint1
     l2cap_dispatch_to_channel(channel, HCI_EVENT_PACKET, event, sizeof(event));
 }
 
-static void l2cap_ecbm_run_channels(void) {
-    hci_con_handle_t con_handle = HCI_CON_HANDLE_INVALID;
+// collect all channels that belong to the same combined signaling pdu as the given channel and send it
+static void l2cap_ecbm_run_combined_pdu(l2cap_channel_t * first_channel) {
+    hci_con_handle_t con_handle = first_channel->con_handle;
     // num max channels + 1 for signaling pdu generator
     uint16_t cids[L2CAP_ECBM_MAX_CID_ARRAY_SIZE + 1];
-    uint8_t num_cids = 0;
+    uint8_t num_cids = first_channel->num_cids;
     uint8_t sig_id;
-    uint16_t spsm;
-    L2CAP_STATE matching_state;
+    uint16_t spsm = 0;
+    L2CAP_STATE matching_state = first_channel->state;
     bool match_remote_sig_cid;
     uint8_t result = 0;
     uint16_t local_mtu;
-    uint16_t initial_credits;
-    uint16_t signaling_cid;
+    uint16_t initial_credits = 0;
+    uint16_t signaling_cid = first_channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
     L2CAP_STATE new_state;
     uint16_t local_mps;
 
-    // pick first channel that needs to send a combined signaling pdu and setup collection via break
-    // then collect all others that belong to the same pdu
+    switch (matching_state) {
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_REQUEST:
+            local_mtu = first_channel->local_mtu;
+            local_mps = first_channel->local_mps;
+            spsm = first_channel->psm;
+            result = first_channel->reason;
+            initial_credits = first_channel->credits_incoming;
+            sig_id = first_channel->local_sig_id;
+            new_state = L2CAP_STATE_WAIT_ENHANCED_CONNECTION_RESPONSE;
+            match_remote_sig_cid = false;
+            break;
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE:
+            local_mtu = first_channel->local_mtu;
+            local_mps = first_channel->local_mps;
+            initial_credits = first_channel->credits_incoming;
+            sig_id = first_channel->remote_sig_id;
+            new_state = L2CAP_STATE_OPEN;
+            match_remote_sig_cid = true;
+            break;
+        case L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST:
+            sig_id = first_channel->local_sig_id;
+            local_mtu = first_channel->renegotiate_mtu;
+            local_mps = first_channel->local_mps;
+            new_state = L2CAP_STATE_WAIT_ENHANCED_RENEGOTIATION_RESPONSE;
+            match_remote_sig_cid = false;
+            break;
+        default:
+            btstack_unreachable();
+            return;
+    }
+
+    // setup cid array
+    (void) memset(cids, 0xff, sizeof(cids));
+    (void) memset(cids, 0, num_cids * sizeof(uint16_t));
+
+    // collect all channels that belong to the same pdu by state, con_handle, and signaling id
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)) {
         l2cap_channel_t *channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
         if (channel->channel_type != L2CAP_CHANNEL_TYPE_CHANNEL_ECBM) continue;
-        if (con_handle == HCI_CON_HANDLE_INVALID) {
-            switch (channel->state) {
-                case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_REQUEST:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    local_mtu = channel->local_mtu;
-                    local_mps = channel->local_mps;
-                    spsm = channel->psm;
-                    result = channel->reason;
-                    initial_credits = channel->credits_incoming;
-                    sig_id = channel->local_sig_id;
-                    new_state = L2CAP_STATE_WAIT_ENHANCED_CONNECTION_RESPONSE;
-                    match_remote_sig_cid = false;
-                    break;
-                case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    local_mtu = channel->local_mtu;
-                    local_mps = channel->local_mps;
-                    initial_credits = channel->credits_incoming;
-                    sig_id = channel->remote_sig_id;
-                    new_state = L2CAP_STATE_OPEN;
-                    match_remote_sig_cid = true;
-                    break;
-                case L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    sig_id = channel->local_sig_id;
-                    local_mtu = channel->renegotiate_mtu;
-                    local_mps = channel->local_mps;
-                    new_state = L2CAP_STATE_WAIT_ENHANCED_RENEGOTIATION_RESPONSE;
-                    match_remote_sig_cid = false;
-                    break;
-                case L2CAP_STATE_OPEN:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    if (channel->new_credits_incoming) {
-                        l2cap_credit_based_send_credits(channel);
-                    }
-                    continue;
-                case L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    channel->local_sig_id = l2cap_next_sig_id();
-                    channel->state = L2CAP_STATE_WAIT_DISCONNECT;
-                    signaling_cid = channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
-                    l2cap_send_general_signaling_packet(channel->con_handle, signaling_cid, DISCONNECTION_REQUEST,
-                                                        channel->local_sig_id, channel->remote_cid, channel->local_cid);
-                    continue;
-                case L2CAP_STATE_WILL_SEND_DISCONNECT_RESPONSE:
-                    if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-                    channel->state = L2CAP_STATE_INVALID;
-                    signaling_cid = channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
-                    l2cap_send_general_signaling_packet(channel->con_handle, signaling_cid, DISCONNECTION_RESPONSE,
-                                                        channel->remote_sig_id, channel->local_cid,
-                                                        channel->remote_cid);
-                    l2cap_cbm_finalize_channel_close(channel);  // -- remove from list
-                    continue;
-                default:
-                    continue;
-            }
-
-            // channel picked - setup cid array and collect info
-            (void) memset(cids, 0xff, sizeof(cids));
-            (void) memset(cids, 0, channel->num_cids * sizeof(uint16_t));
-            matching_state = channel->state;
-            con_handle = channel->con_handle;
-            signaling_cid = channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
-            num_cids = channel->num_cids;
-
+        if (matching_state != channel->state) continue;
+        if (channel->con_handle != con_handle) continue;
+        if (match_remote_sig_cid) {
+            if (channel->remote_sig_id != sig_id) continue;
         } else {
-            // check if it matches first channel by state, con_handle, and signaling id
-            if (matching_state != channel->state) continue;
-            if (channel->con_handle != con_handle) continue;
-            if (match_remote_sig_cid) {
-                if (channel->remote_sig_id != sig_id) continue;
-            } else {
-                if (channel->local_sig_id != sig_id) continue;
-            }
+            if (channel->local_sig_id != sig_id) continue;
         }
 
         // add this cid
@@ -2310,80 +2533,290 @@ static void l2cap_ecbm_run_channels(void) {
             } else {
                 result = channel->reason;
                 btstack_linked_list_iterator_remove(&it);
-                btstack_memory_l2cap_channel_free(channel);
+                l2cap_free_channel_entry(channel);
             }
         }
     }
 
-    if (con_handle != HCI_CON_HANDLE_INVALID) {
-        switch (matching_state) {
-            case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_REQUEST:
-                log_info("send combined connection request for %u cids", num_cids);
-                l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_CONNECTION_REQUEST,
-                                                    sig_id, spsm, local_mtu, local_mps, initial_credits, cids);
-                break;
-            case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE:
-                log_info("send combined connection response for %u cids", num_cids);
-                l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_CONNECTION_RESPONSE,
-                                                    sig_id, local_mtu, local_mps, initial_credits, result, cids);
-                break;
-            case L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST:
-                log_info("send combined renegotiation request for %u cids", num_cids);
-                l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_RECONFIGURE_REQUEST,
-                                                    sig_id, local_mtu, local_mps, cids);
-                break;
-            default:
-                break;
-        }
+    switch (matching_state) {
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_REQUEST:
+            log_info("send combined connection request for %u cids", num_cids);
+            l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_CONNECTION_REQUEST,
+                                                sig_id, spsm, local_mtu, local_mps, initial_credits, cids);
+            break;
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE:
+            log_info("send combined connection response for %u cids", num_cids);
+            l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_CONNECTION_RESPONSE,
+                                                sig_id, local_mtu, local_mps, initial_credits, result, cids);
+            break;
+        case L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST:
+            log_info("send combined renegotiation request for %u cids", num_cids);
+            l2cap_send_general_signaling_packet(con_handle, signaling_cid, L2CAP_CREDIT_BASED_RECONFIGURE_REQUEST,
+                                                sig_id, local_mtu, local_mps, cids);
+            break;
+        default:
+            break;
+    }
+}
+
+static void l2cap_ecbm_run_channel(l2cap_channel_t * channel) {
+    uint16_t signaling_cid;
+    if (!hci_can_send_acl_packet_now(channel->con_handle)) return;
+    switch (channel->state) {
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_REQUEST:
+        case L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE:
+        case L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST:
+            l2cap_ecbm_run_combined_pdu(channel);
+            break;
+        case L2CAP_STATE_OPEN:
+            if (channel->new_credits_incoming) {
+                l2cap_credit_based_send_credits(channel);
+            }
+            break;
+        case L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST:
+            channel->local_sig_id = l2cap_next_sig_id();
+            channel->state = L2CAP_STATE_WAIT_DISCONNECT;
+            signaling_cid = channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
+            l2cap_send_general_signaling_packet(channel->con_handle, signaling_cid, DISCONNECTION_REQUEST,
+                                                channel->local_sig_id, channel->remote_cid, channel->local_cid);
+            break;
+        case L2CAP_STATE_WILL_SEND_DISCONNECT_RESPONSE:
+            channel->state = L2CAP_STATE_INVALID;
+            signaling_cid = channel->address_type == BD_ADDR_TYPE_ACL ? L2CAP_CID_SIGNALING : L2CAP_CID_SIGNALING_LE;
+            l2cap_send_general_signaling_packet(channel->con_handle, signaling_cid, DISCONNECTION_RESPONSE,
+                                                channel->remote_sig_id, channel->local_cid,
+                                                channel->remote_cid);
+            l2cap_cbm_finalize_channel_close(channel);  // -- remove from list
+            break;
+        default:
+            break;
     }
 }
 #endif
 
-// MARK: L2CAP_RUN
-// process outstanding signaling tasks
-static void l2cap_run(void){
-    
-    // log_info("l2cap_run: entered");
-    l2cap_run_signaling_response();
+// MARK: L2CAP_RUN pending work queue
 
-#ifdef ENABLE_CLASSIC
-    bool done = l2ap_run_information_requests();
-    if (done) return;
-#endif
+#ifdef L2CAP_USES_CHANNELS
+static void l2cap_channel_queue_add(l2cap_channel_queue_t * queue, l2cap_channel_t * channel){
+    channel->run_next = NULL;
+    if (queue->tail == NULL){
+        queue->head = channel;
+    } else {
+        queue->tail->run_next = channel;
+    }
+    queue->tail = channel;
+}
 
-#if defined(ENABLE_CLASSIC) || defined(ENABLE_BLE)
-    btstack_linked_list_iterator_t it;
-#endif
+static l2cap_channel_t * l2cap_channel_queue_pop(l2cap_channel_queue_t * queue){
+    l2cap_channel_t * channel = queue->head;
+    if (channel == NULL) return NULL;
+    queue->head = channel->run_next;
+    if (queue->head == NULL){
+        queue->tail = NULL;
+    }
+    channel->run_next = NULL;
+    return channel;
+}
 
-#ifdef ENABLE_CLASSIC
-    btstack_linked_list_iterator_init(&it, &l2cap_channels);
-    while (btstack_linked_list_iterator_has_next(&it)){
+static void l2cap_channel_queue_remove(l2cap_channel_queue_t * queue, l2cap_channel_t * channel){
+    l2cap_channel_t * prev = NULL;
+    l2cap_channel_t * it;
+    for (it = queue->head; it != NULL; it = it->run_next){
+        if (it != channel) {
+            prev = it;
+            continue;
+        }
+        if (prev == NULL){
+            queue->head = channel->run_next;
+        } else {
+            prev->run_next = channel->run_next;
+        }
+        if (queue->tail == channel){
+            queue->tail = prev;
+        }
+        channel->run_next = NULL;
+        return;
+    }
+}
 
-        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+// queue channel for next l2cap_run, needs to be called after changing channel state outside of l2cap_run
+static void l2cap_trigger_run_for_channel(l2cap_channel_t * channel){
+    switch (channel->run_state){
+        case L2CAP_CHANNEL_RUN_STATE_IDLE:
+            channel->run_state = L2CAP_CHANNEL_RUN_STATE_PENDING;
+            l2cap_channel_queue_add(&l2cap_channels_pending, channel);
+            break;
+        case L2CAP_CHANNEL_RUN_STATE_ACTIVE:
+            channel->run_state = L2CAP_CHANNEL_RUN_STATE_RETRIGGERED;
+            break;
+        default:
+            break;
+    }
+}
 
-        if (channel->channel_type != L2CAP_CHANNEL_TYPE_CLASSIC) continue;
+// used for connection-level events that might affect any channel, i.e. disconnect and security level changes
+static void l2cap_trigger_run_for_all_channels(void){
+    l2cap_channels_trigger_all = true;
+}
 
-        // log_info("l2cap_run: channel %p, state %u, var 0x%02x", channel, channel->state, channel->state_var);
-        bool finalized = l2cap_run_for_classic_channel(channel);
+static void l2cap_cancel_run_for_channel(l2cap_channel_t * channel){
+    switch (channel->run_state){
+        case L2CAP_CHANNEL_RUN_STATE_PENDING:
+            l2cap_channel_queue_remove(&l2cap_channels_pending, channel);
+            break;
+        case L2CAP_CHANNEL_RUN_STATE_BLOCKED:
+            l2cap_channel_queue_remove(&l2cap_channels_blocked, channel);
+            break;
+        case L2CAP_CHANNEL_RUN_STATE_ACTIVE:
+        case L2CAP_CHANNEL_RUN_STATE_RETRIGGERED:
+            // let l2cap_run_channels know that the channel is gone
+            l2cap_channel_active = NULL;
+            break;
+        default:
+            break;
+    }
+    channel->run_state = L2CAP_CHANNEL_RUN_STATE_IDLE;
+}
+
+// returns true if l2cap_run needs to visit the channel again, e.g. after it could not send
+static bool l2cap_channel_has_pending_work(l2cap_channel_t * channel){
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        if (channel->send_supervisor_frame_receiver_ready)        return true;
+        if (channel->send_supervisor_frame_receiver_ready_poll)   return true;
+        if (channel->send_supervisor_frame_receiver_not_ready)    return true;
+        if (channel->send_supervisor_frame_reject)                return true;
+        if (channel->send_supervisor_frame_selective_reject)      return true;
+        if (channel->srej_active)                                 return true;
+        if (l2cap_ertm_selective_reject_pending(channel))         return true;
+    }
+#endif
+    switch (channel->state){
+        // waiting for remote or HCI events, these trigger the channel when needed
+        case L2CAP_STATE_WAIT_CONNECTION_COMPLETE:
+        case L2CAP_STATE_WAIT_REMOTE_SUPPORTED_FEATURES:
+        case L2CAP_STATE_WAIT_OUTGOING_SECURITY_LEVEL_UPDATE:
+        case L2CAP_STATE_WAIT_INCOMING_EXTENDED_FEATURES:
+        case L2CAP_STATE_WAIT_OUTGOING_EXTENDED_FEATURES:
+        case L2CAP_STATE_WAIT_CONNECT_RSP:
+        case L2CAP_STATE_WAIT_DISCONNECT:
+        case L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE:
+        case L2CAP_STATE_WAIT_ENHANCED_CONNECTION_RESPONSE:
+        case L2CAP_STATE_WAIT_ENHANCED_RENEGOTIATION_RESPONSE:
+        case L2CAP_STATE_CLOSED:
+        case L2CAP_STATE_INVALID:
+            return false;
+        case L2CAP_STATE_WAIT_INCOMING_SECURITY_LEVEL_UPDATE:
+        case L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT:
+            return (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONN_RESP_PEND) != 0;
+#ifdef ENABLE_CLASSIC
+        case L2CAP_STATE_CONFIG:
+            if ((channel->state_var & (L2CAP_CHANNEL_STATE_VAR_SEND_CONF_REQ | L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP)) != 0) return true;
+            return l2cap_channel_ready_for_open(channel) != 0;
+#endif
+        case L2CAP_STATE_OPEN:
+            return channel->new_credits_incoming != 0;
+        default:
+            // new channels and all WILL_SEND states
+            return true;
+    }
+}
 
-        if (!finalized) {
+static void l2cap_run_for_channel(l2cap_channel_t * channel){
+    switch (channel->channel_type){
+#ifdef ENABLE_CLASSIC
+        case L2CAP_CHANNEL_TYPE_CLASSIC:
+            // log_info("l2cap_run: channel %p, state %u, var 0x%02x", channel, channel->state, channel->state_var);
+            if (l2cap_run_for_classic_channel(channel)) break;
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
             l2cap_run_for_classic_channel_ertm(channel);
 #endif
+            break;
+#endif
+#ifdef ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
+        case L2CAP_CHANNEL_TYPE_CHANNEL_CBM:
+            if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
+            if (l2cap_cbm_run_channel(channel)) {
+                // discard channel - l2cap_finialize_channel_close without sending l2cap close event
+                btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                l2cap_free_channel_entry(channel);
+            }
+            break;
+#endif
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+        case L2CAP_CHANNEL_TYPE_CHANNEL_ECBM:
+            l2cap_ecbm_run_channel(channel);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+// visit channels with pending work, channels that still have work left are visited again on next l2cap_run
+static void l2cap_run_channels(void){
+    l2cap_channel_t * channel;
+
+    if (l2cap_channels_trigger_all){
+        l2cap_channels_trigger_all = false;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &l2cap_channels);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+            if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
+            l2cap_trigger_run_for_channel(channel);
         }
     }
+
+    while (true){
+        channel = l2cap_channel_queue_pop(&l2cap_channels_pending);
+        if (channel == NULL) break;
+
+        l2cap_channel_visits++;
+        channel->run_state = L2CAP_CHANNEL_RUN_STATE_ACTIVE;
+        l2cap_channel_active = channel;
+        l2cap_run_for_channel(channel);
+
+        // channel has been freed
+        if (l2cap_channel_active == NULL) continue;
+        l2cap_channel_active = NULL;
+
+        if ((channel->run_state == L2CAP_CHANNEL_RUN_STATE_RETRIGGERED) || l2cap_channel_has_pending_work(channel)){
+            channel->run_state = L2CAP_CHANNEL_RUN_STATE_BLOCKED;
+            l2cap_channel_queue_add(&l2cap_channels_blocked, channel);
+        } else {
+            channel->run_state = L2CAP_CHANNEL_RUN_STATE_IDLE;
+        }
+    }
+
+    // move blocked channels back into pending queue
+    while (true){
+        channel = l2cap_channel_queue_pop(&l2cap_channels_blocked);
+        if (channel == NULL) break;
+        channel->run_state = L2CAP_CHANNEL_RUN_STATE_PENDING;
+        l2cap_channel_queue_add(&l2cap_channels_pending, channel);
+    }
+}
 #endif
 
-#ifdef ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
-    l2cap_cbm_run_channels();
+// process outstanding signaling tasks
+static void l2cap_run_once(void){
+    
+    // log_info("l2cap_run: entered");
+    l2cap_run_signaling_response();
+
+#ifdef ENABLE_CLASSIC
+    bool done = l2ap_run_information_requests();
+    if (done) return;
 #endif
 
-#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
-    l2cap_ecbm_run_channels();
+#ifdef L2CAP_USES_CHANNELS
+    l2cap_run_channels();
 #endif
 
 #ifdef ENABLE_BLE
     // send l2cap con paramter update if necessary
+    btstack_linked_list_iterator_t it;
     hci_connections_get_iterator(&it);
     while(btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
@@ -2397,6 +2830,7 @@ static void l2cap_run(void){
                 break;
             case CON_PARAMETER_UPDATE_SEND_RESPONSE:
                 connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS;
+                hci_connection_trigger_run(connection);
                 l2cap_send_le_signaling_packet(connection->con_handle, CONNECTION_PARAMETER_UPDATE_RESPONSE, connection->le_con_param_update_identifier, 0);
                 break;
             case CON_PARAMETER_UPDATE_DENY:
@@ -2417,6 +2851,21 @@ static void l2cap_run(void){
     // log_info("l2cap_run: exit");
 }
 
+// MARK: L2CAP_RUN
+static void l2cap_run(void){
+    // defer nested calls, e.g. from event handlers called by l2cap_run
+    if (l2cap_run_active){
+        l2cap_run_requested = true;
+        return;
+    }
+    l2cap_run_active = true;
+    do {
+        l2cap_run_requested = false;
+        l2cap_run_once();
+    } while (l2cap_run_requested);
+    l2cap_run_active = false;
+}
+
 #ifdef ENABLE_CLASSIC
 static void l2cap_ready_to_connect(l2cap_channel_t * channel){
 
@@ -2447,6 +2896,7 @@ static void l2cap_handle_connection_complete(hci_con_handle_t con_handle, l2cap_
         log_info("connection complete con_handle %04x - for channel %p cid 0x%04x",
             (int) con_handle, (void *) channel, channel->local_cid);
         channel->con_handle = con_handle;
+        l2cap_trigger_run_for_channel(channel);
         // query remote features if pairing is required
         if (channel->required_security_level > LEVEL_0){
             channel->state = L2CAP_STATE_WAIT_REMOTE_SUPPORTED_FEATURES;
@@ -2459,6 +2909,7 @@ static void l2cap_handle_connection_complete(hci_con_handle_t con_handle, l2cap_
 
 static void l2cap_handle_remote_supported_features_received(l2cap_channel_t * channel){
     if (channel->state != L2CAP_STATE_WAIT_REMOTE_SUPPORTED_FEATURES) return;
+    l2cap_trigger_run_for_channel(channel);
 
     bool security_sufficient = gap_security_level(channel->con_handle) >= channel->required_security_level;
 
@@ -2536,20 +2987,32 @@ static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t pac
     channel->state_var = L2CAP_CHANNEL_STATE_VAR_NONE;
     channel->remote_sig_id = L2CAP_SIG_ID_INVALID;
     channel->local_sig_id = L2CAP_SIG_ID_INVALID;
+    l2cap_channel_mark_send_request(channel);
 
     log_info("create channel %p, local_cid 0x%04x", (void*)channel, channel->local_cid);
 
+    // visit new channel on next l2cap_run
+    l2cap_trigger_run_for_channel(channel);
+
     return channel;
 }
 
 static void l2cap_free_channel_entry(l2cap_channel_t * channel){
     log_info("free channel %p, local_cid 0x%04x", (void*)channel, channel->local_cid);
+    // remove from pending work and send queue
+    l2cap_cancel_run_for_channel(channel);
+    l2cap_send_queue_remove(channel);
     // assert all timers are stopped
     l2cap_stop_rtx(channel);
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     l2cap_ertm_stop_retransmission_timer(channel);
     l2cap_ertm_stop_monitor_timer(channel);
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        l2cap_receive_buffer_release(channel, channel->reassembly_buffer);
+    }
 #endif
+    // return buffer of incomplete SDU
+    l2cap_receive_buffer_release(channel, channel->receive_sdu_buffer);
     // free  memory
     btstack_memory_l2cap_channel_free(channel);
 }
@@ -2677,6 +3140,36 @@ static void l2cap_handle_connection_success_for_addr(bd_addr_t address, hci_con_
 }
 #endif
 
+// channel requested to send, independent of channel state and available outgoing buffers
+static bool l2cap_channel_has_send_request(const l2cap_channel_t * channel){
+    switch (channel->channel_type){
+#ifdef ENABLE_CLASSIC
+        case L2CAP_CHANNEL_TYPE_CLASSIC:
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+            if ((channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION) && (channel->num_stored_tx_frames > 0u)) return true;
+#endif
+            return channel->waiting_for_can_send_now != 0u;
+        case L2CAP_CHANNEL_TYPE_FIXED_CLASSIC:
+        case L2CAP_CHANNEL_TYPE_CONNECTIONLESS:
+            return channel->waiting_for_can_send_now != 0u;
+#endif
+#ifdef ENABLE_BLE
+        case L2CAP_CHANNEL_TYPE_FIXED_LE:
+            return channel->waiting_for_can_send_now != 0u;
+#endif
+#ifdef ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
+        case L2CAP_CHANNEL_TYPE_CHANNEL_CBM:
+            return channel->send_sdu_buffer != NULL;
+#endif
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+        case L2CAP_CHANNEL_TYPE_CHANNEL_ECBM:
+            return channel->send_sdu_buffer != NULL;
+#endif
+        default:
+            return false;
+    }
+}
+
 static bool l2cap_channel_ready_to_send(l2cap_channel_t * channel){
     switch (channel->channel_type){
 #ifdef ENABLE_CLASSIC
@@ -2686,20 +3179,17 @@ static bool l2cap_channel_ready_to_send(l2cap_channel_t * channel){
             // send new frames or retransmit unacknowledged frames
             if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION) {
                 if (channel->tx_wait_for_final) return false;
-                uint8_t max_tx_frames = (uint8_t) btstack_min(channel->remote_tx_window_size, channel->num_stored_tx_frames);
-                bool request_send = channel->unacked_frames < max_tx_frames;
-                uint8_t tx_index = channel->tx_read_index;
-                for (uint8_t unacked_frames = channel->unacked_frames; (request_send == false) && (unacked_frames > 0) ; unacked_frames--){
-                    const l2cap_ertm_tx_packet_state_t * tx_packet_state = &channel->tx_packets_state[tx_index];
-                    if (tx_packet_state->tx_state == L2CAP_ERTM_TX_STATE_RETRANSMISSION_REQUESTED) {
-                        channel->tx_send_index = tx_index;
-                        request_send = true;
-                    } else {
-                        tx_index++;
-                        if (tx_index >= channel->num_tx_buffers){
-                            tx_index = 0;
-                        }
+                // retransmissions first, oldest frame first
+                bool request_send = l2cap_ertm_get_retransmission_index(channel, &channel->tx_send_index);
+                uint16_t max_tx_frames = btstack_min(channel->remote_tx_window_size, channel->num_stored_tx_frames);
+                if ((request_send == false) && (channel->unacked_frames < max_tx_frames)){
+                    // next new frame follows unacknowledged frames
+                    uint32_t tx_index = channel->tx_read_index + channel->unacked_frames;
+                    if (tx_index >= channel->num_tx_buffers){
+                        tx_index -= channel->num_tx_buffers;
                     }
+                    channel->tx_send_index = (uint16_t) tx_index;
+                    request_send = true;
                 }
                 if (request_send) {
                     return hci_can_send_acl_packet_now(channel->con_handle);
@@ -2778,28 +3268,213 @@ static void l2cap_channel_trigger_send(l2cap_channel_t * channel){
     }
 }
 
-static void l2cap_notify_channel_can_send(void){
-    bool done = false;
-    while (!done){
-        done = true;
-        btstack_linked_list_iterator_t it;
-        btstack_linked_list_iterator_init(&it, &l2cap_channels);
-        while (btstack_linked_list_iterator_has_next(&it)){
-            l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-            bool ready = l2cap_channel_ready_to_send(channel);
-            if (!ready) continue;
+// MARK: outgoing scheduler
 
-            // requeue channel for fairness
-            btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
-            btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
+// connection for round-robin across connections, NULL for fixed channels
+static hci_connection_t * l2cap_scheduler_connection_for_channel(const l2cap_channel_t * channel){
+#ifdef L2CAP_USES_CHANNELS
+    if (l2cap_is_dynamic_channel_type(channel->channel_type)){
+        return hci_connection_for_handle(channel->con_handle);
+    }
+#else
+    UNUSED(channel);
+#endif
+    return NULL;
+}
 
-            // trigger sending
-            l2cap_channel_trigger_send(channel);
+static bool l2cap_scheduler_has_deficit(const l2cap_channel_t * channel){
+    if (channel->send_deficit == 0u) return false;
+    hci_connection_t * connection = l2cap_scheduler_connection_for_channel(channel);
+    if (connection == NULL) return true;
+    return connection->l2cap_state.send_deficit > 0u;
+}
 
-            // exit inner loop as we just broke the iterator, but try again
-            done = false;
-            break;
+// strict priority, deficit round-robin with one packet per connection and round,
+// channels on the same connection get as many packets per round as their weight
+static l2cap_channel_t * l2cap_scheduler_default_select_channel(l2cap_channel_t * channels, bool (*ready_to_send)(l2cap_channel_t * channel)){
+    l2cap_channel_t * channel;
+
+    // get highest priority of channels ready to send
+    bool ready = false;
+    uint8_t priority = 0;
+    for (channel = channels; channel != NULL; channel = channel->send_next){
+        if ((ready == false) || (channel->send_priority > priority)){
+            if ((*ready_to_send)(channel)){
+                ready = true;
+                priority = channel->send_priority;
+            }
+        }
+    }
+    if (ready == false) return NULL;
+
+    int round;
+    for (round = 0; round < 2; round++){
+        // first channel with remaining deficit in queue order, channels are moved to the end once their deficit is used up
+        for (channel = channels; channel != NULL; channel = channel->send_next){
+            if (channel->send_priority != priority) continue;
+            if (!l2cap_scheduler_has_deficit(channel)) continue;
+            if (!(*ready_to_send)(channel)) continue;
+            return channel;
+        }
+        // start next round
+        for (channel = channels; channel != NULL; channel = channel->send_next){
+            if (channel->send_priority != priority) continue;
+            if (!(*ready_to_send)(channel)) continue;
+            if (channel->send_deficit == 0u){
+                channel->send_deficit = (channel->send_weight == 0u) ? 1u : channel->send_weight;
+            }
+            hci_connection_t * connection = l2cap_scheduler_connection_for_channel(channel);
+            if ((connection != NULL) && (connection->l2cap_state.send_deficit == 0u)){
+                connection->l2cap_state.send_deficit = 1;
+            }
+        }
+    }
+    btstack_unreachable();
+    return NULL;
+}
+
+static void l2cap_scheduler_default_channel_served(l2cap_channel_t * channel){
+    if (channel->send_deficit > 0u){
+        channel->send_deficit--;
+    }
+    // requeue channel when its share for this round has been used up
+    if (channel->send_deficit == 0u){
+        l2cap_send_queue_move_to_tail(channel);
+    }
+    hci_connection_t * connection = l2cap_scheduler_connection_for_channel(channel);
+    if ((connection != NULL) && (connection->l2cap_state.send_deficit > 0u)){
+        connection->l2cap_state.send_deficit--;
+    }
+}
+
+static const l2cap_scheduler_t l2cap_scheduler_default = {
+    &l2cap_scheduler_default_select_channel,
+    &l2cap_scheduler_default_channel_served
+};
+
+// channels that become active are queued in front of channels that already had their turn
+static void l2cap_send_queue_add(l2cap_channel_t * channel){
+    if (channel->send_queued) return;
+    channel->send_queued = true;
+    channel->send_next = l2cap_send_queue_head;
+    l2cap_send_queue_head = channel;
+    if (l2cap_send_queue_tail == NULL){
+        l2cap_send_queue_tail = channel;
+    }
+}
+
+static void l2cap_send_queue_move_to_tail(l2cap_channel_t * channel){
+    if (l2cap_send_queue_tail == channel) return;
+    l2cap_send_queue_remove(channel);
+    channel->send_queued = true;
+    l2cap_send_queue_tail->send_next = channel;
+    l2cap_send_queue_tail = channel;
+}
+
+static void l2cap_send_queue_remove(l2cap_channel_t * channel){
+    if (channel->send_queued == false) return;
+    l2cap_channel_t * prev = NULL;
+    l2cap_channel_t * it;
+    for (it = l2cap_send_queue_head; it != NULL; it = it->send_next){
+        if (it == channel) break;
+        prev = it;
+    }
+    btstack_assert(it != NULL);
+    if (prev == NULL){
+        l2cap_send_queue_head = channel->send_next;
+    } else {
+        prev->send_next = channel->send_next;
+    }
+    if (l2cap_send_queue_tail == channel){
+        l2cap_send_queue_tail = prev;
+    }
+    channel->send_next = NULL;
+    channel->send_queued = false;
+}
+
+// start measuring wait time for send request
+static void l2cap_channel_mark_send_request(l2cap_channel_t * channel){
+    channel->send_request_ms = btstack_run_loop_get_time_ms();
+}
+
+static void l2cap_channel_update_send_statistics(l2cap_channel_t * channel){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint32_t wait_time_ms = now - channel->send_request_ms;
+    channel->send_statistics.num_packets++;
+    channel->send_statistics.wait_time_total_ms += wait_time_ms;
+    channel->send_statistics.wait_time_max_ms = btstack_max(channel->send_statistics.wait_time_max_ms, wait_time_ms);
+    // next packet of the same channel waits from now on
+    channel->send_request_ms = now;
+}
+
+void l2cap_set_scheduler(const l2cap_scheduler_t * scheduler){
+    l2cap_scheduler = scheduler;
+}
+
+uint8_t l2cap_set_send_priority(uint16_t local_cid, uint8_t priority, uint8_t weight){
+    l2cap_channel_t * channel = (l2cap_channel_t *) l2cap_channel_item_by_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    channel->send_priority = priority;
+    channel->send_weight = weight;
+    channel->send_deficit = 0;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_get_send_statistics(uint16_t local_cid, l2cap_send_statistics_t * statistics){
+    l2cap_channel_t * channel = (l2cap_channel_t *) l2cap_channel_item_by_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    *statistics = channel->send_statistics;
+    return ERROR_CODE_SUCCESS;
+}
+
+#ifdef L2CAP_USES_CHANNELS
+uint8_t l2cap_set_receive_buffer_provider(uint16_t local_cid, l2cap_receive_buffer_provider_t provider, l2cap_receive_buffer_release_t release){
+    l2cap_channel_t * channel = l2cap_get_channel_for_local_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    channel->receive_buffer_provider = provider;
+    channel->receive_buffer_release = release;
+    return ERROR_CODE_SUCCESS;
+}
+
+static uint8_t * l2cap_receive_buffer_for_sdu(l2cap_channel_t * channel, uint16_t sdu_len, uint8_t * default_buffer){
+    if (channel->receive_buffer_provider == NULL) return default_buffer;
+    uint8_t * buffer = (*channel->receive_buffer_provider)(channel->local_cid, sdu_len);
+    return (buffer != NULL) ? buffer : default_buffer;
+}
+
+// abort incomplete SDU and return buffer to provider
+static void l2cap_receive_buffer_release(l2cap_channel_t * channel, const uint8_t * default_buffer){
+    uint8_t * buffer = channel->receive_sdu_target;
+    channel->receive_sdu_target = NULL;
+    if ((buffer == NULL) || (buffer == default_buffer)) return;
+    if (channel->receive_buffer_release == NULL) return;
+    (*channel->receive_buffer_release)(channel->local_cid, buffer);
+}
+#endif
+
+static void l2cap_notify_channel_can_send(void){
+    const l2cap_scheduler_t * scheduler = (l2cap_scheduler != NULL) ? l2cap_scheduler : &l2cap_scheduler_default;
+    while (true){
+        // drop channels without pending send requests
+        l2cap_channel_t * next;
+        l2cap_channel_t * channel;
+        for (channel = l2cap_send_queue_head; channel != NULL; channel = next){
+            next = channel->send_next;
+            if (!l2cap_channel_has_send_request(channel)){
+                l2cap_send_queue_remove(channel);
+            }
+        }
+
+        channel = (*scheduler->select_channel)(l2cap_send_queue_head, &l2cap_channel_ready_to_send);
+        if (channel == NULL) break;
+
+        l2cap_channel_update_send_statistics(channel);
+        if (scheduler->channel_served != NULL){
+            (*scheduler->channel_served)(channel);
         }
+
+        // trigger sending
+        l2cap_channel_trigger_send(channel);
     }
 }
 
@@ -2811,6 +3486,7 @@ uint8_t l2cap_disconnect(uint16_t local_cid){
         return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
     }
     channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
     return ERROR_CODE_SUCCESS;
 }
@@ -3135,6 +3811,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
 #ifdef L2CAP_USES_CHANNELS
         // handle disconnection complete events
         case HCI_EVENT_DISCONNECTION_COMPLETE:
+            l2cap_trigger_run_for_all_channels();
             handle = hci_event_disconnection_complete_get_connection_handle(packet);
             l2cap_handle_disconnection_complete(handle);
             break;
@@ -3154,6 +3831,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
             break;
 
         case GAP_EVENT_SECURITY_LEVEL:
+            l2cap_trigger_run_for_all_channels();
             handle = gap_event_security_level_get_handle(packet);
             security_level = (gap_security_level_t) gap_event_security_level_get_security_level(packet);
             status = gap_event_security_level_get_status(packet);
@@ -3195,6 +3873,7 @@ static void l2cap_handle_disconnect_request(l2cap_channel_t *channel, uint8_t id
 
     channel->remote_sig_id = identifier;
     channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_RESPONSE;
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
 }
 
@@ -3248,6 +3927,7 @@ static void l2cap_handle_connection_request(hci_con_handle_t handle, uint8_t sig
 
     // add to connections list
     btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_trigger_run_for_channel(channel);
 
     //
     if (required_level > LEVEL_0){
@@ -3279,6 +3959,7 @@ void l2cap_accept_connection(uint16_t local_cid){
     channel->state = L2CAP_STATE_WILL_SEND_CONNECTION_RESPONSE_ACCEPT;
 
     // process
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
 }
 
@@ -3291,6 +3972,7 @@ void l2cap_decline_connection(uint16_t local_cid){
     }
     channel->state  = L2CAP_STATE_WILL_SEND_CONNECTION_RESPONSE_DECLINE;
     channel->reason = L2CAP_CONNECTION_RESULT_NO_RESOURCES_AVAILABLE;
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
 }
 
@@ -3320,6 +4002,7 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
 
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     uint8_t use_fcs = 1;
+    uint16_t extended_window_size = 0;
 #endif
 
     channel->remote_sig_id = command[L2CAP_SIGNALING_COMMAND_SIGID_OFFSET];
@@ -3372,19 +4055,18 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
                         uint16_t remote_mps = little_endian_read_16(command, pos + 7);
                         // optimize our tx buffer configuration based on actual remote mps if remote mps is smaller than planned
                         if (remote_mps < channel->remote_mps){
-                            // get current tx storage
-                            uint16_t num_bytes_per_tx_buffer_before = sizeof(l2cap_ertm_tx_packet_state_t) + channel->remote_mps;
-                            uint16_t tx_storage = channel->num_tx_buffers * num_bytes_per_tx_buffer_before;
+                            // get current tx storage: tx state + ring buffer
+                            uint32_t tx_storage = channel->num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t) + channel->tx_ring_size;
 
                             channel->remote_mps = remote_mps;
-                            uint16_t num_bytes_per_tx_buffer_now = sizeof(l2cap_ertm_tx_packet_state_t) + channel->remote_mps;
-                            channel->num_tx_buffers = tx_storage / num_bytes_per_tx_buffer_now;
+                            uint32_t num_bytes_per_tx_buffer_now = sizeof(l2cap_ertm_tx_packet_state_t) + channel->remote_mps;
+                            channel->num_tx_buffers = (uint16_t) btstack_min(tx_storage / num_bytes_per_tx_buffer_now, 0xffff);
                             uint32_t total_storage = (sizeof(l2cap_ertm_rx_packet_state_t) + channel->local_mps) * channel->num_rx_buffers + tx_storage + channel->local_mtu;
                             l2cap_ertm_setup_buffers(channel, (uint8_t *) channel->rx_packets_state, total_storage);
                         }
                         // limit remote mtu by our tx buffers. Include 2 bytes SDU Length
-                        uint16_t effective_mtu = channel->remote_mps * channel->num_tx_buffers - 2;
-                        channel->remote_mtu    = btstack_min( effective_mtu, channel->remote_mtu);
+                        uint32_t effective_mtu = btstack_min(channel->remote_mps * channel->num_tx_buffers, channel->tx_ring_size) - 2u;
+                        channel->remote_mtu    = (uint16_t) btstack_min( effective_mtu, channel->remote_mtu);
                     }
                     log_info("FC&C config: tx window: %u, max transmit %u, retrans timeout %u, monitor timeout %u, mps %u",
                         channel->remote_tx_window_size,
@@ -3422,6 +4104,10 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
         if (option_type == L2CAP_CONFIG_OPTION_TYPE_FRAME_CHECK_SEQUENCE && length == 1){
             use_fcs = command[pos];
         }        
+        // Extended Window Size { type(8):7, len(8): 2, Max Window Size(16)}
+        if ((option_type == L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE) && (length == 2)){
+            extended_window_size = little_endian_read_16(command, pos) & L2CAP_ERTM_MAX_EXTENDED_TX_WINDOW_SIZE;
+        }
 #endif        
         // handle unknown option
         if ((option_hint == 0) && ((option_type < L2CAP_CONFIG_OPTION_TYPE_MAX_TRANSMISSION_UNIT) || (option_type > L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE))){
@@ -3436,6 +4122,12 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
     }
 
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    // Extended Window Size replaces TxWindow and selects Extended Control Field for both directions
+    if ((extended_window_size > 0u) && (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION)){
+        log_info("Extended Window Size %u", extended_window_size);
+        channel->remote_tx_window_size = extended_window_size;
+        channel->extended_control = true;
+    }
     // "FCS" has precedence over "No FCS"
     uint8_t update = channel->fcs_option || use_fcs;
     log_info("local fcs: %u, remote fcs: %u -> %u", channel->fcs_option, use_fcs, update);
@@ -3521,7 +4213,10 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
     uint16_t result = 0;
     
     log_info("L2CAP signaling handler code %u, state %u", code, channel->state);
-    
+
+    // only the channel addressed by the signaling pdu needs to be visited
+    l2cap_trigger_run_for_channel(channel);
+
     // handle DISCONNECT REQUESTS seperately
     if (code == DISCONNECTION_REQUEST){
         l2cap_handle_disconnect_request(channel, identifier);
@@ -3624,10 +4319,11 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
                 // assert that packet can be stored in fragment buffers in ertm
                 if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
                     uint16_t effective_mps = btstack_min(channel->remote_mps, channel->local_mps);
-                    uint16_t usable_mtu = channel->num_tx_buffers == 1 ? effective_mps : channel->num_tx_buffers * effective_mps - 2;
+                    uint32_t usable_mtu = channel->num_tx_buffers == 1 ? effective_mps : channel->num_tx_buffers * effective_mps - 2;
+                    usable_mtu = btstack_min(usable_mtu, channel->num_tx_buffers == 1 ? channel->tx_ring_size : channel->tx_ring_size - 2);
                     if (usable_mtu < channel->remote_mtu){
-                        log_info("Remote MTU %u > max storable ERTM packet, only using MTU = %u", channel->remote_mtu, usable_mtu);
-                        channel->remote_mtu = usable_mtu;
+                        log_info("Remote MTU %u > max storable ERTM packet, only using MTU = %u", channel->remote_mtu, (int) usable_mtu);
+                        channel->remote_mtu = (uint16_t) usable_mtu;
                     }
                 }
 #endif
@@ -3682,6 +4378,7 @@ static void l2cap_handle_information_request_complete(hci_connection_t * connect
         l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
         if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
         if (channel->con_handle != connection->con_handle) continue;
+        l2cap_trigger_run_for_channel(channel);
 
         // incoming connection: information request was triggered after user has accepted connection,
         // now: verify channel configuration, esp. if ertm will be mandatory
@@ -4043,7 +4740,7 @@ static void l2cap_ecbm_handle_security_level_incoming(l2cap_channel_t * channel)
             channel->state = L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT;
         } else {
             btstack_linked_list_iterator_remove(&it);
-            btstack_memory_l2cap_channel_free(channel);
+            l2cap_free_channel_entry(channel);
         }
     }
 
@@ -4069,6 +4766,7 @@ void l2cap_ecbm_trigger_pending_connection_responses(hci_con_handle_t con_handle
             if (channel->channel_type != L2CAP_CHANNEL_TYPE_CHANNEL_ECBM) continue;
             if (channel->con_handle != con_handle) continue;
             if  (channel->state == L2CAP_STATE_WAIT_INCOMING_SECURITY_LEVEL_UPDATE) {
+                l2cap_trigger_run_for_channel(channel);
                 l2cap_ecbm_handle_security_level_incoming(channel);
                 done = false;
             };
@@ -4204,6 +4902,7 @@ static int l2cap_ecbm_signaling_handler_dispatch(hci_con_handle_t handle, uint16
                     channel->reason = result;
 
                     btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
+                    l2cap_trigger_run_for_channel(channel);
 
                     a_channel = channel;
                 }
@@ -4270,11 +4969,13 @@ static int l2cap_ecbm_signaling_handler_dispatch(hci_con_handle_t handle, uint16
                             channel->remote_mtu = new_mtu;
                             channel->remote_mps = new_mps;
                             channel->credits_outgoing = initial_credits;
+                            l2cap_trigger_run_for_channel(channel);
                             l2cap_ecbm_emit_channel_opened(channel, ERROR_CODE_SUCCESS);
                             continue;
                         }
                         // close original channel
                         original_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                        l2cap_trigger_run_for_channel(original_channel);
                         channel_status = ERROR_CODE_ACL_CONNECTION_ALREADY_EXISTS;
                     }
                 }
@@ -4282,7 +4983,7 @@ static int l2cap_ecbm_signaling_handler_dispatch(hci_con_handle_t handle, uint16
                 l2cap_ecbm_emit_channel_opened(channel, channel_status);
                 // drop failed channel
                 btstack_linked_list_iterator_remove(&it);
-                btstack_memory_l2cap_channel_free(channel);
+                l2cap_free_channel_entry(channel);
             }
             return 1;
 
@@ -4373,6 +5074,7 @@ static int l2cap_ecbm_signaling_handler_dispatch(hci_con_handle_t handle, uint16
                     channel->local_mtu = channel->renegotiate_mtu;
                 }
                 channel->state = L2CAP_STATE_OPEN;
+                l2cap_trigger_run_for_channel(channel);
                 // emit event
                 l2cap_ecbm_emit_reconfigure_complete(channel, result);
             }
@@ -4636,6 +5338,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
             channel->remote_mps = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 4);
             channel->credits_outgoing = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 6);
             channel->state = L2CAP_STATE_OPEN;
+            l2cap_trigger_run_for_channel(channel);
             l2cap_cbm_emit_channel_opened(channel, ERROR_CODE_SUCCESS);
             break;
 #endif
@@ -4658,6 +5361,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
             }
             channel->remote_sig_id = sig_id;
             channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_RESPONSE;
+            l2cap_trigger_run_for_channel(channel);
             break;
 
         case DISCONNECTION_RESPONSE:
@@ -4701,9 +5405,10 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
     if (l2cap_channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
 
         int fcs_size = l2cap_channel->fcs_active ? 2 : 0;
+        uint16_t control_size = l2cap_ertm_control_field_size(l2cap_channel);
 
         // assert control + FCS fields are inside
-        if (size < COMPLETE_L2CAP_HEADER+2+fcs_size) return;
+        if (size < COMPLETE_L2CAP_HEADER+control_size+fcs_size) return;
 
         if (fcs_size > 0){
             // verify FCS (required if one side requested it)
@@ -4729,10 +5434,19 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             }
         }
 
-        // switch on packet type
-        uint16_t control = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
-        uint8_t  req_seq = (control >> 8) & 0x3f;
-        int final = (control >> 7) & 0x01;
+        // get common fields from Enhanced or Extended Control Field
+        uint32_t control;
+        uint16_t req_seq;
+        int final;
+        if (l2cap_channel->extended_control){
+            control = little_endian_read_32(packet, COMPLETE_L2CAP_HEADER);
+            req_seq = (control >> 2) & 0x3fff;
+            final   = (control >> 1) & 0x01;
+        } else {
+            control = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
+            req_seq = (control >> 8) & 0x3f;
+            final   = (control >> 7) & 0x01;
+        }
 
         // WAIT_F -> XMIT on receive packet with F=1
         if (final) {
@@ -4741,9 +5455,16 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
 
         if (control & 1){
             // S-Frame
-            int poll  = (control >> 4) & 0x01;
-            l2cap_supervisory_function_t s = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
-            log_info("Control: 0x%04x => Supervisory function %u, ReqSeq %02u", control, (int) s, req_seq);
+            int poll;
+            l2cap_supervisory_function_t s;
+            if (l2cap_channel->extended_control){
+                poll = (control >> 18) & 0x01;
+                s = (l2cap_supervisory_function_t) ((control >> 16) & 0x03);
+            } else {
+                poll = (control >> 4) & 0x01;
+                s = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
+            }
+            log_info("Control: 0x%04x => Supervisory function %u, ReqSeq %02u", (int) control, (int) s, req_seq);
             l2cap_ertm_tx_packet_state_t * tx_state;
             switch (s){
                 case L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY:
@@ -4759,11 +5480,7 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
                         int i;
                         int num_stored_out_of_order_packets = 0;
                         for (i=0;i<l2cap_channel->num_rx_buffers;i++){
-                            int index = l2cap_channel->rx_store_index + i;
-                            if (index >= l2cap_channel->num_rx_buffers){
-                                index -= l2cap_channel->num_rx_buffers;
-                            }
-                            l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
+                            l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[i];
                             if (!rx_state->valid) continue;
                             num_stored_out_of_order_packets++;
                         }
@@ -4816,9 +5533,16 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
         } else {
             // I-Frame
             // get control
-            l2cap_segmentation_and_reassembly_t sar = (l2cap_segmentation_and_reassembly_t) (control >> 14);
-            uint8_t tx_seq = (control >> 1) & 0x3f;
-            log_info("Control: 0x%04x => SAR %u, ReqSeq %02u, R?, TxSeq %02u", control, (int) sar, req_seq, tx_seq);
+            l2cap_segmentation_and_reassembly_t sar;
+            uint16_t tx_seq;
+            if (l2cap_channel->extended_control){
+                sar    = (l2cap_segmentation_and_reassembly_t) ((control >> 16) & 0x03);
+                tx_seq = (control >> 18) & 0x3fff;
+            } else {
+                sar    = (l2cap_segmentation_and_reassembly_t) ((control >> 14) & 0x03);
+                tx_seq = (control >> 1) & 0x3f;
+            }
+            log_info("Control: 0x%04x => SAR %u, ReqSeq %02u, R?, TxSeq %02u", (int) control, (int) sar, req_seq, tx_seq);
             log_info("SAR: pos %u", l2cap_channel->reassembly_pos);
             log_info("State: expected_tx_seq %02u, req_seq %02u", l2cap_channel->expected_tx_seq, l2cap_channel->req_seq);
             l2cap_ertm_process_req_seq(l2cap_channel, req_seq);
@@ -4828,8 +5552,8 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             }
 
             // get SDU
-            const uint8_t * payload_data = &packet[COMPLETE_L2CAP_HEADER+2];
-            uint16_t        payload_len  = size-(COMPLETE_L2CAP_HEADER+2+fcs_size);
+            const uint8_t * payload_data = &packet[COMPLETE_L2CAP_HEADER+control_size];
+            uint16_t        payload_len  = size-(COMPLETE_L2CAP_HEADER+control_size+fcs_size);
 
             // assert SDU size is smaller or equal to our buffers
             uint16_t max_payload_size = 0;
@@ -4853,50 +5577,53 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             }
 
             // check ordering
-            if (l2cap_channel->expected_tx_seq == tx_seq){
+            uint16_t mask  = l2cap_ertm_seq_nr_mask(l2cap_channel);
+            uint16_t delta = (tx_seq - l2cap_channel->expected_tx_seq) & mask;
+            if (delta == 0){
                 log_info("Received expected frame with TxSeq == ExpectedTxSeq == %02u", tx_seq);
-                l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
-                l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+                l2cap_ertm_rx_packet_state_t * rx_state = l2cap_ertm_get_rx_state(l2cap_channel, 0, NULL);
+                rx_state->valid = 0;
+                l2cap_channel->reject_sent = 0;
 
-                // process SDU
+                // process SDU in place
                 l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, sar, payload_data, payload_len);
 
                 // process stored segments
                 while (true){
-                    int index = l2cap_channel->rx_store_index;
-                    l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
+                    // update expected tx seq and rx store index
+                    l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->expected_tx_seq);
+                    l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+                    l2cap_channel->rx_store_index++;
+                    if (l2cap_channel->rx_store_index >= l2cap_channel->num_rx_buffers){
+                        l2cap_channel->rx_store_index = 0;
+                    }
+
+                    uint8_t * rx_buffer;
+                    rx_state = l2cap_ertm_get_rx_state(l2cap_channel, 0, &rx_buffer);
                     if (!rx_state->valid) break;
 
                     log_info("Processing stored frame with TxSeq == ExpectedTxSeq == %02u", l2cap_channel->expected_tx_seq);
-                    l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
-                    l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
-
                     rx_state->valid = 0;
-                    l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, &l2cap_channel->rx_packets_data[index], rx_state->len);
-
-                    // update rx store index
-                    index++;
-                    if (index >= l2cap_channel->num_rx_buffers){
-                        index = 0;
-                    }
-                    l2cap_channel->rx_store_index = index;
+                    l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, rx_buffer, rx_state->len);
                 }
 
                 //
                 l2cap_channel->send_supervisor_frame_receiver_ready = 1;
 
-            } else {
-                int delta = (tx_seq - l2cap_channel->expected_tx_seq) & 0x3f;
-                if (delta < 2){
-                    // store segment
-                    l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, payload_data, payload_len);
-
-                    log_info("Received unexpected frame TxSeq %u but expected %u -> send S-SREJ", tx_seq, l2cap_channel->expected_tx_seq);
-                    l2cap_channel->send_supervisor_frame_selective_reject = 1;
-                } else {
-                    log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
-                    l2cap_channel->send_supervisor_frame_reject = 1;
+            } else if (delta < l2cap_ertm_rx_window_size(l2cap_channel)){
+                // store segment and request missing frames selectively
+                l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, payload_data, payload_len);
+                uint16_t end_delta = (l2cap_channel->srej_end_tx_seq - l2cap_channel->expected_tx_seq) & mask;
+                if ((end_delta > l2cap_ertm_rx_window_size(l2cap_channel)) || (delta >= end_delta)){
+                    l2cap_channel->srej_end_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, tx_seq);
                 }
+                log_info("Received unexpected frame TxSeq %u but expected %u -> send S-SREJ", tx_seq, l2cap_channel->expected_tx_seq);
+            } else if (((l2cap_channel->expected_tx_seq - tx_seq) & mask) <= l2cap_ertm_rx_window_size(l2cap_channel)){
+                log_info("Received duplicate frame TxSeq %u, expected %u -> ignore", tx_seq, l2cap_channel->expected_tx_seq);
+            } else if (l2cap_channel->reject_sent == 0u){
+                log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
+                l2cap_channel->reject_sent = 1;
+                l2cap_channel->send_supervisor_frame_reject = 1;
             }
         }
         return;
@@ -4969,6 +5696,7 @@ static void l2cap_acl_classic_handler(hci_con_handle_t handle, uint8_t *packet,
             // Find channel for this channel_id and connection handle
             l2cap_channel = l2cap_get_channel_for_local_cid_and_handle(channel_id, handle);
             if (l2cap_channel != NULL){
+                l2cap_trigger_run_for_channel(l2cap_channel);
                 l2cap_acl_classic_handler_for_channel(l2cap_channel, packet, size);
             }
             break;
@@ -5025,6 +5753,7 @@ static void l2cap_acl_le_handler(hci_con_handle_t handle, uint8_t *packet, uint1
 #ifdef ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
             l2cap_channel = l2cap_get_channel_for_local_cid_and_handle(channel_id, handle);
             if (l2cap_channel != NULL) {
+                l2cap_trigger_run_for_channel(l2cap_channel);
                 l2cap_credit_based_handle_pdu(l2cap_channel, packet, size);
             }
 #endif
@@ -5216,6 +5945,8 @@ static uint8_t l2cap_credit_based_send_data(l2cap_channel_t * channel, const uin
     channel->send_sdu_buffer = data;
     channel->send_sdu_len    = size;
     channel->send_sdu_pos    = 0;
+    l2cap_channel_mark_send_request(channel);
+    l2cap_send_queue_add(channel);
 
     l2cap_notify_channel_can_send();
     return ERROR_CODE_SUCCESS;
@@ -5249,6 +5980,7 @@ static uint8_t l2cap_credit_based_provide_credits(uint16_t local_cid, uint16_t c
     channel->new_credits_incoming += credits;
 
     // go
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
     return ERROR_CODE_SUCCESS;
 }
@@ -5263,6 +5995,79 @@ static void l2cap_credit_based_send_credits(l2cap_channel_t *channel) {
     l2cap_send_general_signaling_packet(channel->con_handle, signaling_cid, L2CAP_FLOW_CONTROL_CREDIT_INDICATION, channel->local_sig_id, channel->local_cid, new_credits);
 }
 
+// MARK: adaptive automatic credits
+
+static uint16_t l2cap_credit_based_initial_credits(l2cap_channel_t * channel, uint16_t initial_credits){
+    if (channel->automatic_credits){
+        // incoming rate unknown, start with max window
+        channel->automatic_credits_window = (uint16_t) btstack_min(L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL,
+                                                                   L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_MAX);
+        return L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL;
+    }
+    return initial_credits;
+}
+
+static uint32_t l2cap_credit_based_connection_interval_ms(l2cap_channel_t * channel){
+#ifdef ENABLE_BLE
+    if (channel->address_type != BD_ADDR_TYPE_ACL){
+        hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+        if ((connection != NULL) && (connection->le_connection_interval > 0u)){
+            // connection interval in 1.25 ms units
+            return ((uint32_t) connection->le_connection_interval * 5u + 3u) / 4u;
+        }
+    }
+#else
+    UNUSED(channel);
+#endif
+    return L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_CLASSIC_INTERVAL_MS;
+}
+
+// measure incoming PDUs per second, follow increase immediately and decrease slowly
+static void l2cap_credit_based_automatic_credits_update_rate(l2cap_channel_t * channel){
+    uint32_t now = btstack_run_loop_get_time_ms();
+    if (channel->automatic_credits_num_pdus == 0u){
+        channel->automatic_credits_start_ms = now;
+    }
+    channel->automatic_credits_num_pdus++;
+    uint32_t elapsed_ms = now - channel->automatic_credits_start_ms;
+    if (elapsed_ms < L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_RATE_PERIOD_MS) return;
+    uint32_t rate = ((uint32_t) channel->automatic_credits_num_pdus * 1000u) / elapsed_ms;
+    if (rate < channel->automatic_credits_rate){
+        rate = (rate + 3u * channel->automatic_credits_rate) / 4u;
+    }
+    channel->automatic_credits_rate = (uint16_t) btstack_min(rate, 0xffffu);
+    channel->automatic_credits_num_pdus = 0;
+}
+
+// credits needed until new credits reach the remote and it can use them
+static uint16_t l2cap_credit_based_automatic_credits_window(l2cap_channel_t * channel){
+    // keep window until first measurement is complete
+    if (channel->automatic_credits_rate == 0u) return channel->automatic_credits_window;
+    uint32_t window_ms = L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INTERVALS * l2cap_credit_based_connection_interval_ms(channel);
+    uint32_t window = ((uint32_t) channel->automatic_credits_rate * window_ms + 999u) / 1000u;
+    window = btstack_min(window, L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_MAX);
+    // allow to receive a complete SDU without waiting for credits
+    uint32_t pdus_per_sdu = 1;
+    if (channel->local_mps > 0u){
+        pdus_per_sdu = btstack_max(1u, ((uint32_t) channel->local_mtu + 2u + channel->local_mps - 1u) / channel->local_mps);
+    }
+    window = btstack_max(window, pdus_per_sdu);
+    window = btstack_max(window, L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_WATERMARK + L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INCREMENT);
+    return (uint16_t) btstack_min(window, 0xffffu);
+}
+
+// provide credits to fill window if less than half of window is left
+static void l2cap_credit_based_automatic_credits(l2cap_channel_t * channel){
+    l2cap_credit_based_automatic_credits_update_rate(channel);
+    uint32_t credits = (uint32_t) channel->credits_incoming + channel->new_credits_incoming;
+    if (credits >= L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_WATERMARK){
+        if (credits >= (channel->automatic_credits_window / 2u)) return;
+    }
+    channel->automatic_credits_window = l2cap_credit_based_automatic_credits_window(channel);
+    if (credits >= channel->automatic_credits_window) return;
+    channel->new_credits_incoming += (uint16_t) (channel->automatic_credits_window - credits);
+}
+
 // @return valid
 static bool l2cap_credit_based_handle_credit_indication(hci_con_handle_t handle, const uint8_t * command, uint16_t len){
     // check size
@@ -5275,6 +6080,7 @@ static bool l2cap_credit_based_handle_credit_indication(hci_con_handle_t handle,
         log_error("credit: no channel for handle 0x%04x/cid 0x%02x", handle, remote_cid);
         return true;
     }
+    l2cap_trigger_run_for_channel(channel);
     uint16_t new_credits = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 2);
     uint16_t credits_before = channel->credits_outgoing;
     channel->credits_outgoing += new_credits;
@@ -5302,12 +6108,13 @@ static void l2cap_credit_based_handle_pdu(l2cap_channel_t * l2cap_channel, const
     l2cap_channel->credits_incoming--;
 
     // automatic credits
-    if ((l2cap_channel->credits_incoming < L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_WATERMARK) && l2cap_channel->automatic_credits){
-        l2cap_channel->new_credits_incoming = L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INCREMENT;
+    if (l2cap_channel->automatic_credits){
+        l2cap_credit_based_automatic_credits(l2cap_channel);
     }
 
     // first fragment
     uint16_t pos = 0;
+    bool first_fragment = false;
     if (!l2cap_channel->receive_sdu_len){
         if (size < (COMPLETE_L2CAP_HEADER + 2)) return;
         uint16_t sdu_len = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
@@ -5320,6 +6127,7 @@ static void l2cap_credit_based_handle_pdu(l2cap_channel_t * l2cap_channel, const
         l2cap_channel->receive_sdu_pos = 0;
         pos  += 2u;
         size -= 2u;
+        first_fragment = true;
     }
 
     uint16_t fragment_size   = size-COMPLETE_L2CAP_HEADER;
@@ -5338,7 +6146,17 @@ static void l2cap_credit_based_handle_pdu(l2cap_channel_t * l2cap_channel, const
         return;
     }
 
-    (void)memcpy(&l2cap_channel->receive_sdu_buffer[l2cap_channel->receive_sdu_pos],
+    if (first_fragment){
+        // complete SDU in single PDU -> dispatch in place
+        if (fragment_size == l2cap_channel->receive_sdu_len){
+            l2cap_channel->receive_sdu_len = 0;
+            l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, (uint8_t *) &packet[COMPLETE_L2CAP_HEADER + pos], fragment_size);
+            return;
+        }
+        l2cap_channel->receive_sdu_target = l2cap_receive_buffer_for_sdu(l2cap_channel, l2cap_channel->receive_sdu_len, l2cap_channel->receive_sdu_buffer);
+    }
+
+    (void)memcpy(&l2cap_channel->receive_sdu_target[l2cap_channel->receive_sdu_pos],
                  &packet[COMPLETE_L2CAP_HEADER + pos],
                  fragment_size);
     l2cap_channel->receive_sdu_pos += fragment_size;
@@ -5346,8 +6164,9 @@ static void l2cap_credit_based_handle_pdu(l2cap_channel_t * l2cap_channel, const
     // done?
     log_debug("le packet pos %u, len %u", l2cap_channel->receive_sdu_pos, l2cap_channel->receive_sdu_len);
     if (l2cap_channel->receive_sdu_pos >= l2cap_channel->receive_sdu_len){
-        l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, l2cap_channel->receive_sdu_buffer, l2cap_channel->receive_sdu_len);
+        l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, l2cap_channel->receive_sdu_target, l2cap_channel->receive_sdu_len);
         l2cap_channel->receive_sdu_len = 0;
+        l2cap_channel->receive_sdu_target = NULL;
     }
 }
 
@@ -5477,10 +6296,11 @@ uint8_t l2cap_cbm_accept_connection(uint16_t local_cid, uint8_t * receive_sdu_bu
     channel->state = L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT;
     channel->receive_sdu_buffer = receive_sdu_buffer;
     channel->local_mtu = mtu;
-    channel->new_credits_incoming = initial_credits;
     channel->automatic_credits  = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
+    channel->new_credits_incoming = l2cap_credit_based_initial_credits(channel, initial_credits);
 
     // go
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
     return ERROR_CODE_SUCCESS;
 }
@@ -5498,6 +6318,7 @@ uint8_t l2cap_cbm_decline_connection(uint16_t local_cid, uint16_t result) {
     // set state decline connection
     channel->state  = L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_DECLINE;
     channel->reason = result;
+    l2cap_trigger_run_for_channel(channel);
     l2cap_run();
     return ERROR_CODE_SUCCESS;
 }
@@ -5538,6 +6359,7 @@ static void l2cap_cbm_sm_packet_handler(uint8_t packet_type, uint16_t channel_nr
         } else {
             // send conn request now
             channel->state = L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST;
+            l2cap_trigger_run_for_channel(channel);
             l2cap_run();
         }
     }
@@ -5572,8 +6394,8 @@ uint8_t l2cap_cbm_create_channel(btstack_packet_handler_t packet_handler, hci_co
     // setup channel entry
     channel->con_handle = con_handle;
     channel->receive_sdu_buffer = receive_sdu_buffer;
-    channel->new_credits_incoming = initial_credits;
     channel->automatic_credits    = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
+    channel->new_credits_incoming = l2cap_credit_based_initial_credits(channel, initial_credits);
 
     // add to connections list
     btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
@@ -5688,8 +6510,8 @@ uint8_t l2cap_ecbm_create_channels(btstack_packet_handler_t packet_handler, hci_
         channel->local_mps = local_mps;
         channel->cid_index = i;
         channel->num_cids = num_channels;
-        channel->credits_incoming   = initial_credits;
         channel->automatic_credits  = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
+        channel->credits_incoming   = l2cap_credit_based_initial_credits(channel, initial_credits);
         channel->receive_sdu_buffer = receive_sdu_buffers[i];
         // store local_cid
         if (out_local_cid){
@@ -5754,8 +6576,8 @@ uint8_t l2cap_ecbm_accept_channels(uint16_t local_cid, uint8_t num_channels, uin
             channel->receive_sdu_buffer = receive_buffers[channel_index];
             channel->local_mtu = receive_buffer_size;
             channel->local_mps = local_mps;
-            channel->credits_incoming   = initial_credits;
             channel->automatic_credits  = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
+            channel->credits_incoming   = l2cap_credit_based_initial_credits(channel, initial_credits);
             channel_index++;
         } else {
             // clear local cid for response packet
@@ -5764,6 +6586,7 @@ uint8_t l2cap_ecbm_accept_channels(uint16_t local_cid, uint8_t num_channels, uin
         }
         // update state
         channel->state = L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE;
+        l2cap_trigger_run_for_channel(channel);
     }
     l2cap_run_trigger();
     return ERROR_CODE_SUCCESS;
@@ -5790,6 +6613,7 @@ uint8_t l2cap_ecbm_decline_channels(uint16_t local_cid, uint16_t result){
         channel->local_cid = 0;
         channel->reason = result;
         channel->state = L2CAP_STATE_WILL_SEND_ENHANCED_CONNECTION_RESPONSE;
+        l2cap_trigger_run_for_channel(channel);
     }
     l2cap_run_trigger();
     return ERROR_CODE_SUCCESS;
@@ -5830,6 +6654,7 @@ uint8_t l2cap_ecbm_reconfigure_channels(uint8_t num_cids, uint16_t * local_cids,
         channel->renegotiate_mtu = receive_buffer_size;
         channel->renegotiate_sdu_buffer = receive_buffers[i];
         channel->state = L2CAP_STATE_WILL_SEND_EHNANCED_RENEGOTIATION_REQUEST;
+        l2cap_trigger_run_for_channel(channel);
     }
 
 
@@ -6002,7 +6827,7 @@ void l2cap_free_channels_fuzz(void){
         }
         if (fixed_channel == false) {
             btstack_linked_list_iterator_remove(&it);
-            btstack_memory_l2cap_channel_free(channel);
+            l2cap_free_channel_entry(channel);
         }
     }
 }
@@ -6023,4 +6848,12 @@ l2cap_channel_t * l2cap_get_dynamic_channel_fuzz(void){
     }
     return NULL;
 }
+
+uint32_t l2cap_get_channel_visits_fuzz(void){
+#ifdef L2CAP_USES_CHANNELS
+    return l2cap_channel_visits;
+#else
+    return 0;
+#endif
+}
 #endif
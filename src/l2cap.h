@@ -71,6 +71,7 @@ extern "C" {
 #define MAX_NR_L2CAP_UNKNOWN_OPTIONS 3
 #endif
 
+// automatic credits: adaptive credit window requires L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL in btstack_config.h
 #define L2CAP_LE_AUTOMATIC_CREDITS 0xffff
 
 // private structs
@@ -134,6 +135,15 @@ typedef enum {
     L2CAP_CHANNEL_TYPE_CHANNEL_ECBM     // Classic + LE
 } l2cap_channel_type_t;
 
+// membership of channel in the pending work queue of l2cap_run
+typedef enum {
+    L2CAP_CHANNEL_RUN_STATE_IDLE = 0,   // no outstanding work, not queued
+    L2CAP_CHANNEL_RUN_STATE_PENDING,    // queued for next pass of l2cap_run
+    L2CAP_CHANNEL_RUN_STATE_ACTIVE,     // currently visited by l2cap_run
+    L2CAP_CHANNEL_RUN_STATE_RETRIGGERED,// triggered again while visited
+    L2CAP_CHANNEL_RUN_STATE_BLOCKED,    // work left, e.g. waiting for outgoing buffer
+} l2cap_channel_run_state_t;
+
 
 /*
  * @brief L2CAP Segmentation And Reassembly packet type in I-Frames
@@ -160,9 +170,11 @@ typedef struct {
 typedef struct {
     l2cap_segmentation_and_reassembly_t sar;
     uint16_t len;
-    uint8_t tx_seq;
+    uint16_t tx_seq;
     uint8_t retry_count;
     l2cap_ertm_tx_state_t tx_state;
+    // position of fragment in tx ring buffer
+    uint32_t offset;
 } l2cap_ertm_tx_packet_state_t;
 
 typedef struct {
@@ -182,16 +194,42 @@ typedef struct {
     uint16_t local_mtu;
 
     // Number of buffers for outgoing data
-    uint8_t num_tx_buffers;
+    uint16_t num_tx_buffers;
 
     // Number of packets that can be received out of order (-> our tx_window size)
-    uint8_t num_rx_buffers;
+    // Advertised tx_window is limited to half the sequence number space: 32 without and 8192 with Extended Window Size option.
+    // Values > 63 require the Extended Window Size option, which is only used if supported by remote
+    uint16_t num_rx_buffers;
 
     // Frame Check Sequence (FCS) Option
     uint8_t fcs_option;
 
 } l2cap_ertm_config_t;
 
+// outgoing scheduler statistics
+typedef struct {
+    // number of times the channel was allowed to send
+    uint32_t num_packets;
+    // time between send request and channel being allowed to send
+    uint32_t wait_time_total_ms;
+    uint32_t wait_time_max_ms;
+} l2cap_send_statistics_t;
+
+/**
+ * @brief Provide buffer to reassemble incoming SDU into
+ * @param local_cid
+ * @param sdu_len of incoming SDU
+ * @return buffer of at least sdu_len bytes or NULL to use buffer provided when channel was created
+ */
+typedef uint8_t * (*l2cap_receive_buffer_provider_t)(uint16_t local_cid, uint16_t sdu_len);
+
+/**
+ * @brief Return buffer from l2cap_receive_buffer_provider_t that did not receive a complete SDU
+ * @param local_cid
+ * @param buffer
+ */
+typedef void (*l2cap_receive_buffer_release_t)(uint16_t local_cid, uint8_t * buffer);
+
 // info regarding an actual channel
 // note: l2cap_fixed_channel and l2cap_channel_t share commmon fields
 
@@ -211,11 +249,22 @@ typedef struct l2cap_fixed_channel {
     // send request
     uint8_t waiting_for_can_send_now;
 
+    // outgoing scheduler
+    uint8_t  send_priority;
+    uint8_t  send_weight;
+    uint8_t  send_deficit;
+    uint32_t send_request_ms;
+    l2cap_send_statistics_t send_statistics;
+
+    // queue of channels with pending send requests
+    struct l2cap_channel * send_next;
+    bool     send_queued;
+
     // -- end of shared prefix
 
 } l2cap_fixed_channel_t;
 
-typedef struct {
+typedef struct l2cap_channel {
     // linked list - assert: first field
     btstack_linked_item_t    item;
     
@@ -231,8 +280,23 @@ typedef struct {
     // send request
     uint8_t   waiting_for_can_send_now;
 
+    // outgoing scheduler
+    uint8_t  send_priority;
+    uint8_t  send_weight;
+    uint8_t  send_deficit;
+    uint32_t send_request_ms;
+    l2cap_send_statistics_t send_statistics;
+
+    // queue of channels with pending send requests
+    struct l2cap_channel * send_next;
+    bool     send_queued;
+
     // -- end of shared prefix
 
+    // pending work queue for l2cap_run
+    struct l2cap_channel * run_next;
+    l2cap_channel_run_state_t run_state;
+
     // timer
     btstack_timer_source_t rtx; // also used for ertx
 
@@ -271,6 +335,11 @@ typedef struct {
     uint16_t  receive_sdu_len;
     uint16_t  receive_sdu_pos;
 
+    // incoming SDU: optional provider for per-SDU buffer, current buffer
+    l2cap_receive_buffer_provider_t receive_buffer_provider;
+    l2cap_receive_buffer_release_t  receive_buffer_release;
+    uint8_t * receive_sdu_target;
+
 #ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
     uint8_t * renegotiate_sdu_buffer;
     uint16_t  renegotiate_mtu;
@@ -297,6 +366,12 @@ typedef struct {
     // automatic credits incoming
     bool automatic_credits;
 
+    // automatic credits: current window, incoming PDUs per second, measurement
+    uint16_t automatic_credits_window;
+    uint16_t automatic_credits_rate;
+    uint16_t automatic_credits_num_pdus;
+    uint32_t automatic_credits_start_ms;
+
 #ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
     uint8_t cid_index;
     uint8_t num_cids;
@@ -320,7 +395,7 @@ typedef struct {
     uint16_t remote_retransmission_timeout_ms;
     uint16_t remote_monitor_timeout_ms;
 
-    uint8_t remote_tx_window_size;
+    uint16_t remote_tx_window_size;
 
     uint8_t local_max_transmit;
     uint8_t remote_max_transmit;
@@ -334,26 +409,29 @@ typedef struct {
     // Frame Check Sequence was requested by either side
     bool    fcs_active;
 
+    // Extended Control Field with 14-bit sequence numbers is used, set if Extended Window Size option was sent by either side
+    bool    extended_control;
+
     // sender: max num of stored outgoing frames
-    uint8_t num_tx_buffers;
+    uint16_t num_tx_buffers;
 
     // sender: num stored outgoing frames
-    uint8_t num_stored_tx_frames;
+    uint16_t num_stored_tx_frames;
 
     // sender: number of unacknowledeged I-Frames - frames have been sent, but not acknowledged yet
-    uint8_t unacked_frames;
+    uint16_t unacked_frames;
 
     // sender: buffer index of oldest packet
-    uint8_t tx_read_index;
+    uint16_t tx_read_index;
 
     // sender: buffer index to store next tx packet
-    uint8_t tx_write_index;
+    uint16_t tx_write_index;
 
     // sender: buffer index of packet to send next
-    uint8_t tx_send_index;
+    uint16_t tx_send_index;
 
     // sender: next seq nr used for sending
-    uint8_t next_tx_seq;
+    uint16_t next_tx_seq;
 
     // sender: selective retransmission requested
     uint8_t srej_active;
@@ -364,16 +442,25 @@ typedef struct {
     bool tx_wait_for_final;
 
     // receiver: max num out-of-order packets // tx_window
-    uint8_t num_rx_buffers;
+    uint16_t num_rx_buffers;
 
     // receiver: buffer index of to store packet with delta = 1
-    uint8_t rx_store_index;
+    uint16_t rx_store_index;
 
     // receiver: value of tx_seq in next expected i-frame
-    uint8_t expected_tx_seq;
+    uint16_t expected_tx_seq;
 
     // receiver: request transmission with tx_seq = req_seq and ack up to and including req_seq
-    uint8_t req_seq;
+    uint16_t req_seq;
+
+    // receiver: tx_seq of next missing frame to check for sending SREJ
+    uint16_t srej_tx_seq;
+
+    // receiver: tx_seq following the latest frame received out of order, missing frames before are requested by SREJ
+    uint16_t srej_end_tx_seq;
+
+    // receiver: REJ was sent, further out-of-sequence frames are ignored until ExpectedTxSeq is received
+    uint8_t reject_sent;
 
     // receiver: local busy condition
     uint8_t local_busy;
@@ -414,9 +501,18 @@ typedef struct {
     // receiver: num_rx_buffers of size local_mps
     uint8_t * rx_packets_data;
 
-    // sender: num_tx_buffers of size local_mps
+    // sender: ring buffer for outgoing SDUs, fragments refer to it by offset
     uint8_t * tx_packets_data;
 
+    // sender: size of tx ring buffer
+    uint32_t tx_ring_size;
+
+    // sender: bytes used by stored frames
+    uint32_t tx_ring_used;
+
+    // sender: position to store next SDU
+    uint32_t tx_ring_write_pos;
+
 #endif    
 } l2cap_channel_t;
 
@@ -451,6 +547,23 @@ typedef struct l2cap_signaling_response {
     uint16_t data; // infoType for INFORMATION REQUEST, result for CONNECTION REQUEST and COMMAND UNKNOWN
 } l2cap_signaling_response_t;
 
+// outgoing scheduler, decides which channel may use the outgoing packet buffer next
+typedef struct {
+    /**
+     * @brief Select channel that is allowed to send next
+     * @param channels with pending send requests linked via send_next, newly active channels first, channels moved to the end by l2cap_scheduler_default. Fixed channels are included, only the shared prefix can be used for them
+     * @param ready_to_send returns true if channel has data to send and a packet can be sent now
+     * @return channel or NULL if no channel is ready to send
+     */
+    l2cap_channel_t * (*select_channel)(l2cap_channel_t * channels, bool (*ready_to_send)(l2cap_channel_t * channel));
+
+    /**
+     * @brief Selected channel is about to send
+     * @param channel
+     */
+    void (*channel_served)(l2cap_channel_t * channel);
+} l2cap_scheduler_t;
+
 /* API_START */
 
 //
@@ -568,6 +681,46 @@ bool l2cap_can_send_packet_now(uint16_t local_cid);
  */
 uint8_t l2cap_request_can_send_now_event(uint16_t local_cid);
 
+/**
+ * @brief Set scheduler for outgoing packets
+ * @note Default scheduler serves channels with higher priority first, channels with equal priority are served
+ *       round-robin across connections and according to their weight within a connection
+ * @param scheduler or NULL for default scheduler
+ */
+void l2cap_set_scheduler(const l2cap_scheduler_t * scheduler);
+
+/**
+ * @brief Set priority and weight of channel for outgoing scheduler
+ * @param local_cid of dynamic channel or fixed channel id, e.g. L2CAP_CID_ATTRIBUTE_PROTOCOL
+ * @param priority default: 0
+ * @param weight default: 1
+ * @return status
+ */
+uint8_t l2cap_set_send_priority(uint16_t local_cid, uint8_t priority, uint8_t weight);
+
+/**
+ * @brief Get outgoing scheduler statistics for channel
+ * @param local_cid of dynamic channel or fixed channel id
+ * @param statistics
+ * @return status
+ */
+uint8_t l2cap_get_send_statistics(uint16_t local_cid, l2cap_send_statistics_t * statistics);
+
+/**
+ * @brief Register provider for receive buffers. For each incoming SDU that does not fit into a single PDU, the
+ *        provider is asked for a buffer and the SDU is reassembled directly into it. SDUs that fit into a single PDU
+ *        are delivered from the HCI buffer without copy.
+ *        The buffer is owned by the application again when the SDU is delivered as L2CAP_DATA_PACKET. If the SDU is
+ *        aborted, e.g. on disconnect, on a segmentation error or when the next SDU starts before it was completed,
+ *        the buffer is returned via release callback instead.
+ * @note Supported for Enhanced Retransmission Mode and (Enhanced) Credit-Based Flow-Control Mode channels
+ * @param local_cid
+ * @param provider or NULL to reassemble into buffer provided when channel was created
+ * @param release called for buffers of aborted SDUs, can be NULL
+ * @return status
+ */
+uint8_t l2cap_set_receive_buffer_provider(uint16_t local_cid, l2cap_receive_buffer_provider_t provider, l2cap_receive_buffer_release_t release);
+
 /** 
  * @brief Reserve outgoing buffer
  * @note Only for L2CAP Basic Mode Channels
@@ -893,6 +1046,11 @@ void l2cap_require_security_level_2_for_outgoing_sdp(void);
 // Used by RFCOMM - similar to l2cap_can-send_packet_now but does not check if outgoing buffer is reserved
 bool l2cap_can_send_prepared_packet_now(uint16_t local_cid);
 
+#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+// number of channel visits in l2cap_run, used for testing
+uint32_t l2cap_get_channel_visits_fuzz(void);
+#endif
+
 #if defined __cplusplus
 }
 #endif
@@ -133,6 +133,36 @@ static btstack_linked_list_t  application_keys;
 
 static uint8_t mesh_transport_key_used[MAX_NR_MESH_TRANSPORT_KEYS];
 
+// application keys indexed by 6-bit AID, single linked via aid_next in order of addition
+#define MESH_TRANSPORT_KEY_NUM_AIDS 64
+static mesh_transport_key_t * mesh_transport_keys_by_aid[MESH_TRANSPORT_KEY_NUM_AIDS];
+
+static void mesh_transport_key_aid_index_remove(mesh_transport_key_t * transport_key){
+    // AID might have changed since key was added, check all buckets
+    uint8_t aid;
+    for (aid = 0; aid < MESH_TRANSPORT_KEY_NUM_AIDS; aid++){
+        mesh_transport_key_t ** next = &mesh_transport_keys_by_aid[aid];
+        while (*next != NULL){
+            if (*next == transport_key){
+                *next = transport_key->aid_next;
+                transport_key->aid_next = NULL;
+                return;
+            }
+            next = &(*next)->aid_next;
+        }
+    }
+}
+
+static void mesh_transport_key_aid_index_add(mesh_transport_key_t * transport_key){
+    mesh_transport_key_aid_index_remove(transport_key);
+    mesh_transport_key_t ** next = &mesh_transport_keys_by_aid[transport_key->aid & 0x3f];
+    while (*next != NULL){
+        next = &(*next)->aid_next;
+    }
+    transport_key->aid_next = NULL;
+    *next = transport_key;
+}
+
 void mesh_transport_set_device_key(const uint8_t * device_key){
     mesh_transport_device_key.appkey_index = MESH_DEVICE_KEY_INDEX;
     mesh_transport_device_key.aid   = 0;
@@ -159,10 +189,12 @@ uint16_t mesh_transport_key_get_free_index(void){
 void mesh_transport_key_add(mesh_transport_key_t * transport_key){
     mesh_transport_key_used[transport_key->internal_index] = 1;
     btstack_linked_list_add_tail(&application_keys, (btstack_linked_item_t *) transport_key);
+    mesh_transport_key_aid_index_add(transport_key);
 }
 
 bool mesh_transport_key_remove(mesh_transport_key_t * transport_key){
     mesh_transport_key_used[transport_key->internal_index] = 0;
+    mesh_transport_key_aid_index_remove(transport_key);
     return btstack_linked_list_remove(&application_keys, (btstack_linked_item_t *) transport_key);
 }
 
@@ -204,12 +236,11 @@ mesh_transport_key_t * mesh_transport_key_iterator_get_next(mesh_transport_key_i
 
 void
 mesh_transport_key_aid_iterator_init(mesh_transport_key_iterator_t *it, uint16_t netkey_index, uint8_t akf, uint8_t aid) {
-    btstack_linked_list_iterator_init(&it->it, &application_keys);
     it->netkey_index = netkey_index;
     it->aid      = aid;
     it->akf      = akf;
     if (it->akf){
-        it->key = NULL;
+        it->key = mesh_transport_keys_by_aid[aid & 0x3f];
     } else {
         it->key = &mesh_transport_device_key;
     }
@@ -219,17 +250,18 @@ int mesh_transport_key_aid_iterator_has_more(mesh_transport_key_iterator_t *it){
     if (it->akf == 0){
         return it->key != NULL;
     }
-    // find next matching key
-    while (true){
-        if (it->key && it->key->aid == it->aid && it->key->netkey_index == it->netkey_index) return 1;
-        if (!btstack_linked_list_iterator_has_next(&it->it)) break;
-        it->key = (mesh_transport_key_t *) btstack_linked_list_iterator_next(&it->it);
+    // find next key in AID bucket for this subnet
+    while (it->key != NULL){
+        if (it->key->netkey_index == it->netkey_index) return 1;
+        it->key = it->key->aid_next;
     }
     return 0;
 }
 
 mesh_transport_key_t * mesh_transport_key_aid_iterator_get_next(mesh_transport_key_iterator_t *it){
     mesh_transport_key_t * key = it->key;
-    it->key = NULL;
+    if (key == NULL) return NULL;
+    // device key is not part of the AID index
+    it->key = (it->akf != 0) ? key->aid_next : NULL;
     return key;
 }
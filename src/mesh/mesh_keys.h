@@ -88,9 +88,12 @@ typedef struct {
     uint8_t nid;
 } mesh_network_key_iterator_t;
 
-typedef struct {
+typedef struct mesh_transport_key {
     btstack_linked_item_t item;
 
+    // next key with same AID - see mesh_transport_key_aid_iterator
+    struct mesh_transport_key * aid_next;
+
     // internal index [0..MAX_NR_MESH_TRANSPORT_KEYS-1]
     uint16_t internal_index;
 
@@ -271,6 +274,7 @@ mesh_transport_key_t * mesh_transport_key_iterator_get_next(mesh_transport_key_i
 
 /**
  * @brief Transport Key Iterator by AID - init
+ * @note only visits keys with matching AID using the AID index
  * @param it
  * @param netkey_index
  * @param akf
@@ -55,10 +55,28 @@
 
 #define LOG_LOWER_TRANSPORT
 
+// number of transmissions of an outgoing segmented message without progress
+#define MESH_LOWER_TRANSPORT_SEGMENTED_RETRIES 3
+
+// number of destinations for which the round trip time of segment acknowledgments is tracked
+#ifndef MESH_LOWER_TRANSPORT_RTT_CACHE_SIZE
+#define MESH_LOWER_TRANSPORT_RTT_CACHE_SIZE 4
+#endif
+
+typedef struct {
+    uint16_t dst;
+    // smoothed round trip time and its mean deviation, srtt_ms == 0 for unused entry
+    uint16_t srtt_ms;
+    uint16_t rttvar_ms;
+} mesh_lower_transport_rtt_entry_t;
+
 // prototypes
 static void mesh_lower_transport_run(void);
 static void mesh_lower_transport_outgoing_complete(mesh_segmented_pdu_t * segmented_pdu, mesh_transport_status_t status);
 static void mesh_lower_transport_outgoing_segment_transmission_timeout(btstack_timer_source_t * ts);
+static void mesh_lower_transport_outgoing_stop_acknowledgment_timer(mesh_segmented_pdu_t *segmented_pdu);
+static void mesh_lower_transport_rtt_update(uint16_t dst, uint32_t rtt_ms);
+static void mesh_lower_transport_rtt_reset(void);
 
 
 // lower transport outgoing state
@@ -69,10 +87,8 @@ static btstack_linked_list_t lower_transport_outgoing_ready;
 // mesh_segmented_pdu_t to unicast address, segment transmission timer is active
 static btstack_linked_list_t lower_transport_outgoing_waiting;
 
-// active outgoing segmented message
+// active outgoing segmented message. segments of messages in lower_transport_outgoing_ready are interleaved
 static mesh_segmented_pdu_t * lower_transport_outgoing_message;
-// index of outgoing segment
-static uint16_t               lower_transport_outgoing_seg_o;
 // network pdu with outgoing segment
 static mesh_network_pdu_t   * lower_transport_outgoing_segment;
 // segment currently queued at network layer (only valid for lower_transport_outgoing_message)
@@ -87,6 +103,10 @@ static bool                    lower_transport_outgoing_transmission_aborted;
 // active outgoing unsegmented message
 static mesh_network_pdu_t *   lower_transport_outgoing_network_pdu;
 
+// round trip time of segment acknowledgments per destination
+static mesh_lower_transport_rtt_entry_t lower_transport_rtt_cache[MESH_LOWER_TRANSPORT_RTT_CACHE_SIZE];
+static uint8_t                          lower_transport_rtt_cache_next;
+
 // deliver to higher layer
 static void (*higher_layer_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu);
 static mesh_pdu_t * mesh_lower_transport_higher_layer_pdu;
@@ -479,11 +499,45 @@ static void mesh_lower_transport_outgoing_setup_block_ack(mesh_segmented_pdu_t *
     }
 }
 
+static mesh_segmented_pdu_t * mesh_lower_transport_outgoing_message_in_list(btstack_linked_list_t * list, uint16_t dst){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, list);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) continue;
+        mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) pdu;
+        if (segmented_pdu->dst == dst) return segmented_pdu;
+    }
+    return NULL;
+}
+
 static mesh_segmented_pdu_t * mesh_lower_transport_outgoing_message_for_dst(uint16_t dst){
     if (lower_transport_outgoing_message != NULL && lower_transport_outgoing_message->dst == dst){
         return lower_transport_outgoing_message;
     }
-    return NULL;
+    // waiting for ack
+    mesh_segmented_pdu_t * segmented_pdu = mesh_lower_transport_outgoing_message_in_list(&lower_transport_outgoing_waiting, dst);
+    if (segmented_pdu != NULL){
+        return segmented_pdu;
+    }
+    // interleaved with other messages or queued for retransmission
+    return mesh_lower_transport_outgoing_message_in_list(&lower_transport_outgoing_ready, dst);
+}
+
+static uint8_t mesh_lower_transport_outgoing_seg_n(mesh_segmented_pdu_t * segmented_pdu){
+    int ctl = segmented_pdu->ctl_ttl >> 7;
+    uint16_t max_segment_len = ctl ? 8 : 12;    // control 8 bytes (64 bit NetMic), access 12 bytes (32 bit NetMIC)
+    return (segmented_pdu->len - 1) / max_segment_len;
+}
+
+// find next unacknowledged segment starting at seg_o, returns seg_n + 1 if none left
+static uint8_t mesh_lower_transport_outgoing_next_seg_o(mesh_segmented_pdu_t * segmented_pdu){
+    uint8_t seg_n = mesh_lower_transport_outgoing_seg_n(segmented_pdu);
+    uint8_t seg_o = segmented_pdu->seg_o;
+    while ((seg_o <= seg_n) && ((segmented_pdu->block_ack & (1u << seg_o)) == 0)){
+        seg_o++;
+    }
+    return seg_o;
 }
 
 static void mesh_lower_transport_outgoing_process_segment_acknowledgement_message(mesh_network_pdu_t *network_pdu){
@@ -492,7 +546,7 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
 
     uint8_t * lower_transport_pdu     = mesh_network_pdu_data(network_pdu);
     uint16_t seq_zero_pdu = big_endian_read_16(lower_transport_pdu, 1) >> 2;
-    uint16_t seq_zero_out = lower_transport_outgoing_message->seq & 0x1fff;
+    uint16_t seq_zero_out = segmented_pdu->seq & 0x1fff;
     uint32_t block_ack = big_endian_read_32(lower_transport_pdu, 3);
 
 #ifdef LOG_LOWER_TRANSPORT
@@ -523,6 +577,13 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
         return;
     }
 
+    bool progress = (segmented_pdu->block_ack & block_ack) != 0;
+
+    // measure round trip time if all segments have been sent once (Karn's algorithm)
+    if (progress && (segmented_pdu != lower_transport_outgoing_message) && ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_RETRANSMITTED) == 0)){
+        mesh_lower_transport_rtt_update(segmented_pdu->dst, btstack_run_loop_get_time_ms() - segmented_pdu->transmission_time_ms);
+    }
+
     segmented_pdu->block_ack &= ~block_ack;
 #ifdef LOG_LOWER_TRANSPORT
     printf("[+] Updated block_ack %08" PRIx32 "\n", segmented_pdu->block_ack);
@@ -538,6 +599,24 @@ static void mesh_lower_transport_outgoing_process_segment_acknowledgement_messag
         } else {
             mesh_lower_transport_outgoing_complete(segmented_pdu, MESH_TRANSPORT_STATUS_SUCCESS);
         }
+        return;
+    }
+
+    // new segments acknowledged: remote is receiving, reset retries
+    if (progress){
+        segmented_pdu->retry_count = MESH_LOWER_TRANSPORT_SEGMENTED_RETRIES;
+    }
+
+    // all segments sent and acknowledgement reports missing segments: send them now instead of waiting for the
+    // segment transmission timer
+    if (progress && btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu)){
+#ifdef LOG_LOWER_TRANSPORT
+        printf("[+] Retransmit unacknowledged segments now\n");
+#endif
+        mesh_lower_transport_outgoing_stop_acknowledgment_timer(segmented_pdu);
+        segmented_pdu->flags |= MESH_TRANSPORT_FLAG_RETRANSMITTED;
+        segmented_pdu->seg_o = 0;
+        btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
     }
 }
 
@@ -547,12 +626,53 @@ static void mesh_lower_transport_outgoing_stop_acknowledgment_timer(mesh_segment
     btstack_run_loop_remove_timer(&segmented_pdu->acknowledgement_timer);
 }
 
+static mesh_lower_transport_rtt_entry_t * mesh_lower_transport_rtt_find(uint16_t dst){
+    uint8_t i;
+    for (i=0;i<MESH_LOWER_TRANSPORT_RTT_CACHE_SIZE;i++){
+        mesh_lower_transport_rtt_entry_t * entry = &lower_transport_rtt_cache[i];
+        if ((entry->srtt_ms != 0) && (entry->dst == dst)) return entry;
+    }
+    return NULL;
+}
+
+static void mesh_lower_transport_rtt_reset(void){
+    memset(lower_transport_rtt_cache, 0, sizeof(lower_transport_rtt_cache));
+    lower_transport_rtt_cache_next = 0;
+}
+
+// RFC 6298 estimator: alpha = 1/8, beta = 1/4
+static void mesh_lower_transport_rtt_update(uint16_t dst, uint32_t rtt_ms){
+    uint16_t sample_ms = (uint16_t) btstack_max(1, btstack_min(rtt_ms, 0xffff));
+    mesh_lower_transport_rtt_entry_t * entry = mesh_lower_transport_rtt_find(dst);
+    if (entry == NULL){
+        // replace oldest entry
+        entry = &lower_transport_rtt_cache[lower_transport_rtt_cache_next];
+        lower_transport_rtt_cache_next = (lower_transport_rtt_cache_next + 1) % MESH_LOWER_TRANSPORT_RTT_CACHE_SIZE;
+        entry->dst = dst;
+        entry->srtt_ms = sample_ms;
+        entry->rttvar_ms = sample_ms / 2;
+    } else {
+        uint16_t delta_ms = (entry->srtt_ms > sample_ms) ? (entry->srtt_ms - sample_ms) : (sample_ms - entry->srtt_ms);
+        entry->rttvar_ms = (uint16_t) (((3u * entry->rttvar_ms) + delta_ms) / 4u);
+        entry->srtt_ms   = (uint16_t) btstack_max(1, ((7u * entry->srtt_ms) + sample_ms) / 8u);
+    }
+#ifdef LOG_LOWER_TRANSPORT
+    printf("[+] Lower transport, dst %04x: rtt %u ms, srtt %u ms, rttvar %u ms\n", dst, sample_ms, entry->srtt_ms, entry->rttvar_ms);
+#endif
+}
+
 static void mesh_lower_transport_outgoing_restart_segment_transmission_timer(mesh_segmented_pdu_t *segmented_pdu){
     // restart segment transmission timer for unicast dst
     // - "This timer shall be set to a minimum of 200 + 50 * TTL milliseconds."
+    // - use observed round trip time of segment acknowledgments from dst if higher
     uint32_t timeout = 200 + 50 * (segmented_pdu->ctl_ttl & 0x7f);
+    const mesh_lower_transport_rtt_entry_t * entry = mesh_lower_transport_rtt_find(segmented_pdu->dst);
+    if (entry != NULL){
+        timeout = btstack_max(timeout, entry->srtt_ms + (4u * entry->rttvar_ms));
+    }
+    segmented_pdu->transmission_time_ms = btstack_run_loop_get_time_ms();
     if ((segmented_pdu->flags & MESH_TRANSPORT_FLAG_ACK_TIMER) != 0){
-        btstack_run_loop_remove_timer(&lower_transport_outgoing_message->acknowledgement_timer);
+        btstack_run_loop_remove_timer(&segmented_pdu->acknowledgement_timer);
     }
 
 #ifdef LOG_LOWER_TRANSPORT
@@ -562,7 +682,7 @@ static void mesh_lower_transport_outgoing_restart_segment_transmission_timer(mes
 
     btstack_run_loop_set_timer(&segmented_pdu->acknowledgement_timer, timeout);
     btstack_run_loop_set_timer_handler(&segmented_pdu->acknowledgement_timer, &mesh_lower_transport_outgoing_segment_transmission_timeout);
-    btstack_run_loop_set_timer_context(&segmented_pdu->acknowledgement_timer, lower_transport_outgoing_message);
+    btstack_run_loop_set_timer_context(&segmented_pdu->acknowledgement_timer, segmented_pdu);
     btstack_run_loop_add_timer(&segmented_pdu->acknowledgement_timer);
     segmented_pdu->flags |= MESH_TRANSPORT_FLAG_ACK_TIMER;
 }
@@ -623,7 +743,7 @@ static void mesh_lower_transport_outgoing_setup_segment(mesh_segmented_pdu_t *me
     uint16_t lower_transport_pdu_len = 4 + segment_len;
 
     // find network-pdu with chunk for seg_offset
-    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) lower_transport_outgoing_message->segments;
+    mesh_network_pdu_t * chunk = (mesh_network_pdu_t *) message_pdu->segments;
     uint16_t chunk_start = 0;
     while ((chunk_start + MESH_NETWORK_PAYLOAD_MAX) <= seg_offset){
         chunk = (mesh_network_pdu_t *) chunk->pdu_header.item.next;
@@ -653,27 +773,24 @@ static void mesh_lower_transport_outgoing_send_next_segment(void){
            lower_transport_outgoing_message->seq);
 #endif
 
-    int ctl = lower_transport_outgoing_message->ctl_ttl >> 7;
-    uint16_t max_segment_len = ctl ? 8 : 12;    // control 8 bytes (64 bit NetMic), access 12 bytes (32 bit NetMIC)
-    uint8_t  seg_n = (lower_transport_outgoing_message->len - 1) / max_segment_len;
+    uint8_t  seg_n = mesh_lower_transport_outgoing_seg_n(lower_transport_outgoing_message);
 
     // find next unacknowledged segment
-    while ((lower_transport_outgoing_seg_o <= seg_n) && ((lower_transport_outgoing_message->block_ack & (1 << lower_transport_outgoing_seg_o)) == 0)){
-        lower_transport_outgoing_seg_o++;
-    }
+    lower_transport_outgoing_message->seg_o = mesh_lower_transport_outgoing_next_seg_o(lower_transport_outgoing_message);
 
-    if (lower_transport_outgoing_seg_o > seg_n){
+    if (lower_transport_outgoing_message->seg_o > seg_n){
 #ifdef LOG_LOWER_TRANSPORT
         printf("[+] Lower Transport, segmented pdu %p, seq %06" PRIx32 ": send complete (dst %x)\n", lower_transport_outgoing_message,
                lower_transport_outgoing_message->seq,
                lower_transport_outgoing_message->dst);
 #endif
-        lower_transport_outgoing_seg_o   = 0;
+        lower_transport_outgoing_message->seg_o = 0;
 
         // done for unicast, ack timer already set, too
         if (mesh_network_address_unicast(lower_transport_outgoing_message->dst)) {
             btstack_linked_list_add(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) lower_transport_outgoing_message);
             lower_transport_outgoing_message = NULL;
+            mesh_lower_transport_run();
             return;
         }
 
@@ -684,6 +801,7 @@ static void mesh_lower_transport_outgoing_send_next_segment(void){
 #endif
             // notify upper transport
             mesh_lower_transport_outgoing_complete(lower_transport_outgoing_message, MESH_TRANSPORT_STATUS_SUCCESS);
+            mesh_lower_transport_run();
             return;
         }
 
@@ -692,7 +810,7 @@ static void mesh_lower_transport_outgoing_send_next_segment(void){
         printf("[+] Lower Transport, message unacknowledged retry count %u\n", lower_transport_outgoing_message->retry_count);
 #endif
         lower_transport_outgoing_message->retry_count--;
-        btstack_linked_list_add(&lower_transport_outgoing_ready, (btstack_linked_item_t *) lower_transport_outgoing_message);
+        btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) lower_transport_outgoing_message);
         lower_transport_outgoing_message = NULL;
         mesh_lower_transport_run();
         return;
@@ -703,17 +821,17 @@ static void mesh_lower_transport_outgoing_send_next_segment(void){
         mesh_lower_transport_outgoing_restart_segment_transmission_timer(lower_transport_outgoing_message);
     }
 
-    mesh_lower_transport_outgoing_setup_segment(lower_transport_outgoing_message, lower_transport_outgoing_seg_o,
+    mesh_lower_transport_outgoing_setup_segment(lower_transport_outgoing_message, lower_transport_outgoing_message->seg_o,
                                                 lower_transport_outgoing_segment);
 
 #ifdef LOG_LOWER_TRANSPORT
     printf("[+] Lower Transport, segmented pdu %p, seq %06" PRIx32 ": send seg_o %x, seg_n %x\n", lower_transport_outgoing_message,
-           lower_transport_outgoing_message->seq, lower_transport_outgoing_seg_o, seg_n);
+           lower_transport_outgoing_message->seq, lower_transport_outgoing_message->seg_o, seg_n);
     mesh_print_hex("LowerTransportPDU", &lower_transport_outgoing_segment->data[9], lower_transport_outgoing_segment->len-9);
 #endif
 
     // next segment
-    lower_transport_outgoing_seg_o++;
+    lower_transport_outgoing_message->seg_o++;
 
     // send network pdu
     lower_transport_outgoing_segment_at_network_layer = true;
@@ -724,7 +842,7 @@ static void mesh_lower_transport_outgoing_setup_sending_segmented_pdus(mesh_segm
     printf("[+] Lower Transport, segmented pdu %p, seq %06" PRIx32 ": send retry count %u\n", segmented_pdu, segmented_pdu->seq, segmented_pdu->retry_count);
 
     segmented_pdu->retry_count--;
-    lower_transport_outgoing_seg_o   = 0;
+    segmented_pdu->seg_o = 0;
     lower_transport_outgoing_transmission_timeout  = false;
     lower_transport_outgoing_transmission_complete = false;
     lower_transport_outgoing_transmission_aborted  = false;
@@ -750,7 +868,10 @@ static void mesh_lower_transport_outgoing_segment_transmission_fired(mesh_segmen
         lower_transport_outgoing_message = NULL;
     } else {
         btstack_linked_list_remove(&lower_transport_outgoing_waiting, (btstack_linked_item_t *) segmented_pdu);
+        btstack_linked_list_remove(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
     }
+    segmented_pdu->flags |= MESH_TRANSPORT_FLAG_RETRANSMITTED;
+    segmented_pdu->seg_o = 0;
     btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) segmented_pdu);
 
     // continue
@@ -815,6 +936,15 @@ static void mesh_lower_transport_network_pdu_sent(mesh_network_pdu_t *network_pd
             return;
         }
 
+        // interleave segments with other queued messages, e.g. segmented messages to other destinations
+        if (!btstack_linked_list_empty(&lower_transport_outgoing_ready) &&
+            (mesh_lower_transport_outgoing_next_seg_o(lower_transport_outgoing_message) <= mesh_lower_transport_outgoing_seg_n(lower_transport_outgoing_message))){
+            btstack_linked_list_add_tail(&lower_transport_outgoing_ready, (btstack_linked_item_t *) lower_transport_outgoing_message);
+            lower_transport_outgoing_message = NULL;
+            mesh_lower_transport_run();
+            return;
+        }
+
         // send next segment
         mesh_lower_transport_outgoing_send_next_segment();
         return;
@@ -872,13 +1002,27 @@ static void mesh_lower_transport_process_network_pdu(mesh_network_pdu_t *network
     }
 }
 
+static bool mesh_lower_transport_address_of_this_node(uint16_t address){
+    uint16_t primary_element_address = mesh_node_get_primary_element_address();
+    if (primary_element_address == MESH_ADDRESS_UNSASSIGNED) return false;
+    return (address >= primary_element_address) && (address < (primary_element_address + mesh_node_element_count()));
+}
+
 void mesh_lower_transport_received_message(mesh_network_callback_type_t callback_type, mesh_network_pdu_t *network_pdu){
     mesh_peer_t * peer;
     uint16_t src;
+    uint16_t dst;
     uint16_t seq;
     switch (callback_type){
         case MESH_NETWORK_PDU_RECEIVED:
             src = mesh_network_src(network_pdu);
+            dst = mesh_network_dst(network_pdu);
+            // ignore own messages relayed back by neighbours and messages to other nodes, which only get relayed
+            if (mesh_lower_transport_address_of_this_node(src) ||
+               (mesh_network_address_unicast(dst) && (mesh_node_get_primary_element_address() != MESH_ADDRESS_UNSASSIGNED) && !mesh_lower_transport_address_of_this_node(dst))){
+                mesh_network_message_processed_by_higher_layer(network_pdu);
+                break;
+            }
             seq = mesh_network_seq(network_pdu);
             peer = mesh_peer_for_addr(src);
 #ifdef LOG_LOWER_TRANSPORT
@@ -925,12 +1069,18 @@ static void mesh_lower_transport_run(void){
                 break;
             case MESH_PDU_TYPE_SEGMENTED:
                 message_pdu = (mesh_segmented_pdu_t *) pdu;
-                //
-                printf("[+] Lower transport, segmented pdu %p, seq %06" PRIx32 ": run start sending now\n", message_pdu,
-                       message_pdu->seq);
-                // start sending segmented pdu
-                mesh_lower_transport_outgoing_setup_sending_segmented_pdus(message_pdu);
+                if (message_pdu->seg_o == 0){
+                    printf("[+] Lower transport, segmented pdu %p, seq %06" PRIx32 ": run start sending now\n", message_pdu,
+                           message_pdu->seq);
+                    // start sending segmented pdu
+                    mesh_lower_transport_outgoing_setup_sending_segmented_pdus(message_pdu);
+                } else {
+                    // continue with next segment
+                    lower_transport_outgoing_message = message_pdu;
+                }
                 mesh_lower_transport_outgoing_send_next_segment();
+                // only one segment at network layer
+                if (lower_transport_outgoing_message != NULL) return;
                 break;
             default:
                 btstack_assert(false);
@@ -949,7 +1099,9 @@ void mesh_lower_transport_send_pdu(mesh_pdu_t *pdu){
         case MESH_PDU_TYPE_SEGMENTED:
             // set num retries, set of segments to send
             segmented_pdu = (mesh_segmented_pdu_t *) pdu;
-            segmented_pdu->retry_count = 3;
+            segmented_pdu->retry_count = MESH_LOWER_TRANSPORT_SEGMENTED_RETRIES;
+            segmented_pdu->seg_o = 0;
+            segmented_pdu->flags &= ~MESH_TRANSPORT_FLAG_RETRANSMITTED;
             mesh_lower_transport_outgoing_setup_block_ack(segmented_pdu);
             break;
         default:
@@ -997,6 +1149,16 @@ bool mesh_lower_transport_can_send_to_dest(uint16_t dest){
             return false;
         }
     }
+    // check queued and interleaved
+    btstack_linked_list_iterator_init(&it, &lower_transport_outgoing_ready);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        mesh_pdu_t * pdu = (mesh_pdu_t *) btstack_linked_list_iterator_next(&it);
+        if (pdu->pdu_type != MESH_PDU_TYPE_SEGMENTED) continue;
+        num_messages++;
+        if (((mesh_segmented_pdu_t *) pdu)->dst == dest){
+            return false;
+        }
+    }
 #ifdef MAX_NR_MESH_OUTGOING_SEGMENTED_MESSAGES
     // limit number of parallel outgoing messages if configured
     if (num_messages >= MAX_NR_MESH_OUTGOING_SEGMENTED_MESSAGES) return false;
@@ -1011,6 +1173,7 @@ void mesh_lower_transport_reserve_slot(void){
 
 void mesh_lower_transport_reset(void){
     if (lower_transport_outgoing_message){
+        mesh_lower_transport_outgoing_stop_acknowledgment_timer(lower_transport_outgoing_message);
         while (!btstack_linked_list_empty(&lower_transport_outgoing_message->segments)){
             mesh_network_pdu_t * network_pdu = (mesh_network_pdu_t *) btstack_linked_list_pop(&lower_transport_outgoing_message->segments);
             mesh_network_pdu_free(network_pdu);
@@ -1019,11 +1182,13 @@ void mesh_lower_transport_reset(void){
     }
     while (!btstack_linked_list_empty(&lower_transport_outgoing_waiting)){
         mesh_segmented_pdu_t * segmented_pdu = (mesh_segmented_pdu_t *) btstack_linked_list_pop(&lower_transport_outgoing_waiting);
+        mesh_lower_transport_outgoing_stop_acknowledgment_timer(segmented_pdu);
         btstack_memory_mesh_segmented_pdu_free(segmented_pdu);
     }
     mesh_network_pdu_free(lower_transport_outgoing_segment);
     lower_transport_outgoing_segment_at_network_layer = false;
     lower_transport_outgoing_segment = NULL;
+    mesh_lower_transport_rtt_reset();
 }
 
 void mesh_lower_transport_init(){
@@ -1032,6 +1197,7 @@ void mesh_lower_transport_init(){
     // allocate network_pdu for segmentation
     lower_transport_outgoing_segment_at_network_layer = false;
     lower_transport_outgoing_segment = mesh_network_pdu_get();
+    mesh_lower_transport_rtt_reset();
 }
 
 void mesh_lower_transport_set_higher_layer_handler(void (*pdu_handler)( mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu)){
@@ -177,6 +177,13 @@ static void mesh_network_cache_add(uint32_t hash){
     }
 }
 
+#ifdef ENABLE_TESTING_SUPPORT
+void mesh_network_cache_reset(void){
+    memset(mesh_network_cache, 0, sizeof(mesh_network_cache));
+    mesh_network_cache_index = 0;
+}
+#endif
+
 // common helper
 int mesh_network_address_unicast(uint16_t addr){
     return addr != MESH_ADDRESS_UNSASSIGNED && (addr < 0x8000);
@@ -875,7 +882,7 @@ static void mesh_adv_bearer_handle_network_event(uint8_t packet_type, uint16_t c
 
                     // Get Transmission config depending on relay flag
                     if (adv_bearer_network_pdu->flags & MESH_NETWORK_PDU_FLAGS_RELAY){
-                        transmit_config = mesh_foundation_relay_get();
+                        transmit_config = mesh_foundation_relay_retransmit_get();
                     } else {
                         transmit_config = mesh_foundation_network_transmit_get();
                     }
@@ -112,6 +112,7 @@ typedef struct mesh_network_pdu {
 #define MESH_TRANSPORT_FLAG_TRANSMIC_64       4
 #define MESH_TRANSPORT_FLAG_ACK_TIMER         8
 #define MESH_TRANSPORT_FLAG_INCOMPLETE_TIMER 16
+#define MESH_TRANSPORT_FLAG_RETRANSMITTED    32
 
 typedef struct {
     mesh_pdu_t pdu_header;
@@ -126,6 +127,8 @@ typedef struct {
     btstack_timer_source_t acknowledgement_timer;
     // incoming: incomplete timer / outgoing: not used
     btstack_timer_source_t incomplete_timer;
+    // incoming: not used / outgoing: time last segment was sent
+    uint32_t              transmission_time_ms;
     // block access
     uint32_t              block_ack;
     // meta data network layer
@@ -136,6 +139,8 @@ typedef struct {
     uint16_t              flags;
     // retry count
     uint8_t               retry_count;
+    // outgoing: index of next segment to send
+    uint8_t               seg_o;
     // pdu segments
     uint16_t              len;
     btstack_linked_list_t segments;
@@ -466,6 +471,9 @@ void mesh_network_process_proxy_configuration_message(const uint8_t * pdu_data,
 void mesh_network_encrypt_proxy_configuration_message(mesh_network_pdu_t * network_pdu);
 void mesh_network_dump(void);
 void mesh_network_reset(void);
+#ifdef ENABLE_TESTING_SUPPORT
+void mesh_network_cache_reset(void);
+#endif
 
 #if defined __cplusplus
 }
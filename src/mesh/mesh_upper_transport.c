@@ -68,14 +68,27 @@ typedef struct {
     // state
     mesh_transport_key_iterator_t  key_it;
     mesh_virtual_address_iterator_t address_it;
+    const mesh_transport_key_t *   address_it_key;
     // elements
     const mesh_transport_key_t *   key;
     const mesh_virtual_address_t * address;
     // address - might be virtual
     uint16_t dst;
-    // key info
+    // key info - combination used for last message from same source is tried first
+    const mesh_transport_key_t *   cached_key;
+    const mesh_virtual_address_t * cached_address;
+    bool cached_pending;
 } mesh_transport_key_and_virtual_address_iterator_t;
 
+// per-source cache of key and virtual address used to decrypt last access message from that source
+#define MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE 8
+
+typedef struct {
+    const mesh_transport_key_t *   key;
+    const mesh_virtual_address_t * address;
+    uint16_t src;
+} mesh_upper_transport_key_cache_entry_t;
+
 static void mesh_upper_transport_run(void);
 static void mesh_upper_transport_schedule_send_requests(void);
 static void mesh_upper_transport_validate_access_message(void);
@@ -89,6 +102,12 @@ static int crypto_active;
 static uint8_t application_nonce[13];
 static btstack_crypto_ccm_t ccm;
 static mesh_transport_key_and_virtual_address_iterator_t mesh_transport_key_it;
+static mesh_upper_transport_key_cache_entry_t mesh_upper_transport_key_cache[MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE];
+static uint8_t mesh_upper_transport_key_cache_next;
+#ifdef ENABLE_TESTING_SUPPORT
+// number of AppKey / Label UUID combinations tried to decrypt incoming access messages
+static uint32_t mesh_upper_transport_num_decrypt_attempts;
+#endif
 
 // incoming segmented (mesh_segmented_pdu_t) or unsegmented (network_pdu_t)
 static mesh_pdu_t *          incoming_access_encrypted;
@@ -141,45 +160,118 @@ static void mesh_print_hex(const char * name, const uint8_t * data, uint16_t len
 //     printf("%20s: 0x%x", name, (int) value);
 // }
 
+static mesh_upper_transport_key_cache_entry_t * mesh_upper_transport_key_cache_find(uint16_t src){
+    uint8_t i;
+    for (i=0;i<MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE;i++){
+        mesh_upper_transport_key_cache_entry_t * entry = &mesh_upper_transport_key_cache[i];
+        if ((entry->key != NULL) && (entry->src == src)) return entry;
+    }
+    return NULL;
+}
+
+static void mesh_upper_transport_key_cache_store(uint16_t src, const mesh_transport_key_t * key, const mesh_virtual_address_t * address){
+    mesh_upper_transport_key_cache_entry_t * entry = mesh_upper_transport_key_cache_find(src);
+    if (entry == NULL){
+        // replace oldest entry
+        entry = &mesh_upper_transport_key_cache[mesh_upper_transport_key_cache_next];
+        mesh_upper_transport_key_cache_next = (mesh_upper_transport_key_cache_next + 1) % MESH_UPPER_TRANSPORT_KEY_CACHE_SIZE;
+    }
+    entry->src = src;
+    entry->key = key;
+    entry->address = address;
+}
+
+// cached key and address are only used if they are still registered for this netkey index, aid and hash
+static bool mesh_upper_transport_key_cache_entry_valid(const mesh_upper_transport_key_cache_entry_t * entry, uint16_t dst, uint16_t netkey_index, uint8_t aid){
+    bool key_found = false;
+    mesh_transport_key_iterator_t key_it;
+    mesh_transport_key_aid_iterator_init(&key_it, netkey_index, 1, aid);
+    while (mesh_transport_key_aid_iterator_has_more(&key_it)){
+        if (mesh_transport_key_aid_iterator_get_next(&key_it) == entry->key){
+            key_found = true;
+            break;
+        }
+    }
+    if (key_found == false) return false;
+    if (mesh_network_address_virtual(dst) == false) return true;
+    mesh_virtual_address_iterator_t address_it;
+    mesh_virtual_address_iterator_init(&address_it, dst);
+    while (mesh_virtual_address_iterator_has_more(&address_it)){
+        if (mesh_virtual_address_iterator_get_next(&address_it) == entry->address) return true;
+    }
+    return false;
+}
+
 static void mesh_transport_key_and_virtual_address_iterator_init(mesh_transport_key_and_virtual_address_iterator_t *it,
-                                                                 uint16_t dst, uint16_t netkey_index, uint8_t akf,
-                                                                 uint8_t aid) {
+                                                                 uint16_t src, uint16_t dst, uint16_t netkey_index,
+                                                                 uint8_t akf, uint8_t aid) {
     printf("KEY_INIT: dst %04x, akf %x, aid %x\n", dst, akf, aid);
     // config
     it->dst   = dst;
     // init elements
     it->key     = NULL;
     it->address = NULL;
+    // try key and address from last message of this source first
+    it->cached_key     = NULL;
+    it->cached_address = NULL;
+    it->cached_pending = false;
+    if (akf){
+        const mesh_upper_transport_key_cache_entry_t * entry = mesh_upper_transport_key_cache_find(src);
+        if ((entry != NULL) && mesh_upper_transport_key_cache_entry_valid(entry, dst, netkey_index, aid)){
+            it->cached_key     = entry->key;
+            it->cached_address = entry->address;
+            it->cached_pending = true;
+        }
+    }
     // init element iterators
     mesh_transport_key_aid_iterator_init(&it->key_it, netkey_index, akf, aid);
     // init address iterator
     if (mesh_network_address_virtual(it->dst)){
         mesh_virtual_address_iterator_init(&it->address_it, dst);
         // get first key
+        it->address_it_key = NULL;
         if (mesh_transport_key_aid_iterator_has_more(&it->key_it)) {
-            it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
+            it->address_it_key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
         }
     }
 }
 
 // cartesian product: keys x addressses
 static int mesh_transport_key_and_virtual_address_iterator_has_more(mesh_transport_key_and_virtual_address_iterator_t * it){
+    if (it->cached_pending) return 1;
     if (mesh_network_address_virtual(it->dst)) {
         // find next valid entry
         while (true){
-            if (mesh_virtual_address_iterator_has_more(&it->address_it)) return 1;
+            if ((it->address_it_key != NULL) && mesh_virtual_address_iterator_has_more(&it->address_it)) {
+                // skip combination already tried from cache
+                if ((it->address_it_key != it->cached_key) || (it->address_it.address != it->cached_address)) return 1;
+                (void) mesh_virtual_address_iterator_get_next(&it->address_it);
+                continue;
+            }
             if (!mesh_transport_key_aid_iterator_has_more(&it->key_it)) return 0;
             // get next key
-            it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
+            it->address_it_key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
             mesh_virtual_address_iterator_init(&it->address_it, it->dst);
         }
     } else {
-        return mesh_transport_key_aid_iterator_has_more(&it->key_it);
+        while (mesh_transport_key_aid_iterator_has_more(&it->key_it)){
+            // skip key already tried from cache
+            if (it->key_it.key != it->cached_key) return 1;
+            (void) mesh_transport_key_aid_iterator_get_next(&it->key_it);
+        }
+        return 0;
     }
 }
 
 static void mesh_transport_key_and_virtual_address_iterator_next(mesh_transport_key_and_virtual_address_iterator_t * it){
+    if (it->cached_pending){
+        it->cached_pending = false;
+        it->key     = it->cached_key;
+        it->address = it->cached_address;
+        return;
+    }
     if (mesh_network_address_virtual(it->dst)) {
+        it->key     = it->address_it_key;
         it->address = mesh_virtual_address_iterator_get_next(&it->address_it);
     } else {
         it->key = mesh_transport_key_aid_iterator_get_next(&it->key_it);
@@ -277,8 +369,19 @@ void mesh_upper_transport_dump(void){
     mesh_upper_transport_dump_pdus("upper_transport_incoming", &upper_transport_incoming);
 }
 
+#ifdef ENABLE_TESTING_SUPPORT
+uint32_t mesh_upper_transport_get_num_decrypt_attempts(void){
+    return mesh_upper_transport_num_decrypt_attempts;
+}
+#endif
+
 void mesh_upper_transport_reset(void){
     crypto_active = 0;
+#ifdef ENABLE_TESTING_SUPPORT
+    mesh_upper_transport_num_decrypt_attempts = 0;
+#endif
+    memset(mesh_upper_transport_key_cache, 0, sizeof(mesh_upper_transport_key_cache));
+    mesh_upper_transport_key_cache_next = 0;
     mesh_upper_transport_reset_pdus(&upper_transport_incoming);
     mesh_upper_transport_reset_pdus(&upper_transport_outgoing);
     message_builder_num_network_pdus_reserved = 0;
@@ -491,6 +594,11 @@ static void mesh_upper_transport_validate_access_message_ccm(void * arg){
         // remove TransMIC from payload
         incoming_access_decrypted->len -= transmic_len;
 
+        // remember application key and virtual address for next message from this source
+        if (mesh_transport_key_it.key->akf){
+            mesh_upper_transport_key_cache_store(incoming_access_decrypted->src, mesh_transport_key_it.key, mesh_transport_key_it.address);
+        }
+
         // if virtual address, update dst to pseudo_dst
         if (mesh_network_address_virtual(incoming_access_decrypted->dst)){
             incoming_access_decrypted->dst = mesh_transport_key_it.address->pseudo_dst;
@@ -573,6 +681,9 @@ static void mesh_upper_transport_validate_access_message(void){
     if (mesh_network_address_virtual(incoming_access_decrypted->dst)){
         aad_len  = 16;
     }
+#ifdef ENABLE_TESTING_SUPPORT
+    mesh_upper_transport_num_decrypt_attempts++;
+#endif
     btstack_crypto_ccm_init(&ccm, message_key->key, application_nonce, upper_transport_pdu_len, aad_len, transmic_len);
 
     if (aad_len){
@@ -595,7 +706,8 @@ static void mesh_upper_transport_process_access_message(void){
     printf("AKF: %u\n",   akf);
     printf("AID: %02x\n", aid);
 
-    mesh_transport_key_and_virtual_address_iterator_init(&mesh_transport_key_it, incoming_access_decrypted->dst,
+    mesh_transport_key_and_virtual_address_iterator_init(&mesh_transport_key_it, incoming_access_decrypted->src,
+                                                         incoming_access_decrypted->dst,
                                                          incoming_access_decrypted->netkey_index, akf, aid);
     mesh_upper_transport_validate_access_message();
 }
@@ -685,6 +797,9 @@ static void mesh_upper_transport_send_access_ccm(void * arg){
         default:
             btstack_assert(false);
     }
+
+    // encrypt next message, lower transport interleaves segmented messages to different destinations
+    mesh_upper_transport_run();
 }
 
 static void mesh_upper_transport_send_access_digest(void *arg){
@@ -201,6 +201,9 @@ void mesh_upper_transport_send_access_pdu(mesh_pdu_t * pdu);
 // test
 void mesh_upper_transport_dump(void);
 void mesh_upper_transport_reset(void);
+#ifdef ENABLE_TESTING_SUPPORT
+uint32_t mesh_upper_transport_get_num_decrypt_attempts(void);
+#endif
 
 #ifdef __cplusplus
 } /* end of extern "C" */
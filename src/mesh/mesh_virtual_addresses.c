@@ -51,6 +51,30 @@
 static btstack_linked_list_t mesh_virtual_addresses;
 static uint8_t mesh_virtual_addresses_used[MAX_NR_MESH_VIRTUAL_ADDRESSES];
 
+// virtual addresses indexed by lower bits of hash, single linked via hash_next
+#define MESH_VIRTUAL_ADDRESS_NUM_HASH_BUCKETS 16
+static mesh_virtual_address_t * mesh_virtual_addresses_by_hash[MESH_VIRTUAL_ADDRESS_NUM_HASH_BUCKETS];
+
+static mesh_virtual_address_t ** mesh_virtual_address_hash_bucket(uint16_t hash){
+    return &mesh_virtual_addresses_by_hash[hash & (MESH_VIRTUAL_ADDRESS_NUM_HASH_BUCKETS - 1)];
+}
+
+static void mesh_virtual_address_hash_index_remove(mesh_virtual_address_t * virtual_address){
+    // hash might have changed since address was added, check all buckets
+    uint8_t i;
+    for (i = 0; i < MESH_VIRTUAL_ADDRESS_NUM_HASH_BUCKETS; i++){
+        mesh_virtual_address_t ** next = &mesh_virtual_addresses_by_hash[i];
+        while (*next != NULL){
+            if (*next == virtual_address){
+                *next = virtual_address->hash_next;
+                virtual_address->hash_next = NULL;
+                return;
+            }
+            next = &(*next)->hash_next;
+        }
+    }
+}
+
 uint16_t mesh_virtual_addresses_get_free_pseudo_dst(void){
     uint16_t i;
     for (i=0;i < MAX_NR_MESH_VIRTUAL_ADDRESSES ; i++){
@@ -65,10 +89,15 @@ void mesh_virtual_address_add(mesh_virtual_address_t * virtual_address){
     mesh_virtual_addresses_used[virtual_address->pseudo_dst-0x8000] = 1;
     virtual_address->ref_count = 0;
     btstack_linked_list_add(&mesh_virtual_addresses, (void *) virtual_address);
+    mesh_virtual_address_hash_index_remove(virtual_address);
+    mesh_virtual_address_t ** bucket = mesh_virtual_address_hash_bucket(virtual_address->hash);
+    virtual_address->hash_next = *bucket;
+    *bucket = virtual_address;
 }
 
 void mesh_virtual_address_remove(mesh_virtual_address_t * virtual_address){
     btstack_linked_list_remove(&mesh_virtual_addresses, (void *) virtual_address);
+    mesh_virtual_address_hash_index_remove(virtual_address);
     mesh_virtual_addresses_used[virtual_address->pseudo_dst-0x8000] = 0;
 }
 
@@ -109,24 +138,23 @@ mesh_virtual_address_t * mesh_virtual_address_for_label_uuid(uint8_t * label_uui
 // virtual address iterator
 
 void mesh_virtual_address_iterator_init(mesh_virtual_address_iterator_t * it, uint16_t hash){
-    btstack_linked_list_iterator_init(&it->it, &mesh_virtual_addresses);
     it->hash = hash;
-    it->address = NULL;
+    it->address = *mesh_virtual_address_hash_bucket(hash);
 }
 
 int mesh_virtual_address_iterator_has_more(mesh_virtual_address_iterator_t * it){
-    // find next matching key
-    while (true){
-        printf("check %p\n", it->address);
-        if (it->address && it->address->hash == it->hash) return 1;
-        if (!btstack_linked_list_iterator_has_next(&it->it)) break;
-        it->address = (mesh_virtual_address_t *) btstack_linked_list_iterator_next(&it->it);
+    // find next matching address in hash bucket
+    while (it->address != NULL){
+        if (it->address->hash == it->hash) return 1;
+        it->address = it->address->hash_next;
     }
     return 0;
 }
 
 const mesh_virtual_address_t * mesh_virtual_address_iterator_get_next(mesh_virtual_address_iterator_t * it){
     mesh_virtual_address_t * address = it->address;
-    it->address = NULL;
+    if (address != NULL){
+        it->address = address->hash_next;
+    }
     return address;
 }
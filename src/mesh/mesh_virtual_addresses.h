@@ -47,8 +47,10 @@ extern "C"
 {
 #endif
 
-typedef struct {
+typedef struct mesh_virtual_address {
 	btstack_linked_item_t item;
+    // next address in same hash bucket
+    struct mesh_virtual_address * hash_next;
     uint16_t pseudo_dst;
     uint16_t hash;
     uint16_t ref_count;
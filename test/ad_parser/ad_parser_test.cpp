@@ -193,6 +193,123 @@ TEST(ADParser, ad_data_contains_uuid128){
     }
 }
 
+TEST(ADParser, ad_data_match_uuid16s){
+    const uint16_t uuid16s[] = { 0x1800, 0xaa10, 0xff10 };
+    uint8_t matched;
+    CHECK(ad_data_match_uuid16s(sizeof(adv_data), adv_data, uuid16s, 3, &matched));
+    // 0xff10 from 16-bit list, 0xaa10 from 128-bit list with Bluetooth Base UUID
+    CHECK_EQUAL(0x06, matched);
+    CHECK(ad_data_match_uuid16s(sizeof(adv_data), adv_data, uuid16s, 3, NULL));
+    CHECK(!ad_data_match_uuid16s(sizeof(adv_data), adv_data, uuid16s, 1, &matched));
+    CHECK_EQUAL(0x00, matched);
+    CHECK(!ad_data_match_uuid16s(sizeof(adv_data_2), adv_data_2, uuid16s, 3, NULL));
+}
+
+TEST(ADParser, ad_data_match_uuid128s){
+    const uint8_t uuid128_le[] = {0x9e, 0xca, 0xdc, 0x24, 0xe, 0xe5, 0xa9, 0xe0, 0x93, 0xf3, 0xa3, 0xb5, 0x1, 0x0, 0x40, 0x6e};
+    uint8_t uuid128s[3 * 16];
+    // sorted: 0000ff10-..., 6e400001-..., ffff...
+    uuid_add_bluetooth_prefix(&uuid128s[0], 0xff10);
+    reverse_128(uuid128_le, &uuid128s[16]);
+    memset(&uuid128s[32], 0xff, 16);
+    uint8_t matched;
+    CHECK(ad_data_match_uuid128s(sizeof(adv_data), adv_data, uuid128s, 3, &matched));
+    CHECK_EQUAL(0x03, matched);
+    CHECK(!ad_data_match_uuid128s(sizeof(adv_data), adv_data, &uuid128s[32], 1, &matched));
+    CHECK_EQUAL(0x00, matched);
+}
+
+TEST(ADParser, ad_index){
+    ad_index_t index;
+    uint8_t data_len;
+    CHECK_EQUAL(5, ad_index_build(&index, sizeof(adv_data), adv_data));
+    CHECK(ad_index_contains_data_type(&index, BLUETOOTH_DATA_TYPE_FLAGS));
+    CHECK(!ad_index_contains_data_type(&index, BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA));
+    const uint8_t * name = ad_index_get_data(&index, BLUETOOTH_DATA_TYPE_COMPLETE_LOCAL_NAME, &data_len);
+    CHECK(name != NULL);
+    CHECK_EQUAL(11, data_len);
+    CHECK_EQUAL(0, memcmp("LE Streamer", name, 11));
+    // malformed
+    CHECK_EQUAL(1, ad_index_build(&index, sizeof(ad_data) - 1, ad_data));
+}
+
+// Extended Advertising data with AD Structures beyond AD_INDEX_MAX_STRUCTURES
+#define EXTENDED_AD_DATA_LEN 1650
+static uint8_t extended_ad_data[EXTENDED_AD_DATA_LEN];
+
+static uint16_t setup_extended_ad_data(void){
+    uint16_t pos = 0;
+    uint8_t counter = 0;
+    // 16-byte manufacturer specific data
+    while ((pos + 16u + 14u) <= EXTENDED_AD_DATA_LEN){
+        extended_ad_data[pos++] = 15;
+        extended_ad_data[pos++] = BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA;
+        memset(&extended_ad_data[pos], counter++, 14);
+        pos += 14;
+    }
+    // 16-bit UUID list at the end
+    extended_ad_data[pos++] = 13;
+    extended_ad_data[pos++] = BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS;
+    uint16_t i;
+    for (i = 0; i < 6; i++){
+        little_endian_store_16(extended_ad_data, pos, 0x1800 + (i * 2));
+        pos += 2;
+    }
+    return pos;
+}
+
+TEST(ADParser, ExtendedAdvertisingData){
+    uint16_t ad_len = setup_extended_ad_data();
+    CHECK(ad_len > 255);
+    ad_index_t index;
+    CHECK_EQUAL(AD_INDEX_MAX_STRUCTURES, ad_index_build(&index, ad_len, extended_ad_data));
+    uint8_t data_len;
+    CHECK(ad_index_get_data(&index, BLUETOOTH_DATA_TYPE_COMPLETE_LIST_OF_16_BIT_SERVICE_CLASS_UUIDS, &data_len) != NULL);
+    CHECK_EQUAL(12, data_len);
+    CHECK(ad_data_contains_uuid16(ad_len, extended_ad_data, 0x180a));
+    const uint16_t uuid16s[] = { 0x1801, 0x1802, 0x180a };
+    uint8_t matched;
+    CHECK(ad_data_match_uuid16s(ad_len, extended_ad_data, uuid16s, 3, &matched));
+    CHECK_EQUAL(0x06, matched);
+}
+
+// compare single UUID lookups with multi-UUID matcher, only built by 'make benchmark'
+#ifdef ENABLE_BENCHMARK
+#include <time.h>
+
+TEST(ADParser, Benchmark){
+    const uint32_t num_iterations = 20000;
+    const uint16_t num_uuid16s = 16;
+    uint16_t uuid16s[16];
+    uint16_t ad_len = setup_extended_ad_data();
+    uint32_t i;
+    uint16_t j;
+    uint32_t matches = 0;
+    for (j = 0; j < num_uuid16s; j++){
+        uuid16s[j] = 0x1801 + j;
+    }
+
+    clock_t start = clock();
+    for (i = 0; i < num_iterations; i++){
+        for (j = 0; j < num_uuid16s; j++){
+            if (ad_data_contains_uuid16(ad_len, extended_ad_data, uuid16s[j])) matches++;
+        }
+    }
+    double ns_contains = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / num_iterations;
+
+    uint8_t matched[2];
+    start = clock();
+    for (i = 0; i < num_iterations; i++){
+        ad_data_match_uuid16s(ad_len, extended_ad_data, uuid16s, num_uuid16s, matched);
+        matches -= count_set_bits_uint32(little_endian_read_16(matched, 0));
+    }
+    double ns_match = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / num_iterations;
+    printf("%u bytes AD data, %u UUIDs: %.0f ns with ad_data_contains_uuid16, %.0f ns with ad_data_match_uuid16s\n",
+           ad_len, num_uuid16s, ns_contains, ns_match);
+    CHECK_EQUAL(0, matches);
+}
+#endif
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
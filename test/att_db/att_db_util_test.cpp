@@ -137,7 +137,7 @@ TEST(AttDbUtil, LeCounterDb){
     CHECK_EQUAL_ARRAY(profile_data, addr, size);
 }
 
-TEST(AttDbUtil, GattHash){
+static void add_gatt_hash_services(void){
     const uint8_t appearance[] = {0};
     const uint8_t service_changed[] = {0} ;
     const uint8_t supported_features[] = {0} ;
@@ -156,6 +156,10 @@ TEST(AttDbUtil, GattHash){
     att_db_util_add_descriptor_uuid16(0x2900, 0, ATT_SECURITY_NONE, ATT_SECURITY_NONE, (uint8_t*)extended_properties, sizeof(extended_properties));
     att_db_util_add_secondary_service_uuid16(0x180f);
     att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, (uint8_t*)battery_level, sizeof(battery_level));
+}
+
+TEST(AttDbUtil, GattHash){
+    add_gatt_hash_services();
 
     uint16_t hash_len = att_db_util_hash_len();
     CHECK_EQUAL((uint16_t)sizeof(gatt_database_hash_test_message), hash_len);
@@ -173,6 +177,39 @@ TEST(AttDbUtil, GattHash){
     CHECK_EQUAL_ARRAY(gatt_database_hash_expected, cmac_calculated, 16);
 }
 
+TEST(AttDbUtil, RemoveService){
+    uint16_t start_handle;
+    uint16_t end_handle;
+    const uint8_t value[] = { 0x55 };
+
+    add_gatt_hash_services();
+    CHECK_TRUE(att_db_util_get_changed_handle_range(&start_handle, &end_handle));
+    att_db_util_clear_changed_handle_range();
+    CHECK_FALSE(att_db_util_get_changed_handle_range(&start_handle, &end_handle));
+    uint16_t db_size = att_db_util_get_size();
+
+    // add and remove service at the end
+    uint16_t service_handle = att_db_util_add_service_uuid16(0x1234);
+    att_db_util_add_characteristic_uuid16(0x2345, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, ATT_SECURITY_NONE, ATT_SECURITY_NONE, (uint8_t*)value, sizeof(value));
+    CHECK_TRUE(att_db_util_remove_service(service_handle));
+    CHECK_FALSE(att_db_util_remove_service(service_handle));
+
+    CHECK_EQUAL(db_size, att_db_util_get_size());
+    CHECK_TRUE(att_db_util_get_changed_handle_range(&start_handle, &end_handle));
+    CHECK_EQUAL(service_handle, start_handle);
+    CHECK(end_handle >= service_handle + 3);
+
+    // hash matches database without the removed service
+    CHECK_EQUAL((uint16_t)sizeof(gatt_database_hash_test_message), att_db_util_hash_len());
+    att_db_util_hash_calc(&cmac_context, cmac_calculated, &gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(gatt_database_hash_expected, cmac_calculated, 16);
+
+    // cached hash is returned without recalculation
+    memset(cmac_calculated, 0, sizeof(cmac_calculated));
+    att_db_util_hash_calc(&cmac_context, cmac_calculated, &gatt_hash_calculated, NULL);
+    CHECK_EQUAL_ARRAY(gatt_database_hash_expected, cmac_calculated, 16);
+}
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
@@ -0,0 +1,257 @@
+// test jitter buffer for received media frames
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bluetooth.h"
+#include "btstack_jitter_buffer.h"
+
+#define SAMPLE_RATE       44100
+#define SAMPLES_PER_FRAME 128
+#define FRAME_SIZE        10
+#define FRAMES_PER_PACKET 5
+#define STORAGE_FRAMES    128
+
+// frame counts for default target depths
+#define MIN_TARGET_FRAMES     14
+#define INITIAL_TARGET_FRAMES 42
+#define MAX_TARGET_FRAMES     104
+
+static uint8_t storage[STORAGE_FRAMES * (FRAME_SIZE + BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE)];
+
+TEST_GROUP(JitterBuffer){
+    btstack_jitter_buffer_t jitter_buffer;
+    uint16_t sequence_number;
+    uint32_t timestamp;
+    uint32_t time_ms;
+    uint32_t samples_sent;
+    uint32_t source_rate_percent;
+    uint8_t  next_frame_id;
+
+    void setup(void){
+        btstack_jitter_buffer_init(&jitter_buffer, storage, sizeof(storage), SAMPLE_RATE, SAMPLES_PER_FRAME);
+        sequence_number = 0xfff0;
+        timestamp = 0xffff0000u;
+        time_ms = 1000;
+        samples_sent = 0;
+        source_rate_percent = 100;
+        next_frame_id = 0;
+    }
+
+    uint8_t write_packet(void){
+        uint8_t frames[FRAMES_PER_PACKET * FRAME_SIZE];
+        for (uint8_t i = 0; i < FRAMES_PER_PACKET; i++){
+            memset(&frames[i * FRAME_SIZE], next_frame_id++, FRAME_SIZE);
+        }
+        uint8_t status = btstack_jitter_buffer_write_packet(&jitter_buffer, sequence_number, timestamp, time_ms, frames, sizeof(frames), FRAMES_PER_PACKET);
+        sequence_number++;
+        timestamp += FRAMES_PER_PACKET * SAMPLES_PER_FRAME;
+        samples_sent += FRAMES_PER_PACKET * SAMPLES_PER_FRAME;
+        time_ms = 1000 + (uint32_t)(((uint64_t) samples_sent * 1000 * 100) / ((uint64_t) SAMPLE_RATE * source_rate_percent));
+        return status;
+    }
+
+    void lose_packet(void){
+        next_frame_id += FRAMES_PER_PACKET;
+        sequence_number++;
+        timestamp += FRAMES_PER_PACKET * SAMPLES_PER_FRAME;
+    }
+
+    void fill_to_target(void){
+        while (btstack_jitter_buffer_is_playing(&jitter_buffer) == false){
+            CHECK_EQUAL(ERROR_CODE_SUCCESS, write_packet());
+        }
+    }
+
+    btstack_jitter_buffer_read_status_t read_frame(uint8_t * frame_id){
+        uint8_t frame[FRAME_SIZE];
+        uint16_t frame_size;
+        btstack_jitter_buffer_read_status_t status = btstack_jitter_buffer_read_frame(&jitter_buffer, frame, sizeof(frame), &frame_size);
+        if (status == BTSTACK_JITTER_BUFFER_READ_FRAME){
+            CHECK_EQUAL(FRAME_SIZE, frame_size);
+            *frame_id = frame[0];
+        }
+        return status;
+    }
+
+    // play with constant buffer level and return resampling factor
+    uint32_t play(uint32_t num_packets){
+        uint8_t frame_id;
+        fill_to_target();
+        for (uint32_t i = 0; i < num_packets; i++){
+            write_packet();
+            for (int j = 0; j < FRAMES_PER_PACKET; j++){
+                CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_FRAME, read_frame(&frame_id));
+            }
+        }
+        return btstack_jitter_buffer_get_resampling_factor(&jitter_buffer);
+    }
+
+    void get_statistics(btstack_jitter_buffer_statistics_t * statistics){
+        btstack_jitter_buffer_get_statistics(&jitter_buffer, statistics);
+    }
+};
+
+TEST(JitterBuffer, PlaybackStartsAtTargetDepth){
+    uint8_t frame_id;
+    CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_EMPTY, read_frame(&frame_id));
+    fill_to_target();
+    CHECK_EQUAL(45, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+    CHECK_EQUAL(130, btstack_jitter_buffer_get_latency_ms(&jitter_buffer));
+
+    for (uint8_t i = 0; i < 45; i++){
+        CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_FRAME, read_frame(&frame_id));
+        CHECK_EQUAL(i, frame_id);
+    }
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(9, statistics.packets_received);
+    CHECK_EQUAL(45, statistics.frames_played);
+    CHECK_EQUAL(0, statistics.packets_lost);
+    CHECK_EQUAL(INITIAL_TARGET_FRAMES, statistics.target_frames);
+}
+
+TEST(JitterBuffer, LostPacketReportedAsMissingFrames){
+    write_packet();
+    lose_packet();
+    fill_to_target();
+
+    uint8_t frame_id;
+    for (uint8_t i = 0; i < 15; i++){
+        if ((i >= FRAMES_PER_PACKET) && (i < (2 * FRAMES_PER_PACKET))){
+            CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_MISSING, read_frame(&frame_id));
+        } else {
+            CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_FRAME, read_frame(&frame_id));
+            CHECK_EQUAL(i, frame_id);
+        }
+    }
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.packets_lost);
+    CHECK_EQUAL(FRAMES_PER_PACKET, statistics.frames_concealed);
+}
+
+TEST(JitterBuffer, LateAndDuplicatePacketsDropped){
+    write_packet();
+    write_packet();
+    sequence_number -= 2;
+    timestamp -= 2 * FRAMES_PER_PACKET * SAMPLES_PER_FRAME;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, write_packet());
+    CHECK_EQUAL(2 * FRAMES_PER_PACKET, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.packets_late);
+}
+
+TEST(JitterBuffer, LongGapResyncs){
+    write_packet();
+    write_packet();
+    timestamp += SAMPLE_RATE;
+    sequence_number += 100;
+    write_packet();
+    CHECK_EQUAL(FRAMES_PER_PACKET, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+
+    // sequence number restarted by source
+    sequence_number = 0;
+    write_packet();
+    CHECK_EQUAL(FRAMES_PER_PACKET, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.resyncs);
+}
+
+TEST(JitterBuffer, UnderrunIncreasesTarget){
+    fill_to_target();
+    uint8_t frame_id;
+    while (btstack_jitter_buffer_get_num_frames(&jitter_buffer) > 0){
+        CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_FRAME, read_frame(&frame_id));
+    }
+    CHECK_EQUAL(BTSTACK_JITTER_BUFFER_READ_EMPTY, read_frame(&frame_id));
+    CHECK_FALSE(btstack_jitter_buffer_is_playing(&jitter_buffer));
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.underruns);
+    CHECK_EQUAL(INITIAL_TARGET_FRAMES + INITIAL_TARGET_FRAMES / 2, statistics.target_frames);
+
+    // further underruns limited by max target
+    for (int i = 0; i < 5; i++){
+        fill_to_target();
+        while (read_frame(&frame_id) != BTSTACK_JITTER_BUFFER_READ_EMPTY){
+        }
+    }
+    get_statistics(&statistics);
+    CHECK_EQUAL(MAX_TARGET_FRAMES, statistics.target_frames);
+}
+
+TEST(JitterBuffer, StableLinkDecreasesTarget){
+    // play 60 seconds with constant buffer level
+    play(4200);
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(MIN_TARGET_FRAMES, statistics.target_frames);
+    CHECK_EQUAL(0, statistics.underruns);
+    CHECK_EQUAL(4209, statistics.packets_received);
+}
+
+TEST(JitterBuffer, ResamplingFactorFollowsBufferLevel){
+    CHECK_EQUAL(0x10000, btstack_jitter_buffer_get_resampling_factor(&jitter_buffer) + 0x100);
+    fill_to_target();
+    CHECK_EQUAL(0x10000, btstack_jitter_buffer_get_resampling_factor(&jitter_buffer));
+    for (int i = 0; i < 4; i++){
+        write_packet();
+    }
+    CHECK_EQUAL(0x10100, btstack_jitter_buffer_get_resampling_factor(&jitter_buffer));
+}
+
+TEST(JitterBuffer, SampleRateCompensation){
+    btstack_jitter_buffer_set_playback_sample_rate(&jitter_buffer, SAMPLE_RATE);
+    uint32_t factor_nominal = play(2000);
+
+    // source sends 1% faster than playback
+    setup();
+    btstack_jitter_buffer_set_playback_sample_rate(&jitter_buffer, SAMPLE_RATE);
+    source_rate_percent = 101;
+    uint32_t factor_faster = play(2000);
+    CHECK_TRUE(factor_faster > (factor_nominal + 0xc0));
+}
+
+TEST(JitterBuffer, InvalidPacket){
+    uint8_t frames[3 * FRAME_SIZE + 1];
+    memset(frames, 0, sizeof(frames));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_jitter_buffer_write_packet(&jitter_buffer, 0, 0, 0, frames, sizeof(frames), 3));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, btstack_jitter_buffer_write_packet(&jitter_buffer, 0, 0, 0, frames, sizeof(frames), 0));
+
+    btstack_jitter_buffer_t small_jitter_buffer;
+    btstack_jitter_buffer_init(&small_jitter_buffer, storage, 2 * (FRAME_SIZE + BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE), SAMPLE_RATE, SAMPLES_PER_FRAME);
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, btstack_jitter_buffer_write_packet(&small_jitter_buffer, 0, 0, 0, frames, 3 * FRAME_SIZE, 3));
+}
+
+TEST(JitterBuffer, FullStorageDropsOldestFrames){
+    btstack_jitter_buffer_init(&jitter_buffer, storage, 20 * (FRAME_SIZE + BTSTACK_JITTER_BUFFER_FRAME_HEADER_SIZE), SAMPLE_RATE, SAMPLES_PER_FRAME);
+    for (int i = 0; i < 6; i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, write_packet());
+    }
+    CHECK_EQUAL(20, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+
+    btstack_jitter_buffer_statistics_t statistics;
+    get_statistics(&statistics);
+    CHECK_EQUAL(10, statistics.frames_dropped);
+    btstack_jitter_buffer_reset_statistics(&jitter_buffer);
+    get_statistics(&statistics);
+    CHECK_EQUAL(0, statistics.frames_dropped);
+
+    btstack_jitter_buffer_reset(&jitter_buffer);
+    CHECK_EQUAL(0, btstack_jitter_buffer_get_num_frames(&jitter_buffer));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
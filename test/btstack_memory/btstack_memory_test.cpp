@@ -851,6 +851,48 @@ TEST(btstack_memory, avrcp_browsing_connection_NotEnoughBuffers){
 #ifdef ENABLE_BLE
 
 
+TEST(btstack_memory, att_server_request_GetAndFree){
+    att_server_request_t * context;
+#ifdef HAVE_MALLOC
+    context = btstack_memory_att_server_request_get();
+    CHECK(context != NULL);
+    btstack_memory_att_server_request_free(context);
+#else
+#ifdef MAX_NR_ATT_SERVER_REQUESTS
+    // single
+    context = btstack_memory_att_server_request_get();
+    CHECK(context != NULL);
+    btstack_memory_att_server_request_free(context);
+#else
+    // none
+    context = btstack_memory_att_server_request_get();
+    CHECK(context == NULL);
+    btstack_memory_att_server_request_free(context);
+#endif
+#endif
+}
+
+TEST(btstack_memory, att_server_request_NotEnoughBuffers){
+    att_server_request_t * context;
+#ifdef HAVE_MALLOC
+    btstack_memory_simulate_malloc_failure(true);
+#else
+#ifdef MAX_NR_ATT_SERVER_REQUESTS
+    int i;
+    // alloc all static buffers
+    for (i = 0; i < MAX_NR_ATT_SERVER_REQUESTS; i++){
+        context = btstack_memory_att_server_request_get();
+        CHECK(context != NULL);
+    }
+#endif
+#endif
+    // get one more
+    context = btstack_memory_att_server_request_get();
+    CHECK(context == NULL);
+}
+
+
+
 TEST(btstack_memory, battery_service_client_GetAndFree){
     battery_service_client_t * context;
 #ifdef HAVE_MALLOC
@@ -1449,3 +1491,4 @@ TEST(btstack_memory, hci_iso_stream_NotEnoughBuffers){
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
+
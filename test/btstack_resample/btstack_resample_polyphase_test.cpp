@@ -0,0 +1,191 @@
+// test polyphase resampler: output capacity, THD+N and throughput compared to linear resampler
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_resample.h"
+#include "btstack_resample_polyphase.h"
+
+#define BLOCK_FRAMES      128
+#define MAX_OUTPUT_FRAMES 600
+#define SIGNAL_FRAMES     (BLOCK_FRAMES * 200)
+#define SETTLE_FRAMES     256
+
+// 44.1 kHz -> 48 kHz
+#define FACTOR_44100_TO_48000 ((uint32_t) ((44100.0 * 65536.0 / 48000.0) + 0.5))
+
+static int16_t input_buffer[SIGNAL_FRAMES * BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS];
+static int16_t output_buffer[(SIGNAL_FRAMES * 2) * BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS];
+
+typedef enum {
+    RESAMPLER_LINEAR = 0,
+    RESAMPLER_POLYPHASE_8 = 8,
+    RESAMPLER_POLYPHASE_16 = 16,
+    RESAMPLER_POLYPHASE_32 = 32,
+} resampler_t;
+
+static void generate_sine(double frequency, double sample_rate, int num_channels){
+    for (uint32_t i = 0; i < SIGNAL_FRAMES; i++){
+        int16_t value = (int16_t) lround(16384.0 * sin(2.0 * M_PI * frequency * i / sample_rate));
+        for (int j = 0; j < num_channels; j++){
+            input_buffer[i * num_channels + j] = value;
+        }
+    }
+}
+
+// resample input buffer block by block, @return number of output frames
+static uint32_t resample(resampler_t resampler, uint32_t factor, int num_channels){
+    btstack_resample_t linear;
+    btstack_resample_polyphase_t polyphase;
+    if (resampler == RESAMPLER_LINEAR){
+        btstack_resample_init(&linear, num_channels);
+        btstack_resample_set_factor(&linear, factor);
+    } else {
+        btstack_resample_polyphase_init(&polyphase, num_channels, (btstack_resample_polyphase_filter_t) resampler);
+        btstack_resample_polyphase_set_factor(&polyphase, factor);
+    }
+    uint32_t output_frames = 0;
+    for (uint32_t i = 0; i < SIGNAL_FRAMES; i += BLOCK_FRAMES){
+        const int16_t * input = &input_buffer[i * num_channels];
+        int16_t * output = &output_buffer[output_frames * num_channels];
+        if (resampler == RESAMPLER_LINEAR){
+            output_frames += btstack_resample_block(&linear, input, BLOCK_FRAMES, output);
+        } else {
+            output_frames += btstack_resample_polyphase_block(&polyphase, input, BLOCK_FRAMES, output);
+        }
+    }
+    return output_frames;
+}
+
+// THD+N of first channel in dB: remove best fitting sine at expected frequency and compare residual with signal
+static double thd_n(uint32_t num_frames, int num_channels, double frequency){
+    double sum_ss = 0.0, sum_cc = 0.0, sum_sc = 0.0, sum_ys = 0.0, sum_yc = 0.0;
+    for (uint32_t i = SETTLE_FRAMES; i < num_frames; i++){
+        double s = sin(2.0 * M_PI * frequency * i);
+        double c = cos(2.0 * M_PI * frequency * i);
+        double y = output_buffer[i * num_channels];
+        sum_ss += s * s;
+        sum_cc += c * c;
+        sum_sc += s * c;
+        sum_ys += y * s;
+        sum_yc += y * c;
+    }
+    // least squares for y = a * sin + b * cos
+    double det = (sum_ss * sum_cc) - (sum_sc * sum_sc);
+    double a = ((sum_ys * sum_cc) - (sum_yc * sum_sc)) / det;
+    double b = ((sum_yc * sum_ss) - (sum_ys * sum_sc)) / det;
+    double signal = 0.0, noise = 0.0;
+    for (uint32_t i = SETTLE_FRAMES; i < num_frames; i++){
+        double fit = (a * sin(2.0 * M_PI * frequency * i)) + (b * cos(2.0 * M_PI * frequency * i));
+        double residual = output_buffer[i * num_channels] - fit;
+        signal += fit * fit;
+        noise  += residual * residual;
+    }
+    return 10.0 * log10(noise / signal);
+}
+
+static double measure_thd_n(resampler_t resampler, double frequency){
+    generate_sine(frequency, 44100.0, 1);
+    uint32_t num_frames = resample(resampler, FACTOR_44100_TO_48000, 1);
+    return thd_n(num_frames, 1, (frequency / 44100.0) * (FACTOR_44100_TO_48000 / 65536.0));
+}
+
+TEST_GROUP(ResamplePolyphase){
+    void check_capacity(uint32_t input_frames, uint32_t output_capacity_frames, int num_channels, btstack_resample_polyphase_filter_t filter){
+        static int16_t output[MAX_OUTPUT_FRAMES * BTSTACK_RESAMPLE_POLYPHASE_MAX_CHANNELS];
+        btstack_resample_polyphase_t context;
+        btstack_resample_polyphase_init(&context, num_channels, filter);
+        btstack_resample_polyphase_set_factor(&context,
+            btstack_resample_get_min_factor_for_output_capacity(input_frames, output_capacity_frames));
+        for (int i = 0; i < 10; i++){
+            uint16_t output_frames = btstack_resample_polyphase_block(&context, input_buffer, input_frames, output);
+            CHECK_TRUE(output_frames <= output_capacity_frames);
+        }
+    }
+};
+
+TEST(ResamplePolyphase, MinFactorKeepsOutputWithinCapacity){
+    generate_sine(1000.0, 44100.0, 2);
+    check_capacity(128, 128, 1, BTSTACK_RESAMPLE_POLYPHASE_FILTER_8_TAPS);
+    check_capacity(128, 144, 2, BTSTACK_RESAMPLE_POLYPHASE_FILTER_16_TAPS);
+    check_capacity(480, 528, 1, BTSTACK_RESAMPLE_POLYPHASE_FILTER_32_TAPS);
+    check_capacity(480, 528, 2, BTSTACK_RESAMPLE_POLYPHASE_FILTER_32_TAPS);
+}
+
+TEST(ResamplePolyphase, NumOutputFramesFollowsFactor){
+    generate_sine(1000.0, 44100.0, 2);
+    uint32_t output_frames = resample(RESAMPLER_POLYPHASE_16, FACTOR_44100_TO_48000, 2);
+    uint32_t expected_frames = (uint32_t) (((uint64_t) SIGNAL_FRAMES << 16) / FACTOR_44100_TO_48000);
+    uint32_t delay_frames = BTSTACK_RESAMPLE_POLYPHASE_FILTER_16_TAPS / 2;
+    CHECK_TRUE(output_frames <= expected_frames);
+    CHECK_TRUE(output_frames + delay_frames + 1 >= expected_frames);
+}
+
+TEST(ResamplePolyphase, ConstantSignalIsKept){
+    btstack_resample_polyphase_t context;
+    btstack_resample_polyphase_init(&context, 2, BTSTACK_RESAMPLE_POLYPHASE_FILTER_32_TAPS);
+    btstack_resample_polyphase_set_factor(&context, 0x10123);
+    CHECK_EQUAL(15, btstack_resample_polyphase_get_delay_frames(&context));
+    for (uint32_t i = 0; i < BLOCK_FRAMES * 2; i++){
+        input_buffer[i] = 10000;
+    }
+    uint16_t output_frames = 0;
+    for (int i = 0; i < 4; i++){
+        output_frames = btstack_resample_polyphase_block(&context, input_buffer, BLOCK_FRAMES, output_buffer);
+    }
+    CHECK_TRUE(output_frames > 0);
+    for (uint16_t i = 0; i < output_frames * 2; i++){
+        CHECK_EQUAL(10000, output_buffer[i]);
+    }
+}
+
+TEST(ResamplePolyphase, THD_N){
+    const double frequencies[] = { 1000.0, 5000.0, 10000.0 };
+    const resampler_t resamplers[] = { RESAMPLER_LINEAR, RESAMPLER_POLYPHASE_8, RESAMPLER_POLYPHASE_16, RESAMPLER_POLYPHASE_32 };
+    double results[3][4];
+    printf("\nTHD+N 44.1 kHz -> 48 kHz [dB]:  linear   8 taps  16 taps  32 taps\n");
+    for (int i = 0; i < 3; i++){
+        printf("%5.0f Hz                      ", frequencies[i]);
+        for (int j = 0; j < 4; j++){
+            results[i][j] = measure_thd_n(resamplers[j], frequencies[i]);
+            printf(" %7.1f", results[i][j]);
+        }
+        printf("\n");
+    }
+    for (int i = 0; i < 3; i++){
+        // all filters are better than linear interpolation, 16 and 32 taps reach the Q14 coefficient noise floor
+        for (int j = 1; j < 4; j++){
+            CHECK_TRUE(results[i][j] < results[i][0]);
+        }
+        CHECK_TRUE(results[i][2] < -75.0);
+        CHECK_TRUE(results[i][3] < -75.0);
+    }
+    CHECK_TRUE(results[2][1] < results[2][0] - 40.0);
+}
+
+TEST(ResamplePolyphase, Throughput){
+    const resampler_t resamplers[] = { RESAMPLER_LINEAR, RESAMPLER_POLYPHASE_8, RESAMPLER_POLYPHASE_16, RESAMPLER_POLYPHASE_32 };
+    const char * names[] = { "linear", "8 taps", "16 taps", "32 taps" };
+    const int rounds = 10;
+    generate_sine(1000.0, 48000.0, 2);
+    printf("\nThroughput stereo, factor 1.001:\n");
+    for (int j = 0; j < 4; j++){
+        clock_t start = clock();
+        for (int i = 0; i < rounds; i++){
+            resample(resamplers[j], 0x10042, 2);
+        }
+        double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+        double frames_per_second = (seconds > 0.0) ? ((double) SIGNAL_FRAMES * rounds) / seconds : 0.0;
+        printf("%-8s %8.1f Mframes/s, %6.1f x realtime at 48 kHz\n", names[j], frames_per_second / 1e6, frames_per_second / 48000.0);
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -4,9 +4,24 @@
 #include "ad_parser.h"
 
 int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
-    // ad parser uses uint88_t length
-    if (size > 255) return 0;
+    // ad parser supports Extended Advertising data up to 1650 bytes
+    if (size > 1650) return 0;
     // test ad iterator by calling simple function that uses it
     ad_data_contains_uuid16(size, data, 0xffff);
+    // single pass matchers
+    static const uint16_t uuid16s[] = { 0x0000, 0x1800, 0xffff };
+    static const uint8_t uuid128s[32] = {
+        0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    };
+    uint8_t matched;
+    ad_data_match_uuid16s(size, data, uuid16s, 3, &matched);
+    ad_data_match_uuid128s(size, data, uuid128s, 2, NULL);
+    // indexer
+    ad_index_t index;
+    uint8_t data_len;
+    ad_index_build(&index, size, data);
+    ad_index_get_data(&index, 0xff, &data_len);
+    ad_index_contains_data_type(&index, 0x01);
     return 0;
 }
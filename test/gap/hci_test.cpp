@@ -15,6 +15,7 @@
 #include <bluetooth_company_id.h>
 
 #include "ble/gatt_client.h"
+#include "ble/le_device_db.h"
 #include "btstack_event.h"
 #include "hci_dump.h"
 #include "hci_dump_posix_fs.h"
@@ -63,6 +64,12 @@ static int hci_transport_test_can_send_now(uint8_t packet_type){
 }
 #endif
 
+// stub for sm.c, used by hci for the resolving list
+const uint8_t * gap_get_persistent_irk(void){
+    static const uint8_t irk[16] = { 0 };
+    return irk;
+}
+
 static int hci_transport_test_set_baudrate(uint32_t baudrate){
     return 0;
 }
@@ -540,6 +547,113 @@ TEST(HCI, hci_remove_le_device_db_entry_from_resolving_list) {
 TEST(HCI, gap_load_resolving_list_from_le_device_db) {
     gap_load_resolving_list_from_le_device_db();
 }
+
+static uint16_t resolving_list_num_added;
+static uint16_t resolving_list_num_removed;
+static uint16_t resolving_list_num_cleared;
+
+// complete HCI Commands until stack is idle, count resolving list operations
+static void simulate_resolving_list_controller(uint8_t resolving_list_size){
+    resolving_list_num_added = 0;
+    resolving_list_num_removed = 0;
+    resolving_list_num_cleared = 0;
+    // trigger hci_run with HCI_Command_Complete for NOP
+    transport_count_packets = 0;
+    uint8_t nop_complete[] = { HCI_EVENT_COMMAND_COMPLETE, 3, 1, 0, 0 };
+    packet_handler(HCI_EVENT_PACKET, nop_complete, sizeof(nop_complete));
+    while (transport_count_packets > 0){
+        uint16_t opcode = little_endian_read_16(transport_packets[0].buffer, 0);
+        transport_count_packets = 0;
+        switch (opcode){
+            case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_RESOLVING_LIST:
+                resolving_list_num_added++;
+                break;
+            case HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_RESOLVING_LIST:
+                resolving_list_num_removed++;
+                break;
+            case HCI_OPCODE_HCI_LE_CLEAR_RESOLVING_LIST:
+                resolving_list_num_cleared++;
+                break;
+            default:
+                break;
+        }
+        uint8_t command_complete[] = { HCI_EVENT_COMMAND_COMPLETE, 5, 1, 0, 0, ERROR_CODE_SUCCESS, resolving_list_size };
+        little_endian_store_16(command_complete, 3, opcode);
+        packet_handler(HCI_EVENT_PACKET, command_complete, sizeof(command_complete));
+    }
+}
+
+TEST(HCI, resolving_list_sync) {
+    // Controller supports address resolution and stores local IRK + 4 entries
+    hci_stack->local_supported_commands = 0xffffffff;
+    hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION;
+    le_device_db_init();
+    bd_addr_t addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x00};
+    sm_key_t irk;
+    memset(irk, 0x55, sizeof(irk));
+    uint8_t i;
+    for (i = 0; i < 8; i++){
+        addr[5] = i;
+        irk[0] = i;
+        CHECK_EQUAL(i, le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, irk));
+    }
+
+    // initial load: clear, local IRK + 4 most recently bonded devices
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(1, resolving_list_num_cleared);
+    CHECK_EQUAL(5, resolving_list_num_added);
+    CHECK_EQUAL(0, resolving_list_num_removed);
+    CHECK_EQUAL(4, hci_stack->le_resolving_list_count);
+    CHECK_EQUAL(LE_RESOLVING_LIST_DONE, hci_stack->le_resolving_list_state);
+    for (i = 0; i < 8; i++){
+        CHECK_EQUAL((i < 4) ? BD_ADDR_TYPE_UNKNOWN : BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[i].address_type);
+    }
+
+    // nothing changed: no commands
+    gap_load_resolving_list_from_le_device_db();
+    CHECK_EQUAL(LE_RESOLVING_LIST_DONE, hci_stack->le_resolving_list_state);
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(0, resolving_list_num_added + resolving_list_num_removed + resolving_list_num_cleared);
+
+    // evicted device 1 identified on connect gets added again, least recently used device 4 is evicted
+    le_device_db_mark_used(1);
+    hci_touch_le_device_db_entry_in_resolving_list(1);
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(0, resolving_list_num_cleared);
+    CHECK_EQUAL(1, resolving_list_num_added);
+    CHECK_EQUAL(1, resolving_list_num_removed);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[1].address_type);
+    CHECK_EQUAL(BD_ADDR_TYPE_UNKNOWN, hci_stack->le_resolving_list_entries[4].address_type);
+
+    // device 5 identified on connect is already in resolving list: no commands
+    le_device_db_mark_used(5);
+    hci_touch_le_device_db_entry_in_resolving_list(5);
+    CHECK_EQUAL(LE_RESOLVING_LIST_DONE, hci_stack->le_resolving_list_state);
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(0, resolving_list_num_added + resolving_list_num_removed + resolving_list_num_cleared);
+
+    // deleted bonding of device 6 gets removed using shadow copy, most recently used evicted device 4 is added again
+    le_device_db_remove(6);
+    gap_load_resolving_list_from_le_device_db();
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(0, resolving_list_num_cleared);
+    CHECK_EQUAL(1, resolving_list_num_added);
+    CHECK_EQUAL(1, resolving_list_num_removed);
+    CHECK_EQUAL(BD_ADDR_TYPE_UNKNOWN, hci_stack->le_resolving_list_entries[6].address_type);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[4].address_type);
+    CHECK_EQUAL(4, hci_stack->le_resolving_list_count);
+
+    // re-bonding with device 0 evicts device 4, not recently connected devices 1 and 5
+    le_device_db_mark_used(0);
+    hci_load_le_device_db_entry_into_resolving_list(0);
+    simulate_resolving_list_controller(5);
+    CHECK_EQUAL(1, resolving_list_num_added);
+    CHECK_EQUAL(1, resolving_list_num_removed);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[0].address_type);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[1].address_type);
+    CHECK_EQUAL(BD_ADDR_TYPE_UNKNOWN, hci_stack->le_resolving_list_entries[4].address_type);
+    CHECK_EQUAL(BD_ADDR_TYPE_LE_PUBLIC, hci_stack->le_resolving_list_entries[5].address_type);
+}
 #endif
 
 TEST(HCI, gap_privacy_client) {
@@ -875,6 +989,103 @@ TEST(HCI, handle_command_status_event) {
     }
 }
 
+static void simulate_vendor_event(void){
+    uint8_t packet[3] = { HCI_EVENT_VENDOR_SPECIFIC, 1, 0 };
+    packet_handler(HCI_EVENT_PACKET, packet, sizeof(packet));
+}
+
+static void drain_connection_commands(void){
+    for (uint8_t i = 0; i < 20; i++){
+        simulate_hci_command_complete(HCI_OPCODE_HCI_READ_RSSI, ERROR_CODE_UNKNOWN_HCI_COMMAND, 0);
+    }
+}
+
+TEST(HCI, command_complete_and_connection_api_visit_single_connection) {
+    // other events visit all connections
+    simulate_vendor_event();
+    drain_connection_commands();
+    uint32_t visits = hci_get_connection_visits_fuzz();
+    simulate_vendor_event();
+    CHECK(hci_get_connection_visits_fuzz() - visits >= 5);
+
+    // command complete without pending work doesn't visit any connection
+    visits = hci_get_connection_visits_fuzz();
+    drain_connection_commands();
+    CHECK_EQUAL(visits, hci_get_connection_visits_fuzz());
+
+    // read rssi only visits the addressed connection: once to send the command, once when done
+    CHECK_EQUAL(1, gap_read_rssi(0x03));
+    drain_connection_commands();
+    CHECK_EQUAL(2u, hci_get_connection_visits_fuzz() - visits);
+
+    // disconnect only visits the addressed connection
+    visits = hci_get_connection_visits_fuzz();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_disconnect(0x05));
+    drain_connection_commands();
+    CHECK_EQUAL(2u, hci_get_connection_visits_fuzz() - visits);
+}
+
+static void simulate_le_list_command_complete(uint16_t opcode, uint8_t num_hci_command_packets){
+    uint8_t packet[6];
+    packet[0] = HCI_EVENT_COMMAND_COMPLETE;
+    packet[1] = sizeof(packet) - 2;
+    packet[2] = num_hci_command_packets;
+    little_endian_store_16(packet, 3, opcode);
+    packet[5] = ERROR_CODE_SUCCESS;
+    packet_handler(HCI_EVENT_PACKET, packet, sizeof(packet));
+}
+
+// returns number of HCI command round trips until LE Create Connection is sent for 8 auto connection entries
+static uint16_t simulate_le_auto_connection_setup(uint8_t num_hci_command_packets){
+    // reset Controller credit with HCI_Command_Complete for NOP
+    simulate_le_list_command_complete(0, num_hci_command_packets);
+    transport_count_packets = 0;
+
+    bd_addr_t addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x00};
+    uint8_t i;
+    for (i = 0; i < 8; i++){
+        addr[5] = i;
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, gap_auto_connection_start(BD_ADDR_TYPE_LE_PUBLIC, addr));
+    }
+
+    uint16_t round_trips = 0;
+    while (round_trips < 20){
+        uint16_t num_commands = transport_count_packets;
+        CHECK_TRUE(num_commands > 0);
+        CHECK_TRUE(num_commands <= num_hci_command_packets);
+        uint16_t opcodes[MAX_HCI_PACKETS];
+        for (i = 0; i < num_commands; i++){
+            opcodes[i] = little_endian_read_16(transport_packets[i].buffer, 0);
+        }
+        round_trips++;
+        for (i = 0; i < num_commands; i++){
+            if (opcodes[i] == HCI_OPCODE_HCI_LE_CREATE_CONNECTION) {
+                return round_trips;
+            }
+        }
+        // Controller completes all outstanding commands at once
+        transport_count_packets = 0;
+        for (i = 0; i < num_commands; i++){
+            simulate_le_list_command_complete(opcodes[i], num_hci_command_packets - (num_commands - 1 - i));
+        }
+    }
+    return round_trips;
+}
+
+TEST(HCI, le_list_updates_single_command){
+    uint16_t round_trips = simulate_le_auto_connection_setup(1);
+    printf("Auto connection setup with 1 HCI command packet: %u round trips\n", round_trips);
+    // one round trip per list update, then LE Create Connection
+    CHECK_EQUAL(9, round_trips);
+}
+
+TEST(HCI, le_list_updates_pipelined){
+    uint16_t round_trips = simulate_le_auto_connection_setup(HCI_MAX_PIPELINED_COMMANDS);
+    printf("Auto connection setup with %u HCI command packets: %u round trips\n", HCI_MAX_PIPELINED_COMMANDS, round_trips);
+    // 8 list updates in 2 batches, then LE Create Connection
+    CHECK_EQUAL(3, round_trips);
+}
+
 int main (int argc, const char * argv[]){
     btstack_run_loop_init(btstack_run_loop_posix_get_instance());
     return CommandLineTestRunner::RunAllTests(argc, argv);
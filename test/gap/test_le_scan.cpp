@@ -16,6 +16,11 @@
 #include "hci_dump.h"
 #include "hci_dump_posix_fs.h"
 #include "btstack_debug.h"
+#include "btstack_run_loop_posix.h"
+#include "bluetooth_data_types.h"
+#include "ad_parser.h"
+#include "ble/gap_scan_cache.h"
+#include <time.h>
 
 typedef struct {
     uint8_t type;
@@ -31,6 +36,12 @@ static  void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t si
 
 static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
 
+// stub for sm.c, used by hci for the resolving list
+const uint8_t * gap_get_persistent_irk(void){
+    static const uint8_t irk[16] = { 0 };
+    return irk;
+}
+
 static int hci_transport_test_set_baudrate(uint32_t baudrate){
     return 0;
 }
@@ -132,6 +143,307 @@ TEST(GAP_LE, ScanStartParam){
     CHECK_HCI_COMMAND(&hci_le_set_scan_enable);
 }
 
+static uint16_t gap_advertising_reports;
+static uint16_t hci_advertising_reports;
+static uint16_t gap_extended_advertising_reports;
+static uint32_t manufacturer_data_len;
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+
+static void advertising_report_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    ad_context_t context;
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case GAP_EVENT_ADVERTISING_REPORT:
+            gap_advertising_reports++;
+            // parse advertising data like an application
+            for (ad_iterator_init(&context, gap_event_advertising_report_get_data_length(packet), gap_event_advertising_report_get_data(packet));
+                 ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+                if (ad_iterator_get_data_type(&context) != BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA) continue;
+                manufacturer_data_len += ad_iterator_get_data_len(&context);
+            }
+            break;
+        case GAP_EVENT_EXTENDED_ADVERTISING_REPORT:
+            gap_extended_advertising_reports++;
+            break;
+        case HCI_EVENT_LE_META:
+            if (hci_event_le_meta_get_subevent_code(packet) == HCI_SUBEVENT_LE_ADVERTISING_REPORT){
+                hci_advertising_reports++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// address 66:55:44:33:22:<address_lsb>, flags and manufacturer specific data with company id and counter
+static void simulate_advertising_report(uint8_t address_lsb, int8_t rssi, uint16_t company_id, uint8_t counter){
+    uint8_t packet[] = { HCI_EVENT_LE_META, 20, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 1,
+                         0x00, BD_ADDR_TYPE_LE_PUBLIC, address_lsb, 0x22, 0x33, 0x44, 0x55, 0x66,
+                         8, 2, BLUETOOTH_DATA_TYPE_FLAGS, 0x06, 4, BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA, 0, 0, counter,
+                         (uint8_t) rssi};
+    little_endian_store_16(packet, 18, company_id);
+    packet_handler(HCI_EVENT_PACKET, packet, sizeof(packet));
+}
+
+TEST_GROUP(GAP_LE_ADVERTISING_REPORT_FILTER){
+    void setup(void){
+        transport_count_packets = 0;
+        hci_init(&hci_transport_test, NULL);
+        hci_simulate_working_fuzz();
+        hci_event_callback_registration.callback = &advertising_report_handler;
+        hci_add_event_handler(&hci_event_callback_registration);
+        gap_start_scan();
+        gap_advertising_reports = 0;
+        hci_advertising_reports = 0;
+        gap_extended_advertising_reports = 0;
+    }
+    void teardown(void){
+        mock().clear();
+    }
+};
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, NoFilter){
+    simulate_advertising_report(0x01, -40, 0x0548, 0);
+    simulate_advertising_report(0x02, -90, 0x1234, 0);
+    CHECK_EQUAL(2, gap_advertising_reports);
+    CHECK_EQUAL(2, hci_advertising_reports);
+}
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, ManufacturerPrefix){
+    static const uint8_t company_id[] = { 0x48, 0x05 };
+    gap_advertising_report_filter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.rules = GAP_ADVERTISING_REPORT_FILTER_AD_TYPE;
+    filter.ad_type = BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    filter.ad_data_prefix = company_id;
+    filter.ad_data_prefix_len = sizeof(company_id);
+    gap_advertising_report_filter_add(&filter);
+    simulate_advertising_report(0x01, -40, 0x0548, 0);
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    CHECK_EQUAL(1, gap_advertising_reports);
+    CHECK_EQUAL(1, hci_advertising_reports);
+    gap_advertising_report_filter_remove(&filter);
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    CHECK_EQUAL(2, gap_advertising_reports);
+}
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, AddressAndRssi){
+    gap_advertising_report_filter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.rules = GAP_ADVERTISING_REPORT_FILTER_ADDRESS | GAP_ADVERTISING_REPORT_FILTER_RSSI;
+    filter.address_type = BD_ADDR_TYPE_LE_PUBLIC;
+    bd_addr_t address = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x01 };
+    memcpy(filter.address, address, 6);
+    filter.rssi_min = -60;
+    gap_advertising_report_filter_add(&filter);
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    simulate_advertising_report(0x01, -70, 0x1234, 0);
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    CHECK_EQUAL(1, gap_advertising_reports);
+}
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, DuplicateWindow){
+    gap_set_advertising_report_duplicate_window(10000);
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    simulate_advertising_report(0x01, -42, 0x1234, 0);
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    CHECK_EQUAL(2, gap_advertising_reports);
+    // changed data is reported
+    simulate_advertising_report(0x01, -40, 0x1234, 1);
+    CHECK_EQUAL(3, gap_advertising_reports);
+    gap_set_advertising_report_duplicate_window(0);
+    simulate_advertising_report(0x01, -40, 0x1234, 1);
+    CHECK_EQUAL(4, gap_advertising_reports);
+}
+
+// non-connectable extended advertising report from 66:55:44:33:22:<address_lsb>, SID 1, with data status in bits 5-6
+static void simulate_extended_advertising_report(uint8_t address_lsb, uint8_t data_status, const uint8_t * data, uint8_t data_len){
+    uint8_t packet[4 + 24 + 31];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = HCI_EVENT_LE_META;
+    packet[1] = 2 + 24 + data_len;
+    packet[2] = HCI_SUBEVENT_LE_EXTENDED_ADVERTISING_REPORT;
+    packet[3] = 1;
+    little_endian_store_16(packet, 4, data_status << 5);
+    packet[6] = BD_ADDR_TYPE_LE_PUBLIC;
+    const uint8_t address[] = { address_lsb, 0x22, 0x33, 0x44, 0x55, 0x66 };
+    memcpy(&packet[7], address, 6);
+    packet[13] = 0x01;  // primary phy
+    packet[14] = 0x02;  // secondary phy
+    packet[15] = 0x01;  // sid
+    packet[16] = 0x7f;  // tx power not available
+    packet[17] = 0xd8;  // rssi -40
+    packet[27] = data_len;
+    memcpy(&packet[28], data, data_len);
+    packet_handler(HCI_EVENT_PACKET, packet, 28 + data_len);
+}
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, ChainedExtendedReport){
+    static const uint8_t company_id[] = { 0x48, 0x05 };
+    // manufacturer specific data with 8 bytes split over two fragments
+    static const uint8_t fragment_1[] = { 2, BLUETOOTH_DATA_TYPE_FLAGS, 0x06, 9, BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA, 0x48, 0x05, 1, 2 };
+    static const uint8_t fragment_2[] = { 3, 4, 5, 6 };
+    static const uint8_t other_company[] = { 4, BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA, 0x34, 0x12, 0 };
+    gap_advertising_report_filter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.rules = GAP_ADVERTISING_REPORT_FILTER_AD_TYPE;
+    filter.ad_type = BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    filter.ad_data_prefix = company_id;
+    filter.ad_data_prefix_len = sizeof(company_id);
+    gap_advertising_report_filter_add(&filter);
+    gap_set_advertising_report_duplicate_window(10000);
+
+    // last fragment is delivered although it does not contain the company id
+    simulate_extended_advertising_report(0x01, 1, fragment_1, sizeof(fragment_1));
+    simulate_extended_advertising_report(0x01, 0, fragment_2, sizeof(fragment_2));
+    CHECK_EQUAL(2, gap_extended_advertising_reports);
+
+    // complete report of other advertiser is checked, chain of advertiser 1 is complete
+    simulate_extended_advertising_report(0x02, 0, other_company, sizeof(other_company));
+    simulate_extended_advertising_report(0x01, 0, other_company, sizeof(other_company));
+    CHECK_EQUAL(2, gap_extended_advertising_reports);
+
+    // chain is not affected by duplicate suppression
+    simulate_extended_advertising_report(0x01, 1, fragment_1, sizeof(fragment_1));
+    simulate_extended_advertising_report(0x01, 0, fragment_2, sizeof(fragment_2));
+    CHECK_EQUAL(4, gap_extended_advertising_reports);
+
+    gap_set_advertising_report_duplicate_window(0);
+    gap_advertising_report_filter_remove(&filter);
+}
+
+TEST(GAP_LE_ADVERTISING_REPORT_FILTER, Benchmark){
+    const uint32_t num_reports = 100000;
+    static const uint8_t company_id[] = { 0x48, 0x05 };
+    gap_advertising_report_filter_t filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.rules = GAP_ADVERTISING_REPORT_FILTER_AD_TYPE;
+    filter.ad_type = BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    filter.ad_data_prefix = company_id;
+    filter.ad_data_prefix_len = sizeof(company_id);
+    uint32_t i;
+    int pass;
+    // measure report processing only
+    hci_dump_enable_packet_log(false);
+    for (pass = 0; pass < 2; pass++){
+        if (pass == 1){
+            gap_advertising_report_filter_add(&filter);
+        }
+        clock_t start = clock();
+        for (i = 0; i < num_reports; i++){
+            simulate_advertising_report((uint8_t) i, -40, 0x1234, (uint8_t) i);
+        }
+        double ns_per_report = (double) (clock() - start) * 1e9 / CLOCKS_PER_SEC / num_reports;
+        printf("Irrelevant advertising reports %s filter: %.0f ns per report\n", pass ? "with" : "without", ns_per_report);
+    }
+    hci_dump_enable_packet_log(true);
+    CHECK_EQUAL(num_reports & 0xffff, gap_advertising_reports);
+}
+
+// scan response with complete local name "<name_char>"
+static void simulate_scan_response(uint8_t address_lsb, int8_t rssi, char name_char){
+    uint8_t packet[] = { HCI_EVENT_LE_META, 15, HCI_SUBEVENT_LE_ADVERTISING_REPORT, 1,
+                         0x04, BD_ADDR_TYPE_LE_PUBLIC, address_lsb, 0x22, 0x33, 0x44, 0x55, 0x66,
+                         3, 2, BLUETOOTH_DATA_TYPE_COMPLETE_LOCAL_NAME, (uint8_t) name_char,
+                         (uint8_t) rssi};
+    packet_handler(HCI_EVENT_PACKET, packet, sizeof(packet));
+}
+
+#define SCAN_CACHE_NUM_ENTRIES 2
+static gap_scan_cache_entry_t scan_cache_entries[SCAN_CACHE_NUM_ENTRIES];
+static uint16_t scan_cache_reports[3];
+static const gap_scan_cache_entry_t * scan_cache_last_entry;
+
+static void scan_cache_callback(gap_scan_cache_reason_t reason, const gap_scan_cache_entry_t * entry){
+    scan_cache_reports[reason]++;
+    scan_cache_last_entry = entry;
+}
+
+TEST_GROUP(GAP_SCAN_CACHE){
+    void setup(void){
+        transport_count_packets = 0;
+        hci_init(&hci_transport_test, NULL);
+        hci_simulate_working_fuzz();
+        gap_scan_cache_init(scan_cache_entries, SCAN_CACHE_NUM_ENTRIES);
+        gap_scan_cache_register_callback(&scan_cache_callback);
+        gap_start_scan();
+        memset(scan_cache_reports, 0, sizeof(scan_cache_reports));
+        scan_cache_last_entry = NULL;
+    }
+    void teardown(void){
+        gap_scan_cache_deinit();
+        mock().clear();
+    }
+};
+
+TEST(GAP_SCAN_CACHE, NewDeviceAndChange){
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    CHECK_EQUAL(1, scan_cache_reports[GAP_SCAN_CACHE_REASON_NEW_DEVICE]);
+    CHECK_EQUAL(0, scan_cache_reports[GAP_SCAN_CACHE_REASON_CHANGED]);
+    simulate_advertising_report(0x01, -40, 0x1234, 1);
+    CHECK_EQUAL(1, scan_cache_reports[GAP_SCAN_CACHE_REASON_CHANGED]);
+    CHECK_EQUAL(1, gap_scan_cache_get_num_advertisers());
+    // only report new devices
+    gap_scan_cache_set_reporting_policy(GAP_SCAN_CACHE_REPORT_NEW_DEVICE, 0);
+    simulate_advertising_report(0x01, -40, 0x1234, 2);
+    simulate_advertising_report(0x02, -40, 0x1234, 2);
+    CHECK_EQUAL(2, scan_cache_reports[GAP_SCAN_CACHE_REASON_NEW_DEVICE]);
+    CHECK_EQUAL(1, scan_cache_reports[GAP_SCAN_CACHE_REASON_CHANGED]);
+}
+
+TEST(GAP_SCAN_CACHE, MergedPayloadAndRssi){
+    bd_addr_t address = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x01 };
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    simulate_scan_response(0x01, -50, 'A');
+    simulate_advertising_report(0x01, -60, 0x1234, 0);
+    CHECK_EQUAL(1, scan_cache_reports[GAP_SCAN_CACHE_REASON_CHANGED]);
+    const gap_scan_cache_entry_t * entry = gap_scan_cache_lookup(BD_ADDR_TYPE_LE_PUBLIC, address, GAP_SCAN_CACHE_SID_NONE);
+    CHECK(entry != NULL);
+    CHECK_EQUAL(8, entry->advertising_data_len);
+    CHECK_EQUAL(3, entry->scan_response_data_len);
+    CHECK_EQUAL(-60, entry->rssi_min);
+    CHECK_EQUAL(-40, entry->rssi_max);
+    CHECK_EQUAL(-60, entry->rssi_last);
+    CHECK_EQUAL(-50, gap_scan_cache_entry_get_rssi_average(entry));
+    CHECK_EQUAL(3, entry->num_reports);
+    // merged payload can be parsed as a whole
+    ad_context_t context;
+    bool name_found = false;
+    for (ad_iterator_init(&context, entry->advertising_data_len + entry->scan_response_data_len, entry->data);
+         ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        if (ad_iterator_get_data_type(&context) == BLUETOOTH_DATA_TYPE_COMPLETE_LOCAL_NAME){
+            name_found = ad_iterator_get_data(&context)[0] == 'A';
+        }
+    }
+    CHECK(name_found);
+    // changed scan response
+    simulate_scan_response(0x01, -50, 'B');
+    CHECK_EQUAL(2, scan_cache_reports[GAP_SCAN_CACHE_REASON_CHANGED]);
+    CHECK_EQUAL('B', entry->data[entry->advertising_data_len + 2]);
+}
+
+TEST(GAP_SCAN_CACHE, LruEviction){
+    bd_addr_t address_1 = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x01 };
+    bd_addr_t address_2 = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x02 };
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    simulate_advertising_report(0x01, -40, 0x1234, 0);
+    // device 2 is least recently seen
+    simulate_advertising_report(0x03, -40, 0x1234, 0);
+    CHECK_EQUAL(2, gap_scan_cache_get_num_advertisers());
+    CHECK(gap_scan_cache_lookup(BD_ADDR_TYPE_LE_PUBLIC, address_1, GAP_SCAN_CACHE_SID_NONE) != NULL);
+    CHECK(gap_scan_cache_lookup(BD_ADDR_TYPE_LE_PUBLIC, address_2, GAP_SCAN_CACHE_SID_NONE) == NULL);
+    // evicted device is new again
+    simulate_advertising_report(0x02, -40, 0x1234, 0);
+    CHECK_EQUAL(4, scan_cache_reports[GAP_SCAN_CACHE_REASON_NEW_DEVICE]);
+    CHECK(gap_scan_cache_lookup(BD_ADDR_TYPE_LE_PUBLIC, address_1, GAP_SCAN_CACHE_SID_NONE) == NULL);
+    gap_scan_cache_clear();
+    CHECK_EQUAL(0, gap_scan_cache_get_num_advertisers());
+}
+
 int main (int argc, const char * argv[]){
     // log into file using HCI_DUMP_PACKETLOGGER format
     const char * pklg_path = "hci_dump.pklg";
@@ -139,5 +451,7 @@ int main (int argc, const char * argv[]){
     hci_dump_init(hci_dump_posix_fs_get_instance());
     printf("Packet Log: %s\n", pklg_path);
 
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
@@ -325,6 +325,60 @@ TEST(DEVICE_INFORMATION_SERVICE_CLIENT, query_service_full_setup_no_error){
     CHECK_EQUAL(true, pnp_id);
 }
 
+TEST(DEVICE_INFORMATION_SERVICE_CLIENT, query_service_full_setup_default_mtu_read_by_uuid){
+    setup_full_service();
+
+    uint8_t status = device_information_service_client_query(con_handle, &gatt_client_event_handler);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    mock_gatt_client_run();
+    CHECK_EQUAL(true, connected);
+    CHECK_EQUAL(true, manufacturer_name);
+    CHECK_EQUAL(true, pnp_id);
+
+    // characteristic discovery and Read Multiple Variable would take more requests
+    CHECK_EQUAL(0, mock_gatt_client_get_num_coalesced_reads());
+}
+
+TEST(DEVICE_INFORMATION_SERVICE_CLIENT, query_service_full_setup_mtu_below_min_read_by_uuid){
+    setup_full_service();
+    mock_gatt_client_set_mtu(99);
+
+    uint8_t status = device_information_service_client_query(con_handle, &gatt_client_event_handler);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    mock_gatt_client_run();
+    CHECK_EQUAL(true, manufacturer_name);
+    CHECK_EQUAL(true, pnp_id);
+    CHECK_EQUAL(0, mock_gatt_client_get_num_coalesced_reads());
+}
+
+TEST(DEVICE_INFORMATION_SERVICE_CLIENT, query_service_full_setup_min_mtu_read_multiple){
+    setup_full_service();
+    // values truncated in the Read Multiple Variable Response are read again by GATT Client
+    mock_gatt_client_set_mtu(100);
+
+    uint8_t status = device_information_service_client_query(con_handle, &gatt_client_event_handler);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    mock_gatt_client_run();
+    CHECK_EQUAL(true, connected);
+
+    CHECK_EQUAL(true, manufacturer_name);
+    CHECK_EQUAL(true, model_number);
+    CHECK_EQUAL(true, serial_number);
+    CHECK_EQUAL(true, hardware_revision);
+    CHECK_EQUAL(true, firmware_revision);
+    CHECK_EQUAL(true, software_revision);
+
+    CHECK_EQUAL(true, system_id);
+    CHECK_EQUAL(true, ieee_regulatory_certification);
+    CHECK_EQUAL(true, pnp_id);
+
+    // all discovered characteristics are read with coalesced reads
+    CHECK_EQUAL(9, mock_gatt_client_get_num_coalesced_reads());
+}
+
 TEST(DEVICE_INFORMATION_SERVICE_CLIENT, unhandled_gatt_event_when_connected){
     setup_service(true);
     uint8_t status = device_information_service_client_query(con_handle, &gatt_client_event_handler);
@@ -0,0 +1,702 @@
+// Benchmark for GATT Client and ATT Server in a loopback setup
+//
+// GATT Client and ATT Server run in the same process and are connected through a simulated L2CAP layer:
+// ATT PDUs sent on a client connection are delivered to the corresponding server connection and vice versa.
+// Each scenario measures wall clock time and process CPU time and reports operations per second, CPU time
+// per operation and ATT PDUs per operation:
+// - discovery of all services, characteristics and descriptors of databases with different sizes
+// - bulk reads of all characteristic values
+// - long writes via Prepare Write / Execute Write
+// - notification stream from server to client
+// - reads on several concurrent connections
+//
+// The 'test' target runs all scenarios with few iterations as part of the unit tests, the 'benchmark' target
+// builds without sanitizers and runs more iterations, see BENCHMARK_SCALE.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "btstack_debug.h"
+#include "bluetooth_gatt.h"
+#include "l2cap.h"
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "ble/att_dispatch.h"
+#include "ble/att_server.h"
+#include "ble/gatt_client.h"
+#include "ble/sm.h"
+#include "btstack_run_loop.h"
+
+// number of iterations is multiplied by BENCHMARK_SCALE
+#ifndef BENCHMARK_SCALE
+#define BENCHMARK_SCALE 1
+#endif
+
+#define ATT_MTU                     247
+#define MAX_CONNECTIONS             8
+#define CLIENT_CON_HANDLE_BASE      0x0040
+#define SERVER_CON_HANDLE_BASE      0x0080
+
+#define CHARACTERISTIC_VALUE_SIZE   20
+#define LONG_VALUE_SIZE             512
+#define MAX_SERVICES                64
+#define MAX_CHARACTERISTICS         512
+
+#define LOOPBACK_QUEUE_SIZE         32
+#define LOOPBACK_INCOMING_PDU_OFFSET (HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE)
+
+// mock hci / gap / sm
+static hci_connection_t      loopback_hci_connections[2 * MAX_CONNECTIONS];
+static btstack_linked_list_t loopback_hci_connection_list;
+static btstack_linked_list_t loopback_hci_event_handlers;
+
+static hci_connection_t * loopback_hci_connection_for_index(uint16_t index, bool server){
+    return &loopback_hci_connections[(server ? MAX_CONNECTIONS : 0) + index];
+}
+
+hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &loopback_hci_connection_list);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * hci_connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (hci_connection->con_handle == con_handle) return hci_connection;
+    }
+    return NULL;
+}
+hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t addr, bd_addr_type_t addr_type){
+    UNUSED(addr);
+    UNUSED(addr_type);
+    return NULL;
+}
+void hci_connections_get_iterator(btstack_linked_list_iterator_t * it){
+    btstack_linked_list_iterator_init(it, &loopback_hci_connection_list);
+}
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    btstack_linked_list_add_tail(&loopback_hci_event_handlers, (btstack_linked_item_t *) callback_handler);
+}
+bool hci_can_send_acl_le_packet_now(void){
+    return true;
+}
+void hci_halting_defer(void){
+}
+void hci_remove_le_device_db_entry_from_resolving_list(uint16_t le_device_db_index){
+    UNUSED(le_device_db_index);
+}
+bool gap_authenticated(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+authorization_state_t gap_authorization_state(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return AUTHORIZATION_UNKNOWN;
+}
+bool gap_bonded(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+bool gap_secure_connection(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+gap_connection_type_t gap_get_connection_type(hci_con_handle_t con_handle){
+    return (hci_connection_for_handle(con_handle) != NULL) ? GAP_CONNECTION_LE : GAP_CONNECTION_INVALID;
+}
+uint8_t gap_encryption_key_size(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return 0;
+}
+bool gap_reconnect_security_setup_active(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+int gap_request_connection_parameter_update(hci_con_handle_t con_handle, uint16_t conn_interval_min,
+    uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout){
+    UNUSED(con_handle);
+    UNUSED(conn_interval_min);
+    UNUSED(conn_interval_max);
+    UNUSED(conn_latency);
+    UNUSED(supervision_timeout);
+    return 0;
+}
+void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+void sm_request_pairing(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+}
+int sm_cmac_ready(void){
+    return 0;
+}
+void sm_cmac_signed_write_start(const sm_key_t key, uint8_t opcode, uint16_t attribute_handle, uint16_t message_len, const uint8_t * message, uint32_t sign_counter, void (*done_callback)(uint8_t * hash)){
+    UNUSED(key);
+    UNUSED(opcode);
+    UNUSED(attribute_handle);
+    UNUSED(message_len);
+    UNUSED(message);
+    UNUSED(sign_counter);
+    UNUSED(done_callback);
+}
+irk_lookup_state_t sm_identity_resolving_state(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return IRK_LOOKUP_FAILED;
+}
+int sm_le_device_index(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return -1;
+}
+void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    UNUSED(timer);
+    UNUSED(timeout_in_ms);
+}
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+    UNUSED(timer);
+    UNUSED(process);
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    return 1;
+}
+void * btstack_run_loop_get_timer_context(btstack_timer_source_t * timer){
+    return timer->context;
+}
+uint32_t btstack_run_loop_get_time_ms(void){
+    return 0;
+}
+void btstack_run_loop_execute_on_main_thread(btstack_context_callback_registration_t * callback_registration){
+    callback_registration->callback(callback_registration->context);
+}
+void btstack_crypto_aes128_cmac_generator(btstack_crypto_aes128_cmac_t * request, const uint8_t * key, uint16_t size, uint8_t (*get_byte_callback)(uint16_t pos), uint8_t * hash, void (* callback)(void * arg), void * callback_arg){
+    UNUSED(request);
+    UNUSED(key);
+    UNUSED(size);
+    UNUSED(get_byte_callback);
+    UNUSED(hash);
+    UNUSED(callback);
+    UNUSED(callback_arg);
+}
+
+// simulated link, PDUs are queued and delivered to the peer connection one at a time
+typedef struct {
+    hci_con_handle_t con_handle;
+    uint16_t len;
+    uint8_t  data[ATT_MTU];
+} loopback_pdu_t;
+
+static loopback_pdu_t loopback_queue[LOOPBACK_QUEUE_SIZE];
+static uint16_t       loopback_queue_head;
+static uint16_t       loopback_queue_count;
+static uint32_t       loopback_num_pdus;
+
+static btstack_packet_handler_t att_fixed_channel_packet_handler;
+static bool     att_fixed_channel_can_send_now_requested;
+static uint8_t  att_fixed_channel_outgoing_buffer[ATT_MTU];
+
+static hci_con_handle_t loopback_peer_con_handle(hci_con_handle_t con_handle){
+    if (con_handle >= SERVER_CON_HANDLE_BASE){
+        return con_handle - SERVER_CON_HANDLE_BASE + CLIENT_CON_HANDLE_BASE;
+    }
+    return con_handle - CLIENT_CON_HANDLE_BASE + SERVER_CON_HANDLE_BASE;
+}
+
+void l2cap_register_fixed_channel(btstack_packet_handler_t packet_handler, uint16_t channel_id){
+    UNUSED(channel_id);
+    att_fixed_channel_packet_handler = packet_handler;
+}
+bool l2cap_can_send_fixed_channel_packet_now(hci_con_handle_t con_handle, uint16_t channel_id){
+    UNUSED(con_handle);
+    UNUSED(channel_id);
+    return loopback_queue_count < LOOPBACK_QUEUE_SIZE;
+}
+void l2cap_request_can_send_fix_channel_now_event(hci_con_handle_t con_handle, uint16_t channel_id){
+    UNUSED(con_handle);
+    UNUSED(channel_id);
+    att_fixed_channel_can_send_now_requested = true;
+}
+void l2cap_reserve_packet_buffer(void){
+}
+void l2cap_release_packet_buffer(void){
+}
+uint8_t * l2cap_get_outgoing_buffer(void){
+    return att_fixed_channel_outgoing_buffer;
+}
+uint8_t l2cap_send_prepared_connectionless(hci_con_handle_t con_handle, uint16_t cid, uint16_t len){
+    UNUSED(cid);
+    CHECK(loopback_queue_count < LOOPBACK_QUEUE_SIZE);
+    CHECK(len <= ATT_MTU);
+    loopback_pdu_t * pdu = &loopback_queue[(loopback_queue_head + loopback_queue_count) % LOOPBACK_QUEUE_SIZE];
+    pdu->con_handle = loopback_peer_con_handle(con_handle);
+    pdu->len = len;
+    memcpy(pdu->data, att_fixed_channel_outgoing_buffer, len);
+    loopback_queue_count++;
+    return ERROR_CODE_SUCCESS;
+}
+uint16_t l2cap_max_le_mtu(void){
+    return ATT_MTU;
+}
+
+// deliver next PDU or Can Send Now event, @return false if idle
+static bool loopback_step(void){
+    if (loopback_queue_count > 0){
+        // GATT Client creates events in place, provide pre-buffer and HCI ACL + L2CAP headers like HCI
+        static uint8_t incoming_buffer[LOOPBACK_INCOMING_PDU_OFFSET + ATT_MTU];
+        const loopback_pdu_t * pdu = &loopback_queue[loopback_queue_head];
+        hci_con_handle_t con_handle = pdu->con_handle;
+        uint16_t len = pdu->len;
+        memcpy(&incoming_buffer[LOOPBACK_INCOMING_PDU_OFFSET], pdu->data, len);
+        loopback_queue_head = (loopback_queue_head + 1) % LOOPBACK_QUEUE_SIZE;
+        loopback_queue_count--;
+        loopback_num_pdus++;
+        (*att_fixed_channel_packet_handler)(ATT_DATA_PACKET, con_handle, &incoming_buffer[LOOPBACK_INCOMING_PDU_OFFSET], len);
+        return true;
+    }
+    if (att_fixed_channel_can_send_now_requested){
+        att_fixed_channel_can_send_now_requested = false;
+        uint8_t event[4] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 0, 0 };
+        little_endian_store_16(event, 2, L2CAP_CID_ATTRIBUTE_PROTOCOL);
+        (*att_fixed_channel_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+        return true;
+    }
+    return false;
+}
+
+static void loopback_run(void){
+    while (loopback_step()){
+    }
+}
+
+static void loopback_emit_hci_event(uint8_t * event, uint16_t size){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &loopback_hci_event_handlers);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        btstack_packet_callback_registration_t * callback = (btstack_packet_callback_registration_t *) btstack_linked_list_iterator_next(&it);
+        (*callback->callback)(HCI_EVENT_PACKET, 0, event, size);
+    }
+}
+
+static void loopback_connect(hci_connection_t * hci_connection, hci_con_handle_t con_handle, uint8_t role){
+    memset(hci_connection, 0, sizeof(hci_connection_t));
+    hci_connection->con_handle = con_handle;
+    hci_connection->address_type = BD_ADDR_TYPE_LE_PUBLIC;
+    hci_connection->role = (hci_role_t) role;
+    btstack_linked_list_add_tail(&loopback_hci_connection_list, (btstack_linked_item_t *) hci_connection);
+
+    uint8_t event[36];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_META_GAP;
+    event[1] = sizeof(event) - 2;
+    event[2] = GAP_SUBEVENT_LE_CONNECTION_COMPLETE;
+    little_endian_store_16(event, 4, con_handle);
+    event[6] = role;
+    event[8] = (uint8_t) con_handle;
+    loopback_emit_hci_event(event, sizeof(event));
+}
+
+static void loopback_disconnect(hci_connection_t * hci_connection){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    event[1] = 4;
+    event[2] = 0;
+    little_endian_store_16(event, 3, hci_connection->con_handle);
+    event[5] = ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION;
+    loopback_emit_hci_event(event, sizeof(event));
+    btstack_linked_list_remove(&loopback_hci_connection_list, (btstack_linked_item_t *) hci_connection);
+}
+
+static hci_con_handle_t client_con_handle(uint16_t index){
+    return CLIENT_CON_HANDLE_BASE + index;
+}
+
+// ATT Server database
+static uint8_t  characteristic_value[CHARACTERISTIC_VALUE_SIZE];
+static uint16_t long_value_handle;
+static uint16_t notification_value_handle;
+static uint16_t num_long_value_bytes_written;
+
+static uint16_t att_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(attribute_handle);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    return 0;
+}
+
+static int att_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(offset);
+    UNUSED(buffer);
+    if ((attribute_handle == long_value_handle) && (transaction_mode == ATT_TRANSACTION_MODE_ACTIVE)){
+        num_long_value_bytes_written += buffer_size;
+    }
+    return 0;
+}
+
+// @return number of attributes
+static uint16_t setup_database(uint16_t num_services, uint16_t num_characteristics_per_service){
+    att_db_util_init();
+    att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ACCESS);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_GAP_DEVICE_NAME, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, (uint8_t *) "Benchmark", 9);
+    uint16_t i;
+    uint16_t j;
+    for (i=0;i<num_services;i++){
+        att_db_util_add_service_uuid16(0xff00 + i);
+        for (j=0;j<num_characteristics_per_service;j++){
+            // every fourth characteristic supports notifications
+            uint16_t properties = ATT_PROPERTY_READ | ATT_PROPERTY_WRITE;
+            if ((j & 3) == 0){
+                properties |= ATT_PROPERTY_NOTIFY;
+            }
+            att_db_util_add_characteristic_uuid16(0xfe00 + j, properties, ATT_SECURITY_NONE, ATT_SECURITY_NONE, characteristic_value, sizeof(characteristic_value));
+        }
+    }
+    // dynamic characteristics for long writes and notification stream
+    att_db_util_add_service_uuid16(0xfd00);
+    long_value_handle = att_db_util_add_characteristic_uuid16(0xfd01, ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+    notification_value_handle = att_db_util_add_characteristic_uuid16(0xfd02, ATT_PROPERTY_NOTIFY | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, NULL, 0);
+    att_set_db(att_db_util_get_address());
+
+    // count attributes
+    uint16_t num_attributes = 0;
+    const uint8_t * attribute = att_db_util_get_address() + 1;
+    while (little_endian_read_16(attribute, 0) != 0){
+        num_attributes++;
+        attribute += little_endian_read_16(attribute, 0);
+    }
+    return num_attributes;
+}
+
+// GATT Client
+typedef struct {
+    bool     query_active;
+    uint8_t  query_status;
+    uint16_t num_services;
+    uint16_t num_characteristics;
+    uint16_t num_descriptors;
+    uint32_t num_values;
+    uint32_t num_notifications;
+} client_state_t;
+
+static client_state_t          client_states[MAX_CONNECTIONS];
+static gatt_client_service_t   services[MAX_SERVICES];
+static gatt_client_characteristic_t characteristics[MAX_CHARACTERISTICS];
+static gatt_client_notification_t   notification_listener;
+
+static client_state_t * client_state_for_con_handle(hci_con_handle_t con_handle){
+    uint16_t index = con_handle - CLIENT_CON_HANDLE_BASE;
+    CHECK(index < MAX_CONNECTIONS);
+    return &client_states[index];
+}
+
+static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint8_t * packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    UNUSED(size);
+    client_state_t * state;
+    switch (hci_event_packet_get_type(packet)){
+        case GATT_EVENT_SERVICE_QUERY_RESULT:
+            state = client_state_for_con_handle(gatt_event_service_query_result_get_handle(packet));
+            CHECK(state->num_services < MAX_SERVICES);
+            gatt_event_service_query_result_get_service(packet, &services[state->num_services++]);
+            break;
+        case GATT_EVENT_CHARACTERISTIC_QUERY_RESULT:
+            state = client_state_for_con_handle(gatt_event_characteristic_query_result_get_handle(packet));
+            CHECK(state->num_characteristics < MAX_CHARACTERISTICS);
+            gatt_event_characteristic_query_result_get_characteristic(packet, &characteristics[state->num_characteristics++]);
+            break;
+        case GATT_EVENT_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY_RESULT:
+            state = client_state_for_con_handle(gatt_event_all_characteristic_descriptors_query_result_get_handle(packet));
+            state->num_descriptors++;
+            break;
+        case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
+            state = client_state_for_con_handle(gatt_event_characteristic_value_query_result_get_handle(packet));
+            CHECK_EQUAL(CHARACTERISTIC_VALUE_SIZE, gatt_event_characteristic_value_query_result_get_value_length(packet));
+            state->num_values++;
+            break;
+        case GATT_EVENT_NOTIFICATION:
+            state = client_state_for_con_handle(gatt_event_notification_get_handle(packet));
+            state->num_notifications++;
+            break;
+        case GATT_EVENT_QUERY_COMPLETE:
+            state = client_state_for_con_handle(gatt_event_query_complete_get_handle(packet));
+            state->query_active = false;
+            state->query_status = gatt_event_query_complete_get_att_status(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void client_query_started(hci_con_handle_t con_handle, uint8_t status){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    client_state_for_con_handle(con_handle)->query_active = true;
+}
+
+static void client_wait_for_query_complete(hci_con_handle_t con_handle){
+    client_state_t * state = client_state_for_con_handle(con_handle);
+    while (state->query_active){
+        CHECK_TRUE(loopback_step());
+    }
+    CHECK_EQUAL(ATT_ERROR_SUCCESS, state->query_status);
+}
+
+// measurement
+typedef struct {
+    struct timespec wall_start;
+    struct timespec cpu_start;
+    uint32_t num_pdus_start;
+} benchmark_t;
+
+static uint64_t benchmark_timespec_ns(const struct timespec * ts){
+    return ((uint64_t) ts->tv_sec * 1000000000u) + (uint64_t) ts->tv_nsec;
+}
+
+static void benchmark_start(benchmark_t * benchmark){
+    benchmark->num_pdus_start = loopback_num_pdus;
+    clock_gettime(CLOCK_MONOTONIC, &benchmark->wall_start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &benchmark->cpu_start);
+}
+
+static void benchmark_report(benchmark_t * benchmark, const char * name, uint32_t num_ops){
+    struct timespec wall_end;
+    struct timespec cpu_end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    CHECK(num_ops > 0);
+    uint64_t wall_ns = benchmark_timespec_ns(&wall_end) - benchmark_timespec_ns(&benchmark->wall_start);
+    uint64_t cpu_ns  = benchmark_timespec_ns(&cpu_end)  - benchmark_timespec_ns(&benchmark->cpu_start);
+    uint32_t num_pdus = loopback_num_pdus - benchmark->num_pdus_start;
+    double ops_per_sec = (wall_ns > 0) ? ((double) num_ops * 1e9 / (double) wall_ns) : 0.0;
+    printf("%-32s %8u ops %12.0f ops/s %10.3f us CPU/op %7.2f PDUs/op\n", name, num_ops, ops_per_sec,
+           (double) cpu_ns / 1000.0 / (double) num_ops, (double) num_pdus / (double) num_ops);
+}
+
+TEST_GROUP(GATT_BENCHMARK){
+    uint16_t num_connections;
+
+    void setup(void){
+        memset(client_states, 0, sizeof(client_states));
+        loopback_queue_head  = 0;
+        loopback_queue_count = 0;
+        att_fixed_channel_can_send_now_requested = false;
+        num_connections = 0;
+        memset(characteristic_value, 0x55, sizeof(characteristic_value));
+    }
+
+    void teardown(void){
+        loopback_run();
+        uint16_t i;
+        for (i=0;i<num_connections;i++){
+            loopback_disconnect(loopback_hci_connection_for_index(i, false));
+            loopback_disconnect(loopback_hci_connection_for_index(i, true));
+        }
+    }
+
+    void connect(uint16_t count){
+        CHECK(count <= MAX_CONNECTIONS);
+        uint16_t i;
+        for (i=0;i<count;i++){
+            loopback_connect(loopback_hci_connection_for_index(i, false), client_con_handle(i), HCI_ROLE_MASTER);
+            loopback_connect(loopback_hci_connection_for_index(i, true), loopback_peer_con_handle(client_con_handle(i)), HCI_ROLE_SLAVE);
+        }
+        num_connections = count;
+    }
+
+    void discover_all(hci_con_handle_t con_handle){
+        client_state_t * state = client_state_for_con_handle(con_handle);
+        state->num_services = 0;
+        state->num_characteristics = 0;
+        state->num_descriptors = 0;
+        client_query_started(con_handle, gatt_client_discover_primary_services(&handle_gatt_client_event, con_handle));
+        client_wait_for_query_complete(con_handle);
+        uint16_t i;
+        for (i=0;i<state->num_services;i++){
+            client_query_started(con_handle, gatt_client_discover_characteristics_for_service(&handle_gatt_client_event, con_handle, &services[i]));
+            client_wait_for_query_complete(con_handle);
+        }
+        for (i=0;i<state->num_characteristics;i++){
+            // descriptors only exist for characteristics that support notifications
+            if ((characteristics[i].properties & ATT_PROPERTY_NOTIFY) == 0) continue;
+            client_query_started(con_handle, gatt_client_discover_characteristic_descriptors(&handle_gatt_client_event, con_handle, &characteristics[i]));
+            client_wait_for_query_complete(con_handle);
+        }
+    }
+
+    // @return number of readable characteristics found by discovery
+    uint16_t discover_readable_characteristics(hci_con_handle_t con_handle){
+        discover_all(con_handle);
+        uint16_t num_readable = 0;
+        uint16_t i;
+        for (i=0;i<client_state_for_con_handle(con_handle)->num_characteristics;i++){
+            if ((characteristics[i].properties & ATT_PROPERTY_READ) == 0) continue;
+            if (characteristics[i].uuid16 == ORG_BLUETOOTH_CHARACTERISTIC_GAP_DEVICE_NAME) continue;
+            characteristics[num_readable++] = characteristics[i];
+        }
+        return num_readable;
+    }
+};
+
+TEST(GATT_BENCHMARK, discovery){
+    const uint16_t num_services[] = { 2, 8, 32 };
+    connect(1);
+    hci_con_handle_t con_handle = client_con_handle(0);
+    uint16_t i;
+    for (i=0;i<sizeof(num_services)/sizeof(num_services[0]);i++){
+        uint16_t num_attributes = setup_database(num_services[i], 8);
+        uint32_t num_ops = 10 * BENCHMARK_SCALE;
+        char name[40];
+        snprintf(name, sizeof(name), "discovery %u attributes", num_attributes);
+        benchmark_t benchmark;
+        benchmark_start(&benchmark);
+        uint32_t op;
+        for (op=0;op<num_ops;op++){
+            discover_all(con_handle);
+        }
+        benchmark_report(&benchmark, name, num_ops);
+        // GAP + Services + dynamic service
+        CHECK_EQUAL(num_services[i] + 2, client_states[0].num_services);
+        CHECK_EQUAL(num_services[i] * 8 + 3, client_states[0].num_characteristics);
+        // CCC of every fourth characteristic + dynamic characteristic with notifications
+        CHECK_EQUAL(num_services[i] * 2 + 1, client_states[0].num_descriptors);
+    }
+}
+
+TEST(GATT_BENCHMARK, bulk_reads){
+    setup_database(16, 8);
+    connect(1);
+    hci_con_handle_t con_handle = client_con_handle(0);
+    uint16_t num_readable = discover_readable_characteristics(con_handle);
+    CHECK_EQUAL(16 * 8, num_readable);
+
+    uint32_t num_ops = 20 * BENCHMARK_SCALE * num_readable;
+    benchmark_t benchmark;
+    benchmark_start(&benchmark);
+    uint32_t op;
+    for (op=0;op<num_ops;op++){
+        uint16_t value_handle = characteristics[op % num_readable].value_handle;
+        client_query_started(con_handle, gatt_client_read_value_of_characteristic_using_value_handle(&handle_gatt_client_event, con_handle, value_handle));
+        client_wait_for_query_complete(con_handle);
+    }
+    benchmark_report(&benchmark, "read characteristic value", num_ops);
+    CHECK_EQUAL(num_ops, client_states[0].num_values);
+}
+
+TEST(GATT_BENCHMARK, long_writes){
+    setup_database(1, 1);
+    connect(1);
+    hci_con_handle_t con_handle = client_con_handle(0);
+    uint8_t long_value[LONG_VALUE_SIZE];
+    memset(long_value, 0xaa, sizeof(long_value));
+
+    uint32_t num_ops = 100 * BENCHMARK_SCALE;
+    num_long_value_bytes_written = 0;
+    benchmark_t benchmark;
+    benchmark_start(&benchmark);
+    uint32_t op;
+    for (op=0;op<num_ops;op++){
+        client_query_started(con_handle, gatt_client_write_long_value_of_characteristic(&handle_gatt_client_event, con_handle, long_value_handle, sizeof(long_value), long_value));
+        client_wait_for_query_complete(con_handle);
+        CHECK_EQUAL(LONG_VALUE_SIZE, num_long_value_bytes_written);
+        num_long_value_bytes_written = 0;
+    }
+    benchmark_report(&benchmark, "long write 512 bytes", num_ops);
+}
+
+TEST(GATT_BENCHMARK, notification_stream){
+    setup_database(1, 1);
+    connect(1);
+    hci_con_handle_t con_handle = client_con_handle(0);
+
+    // exchange MTU
+    client_query_started(con_handle, gatt_client_discover_primary_services(&handle_gatt_client_event, con_handle));
+    client_wait_for_query_complete(con_handle);
+
+    gatt_client_characteristic_t characteristic;
+    memset(&characteristic, 0, sizeof(characteristic));
+    characteristic.value_handle = notification_value_handle;
+    characteristic.end_handle   = notification_value_handle + 1;
+    gatt_client_listen_for_characteristic_value_updates(&notification_listener, &handle_gatt_client_event, con_handle, &characteristic);
+
+    static uint8_t stream_storage[4096];
+    att_server_notification_stream_t stream;
+    uint8_t status = att_server_notification_stream_register(&stream, loopback_peer_con_handle(con_handle), notification_value_handle, stream_storage, sizeof(stream_storage));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    uint8_t value[ATT_MTU - 3];
+    memset(value, 0x33, sizeof(value));
+    uint32_t num_ops = 2000 * BENCHMARK_SCALE;
+    uint32_t num_queued = 0;
+    benchmark_t benchmark;
+    benchmark_start(&benchmark);
+    while (client_states[0].num_notifications < num_ops){
+        // fill stream, then let loopback deliver queued notifications
+        while ((num_queued < num_ops) && (att_server_notification_stream_write(&stream, value, sizeof(value)) == ERROR_CODE_SUCCESS)){
+            num_queued++;
+        }
+        CHECK_TRUE(loopback_step());
+    }
+    benchmark_report(&benchmark, "notification 244 bytes", num_ops);
+    CHECK_EQUAL(num_ops, stream.num_notifications_sent);
+
+    att_server_notification_stream_unregister(&stream);
+    gatt_client_stop_listening_for_characteristic_value_updates(&notification_listener);
+}
+
+TEST(GATT_BENCHMARK, concurrent_connections){
+    setup_database(4, 8);
+    connect(MAX_CONNECTIONS);
+    uint16_t num_readable = discover_readable_characteristics(client_con_handle(0));
+    CHECK_EQUAL(4 * 8, num_readable);
+
+    uint32_t num_reads_per_connection = 20 * BENCHMARK_SCALE * num_readable;
+    uint32_t num_reads_started[MAX_CONNECTIONS];
+    memset(num_reads_started, 0, sizeof(num_reads_started));
+    benchmark_t benchmark;
+    benchmark_start(&benchmark);
+    bool done = false;
+    while (!done){
+        // start next read on all idle connections
+        done = true;
+        uint16_t i;
+        for (i=0;i<MAX_CONNECTIONS;i++){
+            client_state_t * state = &client_states[i];
+            if (state->query_active){
+                done = false;
+                continue;
+            }
+            CHECK_EQUAL(ATT_ERROR_SUCCESS, state->query_status);
+            if (num_reads_started[i] == num_reads_per_connection) continue;
+            done = false;
+            hci_con_handle_t con_handle = client_con_handle(i);
+            uint16_t value_handle = characteristics[num_reads_started[i] % num_readable].value_handle;
+            client_query_started(con_handle, gatt_client_read_value_of_characteristic_using_value_handle(&handle_gatt_client_event, con_handle, value_handle));
+            num_reads_started[i]++;
+        }
+        loopback_step();
+    }
+    char name[40];
+    snprintf(name, sizeof(name), "read on %u connections", MAX_CONNECTIONS);
+    benchmark_report(&benchmark, name, num_reads_per_connection * MAX_CONNECTIONS);
+    uint16_t i;
+    for (i=0;i<MAX_CONNECTIONS;i++){
+        CHECK_EQUAL(num_reads_per_connection, client_states[i].num_values);
+    }
+}
+
+int main (int argc, const char * argv[]){
+    setup_database(1, 1);
+    att_server_init(att_db_util_get_address(), &att_read_callback, &att_write_callback);
+    gatt_client_init();
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,275 @@
+
+// *****************************************************************************
+//
+// test GATT Client Discovery Cache
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci_cmd.h"
+
+#include "hci.h"
+#include "btstack_event.h"
+#include "btstack_tlv.h"
+#include "ble/gatt_client.h"
+#include "ble/att_db.h"
+#include "bluetooth_gatt.h"
+#include "mock_btstack_tlv.h"
+#include "profile_caching.h"
+
+extern "C" void hci_setup_le_connection(uint16_t con_handle);
+extern "C" void mock_simulate_disconnected(uint16_t con_handle);
+extern "C" uint32_t mock_get_num_att_requests_sent(void);
+
+#define MAX_RESULTS 10
+
+static const hci_con_handle_t con_handle = 0x40;
+
+static uint8_t database_hash[16];
+
+static btstack_context_callback_registration_t gatt_query_request;
+static bool gatt_query_ready;
+static bool gatt_query_complete;
+static uint8_t gatt_query_complete_status;
+
+static uint16_t num_services;
+static gatt_client_service_t services[MAX_RESULTS];
+static uint16_t num_characteristics;
+static gatt_client_characteristic_t characteristics[MAX_RESULTS];
+static uint16_t num_descriptors;
+static gatt_client_characteristic_descriptor_t descriptors[MAX_RESULTS];
+
+static uint16_t att_read_callback(hci_con_handle_t connection_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(connection_handle);
+    if (attribute_handle == ATT_CHARACTERISTIC_GATT_DATABASE_HASH_01_VALUE_HANDLE){
+        return att_read_callback_handle_blob(database_hash, sizeof(database_hash), offset, buffer, buffer_size);
+    }
+    return 0;
+}
+
+static int att_write_callback(hci_con_handle_t connection_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(connection_handle);
+    UNUSED(attribute_handle);
+    UNUSED(transaction_mode);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    return 0;
+}
+
+static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    UNUSED(size);
+    switch (hci_event_packet_get_type(packet)){
+        case GATT_EVENT_SERVICE_QUERY_RESULT:
+            CHECK(num_services < MAX_RESULTS);
+            gatt_event_service_query_result_get_service(packet, &services[num_services++]);
+            break;
+        case GATT_EVENT_CHARACTERISTIC_QUERY_RESULT:
+            CHECK(num_characteristics < MAX_RESULTS);
+            gatt_event_characteristic_query_result_get_characteristic(packet, &characteristics[num_characteristics++]);
+            break;
+        case GATT_EVENT_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY_RESULT:
+            CHECK(num_descriptors < MAX_RESULTS);
+            gatt_event_all_characteristic_descriptors_query_result_get_characteristic_descriptor(packet, &descriptors[num_descriptors++]);
+            break;
+        case GATT_EVENT_QUERY_COMPLETE:
+            gatt_query_complete = true;
+            gatt_query_complete_status = gatt_event_query_complete_get_att_status(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void handle_gatt_query_ready(void * context){
+    UNUSED(context);
+    gatt_query_ready = true;
+}
+
+static void reset_results(void){
+    gatt_query_complete = false;
+    gatt_query_complete_status = 0xff;
+    num_services = 0;
+    num_characteristics = 0;
+    num_descriptors = 0;
+}
+
+TEST_GROUP(GattClientDiscoveryCache){
+    mock_btstack_tlv_t tlv_context;
+    const btstack_tlv_t * tlv_impl;
+
+    void setup(void){
+        tlv_impl = mock_btstack_tlv_init_instance(&tlv_context);
+        btstack_tlv_set_instance(tlv_impl, &tlv_context);
+        memset(database_hash, 0x11, sizeof(database_hash));
+        reset_results();
+    }
+
+    void teardown(void){
+        mock_simulate_disconnected(con_handle);
+        mock_btstack_tlv_deinit(&tlv_context);
+    }
+
+    // connect and wait until Database Hash has been read
+    void connect(void){
+        mock_simulate_disconnected(con_handle);
+        hci_setup_le_connection(con_handle);
+        gatt_query_ready = false;
+        gatt_query_request.callback = &handle_gatt_query_ready;
+        uint8_t status = gatt_client_request_to_send_gatt_query(&gatt_query_request, con_handle);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_TRUE(gatt_query_ready);
+        CHECK_TRUE(gatt_client_get_database_hash(con_handle) != NULL);
+    }
+
+    // @return number of ATT PDUs sent for the query
+    uint32_t discover_primary_services(void){
+        reset_results();
+        uint32_t num_att_requests = mock_get_num_att_requests_sent();
+        uint8_t status = gatt_client_discover_primary_services(&handle_gatt_client_event, con_handle);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_TRUE(gatt_query_complete);
+        CHECK_EQUAL(ATT_ERROR_SUCCESS, gatt_query_complete_status);
+        return mock_get_num_att_requests_sent() - num_att_requests;
+    }
+
+    uint32_t discover_characteristics(gatt_client_service_t * service){
+        reset_results();
+        uint32_t num_att_requests = mock_get_num_att_requests_sent();
+        uint8_t status = gatt_client_discover_characteristics_for_service(&handle_gatt_client_event, con_handle, service);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_TRUE(gatt_query_complete);
+        CHECK_EQUAL(ATT_ERROR_SUCCESS, gatt_query_complete_status);
+        return mock_get_num_att_requests_sent() - num_att_requests;
+    }
+
+    uint32_t discover_descriptors(gatt_client_characteristic_t * characteristic){
+        reset_results();
+        uint32_t num_att_requests = mock_get_num_att_requests_sent();
+        uint8_t status = gatt_client_discover_characteristic_descriptors(&handle_gatt_client_event, con_handle, characteristic);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_TRUE(gatt_query_complete);
+        CHECK_EQUAL(ATT_ERROR_SUCCESS, gatt_query_complete_status);
+        return mock_get_num_att_requests_sent() - num_att_requests;
+    }
+};
+
+TEST(GattClientDiscoveryCache, ServicesFromCacheAfterReconnect){
+    connect();
+    CHECK(discover_primary_services() > 0);
+    CHECK_EQUAL(4, num_services);
+    gatt_client_service_t services_expected[4];
+    memcpy(services_expected, services, sizeof(services_expected));
+
+    connect();
+    CHECK_EQUAL(0, discover_primary_services());
+    CHECK_EQUAL(4, num_services);
+    MEMCMP_EQUAL(services_expected, services, sizeof(services_expected));
+    CHECK_EQUAL(ORG_BLUETOOTH_SERVICE_GENERIC_ACCESS, services[0].uuid16);
+    CHECK_EQUAL(0, services[3].uuid16);
+}
+
+TEST(GattClientDiscoveryCache, CharacteristicsAndDescriptorsFromCache){
+    gatt_client_service_t service;
+    memset(&service, 0, sizeof(service));
+    service.start_group_handle = ATT_SERVICE_FFF0_START_HANDLE;
+    service.end_group_handle   = ATT_SERVICE_FFF0_END_HANDLE;
+
+    connect();
+    CHECK(discover_characteristics(&service) > 0);
+    CHECK_EQUAL(2, num_characteristics);
+    gatt_client_characteristic_t characteristics_expected[2];
+    memcpy(characteristics_expected, characteristics, sizeof(characteristics_expected));
+    CHECK(discover_descriptors(&characteristics_expected[0]) > 0);
+    CHECK_EQUAL(2, num_descriptors);
+
+    connect();
+    CHECK_EQUAL(0, discover_characteristics(&service));
+    CHECK_EQUAL(2, num_characteristics);
+    MEMCMP_EQUAL(characteristics_expected, characteristics, sizeof(characteristics_expected));
+    CHECK_EQUAL(0, discover_descriptors(&characteristics_expected[0]));
+    CHECK_EQUAL(2, num_descriptors);
+    CHECK_EQUAL(ATT_CHARACTERISTIC_FFF1_01_CLIENT_CONFIGURATION_HANDLE, descriptors[0].handle);
+    CHECK_EQUAL(ORG_BLUETOOTH_DESCRIPTOR_GATT_CLIENT_CHARACTERISTIC_CONFIGURATION, descriptors[0].uuid16);
+    CHECK_EQUAL(ATT_CHARACTERISTIC_FFF1_01_USER_DESCRIPTION_HANDLE, descriptors[1].handle);
+
+    // other service not cached yet
+    service.start_group_handle = ATT_SERVICE_0000FF10_1234_5678_9ABC_DEF012345678_START_HANDLE;
+    service.end_group_handle   = ATT_SERVICE_0000FF10_1234_5678_9ABC_DEF012345678_END_HANDLE;
+    CHECK(discover_characteristics(&service) > 0);
+    CHECK_EQUAL(1, num_characteristics);
+}
+
+TEST(GattClientDiscoveryCache, StoredOnceOnDisconnect){
+    gatt_client_service_t service;
+    memset(&service, 0, sizeof(service));
+    service.start_group_handle = ATT_SERVICE_FFF0_START_HANDLE;
+    service.end_group_handle   = ATT_SERVICE_FFF0_END_HANDLE;
+
+    connect();
+    uint32_t num_store_tag = tlv_context.num_store_tag;
+    discover_primary_services();
+    discover_characteristics(&service);
+    gatt_client_characteristic_t characteristic = characteristics[0];
+    discover_descriptors(&characteristic);
+    CHECK_EQUAL(num_store_tag, tlv_context.num_store_tag);
+
+    mock_simulate_disconnected(con_handle);
+    CHECK_EQUAL(num_store_tag + 1u, tlv_context.num_store_tag);
+
+    // served from cache after reconnect, nothing to store
+    connect();
+    CHECK_EQUAL(0, discover_primary_services());
+    CHECK_EQUAL(0, discover_descriptors(&characteristic));
+    mock_simulate_disconnected(con_handle);
+    CHECK_EQUAL(num_store_tag + 1u, tlv_context.num_store_tag);
+}
+
+TEST(GattClientDiscoveryCache, FilterByUUID){
+    connect();
+    discover_primary_services();
+
+    connect();
+    reset_results();
+    uint32_t num_att_requests = mock_get_num_att_requests_sent();
+    uint8_t status = gatt_client_discover_primary_services_by_uuid16(&handle_gatt_client_event, con_handle, 0xFFF0);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    CHECK_TRUE(gatt_query_complete);
+    CHECK_EQUAL(num_att_requests, mock_get_num_att_requests_sent());
+    CHECK_EQUAL(1, num_services);
+    CHECK_EQUAL(ATT_SERVICE_FFF0_START_HANDLE, services[0].start_group_handle);
+    CHECK_EQUAL(ATT_SERVICE_FFF0_END_HANDLE, services[0].end_group_handle);
+}
+
+TEST(GattClientDiscoveryCache, DatabaseHashChanged){
+    connect();
+    discover_primary_services();
+
+    database_hash[0] = 0x22;
+    connect();
+    CHECK(discover_primary_services() > 0);
+    CHECK_EQUAL(4, num_services);
+
+    connect();
+    CHECK_EQUAL(0, discover_primary_services());
+    CHECK_EQUAL(4, num_services);
+}
+
+int main (int argc, const char * argv[]){
+    att_set_db(profile_data);
+    att_set_write_callback(&att_write_callback);
+    att_set_read_callback(&att_read_callback);
+
+    gatt_client_init();
+
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
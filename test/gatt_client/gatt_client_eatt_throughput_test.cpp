@@ -0,0 +1,587 @@
+// Benchmark for GATT Client requests distributed over multiple EATT bearers
+//
+// A simulated remote GATT Server with 300 attributes answers ATT requests on the Unenhanced ATT bearer or on
+// EATT bearers. Each connection event carries a limited number of PDUs in each direction and the server
+// responds in the next connection event. The application queues independent discovery and read requests
+// with gatt_client_request_to_send_gatt_query. The benchmark reports the time for discovery of all services,
+// characteristics and descriptors and for reading all characteristic values.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "bluetooth_gatt.h"
+#include "bluetooth_psm.h"
+#include "btstack_debug.h"
+#include "l2cap.h"
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "ble/gatt_client.h"
+#include "ble/sm.h"
+#include "btstack_run_loop.h"
+
+#define TEST_CON_HANDLE                 0x0040
+#define ATT_MTU                         247
+#define CONNECTION_INTERVAL_MS          15
+#define MAX_PDUS_PER_CONNECTION_EVENT   6
+#define MAX_EATT_BEARERS                5
+#define EATT_STORAGE_PER_BEARER         (2 * ATT_MTU + 16)
+#define EATT_LOCAL_CID                  0x0041
+
+// remote GATT Server: GAP Service (5), GATT Service (5), 10 x (1 + 12 x 2 + 4 CCC) = 300 attributes
+#define NUM_SERVICES                    10
+#define NUM_CHARACTERISTICS_PER_SERVICE 12
+#define NUM_NOTIFY_PER_SERVICE          4
+#define CHARACTERISTIC_VALUE_SIZE       20
+#define MAX_CHARACTERISTICS             (NUM_SERVICES * NUM_CHARACTERISTICS_PER_SERVICE)
+#define MAX_SERVICES                    (NUM_SERVICES + 2)
+
+// mock hci / gap / sm
+static hci_connection_t test_hci_connection;
+
+hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+    if (con_handle != TEST_CON_HANDLE) return NULL;
+    return &test_hci_connection;
+}
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+bool hci_can_send_acl_le_packet_now(void){
+    return true;
+}
+bool gap_authenticated(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+bool gap_bonded(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+uint8_t gap_encryption_key_size(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return 0;
+}
+bool gap_reconnect_security_setup_active(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return false;
+}
+void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+void sm_request_pairing(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+}
+int sm_cmac_ready(void){
+    return 0;
+}
+void sm_cmac_signed_write_start(const sm_key_t key, uint8_t opcode, uint16_t attribute_handle, uint16_t message_len, const uint8_t * message, uint32_t sign_counter, void (*done_callback)(uint8_t * hash)){
+    UNUSED(key);
+    UNUSED(opcode);
+    UNUSED(attribute_handle);
+    UNUSED(message_len);
+    UNUSED(message);
+    UNUSED(sign_counter);
+    UNUSED(done_callback);
+}
+irk_lookup_state_t sm_identity_resolving_state(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return IRK_LOOKUP_FAILED;
+}
+int sm_le_device_index(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return -1;
+}
+void btstack_run_loop_set_timer(btstack_timer_source_t * timer, uint32_t timeout_in_ms){
+    UNUSED(timer);
+    UNUSED(timeout_in_ms);
+}
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * timer, void (*process)(btstack_timer_source_t * _timer)){
+    UNUSED(timer);
+    UNUSED(process);
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    return 1;
+}
+void btstack_run_loop_execute_on_main_thread(btstack_context_callback_registration_t * callback_registration){
+    callback_registration->callback(callback_registration->context);
+}
+void btstack_crypto_aes128_cmac_generator(btstack_crypto_aes128_cmac_t * request, const uint8_t * key, uint16_t size, uint8_t (*get_byte_callback)(uint16_t pos), uint8_t * hash, void (* callback)(void * arg), void * callback_arg){
+    UNUSED(request);
+    UNUSED(key);
+    UNUSED(size);
+    UNUSED(get_byte_callback);
+    UNUSED(hash);
+    UNUSED(callback);
+    UNUSED(callback_arg);
+}
+
+// simulated link, PDUs from the client are handled by the server, responses are queued for the next connection event
+typedef struct {
+    uint16_t cid;
+    uint16_t len;
+    uint8_t  data[ATT_MTU];
+} sim_pdu_t;
+
+#define SIM_QUEUE_SIZE 64
+typedef struct {
+    sim_pdu_t pdus[SIM_QUEUE_SIZE];
+    uint16_t  head;
+    uint16_t  count;
+} sim_queue_t;
+
+static sim_queue_t sim_queue_to_server;
+static sim_queue_t sim_queue_to_client;
+static uint32_t    sim_time_ms;
+static uint32_t    sim_num_connection_events;
+
+static void sim_queue_push(sim_queue_t * queue, uint16_t cid, const uint8_t * data, uint16_t len){
+    CHECK(queue->count < SIM_QUEUE_SIZE);
+    CHECK(len <= ATT_MTU);
+    sim_pdu_t * pdu = &queue->pdus[(queue->head + queue->count) % SIM_QUEUE_SIZE];
+    pdu->cid = cid;
+    pdu->len = len;
+    memcpy(pdu->data, data, len);
+    queue->count++;
+}
+
+static sim_pdu_t * sim_queue_pop(sim_queue_t * queue){
+    if (queue->count == 0) return NULL;
+    sim_pdu_t * pdu = &queue->pdus[queue->head];
+    queue->head = (queue->head + 1) % SIM_QUEUE_SIZE;
+    queue->count--;
+    return pdu;
+}
+
+// mock l2cap
+static btstack_packet_handler_t att_fixed_channel_packet_handler;
+static btstack_packet_handler_t eatt_packet_handler;
+static bool     att_fixed_channel_can_send_now_requested;
+static uint8_t  att_fixed_channel_outgoing_buffer[ATT_MTU];
+static uint8_t  eatt_num_channels_pending;
+
+void l2cap_register_fixed_channel(btstack_packet_handler_t packet_handler, uint16_t channel_id){
+    UNUSED(channel_id);
+    att_fixed_channel_packet_handler = packet_handler;
+}
+bool l2cap_can_send_fixed_channel_packet_now(hci_con_handle_t con_handle, uint16_t channel_id){
+    UNUSED(con_handle);
+    UNUSED(channel_id);
+    return true;
+}
+void l2cap_request_can_send_fix_channel_now_event(hci_con_handle_t con_handle, uint16_t channel_id){
+    UNUSED(con_handle);
+    UNUSED(channel_id);
+    att_fixed_channel_can_send_now_requested = true;
+}
+void l2cap_reserve_packet_buffer(void){
+}
+uint8_t * l2cap_get_outgoing_buffer(void){
+    return att_fixed_channel_outgoing_buffer;
+}
+uint8_t l2cap_send_prepared_connectionless(hci_con_handle_t con_handle, uint16_t cid, uint16_t len){
+    UNUSED(con_handle);
+    sim_queue_push(&sim_queue_to_server, cid, att_fixed_channel_outgoing_buffer, len);
+    return ERROR_CODE_SUCCESS;
+}
+uint16_t l2cap_max_le_mtu(void){
+    return ATT_MTU;
+}
+uint8_t l2cap_ecbm_create_channels(btstack_packet_handler_t packet_handler, hci_con_handle_t con_handle,
+                                   gap_security_level_t security_level,
+                                   uint16_t psm, uint8_t num_channels, uint16_t initial_credits, uint16_t receive_buffer_size,
+                                   uint8_t ** receive_buffers, uint16_t * out_local_cids){
+    UNUSED(con_handle);
+    UNUSED(security_level);
+    UNUSED(psm);
+    UNUSED(initial_credits);
+    UNUSED(receive_buffer_size);
+    UNUSED(receive_buffers);
+    eatt_packet_handler = packet_handler;
+    uint8_t i;
+    for (i = 0; i < num_channels; i++){
+        out_local_cids[i] = EATT_LOCAL_CID + i;
+    }
+    // channels are opened in next connection event
+    eatt_num_channels_pending = num_channels;
+    return ERROR_CODE_SUCCESS;
+}
+uint8_t l2cap_send(uint16_t local_cid, const uint8_t * data, uint16_t len){
+    sim_queue_push(&sim_queue_to_server, local_cid, data, len);
+    return ERROR_CODE_SUCCESS;
+}
+
+// remote GATT Server
+static att_connection_t server_att_connections[1 + MAX_EATT_BEARERS];
+
+static att_connection_t * server_att_connection_for_cid(uint16_t cid){
+    if (cid == L2CAP_CID_ATTRIBUTE_PROTOCOL) return &server_att_connections[0];
+    CHECK(cid >= EATT_LOCAL_CID);
+    CHECK(cid <  (EATT_LOCAL_CID + MAX_EATT_BEARERS));
+    return &server_att_connections[1 + cid - EATT_LOCAL_CID];
+}
+
+static uint16_t server_att_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(attribute_handle);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    return 0;
+}
+
+static int server_att_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(attribute_handle);
+    UNUSED(transaction_mode);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    return 0;
+}
+
+static uint16_t server_setup_db(void){
+    uint8_t value[CHARACTERISTIC_VALUE_SIZE];
+    memset(value, 0x55, sizeof(value));
+    uint8_t server_supported_features = 0x01;   // EATT Supported
+    uint8_t client_supported_features = 0x00;
+    uint16_t num_attributes = 0;
+
+    att_db_util_init();
+    att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ACCESS);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_GAP_DEVICE_NAME, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, (uint8_t *) "EATT", 4);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_GAP_APPEARANCE, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, value, 2);
+    att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ATTRIBUTE);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_SERVER_SUPPORTED_FEATURES, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &server_supported_features, 1);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_CLIENT_SUPPORTED_FEATURES, ATT_PROPERTY_READ | ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &client_supported_features, 1);
+    num_attributes += 10;
+
+    int s;
+    for (s = 0; s < NUM_SERVICES; s++){
+        att_db_util_add_service_uuid16(0xFF00 + s);
+        num_attributes++;
+        int c;
+        for (c = 0; c < NUM_CHARACTERISTICS_PER_SERVICE; c++){
+            uint16_t properties = ATT_PROPERTY_READ;
+            num_attributes += 2;
+            if (c < NUM_NOTIFY_PER_SERVICE){
+                properties |= ATT_PROPERTY_NOTIFY;
+                num_attributes++;
+            }
+            att_db_util_add_characteristic_uuid16(0xFE00 + c, properties, ATT_SECURITY_NONE, ATT_SECURITY_NONE, value, sizeof(value));
+        }
+    }
+    return num_attributes;
+}
+
+static void server_handle_pdu(const sim_pdu_t * pdu){
+    uint8_t request[ATT_MTU];
+    uint8_t response[ATT_MTU];
+    memcpy(request, pdu->data, pdu->len);
+    uint16_t response_len = att_handle_request(server_att_connection_for_cid(pdu->cid), request, pdu->len, response);
+    if (response_len > 0){
+        sim_queue_push(&sim_queue_to_client, pdu->cid, response, response_len);
+    }
+}
+
+// deliver can send now events as long as requested by att_dispatch
+static void sim_emit_can_send_now(void){
+    while (att_fixed_channel_can_send_now_requested){
+        att_fixed_channel_can_send_now_requested = false;
+        uint8_t event[4];
+        event[0] = L2CAP_EVENT_CAN_SEND_NOW;
+        event[1] = 2;
+        little_endian_store_16(event, 2, L2CAP_CID_ATTRIBUTE_PROTOCOL);
+        (*att_fixed_channel_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+}
+
+static void sim_emit_eatt_channels_opened(void){
+    uint8_t i;
+    for (i = 0; i < eatt_num_channels_pending; i++){
+        uint16_t cid = EATT_LOCAL_CID + i;
+        att_connection_t * att_connection = server_att_connection_for_cid(cid);
+        att_connection->mtu = ATT_MTU;
+        att_connection->max_mtu = ATT_MTU;
+        att_connection->mtu_exchanged = true;
+
+        uint8_t event[23];
+        memset(event, 0, sizeof(event));
+        event[0] = L2CAP_EVENT_ECBM_CHANNEL_OPENED;
+        event[1] = sizeof(event) - 2;
+        event[2] = ERROR_CODE_SUCCESS;
+        little_endian_store_16(event, 10, TEST_CON_HANDLE);
+        little_endian_store_16(event, 13, BLUETOOTH_PSM_EATT);
+        little_endian_store_16(event, 15, cid);
+        little_endian_store_16(event, 17, cid);
+        little_endian_store_16(event, 19, ATT_MTU);
+        little_endian_store_16(event, 21, ATT_MTU);
+        (*eatt_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+    eatt_num_channels_pending = 0;
+}
+
+static void sim_connection_event(void){
+    sim_emit_can_send_now();
+
+    // server receives requests and queues responses for next connection event
+    sim_queue_t responses;
+    memset(&responses, 0, sizeof(responses));
+    sim_queue_t pending_responses = sim_queue_to_client;
+    sim_queue_to_client = responses;
+    int i;
+    for (i = 0; i < MAX_PDUS_PER_CONNECTION_EVENT; i++){
+        sim_pdu_t * pdu = sim_queue_pop(&sim_queue_to_server);
+        if (pdu == NULL) break;
+        server_handle_pdu(pdu);
+    }
+    responses = sim_queue_to_client;
+    sim_queue_to_client = pending_responses;
+
+    // client receives responses from previous connection event
+    sim_emit_eatt_channels_opened();
+    for (i = 0; i < MAX_PDUS_PER_CONNECTION_EVENT; i++){
+        sim_pdu_t * pdu = sim_queue_pop(&sim_queue_to_client);
+        if (pdu == NULL) break;
+        uint8_t packet[ATT_MTU];
+        memcpy(packet, pdu->data, pdu->len);
+        if (pdu->cid == L2CAP_CID_ATTRIBUTE_PROTOCOL){
+            (*att_fixed_channel_packet_handler)(ATT_DATA_PACKET, TEST_CON_HANDLE, packet, pdu->len);
+        } else {
+            (*eatt_packet_handler)(L2CAP_DATA_PACKET, pdu->cid, packet, pdu->len);
+        }
+        sim_emit_can_send_now();
+    }
+
+    // append new responses
+    sim_pdu_t * pdu;
+    while ((pdu = sim_queue_pop(&responses)) != NULL){
+        sim_queue_push(&sim_queue_to_client, pdu->cid, pdu->data, pdu->len);
+    }
+
+    sim_time_ms += CONNECTION_INTERVAL_MS;
+    sim_num_connection_events++;
+}
+
+// application: jobs are started when gatt client can send a query on any bearer
+typedef enum {
+    JOB_DISCOVER_SERVICES,
+    JOB_DISCOVER_CHARACTERISTICS,
+    JOB_DISCOVER_DESCRIPTORS,
+    JOB_READ_VALUE,
+} job_type_t;
+
+static job_type_t job_type;
+static uint16_t   num_jobs;
+static uint16_t   num_jobs_started;
+static uint16_t   num_jobs_completed;
+
+static gatt_client_service_t        services[MAX_SERVICES];
+static uint16_t                     num_services;
+static gatt_client_characteristic_t characteristics[MAX_CHARACTERISTICS + 4];
+static uint16_t                     num_characteristics;
+static uint16_t                     num_descriptors;
+static uint16_t                     num_values;
+static uint16_t                     characteristics_with_descriptors[MAX_CHARACTERISTICS + 4];
+static uint16_t                     num_characteristics_with_descriptors;
+
+static btstack_context_callback_registration_t workers[MAX_EATT_BEARERS];
+static bool eatt_connected;
+
+static void handle_gatt_client_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case GATT_EVENT_CONNECTED:
+            CHECK_EQUAL(ERROR_CODE_SUCCESS, gatt_event_connected_get_status(packet));
+            eatt_connected = true;
+            break;
+        case GATT_EVENT_SERVICE_QUERY_RESULT:
+            CHECK(num_services < MAX_SERVICES);
+            gatt_event_service_query_result_get_service(packet, &services[num_services++]);
+            break;
+        case GATT_EVENT_CHARACTERISTIC_QUERY_RESULT:
+            CHECK(num_characteristics < (MAX_CHARACTERISTICS + 4));
+            gatt_event_characteristic_query_result_get_characteristic(packet, &characteristics[num_characteristics++]);
+            break;
+        case GATT_EVENT_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY_RESULT:
+            num_descriptors++;
+            break;
+        case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
+            num_values++;
+            break;
+        case GATT_EVENT_QUERY_COMPLETE:
+            CHECK_EQUAL(ATT_ERROR_SUCCESS, gatt_event_query_complete_get_att_status(packet));
+            num_jobs_completed++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void worker_start_job(void * context){
+    btstack_context_callback_registration_t * worker = (btstack_context_callback_registration_t *) context;
+    if (num_jobs_started == num_jobs) return;
+    uint16_t index = num_jobs_started++;
+    uint8_t status = ERROR_CODE_SUCCESS;
+    gatt_client_characteristic_t * characteristic;
+    switch (job_type){
+        case JOB_DISCOVER_SERVICES:
+            status = gatt_client_discover_primary_services(&handle_gatt_client_event, TEST_CON_HANDLE);
+            break;
+        case JOB_DISCOVER_CHARACTERISTICS:
+            status = gatt_client_discover_characteristics_for_service(&handle_gatt_client_event, TEST_CON_HANDLE, &services[index]);
+            break;
+        case JOB_DISCOVER_DESCRIPTORS:
+            characteristic = &characteristics[characteristics_with_descriptors[index]];
+            status = gatt_client_discover_characteristic_descriptors(&handle_gatt_client_event, TEST_CON_HANDLE, characteristic);
+            break;
+        case JOB_READ_VALUE:
+            characteristic = &characteristics[index];
+            status = gatt_client_read_value_of_characteristic_using_value_handle(&handle_gatt_client_event, TEST_CON_HANDLE, characteristic->value_handle);
+            break;
+        default:
+            btstack_unreachable();
+            break;
+    }
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    // wait for next free bearer
+    if (num_jobs_started < num_jobs){
+        gatt_client_request_to_send_gatt_query(worker, TEST_CON_HANDLE);
+    }
+}
+
+// @return duration in ms
+static uint32_t run_jobs(job_type_t type, uint16_t count){
+    job_type = type;
+    num_jobs = count;
+    num_jobs_started = 0;
+    num_jobs_completed = 0;
+    uint32_t start_ms = sim_time_ms;
+    int i;
+    for (i = 0; i < MAX_EATT_BEARERS; i++){
+        workers[i].callback = &worker_start_job;
+        workers[i].context  = &workers[i];
+        gatt_client_request_to_send_gatt_query(&workers[i], TEST_CON_HANDLE);
+    }
+    while (num_jobs_completed < num_jobs){
+        sim_connection_event();
+        CHECK((sim_time_ms - start_ms) < 60000);
+    }
+    for (i = 0; i < MAX_EATT_BEARERS; i++){
+        gatt_client_remove_gatt_query(&workers[i], TEST_CON_HANDLE);
+    }
+    return sim_time_ms - start_ms;
+}
+
+typedef struct {
+    uint32_t discovery_ms;
+    uint32_t read_ms;
+} result_t;
+
+static uint16_t num_attributes;
+static uint8_t  eatt_storage[MAX_EATT_BEARERS * EATT_STORAGE_PER_BEARER];
+
+static void run_benchmark(const char * name, uint8_t num_eatt_bearers, result_t * result){
+    uint8_t status;
+    // Unenhanced ATT bearer exchanges MTU with first query
+    if (num_eatt_bearers > 0){
+        eatt_connected = false;
+        status = gatt_client_le_enhanced_connect(&handle_gatt_client_event, TEST_CON_HANDLE, num_eatt_bearers,
+                                                 eatt_storage, num_eatt_bearers * EATT_STORAGE_PER_BEARER);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        while (!eatt_connected){
+            sim_connection_event();
+            CHECK(sim_time_ms < 10000);
+        }
+    }
+
+    // discovery: services, characteristics of all services, descriptors of all characteristics with descriptors
+    uint32_t discovery_ms = run_jobs(JOB_DISCOVER_SERVICES, 1);
+    CHECK_EQUAL(NUM_SERVICES + 2, num_services);
+    discovery_ms += run_jobs(JOB_DISCOVER_CHARACTERISTICS, num_services);
+    CHECK_EQUAL((NUM_SERVICES * NUM_CHARACTERISTICS_PER_SERVICE) + 4, num_characteristics);
+    int i;
+    for (i = 0; i < num_characteristics; i++){
+        if (characteristics[i].end_handle > characteristics[i].value_handle){
+            characteristics_with_descriptors[num_characteristics_with_descriptors++] = i;
+        }
+    }
+    discovery_ms += run_jobs(JOB_DISCOVER_DESCRIPTORS, num_characteristics_with_descriptors);
+    CHECK_EQUAL(NUM_SERVICES * NUM_NOTIFY_PER_SERVICE, num_descriptors);
+
+    // bulk read of all characteristic values
+    uint32_t read_ms = run_jobs(JOB_READ_VALUE, num_characteristics);
+    CHECK_EQUAL(num_characteristics, num_values);
+
+    printf("%-18s: %u attributes, discovery %5u ms, read %3u values %5u ms\n", name, num_attributes,
+           discovery_ms, num_values, read_ms);
+    result->discovery_ms = discovery_ms;
+    result->read_ms = read_ms;
+}
+
+TEST_GROUP(GATT_CLIENT_EATT_THROUGHPUT){
+    void setup(void){
+        btstack_memory_init();
+        gatt_client_init();
+        memset(&test_hci_connection, 0, sizeof(test_hci_connection));
+        test_hci_connection.con_handle = TEST_CON_HANDLE;
+        memset(server_att_connections, 0, sizeof(server_att_connections));
+        server_att_connections[0].con_handle = TEST_CON_HANDLE;
+        server_att_connections[0].mtu = ATT_DEFAULT_MTU;
+        server_att_connections[0].max_mtu = ATT_MTU;
+        memset(&sim_queue_to_server, 0, sizeof(sim_queue_to_server));
+        memset(&sim_queue_to_client, 0, sizeof(sim_queue_to_client));
+        eatt_num_channels_pending = 0;
+        sim_time_ms = 0;
+        sim_num_connection_events = 0;
+        num_services = 0;
+        num_characteristics = 0;
+        num_characteristics_with_descriptors = 0;
+        num_descriptors = 0;
+        num_values = 0;
+    }
+    void teardown(void){
+        btstack_memory_deinit();
+    }
+};
+
+TEST(GATT_CLIENT_EATT_THROUGHPUT, one_vs_five_bearers){
+    CHECK_EQUAL(300, num_attributes);
+    result_t result_att;
+    result_t result_eatt_1;
+    result_t result_eatt_5;
+
+    run_benchmark("ATT bearer", 0, &result_att);
+    teardown();
+    setup();
+    run_benchmark("1 EATT bearer", 1, &result_eatt_1);
+    teardown();
+    setup();
+    run_benchmark("5 EATT bearers", 5, &result_eatt_5);
+
+    // independent requests are distributed over all bearers
+    CHECK(result_eatt_5.discovery_ms * 2 < result_eatt_1.discovery_ms);
+    CHECK(result_eatt_5.read_ms * 4 <= result_eatt_1.read_ms);
+    CHECK(result_eatt_1.read_ms <= result_att.read_ms);
+}
+
+int main (int argc, const char * argv[]){
+    num_attributes = server_setup_db();
+    att_set_db(att_db_util_get_address());
+    att_set_read_callback(&server_att_read_callback);
+    att_set_write_callback(&server_att_write_callback);
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
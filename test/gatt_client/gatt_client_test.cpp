@@ -29,6 +29,10 @@
 
 extern "C" void hci_setup_le_connection(uint16_t con_handle);
 extern "C" void l2cap_set_can_send_fixed_channel_packet_now(bool value);
+extern "C" void mock_defer_main_thread_callbacks(bool deferred);
+extern "C" void mock_execute_main_thread_callbacks(void);
+extern "C" void mock_set_encryption_key_size(uint8_t encryption_key_size);
+extern "C" uint32_t mock_get_num_att_requests_sent(void);
 
 static uint16_t gatt_client_handle = 0x40;
 static int gatt_query_complete = 0;
@@ -1222,6 +1226,96 @@ TEST(GATTClient, gatt_client_read_multiple_characteristic_values){
     CHECK_EQUAL(GATT_CLIENT_IN_WRONG_STATE, status);
 }
 
+static uint16_t coalesced_value_handles[4];
+static uint8_t  coalesced_query_complete_status[4];
+static int      coalesced_values_received;
+static int      coalesced_queries_completed;
+
+static void handle_coalesced_read_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	UNUSED(channel);
+	UNUSED(size);
+	if (packet_type != HCI_EVENT_PACKET) return;
+	switch (hci_event_packet_get_type(packet)){
+		case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
+			CHECK(coalesced_values_received < 4);
+			coalesced_value_handles[coalesced_values_received++] = gatt_event_characteristic_value_query_result_get_value_handle(packet);
+			CHECK_EQUAL(short_value_length, gatt_event_characteristic_value_query_result_get_value_length(packet));
+			CHECK_EQUAL_ARRAY((uint8_t*)short_value, (uint8_t *)gatt_event_characteristic_value_query_result_get_value(packet), short_value_length);
+			break;
+		case GATT_EVENT_QUERY_COMPLETE:
+			CHECK(coalesced_queries_completed < 4);
+			coalesced_query_complete_status[coalesced_queries_completed++] = gatt_event_query_complete_get_att_status(packet);
+			break;
+		default:
+			break;
+	}
+}
+
+static void handle_gatt_query_ready(void * context){
+	UNUSED(context);
+}
+
+TEST(GATTClient, gatt_client_read_value_of_characteristic_coalesced){
+	gatt_client_coalesced_read_t reads[3];
+	btstack_context_callback_registration_t query_request;
+	query_request.callback = &handle_gatt_query_ready;
+
+	test = READ_CHARACTERISTIC_VALUE;
+	reset_query_state();
+	status = gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
+	CHECK_EQUAL(0, status);
+	reset_query_state();
+	status = gatt_client_discover_characteristics_for_service(handle_ble_client_event, gatt_client_handle, &services[0]);
+	CHECK_EQUAL(0, status);
+	CHECK_EQUAL(1, gatt_query_complete);
+	// F100 and F101 readable, F102 neither readable nor writable
+	CHECK_EQUAL(0xF100, characteristics[0].uuid16);
+	CHECK_EQUAL(0xF102, characteristics[2].uuid16);
+
+	status = gatt_client_read_value_of_characteristic_coalesced(&reads[0], handle_coalesced_read_event, HCI_CON_HANDLE_INVALID, characteristics[0].value_handle);
+	CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, status);
+
+	// reads queued while client is busy are combined into a single Read Multiple Variable Request
+	coalesced_values_received = 0;
+	coalesced_queries_completed = 0;
+	set_wrong_gatt_client_state();
+	uint32_t num_att_requests = mock_get_num_att_requests_sent();
+	for (int i = 0; i < 2; i++){
+		status = gatt_client_read_value_of_characteristic_coalesced(&reads[i], handle_coalesced_read_event, gatt_client_handle, characteristics[i].value_handle);
+		CHECK_EQUAL(0, status);
+	}
+	CHECK_EQUAL(0, coalesced_queries_completed);
+	reset_query_state();
+	status = gatt_client_request_to_send_gatt_query(&query_request, gatt_client_handle);
+	CHECK_EQUAL(0, status);
+	CHECK_EQUAL(1, mock_get_num_att_requests_sent() - num_att_requests);
+	CHECK_EQUAL(2, coalesced_values_received);
+	CHECK_EQUAL(2, coalesced_queries_completed);
+	CHECK_EQUAL(characteristics[0].value_handle, coalesced_value_handles[0]);
+	CHECK_EQUAL(characteristics[1].value_handle, coalesced_value_handles[1]);
+	CHECK_EQUAL(ATT_ERROR_SUCCESS, coalesced_query_complete_status[0]);
+	CHECK_EQUAL(ATT_ERROR_SUCCESS, coalesced_query_complete_status[1]);
+
+	// error for one handle fails the combined request, reads are retried individually
+	coalesced_values_received = 0;
+	coalesced_queries_completed = 0;
+	set_wrong_gatt_client_state();
+	num_att_requests = mock_get_num_att_requests_sent();
+	for (int i = 0; i < 3; i++){
+		status = gatt_client_read_value_of_characteristic_coalesced(&reads[i], handle_coalesced_read_event, gatt_client_handle, characteristics[i].value_handle);
+		CHECK_EQUAL(0, status);
+	}
+	reset_query_state();
+	status = gatt_client_request_to_send_gatt_query(&query_request, gatt_client_handle);
+	CHECK_EQUAL(0, status);
+	CHECK_EQUAL(4, mock_get_num_att_requests_sent() - num_att_requests);
+	CHECK_EQUAL(2, coalesced_values_received);
+	CHECK_EQUAL(3, coalesced_queries_completed);
+	CHECK_EQUAL(ATT_ERROR_SUCCESS, coalesced_query_complete_status[0]);
+	CHECK_EQUAL(ATT_ERROR_SUCCESS, coalesced_query_complete_status[1]);
+	CHECK_EQUAL(ATT_ERROR_READ_NOT_PERMITTED, coalesced_query_complete_status[2]);
+}
+
 TEST(GATTClient, gatt_client_write_value_of_characteristic_without_response){
 	reset_query_state();
 	status = gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
@@ -1539,6 +1633,131 @@ TEST(GATTClient, gatt_client_att_status_to_error_code) {
     CHECK_EQUAL(ERROR_CODE_UNSPECIFIED_ERROR, status);
 }
 
+static uint8_t  notification_events[4][300];
+static uint16_t notification_event_sizes[4];
+static int      notification_events_received;
+
+static void handle_notification_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    CHECK(notification_events_received < 4);
+    memcpy(notification_events[notification_events_received], packet, size);
+    notification_event_sizes[notification_events_received] = size;
+    notification_events_received++;
+}
+
+// notifications are only accepted from bonded devices after encryption
+static void send_notification(uint16_t value_handle, uint8_t value_length){
+    uint8_t pdu[3 + 255];
+    pdu[0] = ATT_HANDLE_VALUE_NOTIFICATION;
+    little_endian_store_16(pdu, 1, value_handle);
+    memset(&pdu[3], (uint8_t) value_handle, value_length);
+    mock_set_encryption_key_size(16);
+    gatt_client_att_packet_handler_fuzz(ATT_DATA_PACKET, gatt_client_handle, pdu, 3 + value_length);
+    mock_set_encryption_key_size(0);
+}
+
+TEST(GATTClient, gatt_client_value_listeners_hashed){
+    // register more listeners than hash buckets, including wildcards
+    gatt_client_notification_t listeners[40];
+    gatt_client_characteristic_t characteristic;
+    memset(&characteristic, 0, sizeof(characteristic));
+    int i;
+    for (i = 0; i < 36; i++){
+        characteristic.value_handle = 0x100 + i;
+        gatt_client_listen_for_characteristic_value_updates(&listeners[i], handle_notification_event, gatt_client_handle, &characteristic);
+    }
+    characteristic.value_handle = 0x110;
+    gatt_client_listen_for_characteristic_value_updates(&listeners[36], handle_notification_event, gatt_client_handle + 1, &characteristic);
+    gatt_client_listen_for_characteristic_value_updates(&listeners[37], handle_notification_event, GATT_CLIENT_ANY_CONNECTION, &characteristic);
+    gatt_client_listen_for_characteristic_value_updates(&listeners[38], handle_notification_event, gatt_client_handle, NULL);
+
+    notification_events_received = 0;
+    send_notification(0x110, 4);
+    // exact match, any connection, any value handle
+    CHECK_EQUAL(3, notification_events_received);
+    for (i = 0; i < 3; i++){
+        CHECK_EQUAL(GATT_EVENT_NOTIFICATION, hci_event_packet_get_type(notification_events[i]));
+        CHECK_EQUAL(0x110, gatt_event_notification_get_value_handle(notification_events[i]));
+        CHECK_EQUAL(4, gatt_event_notification_get_value_length(notification_events[i]));
+    }
+
+    notification_events_received = 0;
+    send_notification(0x200, 4);
+    CHECK_EQUAL(1, notification_events_received);
+
+    for (i = 0; i < 39; i++){
+        gatt_client_stop_listening_for_characteristic_value_updates(&listeners[i]);
+    }
+    notification_events_received = 0;
+    send_notification(0x110, 4);
+    send_notification(0x100, 4);
+    CHECK_EQUAL(0, notification_events_received);
+}
+
+TEST(GATTClient, gatt_client_notification_batch){
+    uint8_t buffer[64];
+    gatt_client_notification_batch_t batch;
+    mock_defer_main_thread_callbacks(true);
+    gatt_client_register_notification_batch(&batch, handle_notification_event, gatt_client_handle, buffer, sizeof(buffer));
+
+    // collected until next run loop iteration
+    notification_events_received = 0;
+    send_notification(0x21, 8);
+    send_notification(0x22, 8);
+    send_notification(0x23, 8);
+    CHECK_EQUAL(0, notification_events_received);
+    mock_execute_main_thread_callbacks();
+    CHECK_EQUAL(1, notification_events_received);
+    const uint8_t * event = notification_events[0];
+    CHECK_EQUAL(GATT_EVENT_NOTIFICATION_BATCH, hci_event_packet_get_type(event));
+    CHECK_EQUAL(7 + 3 * 12, notification_event_sizes[0]);
+    CHECK_EQUAL(gatt_client_handle, gatt_event_notification_batch_get_handle(event));
+    CHECK_EQUAL(3, gatt_event_notification_batch_get_num_notifications(event));
+    CHECK_EQUAL(3 * 12, gatt_event_notification_batch_get_notifications_length(event));
+    const uint8_t * item = gatt_event_notification_batch_get_notifications(event);
+    int i;
+    for (i = 0; i < 3; i++){
+        CHECK_EQUAL(0x21 + i, little_endian_read_16(item, 0));
+        CHECK_EQUAL(8, little_endian_read_16(item, 2));
+        CHECK_EQUAL(0x21 + i, item[4]);
+        item += 12;
+    }
+
+    // emitted when full
+    notification_events_received = 0;
+    for (i = 0; i < 5; i++){
+        send_notification(0x30 + i, 8);
+    }
+    CHECK_EQUAL(1, notification_events_received);
+    CHECK_EQUAL(4, gatt_event_notification_batch_get_num_notifications(notification_events[0]));
+    mock_execute_main_thread_callbacks();
+    CHECK_EQUAL(2, notification_events_received);
+    CHECK_EQUAL(1, gatt_event_notification_batch_get_num_notifications(notification_events[1]));
+
+    // too large for batch: pending notifications first, then single notification
+    notification_events_received = 0;
+    send_notification(0x40, 8);
+    send_notification(0x41, 60);
+    CHECK_EQUAL(2, notification_events_received);
+    CHECK_EQUAL(GATT_EVENT_NOTIFICATION_BATCH, hci_event_packet_get_type(notification_events[0]));
+    CHECK_EQUAL(GATT_EVENT_NOTIFICATION, hci_event_packet_get_type(notification_events[1]));
+    CHECK_EQUAL(0x41, gatt_event_notification_get_value_handle(notification_events[1]));
+    CHECK_EQUAL(60, gatt_event_notification_get_value_length(notification_events[1]));
+
+    // explicit flush
+    notification_events_received = 0;
+    send_notification(0x42, 1);
+    gatt_client_flush_notification_batch(&batch);
+    CHECK_EQUAL(1, notification_events_received);
+
+    gatt_client_unregister_notification_batch(&batch);
+    send_notification(0x43, 1);
+    mock_execute_main_thread_callbacks();
+    mock_defer_main_thread_callbacks(false);
+    CHECK_EQUAL(1, notification_events_received);
+}
+
 TEST(GATTClient, gatt_client_att_packet_handler) {
     gatt_client_att_packet_handler_fuzz(0, 0, NULL, 0);
 
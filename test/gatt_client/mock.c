@@ -25,6 +25,8 @@ static hci_connection_t hci_connection;
 static uint8_t packet_buffer[256];
 static uint16_t packet_buffer_len;
 
+static uint32_t att_requests_sent;
+
 uint16_t get_gatt_client_handle(void){
 	return gatt_client_handle;
 }
@@ -70,6 +72,15 @@ void mock_simulate_connected(void){
 	registered_hci_event_handler(HCI_EVENT_PACKET, 0, gap_event, sizeof(gap_event));
 }
 
+void mock_simulate_disconnected(uint16_t con_handle){
+	uint8_t packet[] = {HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, (uint8_t) (con_handle & 0xff), (uint8_t) (con_handle >> 8), 0x13};
+	registered_hci_event_handler(HCI_EVENT_PACKET, 0, (uint8_t *)&packet, sizeof(packet));
+}
+
+uint32_t mock_get_num_att_requests_sent(void){
+	return att_requests_sent;
+}
+
 void mock_simulate_scan_response(void){
 	uint8_t packet[] = {GAP_EVENT_ADVERTISING_REPORT, 0x13, 0xE2, 0x01, 0x34, 0xB1, 0xF7, 0xD1, 0x77, 0x9B, 0xCC, 0x09, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
 	registered_hci_event_handler(HCI_EVENT_PACKET, 0, (uint8_t *)&packet, sizeof(packet));
@@ -79,9 +90,15 @@ bool gap_authenticated(hci_con_handle_t con_handle){
 	UNUSED(con_handle);
 	return false;
 }
+static uint8_t mock_encryption_key_size;
+
+void mock_set_encryption_key_size(uint8_t encryption_key_size){
+    mock_encryption_key_size = encryption_key_size;
+}
+
 uint8_t gap_encryption_key_size(hci_con_handle_t con_handle){
 	UNUSED(con_handle);
-	return 0;
+	return mock_encryption_key_size;
 }
 bool gap_bonded(hci_con_handle_t con_handle){
 	UNUSED(con_handle);
@@ -185,6 +202,7 @@ void l2cap_request_can_send_fix_channel_now_event(uint16_t handle, uint16_t chan
 uint8_t l2cap_send_prepared_connectionless(uint16_t handle, uint16_t cid, uint16_t len){
 	att_connection_t att_connection;
 	att_init_connection(&att_connection);
+	att_requests_sent++;
 	uint8_t response_buffer[PREBUFFER_SIZE + TEST_MAX_MTU];
 	uint8_t * response = &response_buffer[PREBUFFER_SIZE];
 	uint16_t response_len = att_handle_request(&att_connection, l2cap_get_outgoing_buffer(), len, response);
@@ -275,6 +293,24 @@ void l2cap_run(void){
 }
 #include "btstack_run_loop.h"
 
+static bool mock_main_thread_callbacks_deferred;
+static btstack_linked_list_t mock_main_thread_callbacks;
+
+void mock_defer_main_thread_callbacks(bool deferred){
+    mock_main_thread_callbacks_deferred = deferred;
+}
+
+void mock_execute_main_thread_callbacks(void){
+    while (mock_main_thread_callbacks != NULL){
+        btstack_context_callback_registration_t * callback_registration = (btstack_context_callback_registration_t *) btstack_linked_list_pop(&mock_main_thread_callbacks);
+        callback_registration->callback(callback_registration->context);
+    }
+}
+
 void btstack_run_loop_execute_on_main_thread(btstack_context_callback_registration_t * callback_registration){
+    if (mock_main_thread_callbacks_deferred){
+        btstack_linked_list_add_tail(&mock_main_thread_callbacks, (btstack_linked_item_t *) callback_registration);
+        return;
+    }
 	callback_registration->callback(callback_registration->context);
 }
@@ -0,0 +1,229 @@
+
+// *****************************************************************************
+//
+// test ATT Server over EATT bearers
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "ble/att_server.h"
+#include "l2cap.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "bluetooth_psm.h"
+#include "btstack_tlv.h"
+#include "mock_btstack_tlv.h"
+
+#include "bluetooth_gatt.h"
+
+#define NUM_EATT_BEARERS 2
+
+extern "C" void hci_setup_le_connection(uint16_t con_handle);
+
+static const uint16_t eatt_cids[NUM_EATT_BEARERS] = { 0x0041, 0x0042 };
+
+static uint8_t battery_level = 100;
+static uint8_t eatt_storage[NUM_EATT_BEARERS * (sizeof(att_server_eatt_bearer_t) + 2 * 100)];
+
+// simulated L2CAP ECBM
+static btstack_packet_handler_t eatt_packet_handler;
+static bool    can_send_now_requested[NUM_EATT_BEARERS];
+static uint8_t sent_opcode[NUM_EATT_BEARERS];
+static uint8_t sent_error_code[NUM_EATT_BEARERS];
+
+static int eatt_index_for_cid(uint16_t cid){
+    int i;
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        if (eatt_cids[i] == cid) return i;
+    }
+    FAIL("unknown EATT cid");
+    return 0;
+}
+
+uint8_t l2cap_ecbm_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, uint16_t min_remote_mtu,
+                                    gap_security_level_t security_level, bool authorization_required){
+    UNUSED(psm);
+    UNUSED(min_remote_mtu);
+    UNUSED(security_level);
+    UNUSED(authorization_required);
+    eatt_packet_handler = packet_handler;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_ecbm_accept_channels(uint16_t local_cid, uint8_t num_channels, uint16_t initial_credits,
+                                   uint16_t receive_buffer_size, uint8_t ** receive_buffers, uint16_t * out_local_cids){
+    UNUSED(local_cid);
+    UNUSED(initial_credits);
+    UNUSED(receive_buffer_size);
+    UNUSED(receive_buffers);
+    uint8_t i;
+    for (i=0;i<num_channels;i++){
+        out_local_cids[i] = eatt_cids[i];
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_ecbm_decline_channels(uint16_t local_cid, uint16_t result){
+    UNUSED(local_cid);
+    UNUSED(result);
+    return ERROR_CODE_SUCCESS;
+}
+
+bool l2cap_can_send_packet_now(uint16_t local_cid){
+    UNUSED(local_cid);
+    return false;
+}
+
+uint8_t l2cap_request_can_send_now_event(uint16_t local_cid){
+    can_send_now_requested[eatt_index_for_cid(local_cid)] = true;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_send(uint16_t local_cid, const uint8_t *data, uint16_t len){
+    int index = eatt_index_for_cid(local_cid);
+    sent_opcode[index] = data[0];
+    if ((data[0] == ATT_ERROR_RESPONSE) && (len >= 5)){
+        sent_error_code[index] = data[4];
+    }
+    return ERROR_CODE_SUCCESS;
+}
+
+static void eatt_simulate_incoming_connection(hci_con_handle_t con_handle, uint8_t num_channels){
+    uint8_t event[16];
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_ECBM_INCOMING_CONNECTION;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event,  9, con_handle);
+    little_endian_store_16(event, 11, BLUETOOTH_PSM_EATT);
+    event[13] = num_channels;
+    little_endian_store_16(event, 14, 0x0040);
+    (*eatt_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void eatt_simulate_channel_opened(hci_con_handle_t con_handle, uint16_t cid, uint16_t remote_mtu){
+    uint8_t event[23];
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_ECBM_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    event[2] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 10, con_handle);
+    little_endian_store_16(event, 15, cid);
+    little_endian_store_16(event, 21, remote_mtu);
+    (*eatt_packet_handler)(HCI_EVENT_PACKET, cid, event, sizeof(event));
+}
+
+static void eatt_simulate_can_send_now(uint16_t cid){
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CAN_SEND_NOW;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, cid);
+    can_send_now_requested[eatt_index_for_cid(cid)] = false;
+    (*eatt_packet_handler)(HCI_EVENT_PACKET, cid, event, sizeof(event));
+}
+
+static void eatt_simulate_channel_closed(uint16_t cid){
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CHANNEL_CLOSED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, cid);
+    (*eatt_packet_handler)(HCI_EVENT_PACKET, cid, event, sizeof(event));
+}
+
+static void eatt_simulate_read_request(uint16_t cid, uint16_t attribute_handle){
+    uint8_t request[3];
+    request[0] = ATT_READ_REQUEST;
+    little_endian_store_16(request, 1, attribute_handle);
+    (*eatt_packet_handler)(L2CAP_DATA_PACKET, cid, request, sizeof(request));
+}
+
+TEST_GROUP(ATT_SERVER_EATT){
+    hci_con_handle_t con_handle;
+    mock_btstack_tlv_t tlv_context;
+    const btstack_tlv_t * tlv_impl;
+
+    void setup(void){
+        con_handle = 0x01;
+        hci_setup_le_connection(con_handle);
+
+        tlv_impl = mock_btstack_tlv_init_instance(&tlv_context);
+        btstack_tlv_set_instance(tlv_impl, &tlv_context);
+
+        eatt_packet_handler = NULL;
+        memset(can_send_now_requested, 0, sizeof(can_send_now_requested));
+        memset(sent_opcode, 0, sizeof(sent_opcode));
+        memset(sent_error_code, 0, sizeof(sent_error_code));
+
+        att_db_util_init();
+        att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_BATTERY_SERVICE);
+        att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL, ATT_PROPERTY_READ, ATT_SECURITY_NONE, ATT_SECURITY_NONE, &battery_level, 1);
+        att_server_init(att_db_util_get_address(), NULL, NULL);
+    }
+
+    void teardown(void){
+        btstack_memory_simulate_malloc_failure(false);
+        mock_btstack_tlv_deinit(&tlv_context);
+        att_server_deinit();
+        hci_deinit();
+    }
+};
+
+TEST(ATT_SERVER_EATT, concurrent_requests_on_two_bearers){
+    uint8_t status = att_server_eatt_init(NUM_EATT_BEARERS, eatt_storage, sizeof(eatt_storage));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    CHECK(eatt_packet_handler != NULL);
+
+    eatt_simulate_incoming_connection(con_handle, NUM_EATT_BEARERS);
+    int i;
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        eatt_simulate_channel_opened(con_handle, eatt_cids[i], 64);
+    }
+
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL);
+    CHECK(value_handle != 0);
+
+    // request context pool exhausted, each EATT bearer uses its own request context
+    btstack_memory_simulate_malloc_failure(true);
+
+    // both requests are pending before any response can be sent
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        eatt_simulate_read_request(eatt_cids[i], value_handle);
+    }
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        CHECK_TRUE(can_send_now_requested[i]);
+        CHECK_EQUAL(0, sent_opcode[i]);
+    }
+
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        eatt_simulate_can_send_now(eatt_cids[i]);
+    }
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        CHECK_EQUAL(0, sent_error_code[i]);
+        CHECK_EQUAL(ATT_READ_RESPONSE, sent_opcode[i]);
+    }
+
+    // bearers accept new requests after the response was sent
+    memset(sent_opcode, 0, sizeof(sent_opcode));
+    eatt_simulate_read_request(eatt_cids[1], value_handle);
+    eatt_simulate_can_send_now(eatt_cids[1]);
+    CHECK_EQUAL(ATT_READ_RESPONSE, sent_opcode[1]);
+
+    for (i=0;i<NUM_EATT_BEARERS;i++){
+        eatt_simulate_channel_closed(eatt_cids[i]);
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -18,6 +18,8 @@
 #include "ble/att_db.h"
 #include "ble/att_db_util.h"
 #include "ble/att_server.h"
+#include "l2cap.h"
+#include "btstack_memory.h"
 #include "btstack_util.h"
 #include "bluetooth.h"
 #include "btstack_tlv.h"
@@ -36,6 +38,8 @@ extern "C" void mock_call_att_packet_handler(uint8_t packet_type, uint16_t chann
 extern "C" void mock_l2cap_set_max_mtu(uint16_t mtu);
 extern "C" void hci_setup_classic_connection(uint16_t con_handle);
 extern "C" void set_cmac_ready(int ready);
+extern "C" uint32_t mock_l2cap_get_num_packets_sent(void);
+extern "C" void mock_run_loop_advance_time_ms(uint32_t delta_ms);
 
 static uint8_t att_request[255];
 static uint16_t att_write_request(uint16_t request_type, uint16_t attribute_handle, uint16_t value_length, const uint8_t * value){
@@ -51,6 +55,7 @@ static uint16_t att_read_request(uint16_t request_type, uint16_t attribute_handl
     return 3;
 }
 
+static int att_read_callback_num_calls;
 static uint16_t att_read_callback(hci_con_handle_t connection_handle, uint16_t att_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
     UNUSED(connection_handle);
     UNUSED(att_handle);
@@ -58,6 +63,7 @@ static uint16_t att_read_callback(hci_con_handle_t connection_handle, uint16_t a
     UNUSED(buffer);
     UNUSED(buffer_size);
 
+    att_read_callback_num_calls++;
     return 0;
 }
 
@@ -296,6 +302,25 @@ TEST(ATT_SERVER, att_packet_handler_invalid_opcode){
     mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
 }
 
+TEST(ATT_SERVER, att_packet_handler_no_request_context){
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL);
+    uint16_t att_request_len = att_read_request(ATT_READ_REQUEST, value_handle);
+    const uint8_t * response = l2cap_get_outgoing_buffer();
+
+    // request rejected if no request context available
+    btstack_memory_simulate_malloc_failure(true);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    btstack_memory_simulate_malloc_failure(false);
+    CHECK_EQUAL(ATT_ERROR_RESPONSE, response[0]);
+    CHECK_EQUAL(ATT_READ_REQUEST, response[1]);
+    CHECK_EQUAL(ATT_ERROR_INSUFFICIENT_RESOURCES, response[4]);
+
+    // request context returned to pool after response
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    CHECK_EQUAL(battery_level, response[1]);
+}
+
 TEST(ATT_SERVER, att_packet_handler_ATT_HANDLE_VALUE_CONFIRMATION){
     hci_setup_le_connection(att_con_handle);
     static uint8_t value[] = {0x55};
@@ -507,6 +532,289 @@ TEST(ATT_SERVER, att_server_multiple_notify) {
     CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, status);
 }
 
+TEST(ATT_SERVER, att_server_notification_stream) {
+    att_server_notification_stream_t stream;
+    uint8_t storage[64];
+    uint8_t value[20];
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_STATE);
+    uint8_t status;
+    int i;
+
+    status = att_server_notification_stream_register(&stream, 0x50, value_handle, storage, sizeof(storage));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, status);
+    status = att_server_notification_stream_register(&stream, att_con_handle, value_handle, storage, sizeof(storage));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    status = att_server_notification_stream_register(&stream, att_con_handle, value_handle, storage, sizeof(storage));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, status);
+
+    // value larger than ATT MTU - 3
+    status = att_server_notification_stream_write(&stream, value, 21);
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, status);
+
+    // queue values until storage is full, 2 bytes overhead per value
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    for (i = 0; i < 6; i++){
+        memset(value, i, sizeof(value));
+        status = att_server_notification_stream_write(&stream, value, 8);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    }
+    status = att_server_notification_stream_write(&stream, value, 8);
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, status);
+    CHECK_EQUAL(0, stream.num_notifications_sent);
+
+    // all queued values are sent in a single can send now pass
+    uint32_t num_packets_sent = mock_l2cap_get_num_packets_sent();
+    l2cap_can_send_fixed_channel_packet_now_set_status(1);
+    uint8_t can_send_now_event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 1, 0};
+    mock_call_att_server_packet_handler(HCI_EVENT_PACKET, 0, can_send_now_event, sizeof(can_send_now_event));
+    CHECK_EQUAL(6, mock_l2cap_get_num_packets_sent() - num_packets_sent);
+    CHECK_EQUAL(6, stream.num_notifications_sent);
+    CHECK_EQUAL(48, stream.num_bytes_sent);
+    CHECK_EQUAL(0, stream.bytes_used);
+
+    // values wrapping around end of storage are sent as single notification
+    const uint8_t * packet = l2cap_get_outgoing_buffer();
+    for (i = 0; i < 4; i++){
+        memset(value, 0x10 + i, sizeof(value));
+        status = att_server_notification_stream_write(&stream, value, 20);
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+        CHECK_EQUAL(ATT_HANDLE_VALUE_NOTIFICATION, packet[0]);
+        CHECK_EQUAL(value_handle, little_endian_read_16(packet, 1));
+        MEMCMP_EQUAL(value, &packet[3], 20);
+    }
+    CHECK_EQUAL(10, stream.num_notifications_sent);
+
+    att_server_notification_stream_unregister(&stream);
+    status = att_server_notification_stream_write(&stream, value, 8);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, status);
+}
+
+TEST(ATT_SERVER, att_server_notification_stream_large_storage) {
+    static uint8_t storage[40000];
+    att_server_notification_stream_t stream;
+    uint8_t value[20];
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_STATE);
+    uint8_t can_send_now_event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 1, 0};
+    const uint8_t * packet = l2cap_get_outgoing_buffer();
+    int i;
+
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notification_stream_register(&stream, att_con_handle, value_handle, storage, sizeof(storage)));
+
+    // move read position close to end of storage
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    for (i = 0; i < 1800; i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notification_stream_write(&stream, value, sizeof(value)));
+    }
+    l2cap_can_send_fixed_channel_packet_now_set_status(1);
+    mock_call_att_server_packet_handler(HCI_EVENT_PACKET, 0, can_send_now_event, sizeof(can_send_now_event));
+    CHECK_EQUAL(39600, stream.read_pos);
+
+    // read position + bytes used exceeds 16 bit
+    l2cap_can_send_fixed_channel_packet_now_set_status(0);
+    for (i = 0; i < 1500; i++){
+        memset(value, i, sizeof(value));
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, att_server_notification_stream_write(&stream, value, sizeof(value)));
+    }
+    l2cap_can_send_fixed_channel_packet_now_set_status(1);
+    mock_call_att_server_packet_handler(HCI_EVENT_PACKET, 0, can_send_now_event, sizeof(can_send_now_event));
+    CHECK_EQUAL(0, stream.bytes_used);
+    CHECK_EQUAL(3300, stream.num_notifications_sent);
+    MEMCMP_EQUAL(value, &packet[3], sizeof(value));
+
+    att_server_notification_stream_unregister(&stream);
+}
+
+TEST(ATT_SERVER, att_server_value_cache) {
+    att_server_value_cache_t cache;
+    uint8_t storage[40];
+    uint8_t value[30];
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BLOOD_PRESSURE_FEATURE);
+    const uint8_t * response = l2cap_get_outgoing_buffer();
+    uint16_t att_request_len;
+    uint8_t status;
+    int i;
+
+    for (i = 0; i < (int) sizeof(value); i++){
+        value[i] = (uint8_t) i;
+    }
+
+    status = att_server_value_cache_store(value_handle, value, sizeof(value));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, status);
+    att_server_value_cache_register(&cache, value_handle, storage, sizeof(storage), 1000);
+    status = att_server_value_cache_store(value_handle, value, sizeof(storage) + 1);
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, status);
+    status = att_server_value_cache_store(value_handle, value, sizeof(value));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+
+    // read and read blob served from cache
+    att_read_callback_num_calls = 0;
+    att_request_len = att_read_request(ATT_READ_REQUEST, value_handle);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    MEMCMP_EQUAL(value, &response[1], ATT_DEFAULT_MTU - 1);
+    att_request_len = att_read_request(ATT_READ_BLOB_REQUEST, value_handle);
+    little_endian_store_16(att_request, 3, ATT_DEFAULT_MTU - 1);
+    att_request_len += 2;
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(ATT_READ_BLOB_RESPONSE, response[0]);
+    MEMCMP_EQUAL(&value[ATT_DEFAULT_MTU - 1], &response[1], sizeof(value) - (ATT_DEFAULT_MTU - 1));
+    CHECK_EQUAL(0, att_read_callback_num_calls);
+
+    // cached value expired
+    mock_run_loop_advance_time_ms(1000);
+    att_request_len = att_read_request(ATT_READ_REQUEST, value_handle);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(2, att_read_callback_num_calls);
+
+    // invalidated cached value
+    status = att_server_value_cache_store(value_handle, value, sizeof(value));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, status);
+    att_server_value_cache_invalidate(value_handle);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(4, att_read_callback_num_calls);
+
+    att_server_value_cache_unregister(&cache);
+    status = att_server_value_cache_store(value_handle, value, sizeof(value));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, status);
+}
+
+TEST(ATT_SERVER, att_server_service_changed) {
+    uint8_t service_changed[4] = { 0 };
+    att_db_util_add_service_uuid16(ORG_BLUETOOTH_SERVICE_GENERIC_ATTRIBUTE);
+    att_db_util_add_characteristic_uuid16(ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED, ATT_PROPERTY_INDICATE, ATT_SECURITY_NONE, ATT_SECURITY_NONE, service_changed, sizeof(service_changed));
+    att_server_init(att_db_util_get_address(), att_read_callback, att_write_callback);
+    uint16_t value_handle = gatt_server_get_value_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED);
+    uint16_t ccc_handle = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED);
+    const uint8_t * packet = l2cap_get_outgoing_buffer();
+    uint16_t att_request_len;
+
+    // not subscribed
+    att_server_service_changed(0x0010, 0x0020);
+    CHECK_TRUE(att_server_client_change_aware(att_con_handle));
+
+    // enable indications
+    uint8_t ccc[] = { GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_INDICATION, 0 };
+    att_request_len = att_write_request(ATT_WRITE_REQUEST, ccc_handle, sizeof(ccc), ccc);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, packet[0]);
+
+    // changed range is indicated, client change-unaware until confirmed
+    att_server_service_changed(0x0010, 0x0020);
+    CHECK_FALSE(att_server_client_change_aware(att_con_handle));
+    CHECK_EQUAL(ATT_HANDLE_VALUE_INDICATION, packet[0]);
+    CHECK_EQUAL(value_handle, little_endian_read_16(packet, 1));
+    CHECK_EQUAL(0x0010, little_endian_read_16(packet, 3));
+    CHECK_EQUAL(0x0020, little_endian_read_16(packet, 5));
+
+    uint8_t confirmation[] = { ATT_HANDLE_VALUE_CONFIRMATION };
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, att_con_handle, confirmation, sizeof(confirmation));
+    CHECK_TRUE(att_server_client_change_aware(att_con_handle));
+}
+
+static void write_ccc(uint16_t con_handle, uint16_t ccc_handle, uint16_t value){
+    uint8_t ccc[2];
+    little_endian_store_16(ccc, 0, value);
+    uint16_t att_request_len = att_write_request(ATT_WRITE_REQUEST, ccc_handle, sizeof(ccc), ccc);
+    mock_call_att_server_packet_handler(ATT_DATA_PACKET, con_handle, &att_request[0], att_request_len);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, l2cap_get_outgoing_buffer()[0]);
+}
+
+TEST(ATT_SERVER, persistent_ccc_write_coalescing) {
+    const uint16_t uuids[] = {
+        ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL,
+        ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_STATE,
+        ORG_BLUETOOTH_CHARACTERISTIC_BODY_SENSOR_LOCATION,
+    };
+    uint16_t ccc_handles[3];
+    uint16_t i;
+    for (i=0;i<3;i++){
+        ccc_handles[i] = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, uuids[i]);
+        CHECK(ccc_handles[i] != 0);
+    }
+
+    // client enables CCCs several times, no flash writes until flush
+    uint16_t round;
+    for (round=0;round<5;round++){
+        for (i=0;i<3;i++){
+            write_ccc(att_con_handle, ccc_handles[i], GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+            write_ccc(att_con_handle, ccc_handles[i], 0);
+            write_ccc(att_con_handle, ccc_handles[i], GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+        }
+    }
+    CHECK_EQUAL(0, tlv_context.num_store_tag);
+    CHECK_EQUAL(0, tlv_context.num_delete_tag);
+
+    // disconnect writes one tag per CCC
+    uint8_t disconnect[6];
+    disconnect[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    disconnect[1] = 4;
+    disconnect[2] = 0;
+    little_endian_store_16(disconnect, 3, att_con_handle);
+    disconnect[5] = 0;
+    mock_call_att_packet_handler(HCI_EVENT_PACKET, 0, &disconnect[0], sizeof(disconnect));
+    CHECK_EQUAL(3, tlv_context.num_store_tag);
+    CHECK_EQUAL(0, tlv_context.num_delete_tag);
+
+    // after restart, values are loaded from TLV and re-enabling the same values does not write
+    att_server_init(att_db_util_get_address(), att_read_callback, att_write_callback);
+    hci_setup_le_connection(att_con_handle);
+    for (i=0;i<3;i++){
+        write_ccc(att_con_handle, ccc_handles[i], GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+    }
+    att_server_persistent_ccc_flush();
+    CHECK_EQUAL(3, tlv_context.num_store_tag);
+
+    // disable single CCC
+    write_ccc(att_con_handle, ccc_handles[1], 0);
+    att_server_persistent_ccc_flush();
+    CHECK_EQUAL(3, tlv_context.num_store_tag);
+    CHECK_EQUAL(1, tlv_context.num_delete_tag);
+}
+
+TEST(ATT_SERVER, persistent_ccc_pending_writes_stored_on_deinit) {
+    uint16_t ccc_handle = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL);
+    write_ccc(att_con_handle, ccc_handle, GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+    CHECK_EQUAL(0, tlv_context.num_store_tag);
+    att_server_deinit();
+    CHECK_EQUAL(1, tlv_context.num_store_tag);
+}
+
+TEST(ATT_SERVER, persistent_ccc_pending_writes_stored_on_init) {
+    uint16_t ccc_handle = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL);
+    write_ccc(att_con_handle, ccc_handle, GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+    CHECK_EQUAL(0, tlv_context.num_store_tag);
+    att_server_init(att_db_util_get_address(), att_read_callback, att_write_callback);
+    CHECK_EQUAL(1, tlv_context.num_store_tag);
+}
+
+TEST(ATT_SERVER, persistent_ccc_pending_writes_stored_in_previous_tlv) {
+    const uint16_t uuids[] = {
+        ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL,
+        ORG_BLUETOOTH_CHARACTERISTIC_BATTERY_LEVEL_STATE,
+    };
+    uint16_t ccc_handles[2];
+    uint16_t i;
+    for (i=0;i<2;i++){
+        ccc_handles[i] = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(0, 0xffff, uuids[i]);
+    }
+    write_ccc(att_con_handle, ccc_handles[0], GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+
+    // switch TLV, pending write goes to previous TLV
+    mock_btstack_tlv_t other_tlv_context;
+    const btstack_tlv_t * other_tlv_impl = mock_btstack_tlv_init_instance(&other_tlv_context);
+    btstack_tlv_set_instance(other_tlv_impl, &other_tlv_context);
+    write_ccc(att_con_handle, ccc_handles[1], GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+    CHECK_EQUAL(1, tlv_context.num_store_tag);
+
+    att_server_persistent_ccc_flush();
+    CHECK_EQUAL(1, tlv_context.num_store_tag);
+    CHECK_EQUAL(1, other_tlv_context.num_store_tag);
+
+    btstack_tlv_set_instance(tlv_impl, &tlv_context);
+    att_server_persistent_ccc_flush();
+    mock_btstack_tlv_deinit(&other_tlv_context);
+}
+
 TEST(ATT_SERVER, hci_event_encryption_key_refresh_complete_event) {
     uint8_t buffer[5];
     buffer[0] = HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE;
@@ -129,6 +129,7 @@ void hci_deinit(void){
     hci_connection.att_server.ir_le_device_db_index = 0;
     hci_connection.att_server.notification_requests = NULL;
     hci_connection.att_server.indication_requests = NULL;
+    hci_connection.att_server.notification_streams = NULL;
     connections = NULL;
 }
 
@@ -195,8 +196,15 @@ void l2cap_request_can_send_fix_channel_now_event(uint16_t handle, uint16_t chan
     att_server_packet_handler(HCI_EVENT_PACKET, 0, (uint8_t*)event, sizeof(event));
 }
 
+static uint32_t mock_l2cap_num_packets_sent;
+
+uint32_t mock_l2cap_get_num_packets_sent(void){
+    return mock_l2cap_num_packets_sent;
+}
+
 uint8_t l2cap_send_prepared_connectionless(uint16_t handle, uint16_t cid, uint16_t len){
 	att_connection_t att_connection;
+    mock_l2cap_num_packets_sent++;
     hci_setup_le_connection(handle);
 	uint8_t response[max_mtu];
 	uint16_t response_len = att_handle_request(&att_connection, l2cap_get_outgoing_buffer(), len, &response[0]);
@@ -252,6 +260,16 @@ void * btstack_run_loop_get_timer_context(btstack_timer_source_t *ts){
     return ts->context;
 }
 
+static uint32_t mock_time_ms;
+
+uint32_t btstack_run_loop_get_time_ms(void){
+    return mock_time_ms;
+}
+
+void mock_run_loop_advance_time_ms(uint32_t delta_ms){
+    mock_time_ms += delta_ms;
+}
+
 // todo:
 hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t addr, bd_addr_type_t addr_type){
 	printf("hci_connection_for_bd_addr_and_type not implemented in mock backend\n");
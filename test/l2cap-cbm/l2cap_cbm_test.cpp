@@ -90,6 +90,8 @@ static uint16_t initial_credits = L2CAP_LE_AUTOMATIC_CREDITS;
 static uint8_t data_channel_buffer[TEST_PACKET_SIZE];
 static uint16_t l2cap_cid;
 static bool l2cap_channel_opened;
+static const uint8_t * l2cap_received_sdu;
+static uint16_t l2cap_received_sdu_len;
 static uint8_t l2cap_channel_open_status;
 static btstack_packet_callback_registration_t l2cap_event_callback_registration;
 
@@ -97,6 +99,7 @@ static btstack_packet_callback_registration_t l2cap_event_callback_registration;
 extern "C" void l2cap_setup_test_channels_fuzz(void);
 extern "C" void l2cap_free_channels_fuzz(void);
 extern "C" l2cap_channel_t * l2cap_get_dynamic_channel_fuzz(void);
+extern "C" uint32_t l2cap_get_channel_visits_fuzz(void);
 
 // l2cap random public function
 extern "C"  void l2cap_finalize_channel_close(l2cap_channel_t * channel);
@@ -166,6 +169,10 @@ static void l2cap_channel_packet_handler(uint8_t packet_type, uint16_t channel,
                     break;
             }
             break;
+        case L2CAP_DATA_PACKET:
+            l2cap_received_sdu = packet;
+            l2cap_received_sdu_len = size;
+            break;
         default:
             break;
     }
@@ -185,6 +192,8 @@ TEST_GROUP(L2CAP_CHANNELS){
         hci_dump_init(hci_dump_posix_stdout_get_instance());
         l2cap_channel_opened = false;
         l2cap_channel_open_status = 0xff;
+        l2cap_received_sdu = NULL;
+        l2cap_received_sdu_len = 0;
         allow_sending();
         btstack_memory_simulate_malloc_failure(false);
     }
@@ -456,6 +465,251 @@ TEST(L2CAP_CHANNELS, le_credit_indication_unknown_cid){
     mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, packet, sizeof(packet));
     CHECK_EQUAL(0, mock_hci_transport_outgoing_packet_size);
 }
+
+static void simulate_packet_sent(void){
+    const uint8_t transport_packet_sent[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0 };
+    const uint8_t num_completed_packets[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, HCI_CON_HANDLE_TEST_LE, 0, 1, 0 };
+    mock_hci_transport_receive_packet(HCI_EVENT_PACKET, transport_packet_sent, sizeof(transport_packet_sent));
+    mock_hci_transport_receive_packet(HCI_EVENT_PACKET, num_completed_packets, sizeof(num_completed_packets));
+}
+
+// open incoming channels with local and remote cids 0x41, 0x42, ...
+static void open_incoming_channels(uint16_t num_channels){
+    hci_setup_test_connections_fuzz();
+    l2cap_cbm_register_service(&l2cap_channel_packet_handler, TEST_PSM, LEVEL_0);
+    l2cap_channel_accept_incoming = true;
+    uint16_t i;
+    for (i = 0; i < num_channels; i++){
+        uint8_t packet[sizeof(le_data_channel_conn_request_1)];
+        memcpy(packet, le_data_channel_conn_request_1, sizeof(packet));
+        packet[9] = 1 + i;
+        little_endian_store_16(packet, 14, 0x41 + i);
+        mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, packet, sizeof(packet));
+        simulate_packet_sent();
+    }
+}
+
+// send sdu on both channels, returns remote cids of outgoing pdus
+static void send_on_two_channels(uint16_t * out_cids, uint16_t num_pdus){
+    static uint8_t sdu[TEST_PACKET_SIZE];
+    mock_hci_transport_outgoing_packet_size = 0;
+    l2cap_send(0x41, sdu, sizeof(sdu));
+    l2cap_send(0x42, sdu, sizeof(sdu));
+    uint16_t i;
+    for (i = 0; i < num_pdus; i++){
+        out_cids[i] = little_endian_read_16(mock_hci_transport_outgoing_packet_buffer, 6);
+        simulate_packet_sent();
+    }
+}
+
+TEST(L2CAP_CHANNELS, scheduler_priority){
+    open_incoming_channels(2);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_send_priority(0x42, 1, 1));
+    CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_set_send_priority(0x50, 1, 1));
+
+    // 3 pdus per sdu, first pdu of channel 0x41 is sent right away
+    uint16_t cids[6];
+    send_on_two_channels(cids, 6);
+    const uint16_t expected[] = { 0x41, 0x42, 0x42, 0x42, 0x41, 0x41 };
+    MEMCMP_EQUAL(expected, cids, sizeof(expected));
+
+    l2cap_send_statistics_t statistics;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_get_send_statistics(0x41, &statistics));
+    CHECK_EQUAL(3, statistics.num_packets);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_get_send_statistics(0x42, &statistics));
+    CHECK_EQUAL(3, statistics.num_packets);
+}
+
+TEST(L2CAP_CHANNELS, scheduler_weight){
+    open_incoming_channels(2);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_send_priority(0x42, 0, 2));
+
+    uint16_t cids[6];
+    send_on_two_channels(cids, 6);
+    const uint16_t expected[] = { 0x41, 0x42, 0x42, 0x41, 0x42, 0x41 };
+    MEMCMP_EQUAL(expected, cids, sizeof(expected));
+}
+
+TEST(L2CAP_CHANNELS, run_visits_only_channels_with_pending_work){
+    const uint16_t num_channels = 8;
+    open_incoming_channels(num_channels);
+    CHECK(l2cap_channel_opened);
+
+    // packet sent events don't visit idle channels or connections
+    uint32_t visits = l2cap_get_channel_visits_fuzz();
+    uint32_t connection_visits = hci_get_connection_visits_fuzz();
+    simulate_packet_sent();
+    CHECK_EQUAL(visits, l2cap_get_channel_visits_fuzz());
+    CHECK_EQUAL(connection_visits, hci_get_connection_visits_fuzz());
+
+    // data for first channel only visits this channel to return credits
+    const uint8_t data[] = { 0x05, 0x20, 0x07, 0x00, 0x03, 0x00, 0x41, 0x00, 0x01, 0x00, 0x42 };
+    visits = l2cap_get_channel_visits_fuzz();
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, data, sizeof(data));
+    simulate_packet_sent();
+    CHECK(l2cap_get_channel_visits_fuzz() - visits < num_channels);
+
+    // credit indication only visits the addressed channel
+    const uint8_t credits[] = {
+        0x05, 0x20, 0x0c, 0x00, 0x08, 0x00, 0x05, 0x00,
+        L2CAP_FLOW_CONTROL_CREDIT_INDICATION, 0x21, 0x04, 0x00, 0x45, 0x00, 0x01, 0x00
+    };
+    visits = l2cap_get_channel_visits_fuzz();
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, credits, sizeof(credits));
+    simulate_packet_sent();
+    CHECK_EQUAL(1, l2cap_get_channel_visits_fuzz() - visits);
+
+    // connection request only visits the new channel, not the existing ones
+    visits = l2cap_get_channel_visits_fuzz();
+    uint8_t packet[sizeof(le_data_channel_conn_request_1)];
+    memcpy(packet, le_data_channel_conn_request_1, sizeof(packet));
+    packet[9] = 0x20;
+    little_endian_store_16(packet, 14, 0x41 + num_channels);
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, packet, sizeof(packet));
+    simulate_packet_sent();
+    CHECK(l2cap_get_channel_visits_fuzz() - visits < 3);
+
+    // disconnection request only visits the addressed channel
+    const uint8_t disconnect[] = {
+        0x05, 0x20, 0x0c, 0x00, 0x08, 0x00, 0x05, 0x00,
+        DISCONNECTION_REQUEST, 0x22, 0x04, 0x00, 0x43, 0x00, 0x43, 0x00
+    };
+    visits = l2cap_get_channel_visits_fuzz();
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, disconnect, sizeof(disconnect));
+    simulate_packet_sent();
+    CHECK(l2cap_get_channel_visits_fuzz() - visits < 3);
+    CHECK(l2cap_get_channel_visits_fuzz() - visits > 0);
+}
+
+// first ready channel, records number of channels passed to the scheduler
+static uint16_t scheduler_max_channels;
+static l2cap_channel_t * test_scheduler_select_channel(l2cap_channel_t * channels, bool (*ready_to_send)(l2cap_channel_t * channel)){
+    uint16_t num_channels = 0;
+    l2cap_channel_t * selected = NULL;
+    l2cap_channel_t * channel;
+    for (channel = channels; channel != NULL; channel = channel->send_next){
+        num_channels++;
+        if ((selected == NULL) && (*ready_to_send)(channel)){
+            selected = channel;
+        }
+    }
+    scheduler_max_channels = btstack_max(scheduler_max_channels, num_channels);
+    return selected;
+}
+
+static void test_scheduler_channel_served(l2cap_channel_t * channel){
+    UNUSED(channel);
+}
+
+static const l2cap_scheduler_t test_scheduler = {
+    &test_scheduler_select_channel,
+    &test_scheduler_channel_served
+};
+
+TEST(L2CAP_CHANNELS, scheduler_gets_only_channels_with_send_request){
+    open_incoming_channels(8);
+    l2cap_set_scheduler(&test_scheduler);
+    scheduler_max_channels = 0;
+
+    uint16_t cids[3];
+    static uint8_t sdu[TEST_PACKET_SIZE];
+    mock_hci_transport_outgoing_packet_size = 0;
+    l2cap_send(0x44, sdu, sizeof(sdu));
+    uint16_t i;
+    for (i = 0; i < 3; i++){
+        cids[i] = little_endian_read_16(mock_hci_transport_outgoing_packet_buffer, 6);
+        simulate_packet_sent();
+    }
+    const uint16_t expected[] = { 0x44, 0x44, 0x44 };
+    MEMCMP_EQUAL(expected, cids, sizeof(expected));
+    CHECK_EQUAL(1, scheduler_max_channels);
+
+    // idle channels are not passed to the scheduler
+    scheduler_max_channels = 0;
+    simulate_packet_sent();
+    CHECK_EQUAL(0, scheduler_max_channels);
+}
+
+// receive k-frame for local cid 0x41
+static void receive_pdu(const uint8_t * payload, uint16_t len){
+    uint8_t packet[8 + TEST_PACKET_SIZE];
+    little_endian_store_16(packet, 0, HCI_CON_HANDLE_TEST_LE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + len);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, 0x41);
+    memcpy(&packet[8], payload, len);
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, packet, 8 + len);
+}
+
+static uint8_t provided_buffer[TEST_PACKET_SIZE];
+static uint16_t provided_sdu_len;
+static uint8_t * provide_receive_buffer(uint16_t local_cid, uint16_t sdu_len){
+    CHECK_EQUAL(0x41, local_cid);
+    provided_sdu_len = sdu_len;
+    return provided_buffer;
+}
+
+static uint8_t * released_buffer;
+static void release_receive_buffer(uint16_t local_cid, uint8_t * buffer){
+    CHECK_EQUAL(0x41, local_cid);
+    released_buffer = buffer;
+}
+
+TEST(L2CAP_CHANNELS, receive_single_pdu_sdu_in_place){
+    open_incoming_channels(1);
+    const uint8_t pdu[] = { 0x03, 0x00, 0x01, 0x02, 0x03 };
+    receive_pdu(pdu, sizeof(pdu));
+    CHECK_EQUAL(3, l2cap_received_sdu_len);
+    MEMCMP_EQUAL(&pdu[2], l2cap_received_sdu, 3);
+    // not copied into receive buffer
+    CHECK(l2cap_received_sdu != data_channel_buffer);
+}
+
+TEST(L2CAP_CHANNELS, receive_buffer_provider){
+    open_incoming_channels(1);
+    CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_set_receive_buffer_provider(0x50, &provide_receive_buffer, &release_receive_buffer));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(0x41, &provide_receive_buffer, &release_receive_buffer));
+    // SDU of 6 bytes in two k-frames is reassembled in provided buffer
+    const uint8_t pdu_1[] = { 0x06, 0x00, 0x01, 0x02, 0x03 };
+    const uint8_t pdu_2[] = { 0x04, 0x05, 0x06 };
+    receive_pdu(pdu_1, sizeof(pdu_1));
+    CHECK_EQUAL(6, provided_sdu_len);
+    POINTERS_EQUAL(NULL, l2cap_received_sdu);
+    receive_pdu(pdu_2, sizeof(pdu_2));
+    POINTERS_EQUAL(provided_buffer, l2cap_received_sdu);
+    CHECK_EQUAL(6, l2cap_received_sdu_len);
+    const uint8_t expected[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+    MEMCMP_EQUAL(expected, provided_buffer, sizeof(expected));
+    // without provider, SDU is reassembled in receive buffer
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(0x41, NULL, NULL));
+    receive_pdu(pdu_1, sizeof(pdu_1));
+    receive_pdu(pdu_2, sizeof(pdu_2));
+    POINTERS_EQUAL(data_channel_buffer, l2cap_received_sdu);
+    MEMCMP_EQUAL(expected, data_channel_buffer, sizeof(expected));
+}
+
+TEST(L2CAP_CHANNELS, receive_buffer_provider_release_on_disconnect){
+    open_incoming_channels(1);
+    released_buffer = NULL;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(0x41, &provide_receive_buffer, &release_receive_buffer));
+    // completed SDU is not released
+    const uint8_t pdu_1[] = { 0x06, 0x00, 0x01, 0x02, 0x03 };
+    const uint8_t pdu_2[] = { 0x04, 0x05, 0x06 };
+    receive_pdu(pdu_1, sizeof(pdu_1));
+    receive_pdu(pdu_2, sizeof(pdu_2));
+    POINTERS_EQUAL(provided_buffer, l2cap_received_sdu);
+    POINTERS_EQUAL(NULL, released_buffer);
+    // buffer of incomplete SDU is released on disconnect
+    receive_pdu(pdu_1, sizeof(pdu_1));
+    const uint8_t disconnect[] = {
+        0x05, 0x20, 0x0c, 0x00, 0x08, 0x00, 0x05, 0x00,
+        DISCONNECTION_REQUEST, 0x22, 0x04, 0x00, 0x41, 0x00, 0x41, 0x00
+    };
+    mock_hci_transport_receive_packet(HCI_ACL_DATA_PACKET, disconnect, sizeof(disconnect));
+    simulate_packet_sent();
+    POINTERS_EQUAL(provided_buffer, released_buffer);
+}
+
 TEST(L2CAP_CHANNELS, fuzz) {
     l2cap_setup_test_channels_fuzz();
     l2cap_channel_t * channel = l2cap_get_dynamic_channel_fuzz();
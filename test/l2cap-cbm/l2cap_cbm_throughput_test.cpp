@@ -0,0 +1,313 @@
+// Throughput benchmark for LE Credit-Based Flow Control Mode with automatic credits
+//
+// A simulated remote sends SDUs as fast as the link and its credits allow. Each connection event
+// allows for a fixed number of PDUs given by PHY, connection interval and MPS. Credits provided by
+// the local L2CAP layer reach the remote in the next connection event. The benchmark reports
+// link utilization and the number of LE Flow Control Credit indications sent.
+//
+// The adaptive credit window only applies after the initial credits are used up, which requires
+// L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL to be set, see Makefile.
+
+#ifndef L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL
+#error "L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL required"
+#endif
+
+// hal_cpu
+#include "hal_cpu.h"
+void hal_cpu_disable_irqs(void){}
+void hal_cpu_enable_irqs(void){}
+void hal_cpu_enable_irqs_and_sleep(void){}
+
+// mock_sm.c
+#include "ble/sm.h"
+void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){}
+void sm_request_pairing(hci_con_handle_t con_handle){}
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop_embedded.h"
+#include "btstack_util.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+
+#define HCI_CON_HANDLE_TEST_LE 0x0005
+#define TEST_PSM               0x1001
+#define REMOTE_CID             0x0041
+#define SDU_SIZE               512
+#define BENCHMARK_DURATION_MS  5000
+
+// simulated time
+static uint32_t sim_time_ms;
+static btstack_run_loop_t sim_run_loop;
+
+static uint32_t sim_run_loop_get_time_ms(void){
+    return sim_time_ms;
+}
+
+// mock hci transport, outgoing packets are processed after each incoming packet
+static void (*mock_hci_transport_packet_handler)(uint8_t packet_type, uint8_t * packet, uint16_t size);
+static uint8_t  mock_hci_transport_outgoing_packet_buffer[HCI_ACL_PAYLOAD_SIZE];
+static uint16_t mock_hci_transport_outgoing_packet_size;
+static bool     mock_hci_transport_outgoing_packet_pending;
+
+static void mock_hci_transport_register_packet_handler(void (*packet_handler)(uint8_t packet_type, uint8_t * packet, uint16_t size)){
+    mock_hci_transport_packet_handler = packet_handler;
+}
+static int mock_hci_transport_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return mock_hci_transport_outgoing_packet_pending ? 0 : 1;
+}
+static int mock_hci_transport_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    UNUSED(packet_type);
+    mock_hci_transport_outgoing_packet_size = (uint16_t) size;
+    mock_hci_transport_outgoing_packet_pending = true;
+    memcpy(mock_hci_transport_outgoing_packet_buffer, packet, size);
+    return 0;
+}
+static const hci_transport_t * mock_hci_transport_mock_get_instance(void){
+    static hci_transport_t mock_hci_transport = {
+        /*  .transport.name                          = */  "mock",
+        /*  .transport.init                          = */  NULL,
+        /*  .transport.open                          = */  NULL,
+        /*  .transport.close                         = */  NULL,
+        /*  .transport.register_packet_handler       = */  &mock_hci_transport_register_packet_handler,
+        /*  .transport.can_send_packet_now           = */  &mock_hci_transport_can_send_packet_now,
+        /*  .transport.send_packet                   = */  &mock_hci_transport_send_packet,
+        /*  .transport.set_baudrate                  = */  NULL,
+    };
+    return &mock_hci_transport;
+}
+
+// benchmark scenario and results
+typedef struct {
+    const char * name;
+    uint8_t  phy_mbps;
+    uint16_t connection_interval;   // 1.25 ms units
+    uint16_t mps;
+} scenario_t;
+
+typedef struct {
+    uint32_t num_pdus;
+    uint32_t num_pdus_capacity;
+    uint32_t num_credit_indications;
+    uint32_t num_stalled_events;
+    uint32_t num_sdus;
+} result_t;
+
+static const scenario_t * scenario;
+static result_t result;
+
+// remote state
+static uint16_t remote_credits;
+static uint16_t remote_credits_pending;
+static uint16_t remote_sdu_pos;
+static uint16_t local_cid;
+static uint8_t  receive_buffer[SDU_SIZE];
+
+static void process_outgoing_packet(void){
+    const uint8_t * packet = mock_hci_transport_outgoing_packet_buffer;
+    uint16_t cid = little_endian_read_16(packet, 6);
+    if (cid == L2CAP_CID_SIGNALING_LE){
+        switch (packet[8]){
+            case LE_CREDIT_BASED_CONNECTION_RESPONSE:
+                remote_credits = little_endian_read_16(packet, 18);
+                CHECK_EQUAL(L2CAP_CREDIT_BASED_FLOW_CONTROL_MODE_AUTOMATIC_CREDITS_INITIAL, remote_credits);
+                break;
+            case L2CAP_FLOW_CONTROL_CREDIT_INDICATION:
+                // credits are received in next connection event
+                remote_credits_pending += little_endian_read_16(packet, 14);
+                result.num_credit_indications++;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void deliver_packet(const uint8_t * packet, uint16_t size){
+    (*mock_hci_transport_packet_handler)(HCI_ACL_DATA_PACKET, (uint8_t *) packet, size);
+    while (mock_hci_transport_outgoing_packet_pending){
+        process_outgoing_packet();
+        mock_hci_transport_outgoing_packet_pending = false;
+        const uint8_t packet_sent[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0 };
+        (*mock_hci_transport_packet_handler)(HCI_EVENT_PACKET, (uint8_t *) packet_sent, sizeof(packet_sent));
+        const uint8_t num_completed[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, HCI_CON_HANDLE_TEST_LE, 0, 1, 0 };
+        (*mock_hci_transport_packet_handler)(HCI_EVENT_PACKET, (uint8_t *) num_completed, sizeof(num_completed));
+    }
+}
+
+static void remote_send_connection_request(void){
+    uint8_t packet[] = {
+        HCI_CON_HANDLE_TEST_LE, 0x20, 0x12, 0x00, 0x0e, 0x00, 0x05, 0x00,
+        LE_CREDIT_BASED_CONNECTION_REQUEST, 0x01, 0x0a, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    little_endian_store_16(packet, 12, TEST_PSM);
+    little_endian_store_16(packet, 14, REMOTE_CID);
+    little_endian_store_16(packet, 16, SDU_SIZE);
+    little_endian_store_16(packet, 18, scenario->mps);
+    little_endian_store_16(packet, 20, 0xffff);
+    deliver_packet(packet, sizeof(packet));
+}
+
+static void remote_send_pdu(void){
+    static uint8_t packet[8 + 0xffff];
+    uint16_t pos = 8;
+    uint16_t max_payload = scenario->mps;
+    // first PDU starts with SDU length
+    if (remote_sdu_pos == 0u){
+        little_endian_store_16(packet, pos, SDU_SIZE);
+        pos += 2u;
+        max_payload -= 2u;
+    }
+    uint16_t payload_len = btstack_min(max_payload, SDU_SIZE - remote_sdu_pos);
+    memset(&packet[pos], 0x55, payload_len);
+    pos += payload_len;
+    remote_sdu_pos += payload_len;
+    if (remote_sdu_pos == SDU_SIZE){
+        remote_sdu_pos = 0;
+    }
+    little_endian_store_16(packet, 0, HCI_CON_HANDLE_TEST_LE | 0x2000);
+    little_endian_store_16(packet, 2, pos - 4u);
+    little_endian_store_16(packet, 4, pos - 8u);
+    little_endian_store_16(packet, 6, local_cid);
+    remote_credits--;
+    result.num_pdus++;
+    deliver_packet(packet, pos);
+}
+
+// PDUs per connection event: data packets with 251 bytes LL payload acknowledged by empty packets, 90% of interval usable
+static uint32_t pdus_per_connection_event(void){
+    uint32_t l2cap_pdu_len = scenario->mps + 4u;
+    uint32_t num_ll_packets = (l2cap_pdu_len + 250u) / 251u;
+    uint32_t ll_payload_len = (l2cap_pdu_len + num_ll_packets - 1u) / num_ll_packets;
+    // preamble, access address, header, MIC, CRC: 2 + 4 + 2 + 4 + 3 bytes on 2M PHY
+    uint32_t data_us  = ((ll_payload_len + 15u) * 8u) / scenario->phy_mbps + 150u;
+    uint32_t empty_us = ((2u + 4u + 2u + 3u) * 8u) / scenario->phy_mbps + 150u;
+    uint32_t pdu_us = num_ll_packets * (data_us + empty_us);
+    uint32_t usable_us = (uint32_t) scenario->connection_interval * 1250u * 9u / 10u;
+    return btstack_max(1u, usable_us / pdu_us);
+}
+
+static void l2cap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t * packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) == L2CAP_EVENT_CBM_INCOMING_CONNECTION){
+                local_cid = l2cap_event_cbm_incoming_connection_get_local_cid(packet);
+                l2cap_cbm_accept_connection(local_cid, receive_buffer, sizeof(receive_buffer), L2CAP_LE_AUTOMATIC_CREDITS);
+            }
+            break;
+        case L2CAP_DATA_PACKET:
+            CHECK_EQUAL(SDU_SIZE, size);
+            result.num_sdus++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void run_benchmark(const scenario_t * the_scenario){
+    scenario = the_scenario;
+    memset(&result, 0, sizeof(result));
+    remote_credits = 0;
+    remote_credits_pending = 0;
+    remote_sdu_pos = 0;
+    local_cid = 0;
+    sim_time_ms = 0;
+
+    hci_setup_test_connections_fuzz();
+    hci_connection_t * connection = hci_connection_for_handle(HCI_CON_HANDLE_TEST_LE);
+    CHECK(connection != NULL);
+    connection->le_connection_interval = scenario->connection_interval;
+    l2cap_set_max_le_mtu(scenario->mps);
+    l2cap_cbm_register_service(&l2cap_packet_handler, TEST_PSM, LEVEL_0);
+    remote_send_connection_request();
+    CHECK(local_cid != 0);
+
+    uint32_t pdus_per_event = pdus_per_connection_event();
+    uint32_t interval_us = (uint32_t) scenario->connection_interval * 1250u;
+    uint32_t time_us;
+    for (time_us = 0; time_us < (BENCHMARK_DURATION_MS * 1000u); time_us += interval_us){
+        sim_time_ms = time_us / 1000u;
+        remote_credits += remote_credits_pending;
+        remote_credits_pending = 0;
+        result.num_pdus_capacity += pdus_per_event;
+        uint32_t i;
+        for (i = 0; i < pdus_per_event; i++){
+            if (remote_credits == 0u){
+                result.num_stalled_events++;
+                break;
+            }
+            remote_send_pdu();
+        }
+    }
+
+    uint32_t utilization = (result.num_pdus * 100u) / result.num_pdus_capacity;
+    uint32_t throughput_kbps = (result.num_sdus * SDU_SIZE * 8u) / BENCHMARK_DURATION_MS;
+    printf("%-24s: %5u PDUs, %3u%% utilization, %5u kbit/s, %4u credit indications, %3u stalled events\n",
+           scenario->name, result.num_pdus, utilization, throughput_kbps, result.num_credit_indications, result.num_stalled_events);
+}
+
+TEST_GROUP(L2CAP_CBM_THROUGHPUT){
+    void setup(void){
+        btstack_memory_init();
+        sim_run_loop = *btstack_run_loop_embedded_get_instance();
+        sim_run_loop.get_time_ms = &sim_run_loop_get_time_ms;
+        btstack_run_loop_init(&sim_run_loop);
+        hci_init(mock_hci_transport_mock_get_instance(), NULL);
+        l2cap_init();
+        mock_hci_transport_outgoing_packet_pending = false;
+    }
+    void teardown(void){
+        l2cap_deinit();
+        hci_deinit();
+        btstack_memory_deinit();
+        btstack_run_loop_deinit();
+    }
+    void check_result(void){
+        // remote is not blocked by missing credits
+        CHECK(result.num_stalled_events == 0);
+        CHECK_EQUAL(result.num_pdus_capacity, result.num_pdus);
+        // credits adapted after initial credits, with fewer credit indications than with fixed increment
+        CHECK(result.num_credit_indications > 0u);
+        CHECK(result.num_credit_indications * 5u <= result.num_pdus);
+    }
+};
+
+TEST(L2CAP_CBM_THROUGHPUT, le_1m_7_5ms_mps_247){
+    const scenario_t scenario_1m = { "1M PHY, 7.5 ms, MPS 247", 1, 6, 247 };
+    run_benchmark(&scenario_1m);
+    check_result();
+}
+
+TEST(L2CAP_CBM_THROUGHPUT, le_2m_7_5ms_mps_247){
+    const scenario_t scenario_2m = { "2M PHY, 7.5 ms, MPS 247", 2, 6, 247 };
+    run_benchmark(&scenario_2m);
+    check_result();
+}
+
+TEST(L2CAP_CBM_THROUGHPUT, le_2m_50ms_mps_247){
+    const scenario_t scenario_2m_long = { "2M PHY, 50 ms, MPS 247", 2, 40, 247 };
+    run_benchmark(&scenario_2m_long);
+    check_result();
+}
+
+TEST(L2CAP_CBM_THROUGHPUT, le_2m_15ms_mps_64){
+    const scenario_t scenario_2m_small = { "2M PHY, 15 ms, MPS 64", 2, 12, 64 };
+    run_benchmark(&scenario_2m_small);
+    check_result();
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
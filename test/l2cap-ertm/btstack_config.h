@@ -0,0 +1,31 @@
+//
+// btstack_config.h for L2CAP ERTM tests
+//
+
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+// Port related features
+#define HAVE_MALLOC
+#define HAVE_POSIX_FILE_IO
+#define HAVE_POSIX_TIME
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_CLASSIC
+#define ENABLE_LOG_ERROR
+#define ENABLE_PRINTF_HEXDUMP
+#define ENABLE_PRINTF_TO_LOG
+
+#define ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#define ENABLE_LE_CENTRAL
+#define ENABLE_LE_PERIPHERAL
+
+// for ready-to-use hci channels
+#define FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 255
+#define HCI_INCOMING_PRE_BUFFER_SIZE 4
+
+#endif
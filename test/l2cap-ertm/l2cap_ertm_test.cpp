@@ -0,0 +1,780 @@
+// Simulated-loss tests for L2CAP Enhanced Retransmission Mode
+//
+// A simulated remote L2CAP entity opens an ERTM channel and exchanges I-frames with the local L2CAP layer.
+// I-frames are lost on their first transmission at a fixed interval. The tests count retransmitted I-frames
+// with selective reject (SREJ) recovery. As reference, the same remote sender is run against a receiver that
+// only uses reject (REJ), which leads to go-back-N retransmission of all frames following a lost frame.
+
+// hal_cpu
+#include "hal_cpu.h"
+void hal_cpu_disable_irqs(void){}
+void hal_cpu_enable_irqs(void){}
+void hal_cpu_enable_irqs_and_sleep(void){}
+
+// mock_sm.c
+#include "ble/sm.h"
+void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){ UNUSED(callback_handler); }
+void sm_request_pairing(hci_con_handle_t con_handle){ UNUSED(con_handle); }
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop_embedded.h"
+#include "btstack_util.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+
+#define HCI_CON_HANDLE_TEST_CLASSIC 0x0003
+#define TEST_PSM                    0x1001
+#define REMOTE_CID                  0x0041
+#define REMOTE_MPS                  40
+#define LOSS_INTERVAL               10
+#define MAX_FRAMES                  20000
+#define QUEUE_SIZE                  64
+
+// L2CAP constants, see l2cap.c
+#define CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL 0x04
+#define CONFIG_OPTION_FRAME_CHECK_SEQUENCE            0x05
+#define CONFIG_OPTION_EXTENDED_WINDOW_SIZE            0x07
+#define CONFIG_RESULT_SUCCESS                         0x0000
+#define INFO_TYPE_EXTENDED_FEATURES_SUPPORTED         0x0002
+
+typedef enum {
+    SUPERVISORY_FUNCTION_RR = 0,
+    SUPERVISORY_FUNCTION_REJ,
+    SUPERVISORY_FUNCTION_RNR,
+    SUPERVISORY_FUNCTION_SREJ
+} supervisory_function_t;
+
+// remote extended features: ERTM, FCS Option, Extended Window Size
+#define REMOTE_FEATURES_ERTM        0x0028
+#define REMOTE_FEATURES_ERTM_EWS    0x0128
+
+// mock hci transport, outgoing packets are forwarded to the remote entity by pump()
+static void (*mock_hci_transport_packet_handler)(uint8_t packet_type, uint8_t * packet, uint16_t size);
+static uint8_t  mock_hci_transport_outgoing_packet_buffer[HCI_ACL_PAYLOAD_SIZE + 4];
+static uint16_t mock_hci_transport_outgoing_packet_size;
+static bool     mock_hci_transport_outgoing_packet_pending;
+
+static void mock_hci_transport_register_packet_handler(void (*packet_handler)(uint8_t packet_type, uint8_t * packet, uint16_t size)){
+    mock_hci_transport_packet_handler = packet_handler;
+}
+static int mock_hci_transport_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return mock_hci_transport_outgoing_packet_pending ? 0 : 1;
+}
+static int mock_hci_transport_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    UNUSED(packet_type);
+    mock_hci_transport_outgoing_packet_size = (uint16_t) size;
+    mock_hci_transport_outgoing_packet_pending = true;
+    memcpy(mock_hci_transport_outgoing_packet_buffer, packet, size);
+    return 0;
+}
+static const hci_transport_t * mock_hci_transport_mock_get_instance(void){
+    static hci_transport_t mock_hci_transport = {
+        /*  .transport.name                          = */  "mock",
+        /*  .transport.init                          = */  NULL,
+        /*  .transport.open                          = */  NULL,
+        /*  .transport.close                         = */  NULL,
+        /*  .transport.register_packet_handler       = */  &mock_hci_transport_register_packet_handler,
+        /*  .transport.can_send_packet_now           = */  &mock_hci_transport_can_send_packet_now,
+        /*  .transport.send_packet                   = */  &mock_hci_transport_send_packet,
+        /*  .transport.set_baudrate                  = */  NULL,
+    };
+    return &mock_hci_transport;
+}
+
+// packets from remote to local L2CAP
+static uint8_t  queue_packets[QUEUE_SIZE][HCI_ACL_PAYLOAD_SIZE + 4];
+static uint16_t queue_sizes[QUEUE_SIZE];
+static uint16_t queue_read;
+static uint16_t queue_count;
+
+// results
+typedef struct {
+    uint32_t num_frames_lost;
+    uint32_t num_frames_retransmitted;
+    uint32_t num_srej;
+    uint32_t num_rej;
+    uint32_t num_sdus;
+} result_t;
+
+static result_t result;
+
+// local L2CAP
+static l2cap_ertm_config_t ertm_config;
+static uint8_t  ertm_buffer[40000] __attribute__((aligned(16)));
+static uint32_t ertm_buffer_size;
+static uint16_t local_cid;
+static bool     local_channel_open;
+static uint16_t local_sdu_size;
+static const uint8_t * local_sdu_buffer;
+
+// remote L2CAP configuration
+static uint16_t remote_features;
+static uint16_t remote_rx_window;
+static uint16_t remote_tx_window;
+static bool     remote_extended_control;
+static uint8_t  remote_sig_id;
+
+// remote sender: frame indices are absolute, tx_seq = index & mask
+static uint32_t remote_num_frames;
+static uint16_t remote_fragments_per_sdu;
+static uint32_t remote_next_frame;
+static uint32_t remote_acked_frames;
+static uint32_t remote_highest_frame_sent;
+static uint32_t remote_srej_frames[MAX_FRAMES];
+static uint16_t remote_srej_read;
+static uint16_t remote_srej_count;
+
+// remote receiver
+static uint32_t remote_expected_frame;
+static uint32_t remote_srej_next_frame;
+static bool     remote_stored_frames[MAX_FRAMES];
+static bool     remote_sent_frames[MAX_FRAMES];
+static bool     remote_reject_sent;
+
+static uint16_t seq_mask(void){
+    return remote_extended_control ? 0x3fff : 0x3f;
+}
+
+static uint32_t frame_for_seq(uint32_t base_frame, uint16_t seq){
+    return base_frame + ((seq - base_frame) & seq_mask());
+}
+
+static bool frame_lost_on_first_transmission(uint32_t frame, uint32_t num_frames){
+    // keep tail frames, as their loss is only detected by timeout
+    if ((frame + remote_tx_window + remote_rx_window) >= num_frames) return false;
+    return (frame % LOSS_INTERVAL) == (LOSS_INTERVAL - 1u);
+}
+
+static void remote_send_l2cap(uint16_t cid, const uint8_t * data, uint16_t len){
+    CHECK(queue_count < QUEUE_SIZE);
+    uint16_t index = (queue_read + queue_count) % QUEUE_SIZE;
+    uint8_t * packet = queue_packets[index];
+    little_endian_store_16(packet, 0, HCI_CON_HANDLE_TEST_CLASSIC | 0x2000);
+    little_endian_store_16(packet, 2, len + 4u);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, cid);
+    memcpy(&packet[8], data, len);
+    queue_sizes[index] = len + 8u;
+    queue_count++;
+}
+
+static void remote_send_signaling(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t command[64];
+    command[0] = code;
+    command[1] = sig_id;
+    little_endian_store_16(command, 2, len);
+    memcpy(&command[4], data, len);
+    remote_send_l2cap(L2CAP_CID_SIGNALING, command, len + 4u);
+}
+
+static uint16_t remote_store_control(uint8_t * buffer, uint32_t control){
+    if (remote_extended_control){
+        little_endian_store_32(buffer, 0, control);
+        return 4;
+    }
+    little_endian_store_16(buffer, 0, (uint16_t) control);
+    return 2;
+}
+
+static void remote_send_supervisor_frame(supervisory_function_t s, uint16_t req_seq){
+    uint8_t frame[4];
+    uint32_t control;
+    if (remote_extended_control){
+        control = (((uint32_t) s) << 16) | (((uint32_t) req_seq) << 2) | 1u;
+    } else {
+        control = (((uint32_t) req_seq) << 8) | (((uint32_t) s) << 2) | 1u;
+    }
+    uint16_t len = remote_store_control(frame, control);
+    remote_send_l2cap(local_cid, frame, len);
+}
+
+static void remote_send_configure_request(void){
+    uint8_t data[4 + 11 + 3 + 4];
+    uint16_t pos = 0;
+    little_endian_store_16(data, pos, local_cid);
+    pos += 2;
+    little_endian_store_16(data, pos, 0);
+    pos += 2;
+    data[pos++] = CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL;
+    data[pos++] = 9;
+    data[pos++] = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+    data[pos++] = (uint8_t) btstack_min(remote_rx_window, 63);
+    data[pos++] = 3;
+    little_endian_store_16(data, pos, 2000);
+    pos += 2;
+    little_endian_store_16(data, pos, 12000);
+    pos += 2;
+    little_endian_store_16(data, pos, REMOTE_MPS);
+    pos += 2;
+    // No FCS
+    data[pos++] = CONFIG_OPTION_FRAME_CHECK_SEQUENCE;
+    data[pos++] = 1;
+    data[pos++] = 0;
+    if (remote_rx_window > 63){
+        data[pos++] = CONFIG_OPTION_EXTENDED_WINDOW_SIZE;
+        data[pos++] = 2;
+        little_endian_store_16(data, pos, remote_rx_window);
+        pos += 2;
+    }
+    remote_send_signaling(CONFIGURE_REQUEST, ++remote_sig_id, data, pos);
+}
+
+static void remote_handle_configure_request(uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint16_t pos = 4;
+    while ((pos + 2u) <= len){
+        uint8_t type = data[pos] & 0x7f;
+        uint8_t option_len = data[pos+1];
+        const uint8_t * option = &data[pos+2];
+        switch (type){
+            case CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL:
+                CHECK_EQUAL(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, option[0]);
+                if (remote_extended_control == false){
+                    remote_tx_window = option[1];
+                }
+                break;
+            case CONFIG_OPTION_EXTENDED_WINDOW_SIZE:
+                remote_tx_window = little_endian_read_16(option, 0);
+                remote_extended_control = true;
+                break;
+            default:
+                break;
+        }
+        pos += 2u + option_len;
+    }
+    uint8_t response[6];
+    little_endian_store_16(response, 0, REMOTE_CID);
+    little_endian_store_16(response, 2, 0);
+    little_endian_store_16(response, 4, CONFIG_RESULT_SUCCESS);
+    remote_send_signaling(CONFIGURE_RESPONSE, sig_id, response, sizeof(response));
+}
+
+static void remote_handle_signaling(const uint8_t * command){
+    uint8_t code = command[0];
+    uint8_t sig_id = command[1];
+    uint16_t len = little_endian_read_16(command, 2);
+    const uint8_t * data = &command[4];
+    uint8_t response[12];
+    switch (code){
+        case INFORMATION_REQUEST:
+            little_endian_store_16(response, 0, little_endian_read_16(data, 0));
+            little_endian_store_16(response, 2, 0);
+            if (little_endian_read_16(data, 0) == INFO_TYPE_EXTENDED_FEATURES_SUPPORTED){
+                little_endian_store_32(response, 4, remote_features);
+                remote_send_signaling(INFORMATION_RESPONSE, sig_id, response, 8);
+            } else {
+                memset(&response[4], 0, 8);
+                response[4] = 0x02;
+                remote_send_signaling(INFORMATION_RESPONSE, sig_id, response, 12);
+            }
+            break;
+        case CONNECTION_RESPONSE:
+            if (little_endian_read_16(data, 4) == 0){
+                remote_send_configure_request();
+            }
+            break;
+        case CONFIGURE_REQUEST:
+            remote_handle_configure_request(sig_id, data, len);
+            break;
+        default:
+            break;
+    }
+}
+
+// remote sender: handle S-frames
+static void remote_sender_handle_supervisor_frame(supervisory_function_t s, uint16_t req_seq){
+    uint32_t frame = frame_for_seq(remote_acked_frames, req_seq);
+    switch (s){
+        case SUPERVISORY_FUNCTION_RR:
+            remote_acked_frames = btstack_max(remote_acked_frames, frame);
+            break;
+        case SUPERVISORY_FUNCTION_REJ:
+            // go-back-N
+            result.num_rej++;
+            remote_acked_frames = btstack_max(remote_acked_frames, frame);
+            remote_next_frame = remote_acked_frames;
+            break;
+        case SUPERVISORY_FUNCTION_SREJ:
+            result.num_srej++;
+            CHECK(remote_srej_count < MAX_FRAMES);
+            remote_srej_frames[(remote_srej_read + remote_srej_count) % MAX_FRAMES] = frame;
+            remote_srej_count++;
+            break;
+        default:
+            break;
+    }
+}
+
+// remote receiver: handle I-frames, send RR or SREJ for missing frames
+static void remote_receiver_deliver(uint32_t frame){
+    UNUSED(frame);
+    result.num_sdus++;
+    remote_expected_frame++;
+}
+
+static void remote_receiver_handle_information_frame(uint16_t tx_seq){
+    uint32_t frame = frame_for_seq(remote_expected_frame, tx_seq);
+    if (remote_sent_frames[frame] == false){
+        remote_sent_frames[frame] = true;
+        if (frame_lost_on_first_transmission(frame, remote_num_frames)){
+            result.num_frames_lost++;
+            return;
+        }
+    } else {
+        result.num_frames_retransmitted++;
+    }
+    if (frame == remote_expected_frame){
+        remote_receiver_deliver(frame);
+        while (remote_stored_frames[remote_expected_frame]){
+            remote_receiver_deliver(remote_expected_frame);
+        }
+        remote_send_supervisor_frame(SUPERVISORY_FUNCTION_RR, remote_expected_frame & seq_mask());
+        return;
+    }
+    remote_stored_frames[frame] = true;
+    uint32_t missing_frame;
+    for (missing_frame = btstack_max(remote_expected_frame, remote_srej_next_frame); missing_frame < frame; missing_frame++){
+        if (remote_stored_frames[missing_frame]) continue;
+        result.num_srej++;
+        remote_send_supervisor_frame(SUPERVISORY_FUNCTION_SREJ, missing_frame & seq_mask());
+    }
+    remote_srej_next_frame = btstack_max(remote_srej_next_frame, frame + 1u);
+}
+
+static void remote_handle_packet(const uint8_t * packet, uint16_t size){
+    uint16_t cid = little_endian_read_16(packet, 6);
+    if (cid == L2CAP_CID_SIGNALING){
+        remote_handle_signaling(&packet[8]);
+        return;
+    }
+    CHECK_EQUAL(REMOTE_CID, cid);
+    CHECK(local_channel_open);
+    uint32_t control;
+    if (remote_extended_control){
+        control = little_endian_read_32(packet, 8);
+        uint16_t req_seq = (control >> 2) & 0x3fff;
+        if (control & 1){
+            remote_sender_handle_supervisor_frame((supervisory_function_t) ((control >> 16) & 3), req_seq);
+        } else {
+            remote_receiver_handle_information_frame((control >> 18) & 0x3fff);
+        }
+    } else {
+        control = little_endian_read_16(packet, 8);
+        uint16_t req_seq = (control >> 8) & 0x3f;
+        if (control & 1){
+            remote_sender_handle_supervisor_frame((supervisory_function_t) ((control >> 2) & 3), req_seq);
+        } else {
+            remote_receiver_handle_information_frame((control >> 1) & 0x3f);
+        }
+    }
+    UNUSED(size);
+}
+
+// forward packets between local and remote L2CAP until both are idle
+static void pump(void){
+    while (true){
+        if (mock_hci_transport_outgoing_packet_pending){
+            uint8_t packet[HCI_ACL_PAYLOAD_SIZE + 4];
+            uint16_t size = mock_hci_transport_outgoing_packet_size;
+            memcpy(packet, mock_hci_transport_outgoing_packet_buffer, size);
+            mock_hci_transport_outgoing_packet_pending = false;
+            const uint8_t packet_sent[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0 };
+            (*mock_hci_transport_packet_handler)(HCI_EVENT_PACKET, (uint8_t *) packet_sent, sizeof(packet_sent));
+            const uint8_t num_completed[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, HCI_CON_HANDLE_TEST_CLASSIC, 0, 1, 0 };
+            (*mock_hci_transport_packet_handler)(HCI_EVENT_PACKET, (uint8_t *) num_completed, sizeof(num_completed));
+            remote_handle_packet(packet, size);
+            continue;
+        }
+        if (queue_count > 0u){
+            uint8_t * packet = queue_packets[queue_read];
+            uint16_t size = queue_sizes[queue_read];
+            queue_read = (queue_read + 1u) % QUEUE_SIZE;
+            queue_count--;
+            (*mock_hci_transport_packet_handler)(HCI_ACL_DATA_PACKET, packet, size);
+            continue;
+        }
+        break;
+    }
+}
+
+// remote sender: send one I-frame, retransmissions first. returns false if window is full or all frames sent
+static bool remote_sender_send_frame(void (*receiver)(uint16_t tx_seq, const uint8_t * frame, uint16_t len)){
+    uint32_t frame;
+    if (remote_srej_count > 0u){
+        frame = remote_srej_frames[remote_srej_read];
+        remote_srej_read = (remote_srej_read + 1u) % MAX_FRAMES;
+        remote_srej_count--;
+    } else {
+        if (remote_next_frame >= remote_num_frames) return false;
+        if (remote_next_frame >= (remote_acked_frames + remote_tx_window)) return false;
+        frame = remote_next_frame++;
+    }
+    bool retransmission = frame < remote_highest_frame_sent;
+    if (retransmission){
+        result.num_frames_retransmitted++;
+    } else {
+        remote_highest_frame_sent = frame + 1u;
+    }
+
+    // SAR: unsegmented, start, end, continuation
+    uint16_t fragment = frame % remote_fragments_per_sdu;
+    uint32_t sar;
+    if (remote_fragments_per_sdu == 1u){
+        sar = 0;
+    } else if (fragment == 0u){
+        sar = 1;
+    } else if (fragment == (remote_fragments_per_sdu - 1u)){
+        sar = 2;
+    } else {
+        sar = 3;
+    }
+
+    uint16_t tx_seq = frame & seq_mask();
+    uint32_t control;
+    if (remote_extended_control){
+        control = (((uint32_t) tx_seq) << 18) | (sar << 16);
+    } else {
+        control = (((uint32_t) tx_seq) << 1) | (sar << 14);
+    }
+    uint8_t i_frame[4 + 2 + 20];
+    uint16_t pos = remote_store_control(i_frame, control);
+    if (sar == 1u){
+        little_endian_store_16(i_frame, pos, 20 * remote_fragments_per_sdu);
+        pos += 2;
+    }
+    // fragments of 20 bytes, SDU starts with SDU index
+    memset(&i_frame[pos], 0x55, 20);
+    if (fragment == 0u){
+        little_endian_store_32(i_frame, pos, frame / remote_fragments_per_sdu);
+    }
+    pos += 20;
+
+    if ((retransmission == false) && frame_lost_on_first_transmission(frame, remote_num_frames)){
+        result.num_frames_lost++;
+        return true;
+    }
+    (*receiver)(tx_seq, i_frame, pos);
+    return true;
+}
+
+static void receiver_local_l2cap(uint16_t tx_seq, const uint8_t * frame, uint16_t len){
+    UNUSED(tx_seq);
+    remote_send_l2cap(local_cid, frame, len);
+    pump();
+}
+
+// swaps each pair of frames on the way to local L2CAP, so every other frame arrives out-of-order
+static uint8_t  swap_frame[4 + 2 + 20];
+static uint16_t swap_frame_len;
+static void receiver_swap_pairs_local_l2cap(uint16_t tx_seq, const uint8_t * frame, uint16_t len){
+    if (swap_frame_len == 0u){
+        memcpy(swap_frame, frame, len);
+        swap_frame_len = len;
+        return;
+    }
+    receiver_local_l2cap(tx_seq, frame, len);
+    uint16_t held_len = swap_frame_len;
+    swap_frame_len = 0;
+    receiver_local_l2cap(tx_seq, swap_frame, held_len);
+}
+
+// reference receiver: accepts only ExpectedTxSeq, sends REJ once for out-of-sequence frames
+static uint32_t reference_expected_frame;
+static void receiver_reject_only(uint16_t tx_seq, const uint8_t * frame, uint16_t len){
+    UNUSED(frame);
+    UNUSED(len);
+    uint32_t frame_index = frame_for_seq(reference_expected_frame, tx_seq);
+    if (frame_index == reference_expected_frame){
+        reference_expected_frame++;
+        result.num_sdus++;
+        remote_reject_sent = false;
+        remote_sender_handle_supervisor_frame(SUPERVISORY_FUNCTION_RR, reference_expected_frame & seq_mask());
+        return;
+    }
+    if (remote_reject_sent) return;
+    remote_reject_sent = true;
+    remote_sender_handle_supervisor_frame(SUPERVISORY_FUNCTION_REJ, reference_expected_frame & seq_mask());
+}
+
+static void l2cap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t * packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case L2CAP_EVENT_INCOMING_CONNECTION:
+                    local_cid = l2cap_event_incoming_connection_get_local_cid(packet);
+                    l2cap_ertm_accept_connection(local_cid, &ertm_config, ertm_buffer, ertm_buffer_size);
+                    break;
+                case L2CAP_EVENT_CHANNEL_OPENED:
+                    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_event_channel_opened_get_status(packet));
+                    local_channel_open = true;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case L2CAP_DATA_PACKET:
+            // SDUs are delivered in order
+            CHECK_EQUAL(local_sdu_size, size);
+            CHECK_EQUAL(result.num_sdus, little_endian_read_32(packet, 0));
+            local_sdu_buffer = packet;
+            result.num_sdus++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void open_channel(uint16_t features, uint16_t local_rx_window, uint16_t rx_window, uint32_t buffer_size){
+    remote_features = features;
+    remote_rx_window = rx_window;
+    ertm_config.ertm_mandatory = 1;
+    ertm_config.max_transmit = 3;
+    ertm_config.retransmission_timeout_ms = 2000;
+    ertm_config.monitor_timeout_ms = 12000;
+    ertm_config.local_mtu = 200;
+    ertm_config.num_tx_buffers = rx_window;
+    ertm_config.num_rx_buffers = local_rx_window;
+    ertm_config.fcs_option = 0;
+    ertm_buffer_size = buffer_size;
+
+    hci_setup_test_connections_fuzz();
+    l2cap_register_service(&l2cap_packet_handler, TEST_PSM, 200, LEVEL_0);
+    uint8_t connection_request[4];
+    little_endian_store_16(connection_request, 0, TEST_PSM);
+    little_endian_store_16(connection_request, 2, REMOTE_CID);
+    remote_send_signaling(CONNECTION_REQUEST, ++remote_sig_id, connection_request, sizeof(connection_request));
+    pump();
+    CHECK(local_channel_open);
+}
+
+// remote sends frames to local L2CAP or reference receiver
+static void run_receive(uint32_t num_frames, void (*receiver)(uint16_t tx_seq, const uint8_t * frame, uint16_t len)){
+    remote_num_frames = num_frames;
+    local_sdu_size = 20 * remote_fragments_per_sdu;
+    while (remote_sender_send_frame(receiver)){
+    }
+}
+
+// local L2CAP sends SDUs to remote receiver
+static void run_send(uint32_t num_frames, uint16_t sdu_size){
+    uint8_t sdu[200];
+    memset(sdu, 0x55, sizeof(sdu));
+    uint16_t frames_per_sdu = (sdu_size <= REMOTE_MPS) ? 1 : ((sdu_size + 2u + REMOTE_MPS - 1u) / REMOTE_MPS);
+    uint32_t num_sdus = num_frames / frames_per_sdu;
+    remote_num_frames = num_sdus * frames_per_sdu;
+    uint32_t sdus_sent = 0;
+    while (true){
+        bool progress = false;
+        while ((sdus_sent < num_sdus) && l2cap_can_send_packet_now(local_cid)){
+            CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_send(local_cid, sdu, sdu_size));
+            sdus_sent++;
+            progress = true;
+        }
+        pump();
+        if (progress == false) break;
+    }
+    CHECK_EQUAL(num_sdus, sdus_sent);
+    CHECK_EQUAL(remote_num_frames, remote_expected_frame);
+}
+
+TEST_GROUP(L2CAP_ERTM){
+    void setup(void){
+        btstack_memory_init();
+        btstack_run_loop_init(btstack_run_loop_embedded_get_instance());
+        hci_init(mock_hci_transport_mock_get_instance(), NULL);
+        l2cap_init();
+        mock_hci_transport_outgoing_packet_pending = false;
+        queue_read = 0;
+        queue_count = 0;
+        memset(&result, 0, sizeof(result));
+        local_cid = 0;
+        local_channel_open = false;
+        remote_extended_control = false;
+        remote_sig_id = 0x80;
+        remote_next_frame = 0;
+        remote_acked_frames = 0;
+        remote_highest_frame_sent = 0;
+        remote_fragments_per_sdu = 1;
+        remote_srej_read = 0;
+        remote_srej_count = 0;
+        remote_expected_frame = 0;
+        remote_srej_next_frame = 0;
+        remote_reject_sent = false;
+        reference_expected_frame = 0;
+        memset(remote_stored_frames, 0, sizeof(remote_stored_frames));
+        memset(remote_sent_frames, 0, sizeof(remote_sent_frames));
+    }
+    void teardown(void){
+        l2cap_deinit();
+        hci_deinit();
+        btstack_memory_deinit();
+        btstack_run_loop_deinit();
+    }
+    void report(const char * name, const result_t * reference){
+        printf("%-32s: %5u frames, %4u lost, %4u retransmitted (go-back-N: %5u), %4u SREJ\n", name,
+               remote_num_frames, result.num_frames_lost, result.num_frames_retransmitted,
+               reference->num_frames_retransmitted, result.num_srej);
+    }
+    result_t run_reference(uint32_t num_frames){
+        result_t srej_result = result;
+        memset(&result, 0, sizeof(result));
+        remote_next_frame = 0;
+        remote_acked_frames = 0;
+        remote_highest_frame_sent = 0;
+        run_receive(num_frames, &receiver_reject_only);
+        CHECK_EQUAL(num_frames, result.num_sdus);
+        result_t reference = result;
+        result = srej_result;
+        return reference;
+    }
+};
+
+TEST(L2CAP_ERTM, receive_selective_reject){
+    open_channel(REMOTE_FEATURES_ERTM, 16, 16, 4000);
+    CHECK_FALSE(remote_extended_control);
+    CHECK_EQUAL(16, remote_tx_window);
+    run_receive(1000, &receiver_local_l2cap);
+    CHECK_EQUAL(1000, result.num_sdus);
+    // only lost frames are retransmitted
+    CHECK(result.num_frames_lost > 0);
+    CHECK_EQUAL(result.num_frames_lost, result.num_frames_retransmitted);
+    CHECK_EQUAL(result.num_frames_lost, result.num_srej);
+    CHECK_EQUAL(0, result.num_rej);
+    result_t reference = run_reference(1000);
+    report("receive, window 16", &reference);
+    CHECK(result.num_frames_retransmitted < reference.num_frames_retransmitted);
+}
+
+TEST(L2CAP_ERTM, receive_extended_window){
+    open_channel(REMOTE_FEATURES_ERTM_EWS, 200, 16, 40000);
+    CHECK_TRUE(remote_extended_control);
+    CHECK_EQUAL(200, remote_tx_window);
+    // wrap 14-bit sequence numbers
+    run_receive(MAX_FRAMES, &receiver_local_l2cap);
+    CHECK_EQUAL(MAX_FRAMES, result.num_sdus);
+    CHECK_EQUAL(result.num_frames_lost, result.num_frames_retransmitted);
+    CHECK_EQUAL(result.num_frames_lost, result.num_srej);
+    result_t reference = run_reference(MAX_FRAMES);
+    report("receive, extended window 200", &reference);
+    CHECK(result.num_frames_retransmitted < reference.num_frames_retransmitted);
+}
+
+TEST(L2CAP_ERTM, extended_window_not_supported_by_remote){
+    open_channel(REMOTE_FEATURES_ERTM, 200, 16, 40000);
+    CHECK_FALSE(remote_extended_control);
+    // half of 6-bit sequence number space
+    CHECK_EQUAL(32, remote_tx_window);
+    run_receive(1000, &receiver_local_l2cap);
+    CHECK_EQUAL(1000, result.num_sdus);
+    CHECK_EQUAL(result.num_frames_lost, result.num_frames_retransmitted);
+}
+
+TEST(L2CAP_ERTM, receive_out_of_order_rx_buffers_exceed_half_sequence_space){
+    open_channel(REMOTE_FEATURES_ERTM, 40, 16, 4000);
+    CHECK_FALSE(remote_extended_control);
+    CHECK_EQUAL(32, remote_tx_window);
+    swap_frame_len = 0;
+    run_receive(1000, &receiver_swap_pairs_local_l2cap);
+    CHECK_EQUAL(0, swap_frame_len);
+    // all frames delivered in order, retransmissions of frames that arrived late are ignored as duplicates
+    CHECK_EQUAL(1000, result.num_sdus);
+    CHECK(result.num_frames_retransmitted >= result.num_frames_lost);
+}
+
+static uint8_t  provided_buffer[60];
+static uint32_t num_provided_buffers;
+static uint8_t * provide_receive_buffer(uint16_t cid, uint16_t sdu_len){
+    CHECK_EQUAL(local_cid, cid);
+    CHECK_EQUAL(sizeof(provided_buffer), sdu_len);
+    num_provided_buffers++;
+    return provided_buffer;
+}
+
+static uint32_t num_released_buffers;
+static void release_receive_buffer(uint16_t cid, uint8_t * buffer){
+    CHECK_EQUAL(local_cid, cid);
+    POINTERS_EQUAL(provided_buffer, buffer);
+    num_released_buffers++;
+}
+
+// replaces continuation frame with tx_seq 4 by start of a new SDU
+static void receiver_restart_sdu_local_l2cap(uint16_t tx_seq, const uint8_t * frame, uint16_t len){
+    if (tx_seq != 4u){
+        receiver_local_l2cap(tx_seq, frame, len);
+        return;
+    }
+    uint8_t start_frame[2 + 2 + 20];
+    little_endian_store_16(start_frame, 0, (uint16_t) ((tx_seq << 1) | (1u << 14)));
+    little_endian_store_16(start_frame, 2, sizeof(provided_buffer));
+    memcpy(&start_frame[4], &frame[2], 20);
+    receiver_local_l2cap(tx_seq, start_frame, sizeof(start_frame));
+}
+
+TEST(L2CAP_ERTM, receive_segmented_into_provided_buffer){
+    open_channel(REMOTE_FEATURES_ERTM, 16, 16, 4000);
+    num_provided_buffers = 0;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(local_cid, &provide_receive_buffer, &release_receive_buffer));
+    // SDUs of 3 fragments each are reassembled in provided buffer
+    remote_fragments_per_sdu = 3;
+    run_receive(999, &receiver_local_l2cap);
+    CHECK_EQUAL(333, result.num_sdus);
+    CHECK_EQUAL(333, num_provided_buffers);
+    POINTERS_EQUAL(provided_buffer, local_sdu_buffer);
+    CHECK_EQUAL(result.num_frames_lost, result.num_frames_retransmitted);
+}
+
+TEST(L2CAP_ERTM, receive_provided_buffer_released_on_new_start_and_invalid_end){
+    open_channel(REMOTE_FEATURES_ERTM, 16, 16, 4000);
+    num_provided_buffers = 0;
+    num_released_buffers = 0;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(local_cid, &provide_receive_buffer, &release_receive_buffer));
+    // SDU 0 complete, SDU 1 aborted by new start in frame 4, which is aborted by too short end in frame 5
+    remote_fragments_per_sdu = 3;
+    run_receive(6, &receiver_restart_sdu_local_l2cap);
+    CHECK_EQUAL(1, result.num_sdus);
+    CHECK_EQUAL(3, num_provided_buffers);
+    CHECK_EQUAL(2, num_released_buffers);
+}
+
+TEST(L2CAP_ERTM, receive_provided_buffer_released_on_disconnect){
+    open_channel(REMOTE_FEATURES_ERTM, 16, 16, 4000);
+    num_provided_buffers = 0;
+    num_released_buffers = 0;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_set_receive_buffer_provider(local_cid, &provide_receive_buffer, &release_receive_buffer));
+    // SDU 1 incomplete
+    remote_fragments_per_sdu = 3;
+    run_receive(4, &receiver_local_l2cap);
+    CHECK_EQUAL(1, result.num_sdus);
+    CHECK_EQUAL(0, num_released_buffers);
+    uint8_t disconnection_request[4];
+    little_endian_store_16(disconnection_request, 0, local_cid);
+    little_endian_store_16(disconnection_request, 2, REMOTE_CID);
+    remote_send_signaling(DISCONNECTION_REQUEST, ++remote_sig_id, disconnection_request, sizeof(disconnection_request));
+    pump();
+    CHECK_EQUAL(2, num_provided_buffers);
+    CHECK_EQUAL(1, num_released_buffers);
+}
+
+TEST(L2CAP_ERTM, send_selective_reject_segmented){
+    // SDUs of 3 fragments each, stored in tx ring buffer
+    open_channel(REMOTE_FEATURES_ERTM, 8, 16, 4000);
+    run_send(1200, 100);
+    CHECK(result.num_frames_lost > 0);
+    CHECK_EQUAL(result.num_frames_lost, result.num_frames_retransmitted);
+    CHECK_EQUAL(result.num_frames_lost, result.num_srej);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -234,6 +234,61 @@ TEST(LE_DEVICE_DB_TLV, ReplaceOldest){
     CHECK_EQUAL(num_entries, num_entries_test);
 }
 
+TEST(LE_DEVICE_DB_TLV, ReplaceLeastRecentlyUsed){
+    bd_addr_t addr;
+    sm_key_t  sm_key;
+    set_addr_and_sm_key(0x10, addr, sm_key);
+    int used_index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, sm_key);
+    CHECK_TRUE(used_index >= 0);
+    set_addr_and_sm_key(0x11, addr, sm_key);
+    int least_recently_used_index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, sm_key);
+    CHECK_TRUE(least_recently_used_index >= 0);
+    // fill table
+    int i;
+    for (i=2;i<NVM_NUM_DEVICE_DB_ENTRIES;i++){
+        set_addr_and_sm_key(0x10 + i, addr, sm_key);
+        int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, sm_key);
+        CHECK_TRUE(index >= 0);
+    }
+    CHECK_TRUE(le_device_db_last_used_get(used_index) < le_device_db_last_used_get(least_recently_used_index));
+
+    // first device becomes most recently used without flash write, marking it again doesn't change the order
+    static uint8_t flash_before_mark_used[HAL_FLASH_BANK_MEMORY_STORAGE_SIZE];
+    memcpy(flash_before_mark_used, hal_flash_bank_memory_storage, sizeof(flash_before_mark_used));
+    le_device_db_mark_used(used_index);
+    uint32_t last_used = le_device_db_last_used_get(used_index);
+    le_device_db_mark_used(used_index);
+    CHECK_EQUAL(last_used, le_device_db_last_used_get(used_index));
+    MEMCMP_EQUAL(flash_before_mark_used, hal_flash_bank_memory_storage, sizeof(flash_before_mark_used));
+
+    // add another one that overwrites least recently used one
+    set_addr_and_sm_key(0x22 + i, addr, sm_key);
+    int index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr, sm_key);
+    CHECK_EQUAL(least_recently_used_index, index);
+
+    // order of use has been stored before replacing an entry
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_EQUAL(last_used, le_device_db_last_used_get(used_index));
+    CHECK_TRUE(le_device_db_last_used_get(used_index) < le_device_db_last_used_get(index));
+}
+
+TEST(LE_DEVICE_DB_TLV, OrderOfUseStoredWithUpdate){
+    int first_index  = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_aa, sm_key_aa);
+    int second_index = le_device_db_add(BD_ADDR_TYPE_LE_PUBLIC, addr_bb, sm_key_bb);
+    le_device_db_mark_used(first_index);
+    CHECK_TRUE(le_device_db_last_used_get(first_index) > le_device_db_last_used_get(second_index));
+
+    // not stored yet
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_TRUE(le_device_db_last_used_get(first_index) < le_device_db_last_used_get(second_index));
+
+    // stored with next update of the entry
+    le_device_db_mark_used(first_index);
+    le_device_db_encryption_set(first_index, 0, NULL, sm_key_cc, 16, 0, 0, 0);
+    le_device_db_tlv_configure(btstack_tlv_impl, &btstack_tlv_context);
+    CHECK_TRUE(le_device_db_last_used_get(first_index) > le_device_db_last_used_get(second_index));
+}
+
 TEST(LE_DEVICE_DB_TLV, le_device_db_encryption_set_non_existing){
     uint16_t ediv = 16;
     int encryption_key_size = 10;
@@ -14,7 +14,9 @@
 #include "mesh/mesh_iv_index_seq_number.h"
 #include "mesh/mesh_lower_transport.h"
 #include "mesh/mesh_network.h"
+#include "mesh/mesh_node.h"
 #include "mesh/mesh_upper_transport.h"
+#include "mesh/mesh_virtual_addresses.h"
 #include "mesh/provisioning.h"
 #include "mesh/mesh_peer.h"
 #include "mock.h"
@@ -28,6 +30,8 @@ static uint8_t outgoing_gatt_network_pdu_len;
 
 static uint8_t outgoing_adv_network_pdu_data[29];
 static uint8_t outgoing_adv_network_pdu_len;
+static uint8_t outgoing_adv_network_pdu_count;
+static uint16_t outgoing_adv_network_pdu_interval;
 
 static uint8_t  recv_upper_transport_pdu_data[100];
 static uint16_t recv_upper_transport_pdu_len;
@@ -46,12 +50,12 @@ void adv_bearer_request_can_send_now_for_network_pdu(void){
     (*adv_packet_handler)(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
 }
 void adv_bearer_send_network_pdu(const uint8_t * network_pdu, uint16_t size, uint8_t count, uint16_t interval){
-    (void) count;
-    (void) interval;
     // printf("ADV Network PDU: ");
     // printf_hexdump(network_pdu, size);
     memcpy(outgoing_adv_network_pdu_data, network_pdu, size);
     outgoing_adv_network_pdu_len = size;
+    outgoing_adv_network_pdu_count = count;
+    outgoing_adv_network_pdu_interval = interval;
 }
 static void adv_bearer_emit_sent(void){
     uint8_t event[3];
@@ -267,11 +271,18 @@ static void test_proxy_server_callback_handler(mesh_network_callback_type_t call
     }
 }
 
+static uint16_t                test_upper_transport_sent_dst;
+static mesh_transport_status_t test_upper_transport_sent_status;
+
 static void test_upper_transport_access_message_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
     UNUSED(status);
 
     // free sent pdus
     if (callback_type == MESH_TRANSPORT_PDU_SENT) {
+        if (pdu->pdu_type == MESH_PDU_TYPE_UPPER_SEGMENTED_ACCESS){
+            test_upper_transport_sent_dst    = ((mesh_upper_transport_pdu_t *) pdu)->dst;
+            test_upper_transport_sent_status = status;
+        }
         mesh_upper_transport_pdu_free(pdu);
         return;
     }
@@ -326,6 +337,17 @@ static void test_upper_transport_control_message_handler(mesh_transport_callback
     }
 }
 
+// remove virtual addresses registered by test
+static void remove_virtual_addresses(void){
+    uint16_t pseudo_dst;
+    for (pseudo_dst = 0x8000; pseudo_dst < (0x8000 + MAX_NR_MESH_VIRTUAL_ADDRESSES); pseudo_dst++){
+        mesh_virtual_address_t * virtual_address = mesh_virtual_address_for_pseudo_dst(pseudo_dst);
+        if (virtual_address == NULL) continue;
+        mesh_virtual_address_remove(virtual_address);
+        btstack_memory_mesh_virtual_address_free(virtual_address);
+    }
+}
+
 TEST_GROUP(MessageTest){
     void setup(void){
         btstack_memory_init();
@@ -350,14 +372,20 @@ TEST_GROUP(MessageTest){
         outgoing_adv_network_pdu_len = 0;
         received_network_pdu = NULL;
         recv_upper_transport_pdu_len =0;
+        test_upper_transport_sent_dst = MESH_ADDRESS_UNSASSIGNED;
     }
     void teardown(void){
         // printf("-- teardown start --\n\n");
         btstack_crypto_reset();
         mesh_network_reset();
+        mesh_network_cache_reset();
         mesh_lower_transport_reset();
         mesh_upper_transport_dump();
         mesh_upper_transport_reset();
+        remove_virtual_addresses();
+        mesh_node_primary_element_address_set(MESH_ADDRESS_UNSASSIGNED);
+        mesh_foundation_relay_set(0);
+        mesh_foundation_relay_retransmit_set(0);
         // mesh_network_dump();
         // mesh_transport_dump();
         printf("-- teardown complete --\n\n");
@@ -424,6 +452,23 @@ static void test_receive_network_pdus(int count, char ** network_pdus, char ** l
     CHECK_EQUAL_ARRAY(transport_pdu_data, recv_upper_transport_pdu_data, transport_pdu_len);
 }
 
+// complete pending crypto operations and outgoing network pdus, e.g. relayed ones
+static void process_outgoing_network_pdus(void){
+    while (true){
+        if (outgoing_gatt_network_pdu_len != 0){
+            outgoing_gatt_network_pdu_len = 0;
+            gatt_bearer_emit_sent();
+            continue;
+        }
+        if (outgoing_adv_network_pdu_len != 0){
+            outgoing_adv_network_pdu_len = 0;
+            adv_bearer_emit_sent();
+            continue;
+        }
+        if (mock_process_hci_cmd() == 0) break;
+    }
+}
+
 static void expect_gatt_network_pdu(void){
 
         while (outgoing_gatt_network_pdu_len == 0) {
@@ -1013,6 +1058,45 @@ TEST(MessageTest, Message22Receive){
     test_receive_network_pdus(1, message22_network_pdus, message22_lower_transport_pdus, message22_upper_transport_pdu);
 }
 
+TEST(MessageTest, Message22ReceiveWithOtherKeyAndLabelForSameAidAndHash){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345677);
+    // add other application key with same AID that is tried first
+    static mesh_transport_key_t other_application_key;
+    other_application_key.netkey_index = 0;
+    other_application_key.appkey_index = 1;
+    other_application_key.aid = 0x26;
+    other_application_key.akf = 1;
+    other_application_key.internal_index = 1;
+    btstack_parse_hex("00112233445566778899aabbccddeeff", 16, other_application_key.key);
+    mesh_transport_key_remove(&test_application_key);
+    mesh_transport_key_add(&other_application_key);
+    mesh_transport_key_add(&test_application_key);
+    // register other label uuid with same hash
+    uint8_t label_uuid[16];
+    btstack_parse_hex("00112233445566778899aabbccddeeff", 16, label_uuid);
+    mesh_virtual_address_register(label_uuid, 0xb529);
+    btstack_parse_hex(message22_label_string, 16, label_uuid);
+    mesh_virtual_address_register(label_uuid, 0xb529);
+
+    // other AppKey and Label UUID are tried before the matching combination
+    uint32_t num_decrypt_attempts = mesh_upper_transport_get_num_decrypt_attempts();
+    test_receive_network_pdus(1, message22_network_pdus, message22_lower_transport_pdus, message22_upper_transport_pdu);
+    CHECK(mesh_upper_transport_get_num_decrypt_attempts() - num_decrypt_attempts > 1);
+
+    // same message again: AppKey and Label UUID cached for source are tried first, other candidates are skipped
+    process_outgoing_network_pdus();
+    mesh_network_reset();
+    mesh_network_cache_reset();
+    mesh_seq_auth_reset();
+    recv_upper_transport_pdu_len = 0;
+    num_decrypt_attempts = mesh_upper_transport_get_num_decrypt_attempts();
+    test_receive_network_pdus(1, message22_network_pdus, message22_lower_transport_pdus, message22_upper_transport_pdu);
+    CHECK_EQUAL(1, mesh_upper_transport_get_num_decrypt_attempts() - num_decrypt_attempts);
+
+    mesh_transport_key_remove(&other_application_key);
+}
+
 TEST(MessageTest, Message22Send){
     uint16_t netkey_index = 0;
     uint16_t appkey_index = 0;
@@ -1203,6 +1287,229 @@ TEST(MessageTest, ServiceDataUsingNodeIdentityTest){
     btstack_crypto_aes128_encrypt(&crypto_request_aes128, identity_key, plaintext, hash, mesh_proxy_handle_get_aes128, NULL);
 }
 
+// Segmented messages to different unicast addresses
+
+static uint16_t test_adv_network_pdus_sent;
+
+static void test_process_bearers(void){
+    mock_process_hci_cmd();
+    if (outgoing_gatt_network_pdu_len != 0){
+        outgoing_gatt_network_pdu_len = 0;
+        gatt_bearer_emit_sent();
+    }
+    if (outgoing_adv_network_pdu_len != 0){
+        outgoing_adv_network_pdu_len = 0;
+        test_adv_network_pdus_sent++;
+        adv_bearer_emit_sent();
+    }
+}
+
+static void test_process_bearers_until_num_pdus_sent(uint16_t num_pdus){
+    int i;
+    for (i=0; (i < 1000) && (test_adv_network_pdus_sent < num_pdus); i++){
+        test_process_bearers();
+    }
+    CHECK_EQUAL(num_pdus, test_adv_network_pdus_sent);
+}
+
+static mesh_upper_transport_pdu_t * test_send_segmented_access_message(uint16_t src, uint16_t dest, uint16_t payload_len){
+    uint8_t payload[100];
+    uint16_t i;
+    for (i=0;i<payload_len;i++){
+        payload[i] = (uint8_t) i;
+    }
+    mesh_upper_transport_builder_t builder;
+    mesh_upper_transport_message_init(&builder, MESH_PDU_TYPE_UPPER_SEGMENTED_ACCESS);
+    mesh_upper_transport_message_add_data(&builder, payload, payload_len);
+    mesh_pdu_t * pdu = (mesh_pdu_t *) mesh_upper_transport_message_finalize(&builder);
+    mesh_upper_transport_setup_access_pdu_header(pdu, 0, 0, 3, src, dest, 0);
+    mesh_upper_transport_send_access_pdu(pdu);
+    return (mesh_upper_transport_pdu_t *) pdu;
+}
+
+static void test_receive_segment_acknowledgement(uint16_t src, uint16_t dest, uint32_t seq, uint32_t seq_auth, uint32_t block_ack){
+    uint8_t ack_pdu[7];
+    ack_pdu[0] = MESH_TRANSPORT_OPCODE_ACK;
+    big_endian_store_16(ack_pdu, 1, (seq_auth & 0x1fff) << 2);
+    big_endian_store_32(ack_pdu, 3, block_ack);
+    mesh_network_pdu_t * network_pdu = mesh_network_pdu_get();
+    mesh_network_setup_pdu(network_pdu, 0, 0x68, 1, 0, seq, src, dest, ack_pdu, sizeof(ack_pdu));
+    mesh_lower_transport_received_message(MESH_NETWORK_PDU_RECEIVED, network_pdu);
+}
+
+TEST(MessageTest, SegmentedAccessConcurrentDestinations){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345677);
+    mesh_sequence_number_set(0x000100);
+    test_adv_network_pdus_sent = 0;
+
+    // 6 segments to 0x0002, 2 segments to 0x0003
+    mesh_upper_transport_pdu_t * pdu_a = test_send_segmented_access_message(0x0001, 0x0002, 68);
+    mesh_upper_transport_pdu_t * pdu_b = test_send_segmented_access_message(0x0001, 0x0003, 20);
+
+    // segments are interleaved: both segments for 0x0003 have been sent after 4 network pdus
+    test_process_bearers_until_num_pdus_sent(4);
+    test_receive_segment_acknowledgement(0x0003, 0x0001, 1, pdu_b->seq, 0x03);
+    CHECK_EQUAL(0x0003, test_upper_transport_sent_dst);
+    CHECK_EQUAL(MESH_TRANSPORT_STATUS_SUCCESS, test_upper_transport_sent_status);
+
+    // remaining segments for 0x0002
+    test_process_bearers_until_num_pdus_sent(8);
+    uint32_t seq_auth_a = pdu_a->seq;
+
+    // missing segment 3 is re-sent right after the acknowledgement
+    test_receive_segment_acknowledgement(0x0002, 0x0001, 1, seq_auth_a, 0x37);
+    test_process_bearers_until_num_pdus_sent(9);
+    test_receive_segment_acknowledgement(0x0002, 0x0001, 2, seq_auth_a, 0x08);
+    CHECK_EQUAL(0x0002, test_upper_transport_sent_dst);
+    CHECK_EQUAL(MESH_TRANSPORT_STATUS_SUCCESS, test_upper_transport_sent_status);
+
+    // 8 segments + 1 retransmission, no segment transmission timeout needed
+    CHECK_EQUAL(9, test_adv_network_pdus_sent);
+}
+
+// Relay, lower transport filter and reset
+
+// receive network pdus and forward them to lower transport, then process bearers
+static void test_receive_network_pdus_and_process_bearers(int count, char ** network_pdus){
+    int i;
+    for (i=0;i<count;i++){
+        test_network_pdu_len = strlen(network_pdus[i]) / 2;
+        btstack_parse_hex(network_pdus[i], test_network_pdu_len, test_network_pdu_data);
+        mesh_network_received_message(test_network_pdu_data, test_network_pdu_len, 0);
+        while (received_network_pdu == NULL) {
+            mock_process_hci_cmd();
+        }
+        mesh_lower_transport_received_message(MESH_NETWORK_PDU_RECEIVED, received_network_pdu);
+        received_network_pdu = NULL;
+    }
+    for (i=0;i<100;i++){
+        test_process_bearers();
+    }
+}
+
+TEST(MessageTest, RelayUsesRelayRetransmit){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345677);
+    mesh_foundation_relay_set(1);
+    // send 3 times, interval 20 ms
+    mesh_foundation_relay_retransmit_set((2 << 3) | 2);
+    test_adv_network_pdus_sent = 0;
+
+    // message 22 from 0x1234 to virtual address with TTL 3 gets relayed
+    test_receive_network_pdus_and_process_bearers(1, message22_network_pdus);
+    CHECK_EQUAL(1, test_adv_network_pdus_sent);
+    CHECK_EQUAL(3, outgoing_adv_network_pdu_count);
+    CHECK_EQUAL(20, outgoing_adv_network_pdu_interval);
+}
+
+TEST(MessageTest, LowerTransportReceiveMessageForThisNode){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345678);
+    mesh_node_init();
+    mesh_node_primary_element_address_set(0x1201);
+    test_adv_network_pdus_sent = 0;
+
+    // message 6 is reassembled, acknowledged and delivered
+    test_receive_network_pdus_and_process_bearers(2, message6_network_pdus);
+    CHECK(recv_upper_transport_pdu_len > 0);
+    CHECK(test_adv_network_pdus_sent > 0);
+}
+
+TEST(MessageTest, LowerTransportIgnoreOwnMessageRelayedBack){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345678);
+    mesh_node_init();
+    mesh_node_primary_element_address_set(0x0003);
+    test_adv_network_pdus_sent = 0;
+
+    // message 6 from 0x0003 is neither reassembled nor acknowledged
+    test_receive_network_pdus_and_process_bearers(2, message6_network_pdus);
+    CHECK_EQUAL(0, recv_upper_transport_pdu_len);
+    CHECK_EQUAL(0, test_adv_network_pdus_sent);
+}
+
+TEST(MessageTest, LowerTransportIgnoreMessageForOtherNode){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345678);
+    mesh_node_init();
+    mesh_node_primary_element_address_set(0x0005);
+    test_adv_network_pdus_sent = 0;
+
+    // message 6 to 0x1201 is neither reassembled nor acknowledged
+    test_receive_network_pdus_and_process_bearers(2, message6_network_pdus);
+    CHECK_EQUAL(0, recv_upper_transport_pdu_len);
+    CHECK_EQUAL(0, test_adv_network_pdus_sent);
+}
+
+TEST(MessageTest, LowerTransportResetStopsSegmentTransmissionTimer){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345677);
+    mesh_sequence_number_set(0x000100);
+    mock_reset_timers();
+    test_adv_network_pdus_sent = 0;
+
+    // all segments sent, segment transmission timer waits for acknowledgement
+    test_send_segmented_access_message(0x0001, 0x0002, 20);
+    test_process_bearers_until_num_pdus_sent(2);
+    uint32_t timeout_ms;
+    CHECK_TRUE(mock_get_next_timeout_ms(&timeout_ms));
+
+    mesh_lower_transport_reset();
+    CHECK_FALSE(mock_get_next_timeout_ms(&timeout_ms));
+
+    // setup lower transport again for teardown
+    mesh_lower_transport_init();
+    mesh_network_set_higher_layer_handler(&test_lower_transport_callback_handler);
+}
+
+TEST(MessageTest, SegmentTransmissionTimerAdaptsToAcknowledgmentRoundTripTime){
+    load_network_key_nid_68();
+    mesh_set_iv_index(0x12345677);
+    mesh_sequence_number_set(0x000100);
+    mock_reset_timers();
+    mock_set_time_ms(0);
+    test_adv_network_pdus_sent = 0;
+
+    // TTL 3: minimum of 200 + 50 * TTL ms before any acknowledgment has been received
+    mesh_upper_transport_pdu_t * pdu = test_send_segmented_access_message(0x0001, 0x0002, 20);
+    test_process_bearers_until_num_pdus_sent(2);
+    uint32_t timeout_ms;
+    CHECK_TRUE(mock_get_next_timeout_ms(&timeout_ms));
+    CHECK_EQUAL(350, timeout_ms);
+
+    // acknowledgment received after 1000 ms
+    mock_set_time_ms(1000);
+    test_receive_segment_acknowledgement(0x0002, 0x0001, 1, pdu->seq, 0x03);
+    CHECK_EQUAL(MESH_TRANSPORT_STATUS_SUCCESS, test_upper_transport_sent_status);
+
+    // next message to same destination waits srtt + 4 * rttvar = 1000 + 4 * 500 ms
+    pdu = test_send_segmented_access_message(0x0001, 0x0002, 20);
+    test_process_bearers_until_num_pdus_sent(4);
+    CHECK_TRUE(mock_get_next_timeout_ms(&timeout_ms));
+    CHECK_EQUAL(1000 + 3000, timeout_ms);
+
+    // fast acknowledgment lowers timeout
+    mock_set_time_ms(1100);
+    test_receive_segment_acknowledgement(0x0002, 0x0001, 2, pdu->seq, 0x03);
+    CHECK_EQUAL(MESH_TRANSPORT_STATUS_SUCCESS, test_upper_transport_sent_status);
+
+    // other destinations still use the minimum
+    pdu = test_send_segmented_access_message(0x0001, 0x0003, 20);
+    test_process_bearers_until_num_pdus_sent(6);
+    CHECK_TRUE(mock_get_next_timeout_ms(&timeout_ms));
+    CHECK_EQUAL(1100 + 350, timeout_ms);
+    test_receive_segment_acknowledgement(0x0003, 0x0001, 3, pdu->seq, 0x03);
+
+    // srtt = (7 * 1000 + 100) / 8 = 887 ms, rttvar = (3 * 500 + 900) / 4 = 600 ms
+    pdu = test_send_segmented_access_message(0x0001, 0x0002, 20);
+    test_process_bearers_until_num_pdus_sent(8);
+    CHECK_TRUE(mock_get_next_timeout_ms(&timeout_ms));
+    CHECK_EQUAL(1100 + 887 + 4 * 600, timeout_ms);
+    test_receive_segment_acknowledgement(0x0002, 0x0001, 4, pdu->seq, 0x03);
+    CHECK_EQUAL(MESH_TRANSPORT_STATUS_SUCCESS, test_upper_transport_sent_status);
+}
+
 // Mesh v1.0, 8.2.1 
 static btstack_crypto_aes128_cmac_t aes_cmac_request;
 static uint8_t k4_result[1];
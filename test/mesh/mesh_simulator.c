@@ -0,0 +1,877 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#include "mesh_simulator.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btstack_crypto.h"
+#include "btstack_debug.h"
+#include "btstack_linked_list.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "mesh/adv_bearer.h"
+#include "mesh/gatt_bearer.h"
+#include "mesh/mesh_foundation.h"
+#include "mesh/mesh_iv_index_seq_number.h"
+#include "mesh/mesh_keys.h"
+#include "mesh/mesh_lower_transport.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_node.h"
+#include "mesh/mesh_peer.h"
+#include "mesh/mesh_upper_transport.h"
+#include "mock.h"
+#include "rijndael.h"
+
+#define MESH_SIMULATOR_NETWORK_CACHE_SIZE 32
+#define MESH_SIMULATOR_IV_INDEX           0x12345678u
+#define MESH_SIMULATOR_NID                0x68
+#define MESH_SIMULATOR_AID                0x26
+#define MESH_SIMULATOR_BASE_ADDRESS       0x0001
+
+// network key and application key from Mesh Profile v1.0, 8.3 Message sample data
+static const uint8_t mesh_simulator_encryption_key[] = { 0x09, 0x53, 0xfa, 0x93, 0xe7, 0xca, 0xac, 0x96, 0x38, 0xf5, 0x88, 0x20, 0x22, 0x0a, 0x39, 0x8e };
+static const uint8_t mesh_simulator_privacy_key[]    = { 0x8b, 0x84, 0xee, 0xde, 0xc1, 0x00, 0x06, 0x7d, 0x67, 0x09, 0x71, 0xdd, 0x2a, 0xa7, 0x00, 0xcf };
+static const uint8_t mesh_simulator_application_key[] = { 0x63, 0x96, 0x47, 0x71, 0x73, 0x4f, 0xbd, 0x76, 0xe3, 0xb4, 0x05, 0x19, 0xd1, 0xd9, 0x4a, 0x48 };
+
+typedef enum {
+    MESH_SIMULATOR_EVENT_SEND_MESSAGE,
+    MESH_SIMULATOR_EVENT_RECEIVE,
+    MESH_SIMULATOR_EVENT_RETRANSMIT,
+    MESH_SIMULATOR_EVENT_ADV_SENT,
+    MESH_SIMULATOR_EVENT_ACK_TIMEOUT,
+} mesh_simulator_event_type_t;
+
+typedef struct {
+    btstack_linked_item_t item;
+    uint32_t time_ms;
+    mesh_simulator_event_type_t type;
+    uint16_t node;
+    uint16_t message_index;
+    bool     relayed;
+    uint8_t  len;
+    uint8_t  data[MESH_NETWORK_PAYLOAD_MAX];
+} mesh_simulator_event_t;
+
+typedef struct {
+    uint16_t src_node;
+    uint16_t dst_node;
+    uint16_t len;
+    uint32_t time_sent_ms;
+    // seq for unsegmented, seq zero for segmented messages, set on first transmission
+    uint32_t seq;
+    bool     seq_valid;
+    bool     segmented;
+    bool     delivered;
+} mesh_simulator_message_t;
+
+typedef struct {
+    uint16_t src;
+    uint32_t seq;
+} mesh_simulator_cache_entry_t;
+
+typedef struct {
+    uint16_t address;
+    uint32_t seq;
+    // network message cache
+    mesh_simulator_cache_entry_t cache[MESH_SIMULATOR_NETWORK_CACHE_SIZE];
+    uint8_t  cache_index;
+    // incoming segmented message
+    bool     sar_active;
+    bool     sar_complete;
+    bool     sar_ack_timer_active;
+    uint16_t sar_src;
+    uint16_t sar_seq_zero;
+    uint8_t  sar_seg_n;
+    uint32_t sar_block_ack;
+} mesh_simulator_node_t;
+
+typedef struct {
+    uint8_t  ctl;
+    uint8_t  ttl;
+    uint32_t seq;
+    uint16_t src;
+    uint16_t dst;
+    uint8_t  transport_pdu[MESH_NETWORK_PAYLOAD_MAX];
+    uint8_t  transport_pdu_len;
+} mesh_simulator_network_header_t;
+
+static mesh_simulator_config_t   mesh_simulator_config;
+static mesh_simulator_stats_t    mesh_simulator_stats;
+static mesh_simulator_node_t     mesh_simulator_nodes[MESH_SIMULATOR_MAX_NODES];
+static mesh_simulator_message_t  mesh_simulator_messages[MESH_SIMULATOR_MAX_MESSAGES];
+static uint16_t                  mesh_simulator_num_messages;
+static btstack_linked_list_t     mesh_simulator_events;
+static uint32_t                  mesh_simulator_time_ms;
+static uint32_t                  mesh_simulator_random;
+
+static mesh_transport_key_t      mesh_simulator_transport_key;
+
+// node under test
+static btstack_packet_handler_t  mesh_simulator_adv_packet_handler;
+static btstack_packet_handler_t  mesh_simulator_gatt_packet_handler;
+static uint8_t                   mesh_simulator_adv_pdu_data[MESH_NETWORK_PAYLOAD_MAX];
+static uint8_t                   mesh_simulator_adv_pdu_len;
+static uint8_t                   mesh_simulator_adv_pdu_count;
+static uint16_t                  mesh_simulator_adv_pdu_interval_ms;
+static bool                      mesh_simulator_adv_busy;
+static bool                      mesh_simulator_adv_can_send_now_requested;
+
+// adv bearer of node under test
+void adv_bearer_register_for_network_pdu(btstack_packet_handler_t packet_handler){
+    mesh_simulator_adv_packet_handler = packet_handler;
+}
+
+static void mesh_simulator_emit_mesh_subevent(btstack_packet_handler_t packet_handler, uint8_t subevent){
+    uint8_t event[3];
+    event[0] = HCI_EVENT_MESH_META;
+    event[1] = 1;
+    event[2] = subevent;
+    (*packet_handler)(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
+}
+
+void adv_bearer_request_can_send_now_for_network_pdu(void){
+    if (mesh_simulator_adv_busy){
+        mesh_simulator_adv_can_send_now_requested = true;
+        return;
+    }
+    mesh_simulator_emit_mesh_subevent(mesh_simulator_adv_packet_handler, MESH_SUBEVENT_CAN_SEND_NOW);
+}
+
+// network pdu is sent in mesh_simulator_node_under_test_process, bearer is busy until all transmissions are complete
+void adv_bearer_send_network_pdu(const uint8_t * network_pdu, uint16_t size, uint8_t count, uint16_t interval){
+    btstack_assert(mesh_simulator_adv_busy == false);
+    btstack_assert(size <= sizeof(mesh_simulator_adv_pdu_data));
+    (void) memcpy(mesh_simulator_adv_pdu_data, network_pdu, size);
+    mesh_simulator_adv_pdu_len = (uint8_t) size;
+    mesh_simulator_adv_pdu_count = count;
+    mesh_simulator_adv_pdu_interval_ms = interval;
+    mesh_simulator_adv_busy = true;
+}
+
+// gatt bearer of node under test, never connected
+void gatt_bearer_register_for_network_pdu(btstack_packet_handler_t packet_handler){
+    mesh_simulator_gatt_packet_handler = packet_handler;
+}
+
+void gatt_bearer_register_for_mesh_proxy_configuration(btstack_packet_handler_t packet_handler){
+    UNUSED(packet_handler);
+}
+
+void gatt_bearer_request_can_send_now_for_network_pdu(void){
+    mesh_simulator_emit_mesh_subevent(mesh_simulator_gatt_packet_handler, MESH_SUBEVENT_CAN_SEND_NOW);
+}
+
+void gatt_bearer_send_network_pdu(const uint8_t * network_pdu, uint16_t size){
+    UNUSED(network_pdu);
+    UNUSED(size);
+    mesh_simulator_emit_mesh_subevent(mesh_simulator_gatt_packet_handler, MESH_SUBEVENT_MESSAGE_SENT);
+}
+
+// deterministic random numbers
+static uint32_t mesh_simulator_random_next(void){
+    // LCG from Numerical Recipes
+    mesh_simulator_random = mesh_simulator_random * 1664525u + 1013904223u;
+    return mesh_simulator_random >> 8;
+}
+
+static uint64_t mesh_simulator_cpu_time_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000u) + (uint64_t) ts.tv_nsec;
+}
+
+// crypto for simulated nodes, synchronous
+static void mesh_simulator_aes128(const uint8_t * key, const uint8_t * plaintext, uint8_t * cyphertext){
+    uint32_t rk[RKLENGTH(KEYBITS)];
+    int nrounds = rijndaelSetupEncrypt(rk, key, KEYBITS);
+    rijndaelEncrypt(rk, nrounds, plaintext, cyphertext);
+}
+
+// AES-CCM with 13 byte nonce and without additional data, en-/decrypts data in place
+static void mesh_simulator_ccm_crypt(const uint8_t * key, const uint8_t * nonce, uint8_t * data, uint16_t len){
+    uint8_t block[16];
+    uint8_t s[16];
+    uint16_t counter = 1;
+    uint16_t pos;
+    for (pos = 0; pos < len; pos += 16){
+        block[0] = 0x01;
+        (void) memcpy(&block[1], nonce, 13);
+        big_endian_store_16(block, 14, counter++);
+        mesh_simulator_aes128(key, block, s);
+        uint16_t i;
+        for (i = 0; (i < 16) && ((pos + i) < len); i++){
+            data[pos + i] ^= s[i];
+        }
+    }
+}
+
+static void mesh_simulator_ccm_mic(const uint8_t * key, const uint8_t * nonce, const uint8_t * plaintext, uint16_t len, uint8_t mic_len, uint8_t * mic){
+    uint8_t block[16];
+    uint8_t x[16];
+    block[0] = (uint8_t) ((((mic_len - 2) / 2) << 3) | 0x01);
+    (void) memcpy(&block[1], nonce, 13);
+    big_endian_store_16(block, 14, len);
+    mesh_simulator_aes128(key, block, x);
+    uint16_t pos;
+    for (pos = 0; pos < len; pos += 16){
+        uint16_t i;
+        for (i = 0; i < 16; i++){
+            x[i] ^= ((pos + i) < len) ? plaintext[pos + i] : 0;
+        }
+        (void) memcpy(block, x, 16);
+        mesh_simulator_aes128(key, block, x);
+    }
+    // encrypt tag with counter 0
+    block[0] = 0x01;
+    (void) memcpy(&block[1], nonce, 13);
+    big_endian_store_16(block, 14, 0);
+    uint8_t s0[16];
+    mesh_simulator_aes128(key, block, s0);
+    uint8_t i;
+    for (i = 0; i < mic_len; i++){
+        mic[i] = x[i] ^ s0[i];
+    }
+}
+
+static void mesh_simulator_network_pecb(const uint8_t * network_pdu, uint8_t * pecb){
+    uint8_t privacy_plaintext[16];
+    memset(privacy_plaintext, 0, 5);
+    big_endian_store_32(privacy_plaintext, 5, MESH_SIMULATOR_IV_INDEX);
+    (void) memcpy(&privacy_plaintext[9], &network_pdu[7], 7);
+    mesh_simulator_aes128(mesh_simulator_privacy_key, privacy_plaintext, pecb);
+}
+
+static void mesh_simulator_network_nonce(const uint8_t * network_header, uint8_t * nonce){
+    nonce[0] = 0x00;
+    (void) memcpy(&nonce[1], &network_header[1], 6);
+    big_endian_store_16(nonce, 7, 0);
+    big_endian_store_32(nonce, 9, MESH_SIMULATOR_IV_INDEX);
+}
+
+static uint8_t mesh_simulator_network_encrypt(const mesh_simulator_network_header_t * header, uint8_t * network_pdu){
+    uint8_t net_mic_len = header->ctl ? 8 : 4;
+    network_pdu[0] = (uint8_t) (((MESH_SIMULATOR_IV_INDEX & 1) << 7) | MESH_SIMULATOR_NID);
+    network_pdu[1] = (uint8_t) ((header->ctl << 7) | header->ttl);
+    big_endian_store_24(network_pdu, 2, header->seq);
+    big_endian_store_16(network_pdu, 5, header->src);
+    big_endian_store_16(network_pdu, 7, header->dst);
+    (void) memcpy(&network_pdu[9], header->transport_pdu, header->transport_pdu_len);
+    uint8_t plaintext_len = 2 + header->transport_pdu_len;
+    uint8_t nonce[13];
+    mesh_simulator_network_nonce(network_pdu, nonce);
+    mesh_simulator_ccm_mic(mesh_simulator_encryption_key, nonce, &network_pdu[7], plaintext_len, net_mic_len, &network_pdu[7 + plaintext_len]);
+    mesh_simulator_ccm_crypt(mesh_simulator_encryption_key, nonce, &network_pdu[7], plaintext_len);
+    // obfuscate ctl, ttl, seq, src
+    uint8_t pecb[16];
+    mesh_simulator_network_pecb(network_pdu, pecb);
+    uint8_t i;
+    for (i = 0; i < 6; i++){
+        network_pdu[1 + i] ^= pecb[i];
+    }
+    return 7 + plaintext_len + net_mic_len;
+}
+
+static bool mesh_simulator_network_decrypt(const uint8_t * network_pdu, uint8_t len, mesh_simulator_network_header_t * header){
+    if (len < 14) return false;
+    if ((network_pdu[0] & 0x7f) != MESH_SIMULATOR_NID) return false;
+    uint8_t data[MESH_NETWORK_PAYLOAD_MAX];
+    (void) memcpy(data, network_pdu, len);
+    uint8_t pecb[16];
+    mesh_simulator_network_pecb(data, pecb);
+    uint8_t i;
+    for (i = 0; i < 6; i++){
+        data[1 + i] ^= pecb[i];
+    }
+    header->ctl = data[1] >> 7;
+    header->ttl = data[1] & 0x7f;
+    header->seq = big_endian_read_24(data, 2);
+    header->src = big_endian_read_16(data, 5);
+    uint8_t net_mic_len = header->ctl ? 8 : 4;
+    if (len < (9 + 1 + net_mic_len)) return false;
+    uint8_t plaintext_len = len - 7 - net_mic_len;
+    uint8_t nonce[13];
+    mesh_simulator_network_nonce(data, nonce);
+    mesh_simulator_ccm_crypt(mesh_simulator_encryption_key, nonce, &data[7], plaintext_len);
+    uint8_t net_mic[8];
+    mesh_simulator_ccm_mic(mesh_simulator_encryption_key, nonce, &data[7], plaintext_len, net_mic_len, net_mic);
+    if (memcmp(net_mic, &data[7 + plaintext_len], net_mic_len) != 0) return false;
+    header->dst = big_endian_read_16(data, 7);
+    header->transport_pdu_len = plaintext_len - 2;
+    (void) memcpy(header->transport_pdu, &data[9], header->transport_pdu_len);
+    return true;
+}
+
+// topology
+static bool mesh_simulator_nodes_adjacent(uint16_t node_a, uint16_t node_b){
+    uint16_t columns = mesh_simulator_config.grid_columns;
+    int row_delta    = abs((int) (node_a / columns) - (int) (node_b / columns));
+    int column_delta = abs((int) (node_a % columns) - (int) (node_b % columns));
+    return (row_delta + column_delta) == 1;
+}
+
+uint16_t mesh_simulator_node_address(uint16_t node){
+    return MESH_SIMULATOR_BASE_ADDRESS + node;
+}
+
+static bool mesh_simulator_node_for_address(uint16_t address, uint16_t * node){
+    if (address < MESH_SIMULATOR_BASE_ADDRESS) return false;
+    uint16_t index = address - MESH_SIMULATOR_BASE_ADDRESS;
+    if (index >= mesh_simulator_config.num_nodes) return false;
+    *node = index;
+    return true;
+}
+
+// events
+static void mesh_simulator_add_event(mesh_simulator_event_t * event){
+    // keep sorted by time, events with same time are processed in order they were added
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) &mesh_simulator_events; it->next != NULL; it = it->next){
+        mesh_simulator_event_t * next = (mesh_simulator_event_t *) it->next;
+        if (next->time_ms > event->time_ms) break;
+    }
+    event->item.next = it->next;
+    it->next = (btstack_linked_item_t *) event;
+}
+
+static mesh_simulator_event_t * mesh_simulator_create_event(uint32_t time_ms, mesh_simulator_event_type_t type, uint16_t node){
+    mesh_simulator_event_t * event = (mesh_simulator_event_t *) calloc(1, sizeof(mesh_simulator_event_t));
+    btstack_assert(event != NULL);
+    event->time_ms = time_ms;
+    event->type = type;
+    event->node = node;
+    return event;
+}
+
+static uint32_t mesh_simulator_hop_delay_ms(void){
+    uint32_t delay_ms = mesh_simulator_config.latency_ms;
+    if (mesh_simulator_config.jitter_ms > 0){
+        delay_ms += mesh_simulator_random_next() % (mesh_simulator_config.jitter_ms + 1u);
+    }
+    return delay_ms;
+}
+
+static void mesh_simulator_transmit(uint16_t node, const uint8_t * network_pdu, uint8_t len, bool relayed){
+    if (relayed){
+        mesh_simulator_stats.network_pdus_relayed++;
+    } else {
+        mesh_simulator_stats.network_pdus_originated++;
+    }
+    uint16_t neighbour;
+    for (neighbour = 0; neighbour < mesh_simulator_config.num_nodes; neighbour++){
+        if (mesh_simulator_nodes_adjacent(node, neighbour) == false) continue;
+        if ((mesh_simulator_random_next() % 100u) < mesh_simulator_config.loss_percent){
+            mesh_simulator_stats.network_pdus_lost++;
+            continue;
+        }
+        mesh_simulator_event_t * event = mesh_simulator_create_event(mesh_simulator_time_ms + mesh_simulator_hop_delay_ms(),
+                                                                     MESH_SIMULATOR_EVENT_RECEIVE, neighbour);
+        (void) memcpy(event->data, network_pdu, len);
+        event->len = len;
+        mesh_simulator_add_event(event);
+    }
+}
+
+// messages
+static void mesh_simulator_message_delivered(uint16_t dst_node, uint16_t src, uint32_t seq, bool segmented){
+    uint16_t src_node;
+    if (mesh_simulator_node_for_address(src, &src_node) == false) return;
+    uint16_t i;
+    for (i = 0; i < mesh_simulator_num_messages; i++){
+        mesh_simulator_message_t * message = &mesh_simulator_messages[i];
+        if (message->delivered) continue;
+        if (message->seq_valid == false) continue;
+        if (message->src_node != src_node) continue;
+        if (message->dst_node != dst_node) continue;
+        if (message->segmented != segmented) continue;
+        if (message->seq != seq) continue;
+        message->delivered = true;
+        uint32_t latency_ms = mesh_simulator_time_ms - message->time_sent_ms;
+        if ((mesh_simulator_stats.messages_delivered == 0) || (latency_ms < mesh_simulator_stats.latency_min_ms)){
+            mesh_simulator_stats.latency_min_ms = latency_ms;
+        }
+        if (latency_ms > mesh_simulator_stats.latency_max_ms){
+            mesh_simulator_stats.latency_max_ms = latency_ms;
+        }
+        mesh_simulator_stats.latency_total_ms += latency_ms;
+        mesh_simulator_stats.messages_delivered++;
+        return;
+    }
+}
+
+// assign seq or seq zero on first transmission of a message from the node under test
+static void mesh_simulator_message_transmitted(const mesh_simulator_network_header_t * header){
+    if (header->ctl != 0) return;
+    uint16_t dst_node;
+    if (mesh_simulator_node_for_address(header->dst, &dst_node) == false) return;
+    bool segmented = (header->transport_pdu[0] & 0x80) != 0;
+    uint32_t seq = header->seq;
+    if (segmented){
+        seq = (big_endian_read_16(header->transport_pdu, 1) >> 2) & 0x1fff;
+    }
+    uint16_t i;
+    for (i = 0; i < mesh_simulator_num_messages; i++){
+        mesh_simulator_message_t * message = &mesh_simulator_messages[i];
+        if (message->src_node != 0) continue;
+        if (message->dst_node != dst_node) continue;
+        if (message->segmented != segmented) continue;
+        if (message->seq_valid){
+            // retransmission or next segment
+            if (message->seq == seq) return;
+            continue;
+        }
+        message->seq = seq;
+        message->seq_valid = true;
+        return;
+    }
+}
+
+void mesh_simulator_send_access_message(uint32_t time_ms, uint16_t src_node, uint16_t dst_node, uint16_t len){
+    btstack_assert(mesh_simulator_num_messages < MESH_SIMULATOR_MAX_MESSAGES);
+    btstack_assert(src_node < mesh_simulator_config.num_nodes);
+    btstack_assert(dst_node < mesh_simulator_config.num_nodes);
+    // simulated nodes only support unsegmented messages
+    btstack_assert((src_node == 0) || (len <= 11));
+    uint16_t message_index = mesh_simulator_num_messages++;
+    mesh_simulator_message_t * message = &mesh_simulator_messages[message_index];
+    memset(message, 0, sizeof(mesh_simulator_message_t));
+    message->src_node = src_node;
+    message->dst_node = dst_node;
+    message->len = len;
+    message->time_sent_ms = time_ms;
+    message->segmented = len > 11;
+    mesh_simulator_event_t * event = mesh_simulator_create_event(time_ms, MESH_SIMULATOR_EVENT_SEND_MESSAGE, src_node);
+    event->message_index = message_index;
+    mesh_simulator_add_event(event);
+}
+
+// simulated nodes
+static void mesh_simulator_node_cache_add(mesh_simulator_node_t * node, uint16_t src, uint32_t seq){
+    node->cache[node->cache_index].src = src;
+    node->cache[node->cache_index].seq = seq;
+    node->cache_index = (node->cache_index + 1) % MESH_SIMULATOR_NETWORK_CACHE_SIZE;
+}
+
+static bool mesh_simulator_node_cache_check_and_add(mesh_simulator_node_t * node, uint16_t src, uint32_t seq){
+    mesh_simulator_stats.cache_lookups++;
+    uint8_t i;
+    for (i = 0; i < MESH_SIMULATOR_NETWORK_CACHE_SIZE; i++){
+        if ((node->cache[i].src == src) && (node->cache[i].seq == seq)){
+            mesh_simulator_stats.cache_hits++;
+            return true;
+        }
+    }
+    mesh_simulator_node_cache_add(node, src, seq);
+    return false;
+}
+
+static void mesh_simulator_node_send(uint16_t node_index, mesh_simulator_network_header_t * header){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    header->src = node->address;
+    header->seq = node->seq++;
+    // own messages are not relayed when heard again
+    mesh_simulator_node_cache_add(node, header->src, header->seq);
+    uint8_t network_pdu[MESH_NETWORK_PAYLOAD_MAX];
+    uint8_t len = mesh_simulator_network_encrypt(header, network_pdu);
+    mesh_simulator_transmit(node_index, network_pdu, len, false);
+}
+
+static void mesh_simulator_node_send_segment_ack(uint16_t node_index){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    mesh_simulator_network_header_t header;
+    header.ctl = 1;
+    header.ttl = mesh_simulator_config.ttl;
+    header.dst = node->sar_src;
+    header.transport_pdu[0] = 0;
+    big_endian_store_16(header.transport_pdu, 1, node->sar_seq_zero << 2);
+    big_endian_store_32(header.transport_pdu, 3, node->sar_block_ack);
+    header.transport_pdu_len = 7;
+    mesh_simulator_node_send(node_index, &header);
+}
+
+static void mesh_simulator_node_send_access_message(uint16_t node_index, mesh_simulator_message_t * message){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    mesh_simulator_network_header_t header;
+    header.ctl = 0;
+    header.ttl = mesh_simulator_config.ttl;
+    header.dst = mesh_simulator_node_address(message->dst_node);
+    // upper transport: payload encrypted with application key
+    uint8_t * upper_transport_pdu = &header.transport_pdu[1];
+    uint16_t i;
+    for (i = 0; i < message->len; i++){
+        upper_transport_pdu[i] = (uint8_t) i;
+    }
+    uint8_t application_nonce[13];
+    application_nonce[0] = 0x01;
+    application_nonce[1] = 0x00;
+    big_endian_store_24(application_nonce, 2, node->seq);
+    big_endian_store_16(application_nonce, 5, node->address);
+    big_endian_store_16(application_nonce, 7, header.dst);
+    big_endian_store_32(application_nonce, 9, MESH_SIMULATOR_IV_INDEX);
+    mesh_simulator_ccm_mic(mesh_simulator_application_key, application_nonce, upper_transport_pdu, message->len, 4, &upper_transport_pdu[message->len]);
+    mesh_simulator_ccm_crypt(mesh_simulator_application_key, application_nonce, upper_transport_pdu, message->len);
+    // lower transport: unsegmented, akf = 1
+    header.transport_pdu[0] = 0x40 | MESH_SIMULATOR_AID;
+    header.transport_pdu_len = (uint8_t) (1 + message->len + 4);
+    message->seq = node->seq;
+    message->seq_valid = true;
+    mesh_simulator_node_send(node_index, &header);
+}
+
+static void mesh_simulator_node_received_segment(uint16_t node_index, const mesh_simulator_network_header_t * header){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    uint32_t segment_header = big_endian_read_24(header->transport_pdu, 1);
+    uint16_t seq_zero = (segment_header >> 10) & 0x1fff;
+    uint8_t  seg_o    = (segment_header >> 5) & 0x1f;
+    uint8_t  seg_n    =  segment_header & 0x1f;
+    if ((node->sar_active == false) || (node->sar_src != header->src) || (node->sar_seq_zero != seq_zero)){
+        node->sar_active = true;
+        node->sar_complete = false;
+        node->sar_src = header->src;
+        node->sar_seq_zero = seq_zero;
+        node->sar_seg_n = seg_n;
+        node->sar_block_ack = 0;
+    }
+    if (node->sar_complete){
+        // segment retransmitted, previous ack probably lost
+        mesh_simulator_node_send_segment_ack(node_index);
+        return;
+    }
+    node->sar_block_ack |= 1u << seg_o;
+    uint32_t block_ack_complete = (node->sar_seg_n == 31) ? 0xffffffffu : ((1u << (node->sar_seg_n + 1)) - 1);
+    if (node->sar_block_ack == block_ack_complete){
+        node->sar_complete = true;
+        mesh_simulator_message_delivered(node_index, header->src, seq_zero, true);
+        mesh_simulator_node_send_segment_ack(node_index);
+        return;
+    }
+    if (node->sar_ack_timer_active) return;
+    // acknowledgment timer: 150 + 50 * TTL ms
+    node->sar_ack_timer_active = true;
+    mesh_simulator_add_event(mesh_simulator_create_event(mesh_simulator_time_ms + 150 + (50 * header->ttl),
+                                                         MESH_SIMULATOR_EVENT_ACK_TIMEOUT, node_index));
+}
+
+static void mesh_simulator_node_ack_timeout(uint16_t node_index){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    node->sar_ack_timer_active = false;
+    if (node->sar_active && !node->sar_complete){
+        mesh_simulator_node_send_segment_ack(node_index);
+    }
+}
+
+static void mesh_simulator_node_receive(uint16_t node_index, const uint8_t * network_pdu, uint8_t len){
+    mesh_simulator_node_t * node = &mesh_simulator_nodes[node_index];
+    mesh_simulator_network_header_t header;
+    if (mesh_simulator_network_decrypt(network_pdu, len, &header) == false) return;
+    if (mesh_simulator_node_cache_check_and_add(node, header.src, header.seq)) return;
+
+    if ((header.dst == node->address) || (header.dst == MESH_ADDRESS_ALL_NODES)){
+        if ((header.ctl == 0) && ((header.transport_pdu[0] & 0x80) == 0)){
+            mesh_simulator_message_delivered(node_index, header.src, header.seq, false);
+        }
+        if ((header.ctl == 0) && ((header.transport_pdu[0] & 0x80) != 0)){
+            mesh_simulator_node_received_segment(node_index, &header);
+        }
+        if (header.dst == node->address) return;
+    }
+
+    if (mesh_simulator_config.relay == false) return;
+    if (header.ttl < 2) return;
+    header.ttl--;
+    uint8_t relay_pdu[MESH_NETWORK_PAYLOAD_MAX];
+    uint8_t relay_len = mesh_simulator_network_encrypt(&header, relay_pdu);
+    mesh_simulator_transmit(node_index, relay_pdu, relay_len, true);
+}
+
+// node under test
+static void mesh_simulator_node_under_test_access_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
+    UNUSED(status);
+    if (callback_type == MESH_TRANSPORT_PDU_SENT){
+        mesh_upper_transport_pdu_free(pdu);
+        return;
+    }
+    if (pdu->pdu_type == MESH_PDU_TYPE_ACCESS){
+        mesh_access_pdu_t * access_pdu = (mesh_access_pdu_t *) pdu;
+        mesh_simulator_message_delivered(0, access_pdu->src, access_pdu->seq, false);
+    }
+    mesh_upper_transport_message_processed_by_higher_layer(pdu);
+}
+
+static void mesh_simulator_node_under_test_control_handler(mesh_transport_callback_type_t callback_type, mesh_transport_status_t status, mesh_pdu_t * pdu){
+    UNUSED(status);
+    if (callback_type == MESH_TRANSPORT_PDU_SENT) return;
+    mesh_upper_transport_message_processed_by_higher_layer(pdu);
+}
+
+static void mesh_simulator_node_under_test_send_access_message(const mesh_simulator_message_t * message){
+    uint8_t payload[MESH_ACCESS_PAYLOAD_MAX];
+    uint16_t i;
+    for (i = 0; i < message->len; i++){
+        payload[i] = (uint8_t) i;
+    }
+    mesh_upper_transport_builder_t builder;
+    mesh_upper_transport_message_init(&builder, message->segmented ? MESH_PDU_TYPE_UPPER_SEGMENTED_ACCESS : MESH_PDU_TYPE_UPPER_UNSEGMENTED_ACCESS);
+    mesh_upper_transport_message_add_data(&builder, payload, message->len);
+    mesh_pdu_t * pdu = (mesh_pdu_t *) mesh_upper_transport_message_finalize(&builder);
+    btstack_assert(pdu != NULL);
+    mesh_upper_transport_setup_access_pdu_header(pdu, 0, 0, mesh_simulator_config.ttl, mesh_simulator_node_address(0),
+                                                 mesh_simulator_node_address(message->dst_node), 0);
+    mesh_upper_transport_send_access_pdu(pdu);
+}
+
+// process crypto and outgoing network pdus of node under test
+static void mesh_simulator_node_under_test_process(void){
+    while (true){
+        if (mock_process_hci_cmd() != 0) continue;
+        if (mesh_simulator_adv_pdu_len > 0){
+            mesh_simulator_network_header_t header;
+            bool valid = mesh_simulator_network_decrypt(mesh_simulator_adv_pdu_data, mesh_simulator_adv_pdu_len, &header);
+            btstack_assert(valid);
+            bool relayed = header.src != mesh_simulator_node_address(0);
+            if (relayed == false){
+                mesh_simulator_message_transmitted(&header);
+            }
+            mesh_simulator_transmit(0, mesh_simulator_adv_pdu_data, mesh_simulator_adv_pdu_len, relayed);
+            uint32_t transmission_time_ms = mesh_simulator_time_ms;
+            uint8_t i;
+            for (i = 1; i < mesh_simulator_adv_pdu_count; i++){
+                transmission_time_ms += mesh_simulator_adv_pdu_interval_ms;
+                mesh_simulator_event_t * event = mesh_simulator_create_event(transmission_time_ms, MESH_SIMULATOR_EVENT_RETRANSMIT, 0);
+                (void) memcpy(event->data, mesh_simulator_adv_pdu_data, mesh_simulator_adv_pdu_len);
+                event->len = mesh_simulator_adv_pdu_len;
+                event->relayed = relayed;
+                mesh_simulator_add_event(event);
+            }
+            mesh_simulator_adv_pdu_len = 0;
+            mesh_simulator_add_event(mesh_simulator_create_event(transmission_time_ms + mesh_simulator_config.latency_ms,
+                                                                 MESH_SIMULATOR_EVENT_ADV_SENT, 0));
+            continue;
+        }
+        break;
+    }
+}
+
+static void mesh_simulator_process_event(mesh_simulator_event_t * event){
+    uint64_t cpu_start_ns = mesh_simulator_cpu_time_ns();
+    bool node_under_test = event->node == 0;
+    switch (event->type){
+        case MESH_SIMULATOR_EVENT_SEND_MESSAGE:
+            mesh_simulator_stats.messages_sent++;
+            if (node_under_test){
+                mesh_simulator_node_under_test_send_access_message(&mesh_simulator_messages[event->message_index]);
+            } else {
+                mesh_simulator_node_send_access_message(event->node, &mesh_simulator_messages[event->message_index]);
+            }
+            break;
+        case MESH_SIMULATOR_EVENT_RECEIVE:
+            if (node_under_test){
+                mesh_simulator_stats.node_under_test_network_pdus_received++;
+                mesh_network_received_message(event->data, event->len, 0);
+            } else {
+                mesh_simulator_node_receive(event->node, event->data, event->len);
+            }
+            break;
+        case MESH_SIMULATOR_EVENT_RETRANSMIT:
+            mesh_simulator_transmit(event->node, event->data, event->len, event->relayed);
+            break;
+        case MESH_SIMULATOR_EVENT_ADV_SENT:
+            mesh_simulator_adv_busy = false;
+            if (mesh_simulator_adv_can_send_now_requested){
+                mesh_simulator_adv_can_send_now_requested = false;
+                mesh_simulator_emit_mesh_subevent(mesh_simulator_adv_packet_handler, MESH_SUBEVENT_CAN_SEND_NOW);
+            }
+            break;
+        case MESH_SIMULATOR_EVENT_ACK_TIMEOUT:
+            mesh_simulator_node_ack_timeout(event->node);
+            break;
+        default:
+            btstack_assert(false);
+            break;
+    }
+    if (node_under_test){
+        mesh_simulator_node_under_test_process();
+        mesh_simulator_stats.node_under_test_cpu_ns += mesh_simulator_cpu_time_ns() - cpu_start_ns;
+    }
+}
+
+void mesh_simulator_init(const mesh_simulator_config_t * config){
+    btstack_assert(config->num_nodes <= MESH_SIMULATOR_MAX_NODES);
+    btstack_assert(config->grid_columns > 0);
+    mesh_simulator_config = *config;
+    memset(&mesh_simulator_stats, 0, sizeof(mesh_simulator_stats));
+    memset(mesh_simulator_nodes, 0, sizeof(mesh_simulator_nodes));
+    uint16_t i;
+    for (i = 0; i < config->num_nodes; i++){
+        mesh_simulator_nodes[i].address = mesh_simulator_node_address(i);
+        // seq 0 would be rejected by replay protection of the node under test
+        mesh_simulator_nodes[i].seq = 1;
+    }
+    mesh_simulator_num_messages = 0;
+    mesh_simulator_random = config->seed;
+    mesh_simulator_time_ms = 0;
+    while (!btstack_linked_list_empty(&mesh_simulator_events)){
+        free(btstack_linked_list_pop(&mesh_simulator_events));
+    }
+
+    // node under test
+    mesh_simulator_adv_pdu_len = 0;
+    mesh_simulator_adv_busy = false;
+    mesh_simulator_adv_can_send_now_requested = false;
+    mock_reset_timers();
+    mock_set_time_ms(0);
+    btstack_memory_init();
+    btstack_crypto_init();
+    mesh_network_init();
+    mesh_network_cache_reset();
+    mesh_lower_transport_init();
+    mesh_upper_transport_init();
+    mesh_network_key_init();
+    mesh_seq_auth_reset();
+    mesh_upper_transport_register_access_message_handler(&mesh_simulator_node_under_test_access_handler);
+    mesh_upper_transport_register_control_message_handler(&mesh_simulator_node_under_test_control_handler);
+
+    mesh_node_init();
+    mesh_node_primary_element_address_set(mesh_simulator_node_address(0));
+    mesh_set_iv_index(MESH_SIMULATOR_IV_INDEX);
+    mesh_sequence_number_set(0);
+    mesh_foundation_relay_set(config->relay_node_under_test ? 1 : 0);
+    mesh_foundation_gatt_proxy_set(0);
+    mesh_foundation_default_ttl_set(config->ttl);
+    mesh_foundation_network_transmit_set(config->network_transmit);
+    mesh_foundation_relay_retransmit_set(config->network_transmit);
+
+    mesh_network_key_t * network_key = btstack_memory_mesh_network_key_get();
+    network_key->nid = MESH_SIMULATOR_NID;
+    (void) memcpy(network_key->encryption_key, mesh_simulator_encryption_key, 16);
+    (void) memcpy(network_key->privacy_key, mesh_simulator_privacy_key, 16);
+    mesh_network_key_add(network_key);
+    mesh_subnet_setup_for_netkey_index(network_key->netkey_index);
+
+    mesh_simulator_transport_key.netkey_index = 0;
+    mesh_simulator_transport_key.appkey_index = 0;
+    mesh_simulator_transport_key.aid = MESH_SIMULATOR_AID;
+    mesh_simulator_transport_key.akf = 1;
+    (void) memcpy(mesh_simulator_transport_key.key, mesh_simulator_application_key, 16);
+    mesh_transport_key_add(&mesh_simulator_transport_key);
+}
+
+void mesh_simulator_run(uint32_t max_time_ms){
+    int stdout_fd = -1;
+    if (mesh_simulator_config.quiet){
+        fflush(stdout);
+        stdout_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    while (true){
+        mesh_simulator_event_t * event = (mesh_simulator_event_t *) btstack_linked_list_get_first_item(&mesh_simulator_events);
+        uint32_t timer_timeout_ms;
+        bool timer_pending = mock_get_next_timeout_ms(&timer_timeout_ms);
+        if (timer_pending && (timer_timeout_ms < mesh_simulator_time_ms)){
+            timer_timeout_ms = mesh_simulator_time_ms;
+        }
+        if ((event == NULL) && (timer_pending == false)) break;
+
+        // timers of node under test fire before events at same time
+        if (timer_pending && ((event == NULL) || (timer_timeout_ms <= event->time_ms))){
+            if (timer_timeout_ms > max_time_ms) break;
+            mesh_simulator_time_ms = timer_timeout_ms;
+            mock_set_time_ms(mesh_simulator_time_ms);
+            uint64_t cpu_start_ns = mesh_simulator_cpu_time_ns();
+            (void) mock_process_timers();
+            mesh_simulator_node_under_test_process();
+            mesh_simulator_stats.node_under_test_cpu_ns += mesh_simulator_cpu_time_ns() - cpu_start_ns;
+            continue;
+        }
+
+        if (event->time_ms > max_time_ms) break;
+        mesh_simulator_time_ms = event->time_ms;
+        mock_set_time_ms(mesh_simulator_time_ms);
+        btstack_linked_list_remove(&mesh_simulator_events, (btstack_linked_item_t *) event);
+        mesh_simulator_process_event(event);
+        free(event);
+    }
+    mesh_simulator_stats.time_ms = mesh_simulator_time_ms;
+
+    if (stdout_fd >= 0){
+        fflush(stdout);
+        dup2(stdout_fd, STDOUT_FILENO);
+        close(stdout_fd);
+    }
+}
+
+const mesh_simulator_stats_t * mesh_simulator_get_stats(void){
+    return &mesh_simulator_stats;
+}
+
+void mesh_simulator_dump_stats(const char * name){
+    const mesh_simulator_stats_t * stats = &mesh_simulator_stats;
+    uint32_t network_pdus = stats->network_pdus_originated + stats->network_pdus_relayed;
+    printf("%s: %u nodes, %u%% loss, %u ms latency\n", name, mesh_simulator_config.num_nodes,
+           mesh_simulator_config.loss_percent, mesh_simulator_config.latency_ms);
+    printf("- simulator-only, depends on model of simulated nodes:\n");
+    printf("  - messages:            %" PRIu32 " sent, %" PRIu32 " delivered\n", stats->messages_sent, stats->messages_delivered);
+    if (stats->messages_delivered > 0){
+        printf("  - end-to-end latency:  %" PRIu32 " ms avg, %" PRIu32 " ms min, %" PRIu32 " ms max\n",
+               stats->latency_total_ms / stats->messages_delivered, stats->latency_min_ms, stats->latency_max_ms);
+    }
+    if (stats->network_pdus_originated > 0){
+        printf("  - relay amplification: %" PRIu32 " network pdus on air for %" PRIu32 " originated (x%.2f), %" PRIu32 " receptions lost\n",
+               network_pdus, stats->network_pdus_originated, (double) network_pdus / (double) stats->network_pdus_originated,
+               stats->network_pdus_lost);
+    }
+    if (stats->cache_lookups > 0){
+        printf("  - cache hit rate:      %.1f%% of %" PRIu32 " lookups by simulated nodes\n",
+               100.0 * (double) stats->cache_hits / (double) stats->cache_lookups, stats->cache_lookups);
+    }
+    if (stats->messages_sent > 0){
+        printf("- measured on mesh stack of node under test:\n");
+        printf("  - %" PRIu32 " network pdus received, %.1f us cpu per message\n",
+               stats->node_under_test_network_pdus_received,
+               (double) stats->node_under_test_cpu_ns / 1000.0 / (double) stats->messages_sent);
+    }
+    printf("- simulated time:      %" PRIu32 " ms\n", stats->time_ms);
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ * mesh_simulator.h
+ *
+ * Deterministic, in-process simulation of a mesh network for benchmarks.
+ *
+ * Node 0 is the node under test and runs the BTstack mesh stack from mesh_network up to the access layer
+ * callbacks of mesh_upper_transport. All other nodes are simulated: they decrypt, cache and relay
+ * network PDUs, originate unsegmented access messages and acknowledge segmented messages.
+ *
+ * Nodes are placed row by row on a grid and can hear their horizontal and vertical neighbours.
+ * Simulated time only advances between events, timers of the node under test are run by the mock.
+ *
+ * Only the node under test runs BTstack code, the simulator does not measure the relay behaviour of BTstack.
+ * End-to-end latency, relay amplification and cache hit rate depend on the model of the simulated nodes,
+ * e.g. their network message cache and relay behaviour, and are simulator-only numbers. Only the network pdus
+ * received by and the cpu time of the node under test are measured on the mesh stack. See README.md.
+ */
+
+#ifndef MESH_SIMULATOR_H
+#define MESH_SIMULATOR_H
+
+#include <stdint.h>
+
+#include "btstack_bool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define MESH_SIMULATOR_MAX_NODES    64
+#define MESH_SIMULATOR_MAX_MESSAGES 256
+
+typedef struct {
+    // number of nodes, including node under test
+    uint16_t num_nodes;
+    // nodes per row, use num_nodes for a line
+    uint16_t grid_columns;
+    // probability that a neighbour misses a transmission
+    uint8_t  loss_percent;
+    // delay from start of transmission until reception
+    uint16_t latency_ms;
+    // additional random delay per hop in range [0..jitter_ms]
+    uint16_t jitter_ms;
+    // simulated nodes relay network pdus
+    bool     relay;
+    // node under test relays network pdus
+    bool     relay_node_under_test;
+    // ttl for originated messages
+    uint8_t  ttl;
+    // network transmit and relay retransmit state of node under test, simulated nodes send each network pdu once
+    uint8_t  network_transmit;
+    // seed for loss and jitter
+    uint32_t seed;
+    // suppress stdout of the mesh stack while running
+    bool     quiet;
+} mesh_simulator_config_t;
+
+typedef struct {
+    // simulator-only, depend on the model of the simulated nodes
+    uint32_t messages_sent;
+    uint32_t messages_delivered;
+    uint32_t latency_min_ms;
+    uint32_t latency_max_ms;
+    uint32_t latency_total_ms;
+    // network pdus put on air by originating nodes, incl. segments, retransmissions and acks
+    uint32_t network_pdus_originated;
+    // network pdus put on air by relays
+    uint32_t network_pdus_relayed;
+    // receptions dropped by the simulated channel
+    uint32_t network_pdus_lost;
+    // network message cache of the simulated nodes
+    uint32_t cache_lookups;
+    uint32_t cache_hits;
+    // measured on the mesh stack: network pdus received by the node under test
+    uint32_t node_under_test_network_pdus_received;
+    // cpu time spent in the mesh stack of the node under test
+    uint64_t node_under_test_cpu_ns;
+    // simulated time of last event
+    uint32_t time_ms;
+} mesh_simulator_stats_t;
+
+/**
+ * @brief Setup network and node under test, reset stats
+ * @param config
+ */
+void mesh_simulator_init(const mesh_simulator_config_t * config);
+
+/**
+ * @brief Get unicast address of node
+ * @param node
+ * @return address
+ */
+uint16_t mesh_simulator_node_address(uint16_t node);
+
+/**
+ * @brief Queue access message. Messages from the node under test with more than 11 bytes are segmented,
+ *        simulated nodes only send unsegmented messages
+ * @param time_ms when message is sent
+ * @param src_node
+ * @param dst_node
+ * @param len of access payload
+ */
+void mesh_simulator_send_access_message(uint32_t time_ms, uint16_t src_node, uint16_t dst_node, uint16_t len);
+
+/**
+ * @brief Run simulation until there are no more events or timers
+ * @param max_time_ms stop after this time
+ */
+void mesh_simulator_run(uint32_t max_time_ms);
+
+/**
+ * @brief Get stats for current simulation
+ * @return stats
+ */
+const mesh_simulator_stats_t * mesh_simulator_get_stats(void);
+
+/**
+ * @brief Print end-to-end latency, relay amplification and cache hit rate of the simulation and
+ *        cpu time per message of the node under test
+ * @param name of scenario
+ */
+void mesh_simulator_dump_stats(const char * name);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif // MESH_SIMULATOR_H
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_debug.h"
+#include "mesh/mesh_access.h"
+#include "mesh/mesh_network.h"
+#include "mesh/mesh_upper_transport.h"
+#include "mesh_simulator.h"
+#include "mock.h"
+
+// copy from mesh_message.c for now
+uint16_t mesh_pdu_dst(mesh_pdu_t * pdu){
+    switch (pdu->pdu_type){
+        case MESH_PDU_TYPE_UNSEGMENTED:
+        case MESH_PDU_TYPE_NETWORK:
+        case MESH_PDU_TYPE_UPPER_UNSEGMENTED_CONTROL:
+            return mesh_network_dst((mesh_network_pdu_t *) pdu);
+        case MESH_PDU_TYPE_ACCESS: {
+            return ((mesh_access_pdu_t *) pdu)->dst;
+        }
+        case MESH_PDU_TYPE_UPPER_SEGMENTED_ACCESS:
+        case MESH_PDU_TYPE_UPPER_UNSEGMENTED_ACCESS:
+            return ((mesh_upper_transport_pdu_t *) pdu)->dst;
+        default:
+            btstack_assert(false);
+            return MESH_ADDRESS_UNSASSIGNED;
+    }
+}
+uint16_t mesh_pdu_ctl(mesh_pdu_t * pdu){
+    switch (pdu->pdu_type){
+        case MESH_PDU_TYPE_NETWORK:
+        case MESH_PDU_TYPE_UPPER_UNSEGMENTED_CONTROL:
+            return mesh_network_control((mesh_network_pdu_t *) pdu);
+        case MESH_PDU_TYPE_ACCESS: {
+            return ((mesh_access_pdu_t *) pdu)->ctl_ttl >> 7;
+        }
+        default:
+            btstack_assert(false);
+            return 0;
+    }
+}
+
+static mesh_simulator_config_t test_config(uint16_t num_nodes, uint16_t grid_columns, uint8_t loss_percent, uint16_t jitter_ms){
+    mesh_simulator_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.num_nodes = num_nodes;
+    config.grid_columns = grid_columns;
+    config.loss_percent = loss_percent;
+    config.latency_ms = 10;
+    config.jitter_ms = jitter_ms;
+    config.relay = true;
+    config.relay_node_under_test = true;
+    config.ttl = 7;
+    // single transmission
+    config.network_transmit = 0;
+    config.seed = 0x12345678;
+    config.quiet = true;
+    return config;
+}
+
+static void test_run_grid_segmented(uint8_t loss_percent){
+    mesh_simulator_config_t config = test_config(25, 5, loss_percent, 5);
+    // 8 hops to opposite corner
+    config.ttl = 10;
+    mesh_simulator_init(&config);
+    int i;
+    for (i=0;i<10;i++){
+        mesh_simulator_send_access_message(i * 2000, 0, 24, 40);
+    }
+    mesh_simulator_run(60000);
+}
+
+TEST_GROUP(MeshSimulator){
+    void setup(void){
+        mock_init();
+    }
+};
+
+TEST(MeshSimulator, LineUnsegmented){
+    mesh_simulator_config_t config = test_config(8, 8, 0, 0);
+    mesh_simulator_init(&config);
+    int i;
+    for (i=0;i<10;i++){
+        mesh_simulator_send_access_message(i * 100, 0, 7, 8);
+    }
+    mesh_simulator_run(10000);
+    mesh_simulator_dump_stats("Line, unsegmented");
+    const mesh_simulator_stats_t * stats = mesh_simulator_get_stats();
+    CHECK_EQUAL(10, stats->messages_delivered);
+    // 7 hops
+    CHECK_EQUAL(70, stats->latency_min_ms);
+    CHECK_EQUAL(70, stats->latency_max_ms);
+    // each node sends each message once
+    CHECK_EQUAL(10, stats->network_pdus_originated);
+    CHECK_EQUAL(60, stats->network_pdus_relayed);
+}
+
+TEST(MeshSimulator, GridSegmented){
+    test_run_grid_segmented(0);
+    mesh_simulator_dump_stats("Grid, segmented");
+    const mesh_simulator_stats_t * stats = mesh_simulator_get_stats();
+    CHECK_EQUAL(10, stats->messages_delivered);
+}
+
+TEST(MeshSimulator, GridSegmentedWithLoss){
+    test_run_grid_segmented(20);
+    mesh_simulator_dump_stats("Grid, segmented, with loss");
+    const mesh_simulator_stats_t * stats = mesh_simulator_get_stats();
+    CHECK_EQUAL(10, stats->messages_delivered);
+    CHECK(stats->network_pdus_lost > 0);
+}
+
+TEST(MeshSimulator, GridToNodeUnderTest){
+    mesh_simulator_config_t config = test_config(9, 3, 10, 5);
+    mesh_simulator_init(&config);
+    int i;
+    for (i=0;i<20;i++){
+        // node under test tracks up to 5 peers
+        mesh_simulator_send_access_message(i * 100, 5 + (i % 4), 0, 11);
+    }
+    mesh_simulator_run(10000);
+    mesh_simulator_dump_stats("Grid, to node under test");
+    const mesh_simulator_stats_t * stats = mesh_simulator_get_stats();
+    CHECK_EQUAL(20, stats->messages_delivered);
+}
+
+TEST(MeshSimulator, Deterministic){
+    test_run_grid_segmented(20);
+    mesh_simulator_stats_t first_run = *mesh_simulator_get_stats();
+    test_run_grid_segmented(20);
+    const mesh_simulator_stats_t * second_run = mesh_simulator_get_stats();
+    CHECK_EQUAL(first_run.messages_delivered, second_run->messages_delivered);
+    CHECK_EQUAL(first_run.latency_total_ms, second_run->latency_total_ms);
+    CHECK_EQUAL(first_run.network_pdus_originated, second_run->network_pdus_originated);
+    CHECK_EQUAL(first_run.network_pdus_relayed, second_run->network_pdus_relayed);
+    CHECK_EQUAL(first_run.network_pdus_lost, second_run->network_pdus_lost);
+    CHECK_EQUAL(first_run.cache_hits, second_run->cache_hits);
+    CHECK_EQUAL(first_run.time_ms, second_run->time_ms);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
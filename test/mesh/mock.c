@@ -161,29 +161,63 @@ HCI_STATE hci_get_state(void){
 	return HCI_STATE_WORKING;
 }
 
+// timers are only fired by mock_process_timers, time only advances via mock_set_time_ms
+static btstack_linked_list_t timers;
+static uint32_t time_ms;
+
+void mock_set_time_ms(uint32_t now_ms){
+    time_ms = now_ms;
+}
+
+uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+
+bool mock_get_next_timeout_ms(uint32_t * timeout_ms){
+    btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_linked_list_get_first_item(&timers);
+    if (ts == NULL) return false;
+    *timeout_ms = ts->timeout;
+    return true;
+}
+
+int mock_process_timers(void){
+    btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_linked_list_get_first_item(&timers);
+    if (ts == NULL) return 0;
+    if ((int32_t) (ts->timeout - time_ms) > 0) return 0;
+    btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+    ts->process(ts);
+    return 1;
+}
+
+void mock_reset_timers(void){
+    timers = NULL;
+}
+
 void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
-    UNUSED(ts);
+    // keep sorted by timeout, timers with same timeout fire in the order they were added
+    btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) &timers; it->next != NULL ; it = it->next){
+        btstack_timer_source_t * next = (btstack_timer_source_t *) it->next;
+        if ((int32_t) (next->timeout - ts->timeout) > 0) break;
+    }
+    ts->item.next = it->next;
+    it->next = (btstack_linked_item_t *) ts;
 }
 int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
-    UNUSED(ts);
-	return 0;
+	return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts) ? 1 : 0;
 }
 void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout){
-    UNUSED(ts);
-    UNUSED(timeout);
+    ts->timeout = time_ms + timeout;
 }
 void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*fn)(btstack_timer_source_t * ts)){
-    UNUSED(ts);
-    UNUSED(fn);
+    ts->process = fn;
 }
-static void * timer_context;
 void btstack_run_loop_set_timer_context(btstack_timer_source_t * ts, void * context){
-    UNUSED(ts);
-	timer_context = context;
+	ts->context = context;
 }
 void * btstack_run_loop_get_timer_context(btstack_timer_source_t * ts){
-    UNUSED(ts);
-	return timer_context;
+	return ts->context;
 }
 void hci_halting_defer(void){
 }
@@ -45,6 +45,8 @@ extern "C"
 
 #include <stdint.h>
 
+#include "btstack_bool.h"
+
 void mock_init(void);
 uint8_t * mock_packet_buffer(void);
 void mock_clear_packet_buffer(void);
@@ -52,6 +54,12 @@ void mock_simulate_hci_event(uint8_t * packet, uint16_t size);
 int mock_process_hci_cmd(void);
 void mock_simulate_hci_state_working(void);
 
+// timers
+void mock_set_time_ms(uint32_t now_ms);
+bool mock_get_next_timeout_ms(uint32_t * timeout_ms);
+int  mock_process_timers(void);
+void mock_reset_timers(void);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
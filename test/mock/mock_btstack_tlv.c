@@ -90,6 +90,8 @@ static int mock_btstack_tlv_get_tag(void * context, uint32_t tag, uint8_t * buff
 static int mock_btstack_tlv_store_tag(void * context, uint32_t tag, const uint8_t * data, uint32_t data_size){
     mock_btstack_tlv_t * self = (mock_btstack_tlv_t *) context;
 
+    self->num_store_tag++;
+
     // enforce arbitrary max value size
     btstack_assert(data_size <= MAX_TLV_VALUE_SIZE);
 
@@ -120,6 +122,7 @@ static int mock_btstack_tlv_store_tag(void * context, uint32_t tag, const uint8_
  */
 static void mock_btstack_tlv_delete_tag(void * context, uint32_t tag){
     mock_btstack_tlv_t * self = (mock_btstack_tlv_t *) context;
+    self->num_delete_tag++;
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &self->entry_list);
     while (btstack_linked_list_iterator_has_next(&it)){
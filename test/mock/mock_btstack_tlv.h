@@ -49,6 +49,9 @@ extern "C" {
 /* API_START */
 typedef struct {
     btstack_linked_list_t entry_list;
+    // number of store and delete operations, i.e. flash writes
+    uint32_t num_store_tag;
+    uint32_t num_delete_tag;
 } mock_btstack_tlv_t;
 
 /**
@@ -18,7 +18,8 @@ static enum {
     MOCK_QUERY_DISCOVER_CHARACTERISTIC_DESCRIPTORS,
     MOCK_WRITE_CLIENT_CHARACTERISTIC_CONFIGURATION,
     MOCK_READ_VALUE_OF_CHARACTERISTIC_USING_VALUE_HANDLE,
-    MOCK_READ_VALUE_OF_CHARACTERISTIC_DESCRIPTOR_USING_VALUE_HANDLE
+    MOCK_READ_VALUE_OF_CHARACTERISTIC_DESCRIPTOR_USING_VALUE_HANDLE,
+    MOCK_READ_VALUE_OF_CHARACTERISTIC_COALESCED
 } mock_gatt_client_state;
 
 static uint16_t mock_gatt_client_att_handle_generator;
@@ -28,10 +29,13 @@ static uint8_t  mock_gatt_client_uuid128[16];
 static uint16_t mock_gatt_client_value_handle;
 static uint16_t mock_gatt_client_start_handle;
 static uint16_t mock_gatt_client_end_handle;
+static uint16_t mock_gatt_client_mtu;
+static uint16_t mock_gatt_client_num_coalesced_reads;
 
 static gatt_client_t gatt_client;
 
 static btstack_linked_list_t mock_gatt_client_services;
+static btstack_linked_list_t mock_gatt_client_coalesced_reads;
 
 static mock_gatt_client_service_t * mock_gatt_client_last_service;
 static mock_gatt_client_characteristic_t * mock_gatt_client_last_characteristic;
@@ -410,11 +414,12 @@ uint8_t gatt_client_read_value_of_characteristics_by_uuid16(btstack_packet_handl
     mock_gatt_client_state = MOCK_READ_VALUE_OF_CHARACTERISTIC_USING_VALUE_HANDLE;
     
     mock_gatt_client_characteristic_t * mock_characteristic = mock_gatt_client_get_characteristic_for_uuid16(uuid16);
+    mock_gatt_client_value_handle = 0;
     if (mock_characteristic != NULL){
         mock_gatt_client_value_handle = mock_characteristic->value_handle;
-        gatt_client.callback = callback;
-        gatt_client.con_handle = con_handle;
     }
+    gatt_client.callback = callback;
+    gatt_client.con_handle = con_handle;
     return ERROR_CODE_SUCCESS;
 }
 
@@ -449,6 +454,25 @@ uint8_t gatt_client_read_characteristic_descriptor_using_descriptor_handle(btsta
     return ERROR_CODE_SUCCESS;
 }
 
+uint8_t gatt_client_read_value_of_characteristic_coalesced(gatt_client_coalesced_read_t * read, btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle){
+    btstack_assert(read != NULL);
+    mock_gatt_client_state = MOCK_READ_VALUE_OF_CHARACTERISTIC_COALESCED;
+
+    read->callback = callback;
+    read->value_handle = value_handle;
+    read->single = false;
+    btstack_linked_list_add_tail(&mock_gatt_client_coalesced_reads, (btstack_linked_item_t *) read);
+    mock_gatt_client_num_coalesced_reads++;
+    gatt_client.con_handle = con_handle;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t gatt_client_get_mtu(hci_con_handle_t con_handle, uint16_t * mtu){
+    UNUSED(con_handle);
+    *mtu = mock_gatt_client_mtu;
+    return ERROR_CODE_SUCCESS;
+}
+
 void gatt_client_stop_listening_for_characteristic_value_updates(gatt_client_notification_t * notification){
 }
 
@@ -579,6 +603,28 @@ void mock_gatt_client_run_once(void){
             mock_gatt_client_emit_complete(ERROR_CODE_SUCCESS);
             break;
         
+        case MOCK_READ_VALUE_OF_CHARACTERISTIC_COALESCED:
+            // all reads queued so far are answered by a single request, reads queued from callbacks follow in next run
+            mock_gatt_client_state = MOCK_QUERY_IDLE;
+            {
+                btstack_linked_list_t reads = mock_gatt_client_coalesced_reads;
+                mock_gatt_client_coalesced_reads = NULL;
+                while (reads != NULL){
+                    gatt_client_coalesced_read_t * read = (gatt_client_coalesced_read_t *) btstack_linked_list_pop(&reads);
+                    gatt_client.callback = read->callback;
+                    if (moc_att_error_code_read_value_characteristics != ATT_ERROR_SUCCESS){
+                        emit_gatt_complete_event(&gatt_client, moc_att_error_code_read_value_characteristics);
+                        continue;
+                    }
+                    characteristic = mock_gatt_client_get_characteristic_for_value_handle(read->value_handle);
+                    if (characteristic != NULL){
+                        mock_gatt_client_send_characteristic_value(&gatt_client, characteristic);
+                    }
+                    emit_gatt_complete_event(&gatt_client, ATT_ERROR_SUCCESS);
+                }
+            }
+            break;
+
         default:
             btstack_assert(false);
             break;
@@ -614,6 +660,9 @@ void mock_gatt_client_reset(void){
     mock_gatt_client_state = MOCK_QUERY_IDLE;
     mock_gatt_client_att_handle_generator = 0;
     mock_gatt_client_last_service = NULL;
+    mock_gatt_client_coalesced_reads = NULL;
+    mock_gatt_client_num_coalesced_reads = 0;
+    mock_gatt_client_mtu = ATT_DEFAULT_MTU;
 
     mock_gatt_client_reset_errors();
 
@@ -651,6 +700,14 @@ void mock_gatt_client_set_att_error_discover_characteristics(void){
 void mock_gatt_client_set_att_error_discover_characteristic_descriptors(void){
     moc_att_error_code_discover_characteristic_descriptors = ATT_ERROR_REQUEST_NOT_SUPPORTED;
 }
+void mock_gatt_client_set_mtu(uint16_t mtu){
+    mock_gatt_client_mtu = mtu;
+}
+
+uint16_t mock_gatt_client_get_num_coalesced_reads(void){
+    return mock_gatt_client_num_coalesced_reads;
+}
+
 void mock_gatt_client_set_att_error_read_value_characteristics(void){
     moc_att_error_code_read_value_characteristics = ATT_ERROR_REQUEST_NOT_SUPPORTED;
 }
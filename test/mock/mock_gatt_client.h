@@ -93,6 +93,9 @@ void mock_gatt_client_set_att_error_discover_characteristics(void);
 void mock_gatt_client_set_att_error_read_value_characteristics(void);
 void mock_gatt_client_set_att_error_discover_characteristic_descriptors(void);
 
+void mock_gatt_client_set_mtu(uint16_t mtu);
+uint16_t mock_gatt_client_get_num_coalesced_reads(void);
+
 void mock_gatt_client_enable_notification(mock_gatt_client_characteristic_t * characteristic, bool command_allowed);
 void mock_gatt_client_send_notification(mock_gatt_client_characteristic_t * characteristic, const uint8_t * value_buffer, uint16_t value_len);
 void mock_gatt_client_send_notification_with_handle(mock_gatt_client_characteristic_t * characteristic, uint16_t value_handle, const uint8_t * value_buffer, uint16_t value_len);
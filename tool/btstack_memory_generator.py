@@ -307,7 +307,7 @@ list_of_classic_structs = [
     ["avrcp_browsing_connection"],   
 ]
 list_of_le_structs = [
-    ["battery_service_client", "gatt_client", "hids_host", "sm_lookup_entry", "whitelist_entry", "periodic_advertiser_list_entry"],
+    ["att_server_request", "battery_service_client", "gatt_client", "hids_host", "sm_lookup_entry", "whitelist_entry", "periodic_advertiser_list_entry"],
 ]
 list_of_mesh_structs = [
     ['mesh_network_pdu', 'mesh_segmented_pdu', 'mesh_upper_transport_pdu', 'mesh_network_key', 'mesh_transport_key', 'mesh_virtual_address', 'mesh_subnet']
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+#
+# Generate Kaiser windowed-sinc coefficient tables for btstack_resample_polyphase.c
+#
+# Row p of a table holds the filter for a fractional delay of p / num_phases samples.
+# An additional row for a delay of one sample allows to interpolate between adjacent phases.
+# Coefficients are Q14 and each row is normalized to unity gain at DC.
+
+import math
+import sys
+
+NUM_PHASES = 64
+VALUES_PER_LINE = 8
+COEFFICIENT_SHIFT = 14
+
+# num taps -> (cutoff relative to sample rate, kaiser beta)
+FILTERS = {
+    8  : (0.38, 5.0),
+    16 : (0.45, 7.0),
+    32 : (0.46, 8.0),
+}
+
+def bessel_i0(x):
+    result = 1.0
+    term = 1.0
+    k = 1
+    while term > 1e-12 * result:
+        term *= (x / (2.0 * k)) ** 2
+        result += term
+        k += 1
+    return result
+
+def kaiser(t, half_length, beta):
+    ratio = t / half_length
+    if abs(ratio) >= 1.0:
+        return 0.0
+    return bessel_i0(beta * math.sqrt(1.0 - ratio * ratio)) / bessel_i0(beta)
+
+def sinc(x):
+    if x == 0.0:
+        return 1.0
+    return math.sin(math.pi * x) / (math.pi * x)
+
+def generate_row(num_taps, cutoff, beta, delay):
+    center = num_taps / 2 - 1
+    values = []
+    for k in range(num_taps):
+        t = k - center - delay
+        values.append(2.0 * cutoff * sinc(2.0 * cutoff * t) * kaiser(t, num_taps / 2, beta))
+    scale = (1 << COEFFICIENT_SHIFT) / sum(values)
+    row = [int(round(value * scale)) for value in values]
+    # compensate rounding on largest coefficient
+    largest = max(range(num_taps), key=lambda index: abs(row[index]))
+    row[largest] += (1 << COEFFICIENT_SHIFT) - sum(row)
+    return row
+
+def print_table(num_taps):
+    cutoff, beta = FILTERS[num_taps]
+    print('// %u taps, cutoff %.2f * sample rate, kaiser beta %.1f' % (num_taps, cutoff, beta))
+    print('static const int16_t btstack_resample_polyphase_coefficients_%u[] = {' % num_taps)
+    for phase in range(NUM_PHASES + 1):
+        row = generate_row(num_taps, cutoff, beta, phase / NUM_PHASES)
+        for offset in range(0, num_taps, VALUES_PER_LINE):
+            print('    ' + ' '.join('%6d,' % value for value in row[offset:offset + VALUES_PER_LINE]))
+    print('};')
+    print('')
+
+if __name__ == "__main__":
+    for num_taps in sorted(FILTERS.keys()):
+        print_table(num_taps)